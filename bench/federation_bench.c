@@ -0,0 +1,309 @@
+/**
+ * @file federation_bench.c
+ * @brief 跨节点聚合查询的端到端延迟基准测试
+ *
+ * 在一个进程中启动若干节点 (各自的历史存储、查询缓存和本地回环上的查询服务)，
+ * 设备按编号取模分散到各节点，每设备每分钟上传一帧，共24小时。
+ * 协调方按15分钟分桶聚合全部设备24小时的数据，分别测量首次查询 (各节点完整扫描)
+ * 和重复查询 (各节点命中缓存) 的延迟，以及每次查询接收的字节数；
+ * 最后加入一个只监听不应答的节点，查看单节点超时时的延迟和部分结果。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "server/history_federation.h"
+#include "common/realtime_codec.h"
+#include "utils/latency_histogram.h"
+#include "utils/logger.h"
+#include "utils/socket_utils.h"
+
+#define CHANNELS_PER_DEVICE 8       // 每设备通道数
+#define FRAME_INTERVAL_S 60         // 每设备上传间隔(秒)
+#define DAY_SECONDS 86400           // 数据覆盖的时间
+#define BUCKET_MS (15 * 60 * 1000)  // 聚合桶宽
+#define MAX_BENCH_NODES 8           // 最多节点数
+#define START_SECONDS 1699999200u   // 数据起始时间 (对齐到15分钟)
+
+/**
+ * @brief 一个节点
+ */
+typedef struct {
+    char dir[96];                   // 段文件目录
+    history_store_t hist;           // 历史存储
+    query_cache_t cache;            // 查询缓存
+    federation_server_t server;     // 查询服务
+} bench_node_t;
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 构造一帧实时信息内容，计数和占有率随机
+ */
+static size_t build_content(uint8_t *content, uint32_t seconds) {
+    size_t len = 0;
+    memcpy(&content[len], &seconds, 4);
+    len += 6;
+    content[4] = content[5] = 0;
+    content[len++] = CHANNELS_PER_DEVICE;
+    for (int ch = 0; ch < CHANNELS_PER_DEVICE; ch++) {
+        uint8_t *p = &content[len];
+        uint16_t occupancy = (uint16_t)(rand() % 1000);
+        memset(p, 0, REALTIME_RECORD_SIZE);
+        p[0] = (uint8_t)(ch + 1);
+        p[1] = (uint8_t)(rand() % 4);
+        p[4] = (uint8_t)(occupancy & 0xFF);
+        p[5] = (uint8_t)(occupancy >> 8);
+        p[6] = (uint8_t)(rand() % 90);
+        len += REALTIME_RECORD_SIZE;
+    }
+    return len;
+}
+
+/**
+ * @brief 为一个节点生成温层段：编号模nodes等于index的设备，24小时
+ * @return 写入的行数，-1失败
+ */
+static int64_t generate(const char *dir, int index, int nodes, int devices) {
+    realtime_columns_t cols;
+    if (realtime_columns_init(&cols, REALTIME_STORE_CHUNK_ROWS) < 0) {
+        return -1;
+    }
+
+    uint8_t content[MAX_CONTENT_SIZE];
+    uint64_t next_row = 0;
+    int64_t rows = 0;
+    cols.count = 0;
+    for (uint32_t s = 0; s < DAY_SECONDS; s += FRAME_INTERVAL_S) {
+        for (int d = index; d < devices; d += nodes) {
+            device_id_t sender = create_device_id(110000, DEVICE_TYPE_COIL, (uint16_t)(d + 1));
+            size_t len = build_content(content, START_SECONDS + s);
+            realtime_decode_content(&cols, &sender, content, len, (int64_t)(START_SECONDS + s) * 1000000000LL);
+            if (cols.count + CHANNELS_PER_DEVICE > REALTIME_STORE_CHUNK_ROWS ||
+                (s + FRAME_INTERVAL_S >= DAY_SECONDS && d + nodes >= devices)) {
+                if (history_write_segment(dir, HISTORY_TIER_WARM, &cols, next_row) < 0) {
+                    realtime_columns_free(&cols);
+                    return -1;
+                }
+                next_row += cols.count;
+                rows += (int64_t)cols.count;
+                cols.count = 0;
+            }
+        }
+    }
+    realtime_columns_free(&cols);
+    return rows;
+}
+
+/**
+ * @brief 删除生成的目录
+ */
+static void remove_dir(const char *dir) {
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", dir);
+    }
+}
+
+/**
+ * @brief 启动节点：生成数据、打开存储并启动查询服务
+ * @return 节点的行数，-1失败
+ */
+static int64_t start_node(bench_node_t *node, const char *base, int index, int nodes, int devices) {
+    snprintf(node->dir, sizeof(node->dir), "%s/n%d_%d", base, nodes, index);
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = node->dir;
+    config.warm_max_bytes = UINT64_MAX;
+    config.query_max_bytes = UINT64_MAX;
+    config.warmup_threads = -1;
+
+    // 先打开一次以创建目录
+    if (history_init(&node->hist, &config) < 0) {
+        return -1;
+    }
+    history_destroy(&node->hist);
+    int64_t rows = generate(node->dir, index, nodes, devices);
+    if (rows < 0 || history_init(&node->hist, &config) < 0) {
+        return -1;
+    }
+    if (query_cache_init(&node->cache, &node->hist, 0) < 0 ||
+        federation_server_start(&node->server, &node->cache, 0, 0) < 0) {
+        history_destroy(&node->hist);
+        return -1;
+    }
+    return rows;
+}
+
+/**
+ * @brief 停止节点并删除数据
+ */
+static void stop_node(bench_node_t *node) {
+    federation_server_stop(&node->server);
+    query_cache_destroy(&node->cache);
+    history_destroy(&node->hist);
+    remove_dir(node->dir);
+}
+
+/**
+ * @brief 执行一轮查询并记录延迟
+ * @return 0全部节点完整返回，-1有节点未完整返回
+ */
+static int run_query(federation_t *fed, latency_histogram_t *hist, uint64_t *bytes) {
+    realtime_query_t query;
+    realtime_query_init(&query);
+    query.start_ms = (int64_t)START_SECONDS * 1000;
+    query.end_ms = query.start_ms + (int64_t)DAY_SECONDS * 1000;
+    query_bucket_t buckets[DAY_SECONDS * 1000 / BUCKET_MS];
+    federation_node_status_t status[FEDERATION_MAX_NODES];
+
+    int64_t begin = now_ns();
+    int64_t count = federation_aggregate(fed, &query, BUCKET_MS, buckets, sizeof(buckets) / sizeof(buckets[0]),
+                                         status);
+    latency_histogram_record(hist, (uint64_t)(now_ns() - begin));
+    int complete = count >= 0;
+    for (size_t i = 0; i < fed->node_count; i++) {
+        complete = complete && status[i].state == FEDERATION_NODE_OK;
+        *bytes += status[i].bytes;
+    }
+    return complete ? 0 : -1;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -D <n>       Devices (default: 200)\n");
+    printf("  -n <n>       Largest node count, runs 1, 2, 4 ... up to n (default: 8)\n");
+    printf("  -q <n>       Repeated queries per node count (default: 50)\n");
+    printf("  -T <ms>      Timeout of the stalled node (default: 100)\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int devices = 200;
+    int max_nodes = MAX_BENCH_NODES;
+    int queries = 50;
+    int stall_timeout_ms = 100;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "D:n:q:T:h")) != -1) {
+        switch (opt) {
+            case 'D':
+                devices = atoi(optarg);
+                break;
+            case 'n':
+                max_nodes = atoi(optarg);
+                break;
+            case 'q':
+                queries = atoi(optarg);
+                break;
+            case 'T':
+                stall_timeout_ms = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (devices < 1 || devices > 65535 || max_nodes < 1 || max_nodes > MAX_BENCH_NODES || queries < 1 ||
+        stall_timeout_ms < 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_ERROR, NULL);
+    srand(1);
+
+    char base[64];
+    snprintf(base, sizeof(base), "/tmp/federation_bench.%d", (int)getpid());
+    if (mkdir(base, 0755) < 0) {
+        fprintf(stderr, "Failed to create %s\n", base);
+        return 1;
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("Federated aggregate benchmark: %d devices x %d channels, 24 h, 15-min buckets, %ld online CPUs\n\n",
+           devices, CHANNELS_PER_DEVICE, online);
+
+    static bench_node_t nodes[MAX_BENCH_NODES];
+    latency_histogram_t hist;
+    int failed = 0;
+    for (int count = 1; count <= max_nodes && !failed; count *= 2) {
+        federation_node_t addrs[MAX_BENCH_NODES + 1];
+        memset(addrs, 0, sizeof(addrs));
+        int64_t rows = 0;
+        int started = 0;
+        for (; started < count; started++) {
+            int64_t node_rows = start_node(&nodes[started], base, started, count, devices);
+            if (node_rows < 0) {
+                break;
+            }
+            rows += node_rows;
+            snprintf(addrs[started].host, sizeof(addrs[started].host), "127.0.0.1");
+            addrs[started].port = nodes[started].server.port;
+        }
+
+        federation_t fed;
+        if (started < count || federation_init(&fed, addrs, (size_t)count, 0) < 0) {
+            fprintf(stderr, "Failed to start %d nodes\n", count);
+            failed = 1;
+        } else {
+            // 首次查询各节点完整扫描，之后命中各节点的缓存
+            uint64_t bytes = 0;
+            latency_histogram_reset(&hist);
+            failed = run_query(&fed, &hist, &bytes) < 0;
+            double first_ms = hist.max_ns / 1e6;
+            latency_histogram_reset(&hist);
+            bytes = 0;
+            for (int q = 0; q < queries && !failed; q++) {
+                failed = run_query(&fed, &hist, &bytes) < 0;
+            }
+            printf("  nodes %d: %9lld rows  first %8.2f ms  cached p50 %7.3f ms  p99 %7.3f ms  %6llu bytes/query\n",
+                   count, (long long)rows, first_ms, latency_histogram_percentile(&hist, 50) / 1e6,
+                   latency_histogram_percentile(&hist, 99) / 1e6, (unsigned long long)(bytes / (uint64_t)queries));
+
+            // 加入一个只监听不应答的节点
+            int stalled_fd = count * 2 > max_nodes ? create_tcp_server(0) : -1;
+            struct sockaddr_in addr;
+            socklen_t addr_len = sizeof(addr);
+            if (stalled_fd >= 0 && getsockname(stalled_fd, (struct sockaddr *)&addr, &addr_len) == 0) {
+                snprintf(addrs[count].host, sizeof(addrs[count].host), "127.0.0.1");
+                addrs[count].port = ntohs(addr.sin_port);
+                addrs[count].timeout_ms = stall_timeout_ms;
+                federation_init(&fed, addrs, (size_t)count + 1, 0);
+                latency_histogram_reset(&hist);
+                bytes = 0;
+                int partial = run_query(&fed, &hist, &bytes) < 0;
+                printf("  nodes %d + 1 stalled: %s result in %.2f ms (timeout %d ms)\n", count,
+                       partial ? "partial" : "complete", hist.max_ns / 1e6, stall_timeout_ms);
+            }
+            if (stalled_fd >= 0) {
+                close(stalled_fd);
+            }
+        }
+        for (int i = 0; i < started; i++) {
+            stop_node(&nodes[i]);
+        }
+    }
+
+    remove_dir(base);
+    return failed;
+}
@@ -0,0 +1,165 @@
+/**
+ * @file forecast_bench.c
+ * @brief 按通道流量预测的更新开销基准测试
+ *
+ * 预先构造大量设备的实时信息内容 (每2秒一帧，计数随时段和随机扰动变化)，
+ * 按帧调用flow_forecast_update，统计每个通道更新的平均耗时；
+ * 另外测量读取单个通道预测的耗时，并输出一个通道的预测与实际流量对比。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "server/flow_forecast.h"
+#include "common/realtime_codec.h"
+#include "utils/logger.h"
+
+#define FRAME_INTERVAL_MS 2000      // 帧间隔(毫秒)
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 构造一帧实时信息内容，每通道的车辆数围绕mean随机波动
+ */
+static size_t build_content(uint8_t *content, int64_t timestamp_ms, int channels, int mean) {
+    size_t len = 0;
+    uint32_t seconds = (uint32_t)(timestamp_ms / 1000);
+    uint16_t milliseconds = (uint16_t)(timestamp_ms % 1000);
+
+    memcpy(&content[len], &seconds, 4);
+    len += 4;
+    memcpy(&content[len], &milliseconds, 2);
+    len += 2;
+    content[len++] = (uint8_t)channels;
+    for (int ch = 0; ch < channels; ch++) {
+        uint8_t *p = &content[len];
+        int vehicles = mean + rand() % 3 - 1;
+        memset(p, 0, REALTIME_RECORD_SIZE);
+        p[0] = (uint8_t)(ch + 1);
+        p[3] = (uint8_t)(vehicles > 0 ? vehicles : 0);
+        len += REALTIME_RECORD_SIZE;
+    }
+    return len;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -d <n>       Detectors (default: 2000)\n");
+    printf("  -C <n>       Channels per detector (default: 8)\n");
+    printf("  -f <n>       Frames per detector (default: 200)\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int detectors = 2000;
+    int channels = 8;
+    int frames = 200;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:C:f:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                detectors = atoi(optarg);
+                break;
+            case 'C':
+                channels = atoi(optarg);
+                break;
+            case 'f':
+                frames = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (detectors < 1 || frames < 2 || channels < 1 || channels > MAX_CHANNELS) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+    srand(1);
+
+    // 预先构造全部帧，计时只覆盖模型更新
+    size_t content_size = REALTIME_CONTENT_HEADER_SIZE + (size_t)channels * REALTIME_RECORD_SIZE;
+    uint8_t *contents = malloc((size_t)detectors * frames * content_size);
+    if (!contents) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    int64_t start_ms = 1700000000000LL;
+    for (int f = 0; f < frames; f++) {
+        // 流量在测试时段内逐步上升，用于观察趋势项
+        int mean = 2 + f * 4 / frames;
+        for (int d = 0; d < detectors; d++) {
+            build_content(contents + ((size_t)f * detectors + d) * content_size,
+                          start_ms + (int64_t)f * FRAME_INTERVAL_MS, channels, mean);
+        }
+    }
+
+    flow_forecast_t forecast;
+    if (flow_forecast_init(&forecast, (size_t)detectors * ((channels + 3) & ~3), NULL) < 0) {
+        free(contents);
+        return 1;
+    }
+
+    device_id_t *ids = malloc(detectors * sizeof(device_id_t));
+    for (int d = 0; d < detectors; d++) {
+        ids[d] = create_device_id(110100, DEVICE_TYPE_COIL, (uint16_t)(d + 1));
+    }
+
+    int64_t begin = now_ns();
+    for (int f = 0; f < frames; f++) {
+        for (int d = 0; d < detectors; d++) {
+            flow_forecast_update(&forecast, &ids[d],
+                                 contents + ((size_t)f * detectors + d) * content_size, content_size);
+        }
+    }
+    int64_t elapsed = now_ns() - begin;
+
+    forecast_result_t result;
+    int64_t read_begin = now_ns();
+    int reads = 1000000;
+    for (int i = 0; i < reads; i++) {
+        flow_forecast_read(&forecast, &ids[i % detectors], 1 + i % channels, &result);
+    }
+    int64_t read_elapsed = now_ns() - read_begin;
+
+    printf("Forecast benchmark: %d detectors x %d channels, %d frames each\n\n",
+           detectors, channels, frames);
+    printf("  frame updates:     %lld\n", (long long)detectors * frames);
+    printf("  channel updates:   %llu\n", (unsigned long long)forecast.updates);
+    printf("  ns per frame:      %.1f\n", (double)elapsed / ((double)detectors * frames));
+    printf("  ns per channel:    %.1f\n", forecast.updates ? (double)elapsed / forecast.updates : 0);
+    printf("  ns per read:       %.1f\n", (double)read_elapsed / reads);
+
+    flow_forecast_read(&forecast, &ids[0], 1, &result);
+    printf("\n  detector 1 channel 1: flow %.0f veh/h, forecast", result.flow);
+    for (int h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+        printf(" +%ds %.0f", (h + 1) * FORECAST_HORIZON_STEP_S, result.prediction[h]);
+    }
+    printf(" (error variance %.0f)\n", result.variance);
+
+    flow_forecast_destroy(&forecast);
+    free(ids);
+    free(contents);
+    return 0;
+}
@@ -0,0 +1,300 @@
+/**
+ * @file io_bench.c
+ * @brief 接收路径磁盘写入的尾延迟基准测试
+ *
+ * 模拟控制机主循环：按固定速率追加抓包记录，并每秒提交一次fdatasync，
+ * 同时后台线程持续大块写入并fdatasync另一个文件 (fsync风暴)，另一个线程随机读取历史段大小的文件。
+ * 分别测量同步模式 (stdio写入、主循环中直接fdatasync) 和异步模式
+ * (固定缓冲区打包、async_io提交写入和fdatasync) 下每次追加的耗时分布。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "server/capture_writer.h"
+#include "utils/async_io.h"
+#include "utils/latency_histogram.h"
+#include "utils/logger.h"
+
+#define FRAME_SIZE 120              // 每条记录的帧长度
+#define STORM_CHUNK (4 << 20)       // fsync风暴每次写入的字节数
+#define READ_FILE_BYTES (64 << 20)  // 随机读取的文件大小
+#define READ_SIZE (256 * 1024)      // 每次随机读取的字节数
+
+/**
+ * @brief 后台干扰线程的参数
+ */
+typedef struct {
+    const char *path;           // 文件路径
+    volatile int *stop;         // 停止标志
+    uint64_t operations;        // 完成的操作数
+} noise_arg_t;
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 睡眠到指定的单调时钟时间
+ */
+static void sleep_until(int64_t deadline_ns) {
+    struct timespec ts = {deadline_ns / 1000000000LL, deadline_ns % 1000000000LL};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+    }
+}
+
+/**
+ * @brief fsync风暴：反复写入大块数据并fdatasync
+ */
+static void *storm_thread(void *arg) {
+    noise_arg_t *noise = (noise_arg_t *)arg;
+    uint8_t *chunk = malloc(STORM_CHUNK);
+    int fd = open(noise->path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (!chunk || fd < 0) {
+        free(chunk);
+        return NULL;
+    }
+    memset(chunk, 0x5A, STORM_CHUNK);
+    off_t offset = 0;
+    while (!*noise->stop) {
+        if (pwrite(fd, chunk, STORM_CHUNK, offset) != STORM_CHUNK || fdatasync(fd) < 0) {
+            break;
+        }
+        // 文件保持在64MB以内
+        offset = (offset + STORM_CHUNK) % (64 << 20);
+        noise->operations++;
+    }
+    close(fd);
+    free(chunk);
+    return NULL;
+}
+
+/**
+ * @brief 历史读取：随机偏移读取并丢弃页缓存
+ */
+static void *reader_thread(void *arg) {
+    noise_arg_t *noise = (noise_arg_t *)arg;
+    uint8_t *buffer = malloc(READ_SIZE);
+    int fd = open(noise->path, O_RDONLY);
+    if (!buffer || fd < 0) {
+        free(buffer);
+        return NULL;
+    }
+    unsigned seed = 1;
+    while (!*noise->stop) {
+        off_t offset = (off_t)(rand_r(&seed) % (READ_FILE_BYTES / READ_SIZE)) * READ_SIZE;
+        if (pread(fd, buffer, READ_SIZE, offset) < 0) {
+            break;
+        }
+        posix_fadvise(fd, offset, READ_SIZE, POSIX_FADV_DONTNEED);
+        noise->operations++;
+    }
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief 创建随机读取的文件
+ */
+static int create_read_file(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return -1;
+    }
+    uint8_t block[64 * 1024];
+    memset(block, 0xA5, sizeof(block));
+    for (size_t written = 0; written < READ_FILE_BYTES; written += sizeof(block)) {
+        if (fwrite(block, 1, sizeof(block), fp) != sizeof(block)) {
+            fclose(fp);
+            return -1;
+        }
+    }
+    return fclose(fp) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief 执行一轮：按速率追加记录，每秒同步一次
+ * @param io 异步I/O实例，NULL表示同步模式
+ */
+static int run_mode(const char *capture_path, async_io_t *io, int rate, int seconds,
+                    latency_histogram_t *hist, uint64_t *dropped) {
+    capture_writer_t writer;
+    async_io_owner_t owner;
+    if (io) {
+        if (async_io_owner_init(&owner, 0) < 0 ||
+            capture_writer_open_async(&writer, capture_path, io, &owner) < 0) {
+            return -1;
+        }
+    } else if (capture_writer_open(&writer, capture_path) < 0) {
+        return -1;
+    }
+
+    uint8_t frame[FRAME_SIZE];
+    memset(frame, 0x7E, sizeof(frame));
+    latency_histogram_reset(hist);
+    int64_t interval_ns = 1000000000LL / rate;
+    int64_t start = now_ns();
+    int64_t next_sync = start + 1000000000LL;
+    int64_t total = (int64_t)rate * seconds;
+    for (int64_t i = 0; i < total; i++) {
+        int64_t due = start + i * interval_ns;
+        sleep_until(due);
+
+        int64_t begin = now_ns();
+        if (io) {
+            async_io_poll(&owner);
+        }
+        capture_writer_write(&writer, begin, frame, sizeof(frame));
+        if (begin >= next_sync) {
+            capture_writer_sync(&writer);
+            if (!io) {
+                fdatasync(fileno(writer.fp));
+            }
+            next_sync += 1000000000LL;
+        }
+        latency_histogram_record(hist, (uint64_t)(now_ns() - begin));
+    }
+
+    *dropped = writer.dropped;
+    capture_writer_close(&writer);
+    if (io) {
+        async_io_owner_destroy(&owner);
+    }
+    return 0;
+}
+
+/**
+ * @brief 输出一轮的延迟分布
+ */
+static void print_result(const char *name, const latency_histogram_t *hist, uint64_t dropped) {
+    printf("  %-22s p50 %8.1f us  p99 %9.1f us  p99.9 %9.1f us  max %9.1f us  dropped %llu\n", name,
+           latency_histogram_percentile(hist, 50) / 1e3, latency_histogram_percentile(hist, 99) / 1e3,
+           latency_histogram_percentile(hist, 99.9) / 1e3, hist->max_ns / 1e3, (unsigned long long)dropped);
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -r <n>       Records per second (default: 20000)\n");
+    printf("  -t <n>       Seconds per mode (default: 5)\n");
+    printf("  -d <dir>     Directory for test files (default: /tmp)\n");
+    printf("  -q           No background fsync storm and history reads\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int rate = 20000;
+    int seconds = 5;
+    const char *dir = "/tmp";
+    int quiet = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:t:d:qh")) != -1) {
+        switch (opt) {
+            case 'r':
+                rate = atoi(optarg);
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            case 'q':
+                quiet = 1;
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (rate < 1 || rate > 1000000 || seconds < 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    char capture_path[300];
+    char storm_path[300];
+    char read_path[300];
+    snprintf(capture_path, sizeof(capture_path), "%s/io_bench.%d.cap", dir, (int)getpid());
+    snprintf(storm_path, sizeof(storm_path), "%s/io_bench.%d.storm", dir, (int)getpid());
+    snprintf(read_path, sizeof(read_path), "%s/io_bench.%d.read", dir, (int)getpid());
+    if (!quiet && create_read_file(read_path) < 0) {
+        fprintf(stderr, "Failed to create %s\n", read_path);
+        return 1;
+    }
+
+    async_io_t io;
+    if (async_io_init(&io, NULL) < 0) {
+        unlink(read_path);
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("Ingest append latency: %d records/s, %d s per mode, %s background I/O, %ld online CPUs\n\n",
+           rate, seconds, quiet ? "no" : "with", online);
+
+    latency_histogram_t hist;
+    uint64_t dropped = 0;
+    for (int mode = 0; mode < 2; mode++) {
+        volatile int stop = 0;
+        noise_arg_t storm = {storm_path, &stop, 0};
+        noise_arg_t reader = {read_path, &stop, 0};
+        pthread_t threads[2];
+        if (!quiet) {
+            pthread_create(&threads[0], NULL, storm_thread, &storm);
+            pthread_create(&threads[1], NULL, reader_thread, &reader);
+        }
+
+        int result = run_mode(capture_path, mode ? &io : NULL, rate, seconds, &hist, &dropped);
+
+        stop = 1;
+        if (!quiet) {
+            pthread_join(threads[0], NULL);
+            pthread_join(threads[1], NULL);
+        }
+        if (result < 0) {
+            fprintf(stderr, "Failed to open %s\n", capture_path);
+            break;
+        }
+        char name[64];
+        if (mode) {
+            snprintf(name, sizeof(name), "async (%s)", async_io_backend_name(&io));
+        } else {
+            snprintf(name, sizeof(name), "sync (inline fsync)");
+        }
+        print_result(name, &hist, dropped);
+        if (!quiet) {
+            printf("  %-22s %llu storm fsyncs, %llu history reads\n", "",
+                   (unsigned long long)storm.operations, (unsigned long long)reader.operations);
+        }
+    }
+
+    printf("\n  async I/O: %llu requests in %llu batches (max %llu)\n",
+           (unsigned long long)io.completed, (unsigned long long)io.batches, (unsigned long long)io.max_batch);
+    async_io_destroy(&io);
+    unlink(capture_path);
+    unlink(storm_path);
+    unlink(read_path);
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file query_bench.c
+ * @brief 历史查询的并行扩展基准测试
+ *
+ * 在临时目录中生成若干段历史数据 (多个设备按时间顺序交替上传，每段65536行)，
+ * 分别用不同的查询工作线程数打开存储，重复执行覆盖全部时间范围的
+ * 单设备查询和全量查询，输出每次查询的耗时和相对单线程的加速比。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "server/history_store.h"
+#include "common/realtime_codec.h"
+#include "utils/logger.h"
+
+#define CHANNELS_PER_DEVICE 8       // 每设备通道数
+#define FRAME_INTERVAL_S 60         // 每设备上传间隔(秒)
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 构造一帧实时信息内容，计数和占有率随机
+ */
+static size_t build_content(uint8_t *content, uint32_t seconds) {
+    size_t len = 0;
+    memcpy(&content[len], &seconds, 4);
+    len += 6;
+    content[4] = content[5] = 0;
+    content[len++] = CHANNELS_PER_DEVICE;
+    for (int ch = 0; ch < CHANNELS_PER_DEVICE; ch++) {
+        uint8_t *p = &content[len];
+        uint16_t occupancy = (uint16_t)(rand() % 1000);
+        memset(p, 0, REALTIME_RECORD_SIZE);
+        p[0] = (uint8_t)(ch + 1);
+        p[1] = (uint8_t)(rand() % 4);
+        p[4] = (uint8_t)(occupancy & 0xFF);
+        p[5] = (uint8_t)(occupancy >> 8);
+        p[6] = (uint8_t)(rand() % 90);
+        len += REALTIME_RECORD_SIZE;
+    }
+    return len;
+}
+
+/**
+ * @brief 生成历史段
+ * @return 写入的行数，-1失败
+ */
+static int64_t generate(const char *dir, history_tier_t tier, int segments, int devices) {
+    realtime_columns_t cols;
+    if (realtime_columns_init(&cols, REALTIME_STORE_CHUNK_ROWS) < 0) {
+        return -1;
+    }
+
+    uint8_t content[MAX_CONTENT_SIZE];
+    uint64_t next_row = history_import_next_row(dir);
+    uint32_t seconds = 1700000000;
+    int device = 0;
+    int64_t rows = 0;
+    for (int s = 0; s < segments; s++) {
+        cols.count = 0;
+        while (cols.count + CHANNELS_PER_DEVICE <= REALTIME_STORE_CHUNK_ROWS) {
+            device_id_t sender = create_device_id(110000, DEVICE_TYPE_COIL, (uint16_t)(device + 1));
+            size_t len = build_content(content, seconds);
+            realtime_decode_content(&cols, &sender, content, len, (int64_t)seconds * 1000000000LL);
+            if (++device == devices) {
+                device = 0;
+                seconds += FRAME_INTERVAL_S;
+            }
+        }
+        if (history_write_segment(dir, tier, &cols, next_row) < 0) {
+            realtime_columns_free(&cols);
+            return -1;
+        }
+        next_row += cols.count;
+        rows += (int64_t)cols.count;
+    }
+    realtime_columns_free(&cols);
+    return rows;
+}
+
+/**
+ * @brief 删除生成的目录
+ */
+static void remove_dir(const char *dir) {
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", dir);
+    }
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -s <n>       Segments of 65536 rows (default: 64)\n");
+    printf("  -D <n>       Devices (default: 500)\n");
+    printf("  -q <n>       Queries per thread count (default: 5)\n");
+    printf("  -w           Write warm (uncompressed) segments instead of cold\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int segments = 64;
+    int devices = 500;
+    int queries = 5;
+    history_tier_t tier = HISTORY_TIER_COLD;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:D:q:wh")) != -1) {
+        switch (opt) {
+            case 's':
+                segments = atoi(optarg);
+                break;
+            case 'D':
+                devices = atoi(optarg);
+                break;
+            case 'q':
+                queries = atoi(optarg);
+                break;
+            case 'w':
+                tier = HISTORY_TIER_WARM;
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (segments < 1 || devices < 1 || devices > 65535 || queries < 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+    srand(1);
+
+    char dir[64];
+    snprintf(dir, sizeof(dir), "/tmp/query_bench.%d", (int)getpid());
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = dir;
+    config.cold_max_bytes = UINT64_MAX;
+    config.warm_max_bytes = UINT64_MAX;
+    config.query_max_bytes = UINT64_MAX;
+
+    // 先打开一次以创建目录
+    history_store_t hist;
+    config.query_threads = -1;
+    if (history_init(&hist, &config) < 0) {
+        return 1;
+    }
+    history_destroy(&hist);
+    int64_t rows = generate(dir, tier, segments, devices);
+    if (rows < 0) {
+        fprintf(stderr, "Failed to generate history segments\n");
+        remove_dir(dir);
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("History query benchmark: %d %s segments, %lld rows, %d devices, %ld online CPUs\n\n",
+           segments, history_tier_name(tier), (long long)rows, devices, online);
+
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    realtime_query_t query;
+    double base_ms[2] = {0, 0};
+    int thread_counts[] = {-1, 1, 3, 7};
+    for (size_t k = 0; k < sizeof(thread_counts) / sizeof(thread_counts[0]); k++) {
+        config.query_threads = thread_counts[k];
+        if (history_init(&hist, &config) < 0) {
+            break;
+        }
+
+        // 工作线程加上调用线程
+        int threads = hist.query_threads + 1;
+        printf("  threads %d:", threads);
+        for (int kind = 0; kind < 2; kind++) {
+            realtime_query_init(&query);
+            if (kind == 0) {
+                query.match_device = 1;
+                query.device = create_device_id(110000, DEVICE_TYPE_COIL, 1);
+            }
+            int64_t matched = 0;
+            int64_t begin = now_ns();
+            for (int q = 0; q < queries; q++) {
+                out.count = 0;
+                matched = history_query(&hist, &query, &out);
+            }
+            double ms = (double)(now_ns() - begin) / queries / 1e6;
+            if (k == 0) {
+                base_ms[kind] = ms;
+            }
+            printf("  %s %8.1f ms (%5.2fx, %lld rows)", kind == 0 ? "device" : "full",
+                   ms, base_ms[kind] / ms, (long long)matched);
+        }
+        printf("\n");
+        history_destroy(&hist);
+    }
+
+    realtime_columns_free(&out);
+    remove_dir(dir);
+    return 0;
+}
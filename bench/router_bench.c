@@ -0,0 +1,411 @@
+/**
+ * @file router_bench.c
+ * @brief 帧路由转发器吞吐量基准测试
+ *
+ * 启动一个只计数的信号机端，分别以copy(解码再编码)和splice(零拷贝直通)模式运行
+ * frame_router，多个检测器连接并发推送实时数据帧，对比吞吐量和路由进程的CPU开销。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include "common/protocol.h"
+#include "utils/socket_utils.h"
+#include "utils/logger.h"
+
+#define MAX_BENCH_CONNECTIONS 64    // 最大并发连接数
+#define FRAMES_PER_SEND 64          // 每次send的帧数
+#define WAIT_TIMEOUT_SEC 120        // 等待数据全部到达的超时时间
+
+/**
+ * @brief 基准测试参数
+ */
+typedef struct {
+    const char *router_path;    // frame_router可执行文件
+    int connections;            // 并发连接数
+    long frames_per_conn;       // 每个连接发送的帧数
+    int channels;               // 每帧通道数
+} bench_config_t;
+
+/**
+ * @brief 单个发送线程参数
+ */
+typedef struct {
+    int port;                   // 路由器端口
+    int index;                  // 连接序号
+    const bench_config_t *config;
+    size_t bytes_sent;          // 已发送字节数
+} sender_arg_t;
+
+/**
+ * @brief 单轮测试结果
+ */
+typedef struct {
+    double seconds;             // 耗时
+    uint64_t bytes;             // 信号机端收到的字节数
+    double router_cpu;          // 路由进程CPU时间(秒)
+    int complete;               // 是否收齐全部数据
+} bench_result_t;
+
+static volatile uint64_t g_sink_bytes = 0;
+static volatile int g_sink_running = 0;
+
+/**
+ * @brief 获取单调时钟秒数
+ */
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 读取进程累计CPU时间(秒)
+ */
+static double process_cpu_seconds(pid_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        return 0;
+    }
+
+    char line[1024];
+    double seconds = 0;
+    if (fgets(line, sizeof(line), fp)) {
+        // comm字段可能含空格，从最后一个')'之后开始解析
+        char *p = strrchr(line, ')');
+        unsigned long utime = 0, stime = 0;
+        if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                        &utime, &stime) == 2) {
+            seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+        }
+    }
+    fclose(fp);
+    return seconds;
+}
+
+/**
+ * @brief 信号机端连接处理线程：只计数不解析
+ */
+static void *sink_conn_thread(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    static __thread uint8_t buffer[65536];
+
+    while (1) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            break;
+        }
+        __atomic_fetch_add(&g_sink_bytes, (uint64_t)n, __ATOMIC_RELAXED);
+    }
+    close(fd);
+    return NULL;
+}
+
+/**
+ * @brief 信号机端监听线程
+ */
+static void *sink_accept_thread(void *arg) {
+    int listen_fd = (int)(intptr_t)arg;
+
+    while (g_sink_running) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        pthread_t thread;
+        pthread_create(&thread, NULL, sink_conn_thread, (void *)(intptr_t)fd);
+        pthread_detach(thread);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 构造一帧实时数据
+ */
+static int build_realtime_frame(int index, int channels, uint8_t *buffer, size_t size) {
+    uint8_t content[MAX_CONTENT_SIZE];
+    size_t len = 0;
+    device_time_t now = get_current_time();
+
+    memcpy(&content[len], &now.timestamp, 4);
+    len += 4;
+    memcpy(&content[len], &now.milliseconds, 2);
+    len += 2;
+    content[len++] = (uint8_t)channels;
+    for (int ch = 0; ch < channels; ch++) {
+        uint8_t *p = &content[len];
+        memset(p, 0, 19);
+        p[0] = (uint8_t)(ch + 1);
+        p[1] = 1;
+        p[2] = 2;
+        p[3] = 5;
+        p[4] = 0x2C;
+        p[5] = 0x01;
+        p[6] = 45;
+        len += 19;
+    }
+
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(110100, DEVICE_TYPE_RADAR, 1000 + index),
+                                   create_device_id(110100, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, len);
+    int encoded = encode_frame(&frame, buffer, size);
+    free(frame.data.content);
+    return encoded;
+}
+
+/**
+ * @brief 构造一帧通信连接请求 (splice模式下会走完整解码路径)
+ */
+static int build_register_frame(int index, uint8_t *buffer, size_t size) {
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(110100, DEVICE_TYPE_RADAR, 1000 + index),
+                                   create_device_id(110100, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    return encode_frame(&frame, buffer, size);
+}
+
+/**
+ * @brief 检测器发送线程
+ */
+static void *sender_thread(void *arg) {
+    sender_arg_t *sender = (sender_arg_t *)arg;
+    uint8_t frame[MAX_FRAME_SIZE];
+    uint8_t *batch = malloc((size_t)FRAMES_PER_SEND * MAX_FRAME_SIZE);
+
+    int fd = create_tcp_client("127.0.0.1", sender->port);
+    if (fd < 0 || !batch) {
+        free(batch);
+        return NULL;
+    }
+
+    int len = build_register_frame(sender->index, frame, sizeof(frame));
+    send_all(fd, frame, len);
+    sender->bytes_sent += len;
+
+    len = build_realtime_frame(sender->index, sender->config->channels, frame, sizeof(frame));
+    for (int i = 0; i < FRAMES_PER_SEND; i++) {
+        memcpy(batch + (size_t)i * len, frame, len);
+    }
+
+    long remaining = sender->config->frames_per_conn;
+    while (remaining > 0) {
+        long count = remaining < FRAMES_PER_SEND ? remaining : FRAMES_PER_SEND;
+        if (send_all(fd, batch, (size_t)count * len) < 0) {
+            break;
+        }
+        sender->bytes_sent += (size_t)count * len;
+        remaining -= count;
+    }
+
+    shutdown(fd, SHUT_WR);
+    // 等待路由器关闭连接，保证数据已全部转发
+    char drain[4096];
+    while (recv(fd, drain, sizeof(drain), 0) > 0) {
+    }
+    close(fd);
+    free(batch);
+    return NULL;
+}
+
+/**
+ * @brief 等待端口可连接
+ */
+static int wait_for_port(int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i = 0; i < 100; i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        int connected = connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+        close(fd);
+        if (connected) {
+            return 0;
+        }
+        usleep(20000);
+    }
+    return -1;
+}
+
+/**
+ * @brief 运行一轮基准测试
+ */
+static int run_bench(const bench_config_t *config, const char *mode,
+                     int sink_port, int router_port, bench_result_t *result) {
+    memset(result, 0, sizeof(*result));
+    __atomic_store_n(&g_sink_bytes, 0, __ATOMIC_RELAXED);
+
+    char listen_arg[16], upstream_arg[32];
+    snprintf(listen_arg, sizeof(listen_arg), "%d", router_port);
+    snprintf(upstream_arg, sizeof(upstream_arg), "127.0.0.1:%d", sink_port);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        execl(config->router_path, config->router_path, "-p", listen_arg, "-u", upstream_arg,
+              "-m", mode, "-l", "3", (char *)NULL);
+        _exit(127);
+    }
+
+    if (wait_for_port(router_port) < 0) {
+        fprintf(stderr, "Router did not start: %s\n", config->router_path);
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    // wait_for_port的探测连接在路由器侧会被关闭，稍候再开始计数
+    usleep(100000);
+    __atomic_store_n(&g_sink_bytes, 0, __ATOMIC_RELAXED);
+
+    sender_arg_t senders[MAX_BENCH_CONNECTIONS];
+    pthread_t threads[MAX_BENCH_CONNECTIONS];
+    double cpu_start = process_cpu_seconds(pid);
+    double start = now_sec();
+
+    for (int i = 0; i < config->connections; i++) {
+        senders[i].port = router_port;
+        senders[i].index = i;
+        senders[i].config = config;
+        senders[i].bytes_sent = 0;
+        pthread_create(&threads[i], NULL, sender_thread, &senders[i]);
+    }
+    for (int i = 0; i < config->connections; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64_t expected = 0;
+    for (int i = 0; i < config->connections; i++) {
+        expected += senders[i].bytes_sent;
+    }
+    while (__atomic_load_n(&g_sink_bytes, __ATOMIC_RELAXED) < expected &&
+           now_sec() - start < WAIT_TIMEOUT_SEC) {
+        usleep(1000);
+    }
+
+    result->seconds = now_sec() - start;
+    result->router_cpu = process_cpu_seconds(pid) - cpu_start;
+    result->bytes = __atomic_load_n(&g_sink_bytes, __ATOMIC_RELAXED);
+    result->complete = result->bytes == expected;
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return 0;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -r <path>    frame_router binary (default: bin/frame_router)\n");
+    printf("  -c <n>       Concurrent detector connections (default: 4)\n");
+    printf("  -n <n>       Frames per connection (default: 200000)\n");
+    printf("  -C <n>       Channels per realtime frame (default: 8)\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t config = {"bin/frame_router", 4, 200000, 8};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:c:n:C:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                config.router_path = optarg;
+                break;
+            case 'c':
+                config.connections = atoi(optarg);
+                break;
+            case 'n':
+                config.frames_per_conn = atol(optarg);
+                break;
+            case 'C':
+                config.channels = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (config.connections < 1 || config.connections > MAX_BENCH_CONNECTIONS ||
+        config.channels < 1 || 7 + config.channels * 19 > MAX_CONTENT_SIZE) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_ERROR, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int base_port = 47000 + (getpid() % 500) * 4;
+    int listen_fd = create_tcp_server(base_port);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Failed to listen on port %d\n", base_port);
+        return 1;
+    }
+
+    g_sink_running = 1;
+    pthread_t accept_thread;
+    pthread_create(&accept_thread, NULL, sink_accept_thread, (void *)(intptr_t)listen_fd);
+
+    uint8_t sample[MAX_FRAME_SIZE];
+    int frame_len = build_realtime_frame(0, config.channels, sample, sizeof(sample));
+    printf("Router benchmark: %d connections x %ld frames, %d bytes/frame (%d channels)\n\n",
+           config.connections, config.frames_per_conn, frame_len, config.channels);
+    printf("%-8s %10s %12s %10s %14s %s\n",
+           "mode", "MB/s", "frames/s", "cpu(s)", "cpu ns/frame", "");
+
+    const char *modes[] = {"copy", "splice"};
+    int failed = 0;
+    for (int i = 0; i < 2; i++) {
+        bench_result_t result;
+        if (run_bench(&config, modes[i], base_port, base_port + 1 + i, &result) < 0) {
+            failed = 1;
+            continue;
+        }
+
+        double frames = (double)result.bytes / frame_len;
+        printf("%-8s %10.1f %12.0f %10.2f %14.0f %s\n", modes[i],
+               result.bytes / result.seconds / 1e6, frames / result.seconds,
+               result.router_cpu, frames > 0 ? result.router_cpu * 1e9 / frames : 0,
+               result.complete ? "" : "(incomplete)");
+        fflush(stdout);
+        if (!result.complete) {
+            failed = 1;
+        }
+    }
+
+    g_sink_running = 0;
+    shutdown(listen_fd, SHUT_RDWR);
+    close(listen_fd);
+    logger_close();
+    return failed;
+}
@@ -0,0 +1,175 @@
+/**
+ * @file rule_bench.c
+ * @brief 阈值规则引擎的评估开销基准测试
+ *
+ * 构造大量设备的最新实时信息 (每设备8通道，分布在若干行政区划，
+ * 与周期评估线程一样按设备标识排序)，
+ * 生成一批阈值规则 (按区划的占有率持续规则、相邻通道低速规则、组合条件规则)，
+ * 分别用1/2/4个线程重复评估，输出每次评估的耗时和事件数。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "server/rule_engine.h"
+#include "common/realtime_codec.h"
+#include "utils/logger.h"
+
+#define CHANNELS_PER_DEVICE 8       // 每设备通道数
+#define DISTRICTS 100               // 行政区划数
+#define TICK_MS 1000                // 评估间隔(毫秒)
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 构造一个设备的实时信息内容，占有率和速度随机
+ */
+static size_t build_content(uint8_t *content, uint32_t seconds) {
+    size_t len = 0;
+    memcpy(&content[len], &seconds, 4);
+    len += 6;
+    content[4] = content[5] = 0;
+    content[len++] = CHANNELS_PER_DEVICE;
+    for (int ch = 0; ch < CHANNELS_PER_DEVICE; ch++) {
+        uint8_t *p = &content[len];
+        uint16_t occupancy = (uint16_t)(rand() % 1000);
+        memset(p, 0, REALTIME_RECORD_SIZE);
+        p[0] = (uint8_t)(ch + 1);
+        p[1] = (uint8_t)(rand() % 4);
+        p[4] = (uint8_t)(occupancy & 0xFF);
+        p[5] = (uint8_t)(occupancy >> 8);
+        p[6] = (uint8_t)(rand() % 90);
+        len += REALTIME_RECORD_SIZE;
+    }
+    return len;
+}
+
+/**
+ * @brief 生成规则文本
+ */
+static char *build_rules(int count) {
+    char *text = malloc((size_t)count * 128 + 1);
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        uint32_t district = 110000 + (uint32_t)(i % DISTRICTS);
+        switch (i % 3) {
+            case 0:
+                len += sprintf(text + len, "occ_%d: occupancy > %d and admin_code == %u for 60s\n",
+                               i, 700 + i % 250, district);
+                break;
+            case 1:
+                len += sprintf(text + len, "slow_%d: speed < %d and admin_code == %u adjacent 3\n",
+                               i, 5 + i % 10, district);
+                break;
+            default:
+                len += sprintf(text + len, "mix_%d: (occupancy > %d or count_a >= 3) and speed < %d "
+                               "and admin_code == %u for 30s\n", i, 900 + i % 90, 20 + i % 20, district);
+                break;
+        }
+    }
+    text[len] = '\0';
+    return text;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -r <n>       Rules (default: 10000)\n");
+    printf("  -c <n>       Channels (default: 100000)\n");
+    printf("  -t <n>       Ticks per thread count (default: 5)\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int rule_count = 10000;
+    int channels = 100000;
+    int ticks = 5;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:c:t:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                rule_count = atoi(optarg);
+                break;
+            case 'c':
+                channels = atoi(optarg);
+                break;
+            case 't':
+                ticks = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (rule_count < 1 || channels < CHANNELS_PER_DEVICE || ticks < 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+    srand(1);
+
+    int devices = channels / CHANNELS_PER_DEVICE;
+    realtime_columns_t rows;
+    if (realtime_columns_init(&rows, (size_t)channels) < 0) {
+        return 1;
+    }
+    int64_t now_ms = 1700000000000LL;
+    uint8_t content[MAX_CONTENT_SIZE];
+    for (int d = 0; d < devices; d++) {
+        int per_district = (devices + DISTRICTS - 1) / DISTRICTS;
+        device_id_t device = create_device_id(110000 + (uint32_t)(d / per_district), DEVICE_TYPE_COIL,
+                                              (uint16_t)(d % per_district + 1));
+        size_t len = build_content(content, (uint32_t)(now_ms / 1000));
+        realtime_decode_content(&rows, &device, content, len, now_ms * 1000000LL);
+    }
+
+    char *text = build_rules(rule_count);
+    printf("Rule engine benchmark: %d rules x %zu channels (%d devices)\n\n",
+           rule_count, rows.count, devices);
+
+    int thread_counts[] = {1, 2, 4};
+    for (size_t k = 0; k < sizeof(thread_counts) / sizeof(thread_counts[0]); k++) {
+        rule_engine_t engine;
+        if (rule_engine_init(&engine, NULL, thread_counts[k]) < 0 ||
+            rule_engine_load_string(&engine, text) != rule_count) {
+            fprintf(stderr, "Failed to load rules\n");
+            return 1;
+        }
+        engine.stale_ms = 0;
+
+        int64_t events = 0;
+        int64_t begin = now_ns();
+        for (int t = 0; t < ticks; t++) {
+            events += rule_engine_evaluate(&engine, &rows, now_ms + (int64_t)t * TICK_MS);
+        }
+        int64_t elapsed = now_ns() - begin;
+
+        printf("  threads %d: %8.1f ms per tick, %6.2f ns per rule-channel, %lld events\n",
+               thread_counts[k], (double)elapsed / ticks / 1e6,
+               (double)elapsed / ticks / ((double)rule_count * rows.count), (long long)events);
+        rule_engine_destroy(&engine);
+    }
+
+    free(text);
+    realtime_columns_free(&rows);
+    return 0;
+}
@@ -0,0 +1,244 @@
+/**
+ * @file startup_bench.c
+ * @brief 历史存储启动时间基准测试
+ *
+ * 在临时目录中生成大量小段，分别测量两种启动方式：
+ *   全量打开 删除目录文件后启动，逐个读取段头并映射温层段；
+ *   延迟加载 按目录文件建立段列表，段在首次访问或后台预热时加载。
+ * 每次启动测量两个时间：history_init返回后开始监听并接受第一个本地连接的时间
+ * (可以接入设备的时间)，以及history_wait_warmup返回的时间 (全部段已加载)。
+ * 段文件通常仍在页缓存中，冷启动 (重启机器后) 的差距会更大。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include "server/history_store.h"
+#include "common/realtime_codec.h"
+#include "utils/logger.h"
+#include "utils/socket_utils.h"
+
+#define CHANNELS_PER_DEVICE 8       // 每设备通道数
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 构造一帧实时信息内容
+ */
+static size_t build_content(uint8_t *content, uint32_t seconds) {
+    size_t len = 0;
+    memcpy(&content[len], &seconds, 4);
+    len += 6;
+    content[4] = content[5] = 0;
+    content[len++] = CHANNELS_PER_DEVICE;
+    for (int ch = 0; ch < CHANNELS_PER_DEVICE; ch++) {
+        uint8_t *p = &content[len];
+        memset(p, 0, REALTIME_RECORD_SIZE);
+        p[0] = (uint8_t)(ch + 1);
+        p[4] = (uint8_t)(rand() % 256);
+        len += REALTIME_RECORD_SIZE;
+    }
+    return len;
+}
+
+/**
+ * @brief 生成按行号连续的小段 (与迁移写出的段相同)
+ * @return 写入的字节数，-1失败
+ */
+static int64_t generate(const char *dir, history_tier_t tier, int segments, int rows_per_segment) {
+    realtime_columns_t cols;
+    if (realtime_columns_init(&cols, (size_t)rows_per_segment) < 0) {
+        return -1;
+    }
+
+    uint8_t content[MAX_CONTENT_SIZE];
+    device_id_t sender = create_device_id(110000, DEVICE_TYPE_COIL, 1);
+    uint32_t seconds = 1700000000;
+    uint64_t next_row = 0;
+    int64_t bytes = 0;
+    for (int s = 0; s < segments; s++) {
+        cols.count = 0;
+        while (cols.count + CHANNELS_PER_DEVICE <= (size_t)rows_per_segment) {
+            size_t len = build_content(content, seconds++);
+            realtime_decode_content(&cols, &sender, content, len, (int64_t)seconds * 1000000000LL);
+        }
+        int64_t size = history_write_segment(dir, tier, &cols, next_row);
+        if (size < 0) {
+            realtime_columns_free(&cols);
+            return -1;
+        }
+        next_row += cols.count;
+        bytes += size;
+    }
+    realtime_columns_free(&cols);
+    return bytes;
+}
+
+/**
+ * @brief 启动一次存储，测量可接入时间和全部就绪时间
+ * @return 0成功，-1失败
+ */
+static int measure(const history_config_t *config, int port, double *accept_ms, double *ready_ms,
+                   size_t *from_catalog) {
+    history_store_t hist;
+    int64_t begin = now_ns();
+    if (history_init(&hist, config) < 0) {
+        return -1;
+    }
+    int server_fd = create_tcp_server(port);
+    int client_fd = server_fd >= 0 ? create_tcp_client("127.0.0.1", port) : -1;
+    int accepted = client_fd >= 0 ? accept(server_fd, NULL, NULL) : -1;
+    *accept_ms = (double)(now_ns() - begin) / 1e6;
+    history_wait_warmup(&hist);
+    *ready_ms = (double)(now_ns() - begin) / 1e6;
+    *from_catalog = hist.catalog_segments;
+
+    if (accepted >= 0) {
+        close(accepted);
+    }
+    if (client_fd >= 0) {
+        close(client_fd);
+    }
+    if (server_fd >= 0) {
+        close(server_fd);
+    }
+    history_destroy(&hist);
+    return accepted >= 0 ? 0 : -1;
+}
+
+/**
+ * @brief 删除生成的目录
+ */
+static void remove_dir(const char *dir) {
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    if (system(command) != 0) {
+        fprintf(stderr, "Failed to remove %s\n", dir);
+    }
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -s <n>       Segments (default: 5000)\n");
+    printf("  -r <n>       Rows per segment (default: 1024)\n");
+    printf("  -n <n>       Startups per mode (default: 3)\n");
+    printf("  -p <port>    Listen port (default: 18123)\n");
+    printf("  -t <n>       Warm-up threads for lazy startup (default: 2)\n");
+    printf("  -c           Write cold (compressed) segments instead of warm\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    int segments = 5000;
+    int rows_per_segment = 1024;
+    int runs = 3;
+    int port = 18123;
+    int warmup_threads = HISTORY_DEFAULT_WARMUP_THREADS;
+    history_tier_t tier = HISTORY_TIER_WARM;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:n:p:t:ch")) != -1) {
+        switch (opt) {
+            case 's':
+                segments = atoi(optarg);
+                break;
+            case 'r':
+                rows_per_segment = atoi(optarg);
+                break;
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 't':
+                warmup_threads = atoi(optarg);
+                break;
+            case 'c':
+                tier = HISTORY_TIER_COLD;
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (segments < 1 || rows_per_segment < CHANNELS_PER_DEVICE || runs < 1 || port < 1 || port > 65535 ||
+        warmup_threads < 1 || warmup_threads > HISTORY_MAX_WARMUP_THREADS) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+    srand(1);
+
+    char dir[64];
+    char catalog[96];
+    snprintf(dir, sizeof(dir), "/tmp/startup_bench.%d", (int)getpid());
+    snprintf(catalog, sizeof(catalog), "%s/catalog", dir);
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = dir;
+    config.cold_max_bytes = UINT64_MAX;
+    config.warm_max_bytes = UINT64_MAX;
+    config.query_threads = -1;
+    config.warmup_threads = -1;
+
+    // 先打开一次以创建目录
+    history_store_t hist;
+    if (history_init(&hist, &config) < 0) {
+        return 1;
+    }
+    history_destroy(&hist);
+    int64_t bytes = generate(dir, tier, segments, rows_per_segment);
+    if (bytes < 0) {
+        fprintf(stderr, "Failed to generate history segments\n");
+        remove_dir(dir);
+        return 1;
+    }
+
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("History startup benchmark: %d %s segments, %.1f MB, %d warm-up threads, %ld online CPUs\n\n",
+           segments, history_tier_name(tier), (double)bytes / (1 << 20), warmup_threads, online);
+
+    int failed = 0;
+    for (int mode = 0; mode < 2 && !failed; mode++) {
+        config.warmup_threads = mode ? warmup_threads : -1;
+        for (int run = 0; run < runs; run++) {
+            // 全量打开：每次启动前删除目录文件 (启动后会重写)
+            if (mode == 0) {
+                unlink(catalog);
+            }
+            double accept_ms = 0;
+            double ready_ms = 0;
+            size_t from_catalog = 0;
+            if (measure(&config, port, &accept_ms, &ready_ms, &from_catalog) < 0) {
+                fprintf(stderr, "Failed to start history store or accept on port %d\n", port);
+                failed = 1;
+                break;
+            }
+            printf("  %-8s run %d:  first accept %9.2f ms  fully ready %9.2f ms  (%zu from catalog)\n",
+                   mode ? "lazy" : "eager", run + 1, accept_ms, ready_ms, from_catalog);
+        }
+    }
+
+    remove_dir(dir);
+    return failed;
+}
@@ -0,0 +1,282 @@
+/**
+ * @file submit_bench.c
+ * @brief 检测器多线程提交吞吐量基准测试
+ *
+ * 多个生产者线程同时向同一个检测器连接提交实时数据消息，对比两种方式：
+ * mutex - 生产者加锁后直接调用send_message，每条消息编码一次、写入一次；
+ * queue - 生产者无锁提交到发送队列，由发送线程统一编码并批量写入。
+ * 接收端只计数，收齐全部字节后停止计时。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "client/vehicle_detector.h"
+#include "utils/socket_utils.h"
+#include "utils/logger.h"
+
+#define MAX_PRODUCERS 64            // 最大生产者线程数
+#define WAIT_TIMEOUT_SEC 120        // 等待数据全部到达的超时时间
+
+/**
+ * @brief 基准测试参数
+ */
+typedef struct {
+    int producers;              // 生产者线程数
+    long messages;              // 每个生产者提交的消息数
+    int channels;               // 每条消息的通道数
+} bench_config_t;
+
+/**
+ * @brief 生产者线程参数
+ */
+typedef struct {
+    vehicle_detector_t *detector;
+    const bench_config_t *config;
+    const uint8_t *content;     // 消息内容 (所有生产者共用)
+    uint16_t content_len;
+    int use_queue;              // 1: detector_submit, 0: 加锁后send_message
+    long retries;               // 队列满时的重试次数
+} producer_arg_t;
+
+static pthread_mutex_t g_send_mutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile uint64_t g_sink_bytes = 0;
+
+/**
+ * @brief 获取单调时钟秒数
+ */
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * @brief 信号机端：接受一个连接并只计数
+ */
+static void *sink_thread(void *arg) {
+    int listen_fd = (int)(intptr_t)arg;
+    static uint8_t buffer[65536];
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            __atomic_fetch_add(&g_sink_bytes, (uint64_t)n, __ATOMIC_RELAXED);
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 生产者线程
+ */
+static void *producer_thread(void *arg) {
+    producer_arg_t *producer = (producer_arg_t *)arg;
+
+    for (long i = 0; i < producer->config->messages; i++) {
+        if (producer->use_queue) {
+            // 队列满时让出CPU后重试，模拟调用方的背压处理
+            while (detector_submit(producer->detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME,
+                                   producer->content, producer->content_len) < 0) {
+                producer->retries++;
+                sched_yield();
+            }
+        } else {
+            pthread_mutex_lock(&g_send_mutex);
+            send_message(producer->detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME,
+                         producer->content, producer->content_len);
+            pthread_mutex_unlock(&g_send_mutex);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 构造实时数据消息内容 (固定内容，保证每帧长度相同)
+ */
+static uint16_t build_realtime_content(int channels, uint8_t *content) {
+    uint16_t len = 0;
+    uint32_t timestamp = 1700000000;
+    uint16_t milliseconds = 500;
+
+    memcpy(&content[len], &timestamp, 4);
+    len += 4;
+    memcpy(&content[len], &milliseconds, 2);
+    len += 2;
+    content[len++] = (uint8_t)channels;
+    for (int ch = 0; ch < channels; ch++) {
+        uint8_t *p = &content[len];
+        memset(p, 0, 19);
+        p[0] = (uint8_t)(ch + 1);
+        p[1] = 1;
+        p[2] = 2;
+        p[3] = 5;
+        p[4] = 0x2C;
+        p[5] = 0x01;
+        p[6] = 45;
+        len += 19;
+    }
+    return len;
+}
+
+/**
+ * @brief 运行一轮基准测试
+ */
+static int run_bench(const bench_config_t *config, int port, int use_queue,
+                     const uint8_t *content, uint16_t content_len, int frame_len) {
+    vehicle_detector_t detector;
+    if (vehicle_detector_init(&detector, 110100, DEVICE_TYPE_RADAR, 1000, "127.0.0.1", port) < 0 ||
+        detector_connect(&detector) < 0) {
+        fprintf(stderr, "Failed to connect detector\n");
+        return -1;
+    }
+    if (use_queue && vehicle_detector_start_sender(&detector) < 0) {
+        detector_disconnect(&detector);
+        return -1;
+    }
+
+    __atomic_store_n(&g_sink_bytes, 0, __ATOMIC_RELAXED);
+    producer_arg_t producers[MAX_PRODUCERS];
+    pthread_t threads[MAX_PRODUCERS];
+    double start = now_sec();
+
+    for (int i = 0; i < config->producers; i++) {
+        producers[i].detector = &detector;
+        producers[i].config = config;
+        producers[i].content = content;
+        producers[i].content_len = content_len;
+        producers[i].use_queue = use_queue;
+        producers[i].retries = 0;
+        pthread_create(&threads[i], NULL, producer_thread, &producers[i]);
+    }
+    for (int i = 0; i < config->producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double submit_seconds = now_sec() - start;
+
+    uint64_t total = (uint64_t)config->producers * config->messages;
+    uint64_t expected = total * frame_len;
+    while (__atomic_load_n(&g_sink_bytes, __ATOMIC_RELAXED) < expected &&
+           now_sec() - start < WAIT_TIMEOUT_SEC) {
+        usleep(200);
+    }
+    double seconds = now_sec() - start;
+    uint64_t received = __atomic_load_n(&g_sink_bytes, __ATOMIC_RELAXED);
+
+    long retries = 0;
+    for (int i = 0; i < config->producers; i++) {
+        retries += producers[i].retries;
+    }
+
+    uint64_t writes = total;
+    if (use_queue) {
+        vehicle_detector_stop_sender(&detector);
+        writes = detector.tx_batches;
+    }
+    detector_disconnect(&detector);
+
+    printf("%-8s %12.0f %12.0f %10llu %12.1f %10ld %s\n", use_queue ? "queue" : "mutex",
+           received / frame_len / seconds, total / submit_seconds, (unsigned long long)writes,
+           writes ? (double)total / writes : 0, retries,
+           received == expected ? "" : "(incomplete)");
+    fflush(stdout);
+    return received == expected ? 0 : -1;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -p <n>       Producer threads (default: 8)\n");
+    printf("  -n <n>       Messages per producer (default: 100000)\n");
+    printf("  -C <n>       Channels per realtime message (default: 8)\n");
+    printf("  -h           Show this help\n");
+}
+
+int main(int argc, char *argv[]) {
+    bench_config_t config = {8, 100000, 8};
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:C:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                config.producers = atoi(optarg);
+                break;
+            case 'n':
+                config.messages = atol(optarg);
+                break;
+            case 'C':
+                config.channels = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (config.producers < 1 || config.producers > MAX_PRODUCERS || config.messages < 1 ||
+        config.channels < 1 || 7 + config.channels * 19 > MAX_CONTENT_SIZE) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(LOG_LEVEL_ERROR, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int port = 46000 + (getpid() % 1000);
+    int listen_fd = create_tcp_server(port);
+    if (listen_fd < 0) {
+        fprintf(stderr, "Failed to listen on port %d\n", port);
+        return 1;
+    }
+    pthread_t sink;
+    pthread_create(&sink, NULL, sink_thread, (void *)(intptr_t)listen_fd);
+    pthread_detach(sink);
+
+    uint8_t content[MAX_CONTENT_SIZE];
+    uint16_t content_len = build_realtime_content(config.channels, content);
+
+    // 按检测器的编码方式计算单帧长度，用于判断数据是否收齐
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(110100, DEVICE_TYPE_RADAR, 1000),
+                                   create_device_id(110100, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, content_len);
+    uint8_t sample[MAX_FRAME_SIZE];
+    int frame_len = encode_frame(&frame, sample, sizeof(sample));
+    free_frame(&frame);
+    if (frame_len <= 0) {
+        fprintf(stderr, "Failed to encode sample frame\n");
+        return 1;
+    }
+
+    printf("Submit benchmark: %d producers x %ld messages, %d bytes/frame (%d channels)\n\n",
+           config.producers, config.messages, frame_len, config.channels);
+    printf("%-8s %12s %12s %10s %12s %10s\n",
+           "mode", "msgs/s", "submit/s", "writes", "msgs/write", "retries");
+
+    int failed = 0;
+    failed |= run_bench(&config, port, 0, content, content_len, frame_len) < 0;
+    failed |= run_bench(&config, port, 1, content, content_len, frame_len) < 0;
+
+    close(listen_fd);
+    return failed ? 1 : 0;
+}
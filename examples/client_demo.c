@@ -37,6 +37,7 @@
      printf("  -i <id>       Device ID (default: 100)\n");
      printf("  -l <level>    Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
      printf("  -f <file>     Log file (default: console only)\n");
+     printf("  -b <k>        Burst mode: send buffered data every k upload intervals (default: off)\n");
      printf("  -h            Show this help\n");
      printf("\nDevice Types:\n");
      printf("  1  - Coil detector\n");
@@ -58,10 +59,11 @@
      uint16_t device_id = 100;
      log_level_t log_level = LOG_LEVEL_INFO;
      char *log_file = NULL;
+     int burst_intervals = 0;
      
      // 解析命令行参数
      int opt;
-     while ((opt = getopt(argc, argv, "s:p:a:t:i:l:f:h")) != -1) {
+     while ((opt = getopt(argc, argv, "s:p:a:t:i:l:f:b:h")) != -1) {
          switch (opt) {
              case 's':
                  strncpy(server_ip, optarg, sizeof(server_ip) - 1);
@@ -105,6 +107,13 @@
              case 'f':
                  log_file = optarg;
                  break;
+             case 'b':
+                 burst_intervals = atoi(optarg);
+                 if (burst_intervals < 0) {
+                     fprintf(stderr, "Invalid burst intervals: %s\n", optarg);
+                     return 1;
+                 }
+                 break;
              case 'h':
                  show_usage(argv[0]);
                  return 0;
@@ -135,6 +144,10 @@
          return 1;
      }
      
+     if (burst_intervals > 0) {
+         vehicle_detector_set_burst(&detector, burst_intervals, 0);
+     }
+     
      printf("Vehicle Detector Demo\n");
      printf("=====================\n");
      printf("Server: %s:%d\n", server_ip, server_port);
@@ -142,6 +155,9 @@
      printf("Device Type: %d\n", device_type);
      printf("Device ID: %d\n", device_id);
      printf("Log Level: %d\n", log_level);
+     if (burst_intervals > 0) {
+         printf("Burst Mode: every %d upload intervals\n", burst_intervals);
+     }
      if (log_file) {
          printf("Log File: %s\n", log_file);
      }
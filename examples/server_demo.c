@@ -5,12 +5,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <unistd.h>
 #include "server/signal_controller.h"
+#include "server/rule_engine.h"
+#include "server/history_store.h"
+#include "server/history_federation.h"
+#include "server/history_replication.h"
+#include "utils/async_io.h"
 #include "utils/logger.h"
+#include "utils/metrics.h"
 
 static signal_controller_t *g_controller = NULL;
+static rule_engine_t *g_rule_engine = NULL;
 
 /**
  * @brief 信号处理函数 - 优雅关闭程序
@@ -23,6 +31,33 @@ void signal_handler(int sig) {
     exit(0);
 }
 
+/**
+ * @brief SIGHUP处理函数 - 重新加载规则文件
+ */
+void reload_handler(int sig) {
+    (void)sig;
+    if (g_rule_engine) {
+        rule_engine_request_reload(g_rule_engine);
+    }
+}
+
+/**
+ * @brief 规则事件回调 - 输出告警日志
+ */
+static void log_rule_event(void *ctx, const rule_event_t *event) {
+    (void)ctx;
+    if (event->type == RULE_EVENT_FIRING) {
+        LOG_WARN("Rule %s firing on %06X:%04X:%04X channel %d",
+                 event->rule, event->device.admin_code, event->device.device_type,
+                 event->device.device_id, event->channel_id);
+    } else {
+        LOG_INFO("Rule %s cleared on %06X:%04X:%04X channel %d after %lld ms",
+                 event->rule, event->device.admin_code, event->device.device_type,
+                 event->device.device_id, event->channel_id,
+                 (long long)(event->now_ms - event->since_ms));
+    }
+}
+
 /**
  * @brief 显示使用帮助
  */
@@ -34,6 +69,14 @@ void show_usage(const char *program_name) {
     printf("  -i <id>       Device ID (default: 1)\n");
     printf("  -l <level>    Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
     printf("  -f <file>     Log file (default: console only)\n");
+    printf("  -T            Enable kernel receive timestamps and latency histograms\n");
+    printf("  -m <file>     Write runtime metrics to file every %d seconds\n", METRICS_DUMP_INTERVAL);
+    printf("  -c <file>     Capture received frames to file\n");
+    printf("  -r <file>     Evaluate threshold rules from file every second (SIGHUP reloads)\n");
+    printf("  -H <dir>      Keep realtime history in memory, then in segment files under dir\n");
+    printf("  -Q <port>     Serve bucketed history aggregates to other nodes on port (with -H)\n");
+    printf("  -R <host:port> Replicate history segments and recent rows to a replica (with -H)\n");
+    printf("  -B <KB/s>     Replication bandwidth limit (default: unlimited)\n");
     printf("  -h            Show this help\n");
     printf("\nExample:\n");
     printf("  %s -p 40000 -a 110100 -i 1 -l 1\n", program_name);
@@ -45,10 +88,18 @@ int main(int argc, char *argv[]) {
     uint16_t device_id = 1;
     log_level_t log_level = LOG_LEVEL_INFO;
     char *log_file = NULL;
+    int rx_timestamps = 0;
+    char *metrics_file = NULL;
+    char *capture_file = NULL;
+    char *rules_file = NULL;
+    char *history_dir = NULL;
+    int federation_port = 0;
+    char *replica_addr = NULL;
+    uint64_t replica_rate = 0;
     
     // 解析命令行参数
     int opt;
-    while ((opt = getopt(argc, argv, "p:a:i:l:f:h")) != -1) {
+    while ((opt = getopt(argc, argv, "p:a:i:l:f:Tm:c:r:H:Q:R:B:h")) != -1) {
         switch (opt) {
             case 'p':
                 port = atoi(optarg);
@@ -81,6 +132,38 @@ int main(int argc, char *argv[]) {
             case 'f':
                 log_file = optarg;
                 break;
+            case 'T':
+                rx_timestamps = 1;
+                break;
+            case 'm':
+                metrics_file = optarg;
+                break;
+            case 'c':
+                capture_file = optarg;
+                break;
+            case 'r':
+                rules_file = optarg;
+                break;
+            case 'H':
+                history_dir = optarg;
+                break;
+            case 'Q':
+                federation_port = atoi(optarg);
+                if (federation_port <= 0 || federation_port > 65535) {
+                    fprintf(stderr, "Invalid port: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'R':
+                replica_addr = optarg;
+                if (!strchr(replica_addr, ':')) {
+                    fprintf(stderr, "Invalid replica address: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'B':
+                replica_rate = strtoull(optarg, NULL, 10) * 1024;
+                break;
             case 'h':
                 show_usage(argv[0]);
                 return 0;
@@ -110,6 +193,93 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    if (rx_timestamps) {
+        signal_controller_enable_rx_timestamps(&controller, 1);
+    }
+    metrics_init();
+    signal_controller_set_metrics_file(&controller, metrics_file);
+    
+    // 重连补传的统计数据只处理一次
+    stats_dedup_t stats_dedup;
+    stats_dedup_init(&stats_dedup);
+    signal_controller_set_stats_dedup(&controller, &stats_dedup);
+    
+    // 发现仍应答心跳却停止上传数据的设备 (过期时输出告警日志并更新指标)
+    freshness_monitor_t freshness;
+    if (freshness_init(&freshness, 0) == 0) {
+        signal_controller_set_freshness(&controller, &freshness);
+    }
+    
+    // 抓包写入、段文件读写和fsync由异步I/O线程执行，不阻塞接收路径
+    async_io_t disk_io;
+    int use_disk_io = (capture_file || history_dir) && async_io_init(&disk_io, NULL) == 0;
+    if (use_disk_io) {
+        signal_controller_set_async_io(&controller, &disk_io);
+    }
+    if (capture_file && signal_controller_set_capture_file(&controller, capture_file) < 0) {
+        LOG_ERROR("Failed to open capture file %s", capture_file);
+        logger_close();
+        return 1;
+    }
+    
+    // 规则引擎从设备状态表的一致快照评估各通道最新记录
+    device_state_t device_state;
+    rule_engine_t rule_engine;
+    if (rules_file) {
+        if (device_state_init(&device_state, 0) < 0 ||
+            rule_engine_init(&rule_engine, &device_state, 2) < 0 ||
+            rule_engine_load_file(&rule_engine, rules_file) < 0) {
+            LOG_ERROR("Failed to load rule file %s", rules_file);
+            logger_close();
+            return 1;
+        }
+        signal_controller_set_device_state(&controller, &device_state);
+        rule_engine_set_callback(&rule_engine, log_rule_event, NULL);
+        rule_engine_start(&rule_engine, 0);
+        g_rule_engine = &rule_engine;
+        signal(SIGHUP, reload_handler);
+    }
+    
+    // 实时信息先写入内存热层，后台线程迁移到温层和冷层段文件
+    history_store_t history;
+    if (history_dir) {
+        history_config_t config = {history_dir, 0, 0, 0, 0, 0, 0, use_disk_io ? &disk_io : NULL, 0};
+        if (history_init(&history, &config) < 0 || history_start(&history) < 0) {
+            LOG_ERROR("Failed to open history directory %s", history_dir);
+            logger_close();
+            return 1;
+        }
+        signal_controller_set_realtime_store(&controller, &history.hot);
+    }
+    
+    // 其他节点发来的区域查询在本节点完成分桶聚合，只发回聚合结果
+    query_cache_t query_cache;
+    federation_server_t federation;
+    int use_federation = history_dir && federation_port && query_cache_init(&query_cache, &history, 0) == 0;
+    if (use_federation && federation_server_start(&federation, &query_cache, federation_port, 0) < 0) {
+        LOG_ERROR("Failed to start federated query server on port %d", federation_port);
+        query_cache_destroy(&query_cache);
+        use_federation = 0;
+    }
+    
+    // 段文件和热层中的最新行异步复制到副本进程，限速后不挤占接收路径的磁盘和网络
+    replication_t replication;
+    int use_replication = 0;
+    if (history_dir && replica_addr) {
+        char host[64];
+        const char *colon = strrchr(replica_addr, ':');
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - replica_addr), replica_addr);
+        replication_config_t config = {host, atoi(colon + 1), replica_rate, 0};
+        use_replication = replication_init(&replication, &history, &config) == 0;
+        if (use_replication && replication_start(&replication) < 0) {
+            replication_destroy(&replication);
+            use_replication = 0;
+        }
+        if (!use_replication) {
+            LOG_ERROR("Failed to start history replication to %s", replica_addr);
+        }
+    }
+    
     printf("Traffic Signal Controller Demo\n");
     printf("==============================\n");
     printf("Admin Code: %06X\n", admin_code);
@@ -128,6 +298,25 @@ int main(int argc, char *argv[]) {
     
     // 清理资源
     signal_controller_stop(&controller);
+    stats_dedup_destroy(&stats_dedup);
+    freshness_destroy(&freshness);
+    if (rules_file) {
+        rule_engine_destroy(&rule_engine);
+        device_state_destroy(&device_state);
+    }
+    if (use_federation) {
+        federation_server_stop(&federation);
+        query_cache_destroy(&query_cache);
+    }
+    if (use_replication) {
+        replication_destroy(&replication);
+    }
+    if (history_dir) {
+        history_destroy(&history);
+    }
+    if (use_disk_io) {
+        async_io_destroy(&disk_io);
+    }
     logger_close();
     
     return result;
@@ -0,0 +1,824 @@
+/**
+ * @file traffic_module.c
+ * @brief 交通流数据的CPython扩展模块
+ *
+ * 提供：
+ * - Store：进程内列式存储，快照中的列通过缓冲区协议直接导出 (numpy.asarray零拷贝)
+ * - Controller：在后台线程运行信号控制机，收到的实时信息写入Store
+ * - decode_capture：批量解码抓包文件为列
+ * 长时间的扫描和解码都在释放GIL后进行。
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "common/realtime_codec.h"
+#include "server/realtime_store.h"
+#include "server/signal_controller.h"
+#include "utils/logger.h"
+#include "utils/metrics.h"
+
+// ============================================================================
+// Column：单列数据，实现缓冲区协议
+// ============================================================================
+
+/**
+ * @brief 列对象，数据来自存储块 (持有块引用) 或独立分配的数组 (持有所有权)
+ */
+typedef struct {
+    PyObject_HEAD
+    void *data;                 // 列数据
+    Py_ssize_t length;          // 行数
+    int column;                 // 列序号
+    realtime_chunk_t *chunk;    // 数据所在的存储块，NULL表示data由本对象释放
+    Py_ssize_t shape[1];
+    Py_ssize_t strides[1];
+} ColumnObject;
+
+static PyTypeObject ColumnType;
+static uint64_t empty_column_data;
+
+/**
+ * @brief 创建列对象
+ * @param data 列数据
+ * @param length 行数
+ * @param column 列序号
+ * @param chunk 存储块 (增加引用)，NULL表示接管data的所有权
+ */
+static PyObject *column_new(void *data, Py_ssize_t length, int column, realtime_chunk_t *chunk) {
+    ColumnObject *self = PyObject_New(ColumnObject, &ColumnType);
+    if (!self) {
+        if (!chunk) {
+            free(data);
+        }
+        return NULL;
+    }
+
+    self->data = data;
+    self->length = length;
+    self->column = column;
+    self->chunk = chunk;
+    self->shape[0] = length;
+    self->strides[0] = (Py_ssize_t)realtime_column_info[column].item_size;
+    if (chunk) {
+        realtime_chunk_retain(chunk);
+    }
+    return (PyObject *)self;
+}
+
+static void column_dealloc(ColumnObject *self) {
+    if (self->chunk) {
+        realtime_chunk_release(self->chunk);
+    } else if (self->data != &empty_column_data) {
+        free(self->data);
+    }
+    PyObject_Free(self);
+}
+
+static int column_getbuffer(ColumnObject *self, Py_buffer *view, int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "traffic columns are read-only");
+        view->obj = NULL;
+        return -1;
+    }
+
+    const realtime_column_info_t *info = &realtime_column_info[self->column];
+    view->buf = self->data;
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->len = self->length * (Py_ssize_t)info->item_size;
+    view->readonly = 1;
+    view->itemsize = (Py_ssize_t)info->item_size;
+    view->format = (flags & PyBUF_FORMAT) ? (char *)info->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    return 0;
+}
+
+static Py_ssize_t column_length(ColumnObject *self) {
+    return self->length;
+}
+
+static PyObject *column_get_name(ColumnObject *self, void *closure) {
+    (void)closure;
+    return PyUnicode_FromString(realtime_column_info[self->column].name);
+}
+
+static PyObject *column_repr(ColumnObject *self) {
+    return PyUnicode_FromFormat("<traffic.Column %s[%zd] '%s'>",
+                                realtime_column_info[self->column].name, self->length,
+                                realtime_column_info[self->column].format);
+}
+
+static PyBufferProcs column_as_buffer = {
+    .bf_getbuffer = (getbufferproc)column_getbuffer,
+    .bf_releasebuffer = NULL,
+};
+
+static PySequenceMethods column_as_sequence = {
+    .sq_length = (lenfunc)column_length,
+};
+
+static PyGetSetDef column_getset[] = {
+    {"name", (getter)column_get_name, NULL, "column name", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject ColumnType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "traffic.Column",
+    .tp_doc = "Read-only column exported through the buffer protocol",
+    .tp_basicsize = sizeof(ColumnObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)column_dealloc,
+    .tp_repr = (reprfunc)column_repr,
+    .tp_as_buffer = &column_as_buffer,
+    .tp_as_sequence = &column_as_sequence,
+    .tp_getset = column_getset,
+};
+
+/**
+ * @brief 把独立分配的列集合转换为 {列名: Column} 字典，接管各列数组
+ */
+static PyObject *columns_to_dict(realtime_columns_t *columns) {
+    PyObject *dict = PyDict_New();
+    if (!dict) {
+        realtime_columns_free(columns);
+        return NULL;
+    }
+
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        void **slot = (void **)((uint8_t *)columns + realtime_column_info[i].offset);
+        void *data = *slot ? *slot : &empty_column_data;
+        *slot = NULL;
+
+        PyObject *column = column_new(data, (Py_ssize_t)columns->count, i, NULL);
+        if (!column || PyDict_SetItemString(dict, realtime_column_info[i].name, column) < 0) {
+            Py_XDECREF(column);
+            Py_DECREF(dict);
+            realtime_columns_free(columns);
+            return NULL;
+        }
+        Py_DECREF(column);
+    }
+
+    realtime_columns_free(columns);
+    return dict;
+}
+
+/**
+ * @brief 把存储块的前rows行导出为 {列名: Column} 字典 (零拷贝)
+ */
+static PyObject *chunk_to_dict(realtime_chunk_t *chunk, size_t rows) {
+    PyObject *dict = PyDict_New();
+    if (!dict) {
+        return NULL;
+    }
+
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        PyObject *column = column_new(realtime_column_data(&chunk->columns, i),
+                                      (Py_ssize_t)rows, i, chunk);
+        if (!column || PyDict_SetItemString(dict, realtime_column_info[i].name, column) < 0) {
+            Py_XDECREF(column);
+            Py_DECREF(dict);
+            return NULL;
+        }
+        Py_DECREF(column);
+    }
+    return dict;
+}
+
+// ============================================================================
+// Snapshot：存储快照
+// ============================================================================
+
+typedef struct {
+    PyObject_HEAD
+    realtime_snapshot_t snapshot;
+} SnapshotObject;
+
+static PyTypeObject SnapshotType;
+
+static void snapshot_dealloc(SnapshotObject *self) {
+    realtime_snapshot_release(&self->snapshot);
+    PyObject_Free(self);
+}
+
+static Py_ssize_t snapshot_length(SnapshotObject *self) {
+    return (Py_ssize_t)self->snapshot.total_rows;
+}
+
+static PyObject *snapshot_chunks(SnapshotObject *self, PyObject *unused) {
+    (void)unused;
+    PyObject *list = PyList_New(0);
+    if (!list) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < self->snapshot.chunk_count; i++) {
+        if (self->snapshot.rows[i] == 0) {
+            continue;
+        }
+        PyObject *dict = chunk_to_dict(self->snapshot.chunks[i], self->snapshot.rows[i]);
+        if (!dict || PyList_Append(list, dict) < 0) {
+            Py_XDECREF(dict);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(dict);
+    }
+    return list;
+}
+
+/**
+ * @brief 解析查询参数
+ * @return 0成功，-1参数错误 (已设置Python异常)
+ */
+static int parse_query(PyObject *args, PyObject *kwds, realtime_query_t *query) {
+    static char *kwlist[] = {"start_ms", "end_ms", "device", "channel", NULL};
+    PyObject *start = Py_None, *end = Py_None, *device = Py_None, *channel = Py_None;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOOO", kwlist, &start, &end, &device, &channel)) {
+        return -1;
+    }
+
+    realtime_query_init(query);
+    if (start != Py_None && (query->start_ms = PyLong_AsLongLong(start)) == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (end != Py_None && (query->end_ms = PyLong_AsLongLong(end)) == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    if (device != Py_None) {
+        unsigned int admin_code, device_type, device_id;
+        if (!PyArg_ParseTuple(device, "III;device must be (admin_code, type, id)",
+                              &admin_code, &device_type, &device_id)) {
+            return -1;
+        }
+        query->match_device = 1;
+        query->device = create_device_id(admin_code, (uint16_t)device_type, (uint16_t)device_id);
+    }
+    if (channel != Py_None && (query->channel_id = (int)PyLong_AsLong(channel)) == -1 && PyErr_Occurred()) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 在快照上查询，扫描期间释放GIL
+ */
+static PyObject *query_snapshot(const realtime_snapshot_t *snapshot, const realtime_query_t *query) {
+    realtime_columns_t out;
+    if (realtime_columns_init(&out, 0) < 0) {
+        return PyErr_NoMemory();
+    }
+
+    int64_t rows;
+    Py_BEGIN_ALLOW_THREADS
+    rows = realtime_snapshot_query(snapshot, query, &out);
+    Py_END_ALLOW_THREADS
+
+    if (rows < 0) {
+        realtime_columns_free(&out);
+        return PyErr_NoMemory();
+    }
+    return columns_to_dict(&out);
+}
+
+static PyObject *snapshot_query(SnapshotObject *self, PyObject *args, PyObject *kwds) {
+    realtime_query_t query;
+    if (parse_query(args, kwds, &query) < 0) {
+        return NULL;
+    }
+    return query_snapshot(&self->snapshot, &query);
+}
+
+static PyMethodDef snapshot_methods[] = {
+    {"chunks", (PyCFunction)snapshot_chunks, METH_NOARGS,
+     "chunks() -> list of {name: Column}, zero-copy views of each store chunk"},
+    {"query", (PyCFunction)(void (*)(void))snapshot_query, METH_VARARGS | METH_KEYWORDS,
+     "query(start_ms=None, end_ms=None, device=None, channel=None) -> {name: Column}"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PySequenceMethods snapshot_as_sequence = {
+    .sq_length = (lenfunc)snapshot_length,
+};
+
+static PyTypeObject SnapshotType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "traffic.Snapshot",
+    .tp_doc = "Consistent view of a Store; chunks stay alive while referenced",
+    .tp_basicsize = sizeof(SnapshotObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_dealloc = (destructor)snapshot_dealloc,
+    .tp_methods = snapshot_methods,
+    .tp_as_sequence = &snapshot_as_sequence,
+};
+
+// ============================================================================
+// Store：列式存储
+// ============================================================================
+
+typedef struct {
+    PyObject_HEAD
+    realtime_store_t store;
+    int initialized;
+} StoreObject;
+
+static PyTypeObject StoreType;
+
+static int store_init(StoreObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"max_rows", NULL};
+    Py_ssize_t max_rows = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|n", kwlist, &max_rows)) {
+        return -1;
+    }
+    if (self->initialized) {
+        PyErr_SetString(PyExc_RuntimeError, "Store already initialized");
+        return -1;
+    }
+    if (max_rows < 0 || realtime_store_init(&self->store, (size_t)max_rows) < 0) {
+        PyErr_SetString(PyExc_ValueError, "invalid max_rows");
+        return -1;
+    }
+    self->initialized = 1;
+    return 0;
+}
+
+static void store_dealloc(StoreObject *self) {
+    if (self->initialized) {
+        realtime_store_destroy(&self->store);
+    }
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int store_check(StoreObject *self) {
+    if (!self->initialized) {
+        PyErr_SetString(PyExc_RuntimeError, "Store not initialized");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject *store_ingest(StoreObject *self, PyObject *args) {
+    Py_buffer buffer;
+    long long received_ns = 0;
+
+    if (store_check(self) < 0 || !PyArg_ParseTuple(args, "y*|L", &buffer, &received_ns)) {
+        return NULL;
+    }
+
+    // 按帧标识切分字节流，逐帧追加
+    long long rows = 0, bad = 0;
+    Py_BEGIN_ALLOW_THREADS
+    const uint8_t *data = buffer.buf;
+    size_t len = (size_t)buffer.len;
+    size_t pos = 0;
+    while (pos < len) {
+        const uint8_t *start = memchr(data + pos, FRAME_START, len - pos);
+        if (!start) {
+            break;
+        }
+        size_t start_pos = (size_t)(start - data);
+        const uint8_t *end = start_pos + 1 < len ? memchr(start + 1, FRAME_END, len - start_pos - 1) : NULL;
+        if (!end) {
+            break;
+        }
+        size_t frame_len = (size_t)(end - start) + 1;
+        if (frame_len == 2) {
+            pos = start_pos + 1;
+            continue;
+        }
+        int appended = realtime_store_append_frame(&self->store, start, frame_len, received_ns);
+        if (appended < 0) {
+            bad++;
+        } else {
+            rows += appended;
+        }
+        pos = start_pos + frame_len;
+    }
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&buffer);
+    return Py_BuildValue("(LL)", rows, bad);
+}
+
+static PyObject *store_load_capture(StoreObject *self, PyObject *args) {
+    const char *path;
+    if (store_check(self) < 0 || !PyArg_ParseTuple(args, "s", &path)) {
+        return NULL;
+    }
+
+    capture_reader_t reader;
+    if (capture_reader_open(&reader, path) < 0) {
+        return PyErr_Format(PyExc_OSError, "cannot open capture file %s", path);
+    }
+
+    long long rows = 0, bad = 0;
+    int truncated = 0;
+    Py_BEGIN_ALLOW_THREADS
+    int64_t timestamp_ns;
+    const uint8_t *frame;
+    size_t frame_len;
+    int ret;
+    while ((ret = capture_reader_next(&reader, &timestamp_ns, &frame, &frame_len)) > 0) {
+        int appended = realtime_store_append_frame(&self->store, frame, frame_len, timestamp_ns);
+        if (appended < 0) {
+            bad++;
+        } else {
+            rows += appended;
+        }
+    }
+    truncated = ret < 0;
+    capture_reader_close(&reader);
+    Py_END_ALLOW_THREADS
+
+    if (truncated) {
+        return PyErr_Format(PyExc_ValueError, "capture file %s is truncated", path);
+    }
+    return Py_BuildValue("(LL)", rows, bad);
+}
+
+static PyObject *store_snapshot(StoreObject *self, PyObject *unused) {
+    (void)unused;
+    if (store_check(self) < 0) {
+        return NULL;
+    }
+
+    SnapshotObject *snapshot = PyObject_New(SnapshotObject, &SnapshotType);
+    if (!snapshot) {
+        return NULL;
+    }
+    if (realtime_store_snapshot(&self->store, &snapshot->snapshot) < 0) {
+        memset(&snapshot->snapshot, 0, sizeof(snapshot->snapshot));
+        Py_DECREF(snapshot);
+        return PyErr_NoMemory();
+    }
+    return (PyObject *)snapshot;
+}
+
+static PyObject *store_query(StoreObject *self, PyObject *args, PyObject *kwds) {
+    realtime_query_t query;
+    if (store_check(self) < 0 || parse_query(args, kwds, &query) < 0) {
+        return NULL;
+    }
+
+    realtime_snapshot_t snapshot;
+    if (realtime_store_snapshot(&self->store, &snapshot) < 0) {
+        return PyErr_NoMemory();
+    }
+    PyObject *result = query_snapshot(&snapshot, &query);
+    realtime_snapshot_release(&snapshot);
+    return result;
+}
+
+static PyObject *store_get_total_rows(StoreObject *self, void *closure) {
+    (void)closure;
+    if (store_check(self) < 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&self->store.lock);
+    unsigned long long total = self->store.total_rows;
+    pthread_mutex_unlock(&self->store.lock);
+    return PyLong_FromUnsignedLongLong(total);
+}
+
+static PyObject *store_get_evicted_rows(StoreObject *self, void *closure) {
+    (void)closure;
+    if (store_check(self) < 0) {
+        return NULL;
+    }
+    pthread_mutex_lock(&self->store.lock);
+    unsigned long long evicted = self->store.evicted_rows;
+    pthread_mutex_unlock(&self->store.lock);
+    return PyLong_FromUnsignedLongLong(evicted);
+}
+
+static PyMethodDef store_methods[] = {
+    {"ingest", (PyCFunction)store_ingest, METH_VARARGS,
+     "ingest(data, received_ns=0) -> (rows, bad_frames): append realtime frames from a byte stream"},
+    {"load_capture", (PyCFunction)store_load_capture, METH_VARARGS,
+     "load_capture(path) -> (rows, bad_frames): append realtime frames from a capture file"},
+    {"snapshot", (PyCFunction)store_snapshot, METH_NOARGS,
+     "snapshot() -> Snapshot"},
+    {"query", (PyCFunction)(void (*)(void))store_query, METH_VARARGS | METH_KEYWORDS,
+     "query(start_ms=None, end_ms=None, device=None, channel=None) -> {name: Column}"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef store_getset[] = {
+    {"total_rows", (getter)store_get_total_rows, NULL, "rows appended since creation", NULL},
+    {"evicted_rows", (getter)store_get_evicted_rows, NULL, "rows dropped by retention", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject StoreType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "traffic.Store",
+    .tp_doc = "Store(max_rows=0): in-process columnar store of realtime traffic records",
+    .tp_basicsize = sizeof(StoreObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)store_init,
+    .tp_dealloc = (destructor)store_dealloc,
+    .tp_methods = store_methods,
+    .tp_getset = store_getset,
+};
+
+// ============================================================================
+// Controller：后台线程运行的信号控制机
+// ============================================================================
+
+typedef struct {
+    PyObject_HEAD
+    signal_controller_t *controller;
+    StoreObject *store;
+    pthread_t thread;
+    int thread_running;
+    volatile int thread_done;
+    int result;
+} ControllerObject;
+
+static void *controller_thread(void *arg) {
+    ControllerObject *self = arg;
+    self->result = signal_controller_start(self->controller);
+    self->thread_done = 1;
+    return NULL;
+}
+
+static int controller_init(ControllerObject *self, PyObject *args, PyObject *kwds) {
+    static char *kwlist[] = {"store", "port", "admin_code", "device_id", NULL};
+    StoreObject *store;
+    int port = DEFAULT_PORT;
+    unsigned int admin_code = 110100;
+    unsigned int device_id = 1;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!|iII", kwlist, &StoreType, &store,
+                                     &port, &admin_code, &device_id)) {
+        return -1;
+    }
+    if (self->controller) {
+        PyErr_SetString(PyExc_RuntimeError, "Controller already initialized");
+        return -1;
+    }
+    if (store_check(store) < 0) {
+        return -1;
+    }
+
+    self->controller = malloc(sizeof(signal_controller_t));
+    if (!self->controller) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (signal_controller_init(self->controller, admin_code, (uint16_t)device_id, port) < 0) {
+        free(self->controller);
+        self->controller = NULL;
+        PyErr_SetString(PyExc_ValueError, "failed to initialize controller");
+        return -1;
+    }
+
+    Py_INCREF(store);
+    self->store = store;
+    signal_controller_set_realtime_store(self->controller, &store->store);
+    return 0;
+}
+
+static PyObject *controller_start(ControllerObject *self, PyObject *unused) {
+    (void)unused;
+    if (!self->controller || self->thread_running) {
+        PyErr_SetString(PyExc_RuntimeError, "Controller not initialized or already running");
+        return NULL;
+    }
+
+    self->thread_done = 0;
+    if (pthread_create(&self->thread, NULL, controller_thread, self) != 0) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    self->thread_running = 1;
+
+    // 等待监听socket建立或线程失败退出
+    Py_BEGIN_ALLOW_THREADS
+    for (int i = 0; i < 200 && !self->thread_done &&
+                    !__atomic_load_n(&self->controller->running, __ATOMIC_ACQUIRE); i++) {
+        usleep(5000);
+    }
+    Py_END_ALLOW_THREADS
+
+    if (self->thread_done) {
+        pthread_join(self->thread, NULL);
+        self->thread_running = 0;
+        return PyErr_Format(PyExc_OSError, "failed to listen on port %d", self->controller->port);
+    }
+    Py_RETURN_NONE;
+}
+
+static void controller_join(ControllerObject *self) {
+    if (!self->thread_running) {
+        return;
+    }
+
+    __atomic_store_n(&self->controller->running, 0, __ATOMIC_RELEASE);
+    Py_BEGIN_ALLOW_THREADS
+    pthread_join(self->thread, NULL);
+    Py_END_ALLOW_THREADS
+    self->thread_running = 0;
+    signal_controller_stop(self->controller);
+}
+
+static PyObject *controller_stop(ControllerObject *self, PyObject *unused) {
+    (void)unused;
+    if (self->controller) {
+        controller_join(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static void controller_dealloc(ControllerObject *self) {
+    if (self->controller) {
+        controller_join(self);
+        free(self->controller);
+    }
+    Py_XDECREF(self->store);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *controller_get_store(ControllerObject *self, void *closure) {
+    (void)closure;
+    if (!self->store) {
+        Py_RETURN_NONE;
+    }
+    Py_INCREF(self->store);
+    return (PyObject *)self->store;
+}
+
+static PyObject *controller_get_clients(ControllerObject *self, void *closure) {
+    (void)closure;
+    return PyLong_FromLong(self->controller ? self->controller->client_count : 0);
+}
+
+static PyMethodDef controller_methods[] = {
+    {"start", (PyCFunction)controller_start, METH_NOARGS, "start listening in a background thread"},
+    {"stop", (PyCFunction)controller_stop, METH_NOARGS, "stop the background thread"},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef controller_getset[] = {
+    {"store", (getter)controller_get_store, NULL, "Store receiving realtime data", NULL},
+    {"clients", (getter)controller_get_clients, NULL, "connected clients", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject ControllerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "traffic.Controller",
+    .tp_doc = "Controller(store, port=40000, admin_code=110100, device_id=1): "
+              "signal controller feeding a Store",
+    .tp_basicsize = sizeof(ControllerObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)controller_init,
+    .tp_dealloc = (destructor)controller_dealloc,
+    .tp_methods = controller_methods,
+    .tp_getset = controller_getset,
+};
+
+// ============================================================================
+// 模块函数
+// ============================================================================
+
+static PyObject *module_decode_capture(PyObject *module, PyObject *args) {
+    (void)module;
+    const char *path;
+    if (!PyArg_ParseTuple(args, "s", &path)) {
+        return NULL;
+    }
+
+    capture_reader_t reader;
+    if (capture_reader_open(&reader, path) < 0) {
+        return PyErr_Format(PyExc_OSError, "cannot open capture file %s", path);
+    }
+
+    realtime_columns_t columns;
+    int64_t rows = -1;
+    if (realtime_columns_init(&columns, 0) == 0) {
+        Py_BEGIN_ALLOW_THREADS
+        // 按文件大小预估行数，减少扩容次数
+        realtime_columns_reserve(&columns, reader.size / 64);
+        rows = realtime_decode_capture(&columns, &reader, NULL);
+        Py_END_ALLOW_THREADS
+    }
+    capture_reader_close(&reader);
+
+    if (rows < 0) {
+        realtime_columns_free(&columns);
+        return PyErr_Format(PyExc_ValueError, "failed to decode capture file %s", path);
+    }
+    return columns_to_dict(&columns);
+}
+
+static PyObject *module_to_dataframe(PyObject *module, PyObject *columns) {
+    (void)module;
+    if (!PyDict_Check(columns)) {
+        PyErr_SetString(PyExc_TypeError, "expected a dict of columns");
+        return NULL;
+    }
+
+    PyObject *numpy = PyImport_ImportModule("numpy");
+    PyObject *pandas = numpy ? PyImport_ImportModule("pandas") : NULL;
+    PyObject *arrays = pandas ? PyDict_New() : NULL;
+    PyObject *result = NULL;
+
+    if (arrays) {
+        PyObject *key, *value;
+        Py_ssize_t pos = 0;
+        int ok = 1;
+        while (ok && PyDict_Next(columns, &pos, &key, &value)) {
+            // numpy.asarray通过缓冲区协议直接引用列数据
+            PyObject *array = PyObject_CallMethod(numpy, "asarray", "O", value);
+            ok = array && PyDict_SetItem(arrays, key, array) == 0;
+            Py_XDECREF(array);
+        }
+        if (ok) {
+            result = PyObject_CallMethod(pandas, "DataFrame", "O", arrays);
+        }
+    }
+
+    Py_XDECREF(arrays);
+    Py_XDECREF(pandas);
+    Py_XDECREF(numpy);
+    return result;
+}
+
+static PyObject *module_set_log_level(PyObject *module, PyObject *args) {
+    (void)module;
+    int level;
+    if (!PyArg_ParseTuple(args, "i", &level)) {
+        return NULL;
+    }
+    if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_ERROR) {
+        PyErr_SetString(PyExc_ValueError, "log level must be 0..3");
+        return NULL;
+    }
+    logger_init((log_level_t)level, NULL);
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef module_methods[] = {
+    {"decode_capture", module_decode_capture, METH_VARARGS,
+     "decode_capture(path) -> {name: Column}: decode all realtime records in a capture file"},
+    {"to_dataframe", module_to_dataframe, METH_O,
+     "to_dataframe(columns) -> pandas.DataFrame backed by the column buffers"},
+    {"set_log_level", module_set_log_level, METH_VARARGS,
+     "set_log_level(level): 0=DEBUG 1=INFO 2=WARN 3=ERROR"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef traffic_module = {
+    PyModuleDef_HEAD_INIT,
+    .m_name = "traffic",
+    .m_doc = "GB/T 43229-2023 traffic detector data as zero-copy columns",
+    .m_size = -1,
+    .m_methods = module_methods,
+};
+
+PyMODINIT_FUNC PyInit_traffic(void) {
+    if (PyType_Ready(&ColumnType) < 0 || PyType_Ready(&SnapshotType) < 0 ||
+        PyType_Ready(&StoreType) < 0 || PyType_Ready(&ControllerType) < 0) {
+        return NULL;
+    }
+
+    PyObject *module = PyModule_Create(&traffic_module);
+    if (!module) {
+        return NULL;
+    }
+
+    PyObject *names = PyTuple_New(REALTIME_COLUMN_COUNT);
+    if (!names) {
+        Py_DECREF(module);
+        return NULL;
+    }
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        PyTuple_SET_ITEM(names, i, PyUnicode_FromString(realtime_column_info[i].name));
+    }
+
+    if (PyModule_AddObject(module, "COLUMNS", names) < 0 ||
+        PyModule_AddObjectRef(module, "Column", (PyObject *)&ColumnType) < 0 ||
+        PyModule_AddObjectRef(module, "Snapshot", (PyObject *)&SnapshotType) < 0 ||
+        PyModule_AddObjectRef(module, "Store", (PyObject *)&StoreType) < 0 ||
+        PyModule_AddObjectRef(module, "Controller", (PyObject *)&ControllerType) < 0) {
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    logger_init(LOG_LEVEL_WARN, NULL);
+    metrics_init();
+    return module;
+}
@@ -11,6 +11,9 @@
  #include <string.h>
  #include <unistd.h>
  #include <sys/select.h>
+ #include <sys/eventfd.h>
+ #include <poll.h>
+ #include <sched.h>
  #include <errno.h>
  
  /**
@@ -43,6 +46,9 @@
      detector->connected = 0;
      detector->running = 0;
      detector->active_channels = 4;
+     detector->event_fd = -1;
+     pthread_mutex_init(&detector->send_lock, NULL);
+     detector->radio_since = time(NULL);
      
      // 初始化时间
      detector->last_connect_try = 0;
@@ -137,6 +143,9 @@
                      LOG_ERROR("Failed to send realtime data");
                  }
                  detector->last_realtime_upload = current_time;
+                 
+                 // 突发模式下每K个上传周期合并发送一次
+                 detector_burst_interval_elapsed(detector);
              }
              
              // 定期发送统计数据
@@ -145,6 +154,9 @@
                      LOG_ERROR("Failed to send statistics data");
                  }
                  detector->last_statistics_upload = current_time;
+                 LOG_INFO("Radio writes: %llu (%.1f per hour)",
+                          (unsigned long long)detector->radio_writes,
+                          detector_radio_writes_per_hour(detector));
              }
          }
          
@@ -152,8 +164,10 @@
          usleep(100000); // 100ms
      }
      
+     detector_flush_burst(detector);
      detector_disconnect(detector);
-     LOG_INFO("Vehicle detector stopped");
+     LOG_INFO("Vehicle detector stopped - radio writes: %llu (%.1f per hour)",
+              (unsigned long long)detector->radio_writes, detector_radio_writes_per_hour(detector));
      return 0;
  }
  
@@ -163,6 +177,7 @@
  void vehicle_detector_stop(vehicle_detector_t *detector) {
      if (detector) {
          detector->running = 0;
+         detector_flush_burst(detector);
          detector_disconnect(detector);
      }
  }
@@ -180,14 +195,17 @@
          return 0;
      }
      
-     detector->sockfd = create_tcp_client(detector->server_ip, detector->server_port);
-     if (detector->sockfd < 0) {
+     int sockfd = create_tcp_client(detector->server_ip, detector->server_port);
+     if (sockfd < 0) {
          LOG_DEBUG("Failed to connect to server %s:%d", 
                   detector->server_ip, detector->server_port);
          return -1;
      }
      
-     detector->connected = 1;
+     pthread_mutex_lock(&detector->send_lock);
+     detector->sockfd = sockfd;
+     __atomic_store_n(&detector->connected, 1, __ATOMIC_RELEASE);
+     pthread_mutex_unlock(&detector->send_lock);
      detector->last_heartbeat = time(NULL);
      LOG_INFO("Connected to server %s:%d", detector->server_ip, detector->server_port);
      
@@ -202,12 +220,27 @@
          return;
      }
      
-     if (detector->connected && detector->sockfd >= 0) {
+     // 与发送线程的批量写入互斥，避免写入已关闭或被复用的描述符
+     // 重连后需先发送连接请求，累积的数据帧不再补发
+     pthread_mutex_lock(&detector->send_lock);
+     int was_connected = detector->connected && detector->sockfd >= 0;
+     if (was_connected) {
          close(detector->sockfd);
          detector->sockfd = -1;
-         detector->connected = 0;
+         __atomic_store_n(&detector->connected, 0, __ATOMIC_RELEASE);
+     }
+     int discarded = detector->burst_frames;
+     detector->burst_len = 0;
+     detector->burst_frames = 0;
+     detector->burst_pending_intervals = 0;
+     pthread_mutex_unlock(&detector->send_lock);
+     
+     if (was_connected) {
          LOG_INFO("Disconnected from server");
      }
+     if (discarded > 0) {
+         LOG_WARN("Discarding %d buffered frames on disconnect", discarded);
+     }
  }
  
  /**
@@ -295,6 +328,121 @@
      return send_message(detector, OP_QUERY_RESPONSE, OBJ_COMMUNICATION, NULL, 0);
  }
  
+ /**
+  * @brief 把一条消息编码为完整帧 (数据表直接引用content，不复制)
+  * @return 帧长度，失败返回-1
+  */
+ static int encode_message(const vehicle_detector_t *detector, uint8_t operation, uint16_t object_id,
+                           const uint8_t *content, uint16_t content_len,
+                           uint8_t *buffer, size_t buffer_size) {
+     protocol_frame_t frame;
+     frame.frame_start = FRAME_START;
+     frame.frame_end = FRAME_END;
+     frame.data.link_addr = 0x0000;
+     frame.data.sender = detector->device_id;
+     frame.data.receiver = detector->server_id;
+     frame.data.protocol_ver = PROTOCOL_VERSION;
+     frame.data.operation = operation;
+     frame.data.object_id = object_id;
+     frame.data.content_len = content_len;
+     frame.data.content = content_len > 0 ? (uint8_t *)content : NULL;
+     
+     return encode_frame(&frame, buffer, buffer_size);
+ }
+ 
+ /**
+  * @brief 把已编码的帧一次写入socket，并计入写入次数 (调用方持有send_lock)
+  * @return 0成功，-1失败
+  */
+ static int write_frames_locked(vehicle_detector_t *detector, const uint8_t *data, size_t len) {
+     int result = detector->sockfd >= 0 ? send_all(detector->sockfd, data, len) : -1;
+     if (result > 0) {
+         __atomic_add_fetch(&detector->radio_writes, 1, __ATOMIC_RELAXED);
+         return 0;
+     }
+     return -1;
+ }
+ 
+ /**
+  * @brief 把已编码的帧一次写入socket，并计入写入次数
+  * @return 0成功，-1失败
+  */
+ static int write_frames(vehicle_detector_t *detector, const uint8_t *data, size_t len) {
+     pthread_mutex_lock(&detector->send_lock);
+     int result = write_frames_locked(detector, data, len);
+     pthread_mutex_unlock(&detector->send_lock);
+     return result;
+ }
+ 
+ /**
+  * @brief 发出已累积的数据帧 (调用方持有send_lock)
+  * @return 0成功 (包括没有待发送数据)，-1失败
+  */
+ static int flush_burst_locked(vehicle_detector_t *detector) {
+     detector->burst_pending_intervals = 0;
+     if (detector->burst_len == 0) {
+         return 0;
+     }
+     
+     int result = write_frames_locked(detector, detector->burst_buffer, detector->burst_len);
+     if (result == 0) {
+         LOG_DEBUG("Sent burst: %d frames, %zu bytes", detector->burst_frames, detector->burst_len);
+     } else {
+         LOG_ERROR("Failed to send burst of %d frames", detector->burst_frames);
+     }
+     
+     detector->burst_len = 0;
+     detector->burst_frames = 0;
+     return result;
+ }
+ 
+ /**
+  * @brief 发送数据帧：突发模式下编码后累积到本地缓冲区，否则立即发送
+  * @return 0成功，-1失败
+  */
+ static int send_data_message(vehicle_detector_t *detector, uint8_t operation, uint16_t object_id,
+                              const uint8_t *content, uint16_t content_len) {
+     if (detector->burst_intervals <= 0) {
+         return send_message(detector, operation, object_id, content, content_len);
+     }
+     
+     if (!detector->connected) {
+         LOG_ERROR("Not connected to server");
+         return -1;
+     }
+     
+     uint8_t frame[MAX_FRAME_SIZE];
+     int frame_len = encode_message(detector, operation, object_id, content, content_len,
+                                    frame, sizeof(frame));
+     if (frame_len <= 0) {
+         LOG_ERROR("Failed to encode frame");
+         return -1;
+     }
+     
+     // 缓冲区与send_message的顺带发送、断开时的丢弃共用send_lock
+     pthread_mutex_lock(&detector->send_lock);
+     
+     // 放不下时先发出已累积的帧
+     if (detector->burst_len + frame_len > sizeof(detector->burst_buffer) &&
+         flush_burst_locked(detector) < 0) {
+         pthread_mutex_unlock(&detector->send_lock);
+         return -1;
+     }
+     
+     memcpy(detector->burst_buffer + detector->burst_len, frame, frame_len);
+     detector->burst_len += frame_len;
+     detector->burst_frames++;
+     LOG_DEBUG("Buffered message: op=0x%02X, obj=0x%04X, len=%d (%zu bytes pending)",
+               operation, object_id, frame_len, detector->burst_len);
+     
+     int result = 0;
+     if (detector->burst_len >= detector->burst_threshold) {
+         result = flush_burst_locked(detector);
+     }
+     pthread_mutex_unlock(&detector->send_lock);
+     return result;
+ }
+ 
  /**
   * @brief 发送实时交通数据
   */
@@ -304,6 +452,9 @@
          return -1;
      }
      
+     // 从最新发布的快照编码，采样方不会写入该缓冲区
+     const channel_snapshot_t *snapshot = detector_snapshot_acquire(detector);
+     
      // 构建实时交通数据包
      uint8_t content[MAX_CONTENT_SIZE];
      size_t content_len = 0;
@@ -328,17 +479,17 @@
          LOG_ERROR("Content buffer overflow");
          return -1;
      }
-     content[content_len++] = detector->active_channels;
+     content[content_len++] = snapshot->active_channels;
      
      // 添加各通道的实时数据
-     for (int i = 0; i < detector->active_channels; i++) {
+     for (int i = 0; i < snapshot->active_channels; i++) {
          // 检查剩余缓冲区空间 (每个通道需要大约20字节)
          if (content_len + 20 >= MAX_CONTENT_SIZE) {
              LOG_ERROR("Content buffer too small for channel %d", i);
              break;
          }
          
-         traffic_realtime_t *data = &detector->traffic_data[i];
+         const traffic_realtime_t *data = &snapshot->traffic_data[i];
          
          content[content_len++] = data->channel_id;
          content[content_len++] = data->vehicle_count_a;
@@ -372,7 +523,7 @@
      }
      
      LOG_DEBUG("Sending realtime traffic data (%zu bytes)", content_len);
-     return send_message(detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, content_len);
+     return send_data_message(detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, content_len);
  }
  
  /**
@@ -384,6 +535,7 @@
          return -1;
      }
      
+     const channel_snapshot_t *snapshot = detector_snapshot_acquire(detector);
      uint8_t content[MAX_CONTENT_SIZE];
      size_t content_len = 0;
      
@@ -413,10 +565,10 @@
      content[content_len++] = 0;
      
      // 检测通道数
-     content[content_len++] = detector->active_channels;
+     content[content_len++] = snapshot->active_channels;
      
      // 各通道统计数据
-     for (int i = 0; i < detector->active_channels; i++) {
+     for (int i = 0; i < snapshot->active_channels; i++) {
          // 检查剩余缓冲区空间 (每个通道需要大约20字节)
          if (content_len + 20 >= MAX_CONTENT_SIZE) {
              LOG_ERROR("Content buffer too small for statistics channel %d", i);
@@ -426,43 +578,43 @@
          content[content_len++] = i + 1; // 通道编号
          
          // A类车总流量 (2字节)
-         uint16_t total_a = detector->total_vehicles_a;
+         uint16_t total_a = snapshot->total_vehicles_a;
          content[content_len++] = total_a & 0xFF;
          content[content_len++] = (total_a >> 8) & 0xFF;
          
          // B类车总流量 (2字节)
-         uint16_t total_b = detector->total_vehicles_b;
+         uint16_t total_b = snapshot->total_vehicles_b;
          content[content_len++] = total_b & 0xFF;
          content[content_len++] = (total_b >> 8) & 0xFF;
          
          // C类车总流量 (2字节)
-         uint16_t total_c = detector->total_vehicles_c;
+         uint16_t total_c = snapshot->total_vehicles_c;
          content[content_len++] = total_c & 0xFF;
          content[content_len++] = (total_c >> 8) & 0xFF;
          
          // 平均时间占有率 (2字节)
-         uint16_t avg_occupancy = detector->traffic_data[i].time_occupancy;
+         uint16_t avg_occupancy = snapshot->traffic_data[i].time_occupancy;
          content[content_len++] = avg_occupancy & 0xFF;
          content[content_len++] = (avg_occupancy >> 8) & 0xFF;
          
          // 平均车辆速度
-         content[content_len++] = detector->traffic_data[i].vehicle_speed;
+         content[content_len++] = snapshot->traffic_data[i].vehicle_speed;
          
          // 平均车辆长度 (2字节)
-         content[content_len++] = detector->traffic_data[i].vehicle_length & 0xFF;
-         content[content_len++] = (detector->traffic_data[i].vehicle_length >> 8) & 0xFF;
+         content[content_len++] = snapshot->traffic_data[i].vehicle_length & 0xFF;
+         content[content_len++] = (snapshot->traffic_data[i].vehicle_length >> 8) & 0xFF;
          
          // 平均车头时距
-         content[content_len++] = detector->traffic_data[i].headway;
+         content[content_len++] = snapshot->traffic_data[i].headway;
          
          // 平均车间时距
-         content[content_len++] = detector->traffic_data[i].gap_time;
+         content[content_len++] = snapshot->traffic_data[i].gap_time;
          
          // 平均停车次数
-         content[content_len++] = detector->traffic_data[i].stop_count;
+         content[content_len++] = snapshot->traffic_data[i].stop_count;
          
          // 平均停车时长
-         content[content_len++] = detector->traffic_data[i].stop_duration;
+         content[content_len++] = snapshot->traffic_data[i].stop_duration;
          
          // 保留字节 (4字节)
          content[content_len++] = 0;
@@ -472,7 +624,7 @@
      }
      
      LOG_INFO("Sending statistics data (%zu bytes)", content_len);
-     return send_message(detector, OP_UPLOAD, OBJ_TRAFFIC_STATS, content, content_len);
+     return send_data_message(detector, OP_UPLOAD, OBJ_TRAFFIC_STATS, content, content_len);
  }
  
  /**
@@ -484,6 +636,7 @@
          return -1;
      }
      
+     const channel_snapshot_t *snapshot = detector_snapshot_acquire(detector);
      uint8_t content[MAX_CONTENT_SIZE];
      size_t content_len = 0;
      
@@ -503,10 +656,10 @@
      content[content_len++] = (current_time.milliseconds >> 8) & 0xFF;
      
      // 检测器通道数
-     content[content_len++] = detector->active_channels;
+     content[content_len++] = snapshot->active_channels;
      
      // 各通道状态
-     for (int i = 0; i < detector->active_channels; i++) {
+     for (int i = 0; i < snapshot->active_channels; i++) {
          // 检查剩余缓冲区空间
          if (content_len + 4 >= MAX_CONTENT_SIZE) {
              LOG_ERROR("Content buffer too small for channel %d status", i);
@@ -514,7 +667,7 @@
          }
          
          content[content_len++] = i + 1; // 通道编号
-         content[content_len++] = detector->channel_status[i].status; // 运行状态
+         content[content_len++] = snapshot->channel_status[i].status; // 运行状态
          content[content_len++] = 0; // 保留字节
          content[content_len++] = 0; // 保留字节
      }
@@ -539,8 +692,17 @@
      }
      last_update = current_time;
      
+     // 写入采样方独占的缓冲区，其中是更早周期的数据，每个字段都需重新写入
+     channel_snapshot_t *snapshot = detector_snapshot_begin(detector);
+     
      for (int i = 0; i < detector->active_channels; i++) {
-         traffic_realtime_t *data = &detector->traffic_data[i];
+         traffic_realtime_t *data = &snapshot->traffic_data[i];
+         
+         data->channel_id = i + 1;
+         data->stop_count = 0;
+         data->stop_duration = 0;
+         data->occupy_sample_count = 10;
+         data->occupy_info = NULL;
          
          // 模拟车流量变化
          data->vehicle_count_a = rand() % 3;
@@ -560,8 +722,16 @@
          data->gap_time = 10 + rand() % 15;          // 1.0-2.5s
          
          // 随机设备状态 (99%正常)
-         detector->channel_status[i].status = (rand() % 100) < 99 ? 0 : 1;
+         snapshot->channel_status[i].channel_id = i + 1;
+         snapshot->channel_status[i].status = (rand() % 100) < 99 ? 0 : 1;
      }
+     
+     snapshot->active_channels = detector->active_channels;
+     snapshot->total_vehicles_a = detector->total_vehicles_a;
+     snapshot->total_vehicles_b = detector->total_vehicles_b;
+     snapshot->total_vehicles_c = detector->total_vehicles_c;
+     snapshot->sampled_at = current_time;
+     detector_snapshot_publish(detector);
  }
  
  /**
@@ -574,9 +744,10 @@
      
      srand(time(NULL)); // 初始化随机数种子
      
+     channel_snapshot_t *initial = &detector->snapshots[0];
      for (int i = 0; i < detector->active_channels; i++) {
-         traffic_realtime_t *data = &detector->traffic_data[i];
-         channel_status_t *status = &detector->channel_status[i];
+         traffic_realtime_t *data = &initial->traffic_data[i];
+         channel_status_t *status = &initial->channel_status[i];
          
          data->channel_id = i + 1;
          data->vehicle_count_a = 0;
@@ -600,9 +771,55 @@
      detector->total_vehicles_b = 0;
      detector->total_vehicles_c = 0;
      
+     initial->active_channels = detector->active_channels;
+     initial->sampled_at = time(NULL);
+     
+     // 三个缓冲区从同一初始快照开始，上传方在首次采样前读到的是初始值
+     for (int i = 1; i < DETECTOR_SNAPSHOT_COUNT; i++) {
+         detector->snapshots[i] = *initial;
+     }
+     detector->snapshot_front = 0;
+     detector->snapshot_middle = 1;
+     detector->snapshot_back = 2;
+     detector->snapshot_sequence = 0;
+     
      LOG_INFO("Simulation data initialized for %d channels", detector->active_channels);
  }
  
+ /**
+  * @brief 获取采样方可写入的快照缓冲区
+  */
+ channel_snapshot_t *detector_snapshot_begin(vehicle_detector_t *detector) {
+     return &detector->snapshots[detector->snapshot_back];
+ }
+ 
+ /**
+  * @brief 发布快照：与middle交换缓冲区，上传方下次获取时切换到该快照
+  */
+ void detector_snapshot_publish(vehicle_detector_t *detector) {
+     channel_snapshot_t *snapshot = &detector->snapshots[detector->snapshot_back];
+     snapshot->sequence = ++detector->snapshot_sequence;
+     
+     // release保证快照内容先于索引可见；换回的缓冲区可能是上传方尚未读取的旧快照，直接覆盖
+     int previous = __atomic_exchange_n(&detector->snapshot_middle,
+                                        detector->snapshot_back | DETECTOR_SNAPSHOT_FRESH,
+                                        __ATOMIC_ACQ_REL);
+     detector->snapshot_back = previous & ~DETECTOR_SNAPSHOT_FRESH;
+ }
+ 
+ /**
+  * @brief 获取最新发布的快照
+  */
+ const channel_snapshot_t *detector_snapshot_acquire(vehicle_detector_t *detector) {
+     // 没有新快照时继续使用当前缓冲区，不需要原子写操作
+     if (__atomic_load_n(&detector->snapshot_middle, __ATOMIC_RELAXED) & DETECTOR_SNAPSHOT_FRESH) {
+         int previous = __atomic_exchange_n(&detector->snapshot_middle, detector->snapshot_front,
+                                            __ATOMIC_ACQ_REL);
+         detector->snapshot_front = previous & ~DETECTOR_SNAPSHOT_FRESH;
+     }
+     return &detector->snapshots[detector->snapshot_front];
+ }
+ 
  /**
   * @brief 发送消息到服务器
   */
@@ -618,38 +835,317 @@
          return -1;
      }
      
-     // 创建数据表
-     data_table_t data_table = create_data_table(
-         detector->device_id,
-         detector->server_id,
-         operation,
-         object_id,
-         content,
-         content_len
-     );
-     
-     protocol_frame_t frame;
-     frame.frame_start = FRAME_START;
-     frame.frame_end = FRAME_END;
-     frame.data = data_table;
+     // 发送线程运行时统一经由提交队列，保证同一socket上只有一个写入者
+     if (__atomic_load_n(&detector->sender_running, __ATOMIC_ACQUIRE)) {
+         return detector_submit(detector, operation, object_id, content, content_len);
+     }
      
      // 编码并发送
      uint8_t buffer[MAX_FRAME_SIZE];
-     int frame_len = encode_frame(&frame, buffer, sizeof(buffer));
-     
-     int result = -1;
-     if (frame_len > 0) {
-         result = send_all(detector->sockfd, buffer, frame_len);
-         if (result > 0) {
-             LOG_DEBUG("Sent message: op=0x%02X, obj=0x%04X, len=%d",
-                      operation, object_id, frame_len);
+     int frame_len = encode_message(detector, operation, object_id, content, content_len,
+                                    buffer, sizeof(buffer));
+     if (frame_len <= 0) {
+         LOG_ERROR("Failed to encode frame");
+         return -1;
+     }
+     
+     int result;
+     pthread_mutex_lock(&detector->send_lock);
+     if (detector->burst_len > 0 && detector->burst_len + frame_len <= sizeof(detector->burst_buffer)) {
+         // 无线电已为本帧唤醒，累积的数据帧随同一次写入发出
+         memcpy(detector->burst_buffer + detector->burst_len, buffer, frame_len);
+         detector->burst_len += frame_len;
+         detector->burst_frames++;
+         result = flush_burst_locked(detector);
+     } else {
+         result = write_frames_locked(detector, buffer, frame_len);
+     }
+     pthread_mutex_unlock(&detector->send_lock);
+     
+     if (result == 0) {
+         LOG_DEBUG("Sent message: op=0x%02X, obj=0x%04X, len=%d",
+                  operation, object_id, frame_len);
+     } else {
+         LOG_ERROR("Failed to send message to server");
+     }
+     return result;
+ }
+ 
+ /**
+  * @brief 设置突发发送模式
+  */
+ int vehicle_detector_set_burst(vehicle_detector_t *detector, int intervals, size_t threshold) {
+     if (!detector || intervals < 0) {
+         LOG_ERROR("Invalid burst parameters");
+         return -1;
+     }
+     
+     // 关闭或调整前先发出已累积的帧
+     pthread_mutex_lock(&detector->send_lock);
+     flush_burst_locked(detector);
+     detector->burst_intervals = intervals;
+     detector->burst_threshold = (threshold == 0 || threshold > sizeof(detector->burst_buffer))
+                                 ? sizeof(detector->burst_buffer) : threshold;
+     detector->burst_pending_intervals = 0;
+     pthread_mutex_unlock(&detector->send_lock);
+     
+     if (intervals > 0) {
+         LOG_INFO("Burst mode enabled - every %d upload intervals or %zu bytes",
+                  intervals, detector->burst_threshold);
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief 一个实时上传周期结束
+  */
+ int detector_burst_interval_elapsed(vehicle_detector_t *detector) {
+     if (!detector) {
+         return -1;
+     }
+     
+     pthread_mutex_lock(&detector->send_lock);
+     int result = 0;
+     if (detector->burst_intervals > 0 &&
+         ++detector->burst_pending_intervals >= detector->burst_intervals) {
+         result = flush_burst_locked(detector);
+     }
+     pthread_mutex_unlock(&detector->send_lock);
+     return result;
+ }
+ 
+ /**
+  * @brief 立即发送已累积的数据帧
+  */
+ int detector_flush_burst(vehicle_detector_t *detector) {
+     if (!detector) {
+         return -1;
+     }
+     
+     pthread_mutex_lock(&detector->send_lock);
+     int result = flush_burst_locked(detector);
+     pthread_mutex_unlock(&detector->send_lock);
+     return result;
+ }
+ 
+ /**
+  * @brief 每小时socket写入次数
+  */
+ double detector_radio_writes_per_hour(const vehicle_detector_t *detector) {
+     if (!detector) {
+         return 0;
+     }
+     
+     double hours = difftime(time(NULL), detector->radio_since) / 3600.0;
+     if (hours < 1.0 / 60) {
+         hours = 1.0 / 60; // 运行不足一分钟时按一分钟折算，避免启动初期数值失真
+     }
+     return detector->radio_writes / hours;
+ }
+ 
+ /**
+  * @brief 把队列中已发布的消息编码进批量缓冲区并一次写出 (仅发送线程)
+  * @return 本次发送的消息数
+  */
+ static size_t flush_submitted(vehicle_detector_t *detector, uint8_t *batch) {
+     size_t batch_len = 0;
+     size_t messages = 0;
+     detector_message_t *msg;
+     
+     while (batch_len + MAX_FRAME_SIZE <= DETECTOR_TX_BATCH_SIZE &&
+            (msg = mpsc_queue_peek(&detector->tx_queue)) != NULL) {
+         // 数据表直接引用槽位中的内容，编码完成后才归还槽位
+         int frame_len = encode_message(detector, msg->operation, msg->object_id,
+                                        msg->content, msg->content_len,
+                                        batch + batch_len, DETECTOR_TX_BATCH_SIZE - batch_len);
+         if (frame_len > 0) {
+             batch_len += frame_len;
+             messages++;
          } else {
-             LOG_ERROR("Failed to send message to server");
+             LOG_ERROR("Failed to encode submitted message: op=0x%02X, obj=0x%04X",
+                       msg->operation, msg->object_id);
+             __atomic_add_fetch(&detector->tx_dropped, 1, __ATOMIC_RELAXED);
          }
+         mpsc_queue_release(&detector->tx_queue);
+     }
+     
+     if (batch_len == 0) {
+         return messages;
+     }
+     
+     if (write_frames(detector, batch, batch_len) == 0) {
+         __atomic_add_fetch(&detector->tx_sent, messages, __ATOMIC_RELAXED);
+         __atomic_add_fetch(&detector->tx_batches, 1, __ATOMIC_RELAXED);
+         LOG_DEBUG("Sent batch: %zu messages, %zu bytes", messages, batch_len);
      } else {
-         LOG_ERROR("Failed to encode frame");
+         LOG_ERROR("Failed to send batch of %zu messages", messages);
+         __atomic_add_fetch(&detector->tx_dropped, messages, __ATOMIC_RELAXED);
+     }
+     return messages;
+ }
+ 
+ /**
+  * @brief 发送线程：排空提交队列，空闲时在eventfd上等待生产者唤醒
+  */
+ static void *sender_thread_main(void *arg) {
+     vehicle_detector_t *detector = (vehicle_detector_t *)arg;
+     uint8_t *batch = malloc(DETECTOR_TX_BATCH_SIZE);
+     if (!batch) {
+         LOG_ERROR("Failed to allocate sender batch buffer");
+         return NULL;
      }
      
-     free_frame(&frame);
-     return result > 0 ? 0 : -1;
- }
\ No newline at end of file
+     for (;;) {
+         if (flush_submitted(detector, batch) > 0) {
+             continue;
+         }
+         if (!__atomic_load_n(&detector->sender_running, __ATOMIC_SEQ_CST)) {
+             // 已通过运行检查的生产者可能仍在发布，等它们离开后取出剩余消息再退出，
+             // 之后新的生产者都会看到停止标志，不再访问队列
+             if (__atomic_load_n(&detector->tx_submitters, __ATOMIC_SEQ_CST) > 0) {
+                 sched_yield();
+                 continue;
+             }
+             while (flush_submitted(detector, batch) > 0) {
+             }
+             break;
+         }
+         
+         // 先声明进入等待再复查队列，与生产者的"发布后检查标志"配对，不会丢失唤醒
+         __atomic_store_n(&detector->sender_sleeping, 1, __ATOMIC_SEQ_CST);
+         __atomic_thread_fence(__ATOMIC_SEQ_CST);
+         if (mpsc_queue_peek(&detector->tx_queue) == NULL &&
+             __atomic_load_n(&detector->sender_running, __ATOMIC_ACQUIRE)) {
+             struct pollfd pfd = { .fd = detector->event_fd, .events = POLLIN };
+             if (poll(&pfd, 1, 1000) > 0) {
+                 uint64_t value;
+                 if (read(detector->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                     LOG_WARN("Failed to read sender eventfd: %s", strerror(errno));
+                 }
+             }
+         }
+         __atomic_store_n(&detector->sender_sleeping, 0, __ATOMIC_SEQ_CST);
+     }
+     
+     free(batch);
+     return NULL;
+ }
+ 
+ /**
+  * @brief 唤醒发送线程
+  */
+ static void wake_sender(vehicle_detector_t *detector) {
+     uint64_t one = 1;
+     if (write(detector->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+         LOG_WARN("Failed to wake sender thread: %s", strerror(errno));
+     }
+ }
+ 
+ /**
+  * @brief 启动发送线程
+  */
+ int vehicle_detector_start_sender(vehicle_detector_t *detector) {
+     if (!detector) {
+         LOG_ERROR("Detector pointer is NULL");
+         return -1;
+     }
+     
+     if (detector->sender_running) {
+         return 0;
+     }
+     
+     if (mpsc_queue_init(&detector->tx_queue, DETECTOR_TX_QUEUE_SIZE, sizeof(detector_message_t)) < 0) {
+         LOG_ERROR("Failed to allocate submission queue");
+         return -1;
+     }
+     
+     detector->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+     if (detector->event_fd < 0) {
+         LOG_ERROR("Failed to create eventfd: %s", strerror(errno));
+         mpsc_queue_destroy(&detector->tx_queue);
+         return -1;
+     }
+     
+     detector->sender_sleeping = 0;
+     detector->tx_submitters = 0;
+     __atomic_store_n(&detector->sender_running, 1, __ATOMIC_RELEASE);
+     if (pthread_create(&detector->sender_thread, NULL, sender_thread_main, detector) != 0) {
+         LOG_ERROR("Failed to create sender thread");
+         detector->sender_running = 0;
+         close(detector->event_fd);
+         detector->event_fd = -1;
+         mpsc_queue_destroy(&detector->tx_queue);
+         return -1;
+     }
+     
+     LOG_INFO("Sender thread started - queue: %d slots, batch: %d bytes",
+              DETECTOR_TX_QUEUE_SIZE, DETECTOR_TX_BATCH_SIZE);
+     return 0;
+ }
+ 
+ /**
+  * @brief 停止发送线程
+  */
+ void vehicle_detector_stop_sender(vehicle_detector_t *detector) {
+     if (!detector || !detector->sender_running) {
+         return;
+     }
+     
+     // 发送线程退出前等待正在提交的生产者离开，join之后不再有线程访问队列
+     __atomic_store_n(&detector->sender_running, 0, __ATOMIC_SEQ_CST);
+     wake_sender(detector);
+     pthread_join(detector->sender_thread, NULL);
+     
+     close(detector->event_fd);
+     detector->event_fd = -1;
+     mpsc_queue_destroy(&detector->tx_queue);
+     
+     LOG_INFO("Sender thread stopped - submitted: %llu, sent: %llu, batches: %llu, dropped: %llu",
+              (unsigned long long)detector->tx_submitted, (unsigned long long)detector->tx_sent,
+              (unsigned long long)detector->tx_batches, (unsigned long long)detector->tx_dropped);
+ }
+ 
+ /**
+  * @brief 提交消息到发送队列
+  */
+ int detector_submit(vehicle_detector_t *detector, uint8_t operation, uint16_t object_id,
+                     const uint8_t *content, uint16_t content_len) {
+     if (!detector || content_len > MAX_CONTENT_SIZE || (content_len > 0 && !content)) {
+         return -1;
+     }
+     
+     // 先登记为提交者再检查运行标志，与停止方的"清除标志后等待提交者归零"配对，
+     // 通过检查的生产者离开之前，队列和eventfd不会被释放
+     __atomic_add_fetch(&detector->tx_submitters, 1, __ATOMIC_SEQ_CST);
+     if (!__atomic_load_n(&detector->sender_running, __ATOMIC_SEQ_CST) ||
+         !__atomic_load_n(&detector->connected, __ATOMIC_ACQUIRE)) {
+         __atomic_sub_fetch(&detector->tx_submitters, 1, __ATOMIC_RELEASE);
+         return -1;
+     }
+     
+     uint64_t ticket;
+     detector_message_t *msg = mpsc_queue_claim(&detector->tx_queue, &ticket);
+     if (!msg) {
+         // 队列满时不阻塞生产者，由调用方决定重试或丢弃
+         __atomic_add_fetch(&detector->tx_dropped, 1, __ATOMIC_RELAXED);
+         __atomic_sub_fetch(&detector->tx_submitters, 1, __ATOMIC_RELEASE);
+         return -1;
+     }
+     
+     msg->operation = operation;
+     msg->object_id = object_id;
+     msg->content_len = content_len;
+     if (content_len > 0) {
+         memcpy(msg->content, content, content_len);
+     }
+     mpsc_queue_publish(&detector->tx_queue, ticket);
+     __atomic_add_fetch(&detector->tx_submitted, 1, __ATOMIC_RELAXED);
+     
+     // 只有发送线程声明等待时才需要系统调用
+     __atomic_thread_fence(__ATOMIC_SEQ_CST);
+     if (__atomic_exchange_n(&detector->sender_sleeping, 0, __ATOMIC_SEQ_CST)) {
+         wake_sender(detector);
+     }
+     __atomic_sub_fetch(&detector->tx_submitters, 1, __ATOMIC_RELEASE);
+     return 0;
+ }
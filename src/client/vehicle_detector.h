@@ -7,12 +7,45 @@
 #define VEHICLE_DETECTOR_H
 
 #include "../common/protocol.h"
+#include "../utils/mpsc_queue.h"
+#include <pthread.h>
 #include <time.h>
 
 #define MAX_RETRY_COUNT 3       // 最大重试次数
 #define CONNECT_RETRY_INTERVAL 5 // 连接重试间隔(秒)
 #define REALTIME_UPLOAD_INTERVAL 2 // 实时数据上传间隔(秒)
 #define STATISTICS_UPLOAD_INTERVAL 60 // 统计数据上传间隔(秒)
+#define DETECTOR_TX_QUEUE_SIZE 256 // 多线程提交队列槽位数
+#define DETECTOR_TX_BATCH_SIZE 65536 // 发送线程单次批量写入上限(字节)
+#define DETECTOR_BURST_BUFFER_SIZE 16384 // 突发模式本地缓冲区大小(字节)
+
+#define DETECTOR_SNAPSHOT_COUNT 3 // 通道快照缓冲区数 (三缓冲)
+#define DETECTOR_SNAPSHOT_FRESH 0x4 // 发布位置含未读取快照的标志位
+
+/**
+ * @brief 一个采样周期的通道快照
+ * 由采样方整体写入后发布，发布后内容不再修改，上传方可直接编码
+ */
+typedef struct {
+    traffic_realtime_t traffic_data[MAX_CHANNELS]; // 交通流实时数据
+    channel_status_t channel_status[MAX_CHANNELS]; // 通道状态
+    int active_channels;        // 活跃通道数
+    uint32_t total_vehicles_a;  // 截至本周期的A类车总数
+    uint32_t total_vehicles_b;  // 截至本周期的B类车总数
+    uint32_t total_vehicles_c;  // 截至本周期的C类车总数
+    uint64_t sequence;          // 采样周期序号
+    time_t sampled_at;          // 采样时间
+} channel_snapshot_t;
+
+/**
+ * @brief 待发送消息 (提交队列槽位)
+ */
+typedef struct {
+    uint8_t operation;          // 操作类型
+    uint16_t object_id;         // 对象标识
+    uint16_t content_len;       // 消息内容长度
+    uint8_t content[MAX_CONTENT_SIZE]; // 消息内容
+} detector_message_t;
 
 /**
  * @brief 车辆检测器结构体
@@ -32,9 +65,12 @@ typedef struct {
     time_t last_statistics_upload; // 上次统计数据上传时间
     time_t last_heartbeat;      // 上次收到心跳时间
     
-    // 模拟数据
-    traffic_realtime_t traffic_data[MAX_CHANNELS]; // 交通流实时数据
-    channel_status_t channel_status[MAX_CHANNELS]; // 通道状态
+    // 模拟数据 (三缓冲：采样方写back，上传方读front，middle为最近发布的快照)
+    channel_snapshot_t snapshots[DETECTOR_SNAPSHOT_COUNT]; // 通道快照
+    int snapshot_back;          // 采样方正在写入的缓冲区 (仅采样线程访问)
+    int snapshot_middle;        // 最近发布的缓冲区 | FRESH标志 (两侧原子交换)
+    int snapshot_front;         // 上传方正在读取的缓冲区 (仅上传线程访问)
+    uint64_t snapshot_sequence; // 已发布的采样周期数 (仅采样线程访问)
     int active_channels;        // 活跃通道数
     
     // 统计数据
@@ -42,6 +78,30 @@ typedef struct {
     uint32_t total_vehicles_b;  // B类车总数
     uint32_t total_vehicles_c;  // C类车总数
     
+    // 多线程提交 (启用发送线程后，任意线程可无锁提交消息)
+    mpsc_queue_t tx_queue;      // 提交队列
+    pthread_t sender_thread;    // 发送线程
+    pthread_mutex_t send_lock;  // 保护sockfd的切换与写入，以及突发缓冲区 (burst_*)
+    int event_fd;               // 唤醒发送线程的eventfd
+    int sender_running;         // 发送线程运行标志
+    int sender_sleeping;        // 发送线程是否在等待唤醒
+    int tx_submitters;          // 已通过运行检查、正在提交的生产者数 (停止时等待其归零)
+    uint64_t tx_submitted;      // 已提交消息数
+    uint64_t tx_sent;           // 已发送消息数
+    uint64_t tx_batches;        // 批量写入次数
+    uint64_t tx_dropped;        // 队列满或未连接而丢弃的消息数
+    
+    // 突发发送 (无线/蜂窝回传设备：数据帧在本地累积，合并为一次写入以减少无线电唤醒)
+    // 缓冲区可能由主循环和直接调用send_message的线程同时访问，读写都持send_lock
+    int burst_intervals;        // 每多少个实时上传周期发送一次，0表示关闭
+    size_t burst_threshold;     // 缓冲字节数达到该值时提前发送
+    uint8_t burst_buffer[DETECTOR_BURST_BUFFER_SIZE]; // 已编码待发送的数据帧
+    size_t burst_len;           // 缓冲区已用字节数
+    int burst_frames;           // 缓冲区中的帧数
+    int burst_pending_intervals; // 自上次发送以来经过的上传周期数
+    uint64_t radio_writes;      // socket写入次数 (近似无线电唤醒次数)
+    time_t radio_since;         // 写入计数起始时间
+    
 } vehicle_detector_t;
 
 /**
@@ -71,6 +131,64 @@ int vehicle_detector_start(vehicle_detector_t *detector);
  */
 void vehicle_detector_stop(vehicle_detector_t *detector);
 
+/**
+ * @brief 启动发送线程
+ * 启动后send_message及detector_submit都经由提交队列，由发送线程统一编码并批量写入socket
+ * @param detector 检测器指针
+ * @return 0成功，-1失败
+ */
+int vehicle_detector_start_sender(vehicle_detector_t *detector);
+
+/**
+ * @brief 停止发送线程，队列中剩余的消息在退出前发送
+ * @param detector 检测器指针
+ */
+void vehicle_detector_stop_sender(vehicle_detector_t *detector);
+
+/**
+ * @brief 提交消息到发送队列 (线程安全，无锁)
+ * @param detector 检测器指针
+ * @param operation 操作类型
+ * @param object_id 对象标识
+ * @param content 消息内容
+ * @param content_len 内容长度
+ * @return 0成功，-1失败 (发送线程未启动、未连接或队列已满)
+ */
+int detector_submit(vehicle_detector_t *detector, uint8_t operation, uint16_t object_id,
+                    const uint8_t *content, uint16_t content_len);
+
+/**
+ * @brief 设置突发发送模式 (仅主循环线程)
+ * 实时数据和统计数据编码后在本地累积，每intervals个实时上传周期或累积字节数达到threshold时
+ * 合并为一次写入；心跳应答等控制帧仍立即发送，并顺带发出已累积的数据帧
+ * @param detector 检测器指针
+ * @param intervals 合并的上传周期数，0关闭突发模式
+ * @param threshold 提前发送的字节阈值，0使用缓冲区容量
+ * @return 0成功，-1失败
+ */
+int vehicle_detector_set_burst(vehicle_detector_t *detector, int intervals, size_t threshold);
+
+/**
+ * @brief 一个实时上传周期结束：突发模式下累计满intervals个周期时发出已累积的数据帧
+ * @param detector 检测器指针
+ * @return 0成功 (包括未到发送周期)，-1失败
+ */
+int detector_burst_interval_elapsed(vehicle_detector_t *detector);
+
+/**
+ * @brief 立即发送已累积的数据帧
+ * @param detector 检测器指针
+ * @return 0成功 (包括没有待发送数据)，-1失败
+ */
+int detector_flush_burst(vehicle_detector_t *detector);
+
+/**
+ * @brief 每小时socket写入次数 (近似无线电开启次数)
+ * @param detector 检测器指针
+ * @return 每小时写入次数
+ */
+double detector_radio_writes_per_hour(const vehicle_detector_t *detector);
+
 /**
  * @brief 连接到服务器
  * @param detector 检测器指针
@@ -138,6 +256,28 @@ void update_simulation_data(vehicle_detector_t *detector);
  */
 void init_simulation_data(vehicle_detector_t *detector);
 
+/**
+ * @brief 获取采样方可写入的快照缓冲区 (仅采样线程)
+ * 缓冲区内容是更早的快照，采样方需写入全部活跃通道后再发布
+ * @param detector 检测器指针
+ * @return 快照缓冲区
+ */
+channel_snapshot_t *detector_snapshot_begin(vehicle_detector_t *detector);
+
+/**
+ * @brief 发布detector_snapshot_begin得到的快照 (仅采样线程，不阻塞)
+ * @param detector 检测器指针
+ */
+void detector_snapshot_publish(vehicle_detector_t *detector);
+
+/**
+ * @brief 获取最新发布的快照 (仅上传线程，不阻塞)
+ * 返回的快照在下一次调用前保持不变，采样方不会写入
+ * @param detector 检测器指针
+ * @return 最新快照
+ */
+const channel_snapshot_t *detector_snapshot_acquire(vehicle_detector_t *detector);
+
 /**
  * @brief 发送消息到服务器
  * @param detector 检测器指针
@@ -0,0 +1,109 @@
+/**
+ * @file capture.c
+ * @brief 协议帧抓包文件读取实现
+ */
+
+#include "capture.h"
+#include "../utils/logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief 读取小端序整数
+ */
+static uint64_t get_le(const uint8_t *in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief 打开抓包文件并映射到内存
+ */
+int capture_reader_open(capture_reader_t *reader, const char *path) {
+    if (!reader || !path) {
+        return -1;
+    }
+
+    memset(reader, 0, sizeof(capture_reader_t));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open capture file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < CAPTURE_MAGIC_SIZE) {
+        LOG_ERROR("Capture file %s is too short", path);
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map capture file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if (memcmp(data, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) != 0) {
+        LOG_ERROR("File %s is not a capture file", path);
+        munmap(data, st.st_size);
+        return -1;
+    }
+
+    // 顺序读取
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    reader->data = data;
+    reader->size = st.st_size;
+    reader->offset = CAPTURE_MAGIC_SIZE;
+    return 0;
+}
+
+/**
+ * @brief 读取下一条记录
+ */
+int capture_reader_next(capture_reader_t *reader, int64_t *timestamp_ns,
+                        const uint8_t **frame, size_t *frame_len) {
+    if (!reader || !reader->data) {
+        return -1;
+    }
+
+    size_t remaining = reader->size - reader->offset;
+    if (remaining == 0) {
+        return 0;
+    }
+    if (remaining < CAPTURE_RECORD_HEADER_SIZE) {
+        return -1;
+    }
+
+    const uint8_t *record = reader->data + reader->offset;
+    size_t len = get_le(record + 8, 4);
+    if (remaining - CAPTURE_RECORD_HEADER_SIZE < len) {
+        return -1;
+    }
+
+    *timestamp_ns = (int64_t)get_le(record, 8);
+    *frame = record + CAPTURE_RECORD_HEADER_SIZE;
+    *frame_len = len;
+    reader->offset += CAPTURE_RECORD_HEADER_SIZE + len;
+    return 1;
+}
+
+/**
+ * @brief 解除映射
+ */
+void capture_reader_close(capture_reader_t *reader) {
+    if (reader && reader->data) {
+        munmap((void *)reader->data, reader->size);
+        reader->data = NULL;
+        reader->size = 0;
+        reader->offset = 0;
+    }
+}
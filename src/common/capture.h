@@ -0,0 +1,62 @@
+/**
+ * @file capture.h
+ * @brief 协议帧抓包文件读写
+ *
+ * 文件格式：8字节文件头 "TPCAP001"，之后是连续的记录，
+ * 每条记录为 [接收时间 u64 纳秒][帧长度 u32][原始帧字节]，整数均为小端序。
+ * 写入器见server/capture_writer.h。
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_MAGIC "TPCAP001"        // 文件头
+#define CAPTURE_MAGIC_SIZE 8            // 文件头长度
+#define CAPTURE_RECORD_HEADER_SIZE 12   // 记录头长度 (时间8 + 长度4)
+
+/**
+ * @brief 抓包文件读取器 (整个文件映射到内存)
+ */
+typedef struct {
+    const uint8_t *data;        // 映射的文件内容
+    size_t size;                // 文件大小
+    size_t offset;              // 下一条记录的偏移
+} capture_reader_t;
+
+/**
+ * @brief 打开抓包文件并映射到内存
+ * @param reader 读取器指针
+ * @param path 文件路径
+ * @return 0成功，-1失败 (文件不存在或文件头不符)
+ */
+int capture_reader_open(capture_reader_t *reader, const char *path);
+
+/**
+ * @brief 读取下一条记录，frame指向映射内存，不需要释放
+ * @param reader 读取器指针
+ * @param timestamp_ns 输出接收时间
+ * @param frame 输出帧指针
+ * @param frame_len 输出帧长度
+ * @return 1读到记录，0文件结束，-1记录被截断
+ */
+int capture_reader_next(capture_reader_t *reader, int64_t *timestamp_ns,
+                        const uint8_t **frame, size_t *frame_len);
+
+/**
+ * @brief 解除映射
+ * @param reader 读取器指针
+ */
+void capture_reader_close(capture_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_H
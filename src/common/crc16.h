@@ -9,6 +9,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief 计算CRC16校验码
  * 使用多项式 X^16 + X^15 + X^2 + 1 (0x8005)
@@ -20,4 +24,8 @@
  */
 uint16_t calculate_crc16(const uint8_t *data, size_t len);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // CRC16_H
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file crc32.c
+ * @brief CRC32校验算法实现
+ */
+
+#include "crc32.h"
+#include <pthread.h>
+
+// slice_table[k][b]为字节b之后再经过k个零字节的CRC，slice_table[0]即普通查找表
+static uint32_t slice_table[8][256];
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief 生成查找表和派生表
+ */
+static void build_tables(void) {
+    for (uint32_t b = 0; b < 256; b++) {
+        uint32_t crc = b;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        }
+        slice_table[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (int b = 0; b < 256; b++) {
+            uint32_t prev = slice_table[k - 1][b];
+            slice_table[k][b] = (prev >> 8) ^ slice_table[0][prev & 0xFF];
+        }
+    }
+}
+
+/**
+ * @brief 计算CRC32校验码
+ * 每次处理8字节 (slicing-by-8)，用于大文件的传输校验
+ */
+uint32_t calculate_crc32(uint32_t crc, const uint8_t *data, size_t len) {
+    pthread_once(&table_once, build_tables);
+    crc = ~crc;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        const uint8_t *p = data + i;
+        uint32_t x = crc ^ (uint32_t)(p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+        crc = slice_table[7][x & 0xFF] ^ slice_table[6][(x >> 8) & 0xFF] ^
+              slice_table[5][(x >> 16) & 0xFF] ^ slice_table[4][x >> 24] ^
+              slice_table[3][p[4]] ^ slice_table[2][p[5]] ^
+              slice_table[1][p[6]] ^ slice_table[0][p[7]];
+    }
+    for (; i < len; i++) {
+        crc = (crc >> 8) ^ slice_table[0][(crc ^ data[i]) & 0xFF];
+    }
+    return ~crc;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file crc32.h
+ * @brief CRC32校验算法头文件
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 计算CRC32校验码 (可分段累计)
+ * 使用多项式 0x04C11DB7 (反射形式0xEDB88320)，与zlib的crc32相同
+ * 初始值和结果异或值: 0xFFFFFFFF (在函数内部处理)
+ * @param crc 之前各段的校验码，第一段传0
+ * @param data 数据指针
+ * @param len 数据长度
+ * @return 累计到本段的CRC32校验码
+ */
+uint32_t calculate_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRC32_H
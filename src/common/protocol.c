@@ -328,6 +328,58 @@ protocol_result_t decode_frame(const uint8_t *buffer, size_t buffer_len, protoco
     return PROTOCOL_SUCCESS;
 }
 
+/**
+ * @brief 只解码帧头部的数据表字段，不校验CRC也不复制消息内容
+ */
+protocol_result_t peek_frame_header(const uint8_t *buffer, size_t buffer_len, data_table_t *header) {
+    if (!buffer || !header || buffer_len < 4) {
+        return PROTOCOL_ERROR_INVALID_PARAM;
+    }
+    
+    if (buffer[0] != FRAME_START || buffer[buffer_len - 1] != FRAME_END) {
+        return PROTOCOL_ERROR_FORMAT;
+    }
+    
+    // 只反转义数据表头部 (链路地址2 + 发送方7 + 接收方7 + 版本1 + 操作1 + 对象2)
+    uint8_t head[FRAME_HEADER_SIZE];
+    size_t head_len = 0;
+    size_t pos = 1;
+    
+    while (head_len < FRAME_HEADER_SIZE && pos < buffer_len - 1) {
+        uint8_t byte = buffer[pos++];
+        if (byte == ESCAPE_CHAR) {
+            if (pos >= buffer_len - 1) {
+                return PROTOCOL_ERROR_ESCAPE;
+            }
+            uint8_t next = buffer[pos++];
+            if (next == ESCAPE_START) {
+                byte = FRAME_START;
+            } else if (next == ESCAPE_ESCAPE) {
+                byte = ESCAPE_CHAR;
+            } else {
+                return PROTOCOL_ERROR_ESCAPE;
+            }
+        }
+        head[head_len++] = byte;
+    }
+    
+    // 头部之后至少还要有2字节CRC
+    if (head_len < FRAME_HEADER_SIZE || (buffer_len - 1) - pos < 2) {
+        return PROTOCOL_ERROR_INCOMPLETE;
+    }
+    
+    header->link_addr = head[0] | (head[1] << 8);
+    deserialize_device_id(&head[2], &header->sender);
+    deserialize_device_id(&head[9], &header->receiver);
+    header->protocol_ver = head[16];
+    header->operation = head[17];
+    header->object_id = head[18] | (head[19] << 8);
+    header->content_len = 0;
+    header->content = NULL;
+    
+    return PROTOCOL_SUCCESS;
+}
+
 /**
  * @brief 创建设备标识
  */
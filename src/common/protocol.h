@@ -9,6 +9,10 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // 协议常量定义
 #define PROTOCOL_VERSION    0x10        // 协议版本号
 #define FRAME_START         0xC0        // 帧开始标识
@@ -18,6 +22,7 @@
 #define ESCAPE_ESCAPE       0xDD        // 转义转义字符本身
 
 #define MAX_FRAME_SIZE      2048        // 最大帧长度
+#define FRAME_HEADER_SIZE   20          // 数据表头部长度 (不含消息内容和CRC)
 #define MAX_CONTENT_SIZE    1500        // 最大消息内容长度
 #define MAX_CHANNELS        128         // 最大检测通道数
 #define DEVICE_ID_SIZE      7           // 设备标识长度
@@ -202,6 +207,15 @@ int encode_frame(const protocol_frame_t *frame, uint8_t *buffer, size_t buffer_s
  */
 protocol_result_t decode_frame(const uint8_t *buffer, size_t buffer_len, protocol_frame_t *frame);
 
+/**
+ * @brief 只解析帧的数据表头部 (发送方、接收方、操作类型、对象标识)
+ * @param buffer 完整帧 (含帧开始和结束标识)
+ * @param buffer_len 帧长度
+ * @param header 输出头部，content为NULL，content_len为0
+ * @return 协议处理结果，不校验CRC
+ */
+protocol_result_t peek_frame_header(const uint8_t *buffer, size_t buffer_len, data_table_t *header);
+
 /**
  * @brief 创建设备标识
  * @param admin_code 行政区划代码
@@ -252,4 +266,8 @@ device_time_t get_current_time(void);
  */
 void print_frame_info(const protocol_frame_t *frame);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // PROTOCOL_H
\ No newline at end of file
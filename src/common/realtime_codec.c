@@ -0,0 +1,243 @@
+/**
+ * @file realtime_codec.c
+ * @brief 交通流实时信息的列式批量解码实现
+ */
+
+#include "realtime_codec.h"
+#include "crc16.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define REALTIME_COLUMNS_MIN_CAPACITY 256   // 列集合最小容量
+
+const realtime_column_info_t realtime_column_info[REALTIME_COLUMN_COUNT] = {
+#define REALTIME_COLUMN_INFO(name, type, format) \
+    { #name, offsetof(realtime_columns_t, name), sizeof(type), format },
+    REALTIME_COLUMNS(REALTIME_COLUMN_INFO)
+#undef REALTIME_COLUMN_INFO
+};
+
+/**
+ * @brief 读取小端序16位整数
+ */
+static inline uint16_t get_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief 读取小端序32位整数
+ */
+static inline uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief 获取列的数据指针
+ */
+void *realtime_column_data(const realtime_columns_t *columns, int index) {
+    if (!columns || index < 0 || index >= REALTIME_COLUMN_COUNT) {
+        return NULL;
+    }
+    return *(void * const *)((const uint8_t *)columns + realtime_column_info[index].offset);
+}
+
+/**
+ * @brief 分配列集合
+ */
+int realtime_columns_init(realtime_columns_t *columns, size_t capacity) {
+    if (!columns) {
+        return -1;
+    }
+
+    memset(columns, 0, sizeof(realtime_columns_t));
+    return realtime_columns_reserve(columns, capacity);
+}
+
+/**
+ * @brief 扩展列集合容量
+ */
+int realtime_columns_reserve(realtime_columns_t *columns, size_t capacity) {
+    if (!columns) {
+        return -1;
+    }
+    if (capacity <= columns->capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = columns->capacity ? columns->capacity : REALTIME_COLUMNS_MIN_CAPACITY;
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        void **slot = (void **)((uint8_t *)columns + realtime_column_info[i].offset);
+        void *data = realloc(*slot, new_capacity * realtime_column_info[i].item_size);
+        if (!data) {
+            return -1;
+        }
+        *slot = data;
+    }
+    columns->capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * @brief 释放列集合
+ */
+void realtime_columns_free(realtime_columns_t *columns) {
+    if (!columns) {
+        return;
+    }
+
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        void **slot = (void **)((uint8_t *)columns + realtime_column_info[i].offset);
+        free(*slot);
+        *slot = NULL;
+    }
+    columns->count = 0;
+    columns->capacity = 0;
+}
+
+/**
+ * @brief 把实时信息内容按通道追加到列集合
+ */
+int realtime_decode_content(realtime_columns_t *columns, const device_id_t *sender,
+                            const uint8_t *content, size_t content_len, int64_t received_ns) {
+    if (!columns || !sender || !content || content_len < REALTIME_CONTENT_HEADER_SIZE) {
+        return -1;
+    }
+
+    int channels = content[6];
+    if (content_len < REALTIME_CONTENT_HEADER_SIZE + (size_t)channels * REALTIME_RECORD_SIZE) {
+        return -1;
+    }
+    if (realtime_columns_reserve(columns, columns->count + channels) < 0) {
+        return -1;
+    }
+
+    int64_t timestamp_ms = (int64_t)get_u32(content) * 1000 + get_u16(content + 4);
+    const uint8_t *record = content + REALTIME_CONTENT_HEADER_SIZE;
+    size_t row = columns->count;
+
+    // 列指针取到局部变量：写uint8_t列可能与结构体别名，否则每行都要重新读取列指针
+    int64_t *ts = columns->timestamp_ms + row;
+    int64_t *rx = columns->received_ns + row;
+    uint32_t *admin = columns->admin_code + row;
+    uint16_t *type = columns->device_type + row;
+    uint16_t *id = columns->device_id + row;
+    uint8_t *channel = columns->channel_id + row;
+    uint8_t *count_a = columns->count_a + row;
+    uint8_t *count_b = columns->count_b + row;
+    uint8_t *count_c = columns->count_c + row;
+    uint16_t *occupancy = columns->occupancy + row;
+    uint8_t *speed = columns->speed + row;
+    uint16_t *length = columns->length + row;
+    uint8_t *headway = columns->headway + row;
+    uint8_t *gap = columns->gap + row;
+    uint8_t *stop_count = columns->stop_count + row;
+    uint8_t *stop_duration = columns->stop_duration + row;
+
+    const device_id_t device = *sender;
+
+    for (int i = 0; i < channels; i++, record += REALTIME_RECORD_SIZE) {
+        ts[i] = timestamp_ms;
+        rx[i] = received_ns;
+        admin[i] = device.admin_code;
+        type[i] = device.device_type;
+        id[i] = device.device_id;
+        channel[i] = record[0];
+        count_a[i] = record[1];
+        count_b[i] = record[2];
+        count_c[i] = record[3];
+        occupancy[i] = get_u16(record + 4);
+        speed[i] = record[6];
+        length[i] = get_u16(record + 7);
+        headway[i] = record[9];
+        gap[i] = record[10];
+        stop_count[i] = record[11];
+        stop_duration[i] = record[12];
+    }
+    row += channels;
+
+    columns->count = row;
+    return channels;
+}
+
+/**
+ * @brief 解码一个完整帧并追加实时信息
+ */
+int realtime_decode_frame(realtime_columns_t *columns, const uint8_t *frame,
+                          size_t frame_len, int64_t received_ns) {
+    if (!frame || frame_len < 4 || frame[0] != FRAME_START || frame[frame_len - 1] != FRAME_END) {
+        return -1;
+    }
+
+    // 没有转义字符时直接在原缓冲区上解析
+    const uint8_t *table = frame + 1;
+    size_t table_len = frame_len - 2;
+    uint8_t scratch[MAX_FRAME_SIZE];
+    if (memchr(table, ESCAPE_CHAR, table_len) != NULL) {
+        int len = unescape_data(table, table_len, scratch, sizeof(scratch));
+        if (len < 0) {
+            return -1;
+        }
+        table = scratch;
+        table_len = (size_t)len;
+    }
+
+    if (table_len < FRAME_HEADER_SIZE + 2) {
+        return -1;
+    }
+    if (calculate_crc16(table, table_len - 2) != get_u16(table + table_len - 2)) {
+        return -1;
+    }
+
+    // 只解析实时信息上传，头部字段按固定偏移读取
+    if (get_u16(table + 18) != OBJ_TRAFFIC_REALTIME || table[17] != OP_UPLOAD) {
+        return 0;
+    }
+
+    device_id_t sender;
+    sender.admin_code = table[2] | (table[3] << 8) | ((uint32_t)table[4] << 16);
+    sender.device_type = get_u16(table + 5);
+    sender.device_id = get_u16(table + 7);
+
+    return realtime_decode_content(columns, &sender, table + FRAME_HEADER_SIZE,
+                                   table_len - FRAME_HEADER_SIZE - 2, received_ns);
+}
+
+/**
+ * @brief 解码抓包文件中的全部实时信息
+ */
+int64_t realtime_decode_capture(realtime_columns_t *columns, capture_reader_t *reader,
+                                uint64_t *bad_frames) {
+    if (!columns || !reader) {
+        return -1;
+    }
+
+    int64_t rows = 0;
+    uint64_t bad = 0;
+    int64_t timestamp_ns;
+    const uint8_t *frame;
+    size_t frame_len;
+    int ret;
+
+    while ((ret = capture_reader_next(reader, &timestamp_ns, &frame, &frame_len)) > 0) {
+        int appended = realtime_decode_frame(columns, frame, frame_len, timestamp_ns);
+        if (appended < 0) {
+            // 区分帧损坏与内存不足
+            if (columns->count + 255 > columns->capacity &&
+                realtime_columns_reserve(columns, columns->count + 255) < 0) {
+                return -1;
+            }
+            bad++;
+            continue;
+        }
+        rows += appended;
+    }
+
+    if (bad_frames) {
+        *bad_frames = bad;
+    }
+    return ret < 0 ? -1 : rows;
+}
@@ -0,0 +1,138 @@
+/**
+ * @file realtime_codec.h
+ * @brief 交通流实时信息的列式批量解码
+ *
+ * 实时信息按通道展开为行，每个字段存放在独立的连续数组中 (列式)，
+ * 便于按列扫描和以零拷贝方式导出给分析工具。
+ */
+
+#ifndef REALTIME_CODEC_H
+#define REALTIME_CODEC_H
+
+#include "protocol.h"
+#include "capture.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REALTIME_CONTENT_HEADER_SIZE 7  // 采集时间(6) + 通道数(1)
+#define REALTIME_RECORD_SIZE 19         // 单通道记录长度
+
+/**
+ * @brief 实时信息列定义 X(列名, C类型, 缓冲区协议格式字符)
+ */
+#define REALTIME_COLUMNS(X) \
+    X(timestamp_ms,  int64_t,  "q")  /* 采集时间 (Unix毫秒) */ \
+    X(received_ns,   int64_t,  "q")  /* 接收时间 (Unix纳秒) */ \
+    X(admin_code,    uint32_t, "I")  /* 行政区划代码 */ \
+    X(device_type,   uint16_t, "H")  /* 设备类型 */ \
+    X(device_id,     uint16_t, "H")  /* 设备编号 */ \
+    X(channel_id,    uint8_t,  "B")  /* 检测通道编号 */ \
+    X(count_a,       uint8_t,  "B")  /* A类车流量 */ \
+    X(count_b,       uint8_t,  "B")  /* B类车流量 */ \
+    X(count_c,       uint8_t,  "B")  /* C类车流量 */ \
+    X(occupancy,     uint16_t, "H")  /* 时间占有率 (0.1%) */ \
+    X(speed,         uint8_t,  "B")  /* 车辆速度 (km/h) */ \
+    X(length,        uint16_t, "H")  /* 车辆长度 (0.1m) */ \
+    X(headway,       uint8_t,  "B")  /* 车头时距 (0.1s) */ \
+    X(gap,           uint8_t,  "B")  /* 车间时距 (0.1s) */ \
+    X(stop_count,    uint8_t,  "B")  /* 停车次数 (0.1) */ \
+    X(stop_duration, uint8_t,  "B")  /* 停车时长 (0.1s) */
+
+#define REALTIME_COLUMN_COUNT 16        // 列数
+
+/**
+ * @brief 实时信息列集合
+ */
+typedef struct {
+#define REALTIME_COLUMN_FIELD(name, type, format) type *name;
+    REALTIME_COLUMNS(REALTIME_COLUMN_FIELD)
+#undef REALTIME_COLUMN_FIELD
+    size_t count;               // 行数
+    size_t capacity;            // 各列已分配的行数
+} realtime_columns_t;
+
+/**
+ * @brief 列的元数据，用于按名称通用访问各列
+ */
+typedef struct {
+    const char *name;           // 列名
+    size_t offset;              // 列指针在realtime_columns_t中的偏移
+    size_t item_size;           // 元素大小
+    const char *format;         // 缓冲区协议格式字符
+} realtime_column_info_t;
+
+extern const realtime_column_info_t realtime_column_info[REALTIME_COLUMN_COUNT];
+
+/**
+ * @brief 获取列的数据指针
+ * @param columns 列集合
+ * @param index 列序号 (realtime_column_info中的下标)
+ * @return 列数组首地址
+ */
+void *realtime_column_data(const realtime_columns_t *columns, int index);
+
+/**
+ * @brief 分配列集合
+ * @param columns 列集合指针
+ * @param capacity 初始行数
+ * @return 0成功，-1内存不足
+ */
+int realtime_columns_init(realtime_columns_t *columns, size_t capacity);
+
+/**
+ * @brief 扩展列集合容量 (不足时按倍数增长)
+ * @param columns 列集合指针
+ * @param capacity 所需最小行数
+ * @return 0成功，-1内存不足
+ */
+int realtime_columns_reserve(realtime_columns_t *columns, size_t capacity);
+
+/**
+ * @brief 释放列集合
+ * @param columns 列集合指针
+ */
+void realtime_columns_free(realtime_columns_t *columns);
+
+/**
+ * @brief 把一条实时信息的消息内容按通道追加到列集合
+ * @param columns 列集合 (容量不足时自动扩展)
+ * @param sender 发送方标识
+ * @param content 消息内容
+ * @param content_len 内容长度
+ * @param received_ns 接收时间(Unix纳秒)
+ * @return 追加的行数，-1表示内容格式错误或内存不足
+ */
+int realtime_decode_content(realtime_columns_t *columns, const device_id_t *sender,
+                            const uint8_t *content, size_t content_len, int64_t received_ns);
+
+/**
+ * @brief 解码一个完整帧，是实时信息上传时追加到列集合
+ * 没有转义字符的帧直接在原缓冲区上解析
+ * @param columns 列集合
+ * @param frame 完整帧 (含帧开始和结束标识)
+ * @param frame_len 帧长度
+ * @param received_ns 接收时间(Unix纳秒)
+ * @return 追加的行数 (非实时信息帧为0)，-1表示帧损坏
+ */
+int realtime_decode_frame(realtime_columns_t *columns, const uint8_t *frame,
+                          size_t frame_len, int64_t received_ns);
+
+/**
+ * @brief 解码抓包文件中的全部实时信息
+ * @param columns 列集合
+ * @param reader 已打开的读取器，从当前位置读到文件结束
+ * @param bad_frames 输出损坏的帧数，可为NULL
+ * @return 追加的行数，-1表示内存不足或文件被截断
+ */
+int64_t realtime_decode_capture(realtime_columns_t *columns, capture_reader_t *reader,
+                                uint64_t *bad_frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REALTIME_CODEC_H
@@ -0,0 +1,327 @@
+/**
+ * @file traffic_async.hpp
+ * @brief 基于C++20协程的异步收发封装
+ *
+ * 在traffic_protocol.hpp的sans-IO解码器之上提供：
+ * - 惰性启动、对称转移的task<T>
+ * - 基于poll()的单线程调度器，协程通过co_await等待socket可读/可写
+ * - async_send / async_receive，socket需设置为非阻塞或仅配合本调度器使用
+ */
+
+#ifndef TRAFFIC_ASYNC_HPP
+#define TRAFFIC_ASYNC_HPP
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#include "traffic_protocol.hpp"
+
+namespace traffic {
+
+template <typename T>
+class task;
+
+namespace detail {
+
+/**
+ * @brief 协程结束时恢复等待者，没有等待者时挂起
+ */
+struct final_awaiter {
+    bool await_ready() const noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept {
+        if (handle.promise().continuation) {
+            return handle.promise().continuation;
+        }
+        return std::noop_coroutine();
+    }
+
+    void await_resume() const noexcept {}
+};
+
+struct promise_base {
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    final_awaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct task_promise : promise_base {
+    std::optional<T> value;
+
+    task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U &&result) { value.emplace(std::forward<U>(result)); }
+
+    T result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct task_promise<void> : promise_base {
+    task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief 惰性协程任务，被co_await时才开始执行，结束后直接转回等待者
+ */
+template <typename T = void>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::task_promise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    task() noexcept = default;
+    explicit task(handle_type handle) noexcept : handle_(handle) {}
+    task(task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+
+    task &operator=(task &&other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+
+    task(const task &) = delete;
+    task &operator=(const task &) = delete;
+
+    ~task() { destroy(); }
+
+    bool done() const noexcept { return !handle_ || handle_.done(); }
+    handle_type handle() const noexcept { return handle_; }
+
+    auto operator co_await() && noexcept {
+        struct awaiter {
+            handle_type handle;
+
+            bool await_ready() const noexcept { return !handle || handle.done(); }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                handle.promise().continuation = caller;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        return awaiter{handle_};
+    }
+
+private:
+    void destroy() noexcept {
+        if (handle_) {
+            handle_.destroy();
+            handle_ = {};
+        }
+    }
+
+    handle_type handle_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> task_promise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+}
+
+inline task<void> task_promise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+}
+
+} // namespace detail
+
+/**
+ * @brief 基于poll()的单线程协程调度器
+ */
+class poll_scheduler {
+public:
+    /**
+     * @brief 等待socket事件的awaiter
+     */
+    struct io_awaiter {
+        poll_scheduler *scheduler;
+        int fd;
+        short events;
+
+        bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) {
+            scheduler->waiters_.push_back(waiter{fd, events, handle});
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    io_awaiter readable(int fd) noexcept { return io_awaiter{this, fd, POLLIN}; }
+    io_awaiter writable(int fd) noexcept { return io_awaiter{this, fd, POLLOUT}; }
+
+    /**
+     * @brief 托管并调度一个顶层任务，任务在调度器销毁时释放
+     */
+    void spawn(task<void> t) {
+        ready_.push_back(t.handle());
+        tasks_.push_back(std::move(t));
+    }
+
+    /**
+     * @brief 运行直到所有任务结束或等待超时
+     * @param timeout_ms 单次poll的超时时间，-1为无限等待
+     * @return 0成功，-1 poll出错或超时仍有任务未完成
+     */
+    int run(int timeout_ms = -1) {
+        std::vector<pollfd> fds;
+
+        while (!ready_.empty() || !waiters_.empty()) {
+            while (!ready_.empty()) {
+                std::coroutine_handle<> handle = ready_.front();
+                ready_.pop_front();
+                handle.resume();
+            }
+
+            if (waiters_.empty()) {
+                break;
+            }
+
+            fds.clear();
+            for (const waiter &w : waiters_) {
+                fds.push_back(pollfd{w.fd, w.events, 0});
+            }
+
+            int ret = poll(fds.data(), fds.size(), timeout_ms);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            if (ret == 0) {
+                return -1;
+            }
+
+            // 就绪的等待者移入运行队列，保持等待顺序
+            std::size_t kept = 0;
+            for (std::size_t i = 0; i < fds.size(); i++) {
+                if (fds[i].revents) {
+                    ready_.push_back(waiters_[i].handle);
+                } else {
+                    waiters_[kept++] = waiters_[i];
+                }
+            }
+            waiters_.resize(kept);
+        }
+
+        return 0;
+    }
+
+private:
+    struct waiter {
+        int fd;
+        short events;
+        std::coroutine_handle<> handle;
+    };
+
+    std::deque<std::coroutine_handle<>> ready_;
+    std::vector<waiter> waiters_;
+    std::vector<task<void>> tasks_;
+};
+
+/**
+ * @brief 异步发送全部数据
+ * @return 0成功，-1失败
+ */
+inline task<int> async_send(poll_scheduler &scheduler, int fd, std::span<const uint8_t> data) {
+    std::size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0) {
+            sent += static_cast<std::size_t>(n);
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await scheduler.writable(fd);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            co_return -1;
+        }
+    }
+    co_return 0;
+}
+
+/**
+ * @brief 异步编码并发送一帧类型化消息
+ * @return 0成功，-1失败
+ */
+template <typename M>
+task<int> async_send(poll_scheduler &scheduler, int fd, const frame_header &header, const M &msg) {
+    std::array<uint8_t, MAX_FRAME_SIZE> buffer;
+    std::optional<std::size_t> len = encode(header, msg, buffer);
+    if (!len) {
+        co_return -1;
+    }
+    co_return co_await async_send(scheduler, fd, std::span<const uint8_t>(buffer.data(), *len));
+}
+
+/**
+ * @brief 单个连接的接收状态：接收缓冲区和增量解码器
+ */
+struct frame_reader {
+    std::array<uint8_t, MAX_FRAME_SIZE * 4> buffer{};
+    frame_decoder decoder;
+};
+
+/**
+ * @brief 异步接收下一帧
+ *
+ * 返回的帧视图引用reader内部缓冲区，在下一次对同一reader调用前有效。
+ * @return 解码结果；连接关闭或出错时返回std::nullopt
+ */
+inline task<std::optional<decode_result>> async_receive(poll_scheduler &scheduler, int fd,
+                                                        frame_reader &reader) {
+    for (;;) {
+        if (std::optional<decode_result> result = reader.decoder.next()) {
+            co_return result;
+        }
+
+        ssize_t n = recv(fd, reader.buffer.data(), reader.buffer.size(), MSG_DONTWAIT);
+        if (n > 0) {
+            reader.decoder.feed(std::span<const uint8_t>(reader.buffer.data(), static_cast<std::size_t>(n)));
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await scheduler.readable(fd);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            co_return std::nullopt;
+        }
+    }
+}
+
+} // namespace traffic
+
+#endif // TRAFFIC_ASYNC_HPP
@@ -0,0 +1,881 @@
+/**
+ * @file traffic_protocol.hpp
+ * @brief GB/T 43229-2023 协议的C++20头文件接口
+ *
+ * 在C实现之上提供：
+ * - 编译期生成的CRC16查找表
+ * - 基于std::span的零拷贝帧视图 (无转义字符时直接引用输入缓冲区)
+ * - 按对象标识定义的强类型消息，编解码由编译期字段描述生成，定长布局展开为直线代码
+ * - 不做IO的增量帧解码器，协程封装见traffic_async.hpp
+ * 转义编解码直接调用C接口，不重复实现线路格式。
+ */
+
+#ifndef TRAFFIC_PROTOCOL_HPP
+#define TRAFFIC_PROTOCOL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "../common/protocol.h"
+
+namespace traffic {
+
+// ============================================================================
+// CRC16
+// ============================================================================
+
+namespace detail {
+
+/**
+ * @brief 编译期生成CRC16查找表 (多项式0x8005的反射形式0xA001)
+ */
+constexpr std::array<uint16_t, 256> make_crc16_table() noexcept {
+    std::array<uint16_t, 256> table{};
+    for (unsigned i = 0; i < 256; i++) {
+        uint16_t crc = static_cast<uint16_t>(i);
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? static_cast<uint16_t>((crc >> 1) ^ 0xA001)
+                            : static_cast<uint16_t>(crc >> 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+} // namespace detail
+
+inline constexpr std::array<uint16_t, 256> crc16_table = detail::make_crc16_table();
+
+/**
+ * @brief 计算CRC16校验码，与C接口calculate_crc16结果一致
+ * @param data 数据
+ * @param crc 初始值，分段计算时传入上一段的结果
+ */
+constexpr uint16_t crc16(std::span<const uint8_t> data, uint16_t crc = 0xFFFF) noexcept {
+    for (uint8_t byte : data) {
+        crc = static_cast<uint16_t>((crc >> 8) ^ crc16_table[(crc ^ byte) & 0xFF]);
+    }
+    return crc;
+}
+
+namespace detail {
+inline constexpr uint8_t crc16_check_input[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+}
+static_assert(crc16(detail::crc16_check_input) == 0x4B37, "CRC16 check value mismatch");
+
+// ============================================================================
+// 基本类型
+// ============================================================================
+
+/**
+ * @brief 设备标识，可与C结构体device_id_t互相转换
+ */
+struct device_id {
+    uint32_t admin_code = 0;    // 行政区划代码 (24位有效)
+    uint16_t type = 0;          // 设备类型
+    uint16_t number = 0;        // 设备编号
+
+    constexpr bool operator==(const device_id &) const noexcept = default;
+
+    constexpr device_id_t to_c() const noexcept {
+        return device_id_t{admin_code, type, number};
+    }
+
+    static constexpr device_id from_c(const device_id_t &id) noexcept {
+        return device_id{id.admin_code, id.device_type, id.device_id};
+    }
+};
+
+/**
+ * @brief 协议时间 (秒值 + 毫秒值)
+ */
+struct timestamp {
+    uint32_t seconds = 0;       // 地方时秒值
+    uint16_t milliseconds = 0;  // 地方时毫秒值
+
+    constexpr bool operator==(const timestamp &) const noexcept = default;
+};
+
+// ============================================================================
+// 编译期字段描述
+// ============================================================================
+
+namespace wire {
+
+/**
+ * @brief N字节小端序无符号整数
+ */
+template <typename T, std::size_t N = sizeof(T)>
+struct le {
+    static_assert(std::is_unsigned_v<T> && N <= sizeof(T));
+    using value_type = T;
+    static constexpr std::size_t size = N;
+
+    static constexpr void put(uint8_t *out, T value) noexcept {
+        for (std::size_t i = 0; i < N; i++) {
+            out[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+        }
+    }
+
+    static constexpr T get(const uint8_t *in) noexcept {
+        uint64_t value = 0;
+        for (std::size_t i = 0; i < N; i++) {
+            value |= static_cast<uint64_t>(in[i]) << (8 * i);
+        }
+        return static_cast<T>(value);
+    }
+};
+
+using u8 = le<uint8_t>;
+using u16 = le<uint16_t>;
+using u32 = le<uint32_t>;
+
+/**
+ * @brief 7字节设备标识：行政区划代码(3) + 设备类型(2) + 设备编号(2)
+ */
+struct device {
+    using value_type = device_id;
+    static constexpr std::size_t size = DEVICE_ID_SIZE;
+
+    static constexpr void put(uint8_t *out, const device_id &id) noexcept {
+        le<uint32_t, 3>::put(out, id.admin_code);
+        u16::put(out + 3, id.type);
+        u16::put(out + 5, id.number);
+    }
+
+    static constexpr device_id get(const uint8_t *in) noexcept {
+        return device_id{le<uint32_t, 3>::get(in), u16::get(in + 3), u16::get(in + 5)};
+    }
+};
+
+/**
+ * @brief 6字节时间：秒值(4) + 毫秒值(2)
+ */
+struct time {
+    using value_type = timestamp;
+    static constexpr std::size_t size = 6;
+
+    static constexpr void put(uint8_t *out, const timestamp &ts) noexcept {
+        u32::put(out, ts.seconds);
+        u16::put(out + 4, ts.milliseconds);
+    }
+
+    static constexpr timestamp get(const uint8_t *in) noexcept {
+        return timestamp{u32::get(in), u16::get(in + 4)};
+    }
+};
+
+} // namespace wire
+
+/**
+ * @brief 绑定到成员的字段
+ * @tparam Member 成员指针
+ * @tparam Codec 线路编码 (wire::le等)
+ */
+template <auto Member, typename Codec>
+struct field {
+    static constexpr std::size_t size = Codec::size;
+
+    template <typename T>
+    static constexpr void encode(const T &obj, uint8_t *out) noexcept {
+        Codec::put(out, obj.*Member);
+    }
+
+    template <typename T>
+    static constexpr void decode(T &obj, const uint8_t *in) noexcept {
+        obj.*Member = Codec::get(in);
+    }
+};
+
+/**
+ * @brief 保留字节，编码时填0，解码时跳过
+ */
+template <std::size_t N>
+struct reserved {
+    static constexpr std::size_t size = N;
+
+    template <typename T>
+    static constexpr void encode(const T &, uint8_t *out) noexcept {
+        std::fill_n(out, N, uint8_t{0});
+    }
+
+    template <typename T>
+    static constexpr void decode(T &, const uint8_t *) noexcept {}
+};
+
+/**
+ * @brief 定长布局：各字段偏移在编译期确定，编解码展开为直线代码
+ */
+template <typename... Fields>
+struct layout {
+    static constexpr std::size_t size = (std::size_t{0} + ... + Fields::size);
+
+    static constexpr std::array<std::size_t, sizeof...(Fields)> offsets = [] {
+        std::array<std::size_t, sizeof...(Fields)> result{};
+        std::size_t pos = 0;
+        std::size_t index = 0;
+        ((result[index++] = pos, pos += Fields::size), ...);
+        (void)index;
+        return result;
+    }();
+
+    template <typename T>
+    static constexpr void encode(const T &obj, uint8_t *out) noexcept {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (Fields::encode(obj, out + offsets[I]), ...);
+        }(std::index_sequence_for<Fields...>{});
+        (void)obj;
+        (void)out;
+    }
+
+    template <typename T>
+    static constexpr void decode(T &obj, const uint8_t *in) noexcept {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (Fields::decode(obj, in + offsets[I]), ...);
+        }(std::index_sequence_for<Fields...>{});
+        (void)obj;
+        (void)in;
+    }
+};
+
+/**
+ * @brief 记录类型的定长布局，由各记录类型特化
+ */
+template <typename T>
+struct record_traits;
+
+/**
+ * @brief 消息的对象标识和布局，由各消息类型特化
+ *
+ * 必须提供 object_id 和 header (定长头部布局)；带通道记录的消息另外提供
+ * records (指向record_view成员的成员指针)，线路上在头部之后是1字节记录数和定长记录。
+ */
+template <typename M>
+struct message_traits;
+
+/**
+ * @brief 定长记录序列
+ *
+ * 解码时直接引用负载字节，访问元素时才按布局解码；编码时引用调用方的记录数组。
+ */
+template <typename T>
+class record_view {
+public:
+    using value_type = T;
+    using record_layout = typename record_traits<T>::layout;
+    static constexpr std::size_t record_size = record_layout::size;
+
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        constexpr iterator() noexcept = default;
+        constexpr iterator(const record_view *view, std::size_t index) noexcept
+            : view_(view), index_(index) {}
+
+        constexpr T operator*() const noexcept { return (*view_)[index_]; }
+        constexpr iterator &operator++() noexcept { index_++; return *this; }
+        constexpr iterator operator++(int) noexcept { iterator old = *this; index_++; return old; }
+        constexpr bool operator==(const iterator &other) const noexcept { return index_ == other.index_; }
+
+    private:
+        const record_view *view_ = nullptr;
+        std::size_t index_ = 0;
+    };
+
+    constexpr record_view() noexcept = default;
+
+    /**
+     * @brief 引用调用方的记录数组 (用于编码)
+     */
+    constexpr record_view(std::span<const T> items) noexcept
+        : items_(items.data()), count_(items.size()) {}
+
+    /**
+     * @brief 引用线路上的记录字节 (用于解码)
+     */
+    static constexpr record_view from_wire(const uint8_t *bytes, std::size_t count) noexcept {
+        record_view view;
+        view.bytes_ = bytes;
+        view.count_ = count;
+        return view;
+    }
+
+    constexpr std::size_t size() const noexcept { return count_; }
+    constexpr bool empty() const noexcept { return count_ == 0; }
+    constexpr iterator begin() const noexcept { return iterator(this, 0); }
+    constexpr iterator end() const noexcept { return iterator(this, count_); }
+
+    constexpr T operator[](std::size_t index) const noexcept {
+        if (items_) {
+            return items_[index];
+        }
+        T record{};
+        record_layout::decode(record, bytes_ + index * record_size);
+        return record;
+    }
+
+    /**
+     * @brief 写出全部记录，线路字节直接复制
+     */
+    constexpr void encode(uint8_t *out) const noexcept {
+        if (!items_) {
+            std::copy_n(bytes_, count_ * record_size, out);
+            return;
+        }
+        for (std::size_t i = 0; i < count_; i++) {
+            record_layout::encode(items_[i], out + i * record_size);
+        }
+    }
+
+private:
+    const uint8_t *bytes_ = nullptr;
+    const T *items_ = nullptr;
+    std::size_t count_ = 0;
+};
+
+/**
+ * @brief 消息是否带通道记录
+ */
+template <typename M>
+concept has_records = requires { message_traits<M>::records; };
+
+/**
+ * @brief 消息编码后的负载长度
+ */
+template <typename M>
+constexpr std::size_t payload_size(const M &msg) noexcept {
+    using traits = message_traits<M>;
+    std::size_t size = traits::header::size;
+    if constexpr (has_records<M>) {
+        const auto &records = msg.*traits::records;
+        size += 1 + records.size() * records.record_size;
+    }
+    (void)msg;
+    return size;
+}
+
+/**
+ * @brief 编码消息负载
+ * @return 写入的字节数，缓冲区不足或记录数超过255时返回std::nullopt
+ */
+template <typename M>
+constexpr std::optional<std::size_t> encode_payload(const M &msg, std::span<uint8_t> out) noexcept {
+    using traits = message_traits<M>;
+    const std::size_t size = payload_size(msg);
+    if (out.size() < size) {
+        return std::nullopt;
+    }
+
+    traits::header::encode(msg, out.data());
+    if constexpr (has_records<M>) {
+        const auto &records = msg.*traits::records;
+        if (records.size() > 0xFF) {
+            return std::nullopt;
+        }
+        out[traits::header::size] = static_cast<uint8_t>(records.size());
+        records.encode(out.data() + traits::header::size + 1);
+    }
+    return size;
+}
+
+/**
+ * @brief 解码消息负载，记录部分引用输入字节
+ * @return 长度不符时返回std::nullopt
+ */
+template <typename M>
+constexpr std::optional<M> decode_payload(std::span<const uint8_t> in) noexcept {
+    using traits = message_traits<M>;
+    if (in.size() < traits::header::size) {
+        return std::nullopt;
+    }
+
+    M msg{};
+    traits::header::decode(msg, in.data());
+    if constexpr (has_records<M>) {
+        using view_type = std::remove_cvref_t<decltype(msg.*traits::records)>;
+        if (in.size() < traits::header::size + 1) {
+            return std::nullopt;
+        }
+        std::size_t count = in[traits::header::size];
+        if (in.size() < traits::header::size + 1 + count * view_type::record_size) {
+            return std::nullopt;
+        }
+        msg.*traits::records = view_type::from_wire(in.data() + traits::header::size + 1, count);
+    }
+    return msg;
+}
+
+// ============================================================================
+// 消息定义
+// ============================================================================
+
+/**
+ * @brief 通信连接 (连接请求、心跳查询及应答，无消息内容)
+ */
+struct communication {};
+
+template <>
+struct message_traits<communication> {
+    static constexpr uint16_t object_id = OBJ_COMMUNICATION;
+    using header = layout<>;
+};
+
+/**
+ * @brief 交通流实时信息的单通道记录 (19字节)
+ */
+struct realtime_channel {
+    uint8_t channel_id = 0;         // 检测通道编号
+    uint8_t count_a = 0;            // A类车流量
+    uint8_t count_b = 0;            // B类车流量
+    uint8_t count_c = 0;            // C类车流量
+    uint16_t occupancy = 0;         // 时间占有率 (0.1%)
+    uint8_t speed = 0;              // 车辆速度 (km/h)
+    uint16_t length = 0;            // 车辆长度 (0.1m)
+    uint8_t headway = 0;            // 车头时距 (0.1s)
+    uint8_t gap = 0;                // 车间时距 (0.1s)
+    uint8_t stop_count = 0;         // 停车次数 (0.1)
+    uint8_t stop_duration = 0;      // 停车时长 (0.1s)
+    uint8_t occupy_samples = 0;     // 车辆占有采集次数
+    uint8_t occupy_info = 0;        // 车辆占有信息
+
+    constexpr bool operator==(const realtime_channel &) const noexcept = default;
+};
+
+template <>
+struct record_traits<realtime_channel> {
+    using layout = traffic::layout<
+        field<&realtime_channel::channel_id, wire::u8>,
+        field<&realtime_channel::count_a, wire::u8>,
+        field<&realtime_channel::count_b, wire::u8>,
+        field<&realtime_channel::count_c, wire::u8>,
+        field<&realtime_channel::occupancy, wire::u16>,
+        field<&realtime_channel::speed, wire::u8>,
+        field<&realtime_channel::length, wire::u16>,
+        field<&realtime_channel::headway, wire::u8>,
+        field<&realtime_channel::gap, wire::u8>,
+        field<&realtime_channel::stop_count, wire::u8>,
+        field<&realtime_channel::stop_duration, wire::u8>,
+        field<&realtime_channel::occupy_samples, wire::u8>,
+        field<&realtime_channel::occupy_info, wire::u8>,
+        reserved<4>>;
+};
+static_assert(record_traits<realtime_channel>::layout::size == 19);
+
+/**
+ * @brief 交通流实时信息
+ */
+struct traffic_realtime {
+    timestamp time;                             // 采集时间
+    record_view<realtime_channel> channels;     // 各通道数据
+};
+
+template <>
+struct message_traits<traffic_realtime> {
+    static constexpr uint16_t object_id = OBJ_TRAFFIC_REALTIME;
+    using header = layout<field<&traffic_realtime::time, wire::time>>;
+    static constexpr auto records = &traffic_realtime::channels;
+};
+
+/**
+ * @brief 交通流统计数据的单通道记录 (20字节)
+ */
+struct stats_channel {
+    uint8_t channel_id = 0;         // 检测通道编号
+    uint16_t count_a = 0;           // A类车总流量
+    uint16_t count_b = 0;           // B类车总流量
+    uint16_t count_c = 0;           // C类车总流量
+    uint16_t occupancy = 0;         // 平均时间占有率 (0.1%)
+    uint8_t speed = 0;              // 平均车辆速度 (km/h)
+    uint16_t length = 0;            // 平均车辆长度 (0.1m)
+    uint8_t headway = 0;            // 平均车头时距 (0.1s)
+    uint8_t gap = 0;                // 平均车间时距 (0.1s)
+    uint8_t stop_count = 0;         // 平均停车次数 (0.1)
+    uint8_t stop_duration = 0;      // 平均停车时长 (0.1s)
+
+    constexpr bool operator==(const stats_channel &) const noexcept = default;
+};
+
+template <>
+struct record_traits<stats_channel> {
+    using layout = traffic::layout<
+        field<&stats_channel::channel_id, wire::u8>,
+        field<&stats_channel::count_a, wire::u16>,
+        field<&stats_channel::count_b, wire::u16>,
+        field<&stats_channel::count_c, wire::u16>,
+        field<&stats_channel::occupancy, wire::u16>,
+        field<&stats_channel::speed, wire::u8>,
+        field<&stats_channel::length, wire::u16>,
+        field<&stats_channel::headway, wire::u8>,
+        field<&stats_channel::gap, wire::u8>,
+        field<&stats_channel::stop_count, wire::u8>,
+        field<&stats_channel::stop_duration, wire::u8>,
+        reserved<4>>;
+};
+static_assert(record_traits<stats_channel>::layout::size == 20);
+
+/**
+ * @brief 交通流统计数据
+ */
+struct traffic_stats {
+    timestamp start;                        // 统计起始时间
+    timestamp end;                          // 统计结束时间
+    record_view<stats_channel> channels;    // 各通道统计
+};
+
+template <>
+struct message_traits<traffic_stats> {
+    static constexpr uint16_t object_id = OBJ_TRAFFIC_STATS;
+    using header = layout<field<&traffic_stats::start, wire::time>,
+                          field<&traffic_stats::end, wire::time>>;
+    static constexpr auto records = &traffic_stats::channels;
+};
+
+/**
+ * @brief 检测器工作状态的单通道记录 (4字节)
+ */
+struct channel_state {
+    uint8_t channel_id = 0;     // 检测通道编号
+    uint8_t status = 0;         // 运行状态 (0:正常 1:异常)
+
+    constexpr bool operator==(const channel_state &) const noexcept = default;
+};
+
+template <>
+struct record_traits<channel_state> {
+    using layout = traffic::layout<
+        field<&channel_state::channel_id, wire::u8>,
+        field<&channel_state::status, wire::u8>,
+        reserved<2>>;
+};
+
+/**
+ * @brief 车辆检测器工作状态
+ */
+struct detector_status {
+    timestamp time;                         // 状态生成时间
+    record_view<channel_state> channels;    // 各通道状态
+};
+
+template <>
+struct message_traits<detector_status> {
+    static constexpr uint16_t object_id = OBJ_DETECTOR_STATUS;
+    using header = layout<field<&detector_status::time, wire::time>>;
+    static constexpr auto records = &detector_status::channels;
+};
+
+// ============================================================================
+// 帧
+// ============================================================================
+
+/**
+ * @brief 数据表头部
+ */
+struct frame_header {
+    uint16_t link_addr = 0;                 // 链路地址
+    device_id sender;                       // 发送方标识
+    device_id receiver;                     // 接收方标识
+    uint8_t version = PROTOCOL_VERSION;     // 协议版本
+    uint8_t operation = 0;                  // 操作类型
+    uint16_t object_id = 0;                 // 对象标识
+};
+
+using frame_header_layout = layout<
+    field<&frame_header::link_addr, wire::u16>,
+    field<&frame_header::sender, wire::device>,
+    field<&frame_header::receiver, wire::device>,
+    field<&frame_header::version, wire::u8>,
+    field<&frame_header::operation, wire::u8>,
+    field<&frame_header::object_id, wire::u16>>;
+static_assert(frame_header_layout::size == FRAME_HEADER_SIZE);
+
+/**
+ * @brief 构造指定消息类型的帧头部
+ */
+template <typename M>
+constexpr frame_header make_header(const device_id &sender, const device_id &receiver,
+                                   uint8_t operation) noexcept {
+    frame_header header;
+    header.sender = sender;
+    header.receiver = receiver;
+    header.operation = operation;
+    header.object_id = message_traits<M>::object_id;
+    return header;
+}
+
+/**
+ * @brief 解码后的帧视图，payload引用输入缓冲区或解码暂存区，不拥有内存
+ */
+struct frame_view {
+    frame_header header;
+    std::span<const uint8_t> payload;
+
+    /**
+     * @brief 按消息类型解码负载，对象标识不符时返回std::nullopt
+     */
+    template <typename M>
+    std::optional<M> as() const noexcept {
+        if (header.object_id != message_traits<M>::object_id) {
+            return std::nullopt;
+        }
+        return decode_payload<M>(payload);
+    }
+
+    /**
+     * @brief 转换为C结构体，content指向payload，不能对结果调用free_frame
+     */
+    protocol_frame_t to_c() const noexcept {
+        protocol_frame_t frame{};
+        frame.frame_start = FRAME_START;
+        frame.frame_end = FRAME_END;
+        frame.data.link_addr = header.link_addr;
+        frame.data.sender = header.sender.to_c();
+        frame.data.receiver = header.receiver.to_c();
+        frame.data.protocol_ver = header.version;
+        frame.data.operation = header.operation;
+        frame.data.object_id = header.object_id;
+        frame.data.content_len = static_cast<uint16_t>(payload.size());
+        frame.data.content = payload.empty() ? nullptr : const_cast<uint8_t *>(payload.data());
+        return frame;
+    }
+
+    /**
+     * @brief 引用C结构体的内容构造视图
+     */
+    static frame_view from_c(const protocol_frame_t &frame) noexcept {
+        frame_view view;
+        view.header.link_addr = frame.data.link_addr;
+        view.header.sender = device_id::from_c(frame.data.sender);
+        view.header.receiver = device_id::from_c(frame.data.receiver);
+        view.header.version = frame.data.protocol_ver;
+        view.header.operation = frame.data.operation;
+        view.header.object_id = frame.data.object_id;
+        if (frame.data.content && frame.data.content_len > 0) {
+            view.payload = std::span<const uint8_t>(frame.data.content, frame.data.content_len);
+        }
+        return view;
+    }
+};
+
+/**
+ * @brief 帧解码结果
+ */
+struct decode_result {
+    protocol_result_t status = PROTOCOL_ERROR_INCOMPLETE;
+    frame_view frame;
+
+    explicit operator bool() const noexcept { return status == PROTOCOL_SUCCESS; }
+};
+
+/**
+ * @brief 解码一个完整帧 (含帧开始和结束标识)
+ *
+ * 数据中没有转义字符时视图直接引用输入，否则经C接口unescape_data反转义到scratch。
+ * @param wire 完整帧
+ * @param scratch 反转义暂存区，长度至少为帧长度
+ */
+inline decode_result decode(std::span<const uint8_t> wire, std::span<uint8_t> scratch) noexcept {
+    if (wire.size() < 4 || wire.front() != FRAME_START || wire.back() != FRAME_END) {
+        return {PROTOCOL_ERROR_FORMAT, {}};
+    }
+
+    std::span<const uint8_t> body = wire.subspan(1, wire.size() - 2);
+    std::span<const uint8_t> table = body;
+    if (std::memchr(body.data(), ESCAPE_CHAR, body.size()) != nullptr) {
+        int len = unescape_data(body.data(), body.size(), scratch.data(), scratch.size());
+        if (len < 0) {
+            return {PROTOCOL_ERROR_ESCAPE, {}};
+        }
+        table = std::span<const uint8_t>(scratch.data(), static_cast<std::size_t>(len));
+    }
+
+    if (table.size() < FRAME_HEADER_SIZE + 2) {
+        return {PROTOCOL_ERROR_INCOMPLETE, {}};
+    }
+
+    const std::size_t crc_pos = table.size() - 2;
+    if (crc16(table.first(crc_pos)) != wire::u16::get(table.data() + crc_pos)) {
+        return {PROTOCOL_ERROR_CRC, {}};
+    }
+
+    decode_result result;
+    result.status = PROTOCOL_SUCCESS;
+    frame_header_layout::decode(result.frame.header, table.data());
+    result.frame.payload = table.subspan(FRAME_HEADER_SIZE, crc_pos - FRAME_HEADER_SIZE);
+    return result;
+}
+
+namespace detail {
+
+/**
+ * @brief 为已写好头部和负载的数据表追加CRC，经C接口escape_data转义并加帧标识
+ */
+inline std::optional<std::size_t> finish_frame(uint8_t *table, std::size_t len,
+                                               std::span<uint8_t> out) noexcept {
+    wire::u16::put(table + len, crc16(std::span<const uint8_t>(table, len)));
+    len += 2;
+
+    if (out.size() < 2) {
+        return std::nullopt;
+    }
+    int escaped = escape_data(table, len, out.data() + 1, out.size() - 2);
+    if (escaped < 0) {
+        return std::nullopt;
+    }
+    out[0] = FRAME_START;
+    out[static_cast<std::size_t>(escaped) + 1] = FRAME_END;
+    return static_cast<std::size_t>(escaped) + 2;
+}
+
+} // namespace detail
+
+/**
+ * @brief 编码一帧类型化消息，对象标识由消息类型决定
+ * @return 帧长度，缓冲区不足时返回std::nullopt
+ */
+template <typename M>
+std::optional<std::size_t> encode(const frame_header &header, const M &msg,
+                                  std::span<uint8_t> out) noexcept {
+    std::array<uint8_t, MAX_FRAME_SIZE> table;
+    const std::size_t size = payload_size(msg);
+    if (FRAME_HEADER_SIZE + size + 2 > table.size()) {
+        return std::nullopt;
+    }
+
+    frame_header typed = header;
+    typed.object_id = message_traits<M>::object_id;
+    frame_header_layout::encode(typed, table.data());
+    if (!encode_payload(msg, std::span<uint8_t>(table).subspan(FRAME_HEADER_SIZE, size))) {
+        return std::nullopt;
+    }
+    return detail::finish_frame(table.data(), FRAME_HEADER_SIZE + size, out);
+}
+
+/**
+ * @brief 编码一帧未定义类型的原始负载
+ */
+inline std::optional<std::size_t> encode_raw(const frame_header &header,
+                                             std::span<const uint8_t> payload,
+                                             std::span<uint8_t> out) noexcept {
+    std::array<uint8_t, MAX_FRAME_SIZE> table;
+    if (FRAME_HEADER_SIZE + payload.size() + 2 > table.size()) {
+        return std::nullopt;
+    }
+
+    frame_header_layout::encode(header, table.data());
+    std::copy(payload.begin(), payload.end(), table.begin() + FRAME_HEADER_SIZE);
+    return detail::finish_frame(table.data(), FRAME_HEADER_SIZE + payload.size(), out);
+}
+
+// ============================================================================
+// 增量帧解码器 (sans-IO)
+// ============================================================================
+
+/**
+ * @brief 不做IO的增量帧解码器
+ *
+ * 调用方把收到的数据交给feed()，再反复调用next()取帧。完整落在输入中的帧直接
+ * 引用输入缓冲区；只有输入末尾的半帧被复制到内部暂存区。返回的帧视图在下一次
+ * 调用feed()或next()之前有效。
+ */
+class frame_decoder {
+public:
+    /**
+     * @brief 提供新收到的数据，调用前必须已取完上一批数据中的帧
+     */
+    void feed(std::span<const uint8_t> data) noexcept { input_ = data; }
+
+    /**
+     * @brief 取下一帧
+     * @return 解码结果 (校验失败的帧也会返回，status为错误码)；输入耗尽时返回std::nullopt
+     */
+    std::optional<decode_result> next() noexcept {
+        if (stash_len_ > 0) {
+            const uint8_t *end = find(input_, FRAME_END);
+            std::size_t take = end ? static_cast<std::size_t>(end - input_.data()) + 1 : input_.size();
+
+            if (stash_len_ == 1 && end == input_.data()) {
+                // 暂存的0xC0是上一帧残留的结束标识
+                stash_len_ = 0;
+            } else if (stash_len_ + take > stash_.size()) {
+                // 超长无结束标识，丢弃暂存区重新同步
+                stash_len_ = 0;
+            } else {
+                std::copy_n(input_.data(), take, stash_.data() + stash_len_);
+                stash_len_ += take;
+                input_ = input_.subspan(take);
+                if (!end) {
+                    return std::nullopt;
+                }
+                std::size_t len = stash_len_;
+                stash_len_ = 0;
+                return decode(std::span<const uint8_t>(stash_.data(), len), scratch_);
+            }
+        }
+
+        while (!input_.empty()) {
+            const uint8_t *start = find(input_, FRAME_START);
+            if (!start) {
+                input_ = {};
+                return std::nullopt;
+            }
+            input_ = input_.subspan(static_cast<std::size_t>(start - input_.data()));
+
+            const uint8_t *end = find(input_.subspan(1), FRAME_END);
+            if (!end) {
+                // 半帧暂存，等待后续数据
+                if (input_.size() <= stash_.size()) {
+                    std::copy(input_.begin(), input_.end(), stash_.begin());
+                    stash_len_ = input_.size();
+                }
+                input_ = {};
+                return std::nullopt;
+            }
+
+            std::size_t len = static_cast<std::size_t>(end - input_.data()) + 1;
+            if (len == 2) {
+                // 连续两个0xC0，前一个是上一帧的结束标识
+                input_ = input_.subspan(1);
+                continue;
+            }
+
+            std::span<const uint8_t> frame = input_.first(len);
+            input_ = input_.subspan(len);
+            return decode(frame, scratch_);
+        }
+
+        return std::nullopt;
+    }
+
+    /**
+     * @brief 暂存区中的半帧字节数
+     */
+    std::size_t pending() const noexcept { return stash_len_; }
+
+private:
+    static const uint8_t *find(std::span<const uint8_t> data, uint8_t value) noexcept {
+        if (data.empty()) {
+            return nullptr;
+        }
+        return static_cast<const uint8_t *>(std::memchr(data.data(), value, data.size()));
+    }
+
+    std::span<const uint8_t> input_;
+    std::array<uint8_t, MAX_FRAME_SIZE> stash_{};
+    std::size_t stash_len_ = 0;
+    std::array<uint8_t, MAX_FRAME_SIZE> scratch_{};
+};
+
+} // namespace traffic
+
+#endif // TRAFFIC_PROTOCOL_HPP
@@ -0,0 +1,281 @@
+/**
+ * @file capture_writer.c
+ * @brief 协议帧抓包文件写入实现
+ */
+
+#include "capture_writer.h"
+#include "../utils/logger.h"
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#define CAPTURE_WRITE_BUFFER_SIZE (256 * 1024) // 写入缓冲区大小
+
+/**
+ * @brief 写入小端序整数
+ */
+static void put_le(uint8_t *out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief 创建抓包文件
+ */
+int capture_writer_open(capture_writer_t *writer, const char *path) {
+    if (!writer || !path) {
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(capture_writer_t));
+    writer->fp = fopen(path, "wb");
+    if (!writer->fp) {
+        LOG_ERROR("Failed to create capture file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    setvbuf(writer->fp, NULL, _IOFBF, CAPTURE_WRITE_BUFFER_SIZE);
+
+    if (fwrite(CAPTURE_MAGIC, 1, CAPTURE_MAGIC_SIZE, writer->fp) != CAPTURE_MAGIC_SIZE) {
+        LOG_ERROR("Failed to write capture header to %s", path);
+        fclose(writer->fp);
+        writer->fp = NULL;
+        return -1;
+    }
+    writer->bytes = CAPTURE_MAGIC_SIZE;
+
+    return 0;
+}
+
+/**
+ * @brief 异步请求完成 (在所有者线程中调用)
+ */
+static void capture_io_done(void *ctx, const async_io_request_t *request, int64_t result) {
+    capture_writer_t *writer = (capture_writer_t *)ctx;
+    writer->inflight--;
+    if (request->op == ASYNC_IO_WRITE) {
+        async_io_buffer_put(writer->io, request->buffer_index);
+    } else if (result == 0) {
+        writer->syncs++;
+    }
+    if (result < 0) {
+        if (!writer->failed) {
+            LOG_ERROR("Capture %s failed: %s", request->op == ASYNC_IO_WRITE ? "write" : "fdatasync",
+                      strerror((int)-result));
+        }
+        writer->failed = 1;
+    }
+}
+
+/**
+ * @brief 提交请求，完成时回调capture_io_done
+ */
+static int capture_submit(capture_writer_t *writer, async_io_op_t op, int drain) {
+    async_io_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    request.fd = writer->fd;
+    request.buffer_index = -1;
+    request.drain = drain;
+    request.owner = writer->owner;
+    request.callback = capture_io_done;
+    request.ctx = writer;
+    if (op == ASYNC_IO_WRITE) {
+        request.buf = writer->buffer;
+        request.len = writer->buffer_used;
+        request.offset = writer->file_offset;
+        request.buffer_index = writer->buffer_index;
+    }
+    if (async_io_submit(writer->io, &request) < 0) {
+        return -1;
+    }
+    writer->inflight++;
+    return 0;
+}
+
+/**
+ * @brief 提交正在填充的缓冲区，提交队列满时保留缓冲区
+ * @return 0成功或没有缓冲区，-1提交队列满
+ */
+static int capture_flush_buffer(capture_writer_t *writer) {
+    if (!writer->buffer || writer->buffer_used == 0) {
+        return 0;
+    }
+    if (capture_submit(writer, ASYNC_IO_WRITE, 0) < 0) {
+        return -1;
+    }
+    writer->file_offset += writer->buffer_used;
+    writer->buffer = NULL;
+    writer->buffer_used = 0;
+    writer->buffer_records = 0;
+    return 0;
+}
+
+/**
+ * @brief 提交正在填充的缓冲区
+ * 提交队列满时丢弃缓冲区中的记录 (文件中不留空洞，偏移不前进)
+ */
+static void capture_submit_buffer(capture_writer_t *writer) {
+    if (!writer->buffer || capture_flush_buffer(writer) == 0) {
+        return;
+    }
+    writer->dropped += writer->buffer_records;
+    async_io_buffer_put(writer->io, writer->buffer_index);
+    writer->buffer = NULL;
+    writer->buffer_used = 0;
+    writer->buffer_records = 0;
+}
+
+/**
+ * @brief 以异步模式创建抓包文件
+ */
+int capture_writer_open_async(capture_writer_t *writer, const char *path,
+                              async_io_t *io, async_io_owner_t *owner) {
+    if (!writer || !path || !io || !owner) {
+        return -1;
+    }
+
+    memset(writer, 0, sizeof(capture_writer_t));
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (writer->fd < 0) {
+        LOG_ERROR("Failed to create capture file %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    // 文件头同步写入：提交队列满时丢弃的只能是记录，不能是文件头
+    if (pwrite(writer->fd, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE, 0) != CAPTURE_MAGIC_SIZE) {
+        LOG_ERROR("Failed to write capture header to %s: %s", path, strerror(errno));
+        close(writer->fd);
+        writer->fd = -1;
+        return -1;
+    }
+    writer->io = io;
+    writer->owner = owner;
+    writer->file_offset = CAPTURE_MAGIC_SIZE;
+    writer->bytes = CAPTURE_MAGIC_SIZE;
+    return 0;
+}
+
+/**
+ * @brief 写入器是否已打开
+ */
+int capture_writer_is_open(const capture_writer_t *writer) {
+    return writer && (writer->fp || writer->io);
+}
+
+/**
+ * @brief 异步模式写入一条帧记录
+ */
+static int capture_write_async(capture_writer_t *writer, const uint8_t *header,
+                               const uint8_t *frame, size_t frame_len) {
+    size_t record_len = CAPTURE_RECORD_HEADER_SIZE + frame_len;
+    if (writer->failed || record_len > writer->io->buffer_size) {
+        return -1;
+    }
+
+    if (writer->buffer && writer->buffer_used + record_len > writer->io->buffer_size) {
+        capture_submit_buffer(writer);
+    }
+    if (!writer->buffer) {
+        writer->buffer = async_io_buffer_get(writer->io, &writer->buffer_index);
+        if (!writer->buffer) {
+            // 磁盘跟不上时丢弃记录，不阻塞接收
+            writer->dropped++;
+            return 0;
+        }
+    }
+
+    memcpy(writer->buffer + writer->buffer_used, header, CAPTURE_RECORD_HEADER_SIZE);
+    memcpy(writer->buffer + writer->buffer_used + CAPTURE_RECORD_HEADER_SIZE, frame, frame_len);
+    writer->buffer_used += record_len;
+    writer->buffer_records++;
+    writer->records++;
+    writer->bytes += record_len;
+    return 0;
+}
+
+/**
+ * @brief 写入一条帧记录
+ */
+int capture_writer_write(capture_writer_t *writer, int64_t timestamp_ns,
+                         const uint8_t *frame, size_t frame_len) {
+    if (!capture_writer_is_open(writer) || !frame || frame_len > UINT32_MAX) {
+        return -1;
+    }
+
+    uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+    put_le(header, (uint64_t)timestamp_ns, 8);
+    put_le(header + 8, frame_len, 4);
+
+    if (writer->io) {
+        return capture_write_async(writer, header, frame, frame_len);
+    }
+    if (fwrite(header, 1, sizeof(header), writer->fp) != sizeof(header) ||
+        fwrite(frame, 1, frame_len, writer->fp) != frame_len) {
+        return -1;
+    }
+
+    writer->records++;
+    writer->bytes += sizeof(header) + frame_len;
+    return 0;
+}
+
+/**
+ * @brief 提交部分缓冲区和fdatasync
+ */
+int capture_writer_sync(capture_writer_t *writer) {
+    if (!capture_writer_is_open(writer)) {
+        return -1;
+    }
+    if (!writer->io) {
+        return fflush(writer->fp) == 0 ? 0 : -1;
+    }
+    if (writer->failed) {
+        return -1;
+    }
+
+    if (writer->bytes == writer->synced_bytes) {
+        return 0;
+    }
+
+    // fdatasync等之前提交的写入完成后执行，覆盖到当前为止的全部记录；
+    // 提交队列满时缓冲区和fdatasync都留到下次重试
+    if (capture_flush_buffer(writer) < 0 || capture_submit(writer, ASYNC_IO_FSYNC, 1) < 0) {
+        return -1;
+    }
+    writer->synced_bytes = writer->bytes;
+    return 0;
+}
+
+/**
+ * @brief 刷新并关闭抓包文件
+ */
+void capture_writer_close(capture_writer_t *writer) {
+    if (!writer) {
+        return;
+    }
+    if (writer->fp) {
+        fclose(writer->fp);
+        writer->fp = NULL;
+    }
+    if (writer->io) {
+        if (!writer->failed) {
+            capture_writer_sync(writer);
+        }
+        capture_submit_buffer(writer);
+        // 等待在途请求完成 (完成项投递到所有者，在此处取出)
+        while (writer->inflight > 0) {
+            struct pollfd pfd = { .fd = writer->owner->event_fd, .events = POLLIN };
+            poll(&pfd, 1, 100);
+            async_io_poll(writer->owner);
+        }
+        if (writer->dropped > 0) {
+            LOG_WARN("Capture dropped %llu records (no free I/O buffer)", (unsigned long long)writer->dropped);
+        }
+        close(writer->fd);
+        writer->fd = -1;
+        writer->io = NULL;
+    }
+}
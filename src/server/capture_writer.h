@@ -0,0 +1,103 @@
+/**
+ * @file capture_writer.h
+ * @brief 协议帧抓包文件写入 (文件格式见common/capture.h)
+ *
+ * 写入器有两种模式：同步模式经stdio缓冲写入；异步模式将记录打包到async_io的
+ * 固定缓冲区中，缓冲区写满后提交异步写入，调用方定期提交fdatasync，
+ * 接收线程不会因磁盘写入或fsync阻塞。没有空闲缓冲区时丢弃记录并计数。
+ */
+
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "../common/capture.h"
+#include "../utils/async_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 抓包文件写入器
+ */
+typedef struct {
+    FILE *fp;                   // 文件句柄 (同步模式)
+    uint64_t records;           // 已写入记录数
+    uint64_t bytes;             // 已写入字节数
+
+    // 异步模式 (io为NULL表示同步模式)
+    async_io_t *io;             // 异步I/O实例
+    async_io_owner_t *owner;    // 完成投递的所有者 (调用方的事件循环)
+    int fd;                     // 文件描述符
+    uint8_t *buffer;            // 正在填充的固定缓冲区 (NULL表示没有)
+    int buffer_index;           // 固定缓冲区下标
+    size_t buffer_used;         // 已填充字节数
+    uint64_t buffer_records;    // 缓冲区中的记录数
+    uint64_t file_offset;       // 下一次提交写入的文件偏移
+    uint64_t synced_bytes;      // 上次提交fdatasync时的已写入字节数
+    int inflight;               // 在途请求数
+    int failed;                 // 有写入失败
+    uint64_t dropped;           // 没有空闲缓冲区而丢弃的记录数
+    uint64_t syncs;             // 完成的fdatasync次数
+} capture_writer_t;
+
+/**
+ * @brief 创建抓包文件并写入文件头 (已存在时覆盖)
+ * @param writer 写入器指针
+ * @param path 文件路径
+ * @return 0成功，-1失败
+ */
+int capture_writer_open(capture_writer_t *writer, const char *path);
+
+/**
+ * @brief 以异步模式创建抓包文件 (已存在时覆盖)
+ * @param writer 写入器指针
+ * @param path 文件路径
+ * @param io 异步I/O实例
+ * @param owner 完成投递的所有者，调用方须在同一线程中调用async_io_poll
+ * @return 0成功，-1失败
+ */
+int capture_writer_open_async(capture_writer_t *writer, const char *path,
+                              async_io_t *io, async_io_owner_t *owner);
+
+/**
+ * @brief 写入器是否已打开
+ * @param writer 写入器指针
+ * @return 1已打开，0未打开
+ */
+int capture_writer_is_open(const capture_writer_t *writer);
+
+/**
+ * @brief 写入一条帧记录
+ * @param writer 写入器指针
+ * @param timestamp_ns 接收时间(Unix纳秒)
+ * @param frame 原始帧 (含帧开始和结束标识)
+ * @param frame_len 帧长度
+ * @return 0成功，-1失败
+ */
+int capture_writer_write(capture_writer_t *writer, int64_t timestamp_ns,
+                         const uint8_t *frame, size_t frame_len);
+
+/**
+ * @brief 提交已填充的部分缓冲区并提交fdatasync (异步模式，不等待完成)
+ * 同步模式下只刷新stdio缓冲区。上次同步之后没有新记录时不提交。
+ * 提交队列满时返回-1但不置failed，缓冲区保留，可稍后重试
+ * @param writer 写入器指针
+ * @return 0成功或无需同步，-1失败 (failed置位表示写入器已不可用)
+ */
+int capture_writer_sync(capture_writer_t *writer);
+
+/**
+ * @brief 刷新并关闭抓包文件 (异步模式下等待在途写入和fdatasync完成)
+ * @param writer 写入器指针
+ */
+void capture_writer_close(capture_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_WRITER_H
@@ -0,0 +1,332 @@
+/**
+ * @file device_state.c
+ * @brief 各检测器最新实时信息的多版本表实现
+ */
+
+#include "device_state.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 设备标识哈希
+ */
+static inline size_t device_hash(const device_id_t *device) {
+    uint64_t key = ((uint64_t)device->admin_code << 32) |
+                   ((uint64_t)device->device_type << 16) | device->device_id;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+/**
+ * @brief 比较设备标识
+ */
+static inline int device_equal(const device_id_t *a, const device_id_t *b) {
+    return a->admin_code == b->admin_code && a->device_type == b->device_type &&
+           a->device_id == b->device_id;
+}
+
+/**
+ * @brief 查找设备条目下标 (读者与写入方共用)
+ * @return 条目下标，未找到返回-1
+ */
+static int32_t find_entry(const device_state_t *state, const device_id_t *device) {
+    size_t slot = device_hash(device) & state->index_mask;
+
+    for (;;) {
+        int32_t idx = __atomic_load_n(&state->index[slot], __ATOMIC_ACQUIRE);
+        if (idx < 0) {
+            return -1;
+        }
+        if (device_equal(&state->entries[idx].device, device)) {
+            return idx;
+        }
+        slot = (slot + 1) & state->index_mask;
+    }
+}
+
+/**
+ * @brief 沿版本链找到不晚于纪元的最新版本
+ */
+static const device_version_t *version_at(const device_entry_t *entry, uint64_t epoch) {
+    const device_version_t *version = __atomic_load_n(&entry->latest, __ATOMIC_ACQUIRE);
+    while (version && version->epoch > epoch) {
+        version = __atomic_load_n(&version->older, __ATOMIC_ACQUIRE);
+    }
+    return version;
+}
+
+/**
+ * @brief 释放一条版本链
+ */
+static size_t free_versions(device_version_t *version) {
+    size_t freed = 0;
+    while (version) {
+        device_version_t *older = version->older;
+        free(version);
+        version = older;
+        freed++;
+    }
+    return freed;
+}
+
+/**
+ * @brief 初始化状态表
+ */
+int device_state_init(device_state_t *state, size_t max_devices) {
+    if (!state) {
+        return -1;
+    }
+
+    memset(state, 0, sizeof(device_state_t));
+    state->max_devices = max_devices ? max_devices : DEVICE_STATE_DEFAULT_DEVICES;
+
+    // 哈希表容量为设备上限的两倍以上，保证探测链较短且总有空位
+    size_t capacity = 16;
+    while (capacity < state->max_devices * 2) {
+        capacity <<= 1;
+    }
+    state->index_mask = capacity - 1;
+
+    state->entries = calloc(state->max_devices, sizeof(device_entry_t));
+    state->index = malloc(capacity * sizeof(int32_t));
+    if (!state->entries || !state->index) {
+        LOG_ERROR("Failed to allocate device state table");
+        free(state->entries);
+        free(state->index);
+        state->entries = NULL;
+        state->index = NULL;
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        state->index[i] = -1;
+    }
+
+    // 纪元从1开始，读者槽位用0表示空闲
+    state->epoch = 1;
+    return 0;
+}
+
+/**
+ * @brief 销毁状态表
+ */
+void device_state_destroy(device_state_t *state) {
+    if (!state || !state->entries) {
+        return;
+    }
+
+    for (size_t i = 0; i < state->entry_count; i++) {
+        free_versions(state->entries[i].latest);
+    }
+    free(state->entries);
+    free(state->index);
+    state->entries = NULL;
+    state->index = NULL;
+    state->entry_count = 0;
+}
+
+/**
+ * @brief 发布一个设备的最新实时信息
+ */
+int64_t device_state_publish(device_state_t *state, const device_id_t *sender,
+                             const uint8_t *content, size_t content_len, int64_t received_ns) {
+    if (!state || !sender || !content || content_len < REALTIME_CONTENT_HEADER_SIZE ||
+        content_len > MAX_CONTENT_SIZE ||
+        content_len < REALTIME_CONTENT_HEADER_SIZE + (size_t)content[6] * REALTIME_RECORD_SIZE) {
+        return -1;
+    }
+
+    device_version_t *version = malloc(sizeof(device_version_t) + content_len);
+    if (!version) {
+        return -1;
+    }
+
+    uint64_t epoch = state->epoch + 1;
+    uint32_t seconds = content[0] | (content[1] << 8) | (content[2] << 16) | ((uint32_t)content[3] << 24);
+    version->epoch = epoch;
+    version->timestamp_ms = (int64_t)seconds * 1000 + (content[4] | (content[5] << 8));
+    version->received_ns = received_ns;
+    version->content_len = (uint16_t)content_len;
+    memcpy(version->content, content, content_len);
+
+    int32_t idx = find_entry(state, sender);
+    if (idx >= 0) {
+        device_entry_t *entry = &state->entries[idx];
+        version->older = entry->latest;
+        __atomic_store_n(&entry->latest, version, __ATOMIC_RELEASE);
+    } else {
+        if (state->entry_count >= state->max_devices) {
+            LOG_WARN("Device state table full, dropping device %06X:%04X:%04X",
+                     sender->admin_code, sender->device_type, sender->device_id);
+            free(version);
+            return -1;
+        }
+
+        // 先写好条目再发布下标和条目数，读者看到下标时条目内容已完整
+        idx = (int32_t)state->entry_count;
+        device_entry_t *entry = &state->entries[idx];
+        entry->device = *sender;
+        version->older = NULL;
+        __atomic_store_n(&entry->latest, version, __ATOMIC_RELEASE);
+
+        size_t slot = device_hash(sender) & state->index_mask;
+        while (state->index[slot] >= 0) {
+            slot = (slot + 1) & state->index_mask;
+        }
+        __atomic_store_n(&state->index[slot], idx, __ATOMIC_RELEASE);
+        __atomic_store_n(&state->entry_count, state->entry_count + 1, __ATOMIC_RELEASE);
+    }
+
+    state->live_versions++;
+    // 新版本已挂到链上才推进纪元，固定旧纪元的读者会跳过它
+    __atomic_store_n(&state->epoch, epoch, __ATOMIC_SEQ_CST);
+    return (int64_t)epoch;
+}
+
+/**
+ * @brief 回收旧版本
+ */
+size_t device_state_reclaim(device_state_t *state) {
+    if (!state || !state->entries) {
+        return 0;
+    }
+
+    // 所有读者需要的最早纪元；与读者固定纪元时的复查配对，不会漏看正在固定的读者
+    uint64_t oldest = __atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < DEVICE_STATE_MAX_READERS; i++) {
+        uint64_t pin = __atomic_load_n(&state->pins[i], __ATOMIC_SEQ_CST);
+        if (pin != 0 && pin < oldest) {
+            oldest = pin;
+        }
+    }
+
+    size_t freed = 0;
+    for (size_t i = 0; i < state->entry_count; i++) {
+        // 不晚于oldest的最新版本仍可能被读者使用，只回收比它更旧的版本
+        device_version_t *keep = state->entries[i].latest;
+        while (keep && keep->epoch > oldest) {
+            keep = keep->older;
+        }
+        if (keep && keep->older) {
+            device_version_t *stale = keep->older;
+            __atomic_store_n(&keep->older, NULL, __ATOMIC_RELEASE);
+            freed += free_versions(stale);
+        }
+    }
+
+    state->live_versions -= freed;
+    state->reclaimed_versions += freed;
+    return freed;
+}
+
+/**
+ * @brief 生成快照
+ */
+int device_state_snapshot(device_state_t *state, device_snapshot_t *snapshot) {
+    if (!state || !snapshot) {
+        return -1;
+    }
+
+    uint64_t epoch = __atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST);
+    int slot = -1;
+    for (int i = 0; i < DEVICE_STATE_MAX_READERS; i++) {
+        uint64_t expected = 0;
+        if (__atomic_compare_exchange_n(&state->pins[i], &expected, epoch, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        LOG_WARN("No free device state reader slot");
+        return -1;
+    }
+
+    // 固定后复查纪元：若写入方在此期间推进了纪元，它的回收可能没看到本槽位，改固定新纪元
+    for (;;) {
+        uint64_t current = __atomic_load_n(&state->epoch, __ATOMIC_SEQ_CST);
+        if (current == epoch) {
+            break;
+        }
+        epoch = current;
+        __atomic_store_n(&state->pins[slot], epoch, __ATOMIC_SEQ_CST);
+    }
+
+    snapshot->state = state;
+    snapshot->epoch = epoch;
+    snapshot->slot = slot;
+    snapshot->device_count = __atomic_load_n(&state->entry_count, __ATOMIC_ACQUIRE);
+    return 0;
+}
+
+/**
+ * @brief 释放快照
+ */
+void device_snapshot_release(device_snapshot_t *snapshot) {
+    if (!snapshot || !snapshot->state || snapshot->slot < 0) {
+        return;
+    }
+
+    device_state_t *state = (device_state_t *)snapshot->state;
+    __atomic_store_n(&state->pins[snapshot->slot], 0, __ATOMIC_RELEASE);
+    snapshot->slot = -1;
+    snapshot->state = NULL;
+}
+
+/**
+ * @brief 查找设备在快照纪元时的最新版本
+ */
+const device_version_t *device_snapshot_get(const device_snapshot_t *snapshot, const device_id_t *device) {
+    if (!snapshot || !snapshot->state || !device) {
+        return NULL;
+    }
+
+    int32_t idx = find_entry(snapshot->state, device);
+    if (idx < 0) {
+        return NULL;
+    }
+    return version_at(&snapshot->state->entries[idx], snapshot->epoch);
+}
+
+/**
+ * @brief 按下标遍历快照中的设备
+ */
+const device_version_t *device_snapshot_at(const device_snapshot_t *snapshot, size_t index,
+                                           device_id_t *device) {
+    if (!snapshot || !snapshot->state || index >= snapshot->device_count) {
+        return NULL;
+    }
+
+    const device_entry_t *entry = &snapshot->state->entries[index];
+    if (device) {
+        *device = entry->device;
+    }
+    return version_at(entry, snapshot->epoch);
+}
+
+/**
+ * @brief 把快照中每个设备的最新实时信息解码到列集合
+ */
+int64_t device_snapshot_collect(const device_snapshot_t *snapshot, realtime_columns_t *out) {
+    if (!snapshot || !snapshot->state || !out) {
+        return -1;
+    }
+
+    int64_t rows = 0;
+    for (size_t i = 0; i < snapshot->device_count; i++) {
+        device_id_t device;
+        const device_version_t *version = device_snapshot_at(snapshot, i, &device);
+        if (!version) {
+            continue;
+        }
+        int added = realtime_decode_content(out, &device, version->content, version->content_len,
+                                            version->received_ns);
+        if (added < 0) {
+            return -1;
+        }
+        rows += added;
+    }
+    return rows;
+}
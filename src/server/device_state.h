@@ -0,0 +1,149 @@
+/**
+ * @file device_state.h
+ * @brief 各检测器最新实时信息的多版本表，支持跨设备一致快照
+ *
+ * 每个设备保存一条按新旧排列的版本链，写入方每发布一条实时信息就生成新版本，
+ * 并把全局纪元加一。读者固定(pin)当前纪元即得到快照，代价为O(1)；
+ * 之后按纪元在版本链上找到"不晚于该纪元的最新版本"，所有设备的结果对应同一时刻。
+ * 写入方不加锁，也不等待读者；只有写入方回收版本，不再被任何已固定纪元
+ * 需要的旧版本在读者释放后由写入方回收。
+ * 写入方必须是单线程 (控制机主循环)，读者可以是任意线程。
+ */
+
+#ifndef DEVICE_STATE_H
+#define DEVICE_STATE_H
+
+#include "../common/realtime_codec.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVICE_STATE_MAX_READERS 64     // 同时固定纪元的读者数上限
+#define DEVICE_STATE_DEFAULT_DEVICES 1024 // 默认设备数上限
+
+/**
+ * @brief 一个设备的一条实时信息版本 (发布后不再修改)
+ */
+typedef struct device_version {
+    struct device_version *older; // 更早的版本
+    uint64_t epoch;             // 发布时的纪元
+    int64_t timestamp_ms;       // 采集时间(Unix毫秒)
+    int64_t received_ns;        // 接收时间(Unix纳秒)
+    uint16_t content_len;       // 消息内容长度
+    uint8_t content[];          // 实时信息消息内容 (原样保存)
+} device_version_t;
+
+/**
+ * @brief 设备条目
+ */
+typedef struct {
+    device_id_t device;         // 设备标识
+    device_version_t *latest;   // 最新版本 (写入方发布，读者原子读取)
+} device_entry_t;
+
+/**
+ * @brief 多版本设备状态表
+ */
+typedef struct {
+    uint64_t epoch;             // 最新发布的纪元
+    device_entry_t *entries;    // 设备条目 (按首次出现顺序)
+    size_t entry_count;         // 已发布的条目数
+    size_t max_devices;         // 条目上限
+    int32_t *index;             // 设备标识 -> 条目下标的开放寻址哈希 (-1为空)
+    size_t index_mask;          // 哈希表容量 - 1
+    uint64_t pins[DEVICE_STATE_MAX_READERS]; // 读者固定的纪元 (0表示空闲)
+    uint64_t live_versions;     // 当前保留的版本数
+    uint64_t reclaimed_versions; // 累计回收的版本数
+} device_state_t;
+
+/**
+ * @brief 快照：固定的纪元
+ */
+typedef struct {
+    const device_state_t *state; // 所属状态表
+    uint64_t epoch;             // 固定的纪元
+    int slot;                   // 占用的读者槽位
+    size_t device_count;        // 快照时的设备条目数
+} device_snapshot_t;
+
+/**
+ * @brief 初始化状态表
+ * @param state 状态表指针
+ * @param max_devices 设备数上限，0表示默认值
+ * @return 0成功，-1失败
+ */
+int device_state_init(device_state_t *state, size_t max_devices);
+
+/**
+ * @brief 销毁状态表 (调用前所有快照须已释放)
+ * @param state 状态表指针
+ */
+void device_state_destroy(device_state_t *state);
+
+/**
+ * @brief 发布一个设备的最新实时信息 (仅写入线程)
+ * @param state 状态表指针
+ * @param sender 发送方标识
+ * @param content 实时信息消息内容
+ * @param content_len 内容长度
+ * @param received_ns 接收时间(Unix纳秒)
+ * @return 发布后的纪元，-1表示内容无效、内存不足或设备数已满
+ */
+int64_t device_state_publish(device_state_t *state, const device_id_t *sender,
+                             const uint8_t *content, size_t content_len, int64_t received_ns);
+
+/**
+ * @brief 回收所有快照都不再需要的旧版本 (仅写入线程)
+ * @param state 状态表指针
+ * @return 回收的版本数
+ */
+size_t device_state_reclaim(device_state_t *state);
+
+/**
+ * @brief 生成快照：固定当前纪元，不遍历设备 (任意线程)
+ * @param state 状态表指针
+ * @param snapshot 输出快照
+ * @return 0成功，-1读者槽位已满
+ */
+int device_state_snapshot(device_state_t *state, device_snapshot_t *snapshot);
+
+/**
+ * @brief 释放快照，之后写入方可以回收它固定的旧版本
+ * @param snapshot 快照指针
+ */
+void device_snapshot_release(device_snapshot_t *snapshot);
+
+/**
+ * @brief 查找设备在快照纪元时的最新版本
+ * @param snapshot 快照
+ * @param device 设备标识
+ * @return 版本，设备在该纪元时尚无数据返回NULL
+ */
+const device_version_t *device_snapshot_get(const device_snapshot_t *snapshot, const device_id_t *device);
+
+/**
+ * @brief 按下标遍历快照中的设备
+ * @param snapshot 快照
+ * @param index 设备下标 (0到device_count-1)
+ * @param device 输出设备标识，可为NULL
+ * @return 版本，该设备在快照纪元时尚无数据返回NULL
+ */
+const device_version_t *device_snapshot_at(const device_snapshot_t *snapshot, size_t index,
+                                           device_id_t *device);
+
+/**
+ * @brief 把快照中每个设备的最新实时信息按通道解码到列集合
+ * @param snapshot 快照
+ * @param out 输出列集合 (追加)
+ * @return 追加的行数，-1内存不足
+ */
+int64_t device_snapshot_collect(const device_snapshot_t *snapshot, realtime_columns_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEVICE_STATE_H
@@ -0,0 +1,416 @@
+/**
+ * @file flow_forecast.c
+ * @brief 按通道的短时流量预测实现
+ */
+
+#include "flow_forecast.h"
+#include "../common/realtime_codec.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 设备标识哈希
+ */
+static inline size_t device_hash(const device_id_t *device) {
+    uint64_t key = ((uint64_t)device->admin_code << 32) |
+                   ((uint64_t)device->device_type << 16) | device->device_id;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+/**
+ * @brief 比较设备标识
+ */
+static inline int device_equal(const device_id_t *a, const device_id_t *b) {
+    return a->admin_code == b->admin_code && a->device_type == b->device_type &&
+           a->device_id == b->device_id;
+}
+
+/**
+ * @brief 查找设备条目下标
+ * @return 条目下标，未找到返回-1
+ */
+static int32_t find_device(const flow_forecast_t *forecast, const device_id_t *device) {
+    size_t slot = device_hash(device) & forecast->index_mask;
+
+    for (;;) {
+        int32_t idx = __atomic_load_n(&forecast->index[slot], __ATOMIC_ACQUIRE);
+        if (idx < 0) {
+            return -1;
+        }
+        if (device_equal(&forecast->devices[idx].device, device)) {
+            return idx;
+        }
+        slot = (slot + 1) & forecast->index_mask;
+    }
+}
+
+/**
+ * @brief 为新设备分配连续的通道区间
+ * @return 条目下标，容量不足返回-1
+ */
+static int32_t add_device(flow_forecast_t *forecast, const device_id_t *device, uint32_t span) {
+    if (forecast->device_count >= forecast->max_devices || forecast->used + span > forecast->capacity) {
+        return -1;
+    }
+
+    int32_t idx = (int32_t)forecast->device_count;
+    forecast_device_t *entry = &forecast->devices[idx];
+    entry->device = *device;
+    entry->base = (uint32_t)forecast->used;
+    entry->span = span;
+    entry->last_ms = 0;
+    entry->seq = 0;
+    entry->dropped = 0;
+    forecast->used += span;
+
+    size_t slot = device_hash(device) & forecast->index_mask;
+    while (forecast->index[slot] >= 0) {
+        slot = (slot + 1) & forecast->index_mask;
+    }
+    __atomic_store_n(&forecast->index[slot], idx, __ATOMIC_RELEASE);
+    __atomic_store_n(&forecast->device_count, forecast->device_count + 1, __ATOMIC_RELEASE);
+    return idx;
+}
+
+/**
+ * @brief 容纳通道编号1..max_id所需的区间长度 (向上取整为4的倍数便于向量化)
+ */
+static inline uint32_t span_for_channels(uint32_t max_id) {
+    uint32_t span = (max_id + 3) & ~3u;
+    if (span == 0) {
+        span = 4;
+    }
+    return span < MAX_CHANNELS ? span : MAX_CHANNELS;
+}
+
+/**
+ * @brief 把设备扩展到更长的通道区间 (写入线程，调用方已把设备序号置为奇数)
+ *
+ * 设备区间位于末尾时原地扩展，否则把已学到的状态按通道复制到末尾的新区间，
+ * 旧区间不再使用 (区间只增不减，每个设备至多迁移到MAX_CHANNELS)。
+ * @return 0成功，-1容量不足
+ */
+static int grow_device(flow_forecast_t *forecast, forecast_device_t *device, uint32_t span) {
+    uint32_t old_span = device->span;
+    size_t from = device->base;
+
+    if (from + old_span == forecast->used) {
+        if (from + span > forecast->capacity) {
+            return -1;
+        }
+        forecast->used = from + span;
+        __atomic_store_n(&device->span, span, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    if (forecast->used + span > forecast->capacity) {
+        return -1;
+    }
+    size_t to = forecast->used;
+    size_t bytes = old_span * sizeof(float);
+    float *columns[] = {forecast->level, forecast->trend, forecast->variance, forecast->flow};
+    for (size_t c = 0; c < sizeof(columns) / sizeof(columns[0]); c++) {
+        memcpy(columns[c] + to, columns[c] + from, bytes);
+    }
+    for (size_t slot = 0; slot < FORECAST_TOD_SLOTS; slot++) {
+        float *row = forecast->baseline + slot * forecast->capacity;
+        memcpy(row + to, row + from, bytes);
+    }
+    for (size_t h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+        float *row = forecast->prediction + h * forecast->capacity;
+        memcpy(row + to, row + from, bytes);
+    }
+
+    forecast->used = to + span;
+    __atomic_store_n(&device->base, (uint32_t)to, __ATOMIC_RELAXED);
+    __atomic_store_n(&device->span, span, __ATOMIC_RELAXED);
+    forecast->relocations++;
+    return 0;
+}
+
+/**
+ * @brief 计算采集时间所在的基线时段
+ */
+static inline int tod_slot(const flow_forecast_t *forecast, int64_t timestamp_ms) {
+    int64_t seconds = timestamp_ms / 1000 + forecast->params.tz_offset_s;
+    int64_t of_day = ((seconds % 86400) + 86400) % 86400;
+    return (int)(of_day / (86400 / FORECAST_TOD_SLOTS));
+}
+
+/**
+ * @brief 获取默认模型参数
+ */
+void flow_forecast_default_params(forecast_params_t *params) {
+    if (params) {
+        params->alpha = 0.3f;
+        params->beta = 0.05f;
+        params->gamma = 0.02f;
+        params->trend_damping = 0.99f;
+        params->tz_offset_s = 8 * 3600;
+    }
+}
+
+/**
+ * @brief 初始化预测器
+ */
+int flow_forecast_init(flow_forecast_t *forecast, size_t capacity, const forecast_params_t *params) {
+    if (!forecast) {
+        return -1;
+    }
+
+    memset(forecast, 0, sizeof(flow_forecast_t));
+    if (params) {
+        forecast->params = *params;
+    } else {
+        flow_forecast_default_params(&forecast->params);
+    }
+
+    forecast->capacity = capacity ? capacity : FORECAST_DEFAULT_CHANNELS;
+    forecast->max_devices = forecast->capacity;
+
+    size_t slots = 16;
+    while (slots < forecast->max_devices * 2) {
+        slots <<= 1;
+    }
+    forecast->index_mask = slots - 1;
+
+    size_t n = forecast->capacity;
+    forecast->level = calloc(n, sizeof(float));
+    forecast->trend = calloc(n, sizeof(float));
+    forecast->variance = calloc(n, sizeof(float));
+    forecast->flow = calloc(n, sizeof(float));
+    forecast->baseline = calloc(n * FORECAST_TOD_SLOTS, sizeof(float));
+    forecast->prediction = calloc(n * FORECAST_HORIZON_COUNT, sizeof(float));
+    forecast->devices = calloc(forecast->max_devices, sizeof(forecast_device_t));
+    forecast->index = malloc(slots * sizeof(int32_t));
+
+    if (!forecast->level || !forecast->trend || !forecast->variance || !forecast->flow ||
+        !forecast->baseline || !forecast->prediction || !forecast->devices || !forecast->index) {
+        LOG_ERROR("Failed to allocate flow forecast state");
+        flow_forecast_destroy(forecast);
+        return -1;
+    }
+    for (size_t i = 0; i < slots; i++) {
+        forecast->index[i] = -1;
+    }
+
+    // 趋势外推h秒的等效秒数为 1 + d + d^2 + ... + d^(h-1)
+    float sum = 0.0f, factor = 1.0f;
+    for (int second = 1; second <= FORECAST_HORIZON_COUNT * FORECAST_HORIZON_STEP_S; second++) {
+        sum += factor;
+        factor *= forecast->params.trend_damping;
+        if (second % FORECAST_HORIZON_STEP_S == 0) {
+            forecast->damped_horizon[second / FORECAST_HORIZON_STEP_S - 1] = sum;
+        }
+    }
+
+    LOG_INFO("Flow forecast initialized - %zu channels, horizons up to %d s",
+             forecast->capacity, FORECAST_HORIZON_COUNT * FORECAST_HORIZON_STEP_S);
+    return 0;
+}
+
+/**
+ * @brief 销毁预测器
+ */
+void flow_forecast_destroy(flow_forecast_t *forecast) {
+    if (!forecast) {
+        return;
+    }
+
+    free(forecast->level);
+    free(forecast->trend);
+    free(forecast->variance);
+    free(forecast->flow);
+    free(forecast->baseline);
+    free(forecast->prediction);
+    free(forecast->devices);
+    free(forecast->index);
+    memset(forecast, 0, sizeof(flow_forecast_t));
+}
+
+/**
+ * @brief 用一条实时信息更新设备全部通道的模型
+ */
+int flow_forecast_update(flow_forecast_t *forecast, const device_id_t *sender,
+                         const uint8_t *content, size_t content_len) {
+    if (!forecast || !sender || !content || content_len < REALTIME_CONTENT_HEADER_SIZE) {
+        return -1;
+    }
+
+    int channels = content[6];
+    if (channels == 0 || channels > MAX_CHANNELS ||
+        content_len < REALTIME_CONTENT_HEADER_SIZE + (size_t)channels * REALTIME_RECORD_SIZE) {
+        return -1;
+    }
+
+    // 区间按通道编号而不是通道数分配，编号可以不连续
+    uint32_t max_id = 0;
+    const uint8_t *record = content + REALTIME_CONTENT_HEADER_SIZE;
+    for (int i = 0; i < channels; i++, record += REALTIME_RECORD_SIZE) {
+        if (record[0] > max_id && record[0] <= MAX_CHANNELS) {
+            max_id = record[0];
+        }
+    }
+
+    int32_t idx = find_device(forecast, sender);
+    if (idx < 0) {
+        idx = add_device(forecast, sender, span_for_channels(max_id));
+        if (idx < 0) {
+            LOG_WARN("Flow forecast capacity exhausted, dropping device %06X:%04X:%04X",
+                     sender->admin_code, sender->device_type, sender->device_id);
+            return -1;
+        }
+    }
+    forecast_device_t *device = &forecast->devices[idx];
+
+    uint32_t seconds = content[0] | (content[1] << 8) | (content[2] << 16) | ((uint32_t)content[3] << 24);
+    int64_t timestamp_ms = (int64_t)seconds * 1000 + (content[4] | (content[5] << 8));
+    int64_t gap_ms = timestamp_ms - device->last_ms;
+
+    // 首帧只记录时间，重复或乱序的帧忽略；间隔过长时旧的水平和趋势已无参考价值
+    if (device->last_ms == 0 || gap_ms <= 0) {
+        if (device->last_ms == 0) {
+            __atomic_store_n(&device->last_ms, timestamp_ms, __ATOMIC_RELAXED);
+        }
+        return 0;
+    }
+    int reset = gap_ms > FORECAST_STALE_GAP_MS;
+
+    __atomic_store_n(&device->seq, device->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // 出现超出区间的通道编号时扩展区间，容量不足时超出的通道在下面计为丢弃
+    if (max_id > device->span) {
+        grow_device(forecast, device, span_for_channels(max_id));
+    }
+
+    // 第一阶段：把各通道的计数换算为流量，按通道编号放入连续数组，mask标记本帧出现的通道
+    uint32_t span = device->span;
+    float observed[MAX_CHANNELS];
+    float mask[MAX_CHANNELS];
+    memset(observed, 0, span * sizeof(float));
+    memset(mask, 0, span * sizeof(float));
+
+    float per_hour = 3600000.0f / (float)gap_ms;
+    uint32_t dropped = 0;
+    record = content + REALTIME_CONTENT_HEADER_SIZE;
+    for (int i = 0; i < channels; i++, record += REALTIME_RECORD_SIZE) {
+        uint32_t ch = (uint32_t)record[0] - 1;
+        if (ch < span) {
+            observed[ch] = (float)(record[1] + record[2] + record[3]) * per_hour;
+            mask[ch] = 1.0f;
+        } else {
+            dropped++;
+        }
+    }
+    if (dropped > 0) {
+        if (device->dropped == 0) {
+            LOG_WARN("Flow forecast dropping %u channel(s) of device %06X:%04X:%04X "
+                     "(tracking ids 1-%u, %zu of %zu channels used)", dropped, sender->admin_code,
+                     sender->device_type, sender->device_id, span, forecast->used, forecast->capacity);
+        }
+        device->dropped += dropped;
+        forecast->dropped_channels += dropped;
+    }
+
+    // 第二阶段：对设备全部通道做无分支更新，未出现的通道mask为0保持原值
+    const forecast_params_t *p = &forecast->params;
+    float dt = (float)gap_ms / 1000.0f;
+    float keep = reset ? 0.0f : 1.0f;
+    float *level = forecast->level + device->base;
+    float *trend = forecast->trend + device->base;
+    float *variance = forecast->variance + device->base;
+    float *flow = forecast->flow + device->base;
+    float *baseline = forecast->baseline + (size_t)tod_slot(forecast, timestamp_ms) * forecast->capacity + device->base;
+
+    device->last_ms = timestamp_ms;
+
+    for (uint32_t i = 0; i < span; i++) {
+        float m = mask[i];
+        float y = observed[i];
+        float b = baseline[i];
+        float l0 = level[i] * keep;
+        float t0 = trend[i] * keep;
+
+        float residual = y - b;
+        float expected = l0 + t0 * dt;
+        float l1 = p->alpha * residual + (1.0f - p->alpha) * expected;
+        float t1 = p->beta * (l1 - l0) / dt + (1.0f - p->beta) * t0;
+        float error = residual - expected;
+        float v1 = 0.9f * variance[i] + 0.1f * error * error;
+
+        level[i] += m * (l1 - level[i]);
+        trend[i] += m * (t1 - trend[i]);
+        variance[i] += m * (v1 - variance[i]);
+        flow[i] += m * (y - flow[i]);
+        baseline[i] += m * p->gamma * (y - b);
+    }
+
+    // 发布预测：趋势按衰减后的等效秒数外推
+    for (int h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+        int horizon_s = (h + 1) * FORECAST_HORIZON_STEP_S;
+        float damped = forecast->damped_horizon[h];
+        const float *target = forecast->baseline +
+            (size_t)tod_slot(forecast, timestamp_ms + horizon_s * 1000LL) * forecast->capacity + device->base;
+        float *out = forecast->prediction + (size_t)h * forecast->capacity + device->base;
+
+        for (uint32_t i = 0; i < span; i++) {
+            float value = target[i] + level[i] + trend[i] * damped;
+            out[i] = value > 0.0f ? value : 0.0f;
+        }
+    }
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&device->seq, device->seq + 1, __ATOMIC_RELAXED);
+
+    forecast->updates += span;
+    return (int)span;
+}
+
+/**
+ * @brief 读取一个通道的最新预测
+ */
+int flow_forecast_read(const flow_forecast_t *forecast, const device_id_t *device,
+                       int channel_id, forecast_result_t *result) {
+    if (!forecast || !device || !result) {
+        return -1;
+    }
+
+    int32_t idx = find_device(forecast, device);
+    if (idx < 0) {
+        return -1;
+    }
+    const forecast_device_t *entry = &forecast->devices[idx];
+    if (channel_id < 1 || channel_id > MAX_CHANNELS) {
+        return -1;
+    }
+
+    uint32_t seq;
+    int found;
+    do {
+        // 序号为奇数或读取前后不一致时说明写入方正在更新 (可能正在迁移区间)，重读
+        seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;
+        }
+        found = (uint32_t)channel_id <= __atomic_load_n(&entry->span, __ATOMIC_RELAXED);
+        if (!found) {
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            continue;
+        }
+        size_t column = __atomic_load_n(&entry->base, __ATOMIC_RELAXED) + (size_t)channel_id - 1;
+        result->timestamp_ms = entry->last_ms;
+        result->flow = forecast->flow[column];
+        for (int h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+            result->prediction[h] = forecast->prediction[(size_t)h * forecast->capacity + column];
+        }
+        result->variance = forecast->variance[column];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq);
+
+    return found ? 0 : -1;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file flow_forecast.h
+ * @brief 按通道的短时流量预测
+ *
+ * 每个检测通道维护一个模型：按一天中时段(15分钟)学习的流量基线，
+ * 加上对基线残差做Holt双指数平滑的水平和趋势，预测值为
+ * 目标时刻的基线 + 水平 + 趋势 x 预测时长。
+ * 模型状态按结构数组存放，同一设备的通道连续排列，收到一帧实时信息时
+ * 对该设备的全部通道一次性无分支更新，并发布30/60/90/120秒的预测值。
+ * 设备的区间长度按帧中最大的通道编号分配 (不超过MAX_CHANNELS)，之后出现更大的编号时
+ * 设备迁移到更长的区间；编号无效或容量不足以扩展时该通道的观测被丢弃并计数。
+ * 更新只在控制机主循环中进行，读者通过每设备的序号锁读取一致的预测。
+ */
+
+#ifndef FLOW_FORECAST_H
+#define FLOW_FORECAST_H
+
+#include "../common/protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORECAST_HORIZON_COUNT 4        // 预测时长个数
+#define FORECAST_HORIZON_STEP_S 30      // 预测时长间隔(秒)：30/60/90/120
+#define FORECAST_TOD_SLOTS 96           // 每天的基线时段数 (15分钟)
+#define FORECAST_DEFAULT_CHANNELS 8192  // 默认通道容量
+#define FORECAST_STALE_GAP_MS 600000    // 相邻两帧间隔超过该值时重置水平和趋势(毫秒)
+
+/**
+ * @brief 模型参数
+ */
+typedef struct {
+    float alpha;                // 水平平滑系数
+    float beta;                 // 趋势平滑系数
+    float gamma;                // 时段基线学习率
+    float trend_damping;        // 趋势外推的衰减系数 (每秒)
+    int tz_offset_s;            // 本地时间与UTC的时差(秒)，用于划分时段
+} forecast_params_t;
+
+/**
+ * @brief 一个通道的预测结果
+ */
+typedef struct {
+    int64_t timestamp_ms;       // 最近一次观测的采集时间
+    float flow;                 // 最近一次观测的流量(辆/小时)
+    float prediction[FORECAST_HORIZON_COUNT]; // 各预测时长的流量(辆/小时)
+    float variance;             // 一步预测误差的方差((辆/小时)^2)
+} forecast_result_t;
+
+/**
+ * @brief 设备条目：设备的通道在状态数组中占用连续区间
+ */
+typedef struct {
+    device_id_t device;         // 设备标识
+    uint32_t base;              // 第一个通道在状态数组中的下标
+    uint32_t span;              // 通道数
+    int64_t last_ms;            // 上一帧采集时间 (0表示尚无观测)
+    uint32_t seq;               // 序号锁：奇数表示正在更新
+    uint32_t dropped;           // 该设备被丢弃的通道观测数
+} forecast_device_t;
+
+/**
+ * @brief 预测器 (结构数组布局)
+ */
+typedef struct {
+    forecast_params_t params;   // 模型参数
+    float damped_horizon[FORECAST_HORIZON_COUNT]; // 各预测时长的趋势外推等效秒数
+    size_t capacity;            // 通道容量
+    size_t used;                // 已分配通道数
+
+    float *level;               // 残差水平
+    float *trend;               // 残差趋势(每秒)
+    float *variance;            // 一步预测误差方差
+    float *flow;                // 最近一次观测流量
+    float *baseline;            // 时段基线 [时段][通道]
+    float *prediction;          // 发布的预测 [预测时长][通道]
+
+    forecast_device_t *devices; // 设备条目
+    size_t device_count;        // 设备数
+    size_t max_devices;         // 设备上限
+    int32_t *index;             // 设备标识 -> 条目下标的开放寻址哈希 (-1为空)
+    size_t index_mask;          // 哈希表容量 - 1
+
+    uint64_t updates;           // 累计更新的通道数
+    uint64_t relocations;       // 设备迁移到更长区间的次数
+    uint64_t dropped_channels;  // 累计丢弃的通道观测数 (编号无效或无法扩展区间)
+} flow_forecast_t;
+
+/**
+ * @brief 获取默认模型参数
+ * @param params 输出参数
+ */
+void flow_forecast_default_params(forecast_params_t *params);
+
+/**
+ * @brief 初始化预测器
+ * @param forecast 预测器指针
+ * @param capacity 通道容量，0表示默认值
+ * @param params 模型参数，NULL表示默认值
+ * @return 0成功，-1失败
+ */
+int flow_forecast_init(flow_forecast_t *forecast, size_t capacity, const forecast_params_t *params);
+
+/**
+ * @brief 销毁预测器
+ * @param forecast 预测器指针
+ */
+void flow_forecast_destroy(flow_forecast_t *forecast);
+
+/**
+ * @brief 用一条实时信息更新设备全部通道的模型并发布预测 (仅写入线程)
+ * @param forecast 预测器指针
+ * @param sender 发送方标识
+ * @param content 实时信息消息内容
+ * @param content_len 内容长度
+ * @return 更新的通道数，首帧只记录时间返回0，-1表示内容无效或容量不足
+ */
+int flow_forecast_update(flow_forecast_t *forecast, const device_id_t *sender,
+                         const uint8_t *content, size_t content_len);
+
+/**
+ * @brief 读取一个通道的最新预测 (任意线程)
+ * @param forecast 预测器指针
+ * @param device 设备标识
+ * @param channel_id 通道编号 (从1开始)
+ * @param result 输出预测结果
+ * @return 0成功，-1设备或通道不存在
+ */
+int flow_forecast_read(const flow_forecast_t *forecast, const device_id_t *device,
+                       int channel_id, forecast_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLOW_FORECAST_H
@@ -0,0 +1,316 @@
+/**
+ * @file freshness.c
+ * @brief 按设备和数据对象的数据新鲜度监测实现
+ */
+
+#include "freshness.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief (设备, 数据对象)哈希
+ */
+static inline size_t stream_hash(const device_id_t *device, uint16_t object_id) {
+    uint64_t key = ((uint64_t)device->admin_code << 32) |
+                   ((uint64_t)device->device_type << 16) | device->device_id;
+    key ^= (uint64_t)object_id << 56 | (uint64_t)object_id >> 8;
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+/**
+ * @brief 比较数据流标识
+ */
+static inline int stream_equal(const freshness_stream_t *stream, const device_id_t *device,
+                               uint16_t object_id) {
+    return stream->object_id == object_id && stream->device.admin_code == device->admin_code &&
+           stream->device.device_type == device->device_type &&
+           stream->device.device_id == device->device_id;
+}
+
+/**
+ * @brief 查找数据流下标
+ * @return 下标，未找到返回-1
+ */
+static int32_t find_stream(const freshness_monitor_t *monitor, const device_id_t *device,
+                           uint16_t object_id) {
+    size_t slot = stream_hash(device, object_id) & monitor->index_mask;
+    for (;;) {
+        int32_t idx = monitor->index[slot];
+        if (idx < 0) {
+            return -1;
+        }
+        if (stream_equal(&monitor->streams[idx], device, object_id)) {
+            return idx;
+        }
+        slot = (slot + 1) & monitor->index_mask;
+    }
+}
+
+/**
+ * @brief 交换堆中两个位置并维护数据流的堆位置
+ */
+static inline void heap_swap(freshness_monitor_t *monitor, size_t a, size_t b) {
+    int32_t tmp = monitor->heap[a];
+    monitor->heap[a] = monitor->heap[b];
+    monitor->heap[b] = tmp;
+    monitor->streams[monitor->heap[a]].heap_pos = (int32_t)a;
+    monitor->streams[monitor->heap[b]].heap_pos = (int32_t)b;
+}
+
+/**
+ * @brief 堆元素上浮
+ */
+static void sift_up(freshness_monitor_t *monitor, size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (monitor->streams[monitor->heap[parent]].deadline_ms <=
+            monitor->streams[monitor->heap[pos]].deadline_ms) {
+            break;
+        }
+        heap_swap(monitor, pos, parent);
+        pos = parent;
+    }
+}
+
+/**
+ * @brief 堆元素下沉
+ */
+static void sift_down(freshness_monitor_t *monitor, size_t pos) {
+    for (;;) {
+        size_t left = pos * 2 + 1;
+        size_t smallest = pos;
+        if (left < monitor->heap_size &&
+            monitor->streams[monitor->heap[left]].deadline_ms <
+            monitor->streams[monitor->heap[smallest]].deadline_ms) {
+            smallest = left;
+        }
+        if (left + 1 < monitor->heap_size &&
+            monitor->streams[monitor->heap[left + 1]].deadline_ms <
+            monitor->streams[monitor->heap[smallest]].deadline_ms) {
+            smallest = left + 1;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        heap_swap(monitor, pos, smallest);
+        pos = smallest;
+    }
+}
+
+/**
+ * @brief 设置数据流的截止时间 (不在堆中时加入)
+ */
+static void heap_schedule(freshness_monitor_t *monitor, int32_t idx, int64_t deadline_ms) {
+    freshness_stream_t *stream = &monitor->streams[idx];
+    int64_t previous = stream->deadline_ms;
+    stream->deadline_ms = deadline_ms;
+
+    if (stream->heap_pos < 0) {
+        stream->heap_pos = (int32_t)monitor->heap_size;
+        monitor->heap[monitor->heap_size++] = idx;
+        sift_up(monitor, (size_t)stream->heap_pos);
+    } else if (deadline_ms < previous) {
+        sift_up(monitor, (size_t)stream->heap_pos);
+    } else {
+        sift_down(monitor, (size_t)stream->heap_pos);
+    }
+}
+
+/**
+ * @brief 弹出堆顶
+ */
+static int32_t heap_pop(freshness_monitor_t *monitor) {
+    int32_t top = monitor->heap[0];
+    monitor->heap_size--;
+    if (monitor->heap_size > 0) {
+        heap_swap(monitor, 0, monitor->heap_size);
+        sift_down(monitor, 0);
+    }
+    monitor->streams[top].heap_pos = -1;
+    return top;
+}
+
+/**
+ * @brief 向订阅者分发事件
+ */
+static void dispatch(freshness_monitor_t *monitor, freshness_event_type_t type,
+                     const freshness_stream_t *stream, int64_t now_ms) {
+    freshness_event_t event;
+    event.type = type;
+    event.device = stream->device;
+    event.object_id = stream->object_id;
+    event.last_ms = stream->last_ms;
+    event.period_ms = stream->period_ms;
+    event.now_ms = now_ms;
+    for (int i = 0; i < monitor->subscriber_count; i++) {
+        monitor->subscribers[i].callback(monitor->subscribers[i].ctx, &event);
+    }
+}
+
+/**
+ * @brief 初始化监测器
+ */
+int freshness_init(freshness_monitor_t *monitor, size_t max_streams) {
+    if (!monitor) {
+        return -1;
+    }
+
+    memset(monitor, 0, sizeof(freshness_monitor_t));
+    monitor->max_streams = max_streams ? max_streams : FRESHNESS_DEFAULT_STREAMS;
+
+    size_t capacity = 16;
+    while (capacity < monitor->max_streams * 2) {
+        capacity <<= 1;
+    }
+    monitor->index_mask = capacity - 1;
+
+    monitor->streams = calloc(monitor->max_streams, sizeof(freshness_stream_t));
+    monitor->heap = malloc(monitor->max_streams * sizeof(int32_t));
+    monitor->index = malloc(capacity * sizeof(int32_t));
+    if (!monitor->streams || !monitor->heap || !monitor->index) {
+        LOG_ERROR("Failed to allocate freshness monitor");
+        freshness_destroy(monitor);
+        return -1;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        monitor->index[i] = -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 销毁监测器
+ */
+void freshness_destroy(freshness_monitor_t *monitor) {
+    if (!monitor) {
+        return;
+    }
+    free(monitor->streams);
+    free(monitor->heap);
+    free(monitor->index);
+    monitor->streams = NULL;
+    monitor->heap = NULL;
+    monitor->index = NULL;
+    monitor->stream_count = 0;
+    monitor->heap_size = 0;
+}
+
+/**
+ * @brief 订阅新鲜度事件
+ */
+int freshness_subscribe(freshness_monitor_t *monitor, freshness_event_fn callback, void *ctx) {
+    if (!monitor || !callback || monitor->subscriber_count >= FRESHNESS_MAX_SUBSCRIBERS) {
+        return -1;
+    }
+    monitor->subscribers[monitor->subscriber_count].callback = callback;
+    monitor->subscribers[monitor->subscriber_count].ctx = ctx;
+    monitor->subscriber_count++;
+    return 0;
+}
+
+/**
+ * @brief 记录一次数据到达
+ */
+int freshness_observe(freshness_monitor_t *monitor, const device_id_t *device,
+                      uint16_t object_id, int64_t now_ms) {
+    if (!monitor || !monitor->streams || !device) {
+        return -1;
+    }
+
+    int32_t idx = find_stream(monitor, device, object_id);
+    if (idx < 0) {
+        if (monitor->stream_count >= monitor->max_streams) {
+            LOG_WARN("Freshness monitor full, not tracking %06X:%04X:%04X object 0x%04X",
+                     device->admin_code, device->device_type, device->device_id, object_id);
+            return -1;
+        }
+        idx = (int32_t)monitor->stream_count++;
+        freshness_stream_t *stream = &monitor->streams[idx];
+        memset(stream, 0, sizeof(freshness_stream_t));
+        stream->device = *device;
+        stream->object_id = object_id;
+        stream->last_ms = now_ms;
+        stream->heap_pos = -1;
+
+        size_t slot = stream_hash(device, object_id) & monitor->index_mask;
+        while (monitor->index[slot] >= 0) {
+            slot = (slot + 1) & monitor->index_mask;
+        }
+        monitor->index[slot] = idx;
+        return 0;
+    }
+
+    freshness_stream_t *stream = &monitor->streams[idx];
+    int64_t interval = now_ms - stream->last_ms;
+    if (interval <= 0) {
+        return 0;
+    }
+
+    if (stream->stale) {
+        // 中断期间的间隔不计入周期学习
+        stream->stale = 0;
+        monitor->stale_streams--;
+        monitor->recoveries++;
+        dispatch(monitor, FRESHNESS_EVENT_RECOVERED, stream, now_ms);
+    } else if (stream->intervals > 0 && interval < stream->period_ms / 4) {
+        // 远小于周期的间隔是批量补传或突发发送中的一帧，只推迟截止时间，不参与学习
+    } else if (stream->intervals == 0) {
+        stream->period_ms = interval;
+        stream->deviation_ms = interval / 2;
+        stream->intervals = 1;
+    } else {
+        int64_t error = interval - stream->period_ms;
+        stream->deviation_ms += ((error < 0 ? -error : error) - stream->deviation_ms) / 4;
+        stream->period_ms += error / 8;
+        stream->intervals++;
+    }
+    stream->last_ms = now_ms;
+
+    if (stream->intervals > 0) {
+        int64_t slack = stream->deviation_ms * FRESHNESS_DEVIATION_FACTOR;
+        if (slack < FRESHNESS_MIN_SLACK_MS) {
+            slack = FRESHNESS_MIN_SLACK_MS;
+        }
+        heap_schedule(monitor, idx, now_ms + stream->period_ms + slack);
+    }
+    return 0;
+}
+
+/**
+ * @brief 处理已过截止时间的数据流
+ */
+int freshness_expire(freshness_monitor_t *monitor, int64_t now_ms) {
+    if (!monitor || !monitor->streams) {
+        return 0;
+    }
+
+    int expired = 0;
+    while (monitor->heap_size > 0 && monitor->streams[monitor->heap[0]].deadline_ms <= now_ms) {
+        freshness_stream_t *stream = &monitor->streams[heap_pop(monitor)];
+        stream->stale = 1;
+        monitor->stale_streams++;
+        monitor->stale_events++;
+        expired++;
+        LOG_WARN("Data from %06X:%04X:%04X object 0x%04X stale: none for %lld ms (period %lld ms)",
+                 stream->device.admin_code, stream->device.device_type, stream->device.device_id,
+                 stream->object_id, (long long)(now_ms - stream->last_ms), (long long)stream->period_ms);
+        dispatch(monitor, FRESHNESS_EVENT_STALE, stream, now_ms);
+    }
+    return expired;
+}
+
+/**
+ * @brief 查询数据流状态
+ */
+const freshness_stream_t *freshness_get(const freshness_monitor_t *monitor, const device_id_t *device,
+                                        uint16_t object_id) {
+    if (!monitor || !monitor->streams || !device) {
+        return NULL;
+    }
+    int32_t idx = find_stream(monitor, device, object_id);
+    return idx < 0 ? NULL : &monitor->streams[idx];
+}
@@ -0,0 +1,153 @@
+/**
+ * @file freshness.h
+ * @brief 按设备和数据对象的数据新鲜度监测
+ *
+ * 心跳只说明链路存活，检测器仍应答心跳却停止上传数据时需要单独发现。
+ * 对每个(设备, 数据对象)按到达间隔学习上传周期 (与TCP重传超时估计相同的
+ * 平滑均值和平均偏差)，据此给出下一次应到达的截止时间；全部截止时间放在
+ * 带下标的最小堆中，到达时O(log n)更新，截止时间过去时O(log n)弹出并产生过期事件，
+ * 过期后再次到达产生恢复事件。事件同步分发给订阅者。
+ * 只在控制机主循环中调用，不加锁。
+ */
+
+#ifndef FRESHNESS_H
+#define FRESHNESS_H
+
+#include "../common/protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FRESHNESS_DEFAULT_STREAMS 4096  // 默认监测的(设备, 数据对象)数上限
+#define FRESHNESS_MAX_SUBSCRIBERS 4     // 订阅者数上限
+#define FRESHNESS_MIN_SLACK_MS 2000     // 截止时间在预期周期之外的最小余量(毫秒)
+#define FRESHNESS_DEVIATION_FACTOR 4    // 余量为平均偏差的倍数
+
+/**
+ * @brief 新鲜度事件类型
+ */
+typedef enum {
+    FRESHNESS_EVENT_STALE = 1,          // 超过截止时间未到达
+    FRESHNESS_EVENT_RECOVERED = 2       // 过期后再次到达
+} freshness_event_type_t;
+
+/**
+ * @brief 新鲜度事件
+ */
+typedef struct {
+    freshness_event_type_t type;    // 事件类型
+    device_id_t device;         // 设备标识
+    uint16_t object_id;         // 数据对象标识
+    int64_t last_ms;            // 上一次到达时间
+    int64_t period_ms;          // 学习到的上传周期
+    int64_t now_ms;             // 事件产生时间
+} freshness_event_t;
+
+/**
+ * @brief 事件订阅回调
+ */
+typedef void (*freshness_event_fn)(void *ctx, const freshness_event_t *event);
+
+/**
+ * @brief 一个(设备, 数据对象)的数据流
+ */
+typedef struct {
+    device_id_t device;         // 设备标识
+    uint16_t object_id;         // 数据对象标识
+    uint8_t stale;              // 是否已过期
+    uint32_t intervals;         // 已学习的到达间隔数
+    int64_t last_ms;            // 上一次到达时间
+    int64_t period_ms;          // 平滑的到达间隔
+    int64_t deviation_ms;       // 到达间隔的平均偏差
+    int64_t deadline_ms;        // 截止时间
+    int32_t heap_pos;           // 在堆中的位置 (-1表示不在堆中)
+} freshness_stream_t;
+
+/**
+ * @brief 订阅者
+ */
+typedef struct {
+    freshness_event_fn callback;    // 回调
+    void *ctx;                  // 回调上下文
+} freshness_subscriber_t;
+
+/**
+ * @brief 新鲜度监测器
+ */
+typedef struct {
+    freshness_stream_t *streams; // 数据流 (按首次出现顺序)
+    size_t stream_count;        // 数据流数
+    size_t max_streams;         // 数据流上限
+    int32_t *index;             // (设备, 数据对象) -> 数据流下标的开放寻址哈希 (-1为空)
+    size_t index_mask;          // 哈希表容量 - 1
+    int32_t *heap;              // 按截止时间排列的最小堆 (元素为数据流下标)
+    size_t heap_size;           // 堆中元素数
+
+    freshness_subscriber_t subscribers[FRESHNESS_MAX_SUBSCRIBERS]; // 订阅者
+    int subscriber_count;       // 订阅者数
+
+    size_t stale_streams;       // 当前过期的数据流数
+    uint64_t stale_events;      // 累计过期事件数
+    uint64_t recoveries;        // 累计恢复事件数
+} freshness_monitor_t;
+
+/**
+ * @brief 初始化监测器
+ * @param monitor 监测器指针
+ * @param max_streams 数据流上限，0表示默认值
+ * @return 0成功，-1失败
+ */
+int freshness_init(freshness_monitor_t *monitor, size_t max_streams);
+
+/**
+ * @brief 销毁监测器
+ * @param monitor 监测器指针
+ */
+void freshness_destroy(freshness_monitor_t *monitor);
+
+/**
+ * @brief 订阅新鲜度事件
+ * @param monitor 监测器指针
+ * @param callback 回调函数
+ * @param ctx 回调上下文
+ * @return 0成功，-1订阅者已满
+ */
+int freshness_subscribe(freshness_monitor_t *monitor, freshness_event_fn callback, void *ctx);
+
+/**
+ * @brief 记录一次数据到达，更新学习的周期和截止时间
+ * @param monitor 监测器指针
+ * @param device 设备标识
+ * @param object_id 数据对象标识
+ * @param now_ms 到达时间(单调时钟毫秒)
+ * @return 0成功，-1数据流已满
+ */
+int freshness_observe(freshness_monitor_t *monitor, const device_id_t *device,
+                      uint16_t object_id, int64_t now_ms);
+
+/**
+ * @brief 处理已过截止时间的数据流，逐个产生过期事件
+ * @param monitor 监测器指针
+ * @param now_ms 当前时间(单调时钟毫秒)
+ * @return 本次新过期的数据流数
+ */
+int freshness_expire(freshness_monitor_t *monitor, int64_t now_ms);
+
+/**
+ * @brief 查询数据流状态
+ * @param monitor 监测器指针
+ * @param device 设备标识
+ * @param object_id 数据对象标识
+ * @return 数据流指针，未见过返回NULL
+ */
+const freshness_stream_t *freshness_get(const freshness_monitor_t *monitor, const device_id_t *device,
+                                        uint16_t object_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRESHNESS_H
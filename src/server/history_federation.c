@@ -0,0 +1,844 @@
+/**
+ * @file history_federation.c
+ * @brief 跨节点的历史数据分桶聚合查询实现
+ */
+
+#include "history_federation.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+#include "../utils/socket_utils.h"
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG_HEADER_SIZE 5                   // 负载长度 + 类型
+#define MAX_REQUEST_SIZE 128                // 查询报文负载上限
+#define BUCKET_FIELDS 7                     // 每个桶编码的整数个数 (下标差 + 6项和)
+#define MAX_BATCH_SIZE (20 + FEDERATION_BATCH_BUCKETS * BUCKET_FIELDS * 10) // 一批桶的负载上限
+
+/**
+ * @brief 获取单调时钟微秒数
+ */
+static int64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 向下对齐到桶边界
+ */
+static inline int64_t floor_bucket(int64_t value, int64_t bucket_ms) {
+    int64_t rem = value % bucket_ms;
+    return rem < 0 ? value - rem - bucket_ms : value - rem;
+}
+
+/**
+ * @brief [from, to)跨越的桶数 (跨度可能超过INT64_MAX，按无符号计算)
+ */
+static inline uint64_t bucket_span(int64_t from, int64_t to, int64_t bucket_ms) {
+    return ((uint64_t)to - (uint64_t)from) / (uint64_t)bucket_ms;
+}
+
+/**
+ * @brief 从from起第index个桶的起始时间 (结果在范围内，中间值按无符号计算)
+ */
+static inline int64_t bucket_start(int64_t from, uint64_t index, int64_t bucket_ms) {
+    return (int64_t)((uint64_t)from + index * (uint64_t)bucket_ms);
+}
+
+/**
+ * @brief 写入变长整数 (每字节7位，最高位表示后面还有字节)
+ */
+static void put_varint(uint8_t *p, size_t *pos, uint64_t value) {
+    while (value >= 0x80) {
+        p[(*pos)++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[(*pos)++] = (uint8_t)value;
+}
+
+/**
+ * @brief 读取变长整数
+ * @return 0成功，-1越界或超过10字节
+ */
+static int get_varint(const uint8_t *p, size_t len, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 70 && *pos < len; shift += 7) {
+        uint8_t byte = p[(*pos)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/**
+ * @brief 填写报文头 (负载长度和类型)
+ */
+static void put_header(uint8_t *p, size_t payload_len, federation_msg_t type) {
+    uint32_t len = (uint32_t)payload_len;
+    p[0] = (uint8_t)len;
+    p[1] = (uint8_t)(len >> 8);
+    p[2] = (uint8_t)(len >> 16);
+    p[3] = (uint8_t)(len >> 24);
+    p[4] = (uint8_t)type;
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * @brief 编码查询报文
+ * @return 报文总长度
+ */
+static size_t encode_request(uint8_t *msg, const realtime_query_t *key, int64_t bucket_ms) {
+    uint8_t *p = &msg[MSG_HEADER_SIZE];
+    size_t pos = 0;
+    uint32_t magic = FEDERATION_MAGIC;
+    for (int i = 0; i < 4; i++) {
+        p[pos++] = (uint8_t)(magic >> (8 * i));
+    }
+    put_varint(p, &pos, FEDERATION_VERSION);
+    put_varint(p, &pos, zigzag(key->start_ms));
+    put_varint(p, &pos, zigzag(key->end_ms));
+    put_varint(p, &pos, (uint64_t)bucket_ms);
+    put_varint(p, &pos, key->match_device ? 1 : 0);
+    put_varint(p, &pos, key->device.admin_code);
+    put_varint(p, &pos, key->device.device_type);
+    put_varint(p, &pos, key->device.device_id);
+    put_varint(p, &pos, zigzag(key->channel_id));
+    put_header(msg, pos, FEDERATION_MSG_REQUEST);
+    return MSG_HEADER_SIZE + pos;
+}
+
+/**
+ * @brief 解码查询报文负载
+ * @return 0成功，-1格式错误
+ */
+static int decode_request(const uint8_t *p, size_t len, realtime_query_t *query, int64_t *bucket_ms) {
+    if (len < 4 || get_u32(p) != FEDERATION_MAGIC) {
+        return -1;
+    }
+    size_t pos = 4;
+    uint64_t v[9];
+    for (int i = 0; i < 9; i++) {
+        if (get_varint(p, len, &pos, &v[i]) < 0) {
+            return -1;
+        }
+    }
+    if (v[0] != FEDERATION_VERSION || v[3] == 0 || v[3] > (uint64_t)QUERY_CACHE_MAX_BUCKET_MS || v[5] > 0xFFFFFF ||
+        v[6] > UINT16_MAX || v[7] > UINT16_MAX) {
+        return -1;
+    }
+    realtime_query_init(query);
+    query->start_ms = unzigzag(v[1]);
+    query->end_ms = unzigzag(v[2]);
+    *bucket_ms = (int64_t)v[3];
+    query->match_device = v[4] ? 1 : 0;
+    query->device.admin_code = (uint32_t)v[5];
+    query->device.device_type = (uint16_t)v[6];
+    query->device.device_id = (uint16_t)v[7];
+    query->channel_id = (int)unzigzag(v[8]);
+    return 0;
+}
+
+/**
+ * @brief 编码一批桶：[first, end)中的非空桶
+ * @return 报文总长度，0表示这批桶全部为空
+ */
+static size_t encode_batch(uint8_t *msg, const query_bucket_t *buckets, size_t first, size_t end,
+                           uint64_t *encoded) {
+    size_t n = 0;
+    for (size_t b = first; b < end; b++) {
+        n += buckets[b].rows ? 1 : 0;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    uint8_t *p = &msg[MSG_HEADER_SIZE];
+    size_t pos = 0;
+    put_varint(p, &pos, end);
+    put_varint(p, &pos, n);
+    size_t next = 0;
+    for (size_t b = first; b < end; b++) {
+        const query_bucket_t *bucket = &buckets[b];
+        if (!bucket->rows) {
+            continue;
+        }
+        put_varint(p, &pos, b - next);
+        put_varint(p, &pos, bucket->rows);
+        put_varint(p, &pos, bucket->count_a);
+        put_varint(p, &pos, bucket->count_b);
+        put_varint(p, &pos, bucket->count_c);
+        put_varint(p, &pos, bucket->occupancy_sum);
+        put_varint(p, &pos, bucket->speed_sum);
+        next = b + 1;
+    }
+    put_header(msg, pos, FEDERATION_MSG_BUCKETS);
+    *encoded += n;
+    return MSG_HEADER_SIZE + pos;
+}
+
+/**
+ * @brief 解码一批桶，out非NULL时累加到out中
+ * @param complete 该节点已完整的桶下标上界，成功时更新为这批的上界
+ * @param rows 累加这批的行数
+ * @return 0成功，-1格式错误 (下标越界或不递增)
+ */
+static int decode_batch(const uint8_t *p, size_t len, size_t count, size_t *complete,
+                        query_bucket_t *out, uint64_t *rows) {
+    size_t pos = 0;
+    uint64_t end;
+    uint64_t n;
+    if (get_varint(p, len, &pos, &end) < 0 || get_varint(p, len, &pos, &n) < 0 ||
+        end > count || end < *complete || n > FEDERATION_BATCH_BUCKETS) {
+        return -1;
+    }
+
+    // 下标差相对于上一个桶之后的位置，第一个桶为绝对下标且不能早于之前批次的上界
+    uint64_t next = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t v[BUCKET_FIELDS];
+        for (int f = 0; f < BUCKET_FIELDS; f++) {
+            if (get_varint(p, len, &pos, &v[f]) < 0) {
+                return -1;
+            }
+        }
+        if (v[0] >= end - next || (i == 0 && v[0] < *complete)) {
+            return -1;
+        }
+        uint64_t index = next + v[0];
+        next = index + 1;
+        if (out) {
+            query_bucket_t *bucket = &out[index];
+            bucket->rows += v[1];
+            bucket->count_a += v[2];
+            bucket->count_b += v[3];
+            bucket->count_c += v[4];
+            bucket->occupancy_sum += v[5];
+            bucket->speed_sum += v[6];
+            *rows += v[1];
+        }
+    }
+    if (pos != len) {
+        return -1;
+    }
+    if (out) {
+        *complete = (size_t)end;
+    }
+    return 0;
+}
+
+/**
+ * @brief 关闭Nagle算法 (报文小且需要立即发出)
+ */
+static void set_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * @brief 阻塞读取指定字节数 (受SO_RCVTIMEO限制)
+ */
+static int read_full(int fd, uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = recv(fd, buf + done, len - done, 0);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 阻塞发送全部字节 (受SO_SNDTIMEO限制，对端关闭时不产生SIGPIPE)
+ */
+static int send_full(int fd, const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = send(fd, buf + done, len - done, MSG_NOSIGNAL);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 处理一个连接上的一次查询：本地聚合后分批发回非空桶
+ * @param buckets 桶缓冲区 (QUERY_CACHE_MAX_BUCKETS个)
+ * @param msg 报文缓冲区 (MAX_BATCH_SIZE + 报文头)
+ */
+static void serve_connection(federation_server_t *server, int fd, query_bucket_t *buckets, uint8_t *msg) {
+    // 协调方停止读取或发送一半时不长期占用服务线程
+    struct timeval timeout = {FEDERATION_DEFAULT_TIMEOUT_MS / 1000, (FEDERATION_DEFAULT_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    set_nodelay(fd);
+
+    uint8_t header[MSG_HEADER_SIZE];
+    uint8_t request[MAX_REQUEST_SIZE];
+    if (read_full(fd, header, sizeof(header)) < 0) {
+        return;
+    }
+    __atomic_add_fetch(&server->requests, 1, __ATOMIC_RELAXED);
+    uint32_t len = get_u32(header);
+    realtime_query_t query;
+    int64_t bucket_ms = 0;
+    int64_t count = -1;
+    if (header[4] == FEDERATION_MSG_REQUEST && len <= sizeof(request) && read_full(fd, request, len) == 0 &&
+        decode_request(request, len, &query, &bucket_ms) == 0) {
+        count = query_cache_aggregate(server->cache, &query, bucket_ms, buckets, QUERY_CACHE_MAX_BUCKETS);
+    }
+    if (count < 0) {
+        __atomic_add_fetch(&server->failed, 1, __ATOMIC_RELAXED);
+        put_header(msg, 0, FEDERATION_MSG_ERROR);
+        send_full(fd, msg, MSG_HEADER_SIZE);
+        return;
+    }
+
+    uint64_t encoded = 0;
+    uint64_t sent = 0;
+    for (size_t first = 0; first < (size_t)count; first += FEDERATION_BATCH_BUCKETS) {
+        size_t end = first + FEDERATION_BATCH_BUCKETS < (size_t)count ? first + FEDERATION_BATCH_BUCKETS
+                                                                      : (size_t)count;
+        size_t msg_len = encode_batch(msg, buckets, first, end, &encoded);
+        if (msg_len && send_full(fd, msg, msg_len) < 0) {
+            __atomic_add_fetch(&server->failed, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        sent += msg_len;
+    }
+    size_t pos = 0;
+    put_varint(&msg[MSG_HEADER_SIZE], &pos, (uint64_t)count);
+    put_header(msg, pos, FEDERATION_MSG_END);
+    if (send_full(fd, msg, MSG_HEADER_SIZE + pos) < 0) {
+        __atomic_add_fetch(&server->failed, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    __atomic_add_fetch(&server->buckets_sent, encoded, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&server->bytes_sent, sent + MSG_HEADER_SIZE + pos, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 服务线程：接受连接并逐个处理，收到停止通知后退出
+ */
+static void *server_thread(void *arg) {
+    federation_server_t *server = (federation_server_t *)arg;
+    query_bucket_t *buckets = malloc(QUERY_CACHE_MAX_BUCKETS * sizeof(query_bucket_t));
+    uint8_t *msg = malloc(MSG_HEADER_SIZE + MAX_BATCH_SIZE);
+    if (!buckets || !msg) {
+        LOG_ERROR("Failed to allocate federation query buffers");
+        free(buckets);
+        free(msg);
+        return NULL;
+    }
+
+    struct pollfd fds[2] = {{server->listen_fd, POLLIN, 0}, {server->stop_fd, POLLIN, 0}};
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        // 监听socket为非阻塞，多个线程同时被唤醒时只有一个取到连接
+        int fd = accept(server->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        serve_connection(server, fd, buckets, msg);
+        close(fd);
+    }
+    free(buckets);
+    free(msg);
+    return NULL;
+}
+
+/**
+ * @brief 启动查询服务
+ */
+int federation_server_start(federation_server_t *server, query_cache_t *cache, int port, int threads) {
+    if (!server || !cache || port < 0 || port > 65535 || threads < 0) {
+        return -1;
+    }
+
+    memset(server, 0, sizeof(federation_server_t));
+    server->cache = cache;
+    server->listen_fd = create_tcp_server(port);
+    server->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    if (server->listen_fd < 0 || server->stop_fd < 0 || set_nonblocking(server->listen_fd) < 0 ||
+        getsockname(server->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        LOG_ERROR("Failed to listen for federated queries on port %d", port);
+        if (server->listen_fd >= 0) {
+            close(server->listen_fd);
+        }
+        if (server->stop_fd >= 0) {
+            close(server->stop_fd);
+        }
+        server->listen_fd = server->stop_fd = -1;
+        return -1;
+    }
+    server->port = ntohs(addr.sin_port);
+
+    if (threads == 0) {
+        threads = FEDERATION_DEFAULT_THREADS;
+    }
+    if (threads > FEDERATION_MAX_THREADS) {
+        threads = FEDERATION_MAX_THREADS;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&server->threads[t], NULL, server_thread, server) != 0) {
+            LOG_WARN("Started only %d of %d federation query threads", t, threads);
+            break;
+        }
+        server->thread_count++;
+    }
+    if (server->thread_count == 0) {
+        close(server->listen_fd);
+        close(server->stop_fd);
+        server->listen_fd = server->stop_fd = -1;
+        return -1;
+    }
+
+    LOG_INFO("Federated query server listening on port %d (%d threads)", server->port, server->thread_count);
+    return 0;
+}
+
+/**
+ * @brief 停止查询服务
+ */
+void federation_server_stop(federation_server_t *server) {
+    if (!server || server->listen_fd < 0 || server->thread_count == 0) {
+        return;
+    }
+
+    // 计数保持非零，所有线程都能看到停止通知
+    uint64_t one = 1;
+    if (write(server->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+        LOG_WARN("Failed to notify federation query threads");
+    }
+    for (int t = 0; t < server->thread_count; t++) {
+        pthread_join(server->threads[t], NULL);
+    }
+    server->thread_count = 0;
+    close(server->listen_fd);
+    close(server->stop_fd);
+    server->listen_fd = server->stop_fd = -1;
+}
+
+/**
+ * @brief 导出查询服务指标
+ */
+void federation_server_export_metrics(federation_server_t *server) {
+    if (!server) {
+        return;
+    }
+    metrics_gauge_set("traffic_federation_server_requests_total", NULL,
+                      (double)__atomic_load_n(&server->requests, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_server_failed_total", NULL,
+                      (double)__atomic_load_n(&server->failed, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_server_buckets_sent_total", NULL,
+                      (double)__atomic_load_n(&server->buckets_sent, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_server_bytes_sent_total", NULL,
+                      (double)__atomic_load_n(&server->bytes_sent, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief 初始化查询协调
+ */
+int federation_init(federation_t *fed, const federation_node_t *nodes, size_t node_count, int timeout_ms) {
+    if (!fed || (!nodes && node_count) || node_count > FEDERATION_MAX_NODES || timeout_ms < 0) {
+        return -1;
+    }
+
+    memset(fed, 0, sizeof(federation_t));
+    for (size_t i = 0; i < node_count; i++) {
+        if (nodes[i].port <= 0 || nodes[i].port > 65535 || nodes[i].timeout_ms < 0 ||
+            !memchr(nodes[i].host, '\0', sizeof(nodes[i].host))) {
+            LOG_ERROR("Invalid federation node %zu", i);
+            return -1;
+        }
+        fed->nodes[i] = nodes[i];
+    }
+    fed->node_count = node_count;
+    fed->timeout_ms = timeout_ms ? timeout_ms : FEDERATION_DEFAULT_TIMEOUT_MS;
+    return 0;
+}
+
+/**
+ * @brief 一个节点的查询连接
+ */
+typedef struct {
+    int fd;                     // socket，-1表示已结束
+    int connecting;             // 非阻塞连接尚未完成
+    size_t sent;                // 已发送的查询报文字节数
+    int64_t deadline_us;        // 超时时刻
+    size_t complete;            // 已完整合并的桶下标上界
+    uint8_t *in;                // 接收缓冲区
+    size_t in_len;              // 缓冲区中未处理的字节数
+} node_conn_t;
+
+/**
+ * @brief 结束一个节点的查询
+ */
+static void conn_finish(node_conn_t *conn, federation_node_status_t *status, federation_node_state_t state,
+                        int64_t start_us) {
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    status->state = state;
+    status->latency_us = now_us() - start_us;
+}
+
+/**
+ * @brief 开始连接节点并准备查询报文
+ * @return 0已开始连接，-1无法连接
+ */
+static int conn_open(node_conn_t *conn, const federation_node_t *node) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)node->port);
+    if (inet_pton(AF_INET, node->host, &addr.sin_addr) != 1) {
+        return -1;
+    }
+    conn->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0) {
+        return -1;
+    }
+    set_nodelay(conn->fd);
+    if (connect(conn->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(conn->fd);
+        conn->fd = -1;
+        return -1;
+    }
+    conn->connecting = 1;
+    return 0;
+}
+
+/**
+ * @brief 处理接收缓冲区中的完整报文
+ * @return 1节点结果结束 (state为结束状态)，0需要继续接收
+ */
+static int conn_consume(node_conn_t *conn, size_t count, query_bucket_t *buckets,
+                        federation_node_status_t *status, federation_node_state_t *state) {
+    size_t pos = 0;
+    int finished = 0;
+    while (!finished && conn->in_len - pos >= MSG_HEADER_SIZE) {
+        const uint8_t *msg = &conn->in[pos];
+        uint32_t len = get_u32(msg);
+        if (len > MAX_BATCH_SIZE) {
+            *state = FEDERATION_NODE_ERROR;
+            return 1;
+        }
+        if (conn->in_len - pos < MSG_HEADER_SIZE + len) {
+            break;
+        }
+        const uint8_t *payload = msg + MSG_HEADER_SIZE;
+        size_t end = 0;
+        uint64_t value;
+        switch (msg[4]) {
+            case FEDERATION_MSG_BUCKETS:
+                // 先完整校验再合并，格式错误的批次不影响已有结果
+                if (decode_batch(payload, len, count, &conn->complete, NULL, NULL) < 0) {
+                    *state = FEDERATION_NODE_ERROR;
+                    finished = 1;
+                } else {
+                    decode_batch(payload, len, count, &conn->complete, buckets, &status->rows);
+                }
+                break;
+            case FEDERATION_MSG_END:
+                finished = 1;
+                if (get_varint(payload, len, &end, &value) == 0 && end == len && value == count) {
+                    conn->complete = count;
+                    *state = FEDERATION_NODE_OK;
+                } else {
+                    *state = FEDERATION_NODE_ERROR;
+                }
+                break;
+            default:
+                *state = FEDERATION_NODE_ERROR;
+                finished = 1;
+                break;
+        }
+        pos += MSG_HEADER_SIZE + len;
+    }
+    memmove(conn->in, &conn->in[pos], conn->in_len - pos);
+    conn->in_len -= pos;
+    return finished;
+}
+
+/**
+ * @brief 推进一个节点的连接：完成连接、发送查询、接收并合并结果
+ * @return 1节点结果结束，0需要继续等待
+ */
+static int conn_progress(node_conn_t *conn, short revents, const uint8_t *request, size_t request_len,
+                         size_t count, query_bucket_t *buckets, federation_node_status_t *status,
+                         federation_node_state_t *state) {
+    if (conn->connecting) {
+        int error = 0;
+        socklen_t error_len = sizeof(error);
+        if (!(revents & (POLLOUT | POLLERR | POLLHUP))) {
+            return 0;
+        }
+        if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0) {
+            *state = FEDERATION_NODE_UNREACHABLE;
+            return 1;
+        }
+        conn->connecting = 0;
+    }
+
+    while (conn->sent < request_len) {
+        ssize_t n = send(conn->fd, request + conn->sent, request_len - conn->sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return 0;
+            }
+            *state = FEDERATION_NODE_ERROR;
+            return 1;
+        }
+        conn->sent += (size_t)n;
+    }
+
+    if (!(revents & (POLLIN | POLLERR | POLLHUP))) {
+        return 0;
+    }
+    while (1) {
+        ssize_t n = recv(conn->fd, &conn->in[conn->in_len], MSG_HEADER_SIZE + MAX_BATCH_SIZE - conn->in_len, 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return 0;
+            }
+            *state = FEDERATION_NODE_ERROR;
+            return 1;
+        }
+        if (n == 0) {
+            // 结束报文之前断开
+            *state = FEDERATION_NODE_ERROR;
+            return 1;
+        }
+        conn->in_len += (size_t)n;
+        status->bytes += (uint64_t)n;
+        if (conn_consume(conn, count, buckets, status, state)) {
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief 跨节点分桶聚合查询
+ */
+int64_t federation_aggregate(federation_t *fed, const realtime_query_t *query, int64_t bucket_ms,
+                             query_bucket_t *buckets, size_t max_buckets, federation_node_status_t *status) {
+    if (!fed || !query || !buckets || bucket_ms <= 0 || bucket_ms > QUERY_CACHE_MAX_BUCKET_MS ||
+        query->start_ms >= query->end_ms ||
+        query->start_ms < INT64_MIN / 2 || query->end_ms > INT64_MAX / 2) {
+        return -1;
+    }
+
+    // 与查询缓存相同的规范化，各节点的桶与这里一一对应
+    realtime_query_t key;
+    realtime_query_init(&key);
+    key.start_ms = floor_bucket(query->start_ms, bucket_ms);
+    key.end_ms = floor_bucket(query->end_ms - 1, bucket_ms) + bucket_ms;
+    key.match_device = query->match_device ? 1 : 0;
+    if (key.match_device) {
+        key.device = query->device;
+    }
+    key.channel_id = query->channel_id < 0 ? -1 : query->channel_id;
+    uint64_t count = bucket_span(key.start_ms, key.end_ms, bucket_ms);
+    if (count > max_buckets || count > QUERY_CACHE_MAX_BUCKETS) {
+        return -1;
+    }
+
+    size_t node_count = fed->node_count;
+    node_conn_t *conns = calloc(node_count ? node_count : 1, sizeof(node_conn_t));
+    federation_node_status_t *states = status ? status : calloc(node_count ? node_count : 1,
+                                                                 sizeof(federation_node_status_t));
+    struct pollfd *fds = calloc(node_count ? node_count : 1, sizeof(struct pollfd));
+    size_t *index = calloc(node_count ? node_count : 1, sizeof(size_t));
+    if (!conns || !states || !fds || !index) {
+        free(conns);
+        free(fds);
+        free(index);
+        if (states != status) {
+            free(states);
+        }
+        return -1;
+    }
+
+    memset(buckets, 0, count * sizeof(query_bucket_t));
+    for (uint64_t b = 0; b < count; b++) {
+        buckets[b].start_ms = bucket_start(key.start_ms, b, bucket_ms);
+    }
+    uint8_t request[MSG_HEADER_SIZE + MAX_REQUEST_SIZE];
+    size_t request_len = encode_request(request, &key, bucket_ms);
+
+    int64_t start_us = now_us();
+    size_t active = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        node_conn_t *conn = &conns[i];
+        const federation_node_t *node = &fed->nodes[i];
+        memset(&states[i], 0, sizeof(federation_node_status_t));
+        states[i].complete_until_ms = key.start_ms;
+        conn->deadline_us = start_us + (int64_t)(node->timeout_ms ? node->timeout_ms : fed->timeout_ms) * 1000;
+        conn->in = malloc(MSG_HEADER_SIZE + MAX_BATCH_SIZE);
+        if (!conn->in || conn_open(conn, node) < 0) {
+            conn_finish(conn, &states[i], FEDERATION_NODE_UNREACHABLE, start_us);
+            continue;
+        }
+        active++;
+    }
+
+    while (active > 0) {
+        // 等待到最早的超时时刻
+        int64_t now = now_us();
+        int64_t wait_us = INT64_MAX;
+        size_t nfds = 0;
+        for (size_t i = 0; i < node_count; i++) {
+            node_conn_t *conn = &conns[i];
+            if (conn->fd < 0) {
+                continue;
+            }
+            if (now >= conn->deadline_us) {
+                conn_finish(conn, &states[i], FEDERATION_NODE_TIMEOUT, start_us);
+                active--;
+                continue;
+            }
+            if (conn->deadline_us - now < wait_us) {
+                wait_us = conn->deadline_us - now;
+            }
+            fds[nfds].fd = conn->fd;
+            fds[nfds].events = (short)(POLLIN | (conn->connecting || conn->sent < request_len ? POLLOUT : 0));
+            fds[nfds].revents = 0;
+            index[nfds++] = i;
+        }
+        if (nfds == 0) {
+            break;
+        }
+
+        int ready = poll(fds, nfds, (int)((wait_us + 999) / 1000));
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR("Federated query poll failed: %s", strerror(errno));
+            break;
+        }
+        for (size_t k = 0; ready > 0 && k < nfds; k++) {
+            size_t i = index[k];
+            federation_node_state_t state = FEDERATION_NODE_ERROR;
+            if (fds[k].revents &&
+                conn_progress(&conns[i], fds[k].revents, request, request_len, count, buckets, &states[i], &state)) {
+                conn_finish(&conns[i], &states[i], state, start_us);
+                active--;
+            }
+        }
+    }
+
+    int partial = 0;
+    uint64_t received = 0;
+    for (size_t i = 0; i < node_count; i++) {
+        node_conn_t *conn = &conns[i];
+        if (conn->fd >= 0) {
+            conn_finish(conn, &states[i], FEDERATION_NODE_ERROR, start_us);
+        }
+        states[i].complete_until_ms = bucket_start(key.start_ms, conn->complete, bucket_ms);
+        received += states[i].bytes;
+        free(conn->in);
+
+        if (states[i].state != FEDERATION_NODE_OK) {
+            partial = 1;
+            if (states[i].state == FEDERATION_NODE_TIMEOUT) {
+                __atomic_add_fetch(&fed->node_timeouts, 1, __ATOMIC_RELAXED);
+            } else {
+                __atomic_add_fetch(&fed->node_errors, 1, __ATOMIC_RELAXED);
+            }
+            LOG_WARN("Federated query: node %s:%d %s after %lld ms, complete until %lld",
+                     fed->nodes[i].host, fed->nodes[i].port, federation_node_state_name(states[i].state),
+                     (long long)(states[i].latency_us / 1000), (long long)states[i].complete_until_ms);
+        }
+    }
+    __atomic_add_fetch(&fed->queries, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&fed->bytes_received, received, __ATOMIC_RELAXED);
+    if (partial) {
+        __atomic_add_fetch(&fed->partial_queries, 1, __ATOMIC_RELAXED);
+    }
+
+    free(conns);
+    free(fds);
+    free(index);
+    if (states != status) {
+        free(states);
+    }
+    return (int64_t)count;
+}
+
+/**
+ * @brief 导出协调指标
+ */
+void federation_export_metrics(federation_t *fed) {
+    if (!fed) {
+        return;
+    }
+    metrics_gauge_set("traffic_federation_nodes", NULL, (double)fed->node_count);
+    metrics_gauge_set("traffic_federation_queries_total", NULL,
+                      (double)__atomic_load_n(&fed->queries, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_partial_queries_total", NULL,
+                      (double)__atomic_load_n(&fed->partial_queries, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_node_timeouts_total", NULL,
+                      (double)__atomic_load_n(&fed->node_timeouts, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_node_errors_total", NULL,
+                      (double)__atomic_load_n(&fed->node_errors, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_federation_bytes_received_total", NULL,
+                      (double)__atomic_load_n(&fed->bytes_received, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief 节点状态名称
+ */
+const char *federation_node_state_name(federation_node_state_t state) {
+    switch (state) {
+        case FEDERATION_NODE_OK:
+            return "ok";
+        case FEDERATION_NODE_TIMEOUT:
+            return "timeout";
+        case FEDERATION_NODE_ERROR:
+            return "error";
+        case FEDERATION_NODE_UNREACHABLE:
+            return "unreachable";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,173 @@
+/**
+ * @file history_federation.h
+ * @brief 跨节点的历史数据分桶聚合查询
+ *
+ * 设备分散在多台控制机上时，区域查询需要汇总多个节点的数据。
+ * 每个节点运行查询服务 (federation_server_t)，在本地经查询缓存完成分桶聚合，
+ * 只把非空的桶分批发回；接收查询的节点 (federation_t) 同时向所有节点发出查询，
+ * 每收到一批就合并到结果中，不等待全部节点。
+ *
+ * 报文格式 (小端)：4字节负载长度 + 1字节类型 + 负载，负载中的整数为变长编码。
+ *   REQUEST  魔数、版本、对齐后的时间范围、桶宽和过滤条件
+ *   BUCKETS  已完整的桶下标上界，之后为若干非空桶 (与前一桶的下标差 + 各项和)
+ *   END      桶数，表示该节点的结果已全部发出
+ *   ERROR    节点查询失败
+ * 每个节点有独立的超时，超时或失败的节点已合并的批次保留在结果中，
+ * 节点状态给出该节点结果完整覆盖的时间上界，调用方据此判断结果是否完整。
+ */
+
+#ifndef HISTORY_FEDERATION_H
+#define HISTORY_FEDERATION_H
+
+#include "query_cache.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FEDERATION_MAGIC 0x51465054u        // "TPFQ"
+#define FEDERATION_VERSION 1                // 报文版本
+#define FEDERATION_MAX_NODES 64             // 单次查询最多节点数
+#define FEDERATION_MAX_THREADS 16           // 查询服务最多线程数
+#define FEDERATION_DEFAULT_THREADS 2        // 查询服务默认线程数
+#define FEDERATION_DEFAULT_TIMEOUT_MS 2000  // 默认单节点超时
+#define FEDERATION_BATCH_BUCKETS 256        // 每批最多桶数
+
+/**
+ * @brief 报文类型
+ */
+typedef enum {
+    FEDERATION_MSG_REQUEST = 1, // 查询
+    FEDERATION_MSG_BUCKETS = 2, // 一批桶
+    FEDERATION_MSG_END = 3,     // 结果结束
+    FEDERATION_MSG_ERROR = 4    // 查询失败
+} federation_msg_t;
+
+/**
+ * @brief 节点查询状态
+ */
+typedef enum {
+    FEDERATION_NODE_OK = 0,         // 结果完整
+    FEDERATION_NODE_TIMEOUT = 1,    // 超时，结果可能只有一部分
+    FEDERATION_NODE_ERROR = 2,      // 节点查询失败或连接中断
+    FEDERATION_NODE_UNREACHABLE = 3 // 无法连接
+} federation_node_state_t;
+
+/**
+ * @brief 节点地址
+ */
+typedef struct {
+    char host[64];              // IPv4地址
+    int port;                   // 查询服务端口
+    int timeout_ms;             // 该节点的超时，0表示使用协调的超时
+} federation_node_t;
+
+/**
+ * @brief 单个节点的查询结果
+ */
+typedef struct {
+    federation_node_state_t state; // 状态
+    int64_t complete_until_ms;  // 该节点结果完整覆盖的时间上界 (之前的桶已全部合并)
+    uint64_t rows;              // 合并的行数
+    uint64_t bytes;             // 接收的字节数
+    int64_t latency_us;         // 完成或放弃时距查询开始的时间
+} federation_node_status_t;
+
+/**
+ * @brief 查询服务：在本节点执行其他节点发来的聚合查询
+ */
+typedef struct {
+    query_cache_t *cache;       // 本节点的查询缓存
+    int listen_fd;              // 监听socket
+    int stop_fd;                // 停止通知 (eventfd)
+    int port;                   // 实际监听端口
+    pthread_t threads[FEDERATION_MAX_THREADS]; // 服务线程 (各自接受连接)
+    int thread_count;           // 服务线程数
+
+    uint64_t requests;          // 累计处理的查询数
+    uint64_t failed;            // 失败的查询数 (报文错误或本地查询失败)
+    uint64_t buckets_sent;      // 累计发出的非空桶数
+    uint64_t bytes_sent;        // 累计发出的字节数
+} federation_server_t;
+
+/**
+ * @brief 查询协调：向一组节点分发查询并合并结果
+ */
+typedef struct {
+    federation_node_t nodes[FEDERATION_MAX_NODES]; // 节点
+    size_t node_count;          // 节点数
+    int timeout_ms;             // 单节点超时
+
+    uint64_t queries;           // 累计查询数
+    uint64_t partial_queries;   // 有节点未返回完整结果的查询数
+    uint64_t node_timeouts;     // 累计超时的节点数
+    uint64_t node_errors;       // 累计失败或无法连接的节点数
+    uint64_t bytes_received;    // 累计接收的字节数
+} federation_t;
+
+/**
+ * @brief 启动查询服务
+ * @param server 服务指针
+ * @param cache 本节点的查询缓存
+ * @param port 监听端口，0表示由系统分配 (实际端口见server->port)
+ * @param threads 服务线程数，0表示默认值
+ * @return 0成功，-1失败
+ */
+int federation_server_start(federation_server_t *server, query_cache_t *cache, int port, int threads);
+
+/**
+ * @brief 停止查询服务 (等待正在处理的查询完成)
+ * @param server 服务指针
+ */
+void federation_server_stop(federation_server_t *server);
+
+/**
+ * @brief 导出查询服务的请求数、失败数和发送量指标
+ * @param server 服务指针
+ */
+void federation_server_export_metrics(federation_server_t *server);
+
+/**
+ * @brief 初始化查询协调
+ * @param fed 协调指针
+ * @param nodes 节点地址
+ * @param node_count 节点数
+ * @param timeout_ms 单节点超时，0表示默认值
+ * @return 0成功，-1失败
+ */
+int federation_init(federation_t *fed, const federation_node_t *nodes, size_t node_count, int timeout_ms);
+
+/**
+ * @brief 跨节点分桶聚合查询 (可多线程并发调用)
+ * @param fed 协调指针
+ * @param query 过滤条件，时间范围须有界，向外对齐到桶边界
+ * @param bucket_ms 桶宽(毫秒)，不超过QUERY_CACHE_MAX_BUCKET_MS
+ * @param buckets 输出桶数组 (各节点的结果按桶累加)
+ * @param max_buckets 输出数组容量
+ * @param status 输出各节点的结果状态 (node_count个)，可为NULL
+ * @return 桶数，-1参数错误；部分节点超时或失败时仍返回桶数，由status区分
+ */
+int64_t federation_aggregate(federation_t *fed, const realtime_query_t *query, int64_t bucket_ms,
+                             query_bucket_t *buckets, size_t max_buckets, federation_node_status_t *status);
+
+/**
+ * @brief 导出协调的查询数、不完整查询数和节点超时指标
+ * @param fed 协调指针
+ */
+void federation_export_metrics(federation_t *fed);
+
+/**
+ * @brief 节点状态名称
+ * @param state 状态
+ * @return "ok"、"timeout"、"error"或"unreachable"
+ */
+const char *federation_node_state_name(federation_node_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_FEDERATION_H
@@ -0,0 +1,1562 @@
+/**
+ * @file history_replication.c
+ * @brief 历史段文件和热层尾部的异步复制实现
+ */
+
+#include "history_replication.h"
+#include "../common/crc32.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+#include "../utils/socket_utils.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MSG_HEADER_SIZE 5                   // 负载长度 + 类型
+#define MAX_PAYLOAD (1 << 20)               // DATA和TAIL报文的负载上限
+#define MAX_HELLO_PAYLOAD (64 << 20)        // HELLO报文的负载上限 (每个文件约40字节)
+#define TAIL_HEADER_MAX 40                  // TAIL报文中行数据之前的字段上限
+#define NAME_DIGITS 20                      // 文件名中行号的位数
+#define PARTIAL_PREFIX "part-"              // 未完成文件的前缀 (不以seg-开头，存储启动时忽略)
+
+static const char *const tier_dirs[2] = {"warm", "cold"};
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 一行在各列中的总字节数
+ */
+static size_t row_bytes(void) {
+    size_t bytes = 0;
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        bytes += realtime_column_info[i].item_size;
+    }
+    return bytes;
+}
+
+/**
+ * @brief 每条尾部报文的行数 (受报文负载上限约束)
+ */
+static size_t tail_batch_rows(void) {
+    size_t rows = (MAX_PAYLOAD - TAIL_HEADER_MAX) / row_bytes();
+    return rows < REPLICATION_TAIL_ROWS ? rows : REPLICATION_TAIL_ROWS;
+}
+
+/**
+ * @brief 写入变长整数 (每字节7位，最高位表示后面还有字节)
+ */
+static void put_varint(uint8_t *p, size_t *pos, uint64_t value) {
+    while (value >= 0x80) {
+        p[(*pos)++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[(*pos)++] = (uint8_t)value;
+}
+
+/**
+ * @brief 读取变长整数
+ * @return 0成功，-1越界或超过10字节
+ */
+static int get_varint(const uint8_t *p, size_t len, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 70 && *pos < len; shift += 7) {
+        uint8_t byte = p[(*pos)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static inline uint32_t get_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * @brief 填写报文头 (负载长度和类型)
+ */
+static void put_header(uint8_t *p, size_t payload_len, replication_msg_t type) {
+    put_u32(p, (uint32_t)payload_len);
+    p[4] = (uint8_t)type;
+}
+
+/**
+ * @brief 写入名称 (长度 + 字节)
+ */
+static void put_name(uint8_t *p, size_t *pos, const char *name) {
+    size_t len = strlen(name);
+    put_varint(p, pos, len);
+    memcpy(&p[*pos], name, len);
+    *pos += len;
+}
+
+/**
+ * @brief 校验文件名：warm/或cold/之后为seg-和20位行号
+ * @return 0合法，-1不合法
+ */
+static int parse_name(const char *name, int *tier, uint64_t *first_row) {
+    for (int t = 0; t < 2; t++) {
+        size_t prefix = strlen(tier_dirs[t]);
+        if (strncmp(name, tier_dirs[t], prefix) != 0 || strncmp(&name[prefix], "/seg-", 5) != 0) {
+            continue;
+        }
+        const char *digits = &name[prefix + 5];
+        uint64_t row = 0;
+        for (int i = 0; i < NAME_DIGITS; i++) {
+            if (digits[i] < '0' || digits[i] > '9') {
+                return -1;
+            }
+            uint64_t next = row * 10 + (uint64_t)(digits[i] - '0');
+            if (row > UINT64_MAX / 10 || next < row * 10) {
+                return -1;
+            }
+            row = next;
+        }
+        if (digits[NAME_DIGITS] != '\0') {
+            return -1;
+        }
+        *tier = t;
+        *first_row = row;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief 读取名称并校验
+ * @return 0成功，-1格式错误或名称不合法
+ */
+static int get_name(const uint8_t *p, size_t len, size_t *pos, char *name) {
+    uint64_t name_len;
+    int tier;
+    uint64_t first_row;
+    if (get_varint(p, len, pos, &name_len) < 0 || name_len >= REPLICATION_NAME_SIZE || name_len > len - *pos) {
+        return -1;
+    }
+    memcpy(name, &p[*pos], name_len);
+    name[name_len] = '\0';
+    *pos += name_len;
+    return parse_name(name, &tier, &first_row);
+}
+
+/**
+ * @brief 文件在目录中的完整路径
+ * @param partial 是否为未完成文件 (seg-改为part-)
+ */
+static void file_path(const char *dir, const char *name, int partial, char *path, size_t size) {
+    if (partial) {
+        const char *slash = strchr(name, '/');
+        snprintf(path, size, "%s/%.*s/" PARTIAL_PREFIX "%s", dir, (int)(slash - name), name, slash + 5);
+    } else {
+        snprintf(path, size, "%s/%s", dir, name);
+    }
+}
+
+static int compare_files(const void *a, const void *b) {
+    return strcmp(((const replication_file_t *)a)->name, ((const replication_file_t *)b)->name);
+}
+
+/**
+ * @brief 按名称查找文件 (数组已排序)
+ */
+static replication_file_t *find_file(replication_file_t *files, size_t count, const char *name) {
+    replication_file_t key;
+    snprintf(key.name, sizeof(key.name), "%s", name);
+    return bsearch(&key, files, count, sizeof(replication_file_t), compare_files);
+}
+
+/**
+ * @brief 列出目录中的段文件，按名称排序
+ * @param with_partial 是否包含未完成的文件 (副本)
+ * @return 0成功，-1无法读取目录或内存不足
+ */
+static int list_files(const char *dir, int with_partial, replication_file_t **files, size_t *count,
+                      size_t *capacity) {
+    *count = 0;
+    for (int t = 0; t < 2; t++) {
+        char tier_dir[300];
+        snprintf(tier_dir, sizeof(tier_dir), "%s/%s", dir, tier_dirs[t]);
+        DIR *d = opendir(tier_dir);
+        if (!d) {
+            LOG_ERROR("Failed to list history directory %s: %s", tier_dir, strerror(errno));
+            return -1;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            int partial = strncmp(entry->d_name, PARTIAL_PREFIX, strlen(PARTIAL_PREFIX)) == 0;
+            if (strncmp(entry->d_name, "seg-", 4) != 0 && !(with_partial && partial)) {
+                continue;
+            }
+            // 临时文件和其他名称 (含导入工具的临时文件) 由名称校验排除
+            char name[REPLICATION_NAME_SIZE + 8];
+            snprintf(name, sizeof(name), "%s/seg-%s", tier_dirs[t],
+                     entry->d_name + (partial ? strlen(PARTIAL_PREFIX) : 4));
+            int tier;
+            uint64_t first_row;
+            if (strlen(name) >= REPLICATION_NAME_SIZE || parse_name(name, &tier, &first_row) < 0) {
+                continue;
+            }
+            char path[sizeof(tier_dir) + sizeof(entry->d_name)];
+            struct stat st;
+            snprintf(path, sizeof(path), "%s/%s", tier_dir, entry->d_name);
+            if (stat(path, &st) < 0 || !S_ISREG(st.st_mode)) {
+                continue;
+            }
+
+            if (*count == *capacity) {
+                size_t new_capacity = *capacity ? *capacity * 2 : 64;
+                replication_file_t *grown = realloc(*files, new_capacity * sizeof(replication_file_t));
+                if (!grown) {
+                    closedir(d);
+                    return -1;
+                }
+                *files = grown;
+                *capacity = new_capacity;
+            }
+            replication_file_t *file = &(*files)[(*count)++];
+            snprintf(file->name, sizeof(file->name), "%s", name);
+            file->size = (uint64_t)st.st_size;
+            file->partial = partial;
+        }
+        closedir(d);
+    }
+    qsort(*files, *count, sizeof(replication_file_t), compare_files);
+    return 0;
+}
+
+/**
+ * @brief 读取接收路径段 (非导入段) 的行号上界
+ * @return 行号上界，导入段或无法读取时为0
+ */
+static uint64_t segment_end(const char *path) {
+    history_segment_header_t header;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n = pread(fd, &header, sizeof(header), 0);
+    close(fd);
+    if (n != (ssize_t)sizeof(header) || memcmp(header.magic, HISTORY_SEGMENT_MAGIC, 4) != 0 ||
+        (header.first_row & HISTORY_IMPORT_ROW_BIT)) {
+        return 0;
+    }
+    return header.first_row + header.row_count;
+}
+
+/**
+ * @brief 已生效的段文件的行号上界
+ */
+static uint64_t scan_sealed_end(const char *dir, const replication_file_t *files, size_t count) {
+    uint64_t end = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!files[i].partial) {
+            char path[320];
+            file_path(dir, files[i].name, 0, path, sizeof(path));
+            uint64_t file_end = segment_end(path);
+            end = file_end > end ? file_end : end;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief 读取整个文件
+ * @return 文件内容 (调用方释放)，文件不存在时返回NULL且len为0
+ */
+static uint8_t *read_file(const char *path, size_t *len) {
+    *len = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    uint8_t *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = malloc((size_t)st.st_size);
+        if (data && pread(fd, data, (size_t)st.st_size, 0) == st.st_size) {
+            *len = (size_t)st.st_size;
+        } else {
+            free(data);
+            data = NULL;
+        }
+    }
+    close(fd);
+    return data;
+}
+
+/**
+ * @brief 解析尾部报文负载并校验
+ * @param data 输出按列存放的行数据
+ * @return 0成功，-1格式错误，-2校验失败
+ */
+static int decode_tail(const uint8_t *p, size_t len, uint64_t *first_row, uint64_t *rows, const uint8_t **data) {
+    size_t pos = 0;
+    uint64_t crc;
+    if (get_varint(p, len, &pos, first_row) < 0 || get_varint(p, len, &pos, rows) < 0 ||
+        get_varint(p, len, &pos, &crc) < 0 || *rows == 0 || *rows > REPLICATION_TAIL_ROWS ||
+        *first_row >= HISTORY_IMPORT_ROW_BIT || len - pos != *rows * row_bytes()) {
+        return -1;
+    }
+    *data = &p[pos];
+    return calculate_crc32(0, *data, len - pos) == crc ? 0 : -2;
+}
+
+/**
+ * @brief 遍历尾部日志中的有效记录
+ * @param visit 每条记录的回调，返回非0时停止
+ * @return 有效记录的字节数
+ */
+static size_t walk_tail_log(const uint8_t *log, size_t len,
+                            int (*visit)(void *ctx, const uint8_t *record, size_t record_len, uint64_t first_row,
+                                         uint64_t rows, const uint8_t *data),
+                            void *ctx) {
+    size_t pos = 0;
+    while (len - pos >= 4) {
+        uint32_t record_len = get_u32(&log[pos]);
+        uint64_t first_row;
+        uint64_t rows;
+        const uint8_t *data;
+        if (record_len > len - pos - 4 ||
+            decode_tail(&log[pos + 4], record_len, &first_row, &rows, &data) < 0) {
+            break;
+        }
+        if (visit && visit(ctx, &log[pos], 4 + (size_t)record_len, first_row, rows, data)) {
+            break;
+        }
+        pos += 4 + (size_t)record_len;
+    }
+    return pos;
+}
+
+/* ========== 主节点 ========== */
+
+/**
+ * @brief 阻塞读取指定字节数 (受SO_RCVTIMEO限制)
+ */
+static int read_full(int fd, uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = recv(fd, buf + done, len - done, 0);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 阻塞发送全部字节 (受SO_SNDTIMEO限制，对端关闭时不产生SIGPIPE)
+ */
+static int send_full(int fd, const uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = send(fd, buf + done, len - done, MSG_NOSIGNAL);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 限速：按速率补充令牌，不足时等待 (可被replication_stop中断)
+ * @return 0可以发送，-1正在停止
+ */
+static int throttle(replication_t *repl, size_t bytes) {
+    if (repl->max_bytes_per_sec == 0) {
+        return 0;
+    }
+    double rate = (double)repl->max_bytes_per_sec;
+    double burst = rate / 10 > REPLICATION_CHUNK_BYTES ? rate / 10 : REPLICATION_CHUNK_BYTES;
+    int64_t now = now_ns();
+    repl->tokens += (double)(now - repl->tokens_ns) * rate / 1e9;
+    repl->tokens = repl->tokens > burst ? burst : repl->tokens;
+    repl->tokens_ns = now;
+    repl->tokens -= (double)bytes;
+    if (repl->tokens >= 0) {
+        return 0;
+    }
+
+    // 欠下的令牌按速率补足后再发送
+    int64_t wait_ns = (int64_t)(-repl->tokens / rate * 1e9);
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += wait_ns / 1000000000LL;
+    deadline.tv_nsec += wait_ns % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_mutex_lock(&repl->lock);
+    while (!repl->stopping &&
+           pthread_cond_timedwait(&repl->wakeup, &repl->lock, &deadline) != ETIMEDOUT) {
+    }
+    int stopping = repl->stopping;
+    pthread_mutex_unlock(&repl->lock);
+    return stopping ? -1 : 0;
+}
+
+/**
+ * @brief 发送报文 (经过限速)
+ */
+static int send_message(replication_t *repl, const uint8_t *msg, size_t len) {
+    if (throttle(repl, len) < 0 || send_full(repl->fd, msg, len) < 0) {
+        return -1;
+    }
+    repl->bytes_sent += len;
+    return 0;
+}
+
+/**
+ * @brief 读取应答
+ * @return 应答状态，-1连接失败或报文错误
+ */
+static int read_ack(replication_t *repl) {
+    uint8_t msg[MSG_HEADER_SIZE + 10];
+    size_t pos = 0;
+    uint64_t status;
+    if (read_full(repl->fd, msg, MSG_HEADER_SIZE) < 0 || msg[4] != REPLICATION_MSG_ACK ||
+        get_u32(msg) == 0 || get_u32(msg) > 10 || read_full(repl->fd, &msg[MSG_HEADER_SIZE], get_u32(msg)) < 0 ||
+        get_varint(&msg[MSG_HEADER_SIZE], get_u32(msg), &pos, &status) < 0 || status > REPLICATION_ACK_ERROR) {
+        return -1;
+    }
+    return (int)status;
+}
+
+/**
+ * @brief 断开到副本的连接
+ */
+static void disconnect(replication_t *repl) {
+    if (repl->fd >= 0) {
+        close(repl->fd);
+        repl->fd = -1;
+    }
+    repl->connected = 0;
+}
+
+/**
+ * @brief 连接副本 (带超时) 并读取HELLO报文中的文件列表和尾部位置
+ * @return 0成功，-1失败
+ */
+static int connect_replica(replication_t *repl) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)repl->port);
+    if (inet_pton(AF_INET, repl->host, &addr.sin_addr) != 1) {
+        return -1;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+    struct pollfd pfd = {fd, POLLOUT, 0};
+    if ((connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 &&
+         (errno != EINPROGRESS || poll(&pfd, 1, REPLICATION_IO_TIMEOUT_MS) != 1 ||
+          getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0 || error != 0)) ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK) < 0) {
+        close(fd);
+        return -1;
+    }
+    struct timeval timeout = {REPLICATION_IO_TIMEOUT_MS / 1000, (REPLICATION_IO_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    repl->fd = fd;
+
+    // HELLO: 魔数、版本、尾部位置、文件数，之后每个文件为 (是否未完成, 名称, 大小)
+    uint8_t header[MSG_HEADER_SIZE];
+    if (read_full(fd, header, sizeof(header)) < 0 || header[4] != REPLICATION_MSG_HELLO ||
+        get_u32(header) < 4 || get_u32(header) > MAX_HELLO_PAYLOAD) {
+        disconnect(repl);
+        return -1;
+    }
+    size_t len = get_u32(header);
+    uint8_t *p = malloc(len);
+    size_t pos = 4;
+    uint64_t version;
+    uint64_t count = 0;
+    int result = p && read_full(fd, p, len) == 0 && get_u32(p) == REPLICATION_MAGIC &&
+                 get_varint(p, len, &pos, &version) == 0 && version == REPLICATION_VERSION &&
+                 get_varint(p, len, &pos, &repl->tail_end) == 0 && get_varint(p, len, &pos, &count) == 0 &&
+                 count <= len ? 0 : -1;
+    if (result == 0 && count > repl->remote_capacity) {
+        replication_file_t *grown = realloc(repl->remote, count * sizeof(replication_file_t));
+        result = grown ? 0 : -1;
+        if (grown) {
+            repl->remote = grown;
+            repl->remote_capacity = count;
+        }
+    }
+    repl->remote_count = 0;
+    for (uint64_t i = 0; i < count && result == 0; i++) {
+        replication_file_t *file = &repl->remote[i];
+        uint64_t partial;
+        if (get_varint(p, len, &pos, &partial) < 0 || get_name(p, len, &pos, file->name) < 0 ||
+            get_varint(p, len, &pos, &file->size) < 0) {
+            result = -1;
+            break;
+        }
+        file->partial = partial ? 1 : 0;
+        repl->remote_count++;
+    }
+    free(p);
+    if (result < 0) {
+        LOG_WARN("Invalid hello from history replica %s:%d", repl->host, repl->port);
+        disconnect(repl);
+        return -1;
+    }
+    qsort(repl->remote, repl->remote_count, sizeof(replication_file_t), compare_files);
+    repl->connected = 1;
+    LOG_INFO("Connected to history replica %s:%d - %zu files, tail at row %llu", repl->host, repl->port,
+             repl->remote_count, (unsigned long long)repl->tail_end);
+    return 0;
+}
+
+/**
+ * @brief 发送一个段文件：从offset继续分块发送，最后提交并等待副本校验整个文件
+ * @return 0成功或文件已被删除 (*shipped为0)，-1失败
+ */
+static int ship_file(replication_t *repl, const replication_file_t *file, uint64_t offset, int *shipped) {
+    char path[320];
+    file_path(repl->hist->dir, file->name, 0, path, sizeof(path));
+    *shipped = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        // 列出之后被压缩或删除，留给删除阶段
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    // 先补算已发送部分的校验码 (只读本地文件)，整个文件的校验码在提交时比较
+    uint8_t *msg = repl->buffer;
+    uint8_t *data = &msg[MSG_HEADER_SIZE + TAIL_HEADER_MAX + REPLICATION_NAME_SIZE];
+    uint32_t crc = 0;
+    int result = 0;
+    for (uint64_t pos = 0; pos < offset && result == 0;) {
+        size_t len = offset - pos < REPLICATION_CHUNK_BYTES ? (size_t)(offset - pos) : REPLICATION_CHUNK_BYTES;
+        result = async_io_run(repl->hist->io, ASYNC_IO_READ, fd, data, len, pos) == (int64_t)len ? 0 : -1;
+        crc = calculate_crc32(crc, data, len);
+        pos += len;
+    }
+
+    // DATA: 名称、偏移、本块校验码、数据；不等待应答
+    for (uint64_t pos = offset; pos < file->size && result == 0;) {
+        size_t len = file->size - pos < REPLICATION_CHUNK_BYTES ? (size_t)(file->size - pos)
+                                                                : REPLICATION_CHUNK_BYTES;
+        if (async_io_run(repl->hist->io, ASYNC_IO_READ, fd, data, len, pos) != (int64_t)len) {
+            result = -1;
+            break;
+        }
+        uint32_t chunk_crc = calculate_crc32(0, data, len);
+        crc = calculate_crc32(crc, data, len);
+        uint8_t fields[TAIL_HEADER_MAX + REPLICATION_NAME_SIZE];
+        size_t n = 0;
+        put_name(fields, &n, file->name);
+        put_varint(fields, &n, pos);
+        put_varint(fields, &n, chunk_crc);
+        memmove(&msg[MSG_HEADER_SIZE + n], data, len);
+        memcpy(&msg[MSG_HEADER_SIZE], fields, n);
+        put_header(msg, n + len, REPLICATION_MSG_DATA);
+        result = send_message(repl, msg, MSG_HEADER_SIZE + n + len);
+        repl->lag_bytes -= repl->lag_bytes < len ? repl->lag_bytes : len;
+        pos += len;
+    }
+    close(fd);
+    if (result < 0) {
+        return -1;
+    }
+
+    // COMMIT: 名称、大小、整个文件的校验码
+    size_t n = 0;
+    put_name(&msg[MSG_HEADER_SIZE], &n, file->name);
+    put_varint(&msg[MSG_HEADER_SIZE], &n, file->size);
+    put_varint(&msg[MSG_HEADER_SIZE], &n, crc);
+    put_header(msg, n, REPLICATION_MSG_COMMIT);
+    int ack = send_message(repl, msg, MSG_HEADER_SIZE + n) == 0 ? read_ack(repl) : -1;
+    if (ack == REPLICATION_ACK_CHECKSUM) {
+        // 副本已丢弃该文件，下一轮从头发送
+        repl->checksum_failures++;
+        LOG_WARN("History replica rejected %s: checksum mismatch", file->name);
+    }
+    if (ack != REPLICATION_ACK_OK) {
+        return -1;
+    }
+    *shipped = 1;
+    return 0;
+}
+
+/**
+ * @brief 在副本上删除一个文件
+ * @return 0成功，-1失败
+ */
+static int delete_remote(replication_t *repl, const char *name) {
+    uint8_t msg[MSG_HEADER_SIZE + REPLICATION_NAME_SIZE + 10];
+    size_t n = 0;
+    put_name(&msg[MSG_HEADER_SIZE], &n, name);
+    put_header(msg, n, REPLICATION_MSG_DELETE);
+    if (send_message(repl, msg, MSG_HEADER_SIZE + n) < 0 || read_ack(repl) != REPLICATION_ACK_OK) {
+        return -1;
+    }
+    repl->files_deleted++;
+    return 0;
+}
+
+/**
+ * @brief 同步段文件：发送副本缺少的或未完成的文件，再删除本地已没有的文件
+ * @return 0成功，-1失败
+ */
+static int sync_files(replication_t *repl, replication_file_t **local, size_t *local_count,
+                      size_t *local_capacity) {
+    if (list_files(repl->hist->dir, 0, local, local_count, local_capacity) < 0) {
+        return -1;
+    }
+
+    // 副本缺少的字节数，发送过程中递减
+    repl->lag_bytes = 0;
+    for (size_t i = 0; i < *local_count; i++) {
+        const replication_file_t *file = &(*local)[i];
+        const replication_file_t *remote = find_file(repl->remote, repl->remote_count, file->name);
+        if (!remote || remote->partial || remote->size != file->size) {
+            uint64_t have = remote && remote->partial && remote->size <= file->size ? remote->size : 0;
+            repl->lag_bytes += file->size - have;
+        }
+    }
+
+    for (size_t i = 0; i < *local_count; i++) {
+        const replication_file_t *file = &(*local)[i];
+        replication_file_t *remote = find_file(repl->remote, repl->remote_count, file->name);
+        if (remote && !remote->partial && remote->size == file->size) {
+            continue;
+        }
+        uint64_t offset = 0;
+        if (remote && remote->partial && remote->size <= file->size && remote->size > 0) {
+            offset = remote->size;
+            repl->resumed_files++;
+        }
+        int shipped;
+        if (ship_file(repl, file, offset, &shipped) < 0) {
+            return -1;
+        }
+        if (shipped) {
+            repl->files_shipped++;
+        }
+        if (remote) {
+            // 已提交，删除阶段不再处理
+            remote->partial = 0;
+            remote->size = file->size;
+        }
+    }
+
+    for (size_t i = 0; i < repl->remote_count; i++) {
+        if (!find_file(*local, *local_count, repl->remote[i].name) &&
+            delete_remote(repl, repl->remote[i].name) < 0) {
+            return -1;
+        }
+    }
+
+    // 副本的文件列表与本次列出的一致
+    if (*local_count > repl->remote_capacity) {
+        replication_file_t *grown = realloc(repl->remote, *local_count * sizeof(replication_file_t));
+        if (!grown) {
+            return -1;
+        }
+        repl->remote = grown;
+        repl->remote_capacity = *local_count;
+    }
+    memcpy(repl->remote, *local, *local_count * sizeof(replication_file_t));
+    repl->remote_count = *local_count;
+    repl->lag_bytes = 0;
+    return 0;
+}
+
+/**
+ * @brief 发送热层中尚未复制的行 (行号不小于start)，每批等待副本落盘
+ * @return 0成功，-1失败
+ */
+static int sync_tail(replication_t *repl, uint64_t start) {
+    realtime_snapshot_t snapshot;
+    if (realtime_store_snapshot(&repl->hist->hot, &snapshot) < 0) {
+        return -1;
+    }
+    if (repl->tail_end < start) {
+        repl->tail_end = start;
+    }
+
+    size_t batch = tail_batch_rows();
+    uint8_t *msg = repl->buffer;
+    int result = 0;
+    for (size_t c = 0; c < snapshot.chunk_count && result == 0; c++) {
+        const realtime_chunk_t *chunk = snapshot.chunks[c];
+        uint64_t end = chunk->first_row + snapshot.rows[c];
+        // 热层淘汰了尚未复制的行时从现存的最早行继续
+        uint64_t row = repl->tail_end > chunk->first_row ? repl->tail_end : chunk->first_row;
+        while (row < end && result == 0) {
+            size_t rows = end - row < batch ? (size_t)(end - row) : batch;
+            size_t offset = (size_t)(row - chunk->first_row);
+            uint8_t *data = &msg[MSG_HEADER_SIZE + TAIL_HEADER_MAX];
+            size_t len = 0;
+            for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+                size_t item = realtime_column_info[i].item_size;
+                memcpy(&data[len], (const uint8_t *)realtime_column_data(&chunk->columns, i) + offset * item,
+                       rows * item);
+                len += rows * item;
+            }
+
+            // TAIL: 首行行号、行数、校验码，之后是行数据 (字段放在数据之前)
+            uint8_t fields[TAIL_HEADER_MAX];
+            size_t n = 0;
+            put_varint(fields, &n, row);
+            put_varint(fields, &n, rows);
+            put_varint(fields, &n, calculate_crc32(0, data, len));
+            memmove(&msg[MSG_HEADER_SIZE + n], data, len);
+            memcpy(&msg[MSG_HEADER_SIZE], fields, n);
+            put_header(msg, n + len, REPLICATION_MSG_TAIL);
+            int ack = send_message(repl, msg, MSG_HEADER_SIZE + n + len) == 0 ? read_ack(repl) : -1;
+            if (ack == REPLICATION_ACK_CHECKSUM) {
+                repl->checksum_failures++;
+            }
+            if (ack != REPLICATION_ACK_OK) {
+                result = -1;
+                break;
+            }
+            repl->tail_end = row + rows;
+            repl->tail_rows += rows;
+            row += rows;
+        }
+    }
+    repl->lag_rows = snapshot.end_row > repl->tail_end ? snapshot.end_row - repl->tail_end : 0;
+    realtime_snapshot_release(&snapshot);
+    return result;
+}
+
+/**
+ * @brief 初始化复制
+ */
+int replication_init(replication_t *repl, history_store_t *hist, const replication_config_t *config) {
+    if (!repl || !hist || !config || !config->host || config->port <= 0 || config->port > 65535 ||
+        config->interval_ms < 0 || strlen(config->host) >= sizeof(repl->host)) {
+        return -1;
+    }
+
+    memset(repl, 0, sizeof(replication_t));
+    repl->buffer = malloc(MSG_HEADER_SIZE + MAX_PAYLOAD);
+    if (!repl->buffer) {
+        return -1;
+    }
+    repl->hist = hist;
+    snprintf(repl->host, sizeof(repl->host), "%s", config->host);
+    repl->port = config->port;
+    repl->max_bytes_per_sec = config->max_bytes_per_sec;
+    repl->interval_ms = config->interval_ms ? config->interval_ms : REPLICATION_DEFAULT_INTERVAL_MS;
+    repl->fd = -1;
+    repl->tokens_ns = now_ns();
+    repl->caught_up_ns = repl->tokens_ns;
+
+    pthread_mutex_init(&repl->lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&repl->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    return 0;
+}
+
+/**
+ * @brief 执行一轮复制
+ */
+int replication_run_once(replication_t *repl) {
+    if (!repl) {
+        return -1;
+    }
+    if (repl->fd < 0 && connect_replica(repl) < 0) {
+        repl->connect_failures++;
+        return -1;
+    }
+
+    // 行号早于persisted_end的行已在列出的段文件中 (段文件先改名再推进persisted_end)
+    uint64_t persisted = __atomic_load_n(&repl->hist->persisted_end, __ATOMIC_ACQUIRE);
+    replication_file_t *local = NULL;
+    size_t local_count = 0;
+    size_t local_capacity = 0;
+    int result = sync_files(repl, &local, &local_count, &local_capacity);
+    free(local);
+    if (result == 0) {
+        result = sync_tail(repl, persisted);
+    }
+    if (result < 0) {
+        LOG_WARN("History replication to %s:%d interrupted, resuming on next cycle", repl->host, repl->port);
+        disconnect(repl);
+        return -1;
+    }
+    if (repl->lag_bytes == 0 && repl->lag_rows == 0) {
+        repl->caught_up_ns = now_ns();
+    }
+    return 0;
+}
+
+/**
+ * @brief 复制线程：按周期复制并导出指标，直到被停止
+ */
+static void *replication_thread(void *arg) {
+    replication_t *repl = (replication_t *)arg;
+    pthread_mutex_lock(&repl->lock);
+    while (repl->running) {
+        pthread_mutex_unlock(&repl->lock);
+        replication_run_once(repl);
+        replication_export_metrics(repl);
+        pthread_mutex_lock(&repl->lock);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += repl->interval_ms / 1000;
+        deadline.tv_nsec += (long)(repl->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (repl->running &&
+               pthread_cond_timedwait(&repl->wakeup, &repl->lock, &deadline) != ETIMEDOUT) {
+        }
+    }
+    pthread_mutex_unlock(&repl->lock);
+    return NULL;
+}
+
+/**
+ * @brief 启动复制线程
+ */
+int replication_start(replication_t *repl) {
+    if (!repl || repl->running) {
+        return -1;
+    }
+    repl->running = 1;
+    repl->stopping = 0;
+    if (pthread_create(&repl->thread, NULL, replication_thread, repl) != 0) {
+        repl->running = 0;
+        return -1;
+    }
+    LOG_INFO("History replication to %s:%d started (limit %llu bytes/s)", repl->host, repl->port,
+             (unsigned long long)repl->max_bytes_per_sec);
+    return 0;
+}
+
+/**
+ * @brief 停止复制线程
+ */
+void replication_stop(replication_t *repl) {
+    if (!repl || !repl->running) {
+        return;
+    }
+    pthread_mutex_lock(&repl->lock);
+    repl->running = 0;
+    repl->stopping = 1;
+    pthread_cond_broadcast(&repl->wakeup);
+    pthread_mutex_unlock(&repl->lock);
+    pthread_join(repl->thread, NULL);
+}
+
+/**
+ * @brief 停止复制线程、断开连接并释放资源
+ */
+void replication_destroy(replication_t *repl) {
+    if (!repl || !repl->buffer) {
+        return;
+    }
+    replication_stop(repl);
+    disconnect(repl);
+    free(repl->remote);
+    free(repl->buffer);
+    repl->remote = NULL;
+    repl->buffer = NULL;
+    pthread_mutex_destroy(&repl->lock);
+    pthread_cond_destroy(&repl->wakeup);
+}
+
+/**
+ * @brief 导出复制指标
+ */
+void replication_export_metrics(replication_t *repl) {
+    if (!repl) {
+        return;
+    }
+    // 未追平时延迟秒数为距上次追平的时间
+    double lag_seconds = repl->lag_bytes || repl->lag_rows || !repl->connected
+                             ? (double)(now_ns() - repl->caught_up_ns) / 1e9 : 0;
+    metrics_gauge_set("traffic_replication_connected", NULL, repl->connected);
+    metrics_gauge_set("traffic_replication_lag_bytes", NULL, (double)repl->lag_bytes);
+    metrics_gauge_set("traffic_replication_lag_rows", NULL, (double)repl->lag_rows);
+    metrics_gauge_set("traffic_replication_lag_seconds", NULL, lag_seconds);
+    metrics_gauge_set("traffic_replication_bytes_sent_total", NULL, (double)repl->bytes_sent);
+    metrics_gauge_set("traffic_replication_files_shipped_total", NULL, (double)repl->files_shipped);
+    metrics_gauge_set("traffic_replication_files_deleted_total", NULL, (double)repl->files_deleted);
+    metrics_gauge_set("traffic_replication_resumed_files_total", NULL, (double)repl->resumed_files);
+    metrics_gauge_set("traffic_replication_tail_rows_total", NULL, (double)repl->tail_rows);
+    metrics_gauge_set("traffic_replication_checksum_failures_total", NULL, (double)repl->checksum_failures);
+    metrics_gauge_set("traffic_replication_connect_failures_total", NULL, (double)repl->connect_failures);
+}
+
+/* ========== 副本 ========== */
+
+/**
+ * @brief 读取指定字节数，等待时同时检查停止通知
+ * @return 0成功，-1连接关闭、超时或正在停止
+ */
+static int replica_read(replica_t *replica, int fd, uint8_t *buf, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        struct pollfd fds[2] = {{fd, POLLIN, 0}, {replica->stop_fd, POLLIN, 0}};
+        int ready = poll(fds, 2, REPLICATION_IO_TIMEOUT_MS);
+        if (ready < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ready <= 0 || fds[1].revents) {
+            return -1;
+        }
+        ssize_t n = recv(fd, buf + done, len - done, 0);
+        if (n > 0) {
+            done += (size_t)n;
+        } else if (!(n < 0 && (errno == EINTR || errno == EAGAIN))) {
+            return -1;
+        }
+    }
+    __atomic_add_fetch(&replica->bytes_received, len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+ * @brief 发送应答
+ */
+static int replica_ack(int fd, replication_ack_t status) {
+    uint8_t msg[MSG_HEADER_SIZE + 1];
+    msg[MSG_HEADER_SIZE] = (uint8_t)status;
+    put_header(msg, 1, REPLICATION_MSG_ACK);
+    return send_full(fd, msg, sizeof(msg));
+}
+
+/**
+ * @brief 发送HELLO：目录中已有的文件 (含未完成的) 和尾部位置
+ * @return 0成功，-1失败
+ */
+static int replica_hello(replica_t *replica, int fd) {
+    replication_file_t *files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    if (list_files(replica->dir, 1, &files, &count, &capacity) < 0) {
+        free(files);
+        return -1;
+    }
+
+    uint8_t *msg = malloc(MSG_HEADER_SIZE + 32 + count * (REPLICATION_NAME_SIZE + 12));
+    int result = -1;
+    if (msg) {
+        uint8_t *p = &msg[MSG_HEADER_SIZE];
+        size_t pos = 4;
+        put_u32(p, REPLICATION_MAGIC);
+        put_varint(p, &pos, REPLICATION_VERSION);
+        put_varint(p, &pos, replica->tail_end > replica->sealed_end ? replica->tail_end : replica->sealed_end);
+        put_varint(p, &pos, count);
+        for (size_t i = 0; i < count; i++) {
+            put_varint(p, &pos, (uint64_t)files[i].partial);
+            put_name(p, &pos, files[i].name);
+            put_varint(p, &pos, files[i].size);
+        }
+        put_header(msg, pos, REPLICATION_MSG_HELLO);
+        result = send_full(fd, msg, MSG_HEADER_SIZE + pos);
+    }
+    free(msg);
+    free(files);
+    return result;
+}
+
+/**
+ * @brief 写入一块数据到未完成文件
+ * @return 0成功，-1偏移不连续或写入失败
+ */
+static int replica_write_chunk(replica_t *replica, const char *name, uint64_t offset, const uint8_t *data,
+                               size_t len) {
+    char path[320];
+    file_path(replica->dir, name, 1, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open replica file %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    // 主节点从副本报告的大小继续；更早的偏移表示重新发送，丢弃之后的内容
+    int result = fstat(fd, &st) == 0 && offset <= (uint64_t)st.st_size &&
+                 (offset == (uint64_t)st.st_size || ftruncate(fd, (off_t)offset) == 0) &&
+                 pwrite(fd, data, len, (off_t)offset) == (ssize_t)len ? 0 : -1;
+    close(fd);
+    return result;
+}
+
+/**
+ * @brief 计算文件的CRC32
+ * @return 0成功，-1无法读取
+ */
+static int file_crc32(int fd, uint64_t size, uint8_t *buffer, uint32_t *crc) {
+    *crc = 0;
+    for (uint64_t pos = 0; pos < size;) {
+        size_t len = size - pos < REPLICATION_CHUNK_BYTES ? (size_t)(size - pos) : REPLICATION_CHUNK_BYTES;
+        if (pread(fd, buffer, len, (off_t)pos) != (ssize_t)len) {
+            return -1;
+        }
+        *crc = calculate_crc32(*crc, buffer, len);
+        pos += len;
+    }
+    return 0;
+}
+
+/**
+ * @brief 尾部日志重写时保留的记录
+ */
+typedef struct {
+    uint64_t sealed_end;        // 已生效的段的行号上界
+    uint8_t *out;               // 保留的记录
+    size_t out_len;             // 保留的字节数
+    uint64_t first_row;         // 保留的最早行号
+} tail_trim_t;
+
+static int trim_visit(void *ctx, const uint8_t *record, size_t record_len, uint64_t first_row, uint64_t rows,
+                      const uint8_t *data) {
+    tail_trim_t *trim = (tail_trim_t *)ctx;
+    (void)data;
+    if (first_row + rows > trim->sealed_end) {
+        if (trim->out_len == 0) {
+            trim->first_row = first_row;
+        }
+        memcpy(&trim->out[trim->out_len], record, record_len);
+        trim->out_len += record_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief 丢弃尾部日志中已被段文件完整覆盖的记录 (写临时文件后改名)
+ */
+static void replica_trim_tail(replica_t *replica) {
+    if (replica->tail_bytes == 0 || replica->sealed_end <= replica->tail_start) {
+        return;
+    }
+    char path[300];
+    char tmp[310];
+    snprintf(path, sizeof(path), "%s/" REPLICATION_TAIL_LOG, replica->dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    size_t len;
+    uint8_t *log = read_file(path, &len);
+    tail_trim_t trim = {replica->sealed_end, malloc(len ? len : 1), 0, 0};
+    if (!log || !trim.out) {
+        free(log);
+        free(trim.out);
+        return;
+    }
+    walk_tail_log(log, len < replica->tail_bytes ? len : (size_t)replica->tail_bytes, trim_visit, &trim);
+
+    int fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd >= 0 && (trim.out_len == 0 || write(fd, trim.out, trim.out_len) == (ssize_t)trim.out_len) &&
+        fdatasync(fd) == 0 && rename(tmp, path) == 0) {
+        close(replica->tail_fd);
+        replica->tail_fd = fd;
+        replica->tail_bytes = trim.out_len;
+        replica->tail_start = trim.out_len ? trim.first_row : replica->tail_end;
+    } else {
+        LOG_WARN("Failed to trim replica tail log %s: %s", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(tmp);
+    }
+    free(log);
+    free(trim.out);
+}
+
+/**
+ * @brief 提交文件：校验大小和整个文件的CRC32后改名生效
+ * @return 应答状态
+ */
+static replication_ack_t replica_commit(replica_t *replica, const char *name, uint64_t size, uint64_t crc) {
+    char part[320];
+    char path[320];
+    file_path(replica->dir, name, 1, part, sizeof(part));
+    file_path(replica->dir, name, 0, path, sizeof(path));
+    int fd = open(part, O_RDWR);
+    struct stat st;
+    uint32_t actual;
+    if (fd < 0 || fstat(fd, &st) < 0 || (uint64_t)st.st_size != size ||
+        file_crc32(fd, size, replica->buffer, &actual) < 0 || actual != crc) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(part);
+        __atomic_add_fetch(&replica->checksum_failures, 1, __ATOMIC_RELAXED);
+        LOG_WARN("Replica discarded %s: size or checksum mismatch", name);
+        return REPLICATION_ACK_CHECKSUM;
+    }
+    int synced = fdatasync(fd);
+    close(fd);
+    if (synced < 0 || rename(part, path) < 0) {
+        LOG_ERROR("Failed to commit replica file %s: %s", path, strerror(errno));
+        return REPLICATION_ACK_ERROR;
+    }
+
+    __atomic_add_fetch(&replica->files_committed, 1, __ATOMIC_RELAXED);
+    uint64_t end = segment_end(path);
+    if (end > replica->sealed_end) {
+        __atomic_store_n(&replica->sealed_end, end, __ATOMIC_RELAXED);
+        replica_trim_tail(replica);
+    }
+    return REPLICATION_ACK_OK;
+}
+
+/**
+ * @brief 追加一条尾部记录并落盘
+ * @return 应答状态
+ */
+static replication_ack_t replica_append_tail(replica_t *replica, const uint8_t *payload, size_t len) {
+    uint64_t first_row;
+    uint64_t rows;
+    const uint8_t *data;
+    int decoded = decode_tail(payload, len, &first_row, &rows, &data);
+    if (decoded == -2) {
+        __atomic_add_fetch(&replica->checksum_failures, 1, __ATOMIC_RELAXED);
+        return REPLICATION_ACK_CHECKSUM;
+    }
+    if (decoded < 0) {
+        return REPLICATION_ACK_ERROR;
+    }
+    if (first_row + rows <= replica->tail_end) {
+        return REPLICATION_ACK_OK;      // 重复发送
+    }
+    if (first_row < replica->tail_end) {
+        return REPLICATION_ACK_ERROR;
+    }
+
+    uint8_t prefix[4];
+    put_u32(prefix, (uint32_t)len);
+    if (pwrite(replica->tail_fd, prefix, 4, (off_t)replica->tail_bytes) != 4 ||
+        pwrite(replica->tail_fd, payload, len, (off_t)replica->tail_bytes + 4) != (ssize_t)len ||
+        fdatasync(replica->tail_fd) < 0) {
+        LOG_ERROR("Failed to append replica tail log: %s", strerror(errno));
+        return REPLICATION_ACK_ERROR;
+    }
+    if (replica->tail_bytes == 0) {
+        replica->tail_start = first_row;
+    }
+    replica->tail_bytes += 4 + len;
+    __atomic_store_n(&replica->tail_end, first_row + rows, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&replica->tail_rows, rows, __ATOMIC_RELAXED);
+    return REPLICATION_ACK_OK;
+}
+
+/**
+ * @brief 处理一个主节点的连接，直到断开、报文错误或停止
+ */
+static void replica_session(replica_t *replica, int fd) {
+    struct timeval timeout = {REPLICATION_IO_TIMEOUT_MS / 1000, (REPLICATION_IO_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (replica_hello(replica, fd) < 0) {
+        return;
+    }
+
+    uint8_t header[MSG_HEADER_SIZE];
+    uint8_t *p = replica->buffer;
+    while (replica_read(replica, fd, header, sizeof(header)) == 0) {
+        size_t len = get_u32(header);
+        if (len > MAX_PAYLOAD || replica_read(replica, fd, p, len) < 0) {
+            break;
+        }
+        size_t pos = 0;
+        char name[REPLICATION_NAME_SIZE];
+        uint64_t v[2];
+        int status = -1;
+        switch (header[4]) {
+            case REPLICATION_MSG_DATA:
+                // 数据块不应答，校验失败时丢弃未完成文件并断开，主节点重连后从头发送
+                if (get_name(p, len, &pos, name) < 0 || get_varint(p, len, &pos, &v[0]) < 0 ||
+                    get_varint(p, len, &pos, &v[1]) < 0) {
+                    break;
+                }
+                if (calculate_crc32(0, &p[pos], len - pos) != v[1]) {
+                    char part[320];
+                    file_path(replica->dir, name, 1, part, sizeof(part));
+                    unlink(part);
+                    __atomic_add_fetch(&replica->checksum_failures, 1, __ATOMIC_RELAXED);
+                    LOG_WARN("Replica discarded %s: chunk checksum mismatch at offset %llu", name,
+                             (unsigned long long)v[0]);
+                    break;
+                }
+                if (replica_write_chunk(replica, name, v[0], &p[pos], len - pos) == 0) {
+                    continue;
+                }
+                break;
+            case REPLICATION_MSG_COMMIT:
+                if (get_name(p, len, &pos, name) == 0 && get_varint(p, len, &pos, &v[0]) == 0 &&
+                    get_varint(p, len, &pos, &v[1]) == 0 && pos == len) {
+                    status = replica_commit(replica, name, v[0], v[1]);
+                }
+                break;
+            case REPLICATION_MSG_DELETE:
+                if (get_name(p, len, &pos, name) == 0 && pos == len) {
+                    char path[320];
+                    file_path(replica->dir, name, 1, path, sizeof(path));
+                    unlink(path);
+                    file_path(replica->dir, name, 0, path, sizeof(path));
+                    if (unlink(path) == 0) {
+                        __atomic_add_fetch(&replica->files_deleted, 1, __ATOMIC_RELAXED);
+                    }
+                    status = REPLICATION_ACK_OK;
+                }
+                break;
+            case REPLICATION_MSG_TAIL:
+                status = replica_append_tail(replica, p, len);
+                break;
+            default:
+                break;
+        }
+        if (status < 0 || replica_ack(fd, (replication_ack_t)status) < 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 接收线程：逐个接受主节点的连接，收到停止通知后退出
+ */
+static void *replica_thread(void *arg) {
+    replica_t *replica = (replica_t *)arg;
+    struct pollfd fds[2] = {{replica->listen_fd, POLLIN, 0}, {replica->stop_fd, POLLIN, 0}};
+    while (1) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        int fd = accept(replica->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        __atomic_add_fetch(&replica->sessions, 1, __ATOMIC_RELAXED);
+        replica_session(replica, fd);
+        close(fd);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 打开尾部日志，截掉末尾不完整或校验失败的记录
+ * @return 0成功，-1失败
+ */
+static int replica_open_tail(replica_t *replica) {
+    char path[300];
+    snprintf(path, sizeof(path), "%s/" REPLICATION_TAIL_LOG, replica->dir);
+    size_t len;
+    uint8_t *log = read_file(path, &len);
+    replica->tail_bytes = 0;
+    replica->tail_start = replica->tail_end = 0;
+    if (log) {
+        replica->tail_bytes = walk_tail_log(log, len, NULL, NULL);
+        // 记录按行号连续追加，首条和末条给出范围
+        uint64_t rows;
+        const uint8_t *data;
+        size_t pos = 0;
+        while (pos < replica->tail_bytes) {
+            uint32_t record_len = get_u32(&log[pos]);
+            uint64_t first_row;
+            decode_tail(&log[pos + 4], record_len, &first_row, &rows, &data);
+            if (pos == 0) {
+                replica->tail_start = first_row;
+            }
+            replica->tail_end = first_row + rows;
+            pos += 4 + (size_t)record_len;
+        }
+        if (replica->tail_bytes < len) {
+            LOG_WARN("Replica tail log truncated from %zu to %llu bytes", len,
+                     (unsigned long long)replica->tail_bytes);
+        }
+        free(log);
+    }
+
+    replica->tail_fd = open(path, O_CREAT | O_RDWR, 0644);
+    if (replica->tail_fd < 0 || ftruncate(replica->tail_fd, (off_t)replica->tail_bytes) < 0) {
+        LOG_ERROR("Failed to open replica tail log %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (replica->tail_bytes == 0) {
+        replica->tail_start = replica->tail_end = replica->sealed_end;
+    }
+    return 0;
+}
+
+/**
+ * @brief 打开副本目录并开始接收
+ */
+int replica_start(replica_t *replica, const char *dir, int port) {
+    if (!replica || !dir || port < 0 || port > 65535 || strlen(dir) >= sizeof(replica->dir)) {
+        return -1;
+    }
+
+    memset(replica, 0, sizeof(replica_t));
+    replica->listen_fd = replica->stop_fd = replica->tail_fd = -1;
+    snprintf(replica->dir, sizeof(replica->dir), "%s", dir);
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        LOG_ERROR("Failed to create replica directory %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    for (int t = 0; t < 2; t++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", dir, tier_dirs[t]);
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+            LOG_ERROR("Failed to create replica directory %s: %s", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    replication_file_t *files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    if (list_files(dir, 1, &files, &count, &capacity) < 0) {
+        free(files);
+        return -1;
+    }
+    replica->sealed_end = scan_sealed_end(dir, files, count);
+    free(files);
+
+    replica->buffer = malloc(MSG_HEADER_SIZE + MAX_PAYLOAD);
+    if (!replica->buffer || replica_open_tail(replica) < 0) {
+        replica_stop(replica);
+        return -1;
+    }
+    replica_trim_tail(replica);
+
+    replica->listen_fd = create_tcp_server(port);
+    replica->stop_fd = eventfd(0, EFD_CLOEXEC);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    if (replica->listen_fd < 0 || replica->stop_fd < 0 ||
+        getsockname(replica->listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        LOG_ERROR("Failed to listen for history replication on port %d", port);
+        replica_stop(replica);
+        return -1;
+    }
+    replica->port = ntohs(addr.sin_port);
+    if (pthread_create(&replica->thread, NULL, replica_thread, replica) != 0) {
+        replica_stop(replica);
+        return -1;
+    }
+    replica->running = 1;
+
+    LOG_INFO("History replica at %s listening on port %d - sealed rows up to %llu, tail up to %llu", dir,
+             replica->port, (unsigned long long)replica->sealed_end, (unsigned long long)replica->tail_end);
+    return 0;
+}
+
+/**
+ * @brief 停止接收并关闭副本
+ */
+void replica_stop(replica_t *replica) {
+    if (!replica) {
+        return;
+    }
+    if (replica->running) {
+        uint64_t one = 1;
+        if (write(replica->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+            LOG_WARN("Failed to notify history replica thread");
+        }
+        pthread_join(replica->thread, NULL);
+        replica->running = 0;
+    }
+    if (replica->listen_fd >= 0) {
+        close(replica->listen_fd);
+    }
+    if (replica->stop_fd >= 0) {
+        close(replica->stop_fd);
+    }
+    if (replica->tail_fd >= 0) {
+        close(replica->tail_fd);
+    }
+    replica->listen_fd = replica->stop_fd = replica->tail_fd = -1;
+    free(replica->buffer);
+    replica->buffer = NULL;
+}
+
+/**
+ * @brief 导出副本指标
+ */
+void replica_export_metrics(replica_t *replica) {
+    if (!replica) {
+        return;
+    }
+    metrics_gauge_set("traffic_replica_sessions_total", NULL,
+                      (double)__atomic_load_n(&replica->sessions, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_bytes_received_total", NULL,
+                      (double)__atomic_load_n(&replica->bytes_received, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_files_committed_total", NULL,
+                      (double)__atomic_load_n(&replica->files_committed, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_files_deleted_total", NULL,
+                      (double)__atomic_load_n(&replica->files_deleted, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_tail_rows_total", NULL,
+                      (double)__atomic_load_n(&replica->tail_rows, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_checksum_failures_total", NULL,
+                      (double)__atomic_load_n(&replica->checksum_failures, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_sealed_end_row", NULL,
+                      (double)__atomic_load_n(&replica->sealed_end, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_replica_tail_end_row", NULL,
+                      (double)__atomic_load_n(&replica->tail_end, __ATOMIC_RELAXED));
+}
+
+/**
+ * @brief 提升时把尾部日志中的行写为温层段
+ */
+typedef struct {
+    const char *dir;            // 存储目录
+    uint64_t sealed_end;        // 已生效的段的行号上界 (之前的行不再写出)
+    realtime_columns_t cols;    // 当前段的行
+    uint64_t first_row;         // 当前段的首行行号
+    int64_t rows;               // 已写出的行数
+    int failed;                 // 写段文件失败
+} tail_promote_t;
+
+/**
+ * @brief 写出当前段
+ */
+static void promote_flush(tail_promote_t *promote) {
+    if (promote->cols.count == 0 || promote->failed) {
+        return;
+    }
+    if (history_write_segment(promote->dir, HISTORY_TIER_WARM, &promote->cols, promote->first_row) < 0) {
+        promote->failed = 1;
+        return;
+    }
+    promote->rows += (int64_t)promote->cols.count;
+    promote->cols.count = 0;
+}
+
+static int promote_visit(void *ctx, const uint8_t *record, size_t record_len, uint64_t first_row, uint64_t rows,
+                         const uint8_t *data) {
+    tail_promote_t *promote = (tail_promote_t *)ctx;
+    (void)record;
+    (void)record_len;
+    uint64_t skip = promote->sealed_end > first_row ? promote->sealed_end - first_row : 0;
+    if (skip >= rows) {
+        return 0;
+    }
+    // 行号不连续 (主节点热层淘汰了未复制的行) 或段已满时另起一段
+    uint64_t start = first_row + skip;
+    size_t take = (size_t)(rows - skip);
+    if (promote->cols.count && (promote->first_row + promote->cols.count != start ||
+                                promote->cols.count + take > REALTIME_STORE_CHUNK_ROWS)) {
+        promote_flush(promote);
+    }
+    if (promote->failed || realtime_columns_reserve(&promote->cols, promote->cols.count + take) < 0) {
+        promote->failed = 1;
+        return 1;
+    }
+    if (promote->cols.count == 0) {
+        promote->first_row = start;
+    }
+    size_t offset = 0;
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        size_t item = realtime_column_info[i].item_size;
+        memcpy((uint8_t *)realtime_column_data(&promote->cols, i) + promote->cols.count * item,
+               &data[offset + skip * item], take * item);
+        offset += rows * item;
+    }
+    promote->cols.count += take;
+    return 0;
+}
+
+/**
+ * @brief 把副本目录提升为主节点目录
+ */
+int64_t replica_promote(const char *dir) {
+    if (!dir) {
+        return -1;
+    }
+
+    replication_file_t *files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    if (list_files(dir, 1, &files, &count, &capacity) < 0) {
+        free(files);
+        return -1;
+    }
+
+    tail_promote_t promote;
+    memset(&promote, 0, sizeof(promote));
+    promote.dir = dir;
+    promote.sealed_end = scan_sealed_end(dir, files, count);
+    char path[320];
+    snprintf(path, sizeof(path), "%s/" REPLICATION_TAIL_LOG, dir);
+    size_t len;
+    uint8_t *log = read_file(path, &len);
+    if (log) {
+        if (realtime_columns_init(&promote.cols, REALTIME_STORE_CHUNK_ROWS) < 0) {
+            free(log);
+            free(files);
+            return -1;
+        }
+        walk_tail_log(log, len, promote_visit, &promote);
+        promote_flush(&promote);
+        realtime_columns_free(&promote.cols);
+        free(log);
+    }
+    if (promote.failed) {
+        LOG_ERROR("Failed to promote replica at %s: could not write tail segments", dir);
+        free(files);
+        return -1;
+    }
+
+    // 尾部日志已写为段；未完成的文件不完整，不能作为段使用
+    unlink(path);
+    for (size_t i = 0; i < count; i++) {
+        if (files[i].partial) {
+            file_path(dir, files[i].name, 1, path, sizeof(path));
+            unlink(path);
+        }
+    }
+    free(files);
+    LOG_INFO("Promoted history replica at %s - %lld rows recovered from the tail log after row %llu", dir,
+             (long long)promote.rows, (unsigned long long)promote.sealed_end);
+    return promote.rows;
+}
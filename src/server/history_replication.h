@@ -0,0 +1,225 @@
+/**
+ * @file history_replication.h
+ * @brief 历史段文件和热层尾部的异步复制
+ *
+ * 主节点的复制线程 (replication_t) 周期性地把本地的段文件和热层中的最新行发送到副本进程
+ * (replica_t，例如另一台控制机)，主节点磁盘损坏时历史数据不丢失：
+ *   段文件  写完后不再修改，按块发送，每块和整个文件各带CRC32，副本校验后改名生效；
+ *           连接中断后副本报告未完成文件的已收字节数，从断点继续发送；
+ *           主节点已删除的段 (压缩为冷层或从冷层删除) 在副本上同样删除；
+ *   尾部    热层中尚未写成段文件的行按行号顺序追加到副本的尾部日志，
+ *           副本确认已落盘后推进复制位置，相当于只发送日志增量。
+ * 复制与接收路径共享磁盘和网络，max_bytes_per_sec限制发送速率 (令牌桶)，读段文件经异步I/O。
+ * 副本提升为主节点时 (replica_promote) 把尾部日志中段文件之后的行写为温层段，
+ * 之后目录可以直接由history_init打开并提供查询。
+ *
+ * 报文格式 (小端)：4字节负载长度 + 1字节类型 + 负载，负载中的整数为变长编码，名称为长度 + 字节。
+ *   HELLO   副本在连接建立后发送：魔数、版本、尾部日志的行号上界、已有文件 (含未完成的) 及大小
+ *   DATA    文件名、偏移、本块CRC32、数据
+ *   COMMIT  文件名、文件大小、整个文件的CRC32 (副本应答)
+ *   DELETE  文件名 (副本应答)
+ *   TAIL    首行行号、行数、CRC32、按列存放的行数据 (副本应答)
+ *   ACK     状态 (0成功，1校验失败，2其他错误)
+ */
+
+#ifndef HISTORY_REPLICATION_H
+#define HISTORY_REPLICATION_H
+
+#include "history_store.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REPLICATION_MAGIC 0x52505054u           // "TPPR"
+#define REPLICATION_VERSION 1                   // 报文版本
+#define REPLICATION_DEFAULT_INTERVAL_MS 1000    // 默认复制周期
+#define REPLICATION_CHUNK_BYTES (256 * 1024)    // 段文件每块的最大字节数
+#define REPLICATION_TAIL_ROWS 8192              // 每条尾部报文的最大行数
+#define REPLICATION_IO_TIMEOUT_MS 5000          // 等待应答和收发报文的超时
+#define REPLICATION_TAIL_LOG "replica-tail"     // 副本目录下的尾部日志文件名
+#define REPLICATION_NAME_SIZE 32                // 文件名 ("warm/seg-<20位行号>") 缓冲区大小
+
+/**
+ * @brief 报文类型
+ */
+typedef enum {
+    REPLICATION_MSG_HELLO = 1,  // 副本已有的文件和尾部位置
+    REPLICATION_MSG_DATA = 2,   // 段文件的一块
+    REPLICATION_MSG_COMMIT = 3, // 段文件结束
+    REPLICATION_MSG_DELETE = 4, // 删除段文件
+    REPLICATION_MSG_TAIL = 5,   // 热层尾部的一批行
+    REPLICATION_MSG_ACK = 6     // 应答
+} replication_msg_t;
+
+/**
+ * @brief 应答状态
+ */
+typedef enum {
+    REPLICATION_ACK_OK = 0,         // 成功
+    REPLICATION_ACK_CHECKSUM = 1,   // 校验失败 (已丢弃)
+    REPLICATION_ACK_ERROR = 2       // 其他错误
+} replication_ack_t;
+
+/**
+ * @brief 副本上的一个文件
+ */
+typedef struct {
+    char name[REPLICATION_NAME_SIZE]; // 相对于存储目录的路径
+    uint64_t size;              // 大小 (未完成的文件为已收字节数)
+    int partial;                // 是否未完成
+} replication_file_t;
+
+/**
+ * @brief 复制配置
+ */
+typedef struct {
+    const char *host;           // 副本地址 (IPv4)
+    int port;                   // 副本端口
+    uint64_t max_bytes_per_sec; // 发送速率上限，0表示不限
+    int interval_ms;            // 复制周期，0表示默认值
+} replication_config_t;
+
+/**
+ * @brief 主节点的复制状态
+ */
+typedef struct {
+    history_store_t *hist;      // 历史存储
+    char host[64];              // 副本地址
+    int port;                   // 副本端口
+    uint64_t max_bytes_per_sec; // 发送速率上限
+    int interval_ms;            // 复制周期
+    int fd;                     // 到副本的连接，-1表示未连接
+    uint8_t *buffer;            // 报文缓冲区
+
+    replication_file_t *remote; // 副本已有的文件
+    size_t remote_count;        // 文件数
+    size_t remote_capacity;     // 数组容量
+    uint64_t tail_end;          // 副本尾部日志的行号上界
+
+    double tokens;              // 令牌桶中可发送的字节数 (可为负)
+    int64_t tokens_ns;          // 上次补充令牌的时间
+
+    pthread_t thread;           // 复制线程
+    pthread_mutex_t lock;       // 配合wakeup等待
+    pthread_cond_t wakeup;      // 唤醒复制线程
+    int running;                // 复制线程是否运行
+    int stopping;               // 正在停止 (中断限速等待)
+
+    uint64_t bytes_sent;        // 累计发送的字节数
+    uint64_t files_shipped;     // 累计复制完成的段文件数
+    uint64_t files_deleted;     // 累计在副本上删除的段文件数
+    uint64_t resumed_files;     // 从断点继续发送的段文件数
+    uint64_t checksum_failures; // 副本校验失败的段文件和尾部报文数
+    uint64_t tail_rows;         // 累计复制的尾部行数
+    uint64_t connect_failures;  // 连接或握手失败次数
+    int connected;              // 是否已连接
+    uint64_t lag_bytes;         // 副本尚缺的段文件字节数
+    uint64_t lag_rows;          // 热层已追加但副本尚未落盘的行数
+    int64_t caught_up_ns;       // 副本最近一次追平的时间 (单调时钟)
+} replication_t;
+
+/**
+ * @brief 副本进程中的接收端
+ */
+typedef struct {
+    char dir[256];              // 存储目录 (与主节点的布局相同)
+    int listen_fd;              // 监听socket
+    int stop_fd;                // 停止通知 (eventfd)
+    int port;                   // 实际监听端口
+    pthread_t thread;           // 接收线程 (一次服务一个主节点)
+    int running;                // 接收线程是否运行
+    uint8_t *buffer;            // 报文缓冲区
+
+    int tail_fd;                // 尾部日志
+    uint64_t tail_bytes;        // 尾部日志中有效记录的字节数
+    uint64_t tail_start;        // 尾部日志中最早的行号
+    uint64_t tail_end;          // 尾部日志的行号上界
+    uint64_t sealed_end;        // 已生效的段文件 (不含导入段) 的行号上界
+
+    uint64_t sessions;          // 累计接受的连接数
+    uint64_t bytes_received;    // 累计接收的字节数
+    uint64_t files_committed;   // 累计生效的段文件数
+    uint64_t files_deleted;     // 累计删除的段文件数
+    uint64_t tail_rows;         // 累计写入尾部日志的行数
+    uint64_t checksum_failures; // 校验失败的块、文件和尾部报文数
+} replica_t;
+
+/**
+ * @brief 初始化复制 (不连接，不启动线程)
+ * @param repl 复制指针
+ * @param hist 历史存储
+ * @param config 配置
+ * @return 0成功，-1失败
+ */
+int replication_init(replication_t *repl, history_store_t *hist, const replication_config_t *config);
+
+/**
+ * @brief 执行一轮复制：必要时连接副本，发送缺少的段文件、删除多余的段文件，再发送热层尾部
+ * @param repl 复制指针
+ * @return 0副本已追平，-1失败 (断开连接，下一轮重连并从断点继续)
+ */
+int replication_run_once(replication_t *repl);
+
+/**
+ * @brief 启动复制线程 (按周期执行replication_run_once并导出指标)
+ * @param repl 复制指针
+ * @return 0成功，-1失败
+ */
+int replication_start(replication_t *repl);
+
+/**
+ * @brief 停止复制线程
+ * @param repl 复制指针
+ */
+void replication_stop(replication_t *repl);
+
+/**
+ * @brief 停止复制线程、断开连接并释放资源
+ * @param repl 复制指针
+ */
+void replication_destroy(replication_t *repl);
+
+/**
+ * @brief 导出复制延迟 (字节、行、秒) 和发送量指标
+ * @param repl 复制指针
+ */
+void replication_export_metrics(replication_t *repl);
+
+/**
+ * @brief 打开副本目录并开始接收
+ * @param replica 副本指针
+ * @param dir 存储目录 (不存在时创建)
+ * @param port 监听端口，0表示由系统分配 (实际端口见replica->port)
+ * @return 0成功，-1失败
+ */
+int replica_start(replica_t *replica, const char *dir, int port);
+
+/**
+ * @brief 停止接收并关闭副本 (未完成的文件保留，下次从断点继续)
+ * @param replica 副本指针
+ */
+void replica_stop(replica_t *replica);
+
+/**
+ * @brief 导出副本的接收量和复制位置指标
+ * @param replica 副本指针
+ */
+void replica_export_metrics(replica_t *replica);
+
+/**
+ * @brief 把已停止的副本目录提升为主节点目录：尾部日志中段文件之后的行写为温层段，
+ *        删除尾部日志和未完成的文件
+ * @param dir 副本的存储目录
+ * @return 从尾部日志恢复的行数，-1失败
+ */
+int64_t replica_promote(const char *dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_REPLICATION_H
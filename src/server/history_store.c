@@ -0,0 +1,1804 @@
+/**
+ * @file history_store.c
+ * @brief 实时信息的分层历史存储实现
+ */
+
+#include "history_store.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VARINT_MAX_BYTES 10     // 64位变长整数的最大字节数
+
+static const char *tier_names[HISTORY_TIER_COUNT] = {"hot", "warm", "cold"};
+
+/**
+ * @brief 层名称
+ */
+const char *history_tier_name(history_tier_t tier) {
+    return (unsigned)tier < HISTORY_TIER_COUNT ? tier_names[tier] : "unknown";
+}
+
+/**
+ * @brief 每行各列的字节数之和
+ */
+static size_t row_bytes(void) {
+    size_t bytes = 0;
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        bytes += realtime_column_info[i].item_size;
+    }
+    return bytes;
+}
+
+/**
+ * @brief 向上对齐到列对齐字节数
+ */
+static inline uint64_t align_up(uint64_t value) {
+    return (value + HISTORY_COLUMN_ALIGN - 1) & ~(uint64_t)(HISTORY_COLUMN_ALIGN - 1);
+}
+
+/**
+ * @brief 按列宽读取一个值 (int64列按有符号，其余按无符号)
+ */
+static inline int64_t load_value(const void *column, size_t item_size, size_t row) {
+    switch (item_size) {
+        case 1:
+            return ((const uint8_t *)column)[row];
+        case 2:
+            return ((const uint16_t *)column)[row];
+        case 4:
+            return ((const uint32_t *)column)[row];
+        default:
+            return ((const int64_t *)column)[row];
+    }
+}
+
+/**
+ * @brief 按列宽写入一个值
+ */
+static inline void store_value(void *column, size_t item_size, size_t row, int64_t value) {
+    switch (item_size) {
+        case 1:
+            ((uint8_t *)column)[row] = (uint8_t)value;
+            break;
+        case 2:
+            ((uint16_t *)column)[row] = (uint16_t)value;
+            break;
+        case 4:
+            ((uint32_t *)column)[row] = (uint32_t)value;
+            break;
+        default:
+            ((int64_t *)column)[row] = value;
+            break;
+    }
+}
+
+/**
+ * @brief 写一个变长整数
+ */
+static inline size_t put_varint(uint8_t *dst, uint64_t value) {
+    size_t len = 0;
+    while (value >= 0x80) {
+        dst[len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    dst[len++] = (uint8_t)value;
+    return len;
+}
+
+/**
+ * @brief 读一个变长整数
+ * @return 0成功，-1数据损坏
+ */
+static inline int get_varint(const uint8_t *src, size_t len, size_t *pos, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*pos >= len) {
+            return -1;
+        }
+        uint8_t byte = src[(*pos)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 一列按差分 + zigzag + 变长整数编码
+ * 非零差分写为其zigzag值 (不为0)；连续的零差分写为0后跟重复次数，
+ * 同一帧各通道相同的设备标识、采集时间等列因此每帧只占几个字节
+ * @param item_size 列宽 (调用处为常量，内联后按列宽展开)
+ * @return 编码后的字节数
+ */
+static inline size_t encode_values(uint8_t *dst, const void *column, size_t item_size, size_t rows) {
+    size_t len = 0;
+    size_t run = 0;
+    int64_t previous = 0;
+    for (size_t r = 0; r < rows; r++) {
+        int64_t value = load_value(column, item_size, r);
+        int64_t delta = (int64_t)((uint64_t)value - (uint64_t)previous);
+        previous = value;
+        if (delta == 0) {
+            run++;
+            continue;
+        }
+        if (run > 0) {
+            dst[len++] = 0;
+            len += put_varint(dst + len, run);
+            run = 0;
+        }
+        len += put_varint(dst + len, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+    }
+    if (run > 0) {
+        dst[len++] = 0;
+        len += put_varint(dst + len, run);
+    }
+    return len;
+}
+
+/**
+ * @brief 按列宽编码一列
+ */
+static size_t encode_column(uint8_t *dst, const void *column, size_t item_size, size_t rows) {
+    switch (item_size) {
+        case 1:
+            return encode_values(dst, column, 1, rows);
+        case 2:
+            return encode_values(dst, column, 2, rows);
+        case 4:
+            return encode_values(dst, column, 4, rows);
+        default:
+            return encode_values(dst, column, 8, rows);
+    }
+}
+
+/**
+ * @brief 解码一列
+ * @return 0成功，-1数据损坏
+ */
+static int decode_column(void *column, size_t item_size, size_t rows, const uint8_t *src, size_t len) {
+    size_t pos = 0;
+    size_t r = 0;
+    int64_t previous = 0;
+    while (r < rows) {
+        uint64_t token;
+        if (get_varint(src, len, &pos, &token) < 0) {
+            return -1;
+        }
+        if (token == 0) {
+            uint64_t run;
+            if (get_varint(src, len, &pos, &run) < 0 || run == 0 || run > rows - r) {
+                return -1;
+            }
+            for (uint64_t i = 0; i < run; i++) {
+                store_value(column, item_size, r++, previous);
+            }
+            continue;
+        }
+        int64_t delta = (int64_t)(token >> 1) ^ -(int64_t)(token & 1);
+        previous = (int64_t)((uint64_t)previous + (uint64_t)delta);
+        store_value(column, item_size, r++, previous);
+    }
+    return pos == len ? 0 : -1;
+}
+
+/**
+ * @brief 增加段引用
+ */
+static void segment_retain(history_segment_t *segment) {
+    __atomic_add_fetch(&segment->refs, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 释放段引用，最后一个引用释放时解除映射
+ */
+static void segment_release(history_segment_t *segment) {
+    if (segment && __atomic_sub_fetch(&segment->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        if (segment->map) {
+            munmap(segment->map, segment->file_bytes);
+        }
+        pthread_mutex_destroy(&segment->load_lock);
+        free(segment);
+    }
+}
+
+/**
+ * @brief 段文件路径
+ */
+static void segment_path(const char *dir, history_tier_t tier, uint64_t first_row,
+                         char *path, size_t size) {
+    snprintf(path, size, "%s/%s/seg-%020llu", dir, tier_names[tier], (unsigned long long)first_row);
+}
+
+/**
+ * @brief 段在段列表中的排序键：导入段在前，各自按首行行号递增
+ */
+static inline uint64_t segment_order(uint64_t first_row) {
+    return first_row ^ HISTORY_IMPORT_ROW_BIT;
+}
+
+/**
+ * @brief 完整写入 (配置了异步I/O时由I/O线程执行，io为NULL时直接写入)
+ */
+static int write_all(async_io_t *io, int fd, const void *data, size_t len, off_t offset) {
+    int64_t n = async_io_run(io, ASYNC_IO_WRITE, fd, (void *)data, len, (uint64_t)offset);
+    if (n < 0) {
+        errno = (int)-n;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 校验段文件头
+ */
+static int validate_header(const history_segment_header_t *header, history_tier_t tier, size_t file_bytes) {
+    if (memcmp(header->magic, HISTORY_SEGMENT_MAGIC, 4) != 0 ||
+        header->version != HISTORY_SEGMENT_VERSION || header->tier != (uint32_t)tier ||
+        header->row_count == 0) {
+        return -1;
+    }
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        uint64_t offset = header->column_offset[i];
+        uint64_t bytes = header->column_bytes[i];
+        if (offset < sizeof(history_segment_header_t) || offset > file_bytes ||
+            bytes > file_bytes - offset) {
+            return -1;
+        }
+        if (tier == HISTORY_TIER_WARM &&
+            (bytes != (uint64_t)header->row_count * realtime_column_info[i].item_size ||
+             offset % HISTORY_COLUMN_ALIGN != 0)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 创建段 (未加载，引用计数为1)
+ */
+static history_segment_t *segment_new(const char *path, history_tier_t tier) {
+    size_t len = strlen(path);
+    history_segment_t *segment = len < sizeof(segment->path) ? calloc(1, sizeof(history_segment_t)) : NULL;
+    if (!segment) {
+        return NULL;
+    }
+    segment->tier = tier;
+    memcpy(segment->path, path, len + 1);
+    segment->refs = 1;
+    pthread_mutex_init(&segment->load_lock, NULL);
+    return segment;
+}
+
+/**
+ * @brief 读取段文件头，温层段建立映射
+ * @param check 是否核对目录记录中的行号、行数、时间范围和文件大小
+ * @return 0成功，-1失败
+ */
+static int segment_read_file(history_segment_t *segment, int check) {
+    int fd = open(segment->path, O_RDONLY);
+    if (fd < 0) {
+        LOG_WARN("Failed to open history segment %s: %s", segment->path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        pread(fd, &segment->header, sizeof(segment->header), 0) != (ssize_t)sizeof(segment->header) ||
+        validate_header(&segment->header, segment->tier, (size_t)st.st_size) < 0 ||
+        (check && (segment->header.first_row != segment->first_row ||
+                   segment->header.row_count != segment->rows ||
+                   segment->header.min_timestamp_ms != segment->min_timestamp_ms ||
+                   segment->header.max_timestamp_ms != segment->max_timestamp_ms ||
+                   (size_t)st.st_size != segment->file_bytes))) {
+        LOG_WARN("Ignoring invalid history segment %s", segment->path);
+        close(fd);
+        return -1;
+    }
+
+    segment->file_bytes = (size_t)st.st_size;
+    if (segment->tier == HISTORY_TIER_WARM) {
+        void *map = mmap(NULL, segment->file_bytes, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            LOG_WARN("Failed to map history segment %s: %s", segment->path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        segment->map = map;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief 打开段文件，温层段建立映射
+ * @return 段指针 (已加载，引用计数为1)，失败返回NULL
+ */
+static history_segment_t *segment_open(const char *path, history_tier_t tier) {
+    history_segment_t *segment = segment_new(path, tier);
+    if (!segment) {
+        return NULL;
+    }
+    if (segment_read_file(segment, 0) < 0) {
+        segment->refs = 0;
+        pthread_mutex_destroy(&segment->load_lock);
+        free(segment);
+        return NULL;
+    }
+
+    segment->first_row = segment->header.first_row;
+    segment->rows = segment->header.row_count;
+    segment->min_timestamp_ms = segment->header.min_timestamp_ms;
+    segment->max_timestamp_ms = segment->header.max_timestamp_ms;
+    segment->state = 1;
+    return segment;
+}
+
+/**
+ * @brief 按目录记录创建段，不打开文件
+ * @return 段指针 (未加载，引用计数为1)，失败返回NULL
+ */
+static history_segment_t *segment_from_catalog(const char *path, const history_catalog_record_t *record) {
+    history_segment_t *segment = segment_new(path, (history_tier_t)record->tier);
+    if (!segment) {
+        return NULL;
+    }
+    segment->first_row = record->first_row;
+    segment->rows = record->rows;
+    segment->min_timestamp_ms = record->min_timestamp_ms;
+    segment->max_timestamp_ms = record->max_timestamp_ms;
+    segment->file_bytes = (size_t)record->file_bytes;
+    return segment;
+}
+
+/**
+ * @brief 首次访问时加载段 (读取文件头、温层段建立映射)，可在任意线程调用
+ * @return 0已加载，-1加载失败 (之后的访问同样失败)
+ */
+static int segment_load(history_store_t *hist, history_segment_t *segment, int lazy) {
+    int state = __atomic_load_n(&segment->state, __ATOMIC_ACQUIRE);
+    if (state != 0) {
+        return state > 0 ? 0 : -1;
+    }
+
+    pthread_mutex_lock(&segment->load_lock);
+    state = __atomic_load_n(&segment->state, __ATOMIC_ACQUIRE);
+    if (state == 0) {
+        state = segment_read_file(segment, 1) == 0 ? 1 : -1;
+        __atomic_store_n(&segment->state, state, __ATOMIC_RELEASE);
+        if (state > 0 && lazy) {
+            __atomic_add_fetch(&hist->lazy_loads, 1, __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&segment->load_lock);
+    return state > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 写段文件：先写临时文件，同步后改名
+ * 导入段的临时文件不以seg-开头，运行中的存储重启时不会删除导入工具正在写的文件
+ * @return 文件大小，-1失败
+ */
+static int64_t write_segment_file(async_io_t *io, const char *dir, history_tier_t tier,
+                                  const realtime_columns_t *cols, size_t rows, uint64_t first_row, int64_t min_ts, int64_t max_ts,
+                                  char *path, size_t path_size) {
+    int cold = tier == HISTORY_TIER_COLD;
+    char tmp[336];
+    segment_path(dir, tier, first_row, path, path_size);
+    if (first_row & HISTORY_IMPORT_ROW_BIT) {
+        snprintf(tmp, sizeof(tmp), "%s/%s/import-%020llu.tmp", dir, tier_names[tier],
+                 (unsigned long long)first_row);
+    } else {
+        snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    }
+
+    history_segment_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HISTORY_SEGMENT_MAGIC, 4);
+    header.version = HISTORY_SEGMENT_VERSION;
+    header.tier = (uint32_t)tier;
+    header.row_count = (uint32_t)rows;
+    header.first_row = first_row;
+    header.min_timestamp_ms = min_ts;
+    header.max_timestamp_ms = max_ts;
+
+    int fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Failed to create history segment %s: %s", tmp, strerror(errno));
+        return -1;
+    }
+
+    int result = 0;
+    uint8_t *buffer = cold ? malloc((rows + 2) * VARINT_MAX_BYTES) : NULL;
+    uint64_t offset = cold ? sizeof(header) : align_up(sizeof(header));
+    if (cold && !buffer) {
+        result = -1;
+    }
+    for (int i = 0; i < REALTIME_COLUMN_COUNT && result == 0; i++) {
+        const void *column = realtime_column_data(cols, i);
+        size_t item = realtime_column_info[i].item_size;
+        const void *data = column;
+        size_t bytes = rows * item;
+        if (cold) {
+            bytes = encode_column(buffer, column, item, rows);
+            data = buffer;
+        }
+        header.column_offset[i] = offset;
+        header.column_bytes[i] = bytes;
+        result = write_all(io, fd, data, bytes, (off_t)offset);
+        offset += bytes;
+        if (!cold) {
+            offset = align_up(offset);
+        }
+    }
+    free(buffer);
+
+    if (result == 0) {
+        result = write_all(io, fd, &header, sizeof(header), 0);
+    }
+    if (result == 0 && ftruncate(fd, (off_t)offset) < 0) {
+        result = -1;
+    }
+    if (result == 0) {
+        int64_t synced = async_io_run(io, ASYNC_IO_FSYNC, fd, NULL, 0, 0);
+        if (synced < 0) {
+            errno = (int)-synced;
+            result = -1;
+        }
+    }
+    close(fd);
+    if (result < 0 || rename(tmp, path) < 0) {
+        LOG_ERROR("Failed to write history segment %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    return (int64_t)offset;
+}
+
+/**
+ * @brief 写段文件并打开
+ * @return 段指针，失败返回NULL
+ */
+static history_segment_t *segment_write(const history_store_t *hist, const realtime_columns_t *cols,
+                                        size_t rows, uint64_t first_row, int64_t min_ts, int64_t max_ts,
+                                        history_tier_t tier) {
+    char path[320];
+    if (write_segment_file(hist->io, hist->dir, tier, cols, rows, first_row, min_ts, max_ts,
+                           path, sizeof(path)) < 0) {
+        return NULL;
+    }
+    return segment_open(path, tier);
+}
+
+/**
+ * @brief 把一组行直接写为段文件
+ */
+int64_t history_write_segment(const char *dir, history_tier_t tier, const realtime_columns_t *cols,
+                              uint64_t first_row) {
+    if (!dir || !cols || cols->count == 0 || cols->count > UINT32_MAX ||
+        (tier != HISTORY_TIER_WARM && tier != HISTORY_TIER_COLD)) {
+        return -1;
+    }
+
+    int64_t min_ts = INT64_MAX;
+    int64_t max_ts = INT64_MIN;
+    for (size_t i = 0; i < cols->count; i++) {
+        min_ts = cols->timestamp_ms[i] < min_ts ? cols->timestamp_ms[i] : min_ts;
+        max_ts = cols->timestamp_ms[i] > max_ts ? cols->timestamp_ms[i] : max_ts;
+    }
+    char path[320];
+    return write_segment_file(NULL, dir, tier, cols, cols->count, first_row, min_ts, max_ts, path, sizeof(path));
+}
+
+/**
+ * @brief 把冷层段解压到列集合
+ * @return 0成功，-1失败
+ */
+static int segment_decompress(async_io_t *io, const history_segment_t *segment, realtime_columns_t *cols) {
+    if (realtime_columns_reserve(cols, segment->rows) < 0) {
+        return -1;
+    }
+
+    uint8_t *data = malloc(segment->file_bytes);
+    int fd = open(segment->path, O_RDONLY);
+    int result = (data && fd >= 0 &&
+                  async_io_run(io, ASYNC_IO_READ, fd, data, segment->file_bytes, 0) ==
+                      (int64_t)segment->file_bytes) ? 0 : -1;
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    for (int i = 0; i < REALTIME_COLUMN_COUNT && result == 0; i++) {
+        result = decode_column(realtime_column_data(cols, i), realtime_column_info[i].item_size,
+                               segment->rows, data + segment->header.column_offset[i],
+                               segment->header.column_bytes[i]);
+    }
+    free(data);
+
+    if (result < 0) {
+        LOG_ERROR("Failed to read history segment %s", segment->path);
+        return -1;
+    }
+    cols->count = segment->rows;
+    return 0;
+}
+
+/**
+ * @brief 温层段的各列直接指向文件映射
+ */
+static void segment_map_columns(const history_segment_t *segment, realtime_columns_t *cols) {
+    memset(cols, 0, sizeof(realtime_columns_t));
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        void **slot = (void **)((uint8_t *)cols + realtime_column_info[i].offset);
+        *slot = segment->map + segment->header.column_offset[i];
+    }
+    cols->count = segment->rows;
+    cols->capacity = segment->rows;
+}
+
+/**
+ * @brief 追加段到段列表 (调用方持锁)
+ */
+static int segment_list_append(history_store_t *hist, history_segment_t *segment) {
+    if (hist->segment_count == hist->segment_capacity) {
+        size_t capacity = hist->segment_capacity ? hist->segment_capacity * 2 : 64;
+        history_segment_t **segments = realloc(hist->segments, capacity * sizeof(history_segment_t *));
+        if (!segments) {
+            return -1;
+        }
+        hist->segments = segments;
+        hist->segment_capacity = capacity;
+    }
+    hist->segments[hist->segment_count++] = segment;
+    hist->tier_bytes[segment->tier] += segment->file_bytes;
+    hist->tier_segments[segment->tier]++;
+    hist->list_generation++;
+    return 0;
+}
+
+/**
+ * @brief 按排序键排序
+ */
+static int compare_segments(const void *a, const void *b) {
+    const history_segment_t *x = *(history_segment_t *const *)a;
+    const history_segment_t *y = *(history_segment_t *const *)b;
+    if (x->first_row != y->first_row) {
+        return segment_order(x->first_row) < segment_order(y->first_row) ? -1 : 1;
+    }
+    return (int)y->tier - (int)x->tier;     // 同一段同时存在时冷层在前
+}
+
+/**
+ * @brief 段文件名中的首行行号
+ * @return 0成功，-1不是段文件
+ */
+static int parse_segment_name(const char *name, uint64_t *first_row) {
+    if (strncmp(name, "seg-", 4) != 0) {
+        return -1;
+    }
+    char *end;
+    errno = 0;
+    *first_row = strtoull(name + 4, &end, 10);
+    return errno == 0 && end != name + 4 && *end == '\0' ? 0 : -1;
+}
+
+/**
+ * @brief 目录文件中按排序键查找段的记录
+ * @return 记录指针，不存在时返回NULL
+ */
+static const history_catalog_record_t *catalog_find(const history_catalog_record_t *records, size_t count,
+                                                    uint64_t first_row) {
+    size_t low = 0;
+    size_t high = count;
+    uint64_t key = segment_order(first_row);
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (segment_order(records[mid].first_row) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < count && records[low].first_row == first_row ? &records[low] : NULL;
+}
+
+/**
+ * @brief 目录文件的映射
+ */
+typedef struct {
+    void *map;                  // 文件映射
+    size_t size;                // 文件大小
+    const history_catalog_record_t *records;    // 记录
+    size_t count;               // 记录数
+    size_t matched;             // 与段文件对上的记录数
+} history_catalog_t;
+
+/**
+ * @brief 映射并校验目录文件
+ * @return 0成功，-1文件不存在或无效 (按扫描到的段文件逐个打开)
+ */
+static int catalog_map(const char *dir, history_catalog_t *catalog) {
+    memset(catalog, 0, sizeof(history_catalog_t));
+    char path[300];
+    snprintf(path, sizeof(path), "%s/catalog", dir);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(history_catalog_header_t)) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        LOG_WARN("Ignoring unreadable history catalog %s", path);
+        return -1;
+    }
+
+    const history_catalog_header_t *header = (const history_catalog_header_t *)map;
+    size_t size = (size_t)st.st_size;
+    if (memcmp(header->magic, HISTORY_CATALOG_MAGIC, 4) != 0 || header->version != HISTORY_CATALOG_VERSION ||
+        header->count != (size - sizeof(*header)) / sizeof(history_catalog_record_t) ||
+        (size - sizeof(*header)) % sizeof(history_catalog_record_t) != 0) {
+        LOG_WARN("Ignoring invalid history catalog %s", path);
+        munmap(map, size);
+        return -1;
+    }
+    catalog->map = map;
+    catalog->size = size;
+    catalog->records = (const history_catalog_record_t *)(header + 1);
+    catalog->count = (size_t)header->count;
+    return 0;
+}
+
+/**
+ * @brief 把段列表写入目录文件 (调用方持有迁移锁或尚未启动后台线程)
+ * @return 0成功，-1失败
+ */
+static int write_catalog(history_store_t *hist) {
+    size_t bytes = sizeof(history_catalog_header_t) + hist->segment_count * sizeof(history_catalog_record_t);
+    uint8_t *buffer = calloc(1, bytes);
+    if (!buffer) {
+        return -1;
+    }
+    history_catalog_header_t *header = (history_catalog_header_t *)buffer;
+    memcpy(header->magic, HISTORY_CATALOG_MAGIC, 4);
+    header->version = HISTORY_CATALOG_VERSION;
+    header->count = hist->segment_count;
+    history_catalog_record_t *records = (history_catalog_record_t *)(header + 1);
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        const history_segment_t *segment = hist->segments[i];
+        records[i].tier = (uint32_t)segment->tier;
+        records[i].rows = (uint32_t)segment->rows;
+        records[i].first_row = segment->first_row;
+        records[i].min_timestamp_ms = segment->min_timestamp_ms;
+        records[i].max_timestamp_ms = segment->max_timestamp_ms;
+        records[i].file_bytes = segment->file_bytes;
+    }
+
+    char path[300];
+    char tmp[310];
+    snprintf(path, sizeof(path), "%s/catalog", hist->dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    int result = -1;
+    int fd = open(tmp, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd >= 0) {
+        result = write_all(hist->io, fd, buffer, bytes, 0) == 0 &&
+                 async_io_run(hist->io, ASYNC_IO_FSYNC, fd, NULL, 0, 0) == 0 ? 0 : -1;
+        close(fd);
+    }
+    free(buffer);
+    if (result < 0 || rename(tmp, path) < 0) {
+        LOG_WARN("Failed to write history catalog %s: %s", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    hist->catalog_generation = hist->list_generation;
+    return 0;
+}
+
+/**
+ * @brief 扫描一层的目录，删除残留的临时文件
+ * 目录文件中有记录的段只按记录建立，不打开文件；其余的段直接打开
+ * @return 直接打开的段数
+ */
+static size_t scan_tier(history_store_t *hist, history_tier_t tier, history_catalog_t *catalog) {
+    char dir[300];
+    snprintf(dir, sizeof(dir), "%s/%s", hist->dir, tier_names[tier]);
+    DIR *d = opendir(dir);
+    if (!d) {
+        return 0;
+    }
+
+    size_t opened = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "seg-", 4) != 0) {
+            continue;
+        }
+        char path[sizeof(dir) + sizeof(entry->d_name)];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        size_t len = strlen(entry->d_name);
+        if (len > 4 && strcmp(entry->d_name + len - 4, ".tmp") == 0) {
+            unlink(path);
+            continue;
+        }
+
+        uint64_t first_row;
+        const history_catalog_record_t *record = NULL;
+        if (parse_segment_name(entry->d_name, &first_row) == 0) {
+            record = catalog_find(catalog->records, catalog->count, first_row);
+        }
+        history_segment_t *segment;
+        if (record && record->tier == (uint32_t)tier) {
+            segment = segment_from_catalog(path, record);
+            catalog->matched++;
+        } else {
+            segment = segment_open(path, tier);
+            opened++;
+        }
+        if (segment && segment_list_append(hist, segment) < 0) {
+            segment_release(segment);
+        }
+    }
+    closedir(d);
+    return opened;
+}
+
+/**
+ * @brief 恢复段列表：排序后删除压缩中断留下的重复温层段
+ * 段文件与目录文件不一致 (崩溃前刚写出的段、已删除的段) 时重写目录文件
+ */
+static void recover_segments(history_store_t *hist) {
+    history_catalog_t catalog;
+    int mapped = catalog_map(hist->dir, &catalog) == 0;
+    size_t opened = scan_tier(hist, HISTORY_TIER_WARM, &catalog);
+    opened += scan_tier(hist, HISTORY_TIER_COLD, &catalog);
+    hist->catalog_segments = catalog.matched;
+    int stale = !mapped || opened > 0 || catalog.matched != catalog.count;
+    if (mapped) {
+        munmap(catalog.map, catalog.size);
+    }
+    qsort(hist->segments, hist->segment_count, sizeof(history_segment_t *), compare_segments);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        history_segment_t *segment = hist->segments[i];
+        const history_segment_t *previous = kept > 0 ? hist->segments[kept - 1] : NULL;
+        if (previous && (previous->first_row & HISTORY_IMPORT_ROW_BIT) ==
+                        (segment->first_row & HISTORY_IMPORT_ROW_BIT) &&
+            previous->first_row + previous->rows > segment->first_row) {
+            LOG_WARN("Removing duplicate history segment %s", segment->path);
+            hist->tier_bytes[segment->tier] -= segment->file_bytes;
+            hist->tier_segments[segment->tier]--;
+            unlink(segment->path);
+            segment_release(segment);
+            stale = 1;
+            continue;
+        }
+        hist->segments[kept++] = segment;
+        if (!(segment->first_row & HISTORY_IMPORT_ROW_BIT) &&
+            segment->first_row + segment->rows > hist->persisted_end) {
+            hist->persisted_end = segment->first_row + segment->rows;
+        }
+    }
+    hist->segment_count = kept;
+
+    hist->catalog_generation = hist->list_generation;
+    if (stale) {
+        write_catalog(hist);
+    }
+}
+
+/**
+ * @brief 按排序键查找段 (调用方持有迁移锁或段列表锁)
+ * @return 插入位置，found置为是否已存在
+ */
+static size_t segment_list_find(const history_store_t *hist, uint64_t first_row, int *found) {
+    size_t low = 0;
+    size_t high = hist->segment_count;
+    uint64_t key = segment_order(first_row);
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (segment_order(hist->segments[mid]->first_row) < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = low < hist->segment_count && hist->segments[low]->first_row == first_row;
+    return low;
+}
+
+/**
+ * @brief 纳入导入工具在运行期间写入的段 (调用方持有迁移锁)
+ */
+static void adopt_imports(history_store_t *hist) {
+    for (int t = HISTORY_TIER_WARM; t < HISTORY_TIER_COUNT; t++) {
+        char dir[300];
+        snprintf(dir, sizeof(dir), "%s/%s", hist->dir, tier_names[t]);
+        DIR *d = opendir(dir);
+        if (!d) {
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            uint64_t first_row;
+            int found;
+            if (parse_segment_name(entry->d_name, &first_row) < 0 || !(first_row & HISTORY_IMPORT_ROW_BIT)) {
+                continue;
+            }
+            segment_list_find(hist, first_row, &found);
+            if (found) {
+                continue;
+            }
+
+            char path[sizeof(dir) + sizeof(entry->d_name)];
+            snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+            history_segment_t *segment = segment_open(path, (history_tier_t)t);
+            if (!segment) {
+                continue;
+            }
+            pthread_mutex_lock(&hist->lock);
+            size_t pos = segment_list_find(hist, first_row, &found);
+            if (segment_list_append(hist, segment) == 0) {
+                memmove(&hist->segments[pos + 1], &hist->segments[pos],
+                        (hist->segment_count - 1 - pos) * sizeof(history_segment_t *));
+                hist->segments[pos] = segment;
+                segment = NULL;
+            }
+            pthread_mutex_unlock(&hist->lock);
+            if (segment) {
+                segment_release(segment);
+            } else {
+                __atomic_add_fetch(&hist->import_generation, 1, __ATOMIC_RELEASE);
+                LOG_INFO("History adopted imported segment %s", path);
+            }
+        }
+        closedir(d);
+    }
+}
+
+/**
+ * @brief 导入段的下一个行号
+ */
+uint64_t history_import_next_row(const char *dir) {
+    uint64_t next = HISTORY_IMPORT_ROW_BIT;
+    for (int t = HISTORY_TIER_WARM; dir && t < HISTORY_TIER_COUNT; t++) {
+        char tier_dir[300];
+        snprintf(tier_dir, sizeof(tier_dir), "%s/%s", dir, tier_names[t]);
+        DIR *d = opendir(tier_dir);
+        if (!d) {
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            uint64_t first_row;
+            if (parse_segment_name(entry->d_name, &first_row) < 0 || !(first_row & HISTORY_IMPORT_ROW_BIT)) {
+                continue;
+            }
+            char path[sizeof(tier_dir) + sizeof(entry->d_name)];
+            snprintf(path, sizeof(path), "%s/%s", tier_dir, entry->d_name);
+            history_segment_t *segment = segment_open(path, (history_tier_t)t);
+            if (segment) {
+                if (segment->first_row + segment->rows > next) {
+                    next = segment->first_row + segment->rows;
+                }
+                segment_release(segment);
+            }
+        }
+        closedir(d);
+    }
+    return next;
+}
+
+/**
+ * @brief 查询任务：一次查询拆分出的全部分区 (先是段，再是热层快照的块)
+ */
+typedef struct history_query_job {
+    history_store_t *hist;          // 所属存储
+    const realtime_query_t *query;  // 查询条件
+    history_query_ctl_t *ctl;       // 查询控制
+    history_segment_t **segments;   // 段引用
+    size_t segment_count;           // 段数
+    realtime_snapshot_t snapshot;   // 热层快照
+    realtime_columns_t *parts;      // 各分区的部分结果
+    size_t partition_count;         // 分区数
+    size_t next;                    // 下一个待领取的分区 (持query_lock)
+    size_t done;                    // 已结束的分区数 (持query_lock)
+    uint64_t reserved;              // 当前预留的内存 (原子访问)
+    uint64_t max_bytes;             // 内存上限
+    int status;                     // 结束状态 (原子访问，首个非OK状态生效)
+    size_t skipped;                 // 未执行的分区数 (原子访问)
+    uint64_t served[HISTORY_TIER_COUNT]; // 各层提供的行数 (原子访问)
+    uint64_t worker_partitions;     // 由工作线程执行的分区数 (原子访问)
+    pthread_cond_t finished;        // 全部分区结束
+    struct history_query_job *next_job; // 队列中的下一个查询
+} history_query_job_t;
+
+/**
+ * @brief 在一组列上执行查询 (列包装为单块快照)
+ */
+static int64_t query_columns(const realtime_columns_t *cols, uint64_t first_row, int64_t min_ms, int64_t max_ms,
+                             const realtime_query_t *query, realtime_columns_t *out) {
+    realtime_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+    chunk.columns = *cols;
+    chunk.first_row = first_row;
+    chunk.min_timestamp_ms = min_ms;
+    chunk.max_timestamp_ms = max_ms;
+    chunk.refs = 1;
+
+    realtime_chunk_t *chunks[1] = {&chunk};
+    size_t rows[1] = {cols->count};
+    realtime_snapshot_t snapshot = {chunks, rows, 1, cols->count, first_row + cols->count};
+    return realtime_snapshot_query(&snapshot, query, out);
+}
+
+/**
+ * @brief 把列集合截取为从skip行开始的count行 (只移动列指针)
+ */
+static void slice_columns(realtime_columns_t *cols, size_t skip, size_t count) {
+    for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+        uint8_t **slot = (uint8_t **)((uint8_t *)cols + realtime_column_info[i].offset);
+        *slot += skip * realtime_column_info[i].item_size;
+    }
+    cols->count = count;
+    cols->capacity = count;
+}
+
+/**
+ * @brief 记录查询的结束状态 (只保留第一个)
+ */
+static void job_fail(history_query_job_t *job, history_query_status_t status) {
+    int expected = HISTORY_QUERY_OK;
+    __atomic_compare_exchange_n(&job->status, &expected, (int)status, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 预留内存，超过上限时标记查询超限
+ * @return 0成功，-1超限
+ */
+static int job_reserve(history_query_job_t *job, uint64_t bytes) {
+    uint64_t total = __atomic_add_fetch(&job->reserved, bytes, __ATOMIC_RELAXED);
+    if (total > job->max_bytes) {
+        __atomic_sub_fetch(&job->reserved, bytes, __ATOMIC_RELAXED);
+        job_fail(job, HISTORY_QUERY_OVER_LIMIT);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 执行一个分区：按最坏情况 (全部行匹配，冷层另加解压缓冲区) 预留内存，结束后按实际结果结算
+ */
+static void run_partition(history_query_job_t *job, size_t index) {
+    if (__atomic_load_n(&job->ctl->cancel, __ATOMIC_RELAXED)) {
+        job_fail(job, HISTORY_QUERY_CANCELLED);
+    }
+    if (__atomic_load_n(&job->status, __ATOMIC_RELAXED) != HISTORY_QUERY_OK) {
+        __atomic_add_fetch(&job->skipped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    realtime_columns_t *out = &job->parts[index];
+    realtime_columns_t cols;
+    realtime_columns_t scratch;
+    history_tier_t tier = HISTORY_TIER_HOT;
+    uint64_t first_row;
+    int64_t min_ms;
+    int64_t max_ms;
+    uint64_t reserved;
+    memset(&cols, 0, sizeof(cols));
+    memset(&scratch, 0, sizeof(scratch));
+
+    if (index < job->segment_count) {
+        history_segment_t *segment = job->segments[index];
+        tier = segment->tier;
+        first_row = segment->first_row;
+        min_ms = segment->min_timestamp_ms;
+        max_ms = segment->max_timestamp_ms;
+        // 首次访问时加载，文件已损坏的段与启动时一样忽略 (加载时已输出告警)
+        if (segment_load(job->hist, segment, 1) < 0) {
+            return;
+        }
+        reserved = segment->rows * row_bytes() * (tier == HISTORY_TIER_COLD ? 2 : 1);
+        if (job_reserve(job, reserved) < 0) {
+            __atomic_add_fetch(&job->skipped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        if (tier == HISTORY_TIER_WARM) {
+            segment_map_columns(segment, &cols);
+        } else if (segment_decompress(job->hist->io, segment, &scratch) < 0) {
+            job_fail(job, HISTORY_QUERY_FAILED);
+        } else {
+            cols = scratch;
+        }
+    } else {
+        size_t c = index - job->segment_count;
+        const realtime_chunk_t *chunk = job->snapshot.chunks[c];
+        cols = chunk->columns;
+        cols.count = job->snapshot.rows[c];
+        first_row = chunk->first_row;
+        min_ms = chunk->min_timestamp_ms;
+        max_ms = chunk->max_timestamp_ms;
+        if (cols.count == 0 || max_ms < job->query->start_ms || min_ms >= job->query->end_ms) {
+            return;
+        }
+        reserved = cols.count * row_bytes();
+        if (job_reserve(job, reserved) < 0) {
+            __atomic_add_fetch(&job->skipped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    // 接收路径的行按行号范围截取
+    if (!(first_row & HISTORY_IMPORT_ROW_BIT) && cols.count > 0) {
+        uint64_t low = first_row > job->ctl->min_row ? first_row : job->ctl->min_row;
+        uint64_t high = first_row + cols.count;
+        if (job->ctl->max_row && job->ctl->max_row < high) {
+            high = job->ctl->max_row;
+        }
+        slice_columns(&cols, low < high ? (size_t)(low - first_row) : 0, low < high ? (size_t)(high - low) : 0);
+        first_row = low;
+    }
+
+    if (__atomic_load_n(&job->status, __ATOMIC_RELAXED) == HISTORY_QUERY_OK) {
+        int64_t rows = query_columns(&cols, first_row, min_ms, max_ms, job->query, out);
+        if (rows < 0) {
+            job_fail(job, HISTORY_QUERY_FAILED);
+        } else {
+            __atomic_add_fetch(&job->served[tier], (uint64_t)rows, __ATOMIC_RELAXED);
+        }
+    }
+    if (tier == HISTORY_TIER_COLD) {
+        realtime_columns_free(&scratch);
+    }
+    // 释放解压缓冲区和未用到的结果预留
+    __atomic_sub_fetch(&job->reserved, reserved - out->count * row_bytes(), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 领取查询的下一个分区 (调用方持query_lock)，领完时把查询移出队列
+ * @return 分区下标，没有时为partition_count
+ */
+static size_t claim_partition(history_store_t *hist, history_query_job_t *job) {
+    if (job->next >= job->partition_count) {
+        return job->partition_count;
+    }
+    size_t index = job->next++;
+    if (job->next == job->partition_count) {
+        for (history_query_job_t **link = &hist->query_jobs; *link; link = &(*link)->next_job) {
+            if (*link == job) {
+                *link = job->next_job;
+                break;
+            }
+        }
+    }
+    return index;
+}
+
+/**
+ * @brief 标记分区结束 (调用方持query_lock)
+ */
+static void finish_partition(history_query_job_t *job) {
+    if (++job->done == job->partition_count) {
+        pthread_cond_signal(&job->finished);
+    }
+}
+
+/**
+ * @brief 查询工作线程：领取队首查询的分区执行
+ */
+static void *query_worker(void *arg) {
+    history_store_t *hist = (history_store_t *)arg;
+
+    pthread_mutex_lock(&hist->query_lock);
+    while (!hist->query_stopping) {
+        history_query_job_t *job = hist->query_jobs;
+        if (!job) {
+            pthread_cond_wait(&hist->query_ready, &hist->query_lock);
+            continue;
+        }
+        size_t index = claim_partition(hist, job);
+        pthread_mutex_unlock(&hist->query_lock);
+
+        run_partition(job, index);
+        __atomic_add_fetch(&job->worker_partitions, 1, __ATOMIC_RELAXED);
+
+        pthread_mutex_lock(&hist->query_lock);
+        finish_partition(job);
+    }
+    pthread_mutex_unlock(&hist->query_lock);
+    return NULL;
+}
+
+/**
+ * @brief 启动查询工作线程
+ */
+static void start_query_workers(history_store_t *hist, int threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 1 ? (int)(online / 2) : 1;
+    }
+    if (threads > HISTORY_MAX_QUERY_THREADS) {
+        threads = HISTORY_MAX_QUERY_THREADS;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&hist->query_workers[t], NULL, query_worker, hist) != 0) {
+            LOG_WARN("Started only %d of %d history query workers", t, threads);
+            break;
+        }
+        hist->query_threads++;
+    }
+}
+
+/**
+ * @brief 停止查询工作线程
+ */
+static void stop_query_workers(history_store_t *hist) {
+    pthread_mutex_lock(&hist->query_lock);
+    hist->query_stopping = 1;
+    pthread_cond_broadcast(&hist->query_ready);
+    pthread_mutex_unlock(&hist->query_lock);
+    for (int t = 0; t < hist->query_threads; t++) {
+        pthread_join(hist->query_workers[t], NULL);
+    }
+    hist->query_threads = 0;
+}
+
+/**
+ * @brief 预热线程：从最新的段开始加载，温层段预读到页缓存
+ */
+static void *warmup_worker(void *arg) {
+    history_store_t *hist = (history_store_t *)arg;
+
+    while (!__atomic_load_n(&hist->warmup_stopping, __ATOMIC_RELAXED)) {
+        size_t index = __atomic_fetch_add(&hist->warmup_next, 1, __ATOMIC_RELAXED);
+        if (index >= hist->warmup_count) {
+            break;
+        }
+        // 已被压缩或删除 (只剩预热持有的引用) 的段不再加载
+        history_segment_t *segment = hist->warmup_list[index];
+        if (__atomic_load_n(&segment->refs, __ATOMIC_ACQUIRE) > 1 && segment_load(hist, segment, 0) == 0 &&
+            segment->map) {
+            madvise(segment->map, segment->file_bytes, MADV_WILLNEED);
+        }
+        if (__atomic_add_fetch(&hist->warmup_done, 1, __ATOMIC_ACQ_REL) == hist->warmup_count) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            LOG_INFO("History warm-up finished - %zu segments in %.1f ms", hist->warmup_count,
+                     (double)((int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec - hist->warmup_start_ns) / 1e6);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 启动预热线程，加载启动时按目录记录建立的段
+ */
+static void start_warmup(history_store_t *hist, int threads) {
+    if (threads == 0) {
+        threads = HISTORY_DEFAULT_WARMUP_THREADS;
+    }
+    if (threads > HISTORY_MAX_WARMUP_THREADS) {
+        threads = HISTORY_MAX_WARMUP_THREADS;
+    }
+    hist->warmup_list = malloc((hist->segment_count ? hist->segment_count : 1) * sizeof(history_segment_t *));
+    if (!hist->warmup_list) {
+        return;
+    }
+    for (size_t i = hist->segment_count; i-- > 0;) {
+        history_segment_t *segment = hist->segments[i];
+        if (segment->state == 0) {
+            segment_retain(segment);
+            hist->warmup_list[hist->warmup_count++] = segment;
+        }
+    }
+    if ((size_t)threads > hist->warmup_count) {
+        threads = (int)hist->warmup_count;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    hist->warmup_start_ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    for (int t = 0; t < threads; t++) {
+        if (pthread_create(&hist->warmup_workers[t], NULL, warmup_worker, hist) != 0) {
+            LOG_WARN("Failed to start history warm-up thread %d", t);
+            break;
+        }
+        hist->warmup_threads++;
+    }
+}
+
+/**
+ * @brief 等待预热线程结束并释放预热列表
+ */
+void history_wait_warmup(history_store_t *hist) {
+    if (!hist) {
+        return;
+    }
+    for (int t = 0; t < hist->warmup_threads; t++) {
+        pthread_join(hist->warmup_workers[t], NULL);
+    }
+    hist->warmup_threads = 0;
+    for (size_t i = 0; i < hist->warmup_count; i++) {
+        segment_release(hist->warmup_list[i]);
+    }
+    free(hist->warmup_list);
+    hist->warmup_list = NULL;
+    hist->warmup_count = 0;
+}
+
+/**
+ * @brief 创建目录 (已存在时成功)
+ */
+static int make_dir(const char *path) {
+    return mkdir(path, 0755) == 0 || errno == EEXIST ? 0 : -1;
+}
+
+/**
+ * @brief 初始化分层存储
+ */
+int history_init(history_store_t *hist, const history_config_t *config) {
+    if (!hist || !config || !config->dir) {
+        return -1;
+    }
+
+    memset(hist, 0, sizeof(history_store_t));
+    snprintf(hist->dir, sizeof(hist->dir), "%s", config->dir);
+    hist->warm_max_bytes = config->warm_max_bytes ? config->warm_max_bytes : HISTORY_DEFAULT_WARM_BYTES;
+    hist->cold_max_bytes = config->cold_max_bytes ? config->cold_max_bytes : HISTORY_DEFAULT_COLD_BYTES;
+    hist->migrate_interval_ms = config->migrate_interval_ms > 0 ? config->migrate_interval_ms
+                                                                : HISTORY_DEFAULT_MIGRATE_MS;
+    hist->query_max_bytes = config->query_max_bytes ? config->query_max_bytes : HISTORY_DEFAULT_QUERY_BYTES;
+    hist->dropped_max_ms = INT64_MIN;
+    hist->io = config->io;
+
+    char path[300];
+    int result = make_dir(hist->dir);
+    for (int t = HISTORY_TIER_WARM; t < HISTORY_TIER_COUNT && result == 0; t++) {
+        snprintf(path, sizeof(path), "%s/%s", hist->dir, tier_names[t]);
+        result = make_dir(path);
+    }
+    if (result < 0) {
+        LOG_ERROR("Failed to create history directory %s: %s", hist->dir, strerror(errno));
+        return -1;
+    }
+
+    recover_segments(hist);
+    if (realtime_store_init(&hist->hot, config->hot_max_rows) < 0) {
+        history_destroy(hist);
+        return -1;
+    }
+    // 热层从已持久化的行号继续编号，段和块的行号不重叠
+    hist->hot.total_rows = hist->persisted_end;
+
+    pthread_mutex_init(&hist->lock, NULL);
+    pthread_mutex_init(&hist->migrate_lock, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&hist->wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&hist->query_lock, NULL);
+    pthread_cond_init(&hist->query_ready, NULL);
+    if (config->query_threads >= 0) {
+        start_query_workers(hist, config->query_threads);
+    }
+    if (config->warmup_threads >= 0) {
+        start_warmup(hist, config->warmup_threads);
+    }
+
+    LOG_INFO("History store initialized at %s - %zu warm and %zu cold segments (%zu from catalog), next row %llu",
+             hist->dir, hist->tier_segments[HISTORY_TIER_WARM], hist->tier_segments[HISTORY_TIER_COLD],
+             hist->catalog_segments, (unsigned long long)hist->persisted_end);
+    return 0;
+}
+
+/**
+ * @brief 把热层的块写为温层段 (调用方持有迁移锁)
+ * @param include_tail 是否连同仍在追加的最新块一起写出 (仅在关闭时使用)
+ */
+static int64_t persist_hot(history_store_t *hist, int include_tail) {
+    realtime_snapshot_t snapshot;
+    if (realtime_store_snapshot(&hist->hot, &snapshot) < 0) {
+        return -1;
+    }
+
+    int64_t written = 0;
+    for (size_t c = 0; c < snapshot.chunk_count; c++) {
+        const realtime_chunk_t *chunk = snapshot.chunks[c];
+        size_t rows = snapshot.rows[c];
+        // 最新块仍在追加，写满换块后再写出
+        if (rows == 0 || (c + 1 == snapshot.chunk_count && !include_tail) ||
+            chunk->first_row + rows <= hist->persisted_end) {
+            continue;
+        }
+        if (chunk->first_row > hist->persisted_end) {
+            uint64_t lost = chunk->first_row - hist->persisted_end;
+            hist->lost_rows += lost;
+            LOG_WARN("History lost %llu rows evicted from memory before migration",
+                     (unsigned long long)lost);
+        }
+
+        history_segment_t *segment = segment_write(hist, &chunk->columns, rows, chunk->first_row,
+                                                   chunk->min_timestamp_ms, chunk->max_timestamp_ms,
+                                                   HISTORY_TIER_WARM);
+        if (!segment) {
+            written = -1;
+            break;
+        }
+        pthread_mutex_lock(&hist->lock);
+        int appended = segment_list_append(hist, segment);
+        pthread_mutex_unlock(&hist->lock);
+        if (appended < 0) {
+            segment_release(segment);
+            written = -1;
+            break;
+        }
+        hist->persisted_end = chunk->first_row + rows;
+        hist->migrated_rows += rows;
+        written += (int64_t)rows;
+    }
+
+    pthread_mutex_lock(&hist->lock);
+    hist->tier_bytes[HISTORY_TIER_HOT] = (uint64_t)snapshot.chunk_count * REALTIME_STORE_CHUNK_ROWS * row_bytes();
+    hist->tier_segments[HISTORY_TIER_HOT] = snapshot.chunk_count;
+    pthread_mutex_unlock(&hist->lock);
+
+    realtime_snapshot_release(&snapshot);
+    return written;
+}
+
+/**
+ * @brief 把最旧的温层段压缩为冷层段 (调用方持有迁移锁)
+ * @return 0成功，-1没有温层段或失败
+ */
+static int compact_oldest_warm(history_store_t *hist) {
+    history_segment_t *warm = NULL;
+    pthread_mutex_lock(&hist->lock);
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        if (hist->segments[i]->tier == HISTORY_TIER_WARM) {
+            warm = hist->segments[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hist->lock);
+    if (!warm) {
+        return -1;
+    }
+
+    // 段列表只在迁移锁下修改，不需要额外引用
+    if (segment_load(hist, warm, 1) < 0) {
+        return -1;
+    }
+    realtime_columns_t cols;
+    segment_map_columns(warm, &cols);
+    history_segment_t *cold = segment_write(hist, &cols, warm->rows, warm->first_row,
+                                            warm->min_timestamp_ms, warm->max_timestamp_ms, HISTORY_TIER_COLD);
+    if (!cold) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&hist->lock);
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        if (hist->segments[i] == warm) {
+            hist->segments[i] = cold;
+            break;
+        }
+    }
+    hist->tier_bytes[HISTORY_TIER_WARM] -= warm->file_bytes;
+    hist->tier_segments[HISTORY_TIER_WARM]--;
+    hist->tier_bytes[HISTORY_TIER_COLD] += cold->file_bytes;
+    hist->tier_segments[HISTORY_TIER_COLD]++;
+    hist->list_generation++;
+    pthread_mutex_unlock(&hist->lock);
+
+    hist->compacted_rows += warm->rows;
+    LOG_DEBUG("History segment %llu compacted: %zu -> %zu bytes",
+              (unsigned long long)warm->first_row, warm->file_bytes, cold->file_bytes);
+    // 正在扫描的查询仍持有映射，文件删除后映射保持有效
+    unlink(warm->path);
+    segment_release(warm);
+    return 0;
+}
+
+/**
+ * @brief 删除最旧的冷层段 (调用方持有迁移锁)
+ * @return 0成功，-1没有冷层段
+ */
+static int drop_oldest_cold(history_store_t *hist) {
+    history_segment_t *cold = NULL;
+    pthread_mutex_lock(&hist->lock);
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        if (hist->segments[i]->tier == HISTORY_TIER_COLD) {
+            cold = hist->segments[i];
+            memmove(&hist->segments[i], &hist->segments[i + 1],
+                    (hist->segment_count - i - 1) * sizeof(history_segment_t *));
+            hist->segment_count--;
+            hist->tier_bytes[HISTORY_TIER_COLD] -= cold->file_bytes;
+            hist->tier_segments[HISTORY_TIER_COLD]--;
+            hist->list_generation++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hist->lock);
+    if (!cold) {
+        return -1;
+    }
+
+    hist->dropped_rows += cold->rows;
+    if (cold->max_timestamp_ms > hist->dropped_max_ms) {
+        __atomic_store_n(&hist->dropped_max_ms, cold->max_timestamp_ms, __ATOMIC_RELEASE);
+    }
+    unlink(cold->path);
+    segment_release(cold);
+    return 0;
+}
+
+/**
+ * @brief 执行一轮迁移 (调用方持有迁移锁)
+ */
+static int64_t migrate_locked(history_store_t *hist, int include_tail) {
+    int64_t written = persist_hot(hist, include_tail);
+    adopt_imports(hist);
+
+    while (hist->tier_bytes[HISTORY_TIER_WARM] > hist->warm_max_bytes) {
+        if (compact_oldest_warm(hist) < 0) {
+            break;
+        }
+    }
+    while (hist->tier_bytes[HISTORY_TIER_COLD] > hist->cold_max_bytes) {
+        if (drop_oldest_cold(hist) < 0) {
+            break;
+        }
+    }
+    if (hist->list_generation != hist->catalog_generation) {
+        write_catalog(hist);
+    }
+    return written;
+}
+
+/**
+ * @brief 执行一轮迁移
+ */
+int64_t history_migrate(history_store_t *hist) {
+    if (!hist || !hist->hot.chunks) {
+        return -1;
+    }
+    pthread_mutex_lock(&hist->migrate_lock);
+    int64_t written = migrate_locked(hist, 0);
+    pthread_mutex_unlock(&hist->migrate_lock);
+    return written;
+}
+
+/**
+ * @brief 后台迁移线程 (除等待外持有迁移锁)
+ */
+static void *history_thread(void *arg) {
+    history_store_t *hist = (history_store_t *)arg;
+
+    pthread_mutex_lock(&hist->migrate_lock);
+    while (hist->running) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)(hist->migrate_interval_ms % 1000) * 1000000L;
+        deadline.tv_sec += hist->migrate_interval_ms / 1000 + deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&hist->wakeup, &hist->migrate_lock, &deadline);
+        if (!hist->running) {
+            break;
+        }
+
+        if (migrate_locked(hist, 0) < 0) {
+            LOG_WARN("History migration failed, retrying next cycle");
+        }
+        history_export_metrics(hist);
+    }
+    pthread_mutex_unlock(&hist->migrate_lock);
+    return NULL;
+}
+
+/**
+ * @brief 启动后台迁移线程
+ */
+int history_start(history_store_t *hist) {
+    if (!hist || !hist->hot.chunks || hist->running) {
+        return -1;
+    }
+
+    hist->running = 1;
+    if (pthread_create(&hist->thread, NULL, history_thread, hist) != 0) {
+        LOG_ERROR("Failed to start history migration thread");
+        hist->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 停止后台迁移线程
+ */
+void history_stop(history_store_t *hist) {
+    if (!hist || !hist->running) {
+        return;
+    }
+    pthread_mutex_lock(&hist->migrate_lock);
+    hist->running = 0;
+    pthread_cond_signal(&hist->wakeup);
+    pthread_mutex_unlock(&hist->migrate_lock);
+    pthread_join(hist->thread, NULL);
+}
+
+/**
+ * @brief 销毁分层存储
+ */
+void history_destroy(history_store_t *hist) {
+    if (!hist) {
+        return;
+    }
+
+    if (hist->hot.chunks) {
+        history_stop(hist);
+        __atomic_store_n(&hist->warmup_stopping, 1, __ATOMIC_RELAXED);
+        history_wait_warmup(hist);
+        stop_query_workers(hist);
+        pthread_mutex_lock(&hist->migrate_lock);
+        if (migrate_locked(hist, 1) < 0) {
+            LOG_WARN("Failed to persist in-memory history on shutdown");
+        }
+        pthread_mutex_unlock(&hist->migrate_lock);
+        realtime_store_destroy(&hist->hot);
+        pthread_mutex_destroy(&hist->lock);
+        pthread_mutex_destroy(&hist->migrate_lock);
+        pthread_cond_destroy(&hist->wakeup);
+        pthread_mutex_destroy(&hist->query_lock);
+        pthread_cond_destroy(&hist->query_ready);
+    }
+
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        segment_release(hist->segments[i]);
+    }
+    free(hist->segments);
+    hist->segments = NULL;
+    hist->segment_count = 0;
+    hist->segment_capacity = 0;
+}
+
+/**
+ * @brief 合并各分区的部分结果
+ * @return 0成功，-1内存不足
+ */
+static int merge_partitions(const history_query_job_t *job, realtime_columns_t *out, int64_t *matched) {
+    size_t total = 0;
+    for (size_t p = 0; p < job->partition_count; p++) {
+        total += job->parts[p].count;
+    }
+    if (total > 0 && realtime_columns_reserve(out, out->count + total) < 0) {
+        return -1;
+    }
+    for (size_t p = 0; p < job->partition_count; p++) {
+        const realtime_columns_t *part = &job->parts[p];
+        if (part->count == 0) {
+            continue;
+        }
+        for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+            size_t item = realtime_column_info[i].item_size;
+            memcpy((uint8_t *)realtime_column_data(out, i) + out->count * item,
+                   realtime_column_data(part, i), part->count * item);
+        }
+        out->count += part->count;
+    }
+    *matched = (int64_t)total;
+    return 0;
+}
+
+/**
+ * @brief 取消查询
+ */
+void history_query_cancel(history_query_ctl_t *ctl) {
+    if (ctl) {
+        __atomic_store_n(&ctl->cancel, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief 跨层查询 (可取消，受内存上限约束)
+ */
+int64_t history_query_run(history_store_t *hist, const realtime_query_t *query, history_query_ctl_t *ctl,
+                          realtime_columns_t *out) {
+    history_query_ctl_t local;
+    if (!ctl) {
+        memset(&local, 0, sizeof(local));
+        ctl = &local;
+    }
+    ctl->status = HISTORY_QUERY_FAILED;
+    ctl->partitions = 0;
+    ctl->skipped = 0;
+    ctl->reserved_bytes = 0;
+    ctl->row_end = 0;
+    if (!hist || !hist->hot.chunks || !query || !out) {
+        return -1;
+    }
+
+    history_query_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.hist = hist;
+    job.query = query;
+    job.ctl = ctl;
+    job.max_bytes = ctl->max_bytes ? ctl->max_bytes : hist->query_max_bytes;
+
+    // 先取热层快照，再取导入段和行号更早的段；之后迁移写出的段都不早于快照首行，不会重复
+    if (realtime_store_snapshot(&hist->hot, &job.snapshot) < 0) {
+        return -1;
+    }
+    uint64_t hot_first = job.snapshot.chunk_count > 0 ? job.snapshot.chunks[0]->first_row : UINT64_MAX;
+    ctl->row_end = job.snapshot.end_row;
+
+    pthread_mutex_lock(&hist->lock);
+    if (hist->segment_count > 0) {
+        job.segments = malloc(hist->segment_count * sizeof(history_segment_t *));
+    }
+    for (size_t i = 0; job.segments && i < hist->segment_count; i++) {
+        history_segment_t *segment = hist->segments[i];
+        int included;
+        if (segment->first_row & HISTORY_IMPORT_ROW_BIT) {
+            included = !ctl->exclude_imports;
+        } else {
+            included = segment->first_row < hot_first && segment->first_row + segment->rows > ctl->min_row &&
+                       (!ctl->max_row || segment->first_row < ctl->max_row);
+        }
+        if (included && segment->max_timestamp_ms >= query->start_ms &&
+            segment->min_timestamp_ms < query->end_ms) {
+            segment_retain(segment);
+            job.segments[job.segment_count++] = segment;
+        }
+    }
+    int failed = hist->segment_count > 0 && !job.segments;
+    pthread_mutex_unlock(&hist->lock);
+
+    job.partition_count = job.segment_count + job.snapshot.chunk_count;
+    job.parts = calloc(job.partition_count ? job.partition_count : 1, sizeof(realtime_columns_t));
+    if (failed || !job.parts) {
+        job.status = HISTORY_QUERY_FAILED;
+        job.partition_count = 0;
+    }
+
+    // 分区多于一个时交给工作线程，调用线程同时领取分区执行
+    pthread_cond_init(&job.finished, NULL);
+    pthread_mutex_lock(&hist->query_lock);
+    if (hist->query_threads > 0 && job.partition_count > 1) {
+        history_query_job_t **link = &hist->query_jobs;
+        while (*link) {
+            link = &(*link)->next_job;
+        }
+        *link = &job;
+        pthread_cond_broadcast(&hist->query_ready);
+    }
+    for (;;) {
+        size_t index = claim_partition(hist, &job);
+        if (index == job.partition_count) {
+            break;
+        }
+        pthread_mutex_unlock(&hist->query_lock);
+        run_partition(&job, index);
+        pthread_mutex_lock(&hist->query_lock);
+        finish_partition(&job);
+    }
+    while (job.done < job.partition_count) {
+        pthread_cond_wait(&job.finished, &hist->query_lock);
+    }
+    pthread_mutex_unlock(&hist->query_lock);
+    pthread_cond_destroy(&job.finished);
+
+    int64_t matched = 0;
+    if (job.status == HISTORY_QUERY_OK && merge_partitions(&job, out, &matched) < 0) {
+        job.status = HISTORY_QUERY_FAILED;
+    }
+
+    for (size_t p = 0; p < job.partition_count; p++) {
+        realtime_columns_free(&job.parts[p]);
+    }
+    free(job.parts);
+    for (size_t i = 0; i < job.segment_count; i++) {
+        segment_release(job.segments[i]);
+    }
+    free(job.segments);
+    realtime_snapshot_release(&job.snapshot);
+
+    ctl->status = (history_query_status_t)job.status;
+    ctl->partitions = job.partition_count;
+    ctl->skipped = job.skipped;
+    ctl->reserved_bytes = job.reserved;
+
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        __atomic_add_fetch(&hist->rows_served[t], job.served[t], __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&hist->queries, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->query_partitions, job.partition_count - job.skipped, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&hist->worker_partitions, job.worker_partitions, __ATOMIC_RELAXED);
+    if (job.status == HISTORY_QUERY_CANCELLED) {
+        __atomic_add_fetch(&hist->queries_cancelled, 1, __ATOMIC_RELAXED);
+    } else if (job.status == HISTORY_QUERY_OVER_LIMIT) {
+        __atomic_add_fetch(&hist->queries_over_limit, 1, __ATOMIC_RELAXED);
+    }
+    return job.status == HISTORY_QUERY_OK ? matched : -1;
+}
+
+/**
+ * @brief 跨层查询
+ */
+int64_t history_query(history_store_t *hist, const realtime_query_t *query, realtime_columns_t *out) {
+    return history_query_run(hist, query, NULL, out);
+}
+
+/**
+ * @brief 导出各层指标
+ */
+void history_export_metrics(history_store_t *hist) {
+    if (!hist) {
+        return;
+    }
+
+    uint64_t served[HISTORY_TIER_COUNT];
+    uint64_t total = 0;
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        served[t] = __atomic_load_n(&hist->rows_served[t], __ATOMIC_RELAXED);
+        total += served[t];
+    }
+    uint64_t targets[HISTORY_TIER_COUNT] = {
+        (uint64_t)hist->hot.max_chunks * REALTIME_STORE_CHUNK_ROWS * row_bytes(),
+        hist->warm_max_bytes, hist->cold_max_bytes
+    };
+
+    pthread_mutex_lock(&hist->lock);
+    for (int t = 0; t < HISTORY_TIER_COUNT; t++) {
+        char labels[32];
+        snprintf(labels, sizeof(labels), "tier=\"%s\"", tier_names[t]);
+        metrics_gauge_set("traffic_history_bytes", labels, (double)hist->tier_bytes[t]);
+        metrics_gauge_set("traffic_history_target_bytes", labels, (double)targets[t]);
+        metrics_gauge_set("traffic_history_segments", labels, (double)hist->tier_segments[t]);
+        metrics_gauge_set("traffic_history_rows_served_total", labels, (double)served[t]);
+        metrics_gauge_set("traffic_history_hit_ratio", labels, total ? (double)served[t] / total : 0);
+    }
+    size_t unloaded = 0;
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        unloaded += __atomic_load_n(&hist->segments[i]->state, __ATOMIC_RELAXED) == 0;
+    }
+    pthread_mutex_unlock(&hist->lock);
+
+    metrics_gauge_set("traffic_history_segments_unloaded", NULL, (double)unloaded);
+    metrics_gauge_set("traffic_history_lazy_loads_total", NULL,
+                      (double)__atomic_load_n(&hist->lazy_loads, __ATOMIC_RELAXED));
+
+    metrics_gauge_set("traffic_history_migrated_rows_total", NULL, (double)hist->migrated_rows);
+    metrics_gauge_set("traffic_history_lost_rows_total", NULL, (double)hist->lost_rows);
+    metrics_gauge_set("traffic_history_queries_total", NULL,
+                      (double)__atomic_load_n(&hist->queries, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_history_query_threads", NULL, (double)hist->query_threads);
+    metrics_gauge_set("traffic_history_query_partitions_total", NULL,
+                      (double)__atomic_load_n(&hist->query_partitions, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_history_query_worker_partitions_total", NULL,
+                      (double)__atomic_load_n(&hist->worker_partitions, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_history_queries_cancelled_total", NULL,
+                      (double)__atomic_load_n(&hist->queries_cancelled, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_history_queries_over_limit_total", NULL,
+                      (double)__atomic_load_n(&hist->queries_over_limit, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,323 @@
+/**
+ * @file history_store.h
+ * @brief 实时信息的分层历史存储
+ *
+ * 数据分三层保存：
+ *   热层 内存中的列式存储 (realtime_store)，保存最近的若干块，由接收路径直接追加；
+ *   温层 未压缩的段文件，各列按64字节对齐连续存放，mmap后按列直接扫描；
+ *   冷层 压缩的段文件，各列按差分 + zigzag + 变长整数编码 (连续相同值记为游程)，查询时解压。
+ * 后台线程周期性地把热层中已写满的块写为温层段 (每块一段)，温层超过容量目标时
+ * 把最旧的段压缩为冷层段，冷层超过容量目标时删除最旧的段。段文件先写临时文件
+ * 再改名，启动时扫描目录恢复段列表，并从已持久化的最大行号继续编号。
+ * 查询先取热层快照，再加上行号早于快照的冷层和温层段，按行号顺序输出，
+ * 同一行只由一层提供。各层的容量、段数和提供的行数定期导出为指标。
+ *
+ * 离线导入的历史数据使用最高位为1的独立行号空间，与接收路径的行号互不重叠；
+ * 导入工具直接把段写入同一目录，运行中的存储在每轮迁移时纳入新出现的导入段。
+ * 查询结果中导入段在前。
+ *
+ * 查询按段和热层的块拆分为分区，由存储持有的查询工作线程与调用线程一起执行，
+ * 各分区的部分结果按分区顺序合并，结果与逐段执行相同。工作线程数固定，
+ * 所有查询共用，查询占用的核数不超过工作线程数加上并发调用查询的线程数，
+ * 其余核留给接收路径。每次查询可以被其他线程取消，分区执行前按最坏情况
+ * 预留内存，超过查询的内存上限时停止。
+ *
+ * 段列表每次变化后写入目录下的目录文件 (catalog，每段一条定长记录)。启动时映射目录文件，
+ * 只列出段目录核对文件名，不打开段文件：段在首次被查询或压缩时才读取文件头并建立映射
+ * (目录文件中没有的段，如崩溃前刚写出的段，仍在启动时直接打开)。
+ * 后台预热线程从最新的段开始并行加载全部段，温层段同时预读到页缓存。
+ */
+
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include "realtime_store.h"
+#include "../utils/async_io.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HISTORY_SEGMENT_MAGIC "TPHS"        // 段文件魔数
+#define HISTORY_SEGMENT_VERSION 1           // 段文件格式版本
+#define HISTORY_COLUMN_ALIGN 64             // 温层段的列对齐字节数
+#define HISTORY_DEFAULT_WARM_BYTES (1ULL << 30)     // 默认温层容量目标 (1GiB)
+#define HISTORY_DEFAULT_COLD_BYTES (8ULL << 30)     // 默认冷层容量目标 (8GiB)
+#define HISTORY_DEFAULT_MIGRATE_MS 10000    // 默认迁移周期(毫秒)
+#define HISTORY_IMPORT_ROW_BIT (1ULL << 63) // 导入段行号空间的标志位
+#define HISTORY_DEFAULT_QUERY_BYTES (512ULL << 20)  // 默认单次查询内存上限 (512MiB)
+#define HISTORY_MAX_QUERY_THREADS 64        // 查询工作线程数上限
+#define HISTORY_CATALOG_MAGIC "TPHC"        // 目录文件魔数
+#define HISTORY_CATALOG_VERSION 1           // 目录文件格式版本
+#define HISTORY_DEFAULT_WARMUP_THREADS 2    // 默认预热线程数
+#define HISTORY_MAX_WARMUP_THREADS 16       // 预热线程数上限
+
+/**
+ * @brief 存储层
+ */
+typedef enum {
+    HISTORY_TIER_HOT = 0,       // 内存
+    HISTORY_TIER_WARM = 1,      // 未压缩mmap段
+    HISTORY_TIER_COLD = 2,      // 压缩段
+    HISTORY_TIER_COUNT = 3
+} history_tier_t;
+
+/**
+ * @brief 查询结束状态
+ */
+typedef enum {
+    HISTORY_QUERY_OK = 0,           // 完成
+    HISTORY_QUERY_FAILED = 1,       // 读段失败或内存分配失败
+    HISTORY_QUERY_CANCELLED = 2,    // 被取消
+    HISTORY_QUERY_OVER_LIMIT = 3    // 超过内存上限
+} history_query_status_t;
+
+/**
+ * @brief 查询控制：由调用方提供，查询期间其他线程可通过它取消查询
+ */
+typedef struct {
+    int cancel;                 // 取消标志 (用history_query_cancel设置)
+    uint64_t max_bytes;         // 部分结果和解压缓冲区的内存上限，0表示存储的默认值
+    uint64_t min_row;           // 只返回行号不小于此值的接收路径行，0表示不限
+    uint64_t max_row;           // 只返回行号小于此值的接收路径行，0表示不限
+    int exclude_imports;        // 是否跳过导入段
+    history_query_status_t status;  // 结束状态
+    size_t partitions;          // 拆分的分区数
+    size_t skipped;             // 因取消或超限未执行的分区数
+    uint64_t reserved_bytes;    // 结束时仍预留的内存 (即部分结果的大小)
+    uint64_t row_end;           // 热层快照的行号上界 (查询之后追加的行的行号不小于此值)
+} history_query_ctl_t;
+
+/**
+ * @brief 段文件头 (小端，列数据紧随其后)
+ */
+typedef struct {
+    char magic[4];              // HISTORY_SEGMENT_MAGIC
+    uint32_t version;           // HISTORY_SEGMENT_VERSION
+    uint32_t tier;              // 所在层
+    uint32_t row_count;         // 行数
+    uint64_t first_row;         // 首行的全局行号
+    int64_t min_timestamp_ms;   // 段内最早采集时间
+    int64_t max_timestamp_ms;   // 段内最晚采集时间
+    uint64_t column_offset[REALTIME_COLUMN_COUNT]; // 各列在文件中的偏移
+    uint64_t column_bytes[REALTIME_COLUMN_COUNT];  // 各列的字节数
+} history_segment_header_t;
+
+/**
+ * @brief 目录文件头 (小端，之后是count条记录，按段列表顺序)
+ */
+typedef struct {
+    char magic[4];              // HISTORY_CATALOG_MAGIC
+    uint32_t version;           // HISTORY_CATALOG_VERSION
+    uint64_t count;             // 记录数
+} history_catalog_header_t;
+
+/**
+ * @brief 目录文件中一个段的记录
+ */
+typedef struct {
+    uint32_t tier;              // 所在层
+    uint32_t rows;              // 行数
+    uint64_t first_row;         // 首行的全局行号
+    int64_t min_timestamp_ms;   // 段内最早采集时间
+    int64_t max_timestamp_ms;   // 段内最晚采集时间
+    uint64_t file_bytes;        // 文件大小
+} history_catalog_record_t;
+
+/**
+ * @brief 段 (温层或冷层的一个文件)
+ */
+typedef struct {
+    history_tier_t tier;        // 所在层
+    uint64_t first_row;         // 首行的全局行号
+    size_t rows;                // 行数
+    int64_t min_timestamp_ms;   // 段内最早采集时间
+    int64_t max_timestamp_ms;   // 段内最晚采集时间
+    size_t file_bytes;          // 文件大小
+    char path[320];             // 文件路径
+    uint8_t *map;               // 温层：文件映射
+    history_segment_header_t header; // 段文件头
+    int refs;                   // 引用计数 (段列表持有一个)
+    int state;                  // 加载状态：0只有目录记录，1已加载，-1加载失败 (原子访问)
+    pthread_mutex_t load_lock;  // 串行化首次加载
+} history_segment_t;
+
+/**
+ * @brief 分层存储配置
+ */
+typedef struct {
+    const char *dir;            // 段文件目录 (下设warm和cold子目录)
+    size_t hot_max_rows;        // 热层保留行数，0表示默认值
+    uint64_t warm_max_bytes;    // 温层容量目标，0表示默认值
+    uint64_t cold_max_bytes;    // 冷层容量目标，0表示默认值
+    int migrate_interval_ms;    // 迁移周期，0表示默认值
+    int query_threads;          // 查询工作线程数，0表示在线核数的一半，-1表示只在调用线程中执行
+    uint64_t query_max_bytes;   // 单次查询的默认内存上限，0表示默认值
+    async_io_t *io;             // 段文件读写和fsync经由的异步I/O，NULL表示在调用线程中直接执行
+    int warmup_threads;         // 启动后加载段的预热线程数，0表示默认值，-1表示不预热 (首次访问时加载)
+} history_config_t;
+
+/**
+ * @brief 分层存储
+ */
+typedef struct {
+    realtime_store_t hot;       // 热层 (接收路径直接追加)
+    char dir[256];              // 段文件目录
+    uint64_t warm_max_bytes;    // 温层容量目标
+    uint64_t cold_max_bytes;    // 冷层容量目标
+    int migrate_interval_ms;    // 迁移周期
+    async_io_t *io;             // 异步I/O (NULL表示直接读写)
+
+    pthread_mutex_t lock;       // 保护段列表
+    history_segment_t **segments; // 温层和冷层的段 (导入段在前，各自按首行行号递增)
+    size_t segment_count;       // 段数
+    size_t segment_capacity;    // 段数组容量
+    uint64_t tier_bytes[HISTORY_TIER_COUNT];    // 各层字节数 (热层为已分配的列内存)
+    size_t tier_segments[HISTORY_TIER_COUNT];   // 各层段数 (热层为块数)
+
+    pthread_mutex_t migrate_lock; // 串行化迁移
+    uint64_t persisted_end;     // 已写入段文件的行号上界
+    uint64_t migrated_rows;     // 累计从热层写出的行数
+    uint64_t compacted_rows;    // 累计压缩到冷层的行数
+    uint64_t dropped_rows;      // 累计从冷层删除的行数
+    uint64_t lost_rows;         // 迁移前已被热层淘汰的行数
+    uint64_t import_generation; // 纳入导入段的次数 (原子访问)
+    int64_t dropped_max_ms;     // 已从冷层删除的行的最晚采集时间 (原子访问)
+    uint64_t rows_served[HISTORY_TIER_COUNT];   // 各层累计提供的查询结果行数
+    uint64_t queries;           // 累计查询次数
+
+    pthread_t thread;           // 后台迁移线程
+    pthread_cond_t wakeup;      // 唤醒迁移线程
+    int running;                // 迁移线程是否运行
+
+    pthread_mutex_t query_lock; // 保护查询任务队列
+    pthread_cond_t query_ready; // 有待执行的分区或工作线程需要退出
+    struct history_query_job *query_jobs; // 还有未领取分区的查询 (链表)
+    pthread_t query_workers[HISTORY_MAX_QUERY_THREADS]; // 查询工作线程
+    int query_threads;          // 查询工作线程数
+    int query_stopping;         // 工作线程是否退出
+    uint64_t query_max_bytes;   // 单次查询的默认内存上限
+    uint64_t query_partitions;  // 累计执行的分区数
+    uint64_t worker_partitions; // 其中由工作线程执行的分区数
+    uint64_t queries_cancelled; // 累计被取消的查询数
+    uint64_t queries_over_limit;    // 累计超过内存上限的查询数
+
+    uint64_t list_generation;   // 段列表的修改次数 (持迁移锁)
+    uint64_t catalog_generation;    // 目录文件对应的修改次数
+    size_t catalog_segments;    // 启动时按目录文件延迟加载的段数
+    uint64_t lazy_loads;        // 由查询或压缩触发的加载次数 (原子访问)
+    pthread_t warmup_workers[HISTORY_MAX_WARMUP_THREADS]; // 预热线程
+    int warmup_threads;         // 预热线程数 (已等待结束后为0)
+    history_segment_t **warmup_list; // 待预热的段引用 (最新的在前)
+    size_t warmup_count;        // 待预热的段数
+    size_t warmup_next;         // 下一个待预热的段 (原子访问)
+    size_t warmup_done;         // 已预热的段数 (原子访问)
+    int warmup_stopping;        // 预热线程是否提前退出
+    int64_t warmup_start_ns;    // 预热开始时间 (单调时钟)
+} history_store_t;
+
+/**
+ * @brief 初始化分层存储：创建目录、恢复已有段并初始化热层
+ * @param hist 存储指针
+ * @param config 配置
+ * @return 0成功，-1失败
+ */
+int history_init(history_store_t *hist, const history_config_t *config);
+
+/**
+ * @brief 销毁分层存储：停止迁移线程，把热层中尚未写出的行 (含未写满的块) 写为段
+ * @param hist 存储指针
+ */
+void history_destroy(history_store_t *hist);
+
+/**
+ * @brief 等待预热线程加载完全部段
+ * @param hist 存储指针
+ */
+void history_wait_warmup(history_store_t *hist);
+
+/**
+ * @brief 启动后台迁移线程
+ * @param hist 存储指针
+ * @return 0成功，-1失败
+ */
+int history_start(history_store_t *hist);
+
+/**
+ * @brief 停止后台迁移线程
+ * @param hist 存储指针
+ */
+void history_stop(history_store_t *hist);
+
+/**
+ * @brief 执行一轮迁移：写出热层已写满的块，按容量目标压缩温层和删除冷层
+ * @param hist 存储指针
+ * @return 本轮写出的行数，-1写段文件失败
+ */
+int64_t history_migrate(history_store_t *hist);
+
+/**
+ * @brief 跨层查询，结果按行号顺序追加到out
+ * @param hist 存储指针
+ * @param query 查询条件
+ * @param out 输出列集合
+ * @return 匹配的行数，-1失败
+ */
+int64_t history_query(history_store_t *hist, const realtime_query_t *query, realtime_columns_t *out);
+
+/**
+ * @brief 跨层查询 (可取消，受内存上限约束)，结果按行号顺序追加到out
+ * @param hist 存储指针
+ * @param query 查询条件
+ * @param ctl 查询控制，NULL表示不可取消并使用默认内存上限
+ * @param out 输出列集合 (失败时不变)
+ * @return 匹配的行数，-1失败 (原因见ctl->status)
+ */
+int64_t history_query_run(history_store_t *hist, const realtime_query_t *query, history_query_ctl_t *ctl,
+                          realtime_columns_t *out);
+
+/**
+ * @brief 取消正在执行的查询 (可在任意线程调用，未领取的分区不再执行)
+ * @param ctl 查询控制
+ */
+void history_query_cancel(history_query_ctl_t *ctl);
+
+/**
+ * @brief 导出各层容量、段数、提供的行数和命中比例指标
+ * @param hist 存储指针
+ */
+void history_export_metrics(history_store_t *hist);
+
+/**
+ * @brief 把一组行直接写为段文件 (先写临时文件再改名，可与运行中的存储并发)
+ * @param dir 段文件目录
+ * @param tier 目标层 (温层或冷层)
+ * @param cols 行数据
+ * @param first_row 首行行号 (导入段须带HISTORY_IMPORT_ROW_BIT)
+ * @return 文件大小，-1失败
+ */
+int64_t history_write_segment(const char *dir, history_tier_t tier, const realtime_columns_t *cols,
+                              uint64_t first_row);
+
+/**
+ * @brief 扫描目录得到导入段的下一个行号
+ * @param dir 段文件目录
+ * @return 已有导入段的行号上界，没有时为HISTORY_IMPORT_ROW_BIT
+ */
+uint64_t history_import_next_row(const char *dir);
+
+/**
+ * @brief 层名称
+ * @param tier 存储层
+ * @return 名称字符串
+ */
+const char *history_tier_name(history_tier_t tier);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HISTORY_STORE_H
@@ -0,0 +1,394 @@
+/**
+ * @file query_cache.c
+ * @brief 历史数据分桶聚合查询的结果缓存实现
+ */
+
+#include "query_cache.h"
+#include "../utils/logger.h"
+#include "../utils/metrics.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 向下对齐到桶边界
+ */
+static inline int64_t floor_bucket(int64_t value, int64_t bucket_ms) {
+    int64_t rem = value % bucket_ms;
+    return rem < 0 ? value - rem - bucket_ms : value - rem;
+}
+
+/**
+ * @brief [from, to)跨越的桶数 (跨度可能超过INT64_MAX，按无符号计算)
+ */
+static inline uint64_t bucket_span(int64_t from, int64_t to, int64_t bucket_ms) {
+    return ((uint64_t)to - (uint64_t)from) / (uint64_t)bucket_ms;
+}
+
+/**
+ * @brief 从from起第index个桶的起始时间 (结果在范围内，中间值按无符号计算)
+ */
+static inline int64_t bucket_start(int64_t from, uint64_t index, int64_t bucket_ms) {
+    return (int64_t)((uint64_t)from + index * (uint64_t)bucket_ms);
+}
+
+/**
+ * @brief 比较两个过滤条件 (不含时间范围)
+ */
+static int filter_equal(const realtime_query_t *a, const realtime_query_t *b) {
+    if (a->match_device != b->match_device || a->channel_id != b->channel_id) {
+        return 0;
+    }
+    return !a->match_device || (a->device.admin_code == b->device.admin_code &&
+                                a->device.device_type == b->device.device_type &&
+                                a->device.device_id == b->device.device_id);
+}
+
+/**
+ * @brief 把一批行累加到桶中 (行的采集时间都在桶的范围内)
+ */
+static void aggregate_rows(query_bucket_t *buckets, int64_t start_ms, int64_t bucket_ms,
+                           const realtime_columns_t *rows) {
+    for (size_t i = 0; i < rows->count; i++) {
+        query_bucket_t *bucket = &buckets[bucket_span(start_ms, rows->timestamp_ms[i], bucket_ms)];
+        bucket->rows++;
+        bucket->count_a += rows->count_a[i];
+        bucket->count_b += rows->count_b[i];
+        bucket->count_c += rows->count_c[i];
+        bucket->occupancy_sum += rows->occupancy[i];
+        bucket->speed_sum += rows->speed[i];
+    }
+}
+
+/**
+ * @brief 查询一个时间段并累加到桶中
+ * @param first_bucket 时间段的第一个桶
+ * @param ctl 查询控制 (行号范围)，返回热层快照的行号上界
+ * @return 聚合的行数，-1失败
+ */
+static int64_t scan_range(query_cache_t *cache, const realtime_query_t *filter, int64_t start_ms, int64_t end_ms,
+                          int64_t bucket_ms, query_bucket_t *first_bucket, history_query_ctl_t *ctl) {
+    realtime_query_t query = *filter;
+    query.start_ms = start_ms;
+    query.end_ms = end_ms;
+
+    realtime_columns_t rows;
+    if (realtime_columns_init(&rows, 0) < 0) {
+        return -1;
+    }
+    int64_t matched = history_query_run(cache->hist, &query, ctl, &rows);
+    if (matched > 0) {
+        aggregate_rows(first_bucket, start_ms, bucket_ms, &rows);
+    }
+    realtime_columns_free(&rows);
+    return matched;
+}
+
+/**
+ * @brief 释放缓存项
+ */
+static void entry_clear(query_cache_entry_t *entry) {
+    free(entry->buckets);
+    memset(entry, 0, sizeof(query_cache_entry_t));
+}
+
+/**
+ * @brief 查找可复用或正在计算的缓存项：过滤条件和桶宽相同，且查询起点落在缓存的范围内
+ */
+static query_cache_entry_t *find_entry(query_cache_t *cache, const realtime_query_t *key, int64_t bucket_ms) {
+    for (size_t i = 0; i < cache->capacity; i++) {
+        query_cache_entry_t *entry = &cache->entries[i];
+        if ((entry->valid || entry->busy) && entry->bucket_ms == bucket_ms && filter_equal(&entry->filter, key) &&
+            entry->filter.start_ms <= key->start_ms && key->start_ms < entry->filter.end_ms) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 选择空闲或最久未使用的缓存项 (跳过正在计算的项)
+ * @return 缓存项，全部正在计算时返回NULL
+ */
+static query_cache_entry_t *victim_entry(query_cache_t *cache) {
+    query_cache_entry_t *victim = NULL;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        query_cache_entry_t *entry = &cache->entries[i];
+        if (entry->busy) {
+            continue;
+        }
+        if (!entry->valid) {
+            return entry;
+        }
+        if (!victim || entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+    if (victim) {
+        entry_clear(victim);
+    }
+    return victim;
+}
+
+/**
+ * @brief 完整计算一个缓存项
+ * @return 聚合的行数，-1失败
+ */
+static int64_t entry_compute(query_cache_t *cache, query_cache_entry_t *entry, const realtime_query_t *key,
+                             int64_t bucket_ms) {
+    size_t count = (size_t)bucket_span(key->start_ms, key->end_ms, bucket_ms);
+    entry->buckets = calloc(count, sizeof(query_bucket_t));
+    if (!entry->buckets) {
+        return -1;
+    }
+    for (size_t b = 0; b < count; b++) {
+        entry->buckets[b].start_ms = bucket_start(key->start_ms, b, bucket_ms);
+    }
+
+    // 先记录数据版本再查询，查询期间发生的变化留到下次重算
+    entry->import_generation = __atomic_load_n(&cache->hist->import_generation, __ATOMIC_ACQUIRE);
+    entry->dropped_max_ms = __atomic_load_n(&cache->hist->dropped_max_ms, __ATOMIC_ACQUIRE);
+
+    history_query_ctl_t ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    int64_t rows = scan_range(cache, key, key->start_ms, key->end_ms, bucket_ms, entry->buckets, &ctl);
+    if (rows < 0) {
+        entry_clear(entry);
+        return -1;
+    }
+    entry->valid = 1;
+    entry->filter = *key;
+    entry->bucket_ms = bucket_ms;
+    entry->bucket_count = count;
+    entry->watermark = ctl.row_end;
+    return rows;
+}
+
+/**
+ * @brief 补入水位之后追加的行，再把缓存范围向后扩展到end_ms
+ * @return 聚合的行数，-1失败
+ */
+static int64_t entry_refresh(query_cache_t *cache, query_cache_entry_t *entry, int64_t end_ms) {
+    history_query_ctl_t ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.min_row = entry->watermark;
+    ctl.exclude_imports = 1;
+    int64_t scanned = scan_range(cache, &entry->filter, entry->filter.start_ms, entry->filter.end_ms,
+                                 entry->bucket_ms, entry->buckets, &ctl);
+    if (scanned < 0) {
+        return -1;
+    }
+    entry->watermark = ctl.row_end;
+
+    if (end_ms > entry->filter.end_ms) {
+        size_t count = (size_t)bucket_span(entry->filter.start_ms, end_ms, entry->bucket_ms);
+        query_bucket_t *buckets = realloc(entry->buckets, count * sizeof(query_bucket_t));
+        if (!buckets) {
+            return -1;
+        }
+        memset(&buckets[entry->bucket_count], 0, (count - entry->bucket_count) * sizeof(query_bucket_t));
+        for (size_t b = entry->bucket_count; b < count; b++) {
+            buckets[b].start_ms = bucket_start(entry->filter.start_ms, b, entry->bucket_ms);
+        }
+        entry->buckets = buckets;
+
+        // 新增时间段只聚合水位之前的行，水位之后的行由下次补入
+        memset(&ctl, 0, sizeof(ctl));
+        ctl.max_row = entry->watermark;
+        int64_t rows = scan_range(cache, &entry->filter, entry->filter.end_ms, end_ms, entry->bucket_ms,
+                                  &buckets[entry->bucket_count], &ctl);
+        if (rows < 0) {
+            return -1;
+        }
+        scanned += rows;
+        entry->bucket_count = count;
+        entry->filter.end_ms = end_ms;
+    }
+    return scanned;
+}
+
+/**
+ * @brief 丢弃查询起点之前超出桶数上限的桶
+ */
+static void entry_trim(query_cache_entry_t *entry, int64_t start_ms) {
+    if (entry->bucket_count <= QUERY_CACHE_MAX_BUCKETS) {
+        return;
+    }
+    size_t drop = entry->bucket_count - QUERY_CACHE_MAX_BUCKETS;
+    size_t before = (size_t)bucket_span(entry->filter.start_ms, start_ms, entry->bucket_ms);
+    if (drop > before) {
+        drop = before;
+    }
+    memmove(entry->buckets, &entry->buckets[drop], (entry->bucket_count - drop) * sizeof(query_bucket_t));
+    entry->bucket_count -= drop;
+    entry->filter.start_ms = bucket_start(entry->filter.start_ms, drop, entry->bucket_ms);
+}
+
+/**
+ * @brief 初始化缓存
+ */
+int query_cache_init(query_cache_t *cache, history_store_t *hist, size_t capacity) {
+    if (!cache || !hist) {
+        return -1;
+    }
+
+    memset(cache, 0, sizeof(query_cache_t));
+    cache->hist = hist;
+    cache->capacity = capacity ? capacity : QUERY_CACHE_DEFAULT_ENTRIES;
+    cache->entries = calloc(cache->capacity, sizeof(query_cache_entry_t));
+    if (!cache->entries) {
+        LOG_ERROR("Failed to allocate query cache");
+        return -1;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->idle, NULL);
+    return 0;
+}
+
+/**
+ * @brief 销毁缓存
+ */
+void query_cache_destroy(query_cache_t *cache) {
+    if (!cache || !cache->entries) {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; i++) {
+        entry_clear(&cache->entries[i]);
+    }
+    free(cache->entries);
+    cache->entries = NULL;
+    pthread_mutex_destroy(&cache->lock);
+    pthread_cond_destroy(&cache->idle);
+}
+
+/**
+ * @brief 分桶聚合查询
+ */
+int64_t query_cache_aggregate(query_cache_t *cache, const realtime_query_t *query, int64_t bucket_ms,
+                              query_bucket_t *buckets, size_t max_buckets) {
+    if (!cache || !cache->entries || !query || !buckets || bucket_ms <= 0 || bucket_ms > QUERY_CACHE_MAX_BUCKET_MS ||
+        query->start_ms >= query->end_ms || query->start_ms < INT64_MIN / 2 || query->end_ms > INT64_MAX / 2) {
+        return -1;
+    }
+
+    // 规范化：时间范围向外对齐到桶边界，不按设备过滤时忽略设备标识
+    realtime_query_t key;
+    realtime_query_init(&key);
+    key.start_ms = floor_bucket(query->start_ms, bucket_ms);
+    key.end_ms = floor_bucket(query->end_ms - 1, bucket_ms) + bucket_ms;
+    key.match_device = query->match_device ? 1 : 0;
+    if (key.match_device) {
+        key.device = query->device;
+    }
+    key.channel_id = query->channel_id < 0 ? -1 : query->channel_id;
+    uint64_t count = bucket_span(key.start_ms, key.end_ms, bucket_ms);
+    if (count > max_buckets || count > QUERY_CACHE_MAX_BUCKETS) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->lookups++;
+
+    // 同一查询正在由其他线程计算时等待其完成，之后复用结果
+    query_cache_entry_t *entry;
+    while ((entry = find_entry(cache, &key, bucket_ms)) && entry->busy) {
+        pthread_cond_wait(&cache->idle, &cache->lock);
+    }
+    if (entry) {
+        // 纳入了导入段或删除了覆盖范围内的数据时，已有的桶不再可信
+        int64_t dropped = __atomic_load_n(&cache->hist->dropped_max_ms, __ATOMIC_ACQUIRE);
+        if (entry->import_generation != __atomic_load_n(&cache->hist->import_generation, __ATOMIC_ACQUIRE) ||
+            (dropped != entry->dropped_max_ms && dropped >= entry->filter.start_ms)) {
+            entry_clear(entry);
+            cache->invalidations++;
+        }
+    }
+
+    // 占用缓存项后在锁外计算：命中时刷新其副本，未命中时新算一项
+    // 未命中的项先登记查询键，使相同的并发查询等待而不重复计算；全部项都忙时算完不安装
+    query_cache_entry_t work;
+    int hit = entry && entry->valid;
+    if (hit) {
+        cache->hits++;
+        work = *entry;
+    } else {
+        memset(&work, 0, sizeof(work));
+        entry = victim_entry(cache);
+        if (entry) {
+            entry->filter = key;
+            entry->bucket_ms = bucket_ms;
+        }
+    }
+    if (entry) {
+        entry->busy = 1;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    int64_t scanned;
+    if (hit) {
+        scanned = entry_refresh(cache, &work, key.end_ms);
+        if (scanned < 0) {
+            entry_clear(&work);
+        }
+    } else {
+        scanned = entry_compute(cache, &work, &key, bucket_ms);
+    }
+
+    uint64_t saved = 0;
+    if (scanned >= 0) {
+        size_t first = (size_t)bucket_span(work.filter.start_ms, key.start_ms, bucket_ms);
+        memcpy(buckets, &work.buckets[first], count * sizeof(query_bucket_t));
+        if (hit) {
+            uint64_t rows = 0;
+            for (uint64_t b = 0; b < count; b++) {
+                rows += buckets[b].rows;
+            }
+            saved = rows > (uint64_t)scanned ? rows - (uint64_t)scanned : 0;
+        }
+        entry_trim(&work, key.start_ms);
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    if (entry) {
+        work.busy = 0;
+        work.last_used = ++cache->clock;
+        *entry = work;
+        pthread_cond_broadcast(&cache->idle);
+    } else {
+        entry_clear(&work);
+    }
+    if (scanned >= 0) {
+        cache->scanned_rows += (uint64_t)scanned;
+        cache->saved_rows += saved;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (scanned < 0) {
+        LOG_WARN("Aggregate query over history failed");
+        return -1;
+    }
+    return (int64_t)count;
+}
+
+/**
+ * @brief 导出缓存指标
+ */
+void query_cache_export_metrics(query_cache_t *cache) {
+    if (!cache || !cache->entries) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    size_t entries = 0;
+    for (size_t i = 0; i < cache->capacity; i++) {
+        entries += cache->entries[i].valid ? 1 : 0;
+    }
+    metrics_gauge_set("traffic_query_cache_entries", NULL, (double)entries);
+    metrics_gauge_set("traffic_query_cache_lookups_total", NULL, (double)cache->lookups);
+    metrics_gauge_set("traffic_query_cache_hits_total", NULL, (double)cache->hits);
+    metrics_gauge_set("traffic_query_cache_hit_ratio", NULL,
+                      cache->lookups ? (double)cache->hits / cache->lookups : 0);
+    metrics_gauge_set("traffic_query_cache_invalidations_total", NULL, (double)cache->invalidations);
+    metrics_gauge_set("traffic_query_cache_scanned_rows_total", NULL, (double)cache->scanned_rows);
+    metrics_gauge_set("traffic_query_cache_saved_rows_total", NULL, (double)cache->saved_rows);
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,115 @@
+/**
+ * @file query_cache.h
+ * @brief 历史数据分桶聚合查询的结果缓存
+ *
+ * 大屏按固定时间桶 (如15分钟、1小时) 反复刷新相同的聚合结果。
+ * 缓存以规范化的查询为键：过滤条件和桶宽相同、时间范围按桶边界对齐。
+ * 每个缓存项记录计算时热层快照的行号上界 (水位)，再次查询时只聚合
+ * 水位之后追加的行并累加到对应的桶中，迟到数据也随之补入，已结束的桶不再重算。
+ * 时间窗口向后滑动时保留重叠部分的桶，只计算新增的时间段。
+ * 纳入离线导入段或冷层删除了覆盖范围内的数据时，缓存项整体重算。
+ * 缓存项按最近使用淘汰。锁只保护查找、淘汰和安装：计算或刷新期间缓存项标记为忙，
+ * 在锁外查询历史存储，不同查询可以并行；同一查询的并发请求等待正在进行的计算，只计算一次。
+ */
+
+#ifndef QUERY_CACHE_H
+#define QUERY_CACHE_H
+
+#include "history_store.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUERY_CACHE_DEFAULT_ENTRIES 64  // 默认缓存项数
+#define QUERY_CACHE_MAX_BUCKETS 4096    // 单个缓存项保留的桶数上限
+#define QUERY_CACHE_MAX_BUCKET_MS (INT64_MAX / 4) // 桶宽上限 (对齐到桶边界后的时间不溢出)
+
+/**
+ * @brief 一个时间桶的聚合结果
+ */
+typedef struct {
+    int64_t start_ms;           // 桶起始时间
+    uint64_t rows;              // 行数
+    uint64_t count_a;           // A类车流量之和
+    uint64_t count_b;           // B类车流量之和
+    uint64_t count_c;           // C类车流量之和
+    uint64_t occupancy_sum;     // 时间占有率之和 (0.1%)
+    uint64_t speed_sum;         // 车辆速度之和 (km/h)
+} query_bucket_t;
+
+/**
+ * @brief 缓存项
+ */
+typedef struct {
+    int valid;                  // 是否在用
+    realtime_query_t filter;    // 规范化的过滤条件 (时间范围为缓存的范围)
+    int64_t bucket_ms;          // 桶宽
+    query_bucket_t *buckets;    // 桶 (按时间顺序，覆盖filter的时间范围)
+    size_t bucket_count;        // 桶数
+    uint64_t watermark;         // 已聚合的接收路径行号上界
+    uint64_t import_generation; // 计算时存储已纳入导入段的次数
+    int64_t dropped_max_ms;     // 计算时冷层已删除数据的最晚采集时间
+    uint64_t last_used;         // 最近使用序号
+    int busy;                   // 正在由某个线程在锁外计算或刷新 (不淘汰、不复用)
+} query_cache_entry_t;
+
+/**
+ * @brief 查询结果缓存
+ */
+typedef struct {
+    history_store_t *hist;      // 历史存储
+    pthread_mutex_t lock;       // 保护缓存项的查找、淘汰和安装
+    pthread_cond_t idle;        // 某个缓存项计算完成
+    query_cache_entry_t *entries; // 缓存项
+    size_t capacity;            // 缓存项数
+    uint64_t clock;             // 使用序号
+
+    uint64_t lookups;           // 累计查询次数
+    uint64_t hits;              // 命中次数 (复用了已有缓存项)
+    uint64_t invalidations;     // 因导入或删除数据而整体重算的次数
+    uint64_t scanned_rows;      // 累计实际聚合的行数
+    uint64_t saved_rows;        // 累计复用桶中的行数 (免于重新扫描)
+} query_cache_t;
+
+/**
+ * @brief 初始化缓存
+ * @param cache 缓存指针
+ * @param hist 历史存储
+ * @param capacity 缓存项数，0表示默认值
+ * @return 0成功，-1失败
+ */
+int query_cache_init(query_cache_t *cache, history_store_t *hist, size_t capacity);
+
+/**
+ * @brief 销毁缓存
+ * @param cache 缓存指针
+ */
+void query_cache_destroy(query_cache_t *cache);
+
+/**
+ * @brief 分桶聚合查询 (经缓存)
+ * @param cache 缓存指针
+ * @param query 过滤条件，时间范围须有界，向外对齐到桶边界
+ * @param bucket_ms 桶宽(毫秒)，不超过QUERY_CACHE_MAX_BUCKET_MS
+ * @param buckets 输出桶数组
+ * @param max_buckets 输出数组容量
+ * @return 桶数，-1失败 (参数错误、桶数超过容量或查询失败)
+ */
+int64_t query_cache_aggregate(query_cache_t *cache, const realtime_query_t *query, int64_t bucket_ms,
+                              query_bucket_t *buckets, size_t max_buckets);
+
+/**
+ * @brief 导出命中率、实际聚合行数和复用行数指标
+ * @param cache 缓存指针
+ */
+void query_cache_export_metrics(query_cache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUERY_CACHE_H
@@ -0,0 +1,370 @@
+/**
+ * @file realtime_store.c
+ * @brief 进程内的交通流实时信息列式存储实现
+ */
+
+#include "realtime_store.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define QUERY_BATCH_ROWS 4096   // 查询时每批处理的行数 (选择向量长度)
+
+/**
+ * @brief 创建空块
+ */
+static realtime_chunk_t *chunk_create(uint64_t first_row) {
+    realtime_chunk_t *chunk = calloc(1, sizeof(realtime_chunk_t));
+    if (!chunk) {
+        return NULL;
+    }
+
+    if (realtime_columns_init(&chunk->columns, REALTIME_STORE_CHUNK_ROWS) < 0) {
+        realtime_columns_free(&chunk->columns);
+        free(chunk);
+        return NULL;
+    }
+
+    chunk->first_row = first_row;
+    chunk->min_timestamp_ms = INT64_MAX;
+    chunk->max_timestamp_ms = INT64_MIN;
+    chunk->refs = 1;
+    return chunk;
+}
+
+/**
+ * @brief 增加块引用
+ */
+void realtime_chunk_retain(realtime_chunk_t *chunk) {
+    if (chunk) {
+        __atomic_add_fetch(&chunk->refs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief 释放块引用
+ */
+void realtime_chunk_release(realtime_chunk_t *chunk) {
+    if (chunk && __atomic_sub_fetch(&chunk->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        realtime_columns_free(&chunk->columns);
+        free(chunk);
+    }
+}
+
+/**
+ * @brief 初始化存储
+ */
+int realtime_store_init(realtime_store_t *store, size_t max_rows) {
+    if (!store) {
+        return -1;
+    }
+
+    memset(store, 0, sizeof(realtime_store_t));
+    store->max_chunks = max_rows ? (max_rows + REALTIME_STORE_CHUNK_ROWS - 1) / REALTIME_STORE_CHUNK_ROWS
+                                 : REALTIME_STORE_DEFAULT_CHUNKS;
+    if (store->max_chunks < 2) {
+        store->max_chunks = 2;
+    }
+
+    store->chunks = calloc(store->max_chunks, sizeof(realtime_chunk_t *));
+    if (!store->chunks) {
+        LOG_ERROR("Failed to allocate realtime store");
+        return -1;
+    }
+
+    pthread_mutex_init(&store->lock, NULL);
+    LOG_INFO("Realtime store initialized - %zu chunks of %d rows",
+             store->max_chunks, REALTIME_STORE_CHUNK_ROWS);
+    return 0;
+}
+
+/**
+ * @brief 销毁存储
+ */
+void realtime_store_destroy(realtime_store_t *store) {
+    if (!store || !store->chunks) {
+        return;
+    }
+
+    for (size_t i = 0; i < store->chunk_count; i++) {
+        realtime_chunk_release(store->chunks[(store->head + i) % store->max_chunks]);
+    }
+    free(store->chunks);
+    store->chunks = NULL;
+    store->chunk_count = 0;
+    pthread_mutex_destroy(&store->lock);
+}
+
+/**
+ * @brief 获取可容纳rows行的当前块，不足时新建块并按需淘汰最旧的块 (调用方持锁)
+ */
+static realtime_chunk_t *writable_chunk(realtime_store_t *store, size_t rows) {
+    if (store->chunk_count > 0) {
+        realtime_chunk_t *tail = store->chunks[(store->head + store->chunk_count - 1) % store->max_chunks];
+        if (tail->columns.count + rows <= REALTIME_STORE_CHUNK_ROWS) {
+            return tail;
+        }
+    }
+
+    realtime_chunk_t *chunk = chunk_create(store->total_rows);
+    if (!chunk) {
+        LOG_ERROR("Failed to allocate realtime store chunk");
+        return NULL;
+    }
+
+    if (store->chunk_count == store->max_chunks) {
+        realtime_chunk_t *oldest = store->chunks[store->head];
+        store->evicted_rows += oldest->columns.count;
+        realtime_chunk_release(oldest);
+        store->head = (store->head + 1) % store->max_chunks;
+        store->chunk_count--;
+    }
+
+    store->chunks[(store->head + store->chunk_count) % store->max_chunks] = chunk;
+    store->chunk_count++;
+    return chunk;
+}
+
+/**
+ * @brief 追加一条实时信息的消息内容
+ */
+int realtime_store_append(realtime_store_t *store, const device_id_t *sender,
+                          const uint8_t *content, size_t content_len, int64_t received_ns) {
+    if (!store || !sender || !content || content_len < REALTIME_CONTENT_HEADER_SIZE) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+
+    int rows = -1;
+    realtime_chunk_t *chunk = writable_chunk(store, content[6]);
+    if (chunk) {
+        // 块容量足够，解码不会重新分配列数组，快照持有的列指针保持有效
+        size_t first = chunk->columns.count;
+        rows = realtime_decode_content(&chunk->columns, sender, content, content_len, received_ns);
+        if (rows > 0) {
+            int64_t ts = chunk->columns.timestamp_ms[first];
+            if (ts < chunk->min_timestamp_ms) {
+                chunk->min_timestamp_ms = ts;
+            }
+            if (ts > chunk->max_timestamp_ms) {
+                chunk->max_timestamp_ms = ts;
+            }
+            store->total_rows += rows;
+        }
+    }
+
+    pthread_mutex_unlock(&store->lock);
+    return rows;
+}
+
+/**
+ * @brief 追加一个完整帧
+ */
+int realtime_store_append_frame(realtime_store_t *store, const uint8_t *frame,
+                                size_t frame_len, int64_t received_ns) {
+    if (!store || !frame) {
+        return -1;
+    }
+
+    // 先解码到临时列集合，只对实时信息帧加锁追加
+    realtime_columns_t scratch;
+    if (realtime_columns_init(&scratch, 0) < 0) {
+        return -1;
+    }
+
+    int rows = realtime_decode_frame(&scratch, frame, frame_len, received_ns);
+    if (rows > 0) {
+        pthread_mutex_lock(&store->lock);
+        realtime_chunk_t *chunk = writable_chunk(store, rows);
+        if (chunk) {
+            realtime_columns_t *dst = &chunk->columns;
+            for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+                size_t item = realtime_column_info[i].item_size;
+                memcpy((uint8_t *)realtime_column_data(dst, i) + dst->count * item,
+                       realtime_column_data(&scratch, i), rows * item);
+            }
+            dst->count += rows;
+            if (scratch.timestamp_ms[0] < chunk->min_timestamp_ms) {
+                chunk->min_timestamp_ms = scratch.timestamp_ms[0];
+            }
+            if (scratch.timestamp_ms[0] > chunk->max_timestamp_ms) {
+                chunk->max_timestamp_ms = scratch.timestamp_ms[0];
+            }
+            store->total_rows += rows;
+        } else {
+            rows = -1;
+        }
+        pthread_mutex_unlock(&store->lock);
+    }
+
+    realtime_columns_free(&scratch);
+    return rows;
+}
+
+/**
+ * @brief 生成快照
+ */
+int realtime_store_snapshot(realtime_store_t *store, realtime_snapshot_t *snapshot) {
+    if (!store || !snapshot) {
+        return -1;
+    }
+
+    memset(snapshot, 0, sizeof(realtime_snapshot_t));
+    snapshot->chunks = malloc(store->max_chunks * sizeof(realtime_chunk_t *));
+    snapshot->rows = malloc(store->max_chunks * sizeof(size_t));
+    if (!snapshot->chunks || !snapshot->rows) {
+        free(snapshot->chunks);
+        free(snapshot->rows);
+        snapshot->chunks = NULL;
+        snapshot->rows = NULL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&store->lock);
+    for (size_t i = 0; i < store->chunk_count; i++) {
+        realtime_chunk_t *chunk = store->chunks[(store->head + i) % store->max_chunks];
+        realtime_chunk_retain(chunk);
+        snapshot->chunks[i] = chunk;
+        snapshot->rows[i] = chunk->columns.count;
+        snapshot->total_rows += chunk->columns.count;
+    }
+    snapshot->chunk_count = store->chunk_count;
+    snapshot->end_row = store->total_rows;
+    pthread_mutex_unlock(&store->lock);
+
+    return 0;
+}
+
+/**
+ * @brief 释放快照
+ */
+void realtime_snapshot_release(realtime_snapshot_t *snapshot) {
+    if (!snapshot) {
+        return;
+    }
+
+    for (size_t i = 0; i < snapshot->chunk_count; i++) {
+        realtime_chunk_release(snapshot->chunks[i]);
+    }
+    free(snapshot->chunks);
+    free(snapshot->rows);
+    memset(snapshot, 0, sizeof(realtime_snapshot_t));
+}
+
+/**
+ * @brief 初始化查询条件为不过滤
+ */
+void realtime_query_init(realtime_query_t *query) {
+    if (query) {
+        memset(query, 0, sizeof(realtime_query_t));
+        query->start_ms = INT64_MIN;
+        query->end_ms = INT64_MAX;
+        query->channel_id = -1;
+    }
+}
+
+/**
+ * @brief 按选择向量收集一列
+ */
+static void gather_column(void *dst, const void *src, size_t item_size,
+                          const uint32_t *selection, size_t selected) {
+    switch (item_size) {
+        case 1:
+            for (size_t i = 0; i < selected; i++) {
+                ((uint8_t *)dst)[i] = ((const uint8_t *)src)[selection[i]];
+            }
+            break;
+        case 2:
+            for (size_t i = 0; i < selected; i++) {
+                ((uint16_t *)dst)[i] = ((const uint16_t *)src)[selection[i]];
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < selected; i++) {
+                ((uint32_t *)dst)[i] = ((const uint32_t *)src)[selection[i]];
+            }
+            break;
+        default:
+            for (size_t i = 0; i < selected; i++) {
+                ((uint64_t *)dst)[i] = ((const uint64_t *)src)[selection[i]];
+            }
+            break;
+    }
+}
+
+/**
+ * @brief 在快照上按条件查询
+ */
+int64_t realtime_snapshot_query(const realtime_snapshot_t *snapshot, const realtime_query_t *query,
+                                realtime_columns_t *out) {
+    if (!snapshot || !query || !out) {
+        return -1;
+    }
+
+    uint32_t selection[QUERY_BATCH_ROWS];
+    int64_t matched = 0;
+
+    for (size_t c = 0; c < snapshot->chunk_count; c++) {
+        const realtime_chunk_t *chunk = snapshot->chunks[c];
+        const realtime_columns_t *cols = &chunk->columns;
+        size_t rows = snapshot->rows[c];
+
+        // 整块不在时间范围内时跳过
+        if (rows == 0 || chunk->max_timestamp_ms < query->start_ms ||
+            chunk->min_timestamp_ms >= query->end_ms) {
+            continue;
+        }
+
+        for (size_t base = 0; base < rows; base += QUERY_BATCH_ROWS) {
+            size_t batch = rows - base < QUERY_BATCH_ROWS ? rows - base : QUERY_BATCH_ROWS;
+            size_t selected = 0;
+
+            // 时间条件生成初始选择向量
+            const int64_t *ts = cols->timestamp_ms + base;
+            for (size_t i = 0; i < batch; i++) {
+                selection[selected] = (uint32_t)(base + i);
+                selected += (ts[i] >= query->start_ms && ts[i] < query->end_ms);
+            }
+
+            // 设备和通道条件逐列收窄选择向量
+            if (query->match_device) {
+                size_t kept = 0;
+                for (size_t i = 0; i < selected; i++) {
+                    uint32_t row = selection[i];
+                    selection[kept] = row;
+                    kept += (cols->device_id[row] == query->device.device_id &&
+                             cols->device_type[row] == query->device.device_type &&
+                             cols->admin_code[row] == query->device.admin_code);
+                }
+                selected = kept;
+            }
+            if (query->channel_id >= 0) {
+                size_t kept = 0;
+                for (size_t i = 0; i < selected; i++) {
+                    uint32_t row = selection[i];
+                    selection[kept] = row;
+                    kept += (cols->channel_id[row] == query->channel_id);
+                }
+                selected = kept;
+            }
+
+            if (selected == 0) {
+                continue;
+            }
+            if (realtime_columns_reserve(out, out->count + selected) < 0) {
+                return -1;
+            }
+
+            for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+                size_t item = realtime_column_info[i].item_size;
+                gather_column((uint8_t *)realtime_column_data(out, i) + out->count * item,
+                              realtime_column_data(cols, i), item, selection, selected);
+            }
+            out->count += selected;
+            matched += selected;
+        }
+    }
+
+    return matched;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file realtime_store.h
+ * @brief 进程内的交通流实时信息列式存储
+ *
+ * 数据按固定行数分块存放，每块的各列在创建时一次分配，之后只追加不移动，
+ * 读者持有块引用即可直接访问列数组 (零拷贝)。超过保留块数时淘汰最旧的块，
+ * 仍被读者引用的块在最后一个引用释放时才回收。
+ */
+
+#ifndef REALTIME_STORE_H
+#define REALTIME_STORE_H
+
+#include "../common/realtime_codec.h"
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define REALTIME_STORE_CHUNK_ROWS 65536     // 每块行数
+#define REALTIME_STORE_DEFAULT_CHUNKS 64    // 默认保留块数
+
+/**
+ * @brief 存储块
+ */
+typedef struct {
+    realtime_columns_t columns; // 列数据 (容量固定为REALTIME_STORE_CHUNK_ROWS)
+    uint64_t first_row;         // 首行的全局行号
+    int64_t min_timestamp_ms;   // 块内最早采集时间
+    int64_t max_timestamp_ms;   // 块内最晚采集时间
+    int refs;                   // 引用计数 (存储本身持有一个)
+} realtime_chunk_t;
+
+/**
+ * @brief 列式存储
+ * 追加和生成快照时持锁，扫描快照时不持锁
+ */
+typedef struct {
+    pthread_mutex_t lock;       // 保护块列表和追加
+    realtime_chunk_t **chunks;  // 块环形数组
+    size_t max_chunks;          // 最多保留块数
+    size_t head;                // 最旧块的下标
+    size_t chunk_count;         // 当前块数
+    uint64_t total_rows;        // 累计追加行数
+    uint64_t evicted_rows;      // 已淘汰行数
+} realtime_store_t;
+
+/**
+ * @brief 存储快照：生成时各块的引用和行数
+ */
+typedef struct {
+    realtime_chunk_t **chunks;  // 块引用
+    size_t *rows;               // 生成快照时各块的行数
+    size_t chunk_count;         // 块数
+    uint64_t total_rows;        // 快照内总行数
+    uint64_t end_row;           // 生成快照时的累计追加行数 (之后追加的行号不小于此值)
+} realtime_snapshot_t;
+
+/**
+ * @brief 查询条件
+ */
+typedef struct {
+    int64_t start_ms;           // 采集时间下限 (含)
+    int64_t end_ms;             // 采集时间上限 (不含)
+    int match_device;           // 是否按设备过滤
+    device_id_t device;         // 设备标识
+    int channel_id;             // 通道编号，-1表示全部通道
+} realtime_query_t;
+
+/**
+ * @brief 初始化存储
+ * @param store 存储指针
+ * @param max_rows 最多保留行数，0表示默认值，按块数向上取整
+ * @return 0成功，-1失败
+ */
+int realtime_store_init(realtime_store_t *store, size_t max_rows);
+
+/**
+ * @brief 销毁存储，释放存储持有的块引用
+ * @param store 存储指针
+ */
+void realtime_store_destroy(realtime_store_t *store);
+
+/**
+ * @brief 追加一条实时信息的消息内容
+ * @param store 存储指针
+ * @param sender 发送方标识
+ * @param content 消息内容
+ * @param content_len 内容长度
+ * @param received_ns 接收时间(Unix纳秒)
+ * @return 追加的行数，-1失败
+ */
+int realtime_store_append(realtime_store_t *store, const device_id_t *sender,
+                          const uint8_t *content, size_t content_len, int64_t received_ns);
+
+/**
+ * @brief 追加一个完整帧 (非实时信息帧被忽略)
+ * @return 追加的行数，-1表示帧损坏或内存不足
+ */
+int realtime_store_append_frame(realtime_store_t *store, const uint8_t *frame,
+                                size_t frame_len, int64_t received_ns);
+
+/**
+ * @brief 增加块引用
+ * @param chunk 块指针
+ */
+void realtime_chunk_retain(realtime_chunk_t *chunk);
+
+/**
+ * @brief 释放块引用，最后一个引用释放时回收块
+ * @param chunk 块指针
+ */
+void realtime_chunk_release(realtime_chunk_t *chunk);
+
+/**
+ * @brief 生成快照，快照内的块在释放快照前不会被回收
+ * @param store 存储指针
+ * @param snapshot 输出快照
+ * @return 0成功，-1内存不足
+ */
+int realtime_store_snapshot(realtime_store_t *store, realtime_snapshot_t *snapshot);
+
+/**
+ * @brief 释放快照
+ * @param snapshot 快照指针
+ */
+void realtime_snapshot_release(realtime_snapshot_t *snapshot);
+
+/**
+ * @brief 在快照上按条件查询，结果按列追加到out
+ * 先按块的时间范围跳过整块，再逐列生成选择向量并按列收集
+ * @param snapshot 快照
+ * @param query 查询条件
+ * @param out 输出列集合
+ * @return 匹配的行数，-1内存不足
+ */
+int64_t realtime_snapshot_query(const realtime_snapshot_t *snapshot, const realtime_query_t *query,
+                                realtime_columns_t *out);
+
+/**
+ * @brief 初始化查询条件为不过滤
+ * @param query 查询条件指针
+ */
+void realtime_query_init(realtime_query_t *query);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REALTIME_STORE_H
@@ -0,0 +1,1366 @@
+/**
+ * @file rule_engine.c
+ * @brief 实时信息阈值规则引擎实现
+ */
+
+#include "rule_engine.h"
+#include "../utils/logger.h"
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// 操作码
+#define RULE_OP_CMP 1           // 比较一列，压入掩码
+#define RULE_OP_CONST 2         // 压入全0或全1掩码 (常量超出列取值范围时折叠)
+#define RULE_OP_AND 3           // 弹出两个掩码，压入按位与
+#define RULE_OP_OR 4            // 弹出两个掩码，压入按位或
+#define RULE_OP_NOT 5           // 栈顶掩码取反
+#define RULE_OP_SKIP_IF_NONE 6  // 栈顶掩码全为0时跳到target (and的短路)
+#define RULE_OP_SKIP_IF_ALL 7   // 栈顶掩码全为1时跳到target (or的短路)
+
+// 比较符
+#define RULE_CMP_LT 0
+#define RULE_CMP_LE 1
+#define RULE_CMP_GT 2
+#define RULE_CMP_GE 3
+#define RULE_CMP_EQ 4
+#define RULE_CMP_NE 5
+
+#define RULE_STATE_INITIAL 64   // 通道状态哈希表初始容量
+
+/**
+ * @brief 规则文本解析器
+ */
+typedef struct {
+    const char *p;              // 当前位置
+    rule_t *rule;               // 正在编译的规则
+    int depth;                  // 括号和not的嵌套深度
+    int top_or;                 // 顶层是否出现or (出现时顶层比较不能用于跳过整块)
+    const char *error;          // 错误信息 (NULL表示无错误)
+} rule_parser_t;
+
+/**
+ * @brief 一个评估线程负责的规则区间
+ */
+typedef struct rule_worker {
+    rule_engine_t *engine;
+    rule_set_t *set;
+    const realtime_columns_t *rows;
+    int64_t now_ms;
+    size_t first;               // 第一条规则
+    size_t last;                // 最后一条规则之后
+    int active;                 // 本轮是否有区间 (工作线程)
+} rule_worker_t;
+
+/* ========== 编译 ========== */
+
+/**
+ * @brief 跳过空白
+ */
+static void skip_space(rule_parser_t *parser) {
+    while (*parser->p == ' ' || *parser->p == '\t') {
+        parser->p++;
+    }
+}
+
+/**
+ * @brief 读取一个标识符
+ * @return 标识符长度，0表示当前位置不是标识符
+ */
+static size_t read_ident(rule_parser_t *parser, const char **start) {
+    skip_space(parser);
+    const char *p = parser->p;
+    while (isalnum((unsigned char)*p) || *p == '_') {
+        p++;
+    }
+    if (p == parser->p || isdigit((unsigned char)*parser->p)) {
+        return 0;
+    }
+    *start = parser->p;
+    return (size_t)(p - parser->p);
+}
+
+/**
+ * @brief 当前位置是关键字时消费它
+ */
+static int accept_keyword(rule_parser_t *parser, const char *keyword) {
+    const char *start;
+    size_t len = read_ident(parser, &start);
+    if (len == strlen(keyword) && strncmp(start, keyword, len) == 0) {
+        parser->p += len;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 读取一个整数
+ */
+static int read_number(rule_parser_t *parser, int64_t *value) {
+    skip_space(parser);
+    char *end;
+    errno = 0;
+    long long v = strtoll(parser->p, &end, 10);
+    if (end == parser->p || errno == ERANGE) {
+        parser->error = "expected integer";
+        return -1;
+    }
+    parser->p = end;
+    *value = v;
+    return 0;
+}
+
+/**
+ * @brief 追加一条指令
+ * @return 指令下标，-1表示超出上限
+ */
+static int emit(rule_parser_t *parser, uint8_t op) {
+    rule_t *rule = parser->rule;
+    if (rule->code_len >= RULE_MAX_CODE) {
+        parser->error = "expression too long";
+        return -1;
+    }
+    memset(&rule->code[rule->code_len], 0, sizeof(rule_insn_t));
+    rule->code[rule->code_len].op = op;
+    return rule->code_len++;
+}
+
+/**
+ * @brief 常量超出列取值范围时，比较结果与行无关
+ * @return 1恒真，0恒假，-1需逐行比较
+ */
+static int fold_compare(size_t item_size, int cmp, int64_t value) {
+    if (item_size >= 8) {
+        return -1;
+    }
+    int64_t max = (int64_t)((1ULL << (item_size * 8)) - 1);
+    if (value >= 0 && value <= max) {
+        return -1;
+    }
+    int below = value < 0;
+    switch (cmp) {
+        case RULE_CMP_LT:
+        case RULE_CMP_LE:
+            return below ? 0 : 1;
+        case RULE_CMP_GT:
+        case RULE_CMP_GE:
+            return below ? 1 : 0;
+        case RULE_CMP_EQ:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static int parse_or(rule_parser_t *parser);
+
+/**
+ * @brief 解析 not / 括号 / 比较
+ */
+static int parse_unary(rule_parser_t *parser) {
+    if (accept_keyword(parser, "not")) {
+        parser->depth++;
+        if (parse_unary(parser) < 0) {
+            return -1;
+        }
+        parser->depth--;
+        return emit(parser, RULE_OP_NOT) < 0 ? -1 : 0;
+    }
+
+    skip_space(parser);
+    if (*parser->p == '(') {
+        parser->p++;
+        parser->depth++;
+        if (parse_or(parser) < 0) {
+            return -1;
+        }
+        parser->depth--;
+        skip_space(parser);
+        if (*parser->p != ')') {
+            parser->error = "expected ')'";
+            return -1;
+        }
+        parser->p++;
+        return 0;
+    }
+
+    const char *start;
+    size_t len = read_ident(parser, &start);
+    int column = -1;
+    for (int i = 0; len && i < REALTIME_COLUMN_COUNT; i++) {
+        if (strlen(realtime_column_info[i].name) == len &&
+            strncmp(realtime_column_info[i].name, start, len) == 0) {
+            column = i;
+            break;
+        }
+    }
+    if (column < 0) {
+        parser->error = "unknown field";
+        return -1;
+    }
+    parser->p += len;
+
+    skip_space(parser);
+    static const char *const ops[] = {"<=", ">=", "==", "!=", "<", ">"};
+    static const int cmps[] = {RULE_CMP_LE, RULE_CMP_GE, RULE_CMP_EQ, RULE_CMP_NE, RULE_CMP_LT, RULE_CMP_GT};
+    int cmp = -1;
+    for (int i = 0; i < 6; i++) {
+        size_t n = strlen(ops[i]);
+        if (strncmp(parser->p, ops[i], n) == 0) {
+            cmp = cmps[i];
+            parser->p += n;
+            break;
+        }
+    }
+    if (cmp < 0) {
+        parser->error = "expected comparison operator";
+        return -1;
+    }
+
+    int64_t value;
+    if (read_number(parser, &value) < 0) {
+        return -1;
+    }
+
+    int folded = fold_compare(realtime_column_info[column].item_size, cmp, value);
+    int pc = emit(parser, folded < 0 ? RULE_OP_CMP : RULE_OP_CONST);
+    if (pc < 0) {
+        return -1;
+    }
+    rule_insn_t *insn = &parser->rule->code[pc];
+    insn->column = (uint8_t)column;
+    insn->cmp = (uint8_t)cmp;
+    insn->value = folded < 0 ? value : folded;
+
+    // 顶层比较 (只经and连接) 记为跳过整块的条件
+    rule_t *rule = parser->rule;
+    if (parser->depth == 0 && insn->op == RULE_OP_CMP && rule->guard_count < RULE_MAX_GUARDS) {
+        rule->guards[rule->guard_count++] = *insn;
+    }
+    return 0;
+}
+
+/**
+ * @brief 解析 and 连接的条件：左侧块内全不满足时跳过右侧
+ */
+static int parse_and(rule_parser_t *parser) {
+    if (parse_unary(parser) < 0) {
+        return -1;
+    }
+    while (accept_keyword(parser, "and")) {
+        int skip = emit(parser, RULE_OP_SKIP_IF_NONE);
+        if (skip < 0 || parse_unary(parser) < 0 || emit(parser, RULE_OP_AND) < 0) {
+            return -1;
+        }
+        parser->rule->code[skip].target = (uint8_t)parser->rule->code_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief 解析 or 连接的条件：左侧块内全部满足时跳过右侧
+ */
+static int parse_or(rule_parser_t *parser) {
+    if (parse_and(parser) < 0) {
+        return -1;
+    }
+    while (accept_keyword(parser, "or")) {
+        if (parser->depth == 0) {
+            parser->top_or = 1;
+        }
+        int skip = emit(parser, RULE_OP_SKIP_IF_ALL);
+        if (skip < 0 || parse_and(parser) < 0 || emit(parser, RULE_OP_OR) < 0) {
+            return -1;
+        }
+        parser->rule->code[skip].target = (uint8_t)parser->rule->code_len;
+    }
+    return 0;
+}
+
+/**
+ * @brief 检查掩码栈深度 (跳过指令跳过的片段净深度为0，按顺序模拟即可)
+ */
+static int check_stack_depth(const rule_t *rule) {
+    int depth = 0;
+    for (int pc = 0; pc < rule->code_len; pc++) {
+        switch (rule->code[pc].op) {
+            case RULE_OP_CMP:
+            case RULE_OP_CONST:
+                if (++depth > RULE_MAX_STACK) {
+                    return -1;
+                }
+                break;
+            case RULE_OP_AND:
+            case RULE_OP_OR:
+                depth--;
+                break;
+            default:
+                break;
+        }
+    }
+    return depth == 1 ? 0 : -1;
+}
+
+/**
+ * @brief 编译一行规则
+ * @return 0成功，-1失败 (error指向错误信息)
+ */
+static int compile_rule(rule_t *rule, const char *line, const char **error) {
+    memset(rule, 0, sizeof(rule_t));
+    rule->adjacent = 1;
+
+    const char *colon = strchr(line, ':');
+    const char *name = line;
+    while (*name == ' ' || *name == '\t') {
+        name++;
+    }
+    size_t name_len = colon ? (size_t)(colon - name) : 0;
+    while (name_len && (name[name_len - 1] == ' ' || name[name_len - 1] == '\t')) {
+        name_len--;
+    }
+    if (!colon || name_len == 0 || name_len >= RULE_NAME_SIZE) {
+        *error = "expected 'name: expression'";
+        return -1;
+    }
+    if (strlen(line) >= RULE_TEXT_SIZE) {
+        *error = "rule too long";
+        return -1;
+    }
+    memcpy(rule->name, name, name_len);
+    strcpy(rule->text, line);
+
+    rule_parser_t parser = {colon + 1, rule, 0, 0, NULL};
+    if (parse_or(&parser) < 0) {
+        *error = parser.error;
+        return -1;
+    }
+    if (parser.top_or) {
+        rule->guard_count = 0;
+    }
+
+    // 可选子句：for N[s] / adjacent K
+    for (;;) {
+        int64_t value;
+        if (accept_keyword(&parser, "for")) {
+            if (read_number(&parser, &value) < 0 || value < 0) {
+                *error = "invalid duration";
+                return -1;
+            }
+            accept_keyword(&parser, "s");
+            rule->duration_ms = value * 1000;
+        } else if (accept_keyword(&parser, "adjacent")) {
+            if (read_number(&parser, &value) < 0 || value < 1 || value > MAX_CHANNELS) {
+                *error = "invalid adjacent channel count";
+                return -1;
+            }
+            rule->adjacent = (int)value;
+        } else {
+            break;
+        }
+    }
+
+    skip_space(&parser);
+    if (*parser.p != '\0') {
+        *error = "unexpected trailing text";
+        return -1;
+    }
+    if (check_stack_depth(rule) < 0) {
+        *error = "expression nested too deeply";
+        return -1;
+    }
+    return 0;
+}
+
+/* ========== 规则集 ========== */
+
+/**
+ * @brief 释放规则集 (含各规则的运行状态)
+ */
+static void rule_set_free(rule_set_t *set) {
+    if (!set) {
+        return;
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        free(set->rules[i].states);
+        free(set->rules[i].events);
+    }
+    free(set->rules);
+    free(set);
+}
+
+/**
+ * @brief 字符串哈希 (FNV-1a)
+ */
+static uint32_t name_hash(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    }
+    return h;
+}
+
+/**
+ * @brief 把名称和文本都未变化的规则的运行状态移交给新规则集
+ */
+static void rule_set_inherit(rule_set_t *next, rule_set_t *prev) {
+    if (!prev || prev->count == 0) {
+        return;
+    }
+
+    size_t capacity = 16;
+    while (capacity < prev->count * 2) {
+        capacity <<= 1;
+    }
+    int32_t *index = malloc(capacity * sizeof(int32_t));
+    if (!index) {
+        return;
+    }
+    for (size_t i = 0; i < capacity; i++) {
+        index[i] = -1;
+    }
+    for (size_t i = 0; i < prev->count; i++) {
+        size_t slot = name_hash(prev->rules[i].name) & (capacity - 1);
+        while (index[slot] >= 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        index[slot] = (int32_t)i;
+    }
+
+    for (size_t i = 0; i < next->count; i++) {
+        rule_t *rule = &next->rules[i];
+        size_t slot = name_hash(rule->name) & (capacity - 1);
+        for (; index[slot] >= 0; slot = (slot + 1) & (capacity - 1)) {
+            rule_t *old = &prev->rules[index[slot]];
+            if (old->states && strcmp(old->name, rule->name) == 0 && strcmp(old->text, rule->text) == 0) {
+                rule->states = old->states;
+                rule->state_capacity = old->state_capacity;
+                rule->state_count = old->state_count;
+                rule->fired = old->fired;
+                old->states = NULL;
+                old->state_capacity = 0;
+                old->state_count = 0;
+                break;
+            }
+        }
+    }
+    free(index);
+}
+
+/**
+ * @brief 编译规则文本为新规则集
+ * @return 规则集，NULL表示有规则编译失败或内存不足
+ */
+static rule_set_t *rule_set_compile(const char *text, const char *source) {
+    size_t lines = 1;
+    for (const char *p = text; *p; p++) {
+        lines += *p == '\n';
+    }
+
+    rule_set_t *set = calloc(1, sizeof(rule_set_t));
+    if (!set || !(set->rules = calloc(lines, sizeof(rule_t)))) {
+        LOG_ERROR("Failed to allocate rule set");
+        free(set);
+        return NULL;
+    }
+
+    char line[RULE_TEXT_SIZE * 2];
+    const char *p = text;
+    for (int line_no = 1; *p; line_no++) {
+        const char *end = strchr(p, '\n');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        size_t copy = len < sizeof(line) - 1 ? len : sizeof(line) - 1;
+        memcpy(line, p, copy);
+        line[copy] = '\0';
+        p += len + (end ? 1 : 0);
+
+        // 去掉注释和行尾空白
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        size_t n = strlen(line);
+        while (n && isspace((unsigned char)line[n - 1])) {
+            line[--n] = '\0';
+        }
+        const char *start = line;
+        while (*start == ' ' || *start == '\t') {
+            start++;
+        }
+        if (*start == '\0') {
+            continue;
+        }
+
+        const char *error = NULL;
+        if (compile_rule(&set->rules[set->count], start, &error) < 0) {
+            LOG_ERROR("%s:%d: %s: %s", source, line_no, error, start);
+            rule_set_free(set);
+            return NULL;
+        }
+        set->count++;
+    }
+    return set;
+}
+
+/**
+ * @brief 用新规则集替换当前规则集
+ */
+static void install_rule_set(rule_engine_t *engine, rule_set_t *set) {
+    rule_set_inherit(set, engine->set);
+
+    // 被删除或修改的规则不再评估，已触发的通道补发解除事件
+    rule_set_t *prev = engine->set;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    for (size_t r = 0; prev && engine->callback && r < prev->count; r++) {
+        const rule_t *rule = &prev->rules[r];
+        for (size_t i = 0; i < rule->state_capacity; i++) {
+            const rule_channel_state_t *entry = &rule->states[i];
+            if (entry->key == 0 || !entry->firing) {
+                continue;
+            }
+            rule_event_t event;
+            event.type = RULE_EVENT_CLEARED;
+            event.rule = rule->name;
+            event.device = create_device_id((uint32_t)(entry->key >> 40), (uint16_t)(entry->key >> 24),
+                                            (uint16_t)(entry->key >> 8));
+            event.channel_id = (uint8_t)entry->key;
+            event.since_ms = entry->since_ms;
+            event.now_ms = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+            engine->callback(engine->callback_ctx, &event);
+        }
+    }
+
+    rule_set_free(prev);
+    engine->set = set;
+}
+
+/**
+ * @brief 读取并编译规则文件
+ * @return 规则数，-1失败
+ */
+static int reload_file(rule_engine_t *engine) {
+    struct stat st;
+    if (stat(engine->path, &st) < 0) {
+        LOG_ERROR("Failed to stat rule file %s", engine->path);
+        return -1;
+    }
+    engine->loaded_mtime = st.st_mtim;
+
+    FILE *fp = fopen(engine->path, "r");
+    if (!fp) {
+        LOG_ERROR("Failed to open rule file %s", engine->path);
+        return -1;
+    }
+    char *text = malloc((size_t)st.st_size + 1);
+    size_t len = text ? fread(text, 1, (size_t)st.st_size, fp) : 0;
+    fclose(fp);
+    if (!text) {
+        return -1;
+    }
+    text[len] = '\0';
+
+    rule_set_t *set = rule_set_compile(text, engine->path);
+    free(text);
+    if (!set) {
+        return -1;
+    }
+    install_rule_set(engine, set);
+    LOG_INFO("Loaded %zu rules from %s", set->count, engine->path);
+    return (int)set->count;
+}
+
+/* ========== 评估 ========== */
+
+#define COMPARE_LOOP(type) do { \
+    const type *col = (const type *)data; \
+    const type v = (type)value; \
+    switch (cmp) { \
+        case RULE_CMP_LT: for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] < v); break; \
+        case RULE_CMP_LE: for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] <= v); break; \
+        case RULE_CMP_GT: for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] > v); break; \
+        case RULE_CMP_GE: for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] >= v); break; \
+        case RULE_CMP_EQ: for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] == v); break; \
+        default:          for (size_t i = 0; i < n; i++) out[i] = (uint8_t)-(col[i] != v); break; \
+    } \
+} while (0)
+
+/**
+ * @brief 对一列做比较，生成0x00/0xFF掩码
+ */
+static void compare_column(const void *data, size_t item_size, int cmp, int64_t value,
+                           size_t n, uint8_t *out) {
+    switch (item_size) {
+        case 1:
+            COMPARE_LOOP(uint8_t);
+            break;
+        case 2:
+            COMPARE_LOOP(uint16_t);
+            break;
+        case 4:
+            COMPARE_LOOP(uint32_t);
+            break;
+        default:
+            COMPARE_LOOP(int64_t);
+            break;
+    }
+}
+
+/**
+ * @brief 掩码是否全等于fill
+ */
+static int mask_all(const uint8_t *mask, size_t n, uint8_t fill) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < n; i++) {
+        diff |= mask[i] ^ fill;
+    }
+    return diff == 0;
+}
+
+/**
+ * @brief 对一块行执行规则字节码
+ * @param masks 掩码栈
+ * @return 结果掩码
+ */
+static const uint8_t *run_code(const rule_t *rule, const realtime_columns_t *rows, size_t start,
+                               size_t n, uint8_t (*masks)[RULE_BLOCK_ROWS]) {
+    int sp = 0;
+    for (int pc = 0; pc < rule->code_len; pc++) {
+        const rule_insn_t *insn = &rule->code[pc];
+        switch (insn->op) {
+            case RULE_OP_CMP: {
+                size_t item_size = realtime_column_info[insn->column].item_size;
+                const uint8_t *data = (const uint8_t *)realtime_column_data(rows, insn->column) +
+                                      start * item_size;
+                compare_column(data, item_size, insn->cmp, insn->value, n, masks[sp++]);
+                break;
+            }
+            case RULE_OP_CONST:
+                memset(masks[sp++], insn->value ? 0xFF : 0, n);
+                break;
+            case RULE_OP_AND:
+                sp--;
+                for (size_t i = 0; i < n; i++) {
+                    masks[sp - 1][i] &= masks[sp][i];
+                }
+                break;
+            case RULE_OP_OR:
+                sp--;
+                for (size_t i = 0; i < n; i++) {
+                    masks[sp - 1][i] |= masks[sp][i];
+                }
+                break;
+            case RULE_OP_NOT:
+                for (size_t i = 0; i < n; i++) {
+                    masks[sp - 1][i] ^= 0xFF;
+                }
+                break;
+            case RULE_OP_SKIP_IF_NONE:
+                if (mask_all(masks[sp - 1], n, 0)) {
+                    pc = insn->target - 1;
+                }
+                break;
+            case RULE_OP_SKIP_IF_ALL:
+                if (mask_all(masks[sp - 1], n, 0xFF)) {
+                    pc = insn->target - 1;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return masks[0];
+}
+
+/**
+ * @brief 行的通道键：设备标识 << 8 | 通道编号
+ */
+static inline uint64_t row_key(const realtime_columns_t *rows, size_t row) {
+    return ((uint64_t)rows->admin_code[row] << 40) | ((uint64_t)rows->device_type[row] << 24) |
+           ((uint64_t)rows->device_id[row] << 8) | rows->channel_id[row];
+}
+
+/**
+ * @brief 通道键哈希
+ */
+static inline size_t key_hash(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    return (size_t)key;
+}
+
+/**
+ * @brief 向通道状态表放入条目 (调用方保证有空位)
+ */
+static rule_channel_state_t *state_put(rule_channel_state_t *states, size_t capacity, uint64_t key) {
+    size_t slot = key_hash(key) & (capacity - 1);
+    while (states[slot].key != 0 && states[slot].key != key) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+    return &states[slot];
+}
+
+/**
+ * @brief 按新容量重建通道状态表，可丢弃本次未满足条件的条目
+ * @return 0成功，-1内存不足
+ */
+static int state_rebuild(rule_t *rule, size_t capacity, int drop_unseen, uint32_t tick) {
+    rule_channel_state_t *states = calloc(capacity, sizeof(rule_channel_state_t));
+    if (!states) {
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < rule->state_capacity; i++) {
+        const rule_channel_state_t *entry = &rule->states[i];
+        if (entry->key != 0 && (!drop_unseen || entry->seen_tick == tick)) {
+            *state_put(states, capacity, entry->key) = *entry;
+            count++;
+        }
+    }
+    free(rule->states);
+    rule->states = states;
+    rule->state_capacity = capacity;
+    rule->state_count = count;
+    return 0;
+}
+
+/**
+ * @brief 记录一个规则事件
+ */
+static void push_event(rule_t *rule, rule_event_type_t type, uint64_t key, int64_t since_ms, int64_t now_ms) {
+    if (rule->event_count == rule->event_capacity) {
+        size_t capacity = rule->event_capacity ? rule->event_capacity * 2 : 16;
+        rule_event_t *events = realloc(rule->events, capacity * sizeof(rule_event_t));
+        if (!events) {
+            LOG_WARN("Dropping rule event for %s: out of memory", rule->name);
+            return;
+        }
+        rule->events = events;
+        rule->event_capacity = capacity;
+    }
+
+    rule_event_t *event = &rule->events[rule->event_count++];
+    event->type = type;
+    event->rule = rule->name;
+    event->device = create_device_id((uint32_t)(key >> 40), (uint16_t)(key >> 24), (uint16_t)(key >> 8));
+    event->channel_id = (uint8_t)key;
+    event->since_ms = since_ms;
+    event->now_ms = now_ms;
+}
+
+/**
+ * @brief 通道本次满足条件：推进状态机
+ */
+static void state_touch(rule_t *rule, uint64_t key, int64_t now_ms, uint32_t tick) {
+    if ((rule->state_count + 1) * 2 > rule->state_capacity) {
+        size_t capacity = rule->state_capacity ? rule->state_capacity * 2 : RULE_STATE_INITIAL;
+        if (state_rebuild(rule, capacity, 0, tick) < 0) {
+            return;
+        }
+    }
+
+    rule_channel_state_t *entry = state_put(rule->states, rule->state_capacity, key);
+    if (entry->key == 0) {
+        entry->key = key;
+        entry->since_ms = now_ms;
+        entry->firing = 0;
+        rule->state_count++;
+    }
+    entry->seen_tick = tick;
+    if (!entry->firing && now_ms - entry->since_ms >= rule->duration_ms) {
+        entry->firing = 1;
+        rule->fired++;
+        push_event(rule, RULE_EVENT_FIRING, key, entry->since_ms, now_ms);
+    }
+}
+
+/**
+ * @brief 处理一块的结果掩码
+ */
+static void apply_mask(rule_t *rule, const realtime_columns_t *rows, size_t start, size_t n,
+                       const uint8_t *mask, int64_t now_ms, uint32_t tick) {
+    if (rule->adjacent <= 1) {
+        // 按8字节跳过整段不满足的行
+        for (size_t i = 0; i < n; i += 8) {
+            uint64_t word = 0;
+            size_t len = n - i < 8 ? n - i : 8;
+            memcpy(&word, &mask[i], len);
+            if (word == 0) {
+                continue;
+            }
+            for (size_t j = i; j < i + len; j++) {
+                if (mask[j]) {
+                    state_touch(rule, row_key(rows, start + j), now_ms, tick);
+                }
+            }
+        }
+        return;
+    }
+
+    // 相邻规则：同一设备编号连续的通道逐个累计，连续满足数达到K时以当前通道为键
+    for (size_t j = 0; j < n; j++) {
+        uint64_t key = row_key(rows, start + j);
+        if (!mask[j]) {
+            rule->run_length = 0;
+        } else if (rule->run_length > 0 && key == rule->run_key + 1) {
+            rule->run_length++;
+        } else {
+            rule->run_length = 1;
+        }
+        rule->run_key = key;
+        if (rule->run_length >= rule->adjacent) {
+            state_touch(rule, key, now_ms, tick);
+        }
+    }
+}
+
+/**
+ * @brief 清除本次未满足条件的通道，已触发的产生解除事件
+ */
+static void sweep_states(rule_t *rule, int64_t now_ms, uint32_t tick) {
+    size_t stale = 0;
+    for (size_t i = 0; i < rule->state_capacity; i++) {
+        const rule_channel_state_t *entry = &rule->states[i];
+        if (entry->key != 0 && entry->seen_tick != tick) {
+            if (entry->firing) {
+                push_event(rule, RULE_EVENT_CLEARED, entry->key, entry->since_ms, now_ms);
+            }
+            stale++;
+        }
+    }
+    if (stale) {
+        state_rebuild(rule, rule->state_capacity, 1, tick);
+    }
+}
+
+#define ZONE_LOOP(type) do { \
+    const type *col = (const type *)data; \
+    type lo = col[0], hi = col[0]; \
+    for (size_t i = 1; i < n; i++) { \
+        lo = col[i] < lo ? col[i] : lo; \
+        hi = col[i] > hi ? col[i] : hi; \
+    } \
+    zone[0] = (int64_t)lo; \
+    zone[1] = (int64_t)hi; \
+} while (0)
+
+/**
+ * @brief 统计每块各列的最小值和最大值
+ * @return 0成功，-1内存不足
+ */
+static int build_zones(rule_engine_t *engine, const realtime_columns_t *rows) {
+    size_t blocks = (rows->count + RULE_BLOCK_ROWS - 1) / RULE_BLOCK_ROWS;
+    if (blocks > engine->zone_blocks) {
+        int64_t *zones = realloc(engine->zones, blocks * REALTIME_COLUMN_COUNT * 2 * sizeof(int64_t));
+        if (!zones) {
+            return -1;
+        }
+        engine->zones = zones;
+        engine->zone_blocks = blocks;
+    }
+
+    for (size_t b = 0; b < blocks; b++) {
+        size_t start = b * RULE_BLOCK_ROWS;
+        size_t n = rows->count - start < RULE_BLOCK_ROWS ? rows->count - start : RULE_BLOCK_ROWS;
+        for (int c = 0; c < REALTIME_COLUMN_COUNT; c++) {
+            size_t item_size = realtime_column_info[c].item_size;
+            const uint8_t *data = (const uint8_t *)realtime_column_data(rows, c) + start * item_size;
+            int64_t *zone = &engine->zones[(b * REALTIME_COLUMN_COUNT + c) * 2];
+            switch (item_size) {
+                case 1:
+                    ZONE_LOOP(uint8_t);
+                    break;
+                case 2:
+                    ZONE_LOOP(uint16_t);
+                    break;
+                case 4:
+                    ZONE_LOOP(uint32_t);
+                    break;
+                default:
+                    ZONE_LOOP(int64_t);
+                    break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 规则的顶层比较在块的取值范围上是否可能成立
+ */
+static int block_may_match(const rule_t *rule, const int64_t *zones) {
+    for (int g = 0; g < rule->guard_count; g++) {
+        const rule_insn_t *guard = &rule->guards[g];
+        int64_t lo = zones[guard->column * 2];
+        int64_t hi = zones[guard->column * 2 + 1];
+        int64_t v = guard->value;
+        int possible;
+        switch (guard->cmp) {
+            case RULE_CMP_LT: possible = lo < v; break;
+            case RULE_CMP_LE: possible = lo <= v; break;
+            case RULE_CMP_GT: possible = hi > v; break;
+            case RULE_CMP_GE: possible = hi >= v; break;
+            case RULE_CMP_EQ: possible = lo <= v && v <= hi; break;
+            default:          possible = lo != v || hi != v; break;
+        }
+        if (!possible) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief 评估一个区间内的规则：块在外层循环，同一块的列在各规则间复用缓存
+ */
+static void *evaluate_range(void *arg) {
+    rule_worker_t *worker = (rule_worker_t *)arg;
+    const realtime_columns_t *rows = worker->rows;
+    uint32_t tick = worker->engine->tick;
+    int64_t fresh_after_ns = (worker->now_ms - worker->engine->stale_ms) * 1000000LL;
+    uint8_t masks[RULE_MAX_STACK][RULE_BLOCK_ROWS];
+    uint8_t fresh[RULE_BLOCK_ROWS];
+    uint8_t result[RULE_BLOCK_ROWS];
+
+    for (size_t r = worker->first; r < worker->last; r++) {
+        worker->set->rules[r].run_length = 0;
+        worker->set->rules[r].event_count = 0;
+    }
+
+    for (size_t start = 0; start < rows->count; start += RULE_BLOCK_ROWS) {
+        size_t n = rows->count - start < RULE_BLOCK_ROWS ? rows->count - start : RULE_BLOCK_ROWS;
+
+        // 接收时间过早的记录 (设备已停止上传) 不参与评估
+        const int64_t *received = &rows->received_ns[start];
+        for (size_t i = 0; i < n; i++) {
+            fresh[i] = (uint8_t)-(worker->engine->stale_ms <= 0 || received[i] >= fresh_after_ns);
+        }
+
+        const int64_t *zones = &worker->engine->zones[start / RULE_BLOCK_ROWS * REALTIME_COLUMN_COUNT * 2];
+        for (size_t r = worker->first; r < worker->last; r++) {
+            rule_t *rule = &worker->set->rules[r];
+            if (!block_may_match(rule, zones)) {
+                rule->run_length = 0;
+                continue;
+            }
+            const uint8_t *mask = run_code(rule, rows, start, n, masks);
+            for (size_t i = 0; i < n; i++) {
+                result[i] = mask[i] & fresh[i];
+            }
+            apply_mask(rule, rows, start, n, result, worker->now_ms, tick);
+        }
+    }
+
+    for (size_t r = worker->first; r < worker->last; r++) {
+        if (worker->set->rules[r].state_count) {
+            sweep_states(&worker->set->rules[r], worker->now_ms, tick);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 评估工作线程：等待新一轮任务，评估分到的规则区间
+ */
+static void *rule_worker_thread(void *arg) {
+    rule_worker_t *worker = (rule_worker_t *)arg;
+    rule_engine_t *engine = worker->engine;
+    uint64_t seen = 0;
+
+    pthread_mutex_lock(&engine->work_lock);
+    for (;;) {
+        while (!engine->workers_stopping && engine->work_round == seen) {
+            pthread_cond_wait(&engine->work_ready, &engine->work_lock);
+        }
+        if (engine->workers_stopping) {
+            break;
+        }
+        seen = engine->work_round;
+        if (!worker->active) {
+            continue;
+        }
+        pthread_mutex_unlock(&engine->work_lock);
+
+        evaluate_range(worker);
+
+        pthread_mutex_lock(&engine->work_lock);
+        worker->active = 0;
+        if (--engine->work_pending == 0) {
+            pthread_cond_signal(&engine->work_done);
+        }
+    }
+    pthread_mutex_unlock(&engine->work_lock);
+    return NULL;
+}
+
+/**
+ * @brief 启动常驻评估工作线程
+ */
+static void start_workers(rule_engine_t *engine, int count) {
+    for (int t = 0; t < count; t++) {
+        engine->jobs[t].engine = engine;
+        engine->jobs[t].active = 0;
+        if (pthread_create(&engine->workers[t], NULL, rule_worker_thread, &engine->jobs[t]) != 0) {
+            LOG_WARN("Started only %d of %d rule evaluation workers", t, count);
+            break;
+        }
+        engine->worker_count++;
+    }
+}
+
+/**
+ * @brief 停止评估工作线程
+ */
+static void stop_workers(rule_engine_t *engine) {
+    pthread_mutex_lock(&engine->work_lock);
+    engine->workers_stopping = 1;
+    pthread_cond_broadcast(&engine->work_ready);
+    pthread_mutex_unlock(&engine->work_lock);
+    for (int t = 0; t < engine->worker_count; t++) {
+        pthread_join(engine->workers[t], NULL);
+    }
+    engine->worker_count = 0;
+}
+
+/* ========== 接口 ========== */
+
+/**
+ * @brief 初始化规则引擎
+ */
+int rule_engine_init(rule_engine_t *engine, device_state_t *state, int threads) {
+    if (!engine) {
+        return -1;
+    }
+
+    memset(engine, 0, sizeof(rule_engine_t));
+    engine->state = state;
+    engine->threads = threads < 1 ? 1 : threads > RULE_MAX_THREADS ? RULE_MAX_THREADS : threads;
+    engine->stale_ms = RULE_DEFAULT_STALE_MS;
+    engine->set = calloc(1, sizeof(rule_set_t));
+    engine->jobs = calloc(RULE_MAX_THREADS, sizeof(rule_worker_t));
+    if (!engine->set || !engine->jobs || realtime_columns_init(&engine->rows, 1024) < 0) {
+        LOG_ERROR("Failed to allocate rule engine");
+        free(engine->set);
+        free(engine->jobs);
+        engine->set = NULL;
+        engine->jobs = NULL;
+        return -1;
+    }
+
+    pthread_mutex_init(&engine->work_lock, NULL);
+    pthread_cond_init(&engine->work_ready, NULL);
+    pthread_cond_init(&engine->work_done, NULL);
+    start_workers(engine, engine->threads - 1);
+    return 0;
+}
+
+/**
+ * @brief 销毁规则引擎
+ */
+void rule_engine_destroy(rule_engine_t *engine) {
+    if (!engine) {
+        return;
+    }
+    rule_engine_stop(engine);
+    if (engine->jobs) {
+        stop_workers(engine);
+        pthread_mutex_destroy(&engine->work_lock);
+        pthread_cond_destroy(&engine->work_ready);
+        pthread_cond_destroy(&engine->work_done);
+        free(engine->jobs);
+        engine->jobs = NULL;
+    }
+    rule_set_free(engine->set);
+    engine->set = NULL;
+    realtime_columns_free(&engine->rows);
+    free(engine->order);
+    free(engine->zones);
+    engine->order = NULL;
+    engine->zones = NULL;
+}
+
+/**
+ * @brief 设置事件回调
+ */
+void rule_engine_set_callback(rule_engine_t *engine, rule_event_fn callback, void *ctx) {
+    if (engine) {
+        engine->callback = callback;
+        engine->callback_ctx = ctx;
+    }
+}
+
+/**
+ * @brief 从文件加载规则
+ */
+int rule_engine_load_file(rule_engine_t *engine, const char *path) {
+    if (!engine || !path || strlen(path) >= sizeof(engine->path)) {
+        return -1;
+    }
+    // 运行中规则集只由评估线程替换
+    if (__atomic_load_n(&engine->running, __ATOMIC_ACQUIRE)) {
+        LOG_ERROR("Cannot load rules while the rule engine is running, request a reload instead");
+        return -1;
+    }
+    strcpy(engine->path, path);
+    int result = reload_file(engine);
+    if (result < 0) {
+        engine->reload_errors++;
+    }
+    return result;
+}
+
+/**
+ * @brief 从字符串加载规则
+ */
+int rule_engine_load_string(rule_engine_t *engine, const char *text) {
+    if (!engine || !text) {
+        return -1;
+    }
+    if (__atomic_load_n(&engine->running, __ATOMIC_ACQUIRE)) {
+        LOG_ERROR("Cannot load rules while the rule engine is running");
+        return -1;
+    }
+    rule_set_t *set = rule_set_compile(text, "<string>");
+    if (!set) {
+        engine->reload_errors++;
+        return -1;
+    }
+    install_rule_set(engine, set);
+    return (int)set->count;
+}
+
+/**
+ * @brief 请求重新加载规则文件
+ */
+void rule_engine_request_reload(rule_engine_t *engine) {
+    if (engine) {
+        __atomic_store_n(&engine->reload_requested, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief 对一批通道记录评估全部规则
+ */
+int rule_engine_evaluate(rule_engine_t *engine, const realtime_columns_t *rows, int64_t now_ms) {
+    if (!engine || !engine->set || !rows) {
+        return -1;
+    }
+
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    rule_set_t *set = engine->set;
+    engine->tick++;
+    if (build_zones(engine, rows) < 0) {
+        LOG_ERROR("Failed to allocate rule engine zone maps");
+        return -1;
+    }
+
+    // 按规则数平均分给各线程：前几段交给常驻工作线程，最后一段在调用线程中执行
+    int threads = engine->worker_count + 1;
+    if ((size_t)threads > set->count) {
+        threads = set->count ? (int)set->count : 1;
+    }
+    rule_worker_t caller;
+    caller.engine = engine;
+    caller.set = set;
+    caller.rows = rows;
+    caller.now_ms = now_ms;
+    caller.first = set->count * (threads - 1) / threads;
+    caller.last = set->count;
+    caller.active = 1;
+
+    if (threads > 1) {
+        pthread_mutex_lock(&engine->work_lock);
+        for (int t = 0; t < threads - 1; t++) {
+            rule_worker_t *job = &engine->jobs[t];
+            job->set = set;
+            job->rows = rows;
+            job->now_ms = now_ms;
+            job->first = set->count * t / threads;
+            job->last = set->count * (t + 1) / threads;
+            job->active = 1;
+        }
+        engine->work_pending = threads - 1;
+        engine->work_round++;
+        pthread_cond_broadcast(&engine->work_ready);
+        pthread_mutex_unlock(&engine->work_lock);
+    }
+    evaluate_range(&caller);
+    if (threads > 1) {
+        pthread_mutex_lock(&engine->work_lock);
+        while (engine->work_pending > 0) {
+            pthread_cond_wait(&engine->work_done, &engine->work_lock);
+        }
+        pthread_mutex_unlock(&engine->work_lock);
+    }
+
+    // 按规则顺序分发事件
+    int events = 0;
+    for (size_t r = 0; r < set->count; r++) {
+        rule_t *rule = &set->rules[r];
+        for (size_t i = 0; i < rule->event_count; i++) {
+            if (engine->callback) {
+                engine->callback(engine->callback_ctx, &rule->events[i]);
+            }
+        }
+        events += (int)rule->event_count;
+        rule->event_count = 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    engine->last_eval_us = (uint64_t)((end.tv_sec - begin.tv_sec) * 1000000LL +
+                                      (end.tv_nsec - begin.tv_nsec) / 1000);
+    engine->evaluations++;
+    return events;
+}
+
+/**
+ * @brief 规则文件修改时间变化或收到请求时重载
+ */
+static void check_reload(rule_engine_t *engine) {
+    if (engine->path[0] == '\0') {
+        return;
+    }
+
+    int requested = __atomic_exchange_n(&engine->reload_requested, 0, __ATOMIC_RELAXED);
+    struct stat st;
+    int changed = stat(engine->path, &st) == 0 &&
+                  (st.st_mtim.tv_sec != engine->loaded_mtime.tv_sec ||
+                   st.st_mtim.tv_nsec != engine->loaded_mtime.tv_nsec);
+    if (!requested && !changed) {
+        return;
+    }
+
+    if (reload_file(engine) < 0) {
+        LOG_WARN("Rule reload failed, keeping %zu previous rules", engine->set->count);
+        engine->reload_errors++;
+    } else {
+        engine->reloads++;
+    }
+}
+
+/**
+ * @brief 设备排序键
+ */
+typedef struct {
+    uint64_t key;               // 行政区划代码、设备类型、设备编号拼接
+    uint32_t index;             // 快照中的设备下标
+} device_order_t;
+
+static int compare_device_order(const void *a, const void *b) {
+    uint64_t ka = ((const device_order_t *)a)->key;
+    uint64_t kb = ((const device_order_t *)b)->key;
+    return ka < kb ? -1 : ka > kb;
+}
+
+/**
+ * @brief 按设备标识顺序把快照中各设备的最新记录解码到rows
+ * 设备条目只增不减，设备数变化时才重新排序
+ * @return 行数，-1失败
+ */
+static int64_t collect_sorted(rule_engine_t *engine, const device_snapshot_t *snapshot) {
+    size_t count = snapshot->device_count;
+    if (count != engine->order_count) {
+        device_order_t *keys = malloc(count * sizeof(device_order_t));
+        uint32_t *order = realloc(engine->order, count * sizeof(uint32_t));
+        if (!keys || (!order && count)) {
+            free(keys);
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            device_id_t device;
+            device_snapshot_at(snapshot, i, &device);
+            keys[i].key = ((uint64_t)device.admin_code << 32) |
+                          ((uint64_t)device.device_type << 16) | device.device_id;
+            keys[i].index = (uint32_t)i;
+        }
+        qsort(keys, count, sizeof(device_order_t), compare_device_order);
+        for (size_t i = 0; i < count; i++) {
+            order[i] = keys[i].index;
+        }
+        free(keys);
+        engine->order = order;
+        engine->order_count = count;
+    }
+
+    engine->rows.count = 0;
+    for (size_t i = 0; i < count; i++) {
+        device_id_t device;
+        const device_version_t *version = device_snapshot_at(snapshot, engine->order[i], &device);
+        if (version && realtime_decode_content(&engine->rows, &device, version->content,
+                                               version->content_len, version->received_ns) < 0) {
+            return -1;
+        }
+    }
+    return (int64_t)engine->rows.count;
+}
+
+/**
+ * @brief 周期评估线程
+ */
+static void *rule_engine_thread(void *arg) {
+    rule_engine_t *engine = (rule_engine_t *)arg;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    while (__atomic_load_n(&engine->running, __ATOMIC_ACQUIRE)) {
+        next.tv_nsec += (long)(engine->tick_ms % 1000) * 1000000L;
+        next.tv_sec += engine->tick_ms / 1000 + next.tv_nsec / 1000000000L;
+        next.tv_nsec %= 1000000000L;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        if (!__atomic_load_n(&engine->running, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+
+        check_reload(engine);
+
+        device_snapshot_t snapshot;
+        if (device_state_snapshot(engine->state, &snapshot) < 0) {
+            continue;
+        }
+        int64_t rows = collect_sorted(engine, &snapshot);
+        device_snapshot_release(&snapshot);
+        if (rows < 0) {
+            LOG_WARN("Failed to collect device state for rule evaluation");
+            continue;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        rule_engine_evaluate(engine, &engine->rows, (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 启动周期评估线程
+ */
+int rule_engine_start(rule_engine_t *engine, int tick_ms) {
+    if (!engine || !engine->state || engine->running) {
+        return -1;
+    }
+
+    engine->tick_ms = tick_ms > 0 ? tick_ms : RULE_DEFAULT_TICK_MS;
+    __atomic_store_n(&engine->running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&engine->thread, NULL, rule_engine_thread, engine) != 0) {
+        LOG_ERROR("Failed to start rule engine thread");
+        engine->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 停止周期评估线程
+ */
+void rule_engine_stop(rule_engine_t *engine) {
+    if (!engine || !engine->running) {
+        return;
+    }
+    __atomic_store_n(&engine->running, 0, __ATOMIC_RELEASE);
+    pthread_join(engine->thread, NULL);
+}
@@ -0,0 +1,247 @@
+/**
+ * @file rule_engine.h
+ * @brief 实时信息阈值规则引擎
+ *
+ * 规则文件每行一条规则，格式为
+ *     名称: 条件表达式 [for N s] [adjacent K]
+ * 条件表达式由"字段 比较符 整数"和 and/or/not/括号组成，字段为实时信息的列名
+ * (occupancy、speed、admin_code、channel_id等，单位与协议原始值一致，
+ * 例如占有率80%写作 occupancy > 800)。for表示条件需持续N秒才触发，
+ * adjacent表示同一设备需有K个编号相邻的通道同时满足条件。例如：
+ *     occ_high: occupancy > 800 and admin_code == 110105 for 60s
+ *     slow_3: speed < 10 adjacent 3
+ *
+ * 规则加载时编译为按列执行的字节码：每条指令对一块(1024行)的一整列做比较，
+ * 结果为逐行的选择掩码，and/or在掩码上逐字节合并；块内掩码已全为0(或全为1)时
+ * 跳过and(或or)的另一侧。循环无分支，由编译器向量化。
+ * 每个采样周期从设备状态表取一致快照，按设备标识排序后把各通道最新记录解码为列，
+ * 并统计每块各列的最小值和最大值；规则顶层and链中的比较在块的取值范围上
+ * 不可能成立时跳过整块，按区划的规则因此只评估该区划所在的少数几块。
+ * 规则可分给多个线程并行评估 (每条规则的状态只由一个线程修改)：工作线程在初始化时创建并常驻，
+ * 每次评估只唤醒它们领取各自的规则区间，调用线程执行最后一段并等待其余各段完成。
+ * 每条规则对满足条件的通道维护稀疏的状态 (开始满足的时间、是否已触发)，
+ * 状态变化时产生触发/解除事件。
+ * 规则文件修改时间变化或收到重载请求时重新加载，名称和文本都不变的规则保留状态。
+ */
+
+#ifndef RULE_ENGINE_H
+#define RULE_ENGINE_H
+
+#include "device_state.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RULE_BLOCK_ROWS 1024            // 每块评估的行数
+#define RULE_MAX_STACK 16               // 掩码栈深度上限
+#define RULE_MAX_CODE 64                // 每条规则的指令数上限
+#define RULE_MAX_GUARDS 4               // 每条规则用于跳过整块的比较数上限
+#define RULE_NAME_SIZE 48               // 规则名称长度上限
+#define RULE_TEXT_SIZE 256              // 规则文本长度上限
+#define RULE_MAX_THREADS 16             // 评估线程数上限
+#define RULE_DEFAULT_TICK_MS 1000       // 默认采样周期(毫秒)
+#define RULE_DEFAULT_STALE_MS 10000     // 接收时间早于该值的记录不参与评估(毫秒)
+
+/**
+ * @brief 规则事件类型
+ */
+typedef enum {
+    RULE_EVENT_FIRING = 1,              // 条件持续满足，触发
+    RULE_EVENT_CLEARED = 2              // 已触发的条件不再满足，解除
+} rule_event_type_t;
+
+/**
+ * @brief 规则事件
+ */
+typedef struct {
+    rule_event_type_t type;     // 事件类型
+    const char *rule;           // 规则名称 (回调返回后失效)
+    device_id_t device;         // 设备标识
+    uint8_t channel_id;         // 通道编号 (相邻规则为连续通道中编号最大的一个)
+    int64_t since_ms;           // 开始满足条件的时间(Unix毫秒)
+    int64_t now_ms;             // 事件产生的时间(Unix毫秒)
+} rule_event_t;
+
+/**
+ * @brief 事件回调 (在评估所在线程中按规则顺序调用)
+ */
+typedef void (*rule_event_fn)(void *ctx, const rule_event_t *event);
+
+/**
+ * @brief 字节码指令
+ */
+typedef struct {
+    uint8_t op;                 // 操作码
+    uint8_t column;             // 比较的列 (realtime_column_info中的下标)
+    uint8_t cmp;                // 比较符
+    uint8_t target;             // 跳转目标 (跳过指令用)
+    int64_t value;              // 比较常量
+} rule_insn_t;
+
+/**
+ * @brief 通道状态 (稀疏哈希表条目)
+ */
+typedef struct {
+    uint64_t key;               // 设备标识 << 8 | 通道编号，0表示空
+    int64_t since_ms;           // 开始满足条件的时间
+    uint32_t seen_tick;         // 最近一次满足条件的评估序号
+    uint8_t firing;             // 是否已触发
+} rule_channel_state_t;
+
+/**
+ * @brief 编译后的规则及其运行状态
+ */
+typedef struct {
+    char name[RULE_NAME_SIZE];  // 规则名称
+    char text[RULE_TEXT_SIZE];  // 规则原文 (用于重载时判断是否变化)
+    rule_insn_t code[RULE_MAX_CODE]; // 字节码
+    int code_len;               // 指令数
+    rule_insn_t guards[RULE_MAX_GUARDS]; // 顶层and链中的比较，块的取值范围不满足时跳过整块
+    int guard_count;            // 比较数
+    int64_t duration_ms;        // 需持续满足的时间
+    int adjacent;               // 需相邻满足的通道数 (1表示单通道)
+
+    rule_channel_state_t *states; // 满足条件的通道 (开放寻址哈希)
+    size_t state_capacity;      // 哈希表容量 (2的幂，0表示未分配)
+    size_t state_count;         // 条目数
+    uint64_t run_key;           // 相邻判断：上一行的键
+    int run_length;             // 相邻判断：截至上一行连续满足的通道数
+    rule_event_t *events;       // 本次评估产生的事件
+    size_t event_count;         // 事件数
+    size_t event_capacity;      // 事件数组容量
+    uint64_t fired;             // 累计触发次数
+} rule_t;
+
+/**
+ * @brief 一组编译后的规则
+ */
+typedef struct {
+    rule_t *rules;              // 规则数组
+    size_t count;               // 规则数
+} rule_set_t;
+
+struct rule_worker;
+
+/**
+ * @brief 规则引擎
+ */
+typedef struct {
+    rule_set_t *set;            // 当前规则集 (只在评估线程中替换)
+    device_state_t *state;      // 数据来源 (NULL时只能直接调用rule_engine_evaluate)
+    char path[256];             // 规则文件路径 (空表示不从文件加载)
+    struct timespec loaded_mtime; // 已加载规则文件的修改时间
+    int reload_requested;       // 重载请求标志 (可在信号处理函数中设置)
+
+    rule_event_fn callback;     // 事件回调
+    void *callback_ctx;         // 回调上下文
+    int threads;                // 评估线程数
+    int64_t stale_ms;           // 过期记录阈值
+    uint32_t tick;              // 评估序号
+
+    pthread_t thread;           // 周期评估线程
+    int running;                // 周期评估线程是否运行
+
+    pthread_mutex_t work_lock;  // 保护评估任务的分发和完成计数
+    pthread_cond_t work_ready;  // 有新一轮评估或工作线程需要退出
+    pthread_cond_t work_done;   // 本轮工作线程全部完成
+    pthread_t workers[RULE_MAX_THREADS]; // 常驻评估工作线程
+    struct rule_worker *jobs;   // 各工作线程本轮负责的规则区间
+    int worker_count;           // 工作线程数 (评估线程数 - 1)
+    int workers_stopping;       // 工作线程是否退出
+    uint64_t work_round;        // 评估轮次，工作线程据此领取新任务
+    int work_pending;           // 本轮尚未完成的工作线程数
+    int tick_ms;                // 采样周期
+    realtime_columns_t rows;    // 每周期解码的通道记录 (复用)
+    uint32_t *order;            // 按设备标识排序的设备下标 (同一区划的通道落在相邻块)
+    size_t order_count;         // 已排序的设备数
+    int64_t *zones;             // 每块每列的最小值和最大值 [块][列][2]
+    size_t zone_blocks;         // zones可容纳的块数
+
+    uint64_t evaluations;       // 累计评估次数
+    uint64_t last_eval_us;      // 最近一次评估耗时(微秒)
+    uint64_t reloads;           // 成功重载次数
+    uint64_t reload_errors;     // 重载失败次数
+} rule_engine_t;
+
+/**
+ * @brief 初始化规则引擎并启动常驻评估工作线程
+ * @param engine 引擎指针
+ * @param state 设备状态表，NULL表示由调用方提供数据
+ * @param threads 评估线程数 (含调用线程)，0或1表示在调用线程中评估
+ * @return 0成功，-1失败
+ */
+int rule_engine_init(rule_engine_t *engine, device_state_t *state, int threads);
+
+/**
+ * @brief 销毁规则引擎 (先停止周期评估线程)
+ * @param engine 引擎指针
+ */
+void rule_engine_destroy(rule_engine_t *engine);
+
+/**
+ * @brief 设置事件回调
+ * @param engine 引擎指针
+ * @param callback 回调函数
+ * @param ctx 回调上下文
+ */
+void rule_engine_set_callback(rule_engine_t *engine, rule_event_fn callback, void *ctx);
+
+/**
+ * @brief 从文件加载规则，之后文件修改时间变化时自动重载
+ * 任意一条规则编译失败时整个文件不生效，保留原规则集。
+ * 只能在启动周期评估线程之前调用 (运行中返回-1)，运行期间改为修改文件或rule_engine_request_reload
+ * @param engine 引擎指针
+ * @param path 规则文件路径
+ * @return 加载的规则数，-1失败
+ */
+int rule_engine_load_file(rule_engine_t *engine, const char *path);
+
+/**
+ * @brief 从字符串加载规则
+ * 只能在启动周期评估线程之前，或在直接调用rule_engine_evaluate的同一线程中调用 (运行中返回-1)
+ * @param engine 引擎指针
+ * @param text 规则文本
+ * @return 加载的规则数，-1失败
+ */
+int rule_engine_load_string(rule_engine_t *engine, const char *text);
+
+/**
+ * @brief 请求重新加载规则文件 (异步信号安全，由评估线程在下一周期处理)
+ * @param engine 引擎指针
+ */
+void rule_engine_request_reload(rule_engine_t *engine);
+
+/**
+ * @brief 对一批通道记录评估全部规则并分发事件
+ * 每个通道应只出现一次，同一设备的通道按编号连续排列 (相邻规则依赖该顺序)
+ * @param engine 引擎指针
+ * @param rows 通道记录
+ * @param now_ms 评估时刻(Unix毫秒)
+ * @return 本次产生的事件数，-1失败
+ */
+int rule_engine_evaluate(rule_engine_t *engine, const realtime_columns_t *rows, int64_t now_ms);
+
+/**
+ * @brief 启动周期评估线程：每周期检查重载、取设备状态快照并评估
+ * @param engine 引擎指针 (必须已设置设备状态表)
+ * @param tick_ms 采样周期，0表示默认值
+ * @return 0成功，-1失败
+ */
+int rule_engine_start(rule_engine_t *engine, int tick_ms);
+
+/**
+ * @brief 停止周期评估线程
+ * @param engine 引擎指针
+ */
+void rule_engine_stop(rule_engine_t *engine);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RULE_ENGINE_H
@@ -6,6 +6,7 @@
 #include "signal_controller.h"
 #include "../utils/socket_utils.h"
 #include "../utils/logger.h"
+#include "../utils/metrics.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +17,92 @@
 #include <arpa/inet.h>
 #include <errno.h>
 
+/**
+ * @brief 比较两个设备标识是否相同
+ */
+static int device_id_equal(const device_id_t *a, const device_id_t *b) {
+    return a->admin_code == b->admin_code &&
+           a->device_type == b->device_type &&
+           a->device_id == b->device_id;
+}
+
+/**
+ * @brief 连接当前可用的子会话槽位数
+ */
+static inline int client_session_slots(const client_info_t *client) {
+    return client->extra_sessions ? MAX_SESSIONS_PER_CLIENT : 1;
+}
+
+/**
+ * @brief 取连接的第i个子会话槽位 (i小于client_session_slots)
+ */
+static inline client_session_t *client_session_at(const client_info_t *client, int i) {
+    return i == 0 ? (client_session_t *)&client->session : &client->extra_sessions[i - 1];
+}
+
+/**
+ * @brief 获取连接的默认对端标识 (第一个已注册的逻辑检测器)
+ * 用于无法从帧中得到发送方标识时 (如解码失败) 的应答寻址
+ */
+static const device_id_t *client_default_peer(const client_info_t *client) {
+    static const device_id_t unknown_peer = {0, 0, 0};
+    
+    for (int i = 0; i < client_session_slots(client); i++) {
+        const client_session_t *session = client_session_at(client, i);
+        if (session->in_use) {
+            return &session->device_id;
+        }
+    }
+    return &unknown_peer;
+}
+
+/**
+ * @brief 生成设备的指标标签串
+ */
+static void format_device_labels(const device_id_t *device_id, char *buffer, size_t size) {
+    snprintf(buffer, size, "device=\"%06X-%04X-%04X\"",
+             device_id->admin_code, device_id->device_type, device_id->device_id);
+}
+
+/**
+ * @brief 获取单调时钟毫秒数
+ */
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief 新鲜度事件订阅：按设备维护过期数据流数指标
+ */
+static void freshness_metrics_event(void *ctx, const freshness_event_t *event) {
+    (void)ctx;
+    char labels[METRICS_LABELS_SIZE];
+    format_device_labels(&event->device, labels, sizeof(labels));
+    double stale = metrics_get("traffic_device_stale_streams", labels);
+    if (event->type == FRESHNESS_EVENT_STALE) {
+        metrics_gauge_set("traffic_device_stale_streams", labels, stale + 1);
+    } else {
+        metrics_gauge_set("traffic_device_stale_streams", labels, stale > 1 ? stale - 1 : 0);
+    }
+}
+
+/**
+ * @brief 释放逻辑检测器子会话
+ */
+static void release_client_session(client_info_t *client, client_session_t *session) {
+    if (session->in_use) {
+        char labels[METRICS_LABELS_SIZE];
+        format_device_labels(&session->device_id, labels, sizeof(labels));
+        metrics_remove_labels(labels);
+        
+        session->in_use = 0;
+        session->registered = 0;
+        client->session_count--;
+    }
+}
+
 /**
  * @brief 初始化信号控制机
  */
@@ -42,6 +129,17 @@ int signal_controller_init(signal_controller_t *controller,
         controller->clients[i].connected = 0;
     }
     
+    // 初始化待注册连接表
+    for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+        controller->pending[i].sockfd = -1;
+    }
+    controller->pending_count = 0;
+    
+    buffer_pool_init(&controller->stash_pool);
+    controller->last_latency_report = time(NULL);
+    controller->tcp_info_last_ms = monotonic_ms();
+    controller->last_metrics_dump = time(NULL);
+    
     LOG_INFO("Signal controller initialized - Admin: %06X, ID: %04X, Port: %d",
              admin_code, device_id, port);
     
@@ -88,6 +186,25 @@ int signal_controller_start(signal_controller_t *controller) {
             }
         }
         
+        // 添加待注册连接到监听集合
+        for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+            int fd = controller->pending[i].sockfd;
+            if (fd >= 0) {
+                FD_SET(fd, &readfds);
+                if (fd > max_fd) {
+                    max_fd = fd;
+                }
+            }
+        }
+        
+        // 异步I/O完成通知
+        if (controller->io) {
+            FD_SET(controller->io_owner.event_fd, &readfds);
+            if (controller->io_owner.event_fd > max_fd) {
+                max_fd = controller->io_owner.event_fd;
+            }
+        }
+        
         // 设置超时时间为1秒
         timeout.tv_sec = 1;
         timeout.tv_usec = 0;
@@ -100,14 +217,30 @@ int signal_controller_start(signal_controller_t *controller) {
         }
         
         if (activity > 0) {
+            // 记录本轮select之前已连接的客户端槽位，
+            // 本轮刚由待注册连接提升的槽位虽然fd仍在readfds中，但数据已被读完，
+            // 若再读会阻塞在recv上，使整个主循环停顿
+            uint8_t was_connected[MAX_CLIENTS];
+            for (int i = 0; i < MAX_CLIENTS; i++) {
+                was_connected[i] = (uint8_t)controller->clients[i].connected;
+            }
+            
             // 处理新连接
             if (FD_ISSET(controller->server_sockfd, &readfds)) {
                 handle_new_connection(controller);
             }
             
+            // 处理待注册连接的消息
+            for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+                if (controller->pending[i].sockfd >= 0 &&
+                    FD_ISSET(controller->pending[i].sockfd, &readfds)) {
+                    handle_pending_message(controller, i);
+                }
+            }
+            
             // 处理客户端消息
             for (int i = 0; i < MAX_CLIENTS; i++) {
-                if (controller->clients[i].connected && 
+                if (was_connected[i] && controller->clients[i].connected &&
                     controller->clients[i].sockfd > 0 &&
                     FD_ISSET(controller->clients[i].sockfd, &readfds)) {
                     if (handle_client_message(controller, i) < 0) {
@@ -117,8 +250,80 @@ int signal_controller_start(signal_controller_t *controller) {
             }
         }
         
+        // 取出已完成的磁盘I/O (回收缓冲区)
+        if (controller->io) {
+            async_io_poll(&controller->io_owner);
+        }
+        
+        // 清理超过注册时限的待注册连接
+        expire_pending_connections(controller);
+        
+        // 超过预期到达时间仍未上传数据的设备
+        if (controller->freshness) {
+            freshness_expire(controller->freshness, monotonic_ms());
+        }
+        
         // 定期发送心跳查询和检查超时
         time_t current_time = time(NULL);
+        
+        // 轮询采样TCP链路状态
+        sample_tcp_link_stats(controller);
+        
+        // 定期提交抓包fdatasync (异步执行，不阻塞主循环)
+        if (controller->io && capture_writer_is_open(&controller->capture) &&
+            current_time - controller->last_capture_sync >= CAPTURE_SYNC_INTERVAL) {
+            // 提交队列满时下一轮重试，只有写入或fdatasync失败时才关闭抓包
+            if (capture_writer_sync(&controller->capture) == 0) {
+                controller->last_capture_sync = current_time;
+            } else if (controller->capture.failed) {
+                LOG_WARN("Failed to sync capture file, capture disabled");
+                capture_writer_close(&controller->capture);
+            }
+        }
+        
+        // 定期输出运行指标
+        if (controller->metrics_path &&
+            current_time - controller->last_metrics_dump >= METRICS_DUMP_INTERVAL) {
+            metrics_gauge_set("traffic_clients_connected", NULL, controller->client_count);
+            metrics_gauge_set("traffic_pending_connections", NULL, controller->pending_count);
+            if (controller->device_state) {
+                metrics_gauge_set("traffic_device_state_versions", NULL,
+                                  controller->device_state->live_versions);
+            }
+            if (controller->stats_dedup) {
+                metrics_gauge_set("traffic_stats_accepted_total", NULL, controller->stats_dedup->accepted);
+                metrics_gauge_set("traffic_stats_duplicates_total", NULL, controller->stats_dedup->duplicates);
+                metrics_gauge_set("traffic_stats_dedup_false_positives_total", NULL,
+                                  controller->stats_dedup->false_positives);
+                metrics_gauge_set("traffic_stats_dedup_future_total", NULL, controller->stats_dedup->future);
+            }
+            if (controller->io) {
+                async_io_export_metrics(controller->io);
+                metrics_gauge_set("traffic_capture_dropped_total", NULL, controller->capture.dropped);
+            }
+            if (controller->freshness) {
+                metrics_gauge_set("traffic_stale_streams", NULL, controller->freshness->stale_streams);
+                metrics_gauge_set("traffic_stale_events_total", NULL, controller->freshness->stale_events);
+            }
+            if (metrics_write_file(controller->metrics_path) < 0) {
+                LOG_WARN("Failed to write metrics file %s", controller->metrics_path);
+            }
+            controller->last_metrics_dump = current_time;
+        }
+        
+        // 回收快照读者不再需要的设备状态旧版本
+        if (controller->device_state && current_time != controller->last_state_reclaim) {
+            device_state_reclaim(controller->device_state);
+            controller->last_state_reclaim = current_time;
+        }
+        
+        // 定期输出接收延迟统计
+        if (controller->rx_timestamps &&
+            current_time - controller->last_latency_report >= LATENCY_REPORT_INTERVAL) {
+            signal_controller_report_latency(controller);
+            controller->last_latency_report = current_time;
+        }
+
         if (current_time - controller->last_heartbeat_check >= HEARTBEAT_INTERVAL) {
             // 发送心跳查询
             for (int i = 0; i < MAX_CLIENTS; i++) {
@@ -136,6 +341,279 @@ int signal_controller_start(signal_controller_t *controller) {
     return 0;
 }
 
+/**
+ * @brief 开启或关闭内核接收时间戳
+ */
+void signal_controller_enable_rx_timestamps(signal_controller_t *controller, int enable) {
+    if (!controller) {
+        return;
+    }
+    
+    controller->rx_timestamps = enable ? 1 : 0;
+    latency_histogram_reset(&controller->kernel_latency);
+    latency_histogram_reset(&controller->processing_latency);
+    latency_histogram_reset(&controller->end_to_end_latency);
+    LOG_INFO("Kernel receive timestamps %s", enable ? "enabled" : "disabled");
+}
+
+/**
+ * @brief 输出并清空接收延迟直方图
+ */
+void signal_controller_report_latency(signal_controller_t *controller) {
+    if (!controller) {
+        return;
+    }
+    
+    latency_histogram_log("kernel->user", &controller->kernel_latency);
+    latency_histogram_log("processing", &controller->processing_latency);
+    latency_histogram_log("end-to-end", &controller->end_to_end_latency);
+    
+    latency_histogram_reset(&controller->kernel_latency);
+    latency_histogram_reset(&controller->processing_latency);
+    latency_histogram_reset(&controller->end_to_end_latency);
+}
+
+/**
+ * @brief 设置指标文件路径
+ */
+void signal_controller_set_metrics_file(signal_controller_t *controller, const char *path) {
+    if (controller) {
+        controller->metrics_path = path;
+    }
+}
+
+/**
+ * @brief 设置实时信息列式存储
+ */
+void signal_controller_set_realtime_store(signal_controller_t *controller, realtime_store_t *store) {
+    if (controller) {
+        controller->realtime_store = store;
+    }
+}
+
+/**
+ * @brief 设置设备状态表
+ */
+void signal_controller_set_device_state(signal_controller_t *controller, device_state_t *state) {
+    if (controller) {
+        controller->device_state = state;
+    }
+}
+
+/**
+ * @brief 设置流量预测器
+ */
+void signal_controller_set_forecast(signal_controller_t *controller, flow_forecast_t *forecast) {
+    if (controller) {
+        controller->forecast = forecast;
+    }
+}
+
+/**
+ * @brief 设置数据新鲜度监测器
+ */
+int signal_controller_set_freshness(signal_controller_t *controller, freshness_monitor_t *monitor) {
+    if (!controller) {
+        return -1;
+    }
+    controller->freshness = monitor;
+    return monitor ? freshness_subscribe(monitor, freshness_metrics_event, controller) : 0;
+}
+
+/**
+ * @brief 设置统计数据去重器
+ */
+void signal_controller_set_stats_dedup(signal_controller_t *controller, stats_dedup_t *dedup) {
+    if (controller) {
+        controller->stats_dedup = dedup;
+    }
+}
+
+/**
+ * @brief 开启接收帧抓包
+ */
+int signal_controller_set_capture_file(signal_controller_t *controller, const char *path) {
+    if (!controller || !path) {
+        return -1;
+    }
+    
+    capture_writer_close(&controller->capture);
+    if (controller->io) {
+        if (capture_writer_open_async(&controller->capture, path, controller->io, &controller->io_owner) < 0) {
+            return -1;
+        }
+    } else if (capture_writer_open(&controller->capture, path) < 0) {
+        return -1;
+    }
+    
+    LOG_INFO("Capturing received frames to %s%s", path, controller->io ? " (async)" : "");
+    return 0;
+}
+
+/**
+ * @brief 设置异步磁盘I/O
+ */
+int signal_controller_set_async_io(signal_controller_t *controller, async_io_t *io) {
+    if (!controller || !io || controller->io) {
+        return -1;
+    }
+    
+    if (async_io_owner_init(&controller->io_owner, 0) < 0) {
+        return -1;
+    }
+    controller->io = io;
+    controller->last_capture_sync = time(NULL);
+    return 0;
+}
+
+/**
+ * @brief 获取当前帧的接收时间(Unix纳秒)
+ * 开启内核接收时间戳时使用内核时间，否则使用当前时间
+ */
+static int64_t frame_received_ns(const signal_controller_t *controller) {
+    struct timespec ts;
+    if (controller->rx_timestamps && controller->frame_rx_time.tv_sec != 0) {
+        ts = controller->frame_rx_time;
+    } else {
+        clock_gettime(CLOCK_REALTIME, &ts);
+    }
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 采样单个连接的TCP_INFO并更新链路指标
+ */
+int sample_client_tcp_info(signal_controller_t *controller, int client_idx) {
+    client_info_t *client = &controller->clients[client_idx];
+    if (!client->connected) {
+        return -1;
+    }
+    
+    struct tcp_info info;
+    if (get_tcp_info(client->sockfd, &info) < 0) {
+        return -1;
+    }
+    
+    tcp_link_stats_t *stats = &client->link_stats;
+    uint32_t new_retrans = stats->sampled ? info.tcpi_total_retrans - stats->total_retrans : 0;
+    
+    stats->srtt_us = info.tcpi_rtt;
+    stats->rttvar_us = info.tcpi_rttvar;
+    stats->total_retrans = info.tcpi_total_retrans;
+    stats->snd_cwnd = info.tcpi_snd_cwnd;
+    stats->unacked_bytes = info.tcpi_unacked * info.tcpi_snd_mss;
+    if (get_socket_queue_depths(client->sockfd, &stats->send_queue_bytes,
+                                &stats->recv_queue_bytes) < 0) {
+        stats->send_queue_bytes = 0;
+        stats->recv_queue_bytes = 0;
+    }
+    stats->last_sample = time(NULL);
+    stats->sampled = 1;
+    
+    // 判断链路是否劣化，仅在状态变化时记录日志
+    uint8_t degraded = stats->srtt_us > TCP_DEGRADED_RTT_US || new_retrans >= TCP_DEGRADED_RETRANS;
+    if (degraded != stats->degraded) {
+        if (degraded) {
+            LOG_WARN("Client %d (%s) link degraded: srtt=%uus, %u new retransmits",
+                     client_idx, client->ip_addr, stats->srtt_us, new_retrans);
+        } else {
+            LOG_INFO("Client %d (%s) link recovered: srtt=%uus",
+                     client_idx, client->ip_addr, stats->srtt_us);
+        }
+        metrics_gauge_set("traffic_links_degraded", NULL,
+                          metrics_get("traffic_links_degraded", NULL) + (degraded ? 1 : -1));
+        stats->degraded = degraded;
+    }
+    
+    // 按逻辑检测器导出链路指标
+    for (int i = 0; i < client_session_slots(client); i++) {
+        const client_session_t *session = client_session_at(client, i);
+        if (!session->in_use) {
+            continue;
+        }
+        
+        char labels[METRICS_LABELS_SIZE];
+        format_device_labels(&session->device_id, labels, sizeof(labels));
+        metrics_gauge_set("traffic_link_srtt_us", labels, stats->srtt_us);
+        metrics_gauge_set("traffic_link_rttvar_us", labels, stats->rttvar_us);
+        metrics_gauge_set("traffic_link_retrans_total", labels, stats->total_retrans);
+        metrics_gauge_set("traffic_link_cwnd", labels, stats->snd_cwnd);
+        metrics_gauge_set("traffic_link_unacked_bytes", labels, stats->unacked_bytes);
+        metrics_gauge_set("traffic_link_send_queue_bytes", labels, stats->send_queue_bytes);
+        metrics_gauge_set("traffic_link_recv_queue_bytes", labels, stats->recv_queue_bytes);
+        metrics_gauge_set("traffic_link_degraded", labels, stats->degraded);
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief 按轮询方式采样一批连接的TCP_INFO
+ */
+void sample_tcp_link_stats(signal_controller_t *controller) {
+    long long now_ms = monotonic_ms();
+    long long elapsed_ms = now_ms - controller->tcp_info_last_ms;
+    controller->tcp_info_last_ms = now_ms;
+    
+    // 按经过的时间累积额度，每TCP_INFO_SAMPLE_PERIOD_MS遍历一次所有槽位
+    controller->tcp_info_credit += elapsed_ms * MAX_CLIENTS;
+    int slots = (int)(controller->tcp_info_credit / TCP_INFO_SAMPLE_PERIOD_MS);
+    if (slots <= 0) {
+        return;
+    }
+    controller->tcp_info_credit -= (long long)slots * TCP_INFO_SAMPLE_PERIOD_MS;
+    
+    if (slots > TCP_INFO_MAX_BATCH) {
+        slots = TCP_INFO_MAX_BATCH;
+        controller->tcp_info_credit = 0; // 长时间未采样时不补偿积压
+    }
+    
+    for (int i = 0; i < slots; i++) {
+        int idx = controller->tcp_info_cursor;
+        controller->tcp_info_cursor = (controller->tcp_info_cursor + 1) % MAX_CLIENTS;
+        
+        if (controller->clients[idx].connected) {
+            sample_client_tcp_info(controller, idx);
+        }
+    }
+}
+
+/**
+ * @brief 接收数据，开启时间戳时同时记录内核接收时间和读入时间
+ */
+static int controller_recv(signal_controller_t *controller, int sockfd,
+                           uint8_t *buffer, size_t size) {
+    int recv_len;
+    
+    if (controller->rx_timestamps) {
+        recv_len = recv_with_rx_timestamp(sockfd, buffer, size, &controller->frame_rx_time);
+        clock_gettime(CLOCK_REALTIME, &controller->frame_read_time);
+    } else {
+        recv_len = recv(sockfd, buffer, size, 0);
+    }
+    
+    return recv_len;
+}
+
+/**
+ * @brief 记录当前帧的各阶段延迟
+ */
+static void record_frame_latency(signal_controller_t *controller) {
+    if (!controller->rx_timestamps || controller->frame_rx_time.tv_sec == 0) {
+        return;
+    }
+    
+    struct timespec done_time;
+    clock_gettime(CLOCK_REALTIME, &done_time);
+    
+    latency_histogram_record(&controller->kernel_latency,
+                             timespec_diff_ns(&controller->frame_read_time, &controller->frame_rx_time));
+    latency_histogram_record(&controller->processing_latency,
+                             timespec_diff_ns(&done_time, &controller->frame_read_time));
+    latency_histogram_record(&controller->end_to_end_latency,
+                             timespec_diff_ns(&done_time, &controller->frame_rx_time));
+}
+
 /**
  * @brief 停止信号控制机服务
  */
@@ -153,6 +631,27 @@ void signal_controller_stop(signal_controller_t *controller) {
         }
     }
     
+    // 关闭所有待注册连接
+    for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+        if (controller->pending[i].sockfd >= 0) {
+            close(controller->pending[i].sockfd);
+            controller->pending[i].sockfd = -1;
+        }
+    }
+    controller->pending_count = 0;
+    
+    buffer_pool_destroy(&controller->stash_pool);
+    
+    if (capture_writer_is_open(&controller->capture)) {
+        LOG_INFO("Capture closed - %llu frames", (unsigned long long)controller->capture.records);
+        capture_writer_close(&controller->capture);
+    }
+    if (controller->io) {
+        async_io_poll(&controller->io_owner);
+        async_io_owner_destroy(&controller->io_owner);
+        controller->io = NULL;
+    }
+    
     // 关闭服务器socket
     if (controller->server_sockfd >= 0) {
         close(controller->server_sockfd);
@@ -164,6 +663,7 @@ void signal_controller_stop(signal_controller_t *controller) {
 
 /**
  * @brief 处理新客户端连接
+ * 新连接先进入待注册连接表，收到连接请求后再分配完整的客户端槽位
  */
 int handle_new_connection(signal_controller_t *controller) {
     struct sockaddr_in client_addr;
@@ -176,6 +676,131 @@ int handle_new_connection(signal_controller_t *controller) {
         return -1;
     }
     
+    // 查找空闲的待注册槽位
+    int pending_idx = -1;
+    for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+        if (controller->pending[i].sockfd < 0) {
+            pending_idx = i;
+            break;
+        }
+    }
+    
+    if (pending_idx < 0) {
+        LOG_WARN("Too many pending connections, rejecting connection from %s",
+                inet_ntoa(client_addr.sin_addr));
+        close(client_sockfd);
+        return -1;
+    }
+    
+    // 按需开启内核接收时间戳
+    if (controller->rx_timestamps && enable_rx_timestamps(client_sockfd) < 0) {
+        LOG_WARN("Failed to enable receive timestamps for %s", inet_ntoa(client_addr.sin_addr));
+    }
+    
+    pending_conn_t *pending = &controller->pending[pending_idx];
+    pending->sockfd = client_sockfd;
+    pending->accepted_at = time(NULL);
+    pending->addr = client_addr.sin_addr;
+    pending->recv_buffer_len = 0;
+    pending->bytes_received = 0;
+    controller->pending_count++;
+    
+    LOG_DEBUG("New connection from %s awaiting registration (pending slot %d, %d pending)",
+              inet_ntoa(client_addr.sin_addr), pending_idx, controller->pending_count);
+    
+    return 0;
+}
+
+/**
+ * @brief 关闭待注册连接
+ */
+static void close_pending_connection(signal_controller_t *controller, int pending_idx) {
+    pending_conn_t *pending = &controller->pending[pending_idx];
+    if (pending->sockfd >= 0) {
+        close(pending->sockfd);
+        pending->sockfd = -1;
+        pending->recv_buffer_len = 0;
+        controller->pending_count--;
+    }
+}
+
+/**
+ * @brief 释放客户端的残留帧暂存
+ */
+static void release_client_stash(signal_controller_t *controller, client_info_t *client) {
+    if (client->stash) {
+        buffer_pool_free(&controller->stash_pool, client->stash, client->stash_capacity);
+        client->stash = NULL;
+        client->stash_capacity = 0;
+    }
+    client->stash_len = 0;
+}
+
+/**
+ * @brief 就地处理接收数据中的所有完整帧，末尾不完整的帧转入暂存
+ * @param data 接收数据 (通常位于共享接收缓冲区，可能被就地整理)
+ * @param data_len 数据长度
+ */
+static void process_received_data(signal_controller_t *controller, int client_idx,
+                                  uint8_t *data, size_t data_len) {
+    client_info_t *client = &controller->clients[client_idx];
+    
+    // 处理缓冲区中的所有完整帧 (不移动数据，只前移处理位置)
+    int frames_processed = 0;
+    while (client->connected && data_len > 0) {
+        size_t buffer_len = data_len;
+        size_t frame_start, frame_len;
+        int result = extract_complete_frame(data, &buffer_len, &frame_start, &frame_len);
+        
+        if (result <= 0) {
+            data_len = buffer_len; // 没有更多完整帧，可能已丢弃无效前缀
+            break;
+        }
+        
+        // 处理找到的完整帧
+        process_single_frame(controller, client_idx, data + frame_start, frame_len);
+        record_frame_latency(controller);
+        frames_processed++;
+        
+        data += frame_start + frame_len;
+        data_len = buffer_len - (frame_start + frame_len);
+    }
+    
+    if (!client->connected) {
+        return;
+    }
+    
+    // 暂存末尾不完整的帧
+    if (data_len > CLIENT_RECV_BUFFER_SIZE) {
+        LOG_WARN("Client %d partial frame exceeds %d bytes, discarding",
+                 client_idx, CLIENT_RECV_BUFFER_SIZE);
+        data_len = 0;
+    }
+    
+    if (data_len > 0) {
+        size_t capacity;
+        client->stash = buffer_pool_alloc(&controller->stash_pool, data_len, &capacity);
+        if (!client->stash) {
+            LOG_ERROR("Failed to allocate stash for client %d", client_idx);
+            data_len = 0;
+        } else {
+            memcpy(client->stash, data, data_len);
+            client->stash_capacity = (uint16_t)capacity;
+        }
+    }
+    client->stash_len = (uint16_t)data_len;
+    
+    LOG_DEBUG("Processed %d frames from client %d, %zu bytes stashed", 
+              frames_processed, client_idx, data_len);
+}
+
+/**
+ * @brief 将待注册连接提升为完整的客户端连接
+ * @return 客户端索引，-1表示没有空闲槽位
+ */
+static int promote_pending_connection(signal_controller_t *controller, int pending_idx) {
+    pending_conn_t *pending = &controller->pending[pending_idx];
+    
     // 查找空闲的客户端槽位
     int client_idx = -1;
     for (int i = 0; i < MAX_CLIENTS; i++) {
@@ -187,26 +812,131 @@ int handle_new_connection(signal_controller_t *controller) {
     
     if (client_idx < 0) {
         LOG_WARN("Too many clients, rejecting connection from %s",
-                inet_ntoa(client_addr.sin_addr));
-        close(client_sockfd);
+                inet_ntoa(pending->addr));
         return -1;
     }
     
     // 初始化客户端信息
-    controller->clients[client_idx].sockfd = client_sockfd;
-    controller->clients[client_idx].connected = 1;
-    controller->clients[client_idx].last_heartbeat = time(NULL);
-    strcpy(controller->clients[client_idx].ip_addr, inet_ntoa(client_addr.sin_addr));
+    client_info_t *client = &controller->clients[client_idx];
+    client->sockfd = pending->sockfd;
+    client->connected = 1;
+    client->last_heartbeat = time(NULL);
+    strcpy(client->ip_addr, inet_ntoa(pending->addr));
+    
+    // 初始化残留帧暂存
+    client->stash = NULL;
+    client->stash_len = 0;
+    client->stash_capacity = 0;
     
-    // 初始化接收缓冲区
-    controller->clients[client_idx].recv_buffer_len = 0;
+    memset(&client->link_stats, 0, sizeof(client->link_stats));
+    
+    // 初始化逻辑检测器子会话 (其余槽位在出现第二个检测器时分配)
+    memset(&client->session, 0, sizeof(client->session));
+    client->extra_sessions = NULL;
+    client->session_count = 0;
     
     controller->client_count++;
     
+    // 释放待注册槽位 (socket已转交给客户端连接)
+    pending->sockfd = -1;
+    pending->recv_buffer_len = 0;
+    controller->pending_count--;
+    
     LOG_INFO("New client connected from %s (slot %d), total clients: %d",
-             controller->clients[client_idx].ip_addr, client_idx, controller->client_count);
+             client->ip_addr, client_idx, controller->client_count);
     
-    return 0;
+    return client_idx;
+}
+
+/**
+ * @brief 处理待注册连接的消息
+ */
+int handle_pending_message(signal_controller_t *controller, int pending_idx) {
+    pending_conn_t *pending = &controller->pending[pending_idx];
+    
+    size_t available_space = PENDING_RECV_BUFFER_SIZE - pending->recv_buffer_len;
+    int recv_len = controller_recv(controller, pending->sockfd,
+                                   pending->recv_buffer + pending->recv_buffer_len,
+                                   available_space);
+    if (recv_len <= 0) {
+        LOG_DEBUG("Pending connection %d closed before registration", pending_idx);
+        close_pending_connection(controller, pending_idx);
+        return -2;
+    }
+    pending->recv_buffer_len += recv_len;
+    pending->bytes_received += recv_len;
+    
+    size_t buffer_len = pending->recv_buffer_len;
+    size_t frame_start, frame_len;
+    int result = extract_complete_frame(pending->recv_buffer, &buffer_len,
+                                        &frame_start, &frame_len);
+    pending->recv_buffer_len = (uint16_t)buffer_len;
+    
+    if (result <= 0) {
+        // 接收量超过一个连接请求帧仍没有完整帧，说明不是合法的检测器
+        if (pending->bytes_received >= PENDING_RECV_BUFFER_SIZE) {
+            LOG_WARN("Connection from %s sent no registration frame, closing",
+                     inet_ntoa(pending->addr));
+            close_pending_connection(controller, pending_idx);
+            return -2;
+        }
+        return -1;
+    }
+    
+    // 第一帧必须是有效的连接请求
+    protocol_frame_t frame;
+    if (decode_frame(pending->recv_buffer + frame_start, frame_len, &frame) != PROTOCOL_SUCCESS) {
+        LOG_WARN("Invalid registration frame from %s, closing", inet_ntoa(pending->addr));
+        close_pending_connection(controller, pending_idx);
+        return -2;
+    }
+    
+    if (frame.data.object_id != OBJ_COMMUNICATION || frame.data.operation != OP_SET_REQUEST) {
+        LOG_WARN("Connection from %s sent object 0x%04X before registering, closing",
+                 inet_ntoa(pending->addr), frame.data.object_id);
+        free_frame(&frame);
+        close_pending_connection(controller, pending_idx);
+        return -2;
+    }
+    
+    // 保存连接请求之后的剩余数据
+    uint8_t leftover[PENDING_RECV_BUFFER_SIZE];
+    size_t leftover_len = pending->recv_buffer_len - (frame_start + frame_len);
+    memcpy(leftover, pending->recv_buffer + frame_start + frame_len, leftover_len);
+    
+    int client_idx = promote_pending_connection(controller, pending_idx);
+    if (client_idx < 0) {
+        free_frame(&frame);
+        close_pending_connection(controller, pending_idx);
+        return -2;
+    }
+    
+    handle_connection_request(controller, client_idx, &frame);
+    free_frame(&frame);
+    
+    // 处理随连接请求一起到达的后续帧
+    process_received_data(controller, client_idx, leftover, leftover_len);
+    
+    return client_idx;
+}
+
+/**
+ * @brief 关闭超过注册时限的待注册连接
+ */
+void expire_pending_connections(signal_controller_t *controller) {
+    if (controller->pending_count == 0) {
+        return;
+    }
+    
+    time_t current_time = time(NULL);
+    for (int i = 0; i < MAX_PENDING_CONNECTIONS; i++) {
+        if (controller->pending[i].sockfd >= 0 &&
+            current_time - controller->pending[i].accepted_at > REGISTRATION_TIMEOUT) {
+            LOG_WARN("Connection from %s did not register within %d seconds, closing",
+                     inet_ntoa(controller->pending[i].addr), REGISTRATION_TIMEOUT);
+            close_pending_connection(controller, i);
+        }
+    }
 }
 
 /**
@@ -214,19 +944,19 @@ int handle_new_connection(signal_controller_t *controller) {
  */
 int handle_client_message(signal_controller_t *controller, int client_idx) {
     client_info_t *client = &controller->clients[client_idx];
+    uint8_t *rx_buffer = controller->rx_buffer;
     
-    // 计算剩余缓冲区空间
-    size_t available_space = CLIENT_RECV_BUFFER_SIZE - client->recv_buffer_len;
-    if (available_space == 0) {
-        LOG_WARN("Client %d receive buffer full, resetting buffer", client_idx);
-        client->recv_buffer_len = 0;
-        available_space = CLIENT_RECV_BUFFER_SIZE;
+    // 将上次残留的不完整帧放到共享缓冲区开头
+    size_t buffered_len = client->stash_len;
+    if (buffered_len > 0) {
+        memcpy(rx_buffer, client->stash, buffered_len);
     }
+    release_client_stash(controller, client);
     
-    // 接收数据到缓冲区末尾
-    int recv_len = recv(client->sockfd, 
-                       client->recv_buffer + client->recv_buffer_len, 
-                       available_space, 0);
+    // 接收数据到共享缓冲区
+    int recv_len = controller_recv(controller, client->sockfd,
+                                   rx_buffer + buffered_len,
+                                   RX_BUFFER_SIZE - buffered_len);
     if (recv_len <= 0) {
         if (recv_len == 0) {
             LOG_INFO("Client %d disconnected", client_idx);
@@ -237,38 +967,11 @@ int handle_client_message(signal_controller_t *controller, int client_idx) {
     }
     
     // 更新缓冲区长度
-    client->recv_buffer_len += recv_len;
+    buffered_len += recv_len;
     LOG_DEBUG("Received %d bytes from client %d, buffer now has %zu bytes", 
-              recv_len, client_idx, client->recv_buffer_len);
-    
-    // 处理缓冲区中的所有完整帧
-    int frames_processed = 0;
-    while (client->recv_buffer_len > 0) {
-        size_t frame_start, frame_len;
-        int result = extract_complete_frame(client->recv_buffer, &client->recv_buffer_len,
-                                          &frame_start, &frame_len);
-        
-        if (result <= 0) {
-            break; // 没有更多完整帧或出错
-        }
-        
-        // 处理找到的完整帧
-        process_single_frame(controller, client_idx, 
-                           client->recv_buffer + frame_start, frame_len);
-        frames_processed++;
-        
-        // 移除已处理的帧
-        size_t remaining_data = client->recv_buffer_len - (frame_start + frame_len);
-        if (remaining_data > 0) {
-            memmove(client->recv_buffer, 
-                   client->recv_buffer + frame_start + frame_len, 
-                   remaining_data);
-        }
-        client->recv_buffer_len = remaining_data;
-    }
+              recv_len, client_idx, buffered_len);
     
-    LOG_DEBUG("Processed %d frames from client %d, %zu bytes remaining in buffer", 
-              frames_processed, client_idx, client->recv_buffer_len);
+    process_received_data(controller, client_idx, rx_buffer, buffered_len);
     
     return 0;
 }
@@ -334,6 +1037,21 @@ int extract_complete_frame(uint8_t *buffer, size_t *buffer_len,
     return 1;
 }
 
+/**
+ * @brief 向连接发送出错应答
+ */
+static void send_error_frame(signal_controller_t *controller, int client_idx,
+                             const device_id_t *peer, uint8_t error_type) {
+    protocol_frame_t error_frame = create_error_frame(controller->device_id, *peer, error_type);
+    
+    uint8_t error_buffer[MAX_FRAME_SIZE];
+    int error_len = encode_frame(&error_frame, error_buffer, sizeof(error_buffer));
+    if (error_len > 0) {
+        send_all(controller->clients[client_idx].sockfd, error_buffer, error_len);
+    }
+    free_frame(&error_frame);
+}
+
 /**
  * @brief 处理单个协议帧
  */
@@ -345,6 +1063,12 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
     
     LOG_DEBUG("Processing frame of %zu bytes from client %d", frame_len, client_idx);
     
+    if (capture_writer_is_open(&controller->capture) &&
+        capture_writer_write(&controller->capture, frame_received_ns(controller), frame_data, frame_len) < 0) {
+        LOG_WARN("Failed to write capture record, capture disabled");
+        capture_writer_close(&controller->capture);
+    }
+    
     // 解析协议帧
     protocol_frame_t frame;
     protocol_result_t result = decode_frame(frame_data, frame_len, &frame);
@@ -366,18 +1090,8 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
         }
         
         // 发送错误应答
-        protocol_frame_t error_frame = create_error_frame(
-            controller->device_id, 
-            controller->clients[client_idx].device_id,
-            ERROR_CRC
-        );
-        
-        uint8_t error_buffer[MAX_FRAME_SIZE];
-        int error_len = encode_frame(&error_frame, error_buffer, sizeof(error_buffer));
-        if (error_len > 0) {
-            send_all(controller->clients[client_idx].sockfd, error_buffer, error_len);
-        }
-        free_frame(&error_frame);
+        send_error_frame(controller, client_idx,
+                         client_default_peer(&controller->clients[client_idx]), ERROR_CRC);
         return 0;
     }
     
@@ -385,6 +1099,31 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
     LOG_DEBUG("Successfully decoded frame from client %d: operation=0x%02X, object_id=0x%04X, content_len=%d",
               client_idx, frame.data.operation, frame.data.object_id, frame.data.content_len);
     
+    // 数据帧只接受本连接上已注册的逻辑检测器，防止任意连接冒充其他设备上传
+    if (frame.data.operation == OP_UPLOAD) {
+        client_info_t *client = &controller->clients[client_idx];
+        client_session_t *session = find_client_session(client, &frame.data.sender);
+        if (!session || !session->registered) {
+            LOG_WARN("Client %d uploaded object 0x%04X as unregistered device Admin=%06X, Type=%04X, ID=%04X, rejecting",
+                     client_idx, frame.data.object_id, frame.data.sender.admin_code,
+                     frame.data.sender.device_type, frame.data.sender.device_id);
+            metrics_counter_add("traffic_unregistered_uploads_total", NULL, 1);
+            send_error_frame(controller, client_idx, &frame.data.sender, ERROR_LINK_ADDR);
+            free_frame(&frame);
+            return 0;
+        }
+        
+        // 数据上传同样说明该逻辑检测器存活
+        time_t now = time(NULL);
+        session->last_heartbeat = now;
+        client->last_heartbeat = now;
+    }
+    
+    // 记录数据到达，用于发现仍应答心跳却停止上传数据的设备
+    if (controller->freshness && frame.data.operation == OP_UPLOAD) {
+        freshness_observe(controller->freshness, &frame.data.sender, frame.data.object_id, monotonic_ms());
+    }
+    
     // 根据对象标识处理不同类型的消息
     switch (frame.data.object_id) {
         case OBJ_COMMUNICATION:
@@ -410,8 +1149,8 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
         case OBJ_DETECTOR_STATUS:
             if (frame.data.operation == OP_UPLOAD) {
                 LOG_INFO("Received device status from client %d", client_idx);
-                send_response(controller, client_idx, OP_UPLOAD_RESPONSE, 
-                             OBJ_DETECTOR_STATUS, NULL, 0);
+                send_response(controller, client_idx, &frame.data.sender,
+                             OP_UPLOAD_RESPONSE, OBJ_DETECTOR_STATUS, NULL, 0);
             }
             break;
             
@@ -425,23 +1164,73 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
     return 0;
 }
 
+/**
+ * @brief 按设备标识查找连接上的逻辑检测器子会话
+ */
+client_session_t *find_client_session(client_info_t *client, const device_id_t *device_id) {
+    if (!client || !device_id) {
+        return NULL;
+    }
+    
+    for (int i = 0; i < client_session_slots(client); i++) {
+        client_session_t *session = client_session_at(client, i);
+        if (session->in_use && device_id_equal(&session->device_id, device_id)) {
+            return session;
+        }
+    }
+    return NULL;
+}
+
 /**
  * @brief 处理连接请求
+ * 每个发送方标识对应一个子会话，同一连接上可注册多个逻辑检测器
  */
 int handle_connection_request(signal_controller_t *controller, int client_idx, 
                              const protocol_frame_t *frame) {
-    // 保存客户端设备标识
-    controller->clients[client_idx].device_id = frame->data.sender;
-    controller->clients[client_idx].last_heartbeat = time(NULL);
+    client_info_t *client = &controller->clients[client_idx];
+    time_t now = time(NULL);
+    
+    client_session_t *session = find_client_session(client, &frame->data.sender);
+    if (!session) {
+        // 分配新的子会话槽位，内嵌槽位已占用时才分配其余槽位
+        if (client->session.in_use && !client->extra_sessions) {
+            client->extra_sessions = calloc(MAX_SESSIONS_PER_CLIENT - 1, sizeof(client_session_t));
+            if (!client->extra_sessions) {
+                LOG_ERROR("Failed to allocate sessions for client %d", client_idx);
+                return -1;
+            }
+        }
+        for (int i = 0; i < client_session_slots(client); i++) {
+            if (!client_session_at(client, i)->in_use) {
+                session = client_session_at(client, i);
+                break;
+            }
+        }
+        
+        if (!session) {
+            LOG_WARN("Client %d has too many logical detectors (%d), rejecting ID=%04X",
+                     client_idx, client->session_count, frame->data.sender.device_id);
+            return -1;
+        }
+        
+        session->device_id = frame->data.sender;
+        session->in_use = 1;
+        client->session_count++;
+    }
+    
+    session->registered = 1;
+    session->last_heartbeat = now;
+    client->last_heartbeat = now;
     
-    LOG_INFO("Connection request from device Admin=%06X, Type=%04X, ID=%04X",
+    LOG_INFO("Connection request from device Admin=%06X, Type=%04X, ID=%04X (client %d, %d sessions)",
              frame->data.sender.admin_code,
              frame->data.sender.device_type,
-             frame->data.sender.device_id);
+             frame->data.sender.device_id,
+             client_idx, client->session_count);
     
     // 发送连接应答
-    return send_response(controller, client_idx, OP_SET_RESPONSE, 
-                        OBJ_COMMUNICATION, NULL, 0);
+    return send_response(controller, client_idx, &frame->data.sender,
+                        OP_SET_RESPONSE, OBJ_COMMUNICATION, NULL, 0);
 }
 
 /**
@@ -449,11 +1238,20 @@ int handle_connection_request(signal_controller_t *controller, int client_idx,
  */
 int handle_heartbeat_response(signal_controller_t *controller, int client_idx, 
                              const protocol_frame_t *frame) {
-    // 消除未使用参数警告
-    (void)frame;
+    client_info_t *client = &controller->clients[client_idx];
+    time_t now = time(NULL);
     
-    controller->clients[client_idx].last_heartbeat = time(NULL);
-    LOG_DEBUG("Heartbeat response from client %d", client_idx);
+    client_session_t *session = find_client_session(client, &frame->data.sender);
+    if (!session) {
+        LOG_DEBUG("Heartbeat response from unregistered device ID=%04X on client %d",
+                  frame->data.sender.device_id, client_idx);
+        return -1;
+    }
+    
+    session->last_heartbeat = now;
+    client->last_heartbeat = now;
+    LOG_DEBUG("Heartbeat response from client %d, device ID=%04X",
+              client_idx, frame->data.sender.device_id);
     return 0;
 }
 
@@ -462,14 +1260,28 @@ int handle_heartbeat_response(signal_controller_t *controller, int client_idx,
  */
 int handle_realtime_data(signal_controller_t *controller, int client_idx, 
                         const protocol_frame_t *frame) {
-    // 消除未使用参数警告
-    (void)controller;
-    
     LOG_INFO("Received realtime traffic data from client %d, size: %d bytes",
              client_idx, frame->data.content_len);
     
-    // 这里可以添加数据处理逻辑
-    // 例如：解析交通流数据，存储到数据库等
+    // 按通道追加到列式存储
+    if (controller->realtime_store &&
+        realtime_store_append(controller->realtime_store, &frame->data.sender, frame->data.content,
+                              frame->data.content_len, frame_received_ns(controller)) < 0) {
+        LOG_WARN("Malformed realtime data from client %d, %d bytes",
+                 client_idx, frame->data.content_len);
+    }
+    
+    // 发布为该设备的最新版本
+    if (controller->device_state) {
+        device_state_publish(controller->device_state, &frame->data.sender, frame->data.content,
+                             frame->data.content_len, frame_received_ns(controller));
+    }
+    
+    // 增量更新该设备各通道的预测模型
+    if (controller->forecast) {
+        flow_forecast_update(controller->forecast, &frame->data.sender, frame->data.content,
+                             frame->data.content_len);
+    }
     
     // 实时数据不需要应答
     return 0;
@@ -480,22 +1292,47 @@ int handle_realtime_data(signal_controller_t *controller, int client_idx,
  */
 int handle_statistics_data(signal_controller_t *controller, int client_idx, 
                           const protocol_frame_t *frame) {
+    // 重连补传或重传的统计数据：照常应答让检测器停止重发，但不再处理
+    if (controller->stats_dedup && frame->data.content_len >= 4) {
+        const uint8_t *content = frame->data.content;
+        uint32_t interval_start = content[0] | (content[1] << 8) | (content[2] << 16) |
+                                  ((uint32_t)content[3] << 24);
+        if (stats_dedup_check(controller->stats_dedup, &frame->data.sender, interval_start,
+                              time(NULL)) == 1) {
+            LOG_DEBUG("Duplicate statistics from client %d (interval start %u), acknowledged only",
+                      client_idx, interval_start);
+            return send_response(controller, client_idx, &frame->data.sender,
+                                OP_UPLOAD_RESPONSE, frame->data.object_id, NULL, 0);
+        }
+    }
+    
     LOG_INFO("Received statistics data from client %d, size: %d bytes",
              client_idx, frame->data.content_len);
     
     // 这里可以添加统计数据处理逻辑
     
     // 统计数据需要应答
-    return send_response(controller, client_idx, OP_UPLOAD_RESPONSE, 
-                        frame->data.object_id, NULL, 0);
+    return send_response(controller, client_idx, &frame->data.sender,
+                        OP_UPLOAD_RESPONSE, frame->data.object_id, NULL, 0);
 }
 
 /**
  * @brief 发送心跳查询
  */
 int send_heartbeat_query(signal_controller_t *controller, int client_idx) {
-    return send_response(controller, client_idx, OP_QUERY_REQUEST, 
-                        OBJ_COMMUNICATION, NULL, 0);
+    client_info_t *client = &controller->clients[client_idx];
+    int result = 0;
+    
+    for (int i = 0; i < client_session_slots(client); i++) {
+        client_session_t *session = client_session_at(client, i);
+        if (session->in_use && session->registered) {
+            if (send_response(controller, client_idx, &session->device_id,
+                              OP_QUERY_REQUEST, OBJ_COMMUNICATION, NULL, 0) < 0) {
+                result = -1;
+            }
+        }
+    }
+    return result;
 }
 
 /**
@@ -505,12 +1342,28 @@ void check_heartbeat_timeout(signal_controller_t *controller) {
     time_t current_time = time(NULL);
     
     for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (controller->clients[i].connected) {
-            if (current_time - controller->clients[i].last_heartbeat > HEARTBEAT_TIMEOUT) {
-                LOG_WARN("Client %d heartbeat timeout, disconnecting", i);
-                disconnect_client(controller, i);
+        client_info_t *client = &controller->clients[i];
+        if (!client->connected) {
+            continue;
+        }
+        
+        // 逐个检查逻辑检测器的心跳
+        for (int s = 0; s < client_session_slots(client); s++) {
+            client_session_t *session = client_session_at(client, s);
+            if (session->in_use &&
+                current_time - session->last_heartbeat > HEARTBEAT_TIMEOUT) {
+                LOG_WARN("Client %d device ID=%04X heartbeat timeout, releasing session",
+                         i, session->device_id.device_id);
+                release_client_session(client, session);
             }
         }
+        
+        // 连接上没有存活的逻辑检测器时断开连接
+        if (client->session_count == 0 &&
+            current_time - client->last_heartbeat > HEARTBEAT_TIMEOUT) {
+            LOG_WARN("Client %d heartbeat timeout, disconnecting", i);
+            disconnect_client(controller, i);
+        }
     }
 }
 
@@ -523,10 +1376,26 @@ void disconnect_client(signal_controller_t *controller, int client_idx) {
     }
     
     if (controller->clients[client_idx].connected) {
+        client_info_t *client = &controller->clients[client_idx];
+        
+        // 移除该连接上逻辑检测器的指标
+        for (int i = 0; i < client_session_slots(client); i++) {
+            release_client_session(client, client_session_at(client, i));
+        }
+        if (client->link_stats.degraded) {
+            metrics_gauge_set("traffic_links_degraded", NULL,
+                              metrics_get("traffic_links_degraded", NULL) - 1);
+        }
+        memset(&client->link_stats, 0, sizeof(client->link_stats));
+        
         close(controller->clients[client_idx].sockfd);
         controller->clients[client_idx].sockfd = -1;
         controller->clients[client_idx].connected = 0;
-        controller->clients[client_idx].recv_buffer_len = 0;  // 清空接收缓冲区
+        release_client_stash(controller, &controller->clients[client_idx]);  // 清空残留帧暂存
+        memset(&client->session, 0, sizeof(client->session));
+        free(client->extra_sessions);
+        client->extra_sessions = NULL;
+        client->session_count = 0;
         controller->client_count--;
         
         LOG_INFO("Client %d disconnected, remaining clients: %d", 
@@ -538,17 +1407,21 @@ void disconnect_client(signal_controller_t *controller, int client_idx) {
  * @brief 发送应答消息
  */
 int send_response(signal_controller_t *controller, int client_idx,
-                 uint8_t operation, uint16_t object_id,
+                 const device_id_t *receiver, uint8_t operation, uint16_t object_id,
                  const uint8_t *content, uint16_t content_len) {
     if (client_idx < 0 || client_idx >= MAX_CLIENTS || 
         !controller->clients[client_idx].connected) {
         return -1;
     }
     
+    if (!receiver) {
+        receiver = client_default_peer(&controller->clients[client_idx]);
+    }
+    
     // 创建应答帧
     data_table_t data_table = create_data_table(
         controller->device_id,
-        controller->clients[client_idx].device_id,
+        *receiver,
         operation,
         object_id,
         content,
@@ -7,29 +7,103 @@
 #define SIGNAL_CONTROLLER_H
 
 #include "../common/protocol.h"
+#include "../utils/buffer_pool.h"
+#include "../utils/latency_histogram.h"
+#include "capture_writer.h"
+#include "realtime_store.h"
+#include "device_state.h"
+#include "flow_forecast.h"
+#include "stats_dedup.h"
+#include "freshness.h"
 #include <time.h>
+#include <netinet/in.h>
 
 #define MAX_CLIENTS 64          // 最大客户端连接数
 #define HEARTBEAT_INTERVAL 5    // 心跳间隔(秒)
 #define HEARTBEAT_TIMEOUT 15    // 心跳超时(秒)
 #define DEFAULT_PORT 40000      // 默认端口
-#define CLIENT_RECV_BUFFER_SIZE 4096  // 客户端接收缓冲区大小
+#define CLIENT_RECV_BUFFER_SIZE 4096  // 客户端残留帧暂存的最大长度
+#define RX_BUFFER_SIZE 65536          // 控制机共享接收缓冲区大小
+#define MAX_SESSIONS_PER_CLIENT 32    // 单个连接承载的最大逻辑检测器数
+#define MAX_PENDING_CONNECTIONS 256   // 待注册连接表容量
+#define PENDING_RECV_BUFFER_SIZE 128  // 待注册连接接收缓冲区大小 (容纳连接请求帧)
+#define REGISTRATION_TIMEOUT 3        // 连接注册超时(秒)
+#define CAPTURE_SYNC_INTERVAL 1       // 抓包fdatasync间隔(秒，异步模式)
+#define LATENCY_REPORT_INTERVAL 60    // 接收延迟统计输出间隔(秒)
+#define TCP_INFO_SAMPLE_PERIOD_MS 10000 // 每个连接的TCP_INFO采样周期(毫秒)
+#define TCP_INFO_MAX_BATCH 256        // 单次最多采样的连接数
+#define TCP_DEGRADED_RTT_US 200000    // 平滑RTT超过该值视为链路劣化(微秒)
+#define TCP_DEGRADED_RETRANS 3        // 单个采样周期内新增重传超过该值视为链路劣化
+#define METRICS_DUMP_INTERVAL 10      // 指标文件输出间隔(秒)
+
+/**
+ * @brief 逻辑检测器子会话结构体
+ * 同一TCP连接上按发送方设备标识区分的逻辑检测器，
+ * 各自维护注册状态和心跳状态，共享连接的接收路径和发送通道
+ */
+typedef struct {
+    device_id_t device_id;      // 逻辑检测器设备标识
+    time_t last_heartbeat;      // 最后心跳时间
+    uint8_t in_use;             // 槽位是否占用
+    uint8_t registered;         // 是否已完成连接请求
+} client_session_t;
+
+/**
+ * @brief TCP链路状态结构体 (由TCP_INFO周期采样得到)
+ */
+typedef struct {
+    uint32_t srtt_us;           // 平滑RTT(微秒)
+    uint32_t rttvar_us;         // RTT波动(微秒)
+    uint32_t total_retrans;     // 累计重传段数
+    uint32_t snd_cwnd;          // 拥塞窗口(段)
+    uint32_t unacked_bytes;     // 已发送未确认字节数
+    int send_queue_bytes;       // 发送队列深度(字节)
+    int recv_queue_bytes;       // 接收队列深度(字节)
+    time_t last_sample;         // 最近采样时间
+    uint8_t sampled;            // 是否已有采样
+    uint8_t degraded;           // 链路是否劣化
+} tcp_link_stats_t;
 
 /**
  * @brief 客户端连接信息结构体
  */
 typedef struct {
     int sockfd;                 // socket文件描述符
-    device_id_t device_id;      // 客户端设备标识
-    time_t last_heartbeat;      // 最后心跳时间
+    time_t last_heartbeat;      // 连接最后活动时间
     int connected;              // 连接状态
     char ip_addr[16];           // 客户端IP地址
     
+    // 逻辑检测器子会话 (按发送方设备标识区分)
+    // 绝大多数连接只承载一个检测器：第一个子会话内嵌在连接中，
+    // 同一连接上出现第二个检测器时才从堆上分配其余的MAX_SESSIONS_PER_CLIENT-1个槽位
+    client_session_t session;   // 第0个子会话槽位
+    client_session_t *extra_sessions; // 第1个起的子会话槽位 (NULL表示未分配)
+    int session_count;          // 已注册的逻辑检测器数量
+    
     // TCP粘包处理相关字段
-    uint8_t recv_buffer[CLIENT_RECV_BUFFER_SIZE];  // 接收缓冲区
-    size_t recv_buffer_len;     // 缓冲区当前数据长度
+    // 数据接收到控制机的共享缓冲区中就地处理，只有末尾不完整的帧
+    // 才暂存到从缓冲区池分配的小块中，等待下次接收时拼接
+    uint8_t *stash;             // 残留帧暂存 (无残留时为NULL)
+    uint16_t stash_len;         // 暂存数据长度
+    uint16_t stash_capacity;    // 暂存块大小
+    
+    tcp_link_stats_t link_stats; // TCP链路状态
 } client_info_t;
 
+/**
+ * @brief 待注册连接结构体
+ * 新接入的连接在发送有效的连接请求之前只占用该精简结构，
+ * 收到连接请求后才提升为完整的客户端连接
+ */
+typedef struct {
+    int sockfd;                 // socket文件描述符，-1表示空闲
+    time_t accepted_at;         // 接入时间
+    struct in_addr addr;        // 对端IP地址
+    uint16_t recv_buffer_len;   // 缓冲区当前数据长度
+    uint16_t bytes_received;    // 注册前累计接收字节数
+    uint8_t recv_buffer[PENDING_RECV_BUFFER_SIZE]; // 接收缓冲区
+} pending_conn_t;
+
 /**
  * @brief 信号控制机结构体
  */
@@ -39,6 +113,40 @@ typedef struct {
     int port;                   // 监听端口
     client_info_t clients[MAX_CLIENTS]; // 客户端连接数组
     int client_count;           // 当前客户端数量
+    pending_conn_t pending[MAX_PENDING_CONNECTIONS]; // 待注册连接表
+    int pending_count;          // 当前待注册连接数量
+    uint8_t rx_buffer[RX_BUFFER_SIZE]; // 所有连接共享的接收缓冲区
+    buffer_pool_t stash_pool;   // 残留帧暂存缓冲区池
+    
+    // 内核接收时间戳与延迟统计
+    int rx_timestamps;          // 是否开启内核接收时间戳
+    struct timespec frame_rx_time;   // 当前处理帧的内核接收时间
+    struct timespec frame_read_time; // 当前处理帧读入用户态的时间
+    latency_histogram_t kernel_latency;     // 内核接收 -> 用户态读取
+    latency_histogram_t processing_latency; // 用户态读取 -> 帧处理完成
+    latency_histogram_t end_to_end_latency; // 内核接收 -> 帧处理完成
+    time_t last_latency_report; // 上次输出延迟统计时间
+    
+    // TCP_INFO轮询采样 (每次只采样一小批连接，分散到整个采样周期)
+    long long tcp_info_last_ms; // 上次采样时间(单调时钟毫秒)
+    long long tcp_info_credit;  // 累计采样额度 (毫秒 x 连接槽位数)
+    int tcp_info_cursor;        // 下一个待采样的连接槽位
+    
+    // 数据落地
+    realtime_store_t *realtime_store; // 实时信息列式存储 (NULL表示不存储)
+    device_state_t *device_state; // 各设备最新实时信息多版本表 (NULL表示不维护)
+    time_t last_state_reclaim;  // 上次回收旧版本时间
+    flow_forecast_t *forecast;  // 按通道的短时流量预测 (NULL表示不预测)
+    stats_dedup_t *stats_dedup; // 统计数据去重 (NULL表示不去重)
+    freshness_monitor_t *freshness; // 按设备和数据对象的数据新鲜度监测 (NULL表示不监测)
+    capture_writer_t capture;   // 接收帧抓包 (未打开表示不抓包)
+    async_io_t *io;             // 异步磁盘I/O (NULL表示抓包同步写入)
+    async_io_owner_t io_owner;  // 投递给主循环的I/O完成项
+    time_t last_capture_sync;   // 上次提交抓包fdatasync时间
+    
+    // 指标输出
+    const char *metrics_path;   // 指标文件路径 (NULL表示不输出)
+    time_t last_metrics_dump;   // 上次输出指标时间
     int running;                // 运行状态标志
     time_t last_heartbeat_check; // 上次心跳检查时间
 } signal_controller_t;
@@ -61,6 +169,99 @@ int signal_controller_init(signal_controller_t *controller,
  */
 int signal_controller_start(signal_controller_t *controller);
 
+/**
+ * @brief 开启或关闭内核接收时间戳
+ * 开启后每个接收到的帧都带有内核接收时间，用于区分内核到用户态的
+ * 排队延迟和帧处理延迟，需在signal_controller_start之前调用
+ * @param controller 控制机指针
+ * @param enable 1开启，0关闭
+ */
+void signal_controller_enable_rx_timestamps(signal_controller_t *controller, int enable);
+
+/**
+ * @brief 输出并清空接收延迟直方图
+ * @param controller 控制机指针
+ */
+void signal_controller_report_latency(signal_controller_t *controller);
+
+/**
+ * @brief 设置指标文件路径，控制机定期将运行指标写入该文件
+ * @param controller 控制机指针
+ * @param path 文件路径，NULL表示不输出
+ */
+void signal_controller_set_metrics_file(signal_controller_t *controller, const char *path);
+
+/**
+ * @brief 设置实时信息列式存储，收到的实时信息按通道追加到存储中
+ * @param controller 控制机指针
+ * @param store 存储指针，NULL表示不存储 (存储的生命周期由调用方管理)
+ */
+void signal_controller_set_realtime_store(signal_controller_t *controller, realtime_store_t *store);
+
+/**
+ * @brief 设置设备状态表，收到的实时信息作为该设备的新版本发布，供跨设备一致快照读取
+ * 控制机主循环是唯一的写入方，并每秒回收一次读者不再需要的旧版本
+ * @param controller 控制机指针
+ * @param state 状态表指针，NULL表示不维护 (生命周期由调用方管理)
+ */
+void signal_controller_set_device_state(signal_controller_t *controller, device_state_t *state);
+
+/**
+ * @brief 设置流量预测器，收到的实时信息在控制机主循环中增量更新对应设备的通道模型
+ * @param controller 控制机指针
+ * @param forecast 预测器指针，NULL表示不预测 (生命周期由调用方管理)
+ */
+void signal_controller_set_forecast(signal_controller_t *controller, flow_forecast_t *forecast);
+
+/**
+ * @brief 设置统计数据去重器，同一设备同一统计起始时间的重复上传照常应答但不再处理
+ * @param controller 控制机指针
+ * @param dedup 去重器指针，NULL表示不去重 (生命周期由调用方管理)
+ */
+void signal_controller_set_stats_dedup(signal_controller_t *controller, stats_dedup_t *dedup);
+
+/**
+ * @brief 设置数据新鲜度监测器，每个上传帧记录一次到达，主循环中处理过期
+ * 同时订阅其事件，按设备维护过期数据流数指标
+ * @param controller 控制机指针
+ * @param monitor 监测器指针，NULL表示不监测 (生命周期由调用方管理)
+ * @return 0成功，-1订阅失败
+ */
+int signal_controller_set_freshness(signal_controller_t *controller, freshness_monitor_t *monitor);
+
+/**
+ * @brief 设置异步磁盘I/O，之后开启的抓包经其异步写入，主循环每秒提交一次fdatasync
+ * 完成项投递到主循环并在select中等待其eventfd，需在signal_controller_set_capture_file之前调用
+ * @param controller 控制机指针
+ * @param io 异步I/O实例 (生命周期由调用方管理，须晚于signal_controller_stop销毁)
+ * @return 0成功，-1失败
+ */
+int signal_controller_set_async_io(signal_controller_t *controller, async_io_t *io);
+
+/**
+ * @brief 开启接收帧抓包，每个收到的完整帧连同接收时间写入抓包文件
+ * @param controller 控制机指针
+ * @param path 抓包文件路径
+ * @return 0成功，-1失败
+ */
+int signal_controller_set_capture_file(signal_controller_t *controller, const char *path);
+
+/**
+ * @brief 按轮询方式采样一批连接的TCP_INFO
+ * 每次调用根据距上次调用的时间采样相应数量的连接，
+ * 使每个连接在TCP_INFO_SAMPLE_PERIOD_MS内被采样一次
+ * @param controller 控制机指针
+ */
+void sample_tcp_link_stats(signal_controller_t *controller);
+
+/**
+ * @brief 采样单个连接的TCP_INFO并更新链路指标
+ * @param controller 控制机指针
+ * @param client_idx 客户端索引
+ * @return 0成功，-1失败
+ */
+int sample_client_tcp_info(signal_controller_t *controller, int client_idx);
+
 /**
  * @brief 停止信号控制机服务
  * @param controller 控制机指针
@@ -74,6 +275,22 @@ void signal_controller_stop(signal_controller_t *controller);
  */
 int handle_new_connection(signal_controller_t *controller);
 
+/**
+ * @brief 处理待注册连接的消息
+ * 收到有效的连接请求时将连接提升为完整的客户端连接，
+ * 收到其他数据或缓冲区溢出时关闭连接
+ * @param controller 控制机指针
+ * @param pending_idx 待注册连接索引
+ * @return 提升后的客户端索引，仍在等待返回-1，连接被关闭返回-2
+ */
+int handle_pending_message(signal_controller_t *controller, int pending_idx);
+
+/**
+ * @brief 关闭超过注册时限的待注册连接
+ * @param controller 控制机指针
+ */
+void expire_pending_connections(signal_controller_t *controller);
+
 /**
  * @brief 处理客户端消息
  * @param controller 控制机指针
@@ -95,6 +312,8 @@ int extract_complete_frame(uint8_t *buffer, size_t *buffer_len,
 
 /**
  * @brief 处理单个协议帧
+ * 上传类数据帧的发送方必须是本连接上已注册的逻辑检测器，否则回复出错应答 (链路地址错误)
+ * 并丢弃；接受的上传同时刷新该逻辑检测器的存活时间
  * @param controller 控制机指针
  * @param client_idx 客户端索引
  * @param frame_data 帧数据
@@ -105,7 +324,15 @@ int process_single_frame(signal_controller_t *controller, int client_idx,
                         const uint8_t *frame_data, size_t frame_len);
 
 /**
- * @brief 发送心跳查询
+ * @brief 按设备标识查找连接上的逻辑检测器子会话
+ * @param client 客户端连接信息
+ * @param device_id 逻辑检测器设备标识
+ * @return 子会话指针，未找到返回NULL
+ */
+client_session_t *find_client_session(client_info_t *client, const device_id_t *device_id);
+
+/**
+ * @brief 发送心跳查询 (向连接上每个已注册的逻辑检测器发送)
  * @param controller 控制机指针
  * @param client_idx 客户端索引
  * @return 0成功，-1失败
@@ -169,6 +396,7 @@ int handle_statistics_data(signal_controller_t *controller, int client_idx,
  * @brief 发送应答消息
  * @param controller 控制机指针
  * @param client_idx 客户端索引
+ * @param receiver 接收方逻辑检测器标识
  * @param operation 操作类型
  * @param object_id 对象标识
  * @param content 消息内容
@@ -176,7 +404,7 @@ int handle_statistics_data(signal_controller_t *controller, int client_idx,
  * @return 0成功，-1失败
  */
 int send_response(signal_controller_t *controller, int client_idx,
-                 uint8_t operation, uint16_t object_id,
+                 const device_id_t *receiver, uint8_t operation, uint16_t object_id,
                  const uint8_t *content, uint16_t content_len);
 
 #endif // SIGNAL_CONTROLLER_H
\ No newline at end of file
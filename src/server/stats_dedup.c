@@ -0,0 +1,275 @@
+/**
+ * @file stats_dedup.c
+ * @brief 统计数据上传的幂等去重实现
+ */
+
+#include "stats_dedup.h"
+#include "../utils/logger.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SECONDS_PER_HOUR 3600
+
+/**
+ * @brief 64位混合函数
+ */
+static inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/**
+ * @brief 去重键哈希
+ */
+static inline uint64_t key_hash(const stats_key_t *key) {
+    return mix64(key->device ^ ((uint64_t)key->interval_start * 0x9E3779B97F4A7C15ULL));
+}
+
+/**
+ * @brief 由哈希取指纹 (0保留为空槽位)
+ */
+static inline uint16_t fingerprint_of(uint64_t hash) {
+    uint16_t fp = (uint16_t)(hash >> 48);
+    return fp ? fp : 1;
+}
+
+/**
+ * @brief 指纹的另一个候选桶 (异或运算，两个候选桶互为对方)
+ */
+static inline size_t alt_bucket(size_t bucket, uint16_t fp, size_t mask) {
+    return (bucket ^ (size_t)mix64(fp)) & mask;
+}
+
+/**
+ * @brief 桶内是否有该指纹
+ */
+static inline int bucket_has(const uint16_t *fingerprints, size_t bucket, uint16_t fp) {
+    const uint16_t *slots = &fingerprints[bucket * STATS_DEDUP_SLOTS_PER_BUCKET];
+    return (slots[0] == fp) | (slots[1] == fp) | (slots[2] == fp) | (slots[3] == fp);
+}
+
+/**
+ * @brief 向桶中空槽位放入指纹
+ * @return 1成功，0桶已满
+ */
+static inline int bucket_put(uint16_t *fingerprints, size_t bucket, uint16_t fp) {
+    uint16_t *slots = &fingerprints[bucket * STATS_DEDUP_SLOTS_PER_BUCKET];
+    for (int i = 0; i < STATS_DEDUP_SLOTS_PER_BUCKET; i++) {
+        if (slots[i] == 0) {
+            slots[i] = fp;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 向过滤器插入指纹，失败时撤销途中的踢出，过滤器保持原样
+ * @return 0成功，-1过滤器已满
+ */
+static int filter_insert(stats_filter_t *filter, uint64_t hash) {
+    uint16_t *fingerprints = filter->fingerprints;
+    size_t mask = filter->bucket_mask;
+    uint16_t fp = fingerprint_of(hash);
+    size_t i1 = (size_t)hash & mask;
+    size_t i2 = alt_bucket(i1, fp, mask);
+
+    if (bucket_put(fingerprints, i1, fp) || bucket_put(fingerprints, i2, fp)) {
+        return 0;
+    }
+
+    // 两个候选桶都满：踢出一个指纹到它的另一个候选桶，依次类推
+    uint16_t *path[STATS_DEDUP_MAX_KICKS];
+    uint16_t victims[STATS_DEDUP_MAX_KICKS];
+    size_t bucket = (hash >> 32) & 1 ? i2 : i1;
+    for (int kick = 0; kick < STATS_DEDUP_MAX_KICKS; kick++) {
+        uint16_t *slot = &fingerprints[bucket * STATS_DEDUP_SLOTS_PER_BUCKET +
+                                       (size_t)(kick + (hash >> 40)) % STATS_DEDUP_SLOTS_PER_BUCKET];
+        path[kick] = slot;
+        victims[kick] = *slot;
+        *slot = fp;
+        fp = victims[kick];
+        bucket = alt_bucket(bucket, fp, mask);
+        if (bucket_put(fingerprints, bucket, fp)) {
+            return 0;
+        }
+    }
+
+    // 没有键记录无法重建，按相反顺序放回被踢出的指纹
+    for (int kick = STATS_DEDUP_MAX_KICKS - 1; kick >= 0; kick--) {
+        *path[kick] = victims[kick];
+    }
+    return -1;
+}
+
+/**
+ * @brief 过滤器中是否有该哈希的指纹
+ */
+static inline int filter_contains(const stats_filter_t *filter, uint64_t hash) {
+    uint16_t fp = fingerprint_of(hash);
+    size_t i1 = (size_t)hash & filter->bucket_mask;
+    size_t i2 = alt_bucket(i1, fp, filter->bucket_mask);
+    return bucket_has(filter->fingerprints, i1, fp) | bucket_has(filter->fingerprints, i2, fp);
+}
+
+/**
+ * @brief 取小时桶的第index个过滤器，未分配时按初始容量的2^index倍分配
+ * @return 过滤器指针，内存不足返回NULL
+ */
+static stats_filter_t *hour_filter(stats_hour_t *hour, int index) {
+    stats_filter_t *filter = &hour->filters[index];
+    if (!filter->fingerprints) {
+        size_t buckets = (size_t)STATS_DEDUP_INITIAL_BUCKETS << index;
+        filter->fingerprints = calloc(buckets * STATS_DEDUP_SLOTS_PER_BUCKET, sizeof(uint16_t));
+        if (!filter->fingerprints) {
+            return NULL;
+        }
+        filter->bucket_mask = buckets - 1;
+    }
+    return filter;
+}
+
+/**
+ * @brief 清空一个小时桶 (保留已分配的过滤器)
+ */
+static void hour_reset(stats_hour_t *hour, int64_t hour_index) {
+    hour->hour = hour_index;
+    for (int i = 0; i < STATS_DEDUP_MAX_FILTERS && hour->filters[i].fingerprints; i++) {
+        memset(hour->filters[i].fingerprints, 0,
+               (hour->filters[i].bucket_mask + 1) * STATS_DEDUP_SLOTS_PER_BUCKET * sizeof(uint16_t));
+    }
+    hour->filter_count = 0;
+}
+
+/**
+ * @brief 初始化去重器
+ */
+int stats_dedup_init(stats_dedup_t *dedup) {
+    if (!dedup) {
+        return -1;
+    }
+
+    memset(dedup, 0, sizeof(stats_dedup_t));
+    for (int i = 0; i < STATS_DEDUP_WINDOW_HOURS; i++) {
+        dedup->hours[i].hour = -1;
+    }
+    dedup->newest_hour = -1;
+    return 0;
+}
+
+/**
+ * @brief 销毁去重器
+ */
+void stats_dedup_destroy(stats_dedup_t *dedup) {
+    if (!dedup) {
+        return;
+    }
+
+    for (int i = 0; i < STATS_DEDUP_WINDOW_HOURS; i++) {
+        for (int j = 0; j < STATS_DEDUP_MAX_FILTERS; j++) {
+            free(dedup->hours[i].filters[j].fingerprints);
+            dedup->hours[i].filters[j].fingerprints = NULL;
+        }
+        dedup->hours[i].filter_count = 0;
+        dedup->hours[i].hour = -1;
+    }
+}
+
+/**
+ * @brief 设置外部精确核对
+ */
+void stats_dedup_set_verifier(stats_dedup_t *dedup, stats_verify_fn verify, void *ctx) {
+    if (!dedup) {
+        return;
+    }
+    dedup->verify = verify;
+    dedup->verify_ctx = ctx;
+}
+
+/**
+ * @brief 判定一条统计数据是否重复
+ */
+int stats_dedup_check(stats_dedup_t *dedup, const device_id_t *device, uint32_t interval_start,
+                      time_t now) {
+    if (!dedup || !device) {
+        return -1;
+    }
+
+    // 时钟错误或内容损坏的未来时间不能推进窗口，否则之后正常的数据都会落到窗口之外
+    if ((int64_t)interval_start > (int64_t)now + STATS_DEDUP_MAX_SKEW) {
+        dedup->future++;
+        dedup->accepted++;
+        return 0;
+    }
+
+    int64_t hour_index = interval_start / SECONDS_PER_HOUR;
+    if (dedup->newest_hour >= 0 && hour_index <= dedup->newest_hour - STATS_DEDUP_WINDOW_HOURS) {
+        // 对应小时桶已丢弃，无法判定；宁可重复接收也不丢数据
+        dedup->too_old++;
+        dedup->accepted++;
+        return 0;
+    }
+    if (hour_index > dedup->newest_hour) {
+        dedup->newest_hour = hour_index;
+    }
+
+    // 同一槽位上的旧小时必然已超出窗口，整桶清空复用
+    stats_hour_t *hour = &dedup->hours[hour_index % STATS_DEDUP_WINDOW_HOURS];
+    if (hour->hour != hour_index) {
+        hour_reset(hour, hour_index);
+    }
+    if (hour->filter_count == 0) {
+        if (!hour_filter(hour, 0)) {
+            dedup->accepted++;
+            return -1;
+        }
+        hour->filter_count = 1;
+    }
+
+    stats_key_t key;
+    key.device = ((uint64_t)device->admin_code << 32) |
+                 ((uint64_t)device->device_type << 16) | device->device_id;
+    key.interval_start = interval_start;
+    uint64_t hash = key_hash(&key);
+
+    int filter_hit = 0;
+    for (int i = 0; i < hour->filter_count && !filter_hit; i++) {
+        filter_hit = filter_contains(&hour->filters[i], hash);
+    }
+    if (filter_hit) {
+        // 只有过滤器命中时才做精确核对；没有核对回调时按重复处理
+        dedup->filter_hits++;
+        if (!dedup->verify || dedup->verify(dedup->verify_ctx, &key)) {
+            dedup->duplicates++;
+            return 1;
+        }
+        // 误判时过滤器中已有相同指纹，不必再插入
+        dedup->false_positives++;
+        dedup->accepted++;
+        return 0;
+    }
+
+    dedup->accepted++;
+    if (filter_insert(&hour->filters[hour->filter_count - 1], hash) == 0) {
+        return 0;
+    }
+
+    // 当前过滤器已满：追加一个两倍容量的过滤器，查找时依次检查
+    if (hour->filter_count == STATS_DEDUP_MAX_FILTERS) {
+        LOG_WARN("Statistics dedup filters full for hour %lld, not recorded", (long long)hour_index);
+        return -1;
+    }
+    stats_filter_t *filter = hour_filter(hour, hour->filter_count);
+    if (!filter) {
+        LOG_WARN("Statistics dedup out of memory, hour %lld not recorded", (long long)hour_index);
+        return -1;
+    }
+    hour->filter_count++;
+    dedup->expansions++;
+    filter_insert(filter, hash);
+    return 0;
+}
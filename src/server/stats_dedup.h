@@ -0,0 +1,121 @@
+/**
+ * @file stats_dedup.h
+ * @brief 统计数据上传的幂等去重
+ *
+ * 检测器重连后补传积压数据、或未收到应答而重传时，同一设备同一统计起始时间的
+ * 统计数据会重复到达。按统计起始时间所在的小时分桶，每桶一组布谷鸟过滤器
+ * (每个槽位16位指纹)，绝大多数新数据在过滤器上未命中，O(1)判定为新数据；
+ * 命中时交给核对回调 (例如查询持久化存储) 精确核对，没有回调时按重复处理，
+ * 误判率约为每个过滤器万分之一。不保存键本身，过滤器装满时追加一个两倍容量的过滤器。
+ * 超出保留窗口的旧桶整体丢弃；起始时间超前当前时间太多的数据不推进窗口，也不记录。
+ * 只在控制机主循环中调用，不加锁。
+ */
+
+#ifndef STATS_DEDUP_H
+#define STATS_DEDUP_H
+
+#include "../common/protocol.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define STATS_DEDUP_WINDOW_HOURS 48         // 保留的小时桶数
+#define STATS_DEDUP_INITIAL_BUCKETS 1024    // 每个小时桶过滤器的初始桶数 (每桶4个指纹)
+#define STATS_DEDUP_SLOTS_PER_BUCKET 4      // 每个过滤器桶的指纹数
+#define STATS_DEDUP_MAX_KICKS 500           // 插入时最多踢出次数
+#define STATS_DEDUP_MAX_FILTERS 8           // 每个小时桶最多的过滤器数 (容量依次翻倍)
+#define STATS_DEDUP_MAX_SKEW 600            // 起始时间允许超前当前时间的秒数
+
+/**
+ * @brief 去重键：设备和统计起始时间
+ */
+typedef struct {
+    uint64_t device;            // 设备标识 (行政区划代码、设备类型、设备编号拼接)
+    uint32_t interval_start;    // 统计起始时间(Unix秒)
+} stats_key_t;
+
+/**
+ * @brief 精确核对回调
+ * @param ctx 调用方上下文
+ * @param key 去重键
+ * @return 1已存在，0不存在
+ */
+typedef int (*stats_verify_fn)(void *ctx, const stats_key_t *key);
+
+/**
+ * @brief 一个布谷鸟过滤器
+ */
+typedef struct {
+    uint16_t *fingerprints;     // 指纹 (0表示空槽位)，NULL表示未分配
+    size_t bucket_mask;         // 过滤器桶数 - 1
+} stats_filter_t;
+
+/**
+ * @brief 一个小时桶
+ */
+typedef struct {
+    int64_t hour;               // 起始时间所在小时 (Unix秒/3600)，-1表示空桶
+    stats_filter_t filters[STATS_DEDUP_MAX_FILTERS]; // 过滤器 (第i个容量为初始的2^i倍)
+    int filter_count;           // 本小时使用中的过滤器数 (换小时后保留已分配的内存)
+} stats_hour_t;
+
+/**
+ * @brief 去重器
+ */
+typedef struct {
+    stats_hour_t hours[STATS_DEDUP_WINDOW_HOURS]; // 小时桶 (按小时取模)
+    int64_t newest_hour;        // 已见过的最新小时
+    stats_verify_fn verify;     // 精确核对 (NULL表示过滤器命中即按重复处理)
+    void *verify_ctx;           // 核对回调上下文
+
+    uint64_t accepted;          // 判定为新数据的次数
+    uint64_t duplicates;        // 判定为重复的次数
+    uint64_t filter_hits;       // 过滤器命中次数 (需精确核对)
+    uint64_t false_positives;   // 过滤器命中但核对为新数据的次数 (仅设置核对回调时)
+    uint64_t too_old;           // 超出保留窗口、无法判定而按新数据接收的次数
+    uint64_t future;            // 起始时间超前太多、不记录而按新数据接收的次数
+    uint64_t expansions;        // 追加过滤器的次数
+} stats_dedup_t;
+
+/**
+ * @brief 初始化去重器
+ * @param dedup 去重器指针
+ * @return 0成功，-1失败
+ */
+int stats_dedup_init(stats_dedup_t *dedup);
+
+/**
+ * @brief 销毁去重器
+ * @param dedup 去重器指针
+ */
+void stats_dedup_destroy(stats_dedup_t *dedup);
+
+/**
+ * @brief 设置精确核对 (例如查询持久化的统计数据)
+ * 过滤器命中时以回调结果为准，排除过滤器误判
+ * @param dedup 去重器指针
+ * @param verify 核对回调，NULL表示命中即按重复处理
+ * @param ctx 回调上下文
+ */
+void stats_dedup_set_verifier(stats_dedup_t *dedup, stats_verify_fn verify, void *ctx);
+
+/**
+ * @brief 判定一条统计数据是否重复，新数据同时记录
+ * @param dedup 去重器指针
+ * @param device 设备标识
+ * @param interval_start 统计起始时间(Unix秒)
+ * @param now 当前时间(Unix秒)，起始时间超前超过STATS_DEDUP_MAX_SKEW时不记录
+ * @return 1重复，0新数据，-1内存不足或过滤器已满 (按新数据处理)
+ */
+int stats_dedup_check(stats_dedup_t *dedup, const device_id_t *device, uint32_t interval_start,
+                      time_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATS_DEDUP_H
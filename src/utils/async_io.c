@@ -0,0 +1,791 @@
+/**
+ * @file async_io.c
+ * @brief 磁盘读写和fsync的异步执行实现
+ *
+ * io_uring通过系统调用直接使用 (不依赖liburing)：提交队列、完成队列和提交项数组
+ * 由内核分配并映射到用户态。I/O线程始终保留一个读eventfd的请求在内核中，
+ * 因此只需在io_uring_enter中等待至少一个完成项，既能收到I/O完成也能被新请求唤醒。
+ */
+
+#include "async_io.h"
+#include "logger.h"
+#include "metrics.h"
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define WAKE_USER_DATA UINT64_MAX           // 读eventfd请求的user_data
+#define OWNER_DEFAULT_CAPACITY 1024         // 所有者完成队列的默认容量
+#define MAX_REQUEST_BYTES (1U << 30)        // 单个提交项的最大字节数 (更长的请求分多次执行)
+#define BUFFER_ALIGN 4096                   // 固定缓冲区对齐
+
+/**
+ * @brief io_uring状态
+ */
+typedef struct {
+    int fd;                     // io_uring文件描述符
+    unsigned *sq_tail;          // 提交队列尾 (用户态写)
+    unsigned sq_mask;           // 提交队列掩码
+    unsigned *sq_array;         // 提交队列 (提交项下标)
+    struct io_uring_sqe *sqes;  // 提交项数组
+    unsigned *cq_head;          // 完成队列头 (用户态写)
+    unsigned *cq_tail;          // 完成队列尾 (内核写)
+    unsigned cq_mask;           // 完成队列掩码
+    struct io_uring_cqe *cqes;  // 完成项数组
+    void *sq_map;               // 提交队列映射
+    size_t sq_map_size;         // 提交队列映射大小
+    void *cq_map;               // 完成队列映射 (单次映射时与sq_map相同)
+    size_t cq_map_size;         // 完成队列映射大小
+    size_t sqes_size;           // 提交项数组映射大小
+    int registered;             // 固定缓冲区是否已注册
+    unsigned to_submit;         // 已填写尚未提交的提交项数
+
+    async_io_request_t *slots;  // 在途请求 (user_data为下标)
+    size_t *done_bytes;         // 各在途请求已完成的字节数
+    uint32_t *free_slots;       // 空闲下标栈
+    size_t free_count;          // 空闲下标数
+    uint64_t wake_value;        // 读eventfd的缓冲区
+    int wake_armed;             // 读eventfd的请求是否在内核中
+} uring_t;
+
+/**
+ * @brief io_uring_setup系统调用
+ */
+static inline int sys_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+/**
+ * @brief io_uring_enter系统调用
+ */
+static inline int sys_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/**
+ * @brief 唤醒I/O线程
+ */
+static void wake_io_thread(async_io_t *io) {
+    uint64_t one = 1;
+    if (write(io->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        LOG_WARN("Failed to wake I/O thread: %s", strerror(errno));
+    }
+}
+
+/**
+ * @brief 在调用线程中同步执行请求
+ * @return 读写的字节数或0，失败时为负的errno
+ */
+static int64_t execute_request(const async_io_request_t *request) {
+    uint8_t *buf = (uint8_t *)request->buf;
+    size_t done = 0;
+
+    switch (request->op) {
+        case ASYNC_IO_FSYNC:
+            return fdatasync(request->fd) == 0 ? 0 : -errno;
+        case ASYNC_IO_WRITE:
+            while (done < request->len) {
+                ssize_t n = pwrite(request->fd, buf + done, request->len - done, (off_t)(request->offset + done));
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -errno;
+                }
+                done += (size_t)n;
+            }
+            return (int64_t)done;
+        case ASYNC_IO_READ:
+            while (done < request->len) {
+                ssize_t n = pread(request->fd, buf + done, request->len - done, (off_t)(request->offset + done));
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return -errno;
+                }
+                if (n == 0) {
+                    break;
+                }
+                done += (size_t)n;
+            }
+            return (int64_t)done;
+    }
+    return -EINVAL;
+}
+
+/**
+ * @brief 投递完成结果：有所有者时写入其完成队列并通知，否则直接回调
+ */
+static void complete_request(async_io_t *io, const async_io_request_t *request, int64_t result) {
+    __atomic_add_fetch(&io->completed, 1, __ATOMIC_RELAXED);
+    if (result < 0) {
+        __atomic_add_fetch(&io->failed, 1, __ATOMIC_RELAXED);
+    }
+
+    async_io_owner_t *owner = request->owner;
+    if (!owner) {
+        if (request->callback) {
+            request->callback(request->ctx, request, result);
+        }
+        return;
+    }
+
+    // 完成队列满时等待所有者取出 (完成项中可能带有需要归还的缓冲区，不能丢弃)
+    uint64_t ticket;
+    async_io_completion_t *completion;
+    while ((completion = mpsc_queue_claim(&owner->completions, &ticket)) == NULL) {
+        sched_yield();
+    }
+    completion->request = *request;
+    completion->result = result;
+    mpsc_queue_publish(&owner->completions, ticket);
+
+    if (!__atomic_exchange_n(&owner->notified, 1, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        if (write(owner->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_WARN("Failed to notify I/O owner: %s", strerror(errno));
+        }
+    }
+}
+
+/**
+ * @brief 线程后端：依次执行请求，空闲时在eventfd上等待
+ */
+static void *thread_backend_main(void *arg) {
+    async_io_t *io = (async_io_t *)arg;
+
+    for (;;) {
+        async_io_request_t *slot = mpsc_queue_peek(&io->submissions);
+        if (slot) {
+            async_io_request_t request = *slot;
+            mpsc_queue_release(&io->submissions);
+            __atomic_add_fetch(&io->batches, 1, __ATOMIC_RELAXED);
+            complete_request(io, &request, execute_request(&request));
+            continue;
+        }
+        if (!__atomic_load_n(&io->running, __ATOMIC_SEQ_CST)) {
+            // 已通过运行检查的提交方可能仍在发布，等它们离开并取完队列后再退出
+            if (__atomic_load_n(&io->submitters, __ATOMIC_SEQ_CST) > 0) {
+                sched_yield();
+                continue;
+            }
+            if (mpsc_queue_peek(&io->submissions) == NULL) {
+                break;
+            }
+            continue;
+        }
+
+        // 先声明进入等待再复查队列，与提交方的"发布后检查标志"配对，不会丢失唤醒
+        __atomic_store_n(&io->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (mpsc_queue_peek(&io->submissions) == NULL && __atomic_load_n(&io->running, __ATOMIC_ACQUIRE)) {
+            struct pollfd pfd = { .fd = io->wake_fd, .events = POLLIN };
+            if (poll(&pfd, 1, 1000) > 0) {
+                uint64_t value;
+                if (read(io->wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                    LOG_WARN("Failed to read I/O eventfd: %s", strerror(errno));
+                }
+            }
+        }
+        __atomic_store_n(&io->sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+    return NULL;
+}
+
+/**
+ * @brief 取下一个提交项
+ */
+static struct io_uring_sqe *next_sqe(uring_t *ring) {
+    unsigned index = *ring->sq_tail & ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    return sqe;
+}
+
+/**
+ * @brief 发布已填写的提交项 (在下次io_uring_enter时提交)
+ */
+static void publish_sqe(uring_t *ring) {
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+    ring->to_submit++;
+}
+
+/**
+ * @brief 填写在途请求 (从已完成的字节之后继续)
+ */
+static void prepare_request(uring_t *ring, uint32_t slot) {
+    const async_io_request_t *request = &ring->slots[slot];
+    size_t done = ring->done_bytes[slot];
+    struct io_uring_sqe *sqe = next_sqe(ring);
+
+    sqe->fd = request->fd;
+    sqe->user_data = slot;
+    if (request->op == ASYNC_IO_FSYNC) {
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    } else {
+        int fixed = ring->registered && request->buffer_index >= 0;
+        size_t len = request->len - done;
+        if (request->op == ASYNC_IO_WRITE) {
+            sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        } else {
+            sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        }
+        sqe->addr = (uint64_t)(uintptr_t)((uint8_t *)request->buf + done);
+        sqe->len = len > MAX_REQUEST_BYTES ? MAX_REQUEST_BYTES : (unsigned)len;
+        sqe->off = request->offset + done;
+        if (fixed) {
+            sqe->buf_index = (uint16_t)request->buffer_index;
+        }
+    }
+    publish_sqe(ring);
+}
+
+/**
+ * @brief 处理一个完成项
+ */
+static void handle_cqe(async_io_t *io, uring_t *ring, uint64_t user_data, int res) {
+    if (user_data == WAKE_USER_DATA) {
+        ring->wake_armed = 0;
+        return;
+    }
+
+    uint32_t slot = (uint32_t)user_data;
+    async_io_request_t *request = &ring->slots[slot];
+    int64_t result = res;
+    if (res >= 0 && request->op != ASYNC_IO_FSYNC) {
+        ring->done_bytes[slot] += (size_t)res;
+        // 短写和超过单个提交项上限的请求继续执行剩余部分，读到文件末尾时结束
+        if (res > 0 && ring->done_bytes[slot] < request->len) {
+            prepare_request(ring, slot);
+            return;
+        }
+        result = (int64_t)ring->done_bytes[slot];
+        if (request->op == ASYNC_IO_WRITE && ring->done_bytes[slot] < request->len) {
+            result = -EIO;
+        }
+    }
+
+    ring->free_slots[ring->free_count++] = slot;
+    __atomic_sub_fetch(&io->in_flight, 1, __ATOMIC_RELAXED);
+    complete_request(io, request, result);
+}
+
+/**
+ * @brief io_uring后端：批量填写提交项，一次系统调用提交并等待完成
+ */
+static void *uring_backend_main(void *arg) {
+    async_io_t *io = (async_io_t *)arg;
+    uring_t *ring = (uring_t *)io->ring;
+
+    for (;;) {
+        if (!ring->wake_armed) {
+            struct io_uring_sqe *sqe = next_sqe(ring);
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = io->wake_fd;
+            sqe->addr = (uint64_t)(uintptr_t)&ring->wake_value;
+            sqe->len = sizeof(ring->wake_value);
+            sqe->off = (uint64_t)-1;
+            sqe->user_data = WAKE_USER_DATA;
+            publish_sqe(ring);
+            ring->wake_armed = 1;
+        }
+
+        // 取出待执行的请求，填满空闲的在途槽位
+        // 要求排空的请求等在途请求全部完成后再取 (不用IOSQE_IO_DRAIN，它还会等待常驻的读eventfd请求)
+        uint64_t batch = 0;
+        int blocked = 0;
+        async_io_request_t *pending;
+        while (ring->free_count > 0 && (pending = mpsc_queue_peek(&io->submissions)) != NULL) {
+            if (pending->drain && (batch > 0 || __atomic_load_n(&io->in_flight, __ATOMIC_RELAXED) > 0)) {
+                blocked = 1;
+                break;
+            }
+            uint32_t slot = ring->free_slots[--ring->free_count];
+            ring->slots[slot] = *pending;
+            ring->done_bytes[slot] = 0;
+            mpsc_queue_release(&io->submissions);
+            prepare_request(ring, slot);
+            batch++;
+        }
+        if (batch > 0) {
+            __atomic_add_fetch(&io->in_flight, batch, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&io->batches, 1, __ATOMIC_RELAXED);
+            if (batch > io->max_batch) {
+                __atomic_store_n(&io->max_batch, batch, __ATOMIC_RELAXED);
+            }
+        }
+
+        if (!__atomic_load_n(&io->running, __ATOMIC_SEQ_CST) &&
+            __atomic_load_n(&io->in_flight, __ATOMIC_RELAXED) == 0 &&
+            mpsc_queue_peek(&io->submissions) == NULL) {
+            // 已通过运行检查的提交方可能仍在发布，不阻塞等待，等它们离开后再复查队列
+            if (__atomic_load_n(&io->submitters, __ATOMIC_SEQ_CST) == 0 &&
+                mpsc_queue_peek(&io->submissions) == NULL) {
+                break;
+            }
+            sched_yield();
+            continue;
+        }
+
+        // 有可立即取出的请求时只提交不等待，否则等待至少一个完成项 (I/O完成或被唤醒)
+        __atomic_store_n(&io->sleeping, 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        int ready = !blocked && ring->free_count > 0 && mpsc_queue_peek(&io->submissions) != NULL;
+        unsigned min_complete = ready ? 0 : 1;
+        int submitted = sys_uring_enter(ring->fd, ring->to_submit, min_complete, IORING_ENTER_GETEVENTS);
+        __atomic_store_n(&io->sleeping, 0, __ATOMIC_SEQ_CST);
+        if (submitted >= 0) {
+            ring->to_submit -= (unsigned)submitted;
+        } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOG_ERROR("io_uring_enter failed: %s", strerror(errno));
+            sched_yield();
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+            uint64_t user_data = cqe->user_data;
+            int res = cqe->res;
+            head++;
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+            handle_cqe(io, ring, user_data, res);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 释放io_uring状态
+ */
+static void uring_destroy(uring_t *ring) {
+    if (!ring) {
+        return;
+    }
+    if (ring->sqes && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map && ring->sq_map != MAP_FAILED) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    free(ring->slots);
+    free(ring->done_bytes);
+    free(ring->free_slots);
+    free(ring);
+}
+
+/**
+ * @brief 内核是否支持用到的全部操作码
+ * 读eventfd和非固定缓冲区的读写需要IORING_OP_READ/WRITE (5.6起)，更早的内核上
+ * io_uring_setup能成功，但常驻的读eventfd请求会立即以-EINVAL完成
+ * @return 1支持，0不支持 (含不支持IORING_REGISTER_PROBE的内核)
+ */
+static int uring_supports_ops(int fd) {
+    static const uint8_t needed[] = {
+        IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC
+    };
+    size_t ops = 256;
+    struct io_uring_probe *probe = calloc(1, sizeof(*probe) + ops * sizeof(struct io_uring_probe_op));
+    if (!probe) {
+        return 0;
+    }
+
+    int supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, (unsigned)ops) == 0;
+    for (size_t i = 0; supported && i < sizeof(needed); i++) {
+        supported = needed[i] <= probe->last_op && (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(probe);
+    return supported;
+}
+
+/**
+ * @brief 创建io_uring并注册固定缓冲区
+ * @return io_uring状态，内核不支持时返回NULL
+ */
+static uring_t *uring_create(async_io_t *io) {
+    uring_t *ring = calloc(1, sizeof(uring_t));
+    if (!ring) {
+        return NULL;
+    }
+
+    // 另留一项给读eventfd的请求
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = sys_uring_setup((unsigned)io->depth + 1, &params);
+    if (ring->fd < 0) {
+        LOG_INFO("io_uring unavailable (%s), using I/O thread", strerror(errno));
+        free(ring);
+        return NULL;
+    }
+    if (!uring_supports_ops(ring->fd)) {
+        LOG_INFO("io_uring lacks required opcodes (kernel older than 5.6), using I/O thread");
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && ring->cq_map_size > ring->sq_map_size) {
+        ring->sq_map_size = ring->cq_map_size;
+    }
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    ring->cq_map = single ? ring->sq_map
+                          : mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                 ring->fd, IORING_OFF_CQ_RING);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    ring->slots = calloc(io->depth, sizeof(async_io_request_t));
+    ring->done_bytes = calloc(io->depth, sizeof(size_t));
+    ring->free_slots = malloc(io->depth * sizeof(uint32_t));
+    if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED ||
+        !ring->slots || !ring->done_bytes || !ring->free_slots) {
+        LOG_ERROR("Failed to map io_uring queues");
+        uring_destroy(ring);
+        return NULL;
+    }
+
+    uint8_t *sq = (uint8_t *)ring->sq_map;
+    uint8_t *cq = (uint8_t *)ring->cq_map;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    for (size_t i = 0; i < io->depth; i++) {
+        ring->free_slots[i] = (uint32_t)(io->depth - 1 - i);
+    }
+    ring->free_count = io->depth;
+
+    // 注册失败 (如锁定内存上限过低) 时固定缓冲区按普通缓冲区读写
+    struct iovec *iov = malloc(io->buffer_count * sizeof(struct iovec));
+    for (size_t i = 0; iov && i < io->buffer_count; i++) {
+        iov[i].iov_base = io->buffers + i * io->buffer_size;
+        iov[i].iov_len = io->buffer_size;
+    }
+    if (iov && syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iov,
+                       (unsigned)io->buffer_count) == 0) {
+        ring->registered = 1;
+    } else {
+        LOG_WARN("Failed to register %zu I/O buffers: %s", io->buffer_count, strerror(errno));
+    }
+    free(iov);
+    return ring;
+}
+
+/**
+ * @brief 初始化实例
+ */
+int async_io_init(async_io_t *io, const async_io_config_t *config) {
+    if (!io) {
+        return -1;
+    }
+
+    memset(io, 0, sizeof(async_io_t));
+    io->wake_fd = -1;
+    io->depth = config && config->depth ? config->depth : ASYNC_IO_DEFAULT_DEPTH;
+    io->buffer_count = config && config->buffer_count ? config->buffer_count : ASYNC_IO_DEFAULT_BUFFERS;
+    io->buffer_size = config && config->buffer_size ? config->buffer_size : ASYNC_IO_DEFAULT_BUFFER_SIZE;
+    io->buffer_size = (io->buffer_size + BUFFER_ALIGN - 1) / BUFFER_ALIGN * BUFFER_ALIGN;
+
+    io->buffers = aligned_alloc(BUFFER_ALIGN, io->buffer_count * io->buffer_size);
+    io->free_buffers = malloc(io->buffer_count * sizeof(int));
+    io->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!io->buffers || !io->free_buffers || io->wake_fd < 0 ||
+        mpsc_queue_init(&io->submissions, io->depth * 4, sizeof(async_io_request_t)) < 0) {
+        LOG_ERROR("Failed to allocate async I/O queues");
+        free(io->buffers);
+        free(io->free_buffers);
+        if (io->wake_fd >= 0) {
+            close(io->wake_fd);
+        }
+        return -1;
+    }
+    for (size_t i = 0; i < io->buffer_count; i++) {
+        io->free_buffers[i] = (int)(io->buffer_count - 1 - i);
+    }
+    io->free_count = io->buffer_count;
+    pthread_mutex_init(&io->buffer_lock, NULL);
+
+    io->ring = (config && config->force_thread) ? NULL : uring_create(io);
+    io->backend = io->ring ? ASYNC_IO_BACKEND_URING : ASYNC_IO_BACKEND_THREAD;
+    io->running = 1;
+    if (pthread_create(&io->thread, NULL, io->ring ? uring_backend_main : thread_backend_main, io) != 0) {
+        LOG_ERROR("Failed to start I/O thread");
+        io->running = 0;
+        async_io_destroy(io);
+        return -1;
+    }
+
+    LOG_INFO("Async I/O started - %s backend, depth %zu, %zu x %zu KB buffers",
+             async_io_backend_name(io), io->depth, io->buffer_count, io->buffer_size / 1024);
+    return 0;
+}
+
+/**
+ * @brief 销毁实例
+ */
+void async_io_destroy(async_io_t *io) {
+    if (!io || !io->buffers) {
+        return;
+    }
+
+    if (__atomic_exchange_n(&io->running, 0, __ATOMIC_SEQ_CST)) {
+        wake_io_thread(io);
+        pthread_join(io->thread, NULL);
+    }
+    uring_destroy((uring_t *)io->ring);
+    io->ring = NULL;
+    mpsc_queue_destroy(&io->submissions);
+    close(io->wake_fd);
+    free(io->buffers);
+    free(io->free_buffers);
+    io->buffers = NULL;
+    io->free_buffers = NULL;
+    pthread_mutex_destroy(&io->buffer_lock);
+}
+
+/**
+ * @brief 提交请求
+ */
+int async_io_submit(async_io_t *io, const async_io_request_t *request) {
+    if (!io || !request) {
+        return -1;
+    }
+
+    // 先登记为提交方再检查运行标志，与销毁方的"清除标志后等待提交方归零"配对，
+    // 通过检查的提交方离开之前，I/O线程不会退出，队列和eventfd不会被释放
+    __atomic_add_fetch(&io->submitters, 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&io->running, __ATOMIC_SEQ_CST)) {
+        __atomic_sub_fetch(&io->submitters, 1, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    uint64_t ticket;
+    async_io_request_t *slot = mpsc_queue_claim(&io->submissions, &ticket);
+    if (!slot) {
+        __atomic_add_fetch(&io->rejected, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&io->submitters, 1, __ATOMIC_RELEASE);
+        return -1;
+    }
+    *slot = *request;
+    mpsc_queue_publish(&io->submissions, ticket);
+    __atomic_add_fetch(&io->submitted, 1, __ATOMIC_RELAXED);
+
+    // 只有I/O线程声明等待时才需要系统调用
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&io->sleeping, 0, __ATOMIC_SEQ_CST)) {
+        wake_io_thread(io);
+    }
+    __atomic_sub_fetch(&io->submitters, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * @brief 同步等待的状态
+ */
+typedef struct {
+    pthread_mutex_t lock;       // 保护done
+    pthread_cond_t cond;        // 完成通知
+    int done;                   // 是否完成
+    int64_t result;             // 结果
+} sync_wait_t;
+
+/**
+ * @brief 同步等待的完成回调 (在I/O线程中执行)
+ */
+static void sync_wait_done(void *ctx, const async_io_request_t *request, int64_t result) {
+    (void)request;
+    sync_wait_t *wait = (sync_wait_t *)ctx;
+    pthread_mutex_lock(&wait->lock);
+    wait->result = result;
+    wait->done = 1;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->lock);
+}
+
+/**
+ * @brief 提交请求并等待完成
+ */
+int64_t async_io_run(async_io_t *io, async_io_op_t op, int fd, void *buf, size_t len, uint64_t offset) {
+    async_io_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.op = op;
+    request.fd = fd;
+    request.buf = buf;
+    request.len = len;
+    request.offset = offset;
+    request.buffer_index = -1;
+
+    // 未配置实例或提交队列满时在调用线程中执行
+    sync_wait_t wait;
+    pthread_mutex_init(&wait.lock, NULL);
+    pthread_cond_init(&wait.cond, NULL);
+    wait.done = 0;
+    wait.result = 0;
+    request.callback = sync_wait_done;
+    request.ctx = &wait;
+    if (!io || async_io_submit(io, &request) < 0) {
+        wait.result = execute_request(&request);
+    } else {
+        pthread_mutex_lock(&wait.lock);
+        while (!wait.done) {
+            pthread_cond_wait(&wait.cond, &wait.lock);
+        }
+        pthread_mutex_unlock(&wait.lock);
+    }
+    pthread_mutex_destroy(&wait.lock);
+    pthread_cond_destroy(&wait.cond);
+    return wait.result;
+}
+
+/**
+ * @brief 取一个空闲的固定缓冲区
+ */
+uint8_t *async_io_buffer_get(async_io_t *io, int *index) {
+    if (!io || !index || !io->buffers) {
+        return NULL;
+    }
+    int found = -1;
+    pthread_mutex_lock(&io->buffer_lock);
+    if (io->free_count > 0) {
+        found = io->free_buffers[--io->free_count];
+    }
+    pthread_mutex_unlock(&io->buffer_lock);
+    if (found < 0) {
+        return NULL;
+    }
+    *index = found;
+    return io->buffers + (size_t)found * io->buffer_size;
+}
+
+/**
+ * @brief 归还固定缓冲区
+ */
+void async_io_buffer_put(async_io_t *io, int index) {
+    if (!io || index < 0 || (size_t)index >= io->buffer_count) {
+        return;
+    }
+    pthread_mutex_lock(&io->buffer_lock);
+    io->free_buffers[io->free_count++] = index;
+    pthread_mutex_unlock(&io->buffer_lock);
+}
+
+/**
+ * @brief 初始化所有者
+ */
+int async_io_owner_init(async_io_owner_t *owner, size_t capacity) {
+    if (!owner) {
+        return -1;
+    }
+    memset(owner, 0, sizeof(async_io_owner_t));
+    owner->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (owner->event_fd < 0 ||
+        mpsc_queue_init(&owner->completions, capacity ? capacity : OWNER_DEFAULT_CAPACITY,
+                        sizeof(async_io_completion_t)) < 0) {
+        LOG_ERROR("Failed to create async I/O owner");
+        if (owner->event_fd >= 0) {
+            close(owner->event_fd);
+        }
+        owner->event_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 销毁所有者
+ */
+void async_io_owner_destroy(async_io_owner_t *owner) {
+    if (!owner || owner->event_fd < 0) {
+        return;
+    }
+    mpsc_queue_destroy(&owner->completions);
+    close(owner->event_fd);
+    owner->event_fd = -1;
+}
+
+/**
+ * @brief 取出已完成的请求并调用回调
+ */
+int async_io_poll(async_io_owner_t *owner) {
+    if (!owner || owner->event_fd < 0) {
+        return 0;
+    }
+
+    // 先清除通知标志再取队列，之后投递的完成项会重新通知
+    __atomic_store_n(&owner->notified, 0, __ATOMIC_SEQ_CST);
+    uint64_t value;
+    if (read(owner->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        LOG_WARN("Failed to read I/O owner eventfd: %s", strerror(errno));
+    }
+
+    int handled = 0;
+    async_io_completion_t *completion;
+    while ((completion = mpsc_queue_peek(&owner->completions)) != NULL) {
+        async_io_completion_t done = *completion;
+        mpsc_queue_release(&owner->completions);
+        if (done.request.callback) {
+            done.request.callback(done.request.ctx, &done.request, done.result);
+        }
+        handled++;
+    }
+    owner->delivered += (uint64_t)handled;
+    return handled;
+}
+
+/**
+ * @brief 后端名称
+ */
+const char *async_io_backend_name(const async_io_t *io) {
+    return io && io->backend == ASYNC_IO_BACKEND_URING ? "io_uring" : "thread";
+}
+
+/**
+ * @brief 导出指标
+ */
+void async_io_export_metrics(async_io_t *io) {
+    if (!io || !io->buffers) {
+        return;
+    }
+
+    char labels[32];
+    snprintf(labels, sizeof(labels), "backend=\"%s\"", async_io_backend_name(io));
+    metrics_gauge_set("traffic_async_io_submitted_total", labels,
+                      (double)__atomic_load_n(&io->submitted, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_completed_total", labels,
+                      (double)__atomic_load_n(&io->completed, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_failed_total", labels,
+                      (double)__atomic_load_n(&io->failed, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_rejected_total", labels,
+                      (double)__atomic_load_n(&io->rejected, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_batches_total", labels,
+                      (double)__atomic_load_n(&io->batches, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_max_batch", labels,
+                      (double)__atomic_load_n(&io->max_batch, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_in_flight", labels,
+                      (double)__atomic_load_n(&io->in_flight, __ATOMIC_RELAXED));
+    metrics_gauge_set("traffic_async_io_queue_depth", labels, (double)mpsc_queue_depth(&io->submissions));
+}
@@ -0,0 +1,220 @@
+/**
+ * @file async_io.h
+ * @brief 磁盘读写和fsync的异步执行
+ *
+ * 请求由任意线程提交到多生产者队列，由专用I/O线程批量取出执行：
+ *   io_uring后端 一次填写多个提交项后用一次io_uring_enter提交并收割完成项，
+ *                fsync在内核中异步执行，不阻塞其他请求；
+ *   线程后端     内核不支持io_uring或被禁用时，由I/O线程依次执行pread/pwrite/fdatasync。
+ * 初始化时分配并向内核注册一组固定缓冲区，使用固定缓冲区的写入免去每次的页锁定。
+ * 完成结果投递到提交方指定的所有者 (每个事件循环一个的无锁完成队列)，并通过eventfd通知，
+ * 所有者在自己的事件循环中非阻塞地取出完成项并调用回调；未指定所有者的请求在I/O线程中
+ * 直接调用回调。需要同步等待结果的后台线程使用async_io_run。
+ */
+
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include "mpsc_queue.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ASYNC_IO_DEFAULT_DEPTH 256          // 默认同时执行的请求数
+#define ASYNC_IO_DEFAULT_BUFFERS 16         // 默认固定缓冲区数
+#define ASYNC_IO_DEFAULT_BUFFER_SIZE (1 << 20)  // 默认固定缓冲区大小
+
+/**
+ * @brief 请求类型
+ */
+typedef enum {
+    ASYNC_IO_READ = 0,          // pread
+    ASYNC_IO_WRITE = 1,         // pwrite (写满len字节)
+    ASYNC_IO_FSYNC = 2          // fdatasync
+} async_io_op_t;
+
+/**
+ * @brief 后端类型
+ */
+typedef enum {
+    ASYNC_IO_BACKEND_URING = 0, // io_uring
+    ASYNC_IO_BACKEND_THREAD = 1 // I/O线程同步执行
+} async_io_backend_t;
+
+struct async_io_request;
+struct async_io_owner;
+
+/**
+ * @brief 完成回调
+ * @param ctx 回调上下文
+ * @param request 请求
+ * @param result 读写的字节数或0 (fsync)，失败时为负的errno
+ */
+typedef void (*async_io_callback_t)(void *ctx, const struct async_io_request *request, int64_t result);
+
+/**
+ * @brief 请求
+ */
+typedef struct async_io_request {
+    async_io_op_t op;           // 请求类型
+    int fd;                     // 文件描述符
+    void *buf;                  // 读写缓冲区
+    size_t len;                 // 读写字节数
+    uint64_t offset;            // 文件偏移
+    int buffer_index;           // 固定缓冲区下标，-1表示普通缓冲区
+    int drain;                  // 等之前提交的请求全部完成后再执行 (用于fsync覆盖之前的写入)
+    struct async_io_owner *owner; // 完成投递的所有者，NULL表示在I/O线程中直接回调
+    async_io_callback_t callback; // 完成回调，可为NULL
+    void *ctx;                  // 回调上下文
+} async_io_request_t;
+
+/**
+ * @brief 完成项
+ */
+typedef struct {
+    async_io_request_t request; // 请求
+    int64_t result;             // 结果
+} async_io_completion_t;
+
+/**
+ * @brief 所有者：一个事件循环的完成队列
+ */
+typedef struct async_io_owner {
+    mpsc_queue_t completions;   // 完成项队列 (I/O线程写入，所有者线程读取)
+    int event_fd;               // 有新完成项时可读
+    int notified;               // 已写eventfd且所有者尚未取出
+    uint64_t delivered;         // 已取出的完成项数
+} async_io_owner_t;
+
+/**
+ * @brief 配置
+ */
+typedef struct {
+    size_t depth;               // 同时执行的请求数，0表示默认值
+    size_t buffer_count;        // 固定缓冲区数，0表示默认值
+    size_t buffer_size;         // 固定缓冲区大小，0表示默认值
+    int force_thread;           // 不尝试io_uring，直接使用线程后端
+} async_io_config_t;
+
+/**
+ * @brief 异步I/O实例
+ */
+typedef struct {
+    async_io_backend_t backend; // 后端类型
+    mpsc_queue_t submissions;   // 待执行的请求
+    size_t depth;               // 同时执行的请求数
+    int wake_fd;                // 唤醒I/O线程的eventfd
+    int sleeping;               // I/O线程是否在等待新请求
+    int running;                // I/O线程是否运行
+    int submitters;             // 已通过运行检查、正在写入队列的提交方数
+    pthread_t thread;           // I/O线程
+    void *ring;                 // io_uring状态 (线程后端为NULL)
+
+    uint8_t *buffers;           // 固定缓冲区 (连续分配)
+    size_t buffer_count;        // 固定缓冲区数
+    size_t buffer_size;         // 固定缓冲区大小
+    int *free_buffers;          // 空闲缓冲区下标栈
+    size_t free_count;          // 空闲缓冲区数
+    pthread_mutex_t buffer_lock; // 保护空闲栈
+
+    uint64_t submitted;         // 累计提交的请求数
+    uint64_t completed;         // 累计完成的请求数
+    uint64_t failed;            // 累计失败的请求数
+    uint64_t rejected;          // 提交队列满被拒绝的请求数
+    uint64_t batches;           // 累计提交批次数 (io_uring_enter调用数)
+    uint64_t max_batch;         // 单批最多请求数
+    uint64_t in_flight;         // 当前在内核中执行的请求数
+} async_io_t;
+
+/**
+ * @brief 初始化实例并启动I/O线程，io_uring不可用时使用线程后端
+ * @param io 实例指针
+ * @param config 配置，NULL表示默认值
+ * @return 0成功，-1失败
+ */
+int async_io_init(async_io_t *io, const async_io_config_t *config);
+
+/**
+ * @brief 等待已提交的请求全部完成后停止I/O线程并释放资源
+ * @param io 实例指针
+ */
+void async_io_destroy(async_io_t *io);
+
+/**
+ * @brief 提交请求 (任意线程，不阻塞)
+ * @param io 实例指针
+ * @param request 请求 (复制到队列中)
+ * @return 0成功，-1队列满或参数错误
+ */
+int async_io_submit(async_io_t *io, const async_io_request_t *request);
+
+/**
+ * @brief 提交请求并等待完成 (供后台线程使用)
+ * @param io 实例指针
+ * @param op 请求类型
+ * @param fd 文件描述符
+ * @param buf 读写缓冲区
+ * @param len 读写字节数
+ * @param offset 文件偏移
+ * @return 读写的字节数或0 (fsync)，失败时为负的errno
+ */
+int64_t async_io_run(async_io_t *io, async_io_op_t op, int fd, void *buf, size_t len, uint64_t offset);
+
+/**
+ * @brief 取一个空闲的固定缓冲区 (不阻塞)
+ * @param io 实例指针
+ * @param index 输出缓冲区下标
+ * @return 缓冲区 (大小为buffer_size)，没有空闲时返回NULL
+ */
+uint8_t *async_io_buffer_get(async_io_t *io, int *index);
+
+/**
+ * @brief 归还固定缓冲区
+ * @param io 实例指针
+ * @param index 缓冲区下标
+ */
+void async_io_buffer_put(async_io_t *io, int index);
+
+/**
+ * @brief 初始化所有者
+ * @param owner 所有者指针
+ * @param capacity 完成队列容量，0表示默认值
+ * @return 0成功，-1失败
+ */
+int async_io_owner_init(async_io_owner_t *owner, size_t capacity);
+
+/**
+ * @brief 销毁所有者 (调用方须先等待投递给它的请求全部完成)
+ * @param owner 所有者指针
+ */
+void async_io_owner_destroy(async_io_owner_t *owner);
+
+/**
+ * @brief 取出已完成的请求并调用回调 (仅所有者线程，不阻塞)
+ * @param owner 所有者指针
+ * @return 处理的完成项数
+ */
+int async_io_poll(async_io_owner_t *owner);
+
+/**
+ * @brief 后端名称
+ * @param io 实例指针
+ * @return "io_uring"或"thread"
+ */
+const char *async_io_backend_name(const async_io_t *io);
+
+/**
+ * @brief 导出请求数、批次和在途请求数指标
+ * @param io 实例指针
+ */
+void async_io_export_metrics(async_io_t *io);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ASYNC_IO_H
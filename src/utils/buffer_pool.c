@@ -0,0 +1,133 @@
+/**
+ * @file buffer_pool.c
+ * @brief 分级大小的缓冲区池实现
+ */
+
+#include "buffer_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 空闲块链表节点 (复用空闲块本身的存储)
+ */
+typedef struct free_block {
+    struct free_block *next;
+} free_block_t;
+
+/**
+ * @brief 计算容纳size字节的最小尺寸等级
+ * @return 尺寸等级，超过最大等级返回-1
+ */
+static int size_to_class(size_t size) {
+    size_t class_size = BUFFER_POOL_MIN_CLASS_SIZE;
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+        if (size <= class_size) {
+            return i;
+        }
+        class_size <<= 2;
+    }
+    return -1;
+}
+
+/**
+ * @brief 初始化缓冲区池
+ */
+void buffer_pool_init(buffer_pool_t *pool) {
+    if (pool) {
+        memset(pool, 0, sizeof(buffer_pool_t));
+    }
+}
+
+/**
+ * @brief 销毁缓冲区池
+ */
+void buffer_pool_destroy(buffer_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+    
+    for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++) {
+        free_block_t *block = pool->free_lists[i];
+        while (block) {
+            free_block_t *next = block->next;
+            free(block);
+            block = next;
+        }
+        pool->free_lists[i] = NULL;
+        pool->free_counts[i] = 0;
+    }
+}
+
+/**
+ * @brief 获取指定等级的块大小
+ */
+size_t buffer_pool_class_size(int class_idx) {
+    if (class_idx < 0 || class_idx >= BUFFER_POOL_CLASS_COUNT) {
+        return 0;
+    }
+    return (size_t)BUFFER_POOL_MIN_CLASS_SIZE << (2 * class_idx);
+}
+
+/**
+ * @brief 从池中分配缓冲区
+ */
+uint8_t *buffer_pool_alloc(buffer_pool_t *pool, size_t size, size_t *capacity) {
+    if (!pool || !capacity) {
+        return NULL;
+    }
+    
+    int class_idx = size_to_class(size);
+    if (class_idx < 0) {
+        return NULL;
+    }
+    
+    size_t class_size = buffer_pool_class_size(class_idx);
+    uint8_t *buffer;
+    
+    // 优先复用空闲块
+    free_block_t *block = pool->free_lists[class_idx];
+    if (block) {
+        pool->free_lists[class_idx] = block->next;
+        pool->free_counts[class_idx]--;
+        buffer = (uint8_t *)block;
+    } else {
+        buffer = malloc(class_size);
+        if (!buffer) {
+            return NULL;
+        }
+    }
+    
+    pool->in_use_counts[class_idx]++;
+    pool->bytes_in_use += class_size;
+    *capacity = class_size;
+    return buffer;
+}
+
+/**
+ * @brief 将缓冲区归还到池中
+ */
+void buffer_pool_free(buffer_pool_t *pool, uint8_t *buffer, size_t capacity) {
+    if (!pool || !buffer) {
+        return;
+    }
+    
+    int class_idx = size_to_class(capacity);
+    if (class_idx < 0 || buffer_pool_class_size(class_idx) != capacity) {
+        free(buffer);
+        return;
+    }
+    
+    pool->in_use_counts[class_idx]--;
+    pool->bytes_in_use -= capacity;
+    
+    // 空闲块过多时直接释放，避免长期占用内存
+    if (pool->free_counts[class_idx] >= BUFFER_POOL_MAX_FREE_PER_CLASS) {
+        free(buffer);
+        return;
+    }
+    
+    free_block_t *block = (free_block_t *)buffer;
+    block->next = pool->free_lists[class_idx];
+    pool->free_lists[class_idx] = block;
+    pool->free_counts[class_idx]++;
+}
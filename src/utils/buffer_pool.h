@@ -0,0 +1,63 @@
+/**
+ * @file buffer_pool.h
+ * @brief 分级大小的缓冲区池
+ */
+
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BUFFER_POOL_CLASS_COUNT 4           // 尺寸等级数量 (64/256/1024/4096字节)
+#define BUFFER_POOL_MIN_CLASS_SIZE 64       // 最小尺寸等级
+#define BUFFER_POOL_MAX_FREE_PER_CLASS 1024 // 每个等级最多缓存的空闲块数
+
+/**
+ * @brief 缓冲区池结构体
+ * 每个尺寸等级维护一个空闲链表，释放的块优先回收复用
+ */
+typedef struct {
+    void *free_lists[BUFFER_POOL_CLASS_COUNT];      // 各等级空闲链表
+    size_t free_counts[BUFFER_POOL_CLASS_COUNT];    // 各等级空闲块数
+    size_t in_use_counts[BUFFER_POOL_CLASS_COUNT];  // 各等级使用中的块数
+    size_t bytes_in_use;                            // 使用中的总字节数
+} buffer_pool_t;
+
+/**
+ * @brief 初始化缓冲区池
+ * @param pool 缓冲区池指针
+ */
+void buffer_pool_init(buffer_pool_t *pool);
+
+/**
+ * @brief 销毁缓冲区池，释放所有空闲块
+ * @param pool 缓冲区池指针
+ */
+void buffer_pool_destroy(buffer_pool_t *pool);
+
+/**
+ * @brief 获取指定等级的块大小
+ * @param class_idx 尺寸等级
+ * @return 块大小(字节)
+ */
+size_t buffer_pool_class_size(int class_idx);
+
+/**
+ * @brief 从池中分配至少size字节的缓冲区
+ * @param pool 缓冲区池指针
+ * @param size 所需字节数
+ * @param capacity 输出实际块大小
+ * @return 缓冲区指针，size超过最大等级或内存不足返回NULL
+ */
+uint8_t *buffer_pool_alloc(buffer_pool_t *pool, size_t size, size_t *capacity);
+
+/**
+ * @brief 将缓冲区归还到池中
+ * @param pool 缓冲区池指针
+ * @param buffer 缓冲区指针
+ * @param capacity 分配时得到的块大小
+ */
+void buffer_pool_free(buffer_pool_t *pool, uint8_t *buffer, size_t capacity);
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,112 @@
+/**
+ * @file latency_histogram.c
+ * @brief 延迟直方图实现
+ */
+
+#include "latency_histogram.h"
+#include "logger.h"
+#include <string.h>
+
+/**
+ * @brief 计算样本所在的桶
+ * 小于SUB_BUCKETS的值直接落在对应桶中，其余按最高位和其后两位定位
+ */
+static int bucket_index(uint64_t ns) {
+    if (ns < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (int)ns;
+    }
+    
+    int msb = 63 - __builtin_clzll(ns);
+    int sub = (int)((ns >> (msb - 2)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1));
+    return (msb - 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief 计算桶的上界
+ */
+static uint64_t bucket_upper_bound(int index) {
+    if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (uint64_t)index;
+    }
+    
+    int msb = index / LATENCY_HISTOGRAM_SUB_BUCKETS + 1;
+    uint64_t sub = (uint64_t)(index % LATENCY_HISTOGRAM_SUB_BUCKETS);
+    uint64_t step = 1ULL << (msb - 2);
+    return (1ULL << msb) + (sub + 1) * step - 1;
+}
+
+/**
+ * @brief 清空直方图
+ */
+void latency_histogram_reset(latency_histogram_t *hist) {
+    if (hist) {
+        memset(hist, 0, sizeof(latency_histogram_t));
+    }
+}
+
+/**
+ * @brief 记录一个延迟样本
+ */
+void latency_histogram_record(latency_histogram_t *hist, uint64_t ns) {
+    if (!hist) {
+        return;
+    }
+    
+    hist->buckets[bucket_index(ns)]++;
+    hist->count++;
+    hist->sum_ns += ns;
+    if (ns > hist->max_ns) {
+        hist->max_ns = ns;
+    }
+}
+
+/**
+ * @brief 计算百分位延迟
+ */
+uint64_t latency_histogram_percentile(const latency_histogram_t *hist, double percentile) {
+    if (!hist || hist->count == 0) {
+        return 0;
+    }
+    
+    uint64_t target = (uint64_t)(hist->count * percentile / 100.0);
+    if (target >= hist->count) {
+        target = hist->count - 1;
+    }
+    
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen > target) {
+            uint64_t upper = bucket_upper_bound(i);
+            return upper < hist->max_ns ? upper : hist->max_ns;
+        }
+    }
+    return hist->max_ns;
+}
+
+/**
+ * @brief 输出直方图摘要
+ */
+void latency_histogram_log(const char *name, const latency_histogram_t *hist) {
+    if (!hist || hist->count == 0) {
+        LOG_INFO("Latency %s: no samples", name);
+        return;
+    }
+    
+    LOG_INFO("Latency %s: count=%llu avg=%.1fus p50=%.1fus p99=%.1fus p999=%.1fus max=%.1fus",
+             name, (unsigned long long)hist->count,
+             hist->sum_ns / 1000.0 / hist->count,
+             latency_histogram_percentile(hist, 50.0) / 1000.0,
+             latency_histogram_percentile(hist, 99.0) / 1000.0,
+             latency_histogram_percentile(hist, 99.9) / 1000.0,
+             hist->max_ns / 1000.0);
+}
+
+/**
+ * @brief 计算两个时间点的差值
+ */
+uint64_t timespec_diff_ns(const struct timespec *later, const struct timespec *earlier) {
+    int64_t diff = (int64_t)(later->tv_sec - earlier->tv_sec) * 1000000000LL +
+                   (later->tv_nsec - earlier->tv_nsec);
+    return diff > 0 ? (uint64_t)diff : 0;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file latency_histogram.h
+ * @brief 延迟直方图 (对数分桶)
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 4   // 每个2的幂区间的细分桶数
+#define LATENCY_HISTOGRAM_BUCKETS (64 * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+/**
+ * @brief 延迟直方图结构体
+ * 以纳秒为单位，按2的幂分段并在每段内线性细分，相对误差不超过25%
+ */
+typedef struct {
+    uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS]; // 各桶计数
+    uint64_t count;             // 样本总数
+    uint64_t sum_ns;            // 样本总和(纳秒)
+    uint64_t max_ns;            // 最大样本(纳秒)
+} latency_histogram_t;
+
+/**
+ * @brief 清空直方图
+ * @param hist 直方图指针
+ */
+void latency_histogram_reset(latency_histogram_t *hist);
+
+/**
+ * @brief 记录一个延迟样本
+ * @param hist 直方图指针
+ * @param ns 延迟(纳秒)
+ */
+void latency_histogram_record(latency_histogram_t *hist, uint64_t ns);
+
+/**
+ * @brief 计算百分位延迟
+ * @param hist 直方图指针
+ * @param percentile 百分位 (0-100)
+ * @return 百分位所在桶的上界(纳秒)，无样本返回0
+ */
+uint64_t latency_histogram_percentile(const latency_histogram_t *hist, double percentile);
+
+/**
+ * @brief 以INFO级别输出直方图摘要 (样本数、均值、p50/p99/p999、最大值)
+ * @param name 直方图名称
+ * @param hist 直方图指针
+ */
+void latency_histogram_log(const char *name, const latency_histogram_t *hist);
+
+/**
+ * @brief 计算两个时间点的差值
+ * @param later 较晚的时间
+ * @param earlier 较早的时间
+ * @return 差值(纳秒)，later早于earlier时返回0
+ */
+uint64_t timespec_diff_ns(const struct timespec *later, const struct timespec *earlier);
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,416 @@
+/**
+ * @file metrics.c
+ * @brief 简单的运行指标系统实现
+ */
+
+#include "metrics.h"
+#include "logger.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * @brief 指标条目状态
+ */
+typedef enum {
+    ENTRY_EMPTY = 0,        // 从未使用
+    ENTRY_USED,             // 使用中
+    ENTRY_DELETED           // 已删除 (保留探测链)
+} entry_state_t;
+
+/**
+ * @brief 指标条目
+ */
+typedef struct {
+    char name[METRICS_NAME_SIZE];
+    char labels[METRICS_LABELS_SIZE];
+    metric_type_t type;
+    entry_state_t state;
+    double value;
+    int label_next;         // 同一标签串的下一个条目，-1表示链尾
+} metric_entry_t;
+
+#define LABEL_EMPTY (-1)    // 标签槽从未使用
+#define LABEL_DELETED (-2)  // 标签槽已删除 (保留探测链)
+
+/**
+ * @brief 标签串索引槽位：标签串到其条目链的映射
+ */
+typedef struct {
+    uint32_t hash;          // 标签串哈希
+    int head;               // 链首条目下标，或LABEL_EMPTY/LABEL_DELETED
+} label_slot_t;
+
+static metric_entry_t *metric_table = NULL;  // 指标条目 (容量为2的幂)
+static label_slot_t *label_table = NULL;     // 标签串索引 (与条目表容量相同)
+static int table_capacity = 0;               // 表容量
+static int used_entries = 0;                 // 使用中的条目数
+static int deleted_entries = 0;              // 条目墓碑数
+static int used_labels = 0;                  // 使用中的标签槽数
+static int deleted_labels = 0;               // 标签槽墓碑数
+static int full_logged = 0;                  // 表满后是否已记录日志
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief 计算字符串的哈希值 (FNV-1a)
+ */
+static uint32_t hash_string(uint32_t hash, const char *str) {
+    for (const char *p = str; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief 计算指标名和标签串的哈希值
+ */
+static uint32_t metric_hash(const char *name, const char *labels) {
+    uint32_t hash = hash_string(2166136261u, name);
+    hash = (hash ^ '{') * 16777619u;
+    return hash_string(hash, labels);
+}
+
+/**
+ * @brief 查找标签串的索引槽 (调用者持有锁)
+ * @param new_head 不存在时以该条目为链首创建索引槽，-1表示只查找
+ */
+static label_slot_t *find_label(const char *labels, int new_head) {
+    uint32_t hash = hash_string(2166136261u, labels);
+    uint32_t mask = (uint32_t)table_capacity - 1;
+    uint32_t idx = hash & mask;
+    label_slot_t *reusable = NULL;
+    
+    for (int probe = 0; probe < table_capacity; probe++) {
+        label_slot_t *slot = &label_table[idx];
+        if (slot->head == LABEL_EMPTY) {
+            if (!reusable) {
+                reusable = slot;
+            }
+            break;
+        }
+        if (slot->head == LABEL_DELETED) {
+            if (!reusable) {
+                reusable = slot;
+            }
+        } else if (slot->hash == hash && strcmp(metric_table[slot->head].labels, labels) == 0) {
+            return slot;
+        }
+        idx = (idx + 1) & mask;
+    }
+    
+    if (new_head < 0 || !reusable) {
+        return NULL;
+    }
+    if (reusable->head == LABEL_DELETED) {
+        deleted_labels--;
+    }
+    used_labels++;
+    reusable->hash = hash;
+    reusable->head = new_head;
+    return reusable;
+}
+
+/**
+ * @brief 在条目表中放置新条目并挂到标签链上 (调用者持有锁，表中不存在同名条目)
+ * @return 条目，表满时返回NULL
+ */
+static metric_entry_t *insert_entry(const char *name, const char *labels, metric_type_t type) {
+    uint32_t mask = (uint32_t)table_capacity - 1;
+    uint32_t idx = metric_hash(name, labels) & mask;
+    
+    // 复用探测链上第一个墓碑或空槽
+    int probe;
+    for (probe = 0; probe < table_capacity; probe++) {
+        if (metric_table[idx].state != ENTRY_USED) {
+            break;
+        }
+        idx = (idx + 1) & mask;
+    }
+    if (probe == table_capacity) {
+        return NULL;
+    }
+    
+    // 已有同标签的条目时插到链首，否则新建索引槽
+    int next = -1;
+    label_slot_t *slot = find_label(labels, -1);
+    if (slot) {
+        next = slot->head;
+        slot->head = (int)idx;
+    } else if (!find_label(labels, (int)idx)) {
+        return NULL;
+    }
+    
+    metric_entry_t *entry = &metric_table[idx];
+    if (entry->state == ENTRY_DELETED) {
+        deleted_entries--;
+    }
+    used_entries++;
+    snprintf(entry->name, sizeof(entry->name), "%s", name);
+    snprintf(entry->labels, sizeof(entry->labels), "%s", labels);
+    entry->type = type;
+    entry->state = ENTRY_USED;
+    entry->value = 0;
+    entry->label_next = next;
+    return entry;
+}
+
+/**
+ * @brief 以指定容量重建条目表和标签索引，清除全部墓碑 (调用者持有锁)
+ * @return 0成功，-1内存不足 (保留原表)
+ */
+static int rebuild_tables(int capacity) {
+    metric_entry_t *old_table = metric_table;
+    label_slot_t *old_labels = label_table;
+    int old_capacity = table_capacity;
+    
+    metric_entry_t *entries = calloc((size_t)capacity, sizeof(metric_entry_t));
+    label_slot_t *slots = malloc((size_t)capacity * sizeof(label_slot_t));
+    if (!entries || !slots) {
+        free(entries);
+        free(slots);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        slots[i].head = LABEL_EMPTY;
+    }
+    
+    metric_table = entries;
+    label_table = slots;
+    table_capacity = capacity;
+    used_entries = 0;
+    deleted_entries = 0;
+    used_labels = 0;
+    deleted_labels = 0;
+    
+    for (int i = 0; i < old_capacity; i++) {
+        if (old_table[i].state == ENTRY_USED) {
+            metric_entry_t *entry = insert_entry(old_table[i].name, old_table[i].labels, old_table[i].type);
+            entry->value = old_table[i].value;
+        }
+    }
+    free(old_table);
+    free(old_labels);
+    return 0;
+}
+
+/**
+ * @brief 为插入一个条目预留空间：负载超过3/4时扩容，或在原容量下重建以清除墓碑
+ * @return 0成功，-1表尚未分配且内存不足
+ */
+static int reserve_entry(void) {
+    if (!metric_table) {
+        return rebuild_tables(METRICS_INITIAL_ENTRIES);
+    }
+    
+    int limit = table_capacity / 4 * 3;
+    if (used_entries + deleted_entries < limit && used_labels + deleted_labels < limit) {
+        return 0;
+    }
+    
+    if (used_entries >= table_capacity / 2 && table_capacity < METRICS_MAX_ENTRIES) {
+        // 扩容失败时继续使用原表，直到真正填满
+        if (rebuild_tables(table_capacity * 2) < 0) {
+            LOG_WARN("Failed to grow metrics table beyond %d entries", table_capacity);
+        }
+    } else if (deleted_entries + deleted_labels >= table_capacity / 8) {
+        // 墓碑较多时原容量重建；已达上限且墓碑很少时直接复用墓碑，直到表满
+        rebuild_tables(table_capacity);
+    }
+    return 0;
+}
+
+/**
+ * @brief 查找指标条目，create为1时不存在则创建 (调用者持有锁)
+ */
+static metric_entry_t *find_entry(const char *name, const char *labels,
+                                  metric_type_t type, int create) {
+    if (!labels) {
+        labels = "";
+    }
+    
+    if (metric_table) {
+        uint32_t mask = (uint32_t)table_capacity - 1;
+        uint32_t idx = metric_hash(name, labels) & mask;
+        
+        // 线性探测
+        for (int probe = 0; probe < table_capacity; probe++) {
+            metric_entry_t *entry = &metric_table[idx];
+            
+            if (entry->state == ENTRY_EMPTY) {
+                break;
+            }
+            if (entry->state == ENTRY_USED &&
+                strcmp(entry->name, name) == 0 && strcmp(entry->labels, labels) == 0) {
+                return entry;
+            }
+            idx = (idx + 1) & mask;
+        }
+    }
+    
+    if (!create || reserve_entry() < 0) {
+        return NULL;
+    }
+    
+    metric_entry_t *entry = insert_entry(name, labels, type);
+    if (!entry && !full_logged) {
+        LOG_WARN("Metrics table full (%d entries), dropping %s{%s} and further new metrics",
+                 used_entries, name, labels);
+        full_logged = 1;
+    }
+    return entry;
+}
+
+/**
+ * @brief 初始化指标系统
+ */
+int metrics_init(void) {
+    pthread_mutex_lock(&metrics_mutex);
+    free(metric_table);
+    free(label_table);
+    metric_table = NULL;
+    label_table = NULL;
+    table_capacity = 0;
+    used_entries = 0;
+    deleted_entries = 0;
+    used_labels = 0;
+    deleted_labels = 0;
+    full_logged = 0;
+    pthread_mutex_unlock(&metrics_mutex);
+    return 0;
+}
+
+/**
+ * @brief 计数器累加
+ */
+void metrics_counter_add(const char *name, const char *labels, double delta) {
+    if (!name) {
+        return;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    metric_entry_t *entry = find_entry(name, labels, METRIC_COUNTER, 1);
+    if (entry) {
+        entry->value += delta;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+}
+
+/**
+ * @brief 设置瞬时值
+ */
+void metrics_gauge_set(const char *name, const char *labels, double value) {
+    if (!name) {
+        return;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    metric_entry_t *entry = find_entry(name, labels, METRIC_GAUGE, 1);
+    if (entry) {
+        entry->value = value;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+}
+
+/**
+ * @brief 读取指标当前值
+ */
+double metrics_get(const char *name, const char *labels) {
+    if (!name) {
+        return 0;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    metric_entry_t *entry = find_entry(name, labels, METRIC_GAUGE, 0);
+    double value = entry ? entry->value : 0;
+    pthread_mutex_unlock(&metrics_mutex);
+    return value;
+}
+
+/**
+ * @brief 当前指标条数
+ */
+int metrics_count(void) {
+    pthread_mutex_lock(&metrics_mutex);
+    int count = used_entries;
+    pthread_mutex_unlock(&metrics_mutex);
+    return count;
+}
+
+/**
+ * @brief 删除带有指定标签串的所有指标 (沿标签链，只访问该标签下的条目)
+ */
+void metrics_remove_labels(const char *labels) {
+    if (!labels) {
+        return;
+    }
+    
+    pthread_mutex_lock(&metrics_mutex);
+    label_slot_t *slot = metric_table ? find_label(labels, -1) : NULL;
+    if (slot) {
+        for (int i = slot->head; i >= 0; i = metric_table[i].label_next) {
+            metric_table[i].state = ENTRY_DELETED;
+            used_entries--;
+            deleted_entries++;
+        }
+        slot->head = LABEL_DELETED;
+        used_labels--;
+        deleted_labels++;
+        full_logged = 0;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+}
+
+/**
+ * @brief 以Prometheus文本格式输出所有指标
+ */
+int metrics_write(FILE *fp) {
+    if (!fp) {
+        return -1;
+    }
+    
+    int written = 0;
+    pthread_mutex_lock(&metrics_mutex);
+    for (int i = 0; i < table_capacity; i++) {
+        const metric_entry_t *entry = &metric_table[i];
+        if (entry->state != ENTRY_USED) {
+            continue;
+        }
+        
+        if (entry->labels[0]) {
+            fprintf(fp, "%s{%s} %.17g\n", entry->name, entry->labels, entry->value);
+        } else {
+            fprintf(fp, "%s %.17g\n", entry->name, entry->value);
+        }
+        written++;
+    }
+    pthread_mutex_unlock(&metrics_mutex);
+    
+    return written;
+}
+
+/**
+ * @brief 将所有指标原子地写入文件
+ */
+int metrics_write_file(const char *path) {
+    if (!path) {
+        return -1;
+    }
+    
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    
+    FILE *fp = fopen(tmp_path, "w");
+    if (!fp) {
+        return -1;
+    }
+    
+    int result = metrics_write(fp);
+    if (fclose(fp) != 0 || result < 0) {
+        remove(tmp_path);
+        return -1;
+    }
+    
+    return rename(tmp_path, path) == 0 ? 0 : -1;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file metrics.h
+ * @brief 简单的运行指标系统
+ *
+ * 指标存放在开放寻址哈希表中，负载过高时翻倍扩容 (至多METRICS_MAX_ENTRIES)，
+ * 删除留下的墓碑在插入时复用、在重建时清除。同一标签串的指标串成链，
+ * 按标签删除 (如逻辑检测器下线) 只访问该标签下的条目。
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+
+#define METRICS_INITIAL_ENTRIES 4096 // 初始表容量
+#define METRICS_MAX_ENTRIES 65536   // 最大表容量 (64连接 x 32逻辑检测器 x 每检测器约10项仍有余量)
+#define METRICS_NAME_SIZE 64        // 指标名最大长度
+#define METRICS_LABELS_SIZE 96      // 标签串最大长度
+
+/**
+ * @brief 指标类型
+ */
+typedef enum {
+    METRIC_COUNTER = 0,     // 单调递增计数器
+    METRIC_GAUGE            // 可任意设置的瞬时值
+} metric_type_t;
+
+/**
+ * @brief 初始化指标系统 (重复调用会清空已有指标)
+ * @return 0成功，-1失败
+ */
+int metrics_init(void);
+
+/**
+ * @brief 计数器累加
+ * @param name 指标名
+ * @param labels 标签串，如 device="110100-0002-0064"，NULL表示无标签
+ * @param delta 增量
+ */
+void metrics_counter_add(const char *name, const char *labels, double delta);
+
+/**
+ * @brief 设置瞬时值
+ * @param name 指标名
+ * @param labels 标签串，NULL表示无标签
+ * @param value 数值
+ */
+void metrics_gauge_set(const char *name, const char *labels, double value);
+
+/**
+ * @brief 读取指标当前值
+ * @param name 指标名
+ * @param labels 标签串，NULL表示无标签
+ * @return 指标值，不存在返回0
+ */
+double metrics_get(const char *name, const char *labels);
+
+/**
+ * @brief 当前指标条数
+ * @return 条数
+ */
+int metrics_count(void);
+
+/**
+ * @brief 删除带有指定标签串的所有指标 (如设备下线时)
+ * @param labels 标签串
+ */
+void metrics_remove_labels(const char *labels);
+
+/**
+ * @brief 以Prometheus文本格式输出所有指标
+ * @param fp 输出文件
+ * @return 输出的指标条数，-1表示错误
+ */
+int metrics_write(FILE *fp);
+
+/**
+ * @brief 将所有指标原子地写入文件 (先写临时文件再重命名)
+ * @param path 文件路径
+ * @return 0成功，-1失败
+ */
+int metrics_write_file(const char *path);
+
+#endif // METRICS_H
@@ -0,0 +1,132 @@
+/**
+ * @file mpsc_queue.c
+ * @brief 多生产者单消费者的无锁有界队列实现
+ */
+
+#include "mpsc_queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief 获取槽位的序号字段
+ */
+static inline uint64_t *slot_sequence(const mpsc_queue_t *queue, uint64_t position) {
+    return (uint64_t *)(queue->slots + (position & queue->mask) * queue->slot_stride);
+}
+
+/**
+ * @brief 获取槽位的数据区 (序号之后的下一个缓存行)
+ */
+static inline void *slot_item(const mpsc_queue_t *queue, uint64_t position) {
+    return queue->slots + (position & queue->mask) * queue->slot_stride + MPSC_QUEUE_CACHE_LINE;
+}
+
+/**
+ * @brief 初始化队列
+ */
+int mpsc_queue_init(mpsc_queue_t *queue, size_t capacity, size_t item_size) {
+    if (!queue || capacity == 0 || item_size == 0) {
+        return -1;
+    }
+
+    memset(queue, 0, sizeof(mpsc_queue_t));
+
+    size_t slots = 1;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+
+    queue->item_size = item_size;
+    queue->slot_stride = MPSC_QUEUE_CACHE_LINE +
+        (item_size + MPSC_QUEUE_CACHE_LINE - 1) / MPSC_QUEUE_CACHE_LINE * MPSC_QUEUE_CACHE_LINE;
+    queue->mask = slots - 1;
+
+    if (posix_memalign((void **)&queue->slots, MPSC_QUEUE_CACHE_LINE, slots * queue->slot_stride) != 0) {
+        queue->slots = NULL;
+        return -1;
+    }
+
+    // 槽位i的初始序号为i，表示可供第i次写入
+    for (size_t i = 0; i < slots; i++) {
+        *slot_sequence(queue, i) = i;
+    }
+    return 0;
+}
+
+/**
+ * @brief 销毁队列
+ */
+void mpsc_queue_destroy(mpsc_queue_t *queue) {
+    if (queue) {
+        free(queue->slots);
+        queue->slots = NULL;
+    }
+}
+
+/**
+ * @brief 申请一个槽位
+ */
+void *mpsc_queue_claim(mpsc_queue_t *queue, uint64_t *ticket) {
+    uint64_t position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+
+    for (;;) {
+        uint64_t sequence = __atomic_load_n(slot_sequence(queue, position), __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - position);
+
+        if (diff == 0) {
+            // 槽位空闲，竞争写入位置；失败时position被更新为最新值
+            if (__atomic_compare_exchange_n(&queue->tail, &position, position + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *ticket = position;
+                return slot_item(queue, position);
+            }
+        } else if (diff < 0) {
+            // 槽位仍未被消费者归还，队列已满
+            __atomic_add_fetch(&queue->full_count, 1, __ATOMIC_RELAXED);
+            return NULL;
+        } else {
+            // 其他生产者已占用该位置
+            position = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief 发布已填写的槽位
+ */
+void mpsc_queue_publish(mpsc_queue_t *queue, uint64_t ticket) {
+    __atomic_store_n(slot_sequence(queue, ticket), ticket + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 查看下一个已发布的槽位
+ */
+void *mpsc_queue_peek(mpsc_queue_t *queue) {
+    uint64_t position = queue->head;
+    uint64_t sequence = __atomic_load_n(slot_sequence(queue, position), __ATOMIC_ACQUIRE);
+
+    if (sequence != position + 1) {
+        return NULL;
+    }
+    return slot_item(queue, position);
+}
+
+/**
+ * @brief 归还槽位
+ */
+void mpsc_queue_release(mpsc_queue_t *queue) {
+    uint64_t position = queue->head;
+
+    // 序号前进一圈，表示可供下一轮写入
+    __atomic_store_n(slot_sequence(queue, position), position + queue->mask + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&queue->head, position + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 队列中未被消费的槽位数
+ */
+size_t mpsc_queue_depth(const mpsc_queue_t *queue) {
+    uint64_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    uint64_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    return tail > head ? (size_t)(tail - head) : 0;
+}
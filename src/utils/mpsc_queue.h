@@ -0,0 +1,83 @@
+/**
+ * @file mpsc_queue.h
+ * @brief 多生产者单消费者的无锁有界队列
+ *
+ * 基于序号的环形队列：每个槽位带一个序号，生产者通过CAS竞争写入位置，
+ * 写完数据后发布序号；唯一的消费者按顺序读取已发布的槽位，不需要CAS。
+ * 生产者之间不加锁，也不分配内存，队列满时立即返回失败。
+ * 槽位数据采用"申请-填写-发布"两阶段接口，避免额外复制。
+ */
+
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MPSC_QUEUE_CACHE_LINE 64    // 缓存行大小
+
+/**
+ * @brief 队列结构体
+ * 生产者位置和消费者位置分处不同缓存行，避免伪共享
+ */
+typedef struct {
+    uint64_t tail __attribute__((aligned(MPSC_QUEUE_CACHE_LINE))); // 下一个写入位置 (生产者竞争)
+    uint64_t head __attribute__((aligned(MPSC_QUEUE_CACHE_LINE))); // 下一个读取位置 (仅消费者)
+    uint8_t *slots;             // 槽位数组
+    size_t slot_stride;         // 槽位间距 (序号 + 数据，按缓存行对齐)
+    size_t item_size;           // 数据区大小
+    uint64_t mask;              // 容量 - 1
+    uint64_t full_count;        // 因队列满被拒绝的次数
+} mpsc_queue_t;
+
+/**
+ * @brief 初始化队列
+ * @param queue 队列指针
+ * @param capacity 槽位数，向上取整为2的幂
+ * @param item_size 每个槽位的数据区大小
+ * @return 0成功，-1失败
+ */
+int mpsc_queue_init(mpsc_queue_t *queue, size_t capacity, size_t item_size);
+
+/**
+ * @brief 销毁队列
+ * @param queue 队列指针
+ */
+void mpsc_queue_destroy(mpsc_queue_t *queue);
+
+/**
+ * @brief 申请一个槽位 (任意线程)
+ * @param queue 队列指针
+ * @param ticket 输出槽位序号，发布时传回
+ * @return 槽位数据区，队列满返回NULL
+ */
+void *mpsc_queue_claim(mpsc_queue_t *queue, uint64_t *ticket);
+
+/**
+ * @brief 发布已填写的槽位，之后消费者可见
+ * @param queue 队列指针
+ * @param ticket mpsc_queue_claim得到的序号
+ */
+void mpsc_queue_publish(mpsc_queue_t *queue, uint64_t ticket);
+
+/**
+ * @brief 查看下一个已发布的槽位 (仅消费者线程)
+ * @param queue 队列指针
+ * @return 槽位数据区，没有已发布的槽位返回NULL
+ */
+void *mpsc_queue_peek(mpsc_queue_t *queue);
+
+/**
+ * @brief 归还mpsc_queue_peek得到的槽位 (仅消费者线程)
+ * @param queue 队列指针
+ */
+void mpsc_queue_release(mpsc_queue_t *queue);
+
+/**
+ * @brief 队列中已申请但未被消费的槽位数 (近似值)
+ * @param queue 队列指针
+ * @return 槽位数
+ */
+size_t mpsc_queue_depth(const mpsc_queue_t *queue);
+
+#endif // MPSC_QUEUE_H
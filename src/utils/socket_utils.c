@@ -10,6 +10,10 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/select.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <linux/net_tstamp.h>
 #include <errno.h>
 
 /**
@@ -173,4 +177,93 @@ int send_all(int sockfd, const void *buffer, size_t size) {
     }
     
     return size;
+}
+
+/**
+ * @brief 开启socket的内核软件接收时间戳
+ */
+int enable_rx_timestamps(int sockfd) {
+    int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0) {
+        return 0;
+    }
+    
+    // 回退到纳秒精度的SO_TIMESTAMPNS
+    int opt = 1;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt)) < 0) {
+        perror("setsockopt SO_TIMESTAMPNS failed");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 接收数据并读取内核接收时间戳
+ */
+int recv_with_rx_timestamp(int sockfd, void *buffer, size_t size, struct timespec *rx_time) {
+    struct iovec iov;
+    struct msghdr msg;
+    // 控制消息缓冲区，足够容纳SCM_TIMESTAMPING的三个时间戳
+    union {
+        char buf[CMSG_SPACE(3 * sizeof(struct timespec))];
+        struct cmsghdr align;
+    } control;
+    
+    iov.iov_base = buffer;
+    iov.iov_len = size;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+    
+    int received = recvmsg(sockfd, &msg, 0);
+    
+    if (rx_time) {
+        rx_time->tv_sec = 0;
+        rx_time->tv_nsec = 0;
+        
+        if (received > 0) {
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level != SOL_SOCKET) {
+                    continue;
+                }
+                if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                    // ts[0]为软件时间戳，ts[2]为硬件时间戳
+                    memcpy(rx_time, CMSG_DATA(cmsg), sizeof(struct timespec));
+                    break;
+                }
+                if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                    memcpy(rx_time, CMSG_DATA(cmsg), sizeof(struct timespec));
+                    break;
+                }
+            }
+        }
+    }
+    
+    return received;
+}
+
+/**
+ * @brief 读取TCP连接的内核状态
+ */
+int get_tcp_info(int sockfd, struct tcp_info *info) {
+    socklen_t len = sizeof(struct tcp_info);
+    if (getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, info, &len) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 读取socket的发送队列和接收队列深度
+ */
+int get_socket_queue_depths(int sockfd, int *send_queue, int *recv_queue) {
+    if (ioctl(sockfd, SIOCOUTQ, send_queue) < 0) {
+        return -1;
+    }
+    if (ioctl(sockfd, SIOCINQ, recv_queue) < 0) {
+        return -1;
+    }
+    return 0;
 }
\ No newline at end of file
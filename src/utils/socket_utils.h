@@ -9,6 +9,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <time.h>
 
 /**
  * @brief 创建TCP服务端socket
@@ -58,4 +60,41 @@ int recv_with_timeout(int sockfd, void *buffer, size_t size, int timeout_ms);
  */
 int send_all(int sockfd, const void *buffer, size_t size);
 
+/**
+ * @brief 开启socket的内核软件接收时间戳
+ * 优先使用SO_TIMESTAMPING软件接收时间戳，不支持时回退到SO_TIMESTAMPNS，
+ * TCP和UDP socket均适用，不依赖网卡硬件时间戳
+ * @param sockfd socket文件描述符
+ * @return 0成功，-1失败
+ */
+int enable_rx_timestamps(int sockfd);
+
+/**
+ * @brief 接收数据并读取内核接收时间戳
+ * 通过recvmsg的控制消息读取时间戳，未开启时间戳时等同于recv
+ * @param sockfd socket文件描述符
+ * @param buffer 接收缓冲区
+ * @param size 缓冲区大小
+ * @param rx_time 输出内核接收时间 (CLOCK_REALTIME)，没有时间戳时置零
+ * @return 接收到的字节数，-1表示错误，0表示连接关闭
+ */
+int recv_with_rx_timestamp(int sockfd, void *buffer, size_t size, struct timespec *rx_time);
+
+/**
+ * @brief 读取TCP连接的内核状态 (TCP_INFO)
+ * @param sockfd socket文件描述符
+ * @param info 输出TCP连接状态
+ * @return 0成功，-1失败
+ */
+int get_tcp_info(int sockfd, struct tcp_info *info);
+
+/**
+ * @brief 读取socket的发送队列和接收队列深度
+ * @param sockfd socket文件描述符
+ * @param send_queue 输出发送队列中尚未被确认的字节数
+ * @param recv_queue 输出接收队列中尚未读取的字节数
+ * @return 0成功，-1失败
+ */
+int get_socket_queue_depths(int sockfd, int *send_queue, int *recv_queue);
+
 #endif // SOCKET_UTILS_H
\ No newline at end of file
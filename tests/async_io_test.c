@@ -0,0 +1,348 @@
+/**
+ * @file async_io_test.c
+ * @brief 异步磁盘I/O测试脚本
+ *
+ * 该测试脚本验证磁盘读写和fsync的异步执行，包括：
+ * 1. 异步磁盘I/O (io_uring和线程后端) 上的抓包写入与段文件读写
+ * 2. 提交队列满时抓包文件头不丢失，定期同步下次重试
+ * 3. 提交与销毁并发时已接受的请求全部完成
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/capture.h"
+#include "../src/server/capture_writer.h"
+#include "../src/server/history_store.h"
+#include "../src/utils/async_io.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_CAPTURE_FILE "/tmp/async_io_test.cap"
+#define TEST_HISTORY_DIR "/tmp/async_io_test_history"
+
+// 辅助函数：删除历史存储目录
+static void remove_history_dir(void) {
+    remove_history_dir_at(TEST_HISTORY_DIR);
+}
+
+// 辅助函数：完成回调 (I/O线程中调用)，第一个请求在此阻塞I/O线程直到放行
+static void block_io_thread(void *ctx, const async_io_request_t *request, int64_t result) {
+    int *gate = (int *)ctx;
+    (void)request;
+    (void)result;
+    if (__atomic_exchange_n(&gate[1], 1, __ATOMIC_SEQ_CST) == 0) {
+        while (!__atomic_load_n(&gate[0], __ATOMIC_SEQ_CST)) {
+            usleep(1000);
+        }
+    }
+}
+
+// 辅助函数：销毁期间持续提交的线程参数
+typedef struct {
+    async_io_t *io;             // 实例
+    int fd;                     // fsync的文件
+    int accepted;               // 提交成功的请求数
+    int completed;              // 完成回调次数 (I/O线程中累加)
+} submit_worker_t;
+
+// 辅助函数：完成回调，累加完成数
+static void count_completion(void *ctx, const async_io_request_t *request, int64_t result) {
+    submit_worker_t *worker = (submit_worker_t *)ctx;
+    (void)request;
+    (void)result;
+    __atomic_add_fetch(&worker->completed, 1, __ATOMIC_SEQ_CST);
+}
+
+// 辅助函数：提交到实例停止为止 (队列满时让出后重试)
+static void *submit_until_stopped(void *arg) {
+    submit_worker_t *worker = (submit_worker_t *)arg;
+    async_io_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.op = ASYNC_IO_FSYNC;
+    request.fd = worker->fd;
+    request.buffer_index = -1;
+    request.callback = count_completion;
+    request.ctx = worker;
+    while (__atomic_load_n(&worker->io->running, __ATOMIC_SEQ_CST)) {
+        if (async_io_submit(worker->io, &request) == 0) {
+            worker->accepted++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// 测试用例1：异步磁盘I/O
+void test_async_io() {
+    TEST_HEADER("测试用例1：异步磁盘I/O");
+
+    // io_uring不可用时两次都是线程后端
+    for (int force_thread = 0; force_thread <= 1; force_thread++) {
+        async_io_config_t io_config = {0, 16, 64 * 1024, force_thread};
+        async_io_t io;
+        async_io_owner_t owner;
+        TEST_ASSERT(async_io_init(&io, &io_config) == 0 && async_io_owner_init(&owner, 0) == 0, "异步I/O初始化");
+        printf("  后端：%s\n", async_io_backend_name(&io));
+
+        // 抓包记录打包到固定缓冲区异步写入，完成项由所有者取出后回收缓冲区
+        capture_writer_t writer;
+        TEST_ASSERT(capture_writer_open_async(&writer, TEST_CAPTURE_FILE, &io, &owner) == 0, "以异步模式创建抓包文件");
+        uint8_t frame[100];
+        for (int i = 0; i < 3000; i++) {
+            memset(frame, i & 0xFF, sizeof(frame));
+            capture_writer_write(&writer, i, frame, sizeof(frame));
+            if (i == 1500) {
+                capture_writer_sync(&writer);
+            }
+            async_io_poll(&owner);
+        }
+        uint64_t records = writer.records;
+        capture_writer_close(&writer);
+        TEST_ASSERT(records == 3000 && writer.dropped == 0 && writer.syncs == 2 && writer.inflight == 0 &&
+                    io.free_count == io.buffer_count, "关闭时等待在途写入和fdatasync完成并归还缓冲区");
+
+        capture_reader_t reader;
+        int64_t timestamp_ns;
+        const uint8_t *data;
+        size_t len;
+        int read_back = 0;
+        int intact = capture_reader_open(&reader, TEST_CAPTURE_FILE) == 0;
+        while (intact && capture_reader_next(&reader, &timestamp_ns, &data, &len) > 0) {
+            intact = timestamp_ns == read_back && len == sizeof(frame) && data[99] == (read_back & 0xFF);
+            read_back++;
+        }
+        capture_reader_close(&reader);
+        TEST_ASSERT(intact && read_back == 3000, "异步写入的抓包文件按顺序完整读回");
+
+        // 同步读取 (后台线程的用法)
+        uint8_t magic[CAPTURE_MAGIC_SIZE];
+        int fd = open(TEST_CAPTURE_FILE, O_RDONLY);
+        TEST_ASSERT(async_io_run(&io, ASYNC_IO_READ, fd, magic, sizeof(magic), 0) == CAPTURE_MAGIC_SIZE &&
+                    memcmp(magic, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) == 0, "同步等待读取结果");
+        TEST_ASSERT(async_io_run(&io, ASYNC_IO_READ, -1, magic, sizeof(magic), 0) == -EBADF,
+                    "失败的请求返回负的errno");
+        close(fd);
+        unlink(TEST_CAPTURE_FILE);
+
+        // 段文件的写入、fsync和冷层读取经由异步I/O
+        remove_history_dir();
+        history_config_t config;
+        memset(&config, 0, sizeof(config));
+        config.dir = TEST_HISTORY_DIR;
+        config.hot_max_rows = REALTIME_STORE_CHUNK_ROWS;
+        config.warm_max_bytes = 1;
+        config.io = &io;
+        history_store_t hist;
+        TEST_ASSERT(history_init(&hist, &config) == 0, "分层存储使用异步I/O初始化");
+        uint64_t completed = io.completed;
+        uint8_t content[MAX_FRAME_SIZE];
+        device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+        size_t content_len = build_realtime_content(content, 20000, 64, 0);
+        for (int chunk = 0; chunk < 3; chunk++) {
+            int appends = chunk < 2 ? REALTIME_STORE_CHUNK_ROWS / 64 : 10;
+            for (int i = 0; i < appends; i++) {
+                realtime_store_append(&hist.hot, &sender, content, content_len, 0);
+            }
+            history_migrate(&hist);
+        }
+        realtime_columns_t out;
+        realtime_columns_init(&out, 0);
+        TEST_ASSERT(hist.tier_segments[HISTORY_TIER_COLD] >= 1 && io.completed > completed &&
+                    count_history(&hist, INT64_MIN, INT64_MAX, &out) == 2 * REALTIME_STORE_CHUNK_ROWS + 640 &&
+                    out.occupancy[1] == 1, "经异步I/O写入的段可跨层查询");
+        realtime_columns_free(&out);
+        history_destroy(&hist);
+        remove_history_dir();
+
+        async_io_export_metrics(&io);
+        TEST_ASSERT(io.failed == 1 && io.in_flight == 0, "指标统计失败的请求数");
+        async_io_owner_destroy(&owner);
+        async_io_destroy(&io);
+    }
+}
+
+// 测试用例2：提交队列满时的抓包写入
+void test_capture_queue_full() {
+    TEST_HEADER("测试用例2：提交队列满时的抓包写入");
+
+    for (int force_thread = 0; force_thread <= 1; force_thread++) {
+        async_io_config_t io_config = {4, 4, 64 * 1024, force_thread};
+        async_io_t io;
+        async_io_owner_t owner;
+        TEST_ASSERT(async_io_init(&io, &io_config) == 0 && async_io_owner_init(&owner, 0) == 0, "异步I/O初始化");
+
+        // 第一个请求的回调阻塞I/O线程，其余请求填满提交队列
+        int gate[2] = {0, 0};
+        int fd = open(TEST_CAPTURE_FILE ".fill", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        async_io_request_t request;
+        memset(&request, 0, sizeof(request));
+        request.op = ASYNC_IO_FSYNC;
+        request.fd = fd;
+        request.buffer_index = -1;
+        request.callback = block_io_thread;
+        request.ctx = gate;
+        int queued = 0;
+        while (queued < 1000 && async_io_submit(&io, &request) == 0) {
+            queued++;
+            usleep(100);
+        }
+        TEST_ASSERT(queued < 1000 && io.rejected == 1, "I/O线程阻塞时提交队列被填满");
+
+        // 第一个缓冲区写满时提交被拒绝，丢弃的只有记录
+        capture_writer_t writer;
+        TEST_ASSERT(capture_writer_open_async(&writer, TEST_CAPTURE_FILE, &io, &owner) == 0, "以异步模式创建抓包文件");
+        uint8_t frame[100];
+        memset(frame, 0x5A, sizeof(frame));
+        for (int i = 0; i < 1000; i++) {
+            capture_writer_write(&writer, i, frame, sizeof(frame));
+        }
+        uint64_t dropped = writer.dropped;
+        TEST_ASSERT(dropped > 0 && dropped < 1000 && !writer.failed, "提交队列满时写满的缓冲区丢弃");
+
+        // 定期同步被拒绝时保留缓冲区，放行I/O线程后重试成功
+        TEST_ASSERT(capture_writer_sync(&writer) < 0 && !writer.failed && writer.buffer != NULL &&
+                    writer.dropped == dropped, "同步被拒绝时保留缓冲区，不置失败");
+        __atomic_store_n(&gate[0], 1, __ATOMIC_SEQ_CST);
+        while (io.completed < (uint64_t)queued) {
+            usleep(1000);
+        }
+        TEST_ASSERT(capture_writer_sync(&writer) == 0 && writer.dropped == dropped, "下一次同步提交保留的缓冲区");
+        int inflight = writer.inflight;
+        TEST_ASSERT(capture_writer_sync(&writer) == 0 && writer.inflight == inflight, "没有新记录时不再提交fdatasync");
+        capture_writer_close(&writer);
+        TEST_ASSERT(writer.syncs == 1, "关闭时没有新记录不重复同步");
+        close(fd);
+        unlink(TEST_CAPTURE_FILE ".fill");
+
+        capture_reader_t reader;
+        int64_t timestamp_ns;
+        const uint8_t *data;
+        size_t len;
+        int read_back = 0;
+        int opened = capture_reader_open(&reader, TEST_CAPTURE_FILE) == 0;
+        TEST_ASSERT(opened, "文件头完整，抓包文件可读");
+        int intact = opened;
+        while (intact && capture_reader_next(&reader, &timestamp_ns, &data, &len) > 0) {
+            intact = timestamp_ns == (int64_t)dropped + read_back && len == sizeof(frame);
+            read_back++;
+        }
+        if (opened) {
+            capture_reader_close(&reader);
+        }
+        TEST_ASSERT(intact && read_back == 1000 - (int)dropped, "丢弃之后写入的记录完整读回");
+        unlink(TEST_CAPTURE_FILE);
+
+        async_io_owner_destroy(&owner);
+        async_io_destroy(&io);
+    }
+}
+
+// 测试用例3：提交与销毁并发
+void test_submit_during_destroy() {
+    TEST_HEADER("测试用例3：提交与销毁并发");
+
+    for (int force_thread = 0; force_thread <= 1; force_thread++) {
+        async_io_config_t io_config = {8, 4, 64 * 1024, force_thread};
+        async_io_t io;
+        TEST_ASSERT(async_io_init(&io, &io_config) == 0, "异步I/O初始化");
+        const char *backend = async_io_backend_name(&io);
+
+        int fd = open(TEST_CAPTURE_FILE ".fill", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        submit_worker_t workers[3];
+        pthread_t threads[3];
+        for (int i = 0; i < 3; i++) {
+            workers[i] = (submit_worker_t){&io, fd, 0, 0};
+            pthread_create(&threads[i], NULL, submit_until_stopped, &workers[i]);
+        }
+        usleep(20000);
+
+        // 销毁时已接受的请求全部执行完，正在提交的线程不会写入已释放的队列
+        async_io_destroy(&io);
+        int accepted = 0;
+        int completed = 0;
+        for (int i = 0; i < 3; i++) {
+            pthread_join(threads[i], NULL);
+            accepted += workers[i].accepted;
+            completed += workers[i].completed;
+        }
+        close(fd);
+        unlink(TEST_CAPTURE_FILE ".fill");
+        printf("  后端：%s，提交%d个请求\n", backend, accepted);
+        TEST_ASSERT(accepted > 0 && completed == accepted, "销毁前接受的请求全部完成");
+        TEST_ASSERT(async_io_submit(&io, &(async_io_request_t){0}) < 0, "销毁后提交被拒绝");
+    }
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 异步磁盘I/O测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_async_io();
+    test_capture_queue_full();
+    test_submit_during_destroy();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！异步磁盘I/O工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查异步I/O逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,309 @@
+/**
+ * @file cpp_api_test.cpp
+ * @brief C++20头文件接口测试脚本
+ *
+ * 该测试脚本验证src/cpp下的C++接口与C实现的互通，包括：
+ * 1. 编译期CRC16与calculate_crc16一致
+ * 2. 类型化消息编码后可由C接口decode_frame解码
+ * 3. C接口encode_frame的输出可由C++接口零拷贝解码
+ * 4. 含转义字符的帧经暂存区反转义
+ * 5. 增量解码器逐字节拼接半帧
+ * 6. 协程收发
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "../src/cpp/traffic_async.hpp"
+#include "../src/utils/logger.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+static const traffic::device_id TEST_SENDER{110100, 1, 7};
+static const traffic::device_id TEST_RECEIVER{110100, 2, 1};
+
+// 辅助函数：构造两通道实时数据
+static std::array<traffic::realtime_channel, 2> make_channels() {
+    std::array<traffic::realtime_channel, 2> channels{};
+    for (uint8_t i = 0; i < 2; i++) {
+        channels[i].channel_id = static_cast<uint8_t>(i + 1);
+        channels[i].count_a = 1;
+        channels[i].count_b = 2;
+        channels[i].count_c = static_cast<uint8_t>(10 + i);
+        channels[i].occupancy = 345;
+        channels[i].speed = 62;
+        channels[i].length = 48;
+        channels[i].headway = 25;
+        channels[i].gap = 18;
+        channels[i].occupy_info = 0x55;
+    }
+    return channels;
+}
+
+// 测试用例1：CRC16
+void test_crc16() {
+    TEST_HEADER("测试用例1：编译期CRC16");
+
+    static constexpr uint8_t sample[] = {0x00, 0x01, 0xC0, 0xDB, 0xFF, 0x7E};
+    static_assert(traffic::crc16(sample) != 0, "constexpr evaluation");
+
+    TEST_ASSERT(traffic::crc16(sample) == calculate_crc16(sample, sizeof(sample)),
+                "编译期CRC16与calculate_crc16一致");
+
+    uint16_t split = traffic::crc16(std::span<const uint8_t>(sample, 2));
+    split = traffic::crc16(std::span<const uint8_t>(sample + 2, sizeof(sample) - 2), split);
+    TEST_ASSERT(split == traffic::crc16(sample), "分段计算结果与整体计算一致");
+}
+
+// 测试用例2：C++编码，C解码
+void test_encode_interop() {
+    TEST_HEADER("测试用例2：类型化编码与C接口解码互通");
+
+    auto channels = make_channels();
+    traffic::traffic_realtime msg;
+    msg.time = {1700000000, 250};
+    msg.channels = std::span<const traffic::realtime_channel>(channels);
+
+    auto header = traffic::make_header<traffic::traffic_realtime>(TEST_SENDER, TEST_RECEIVER, OP_UPLOAD);
+    uint8_t buffer[MAX_FRAME_SIZE];
+    auto len = traffic::encode(header, msg, buffer);
+    TEST_ASSERT(len.has_value(), "实时数据编码成功");
+    if (!len) {
+        return;
+    }
+
+    protocol_frame_t frame;
+    TEST_ASSERT(decode_frame(buffer, *len, &frame) == PROTOCOL_SUCCESS, "C接口decode_frame解码成功");
+    TEST_ASSERT(frame.data.object_id == OBJ_TRAFFIC_REALTIME && frame.data.operation == OP_UPLOAD,
+                "对象标识和操作类型正确");
+    TEST_ASSERT(frame.data.sender.admin_code == 110100 && frame.data.sender.device_id == 7,
+                "发送方标识正确");
+    TEST_ASSERT(frame.data.content_len == 6 + 1 + 2 * 19, "消息内容长度正确");
+    TEST_ASSERT(frame.data.content[6] == 2 && frame.data.content[7 + 19] == 2 &&
+                frame.data.content[7 + 4] == (345 & 0xFF) && frame.data.content[7 + 5] == (345 >> 8),
+                "通道记录按小端序写入");
+
+    auto decoded = traffic::frame_view::from_c(frame).as<traffic::traffic_realtime>();
+    TEST_ASSERT(decoded && decoded->time == msg.time && decoded->channels.size() == 2 &&
+                decoded->channels[0] == channels[0] && decoded->channels[1] == channels[1],
+                "C结构体视图按类型解码还原");
+    TEST_ASSERT(!traffic::frame_view::from_c(frame).as<traffic::traffic_stats>(),
+                "对象标识不符时拒绝解码");
+    free_frame(&frame);
+}
+
+// 测试用例3：C编码，C++零拷贝解码
+void test_decode_interop() {
+    TEST_HEADER("测试用例3：C接口编码与零拷贝解码");
+
+    uint8_t content[6 + 1 + 4] = {0};
+    content[6] = 1;
+    content[7] = 3;
+    content[8] = 1;
+    protocol_frame_t frame{};
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(TEST_SENDER.to_c(), TEST_RECEIVER.to_c(), OP_UPLOAD,
+                                   OBJ_DETECTOR_STATUS, content, sizeof(content));
+    uint8_t buffer[MAX_FRAME_SIZE];
+    int len = encode_frame(&frame, buffer, sizeof(buffer));
+    free_frame(&frame);
+    TEST_ASSERT(len > 0, "C接口encode_frame编码成功");
+
+    uint8_t scratch[MAX_FRAME_SIZE];
+    auto result = traffic::decode(std::span<const uint8_t>(buffer, len), scratch);
+    TEST_ASSERT(result.status == PROTOCOL_SUCCESS, "C++接口解码成功");
+    TEST_ASSERT(result.frame.payload.data() >= buffer && result.frame.payload.data() < buffer + len,
+                "无转义字符时负载直接引用输入缓冲区");
+    TEST_ASSERT(result.frame.header.sender == TEST_SENDER &&
+                result.frame.header.object_id == OBJ_DETECTOR_STATUS,
+                "帧头部解码正确");
+
+    auto status = result.frame.as<traffic::detector_status>();
+    TEST_ASSERT(status && status->channels.size() == 1 && status->channels[0].channel_id == 3 &&
+                status->channels[0].status == 1,
+                "检测器状态记录解码正确");
+
+    buffer[len / 2] ^= 0x01;
+    result = traffic::decode(std::span<const uint8_t>(buffer, len), scratch);
+    TEST_ASSERT(result.status != PROTOCOL_SUCCESS, "数据损坏时解码失败");
+}
+
+// 测试用例4：转义
+void test_escape_roundtrip() {
+    TEST_HEADER("测试用例4：含转义字符的帧");
+
+    const uint8_t payload[] = {FRAME_START, ESCAPE_CHAR, 0x01, FRAME_START};
+    traffic::frame_header header;
+    header.sender = TEST_SENDER;
+    header.receiver = TEST_RECEIVER;
+    header.operation = OP_UPLOAD;
+    header.object_id = 0x0F01;
+
+    uint8_t buffer[MAX_FRAME_SIZE];
+    auto len = traffic::encode_raw(header, payload, buffer);
+    TEST_ASSERT(len && std::memchr(buffer + 1, FRAME_START, *len - 2) == nullptr,
+                "编码后数据中不含帧标识");
+
+    uint8_t scratch[MAX_FRAME_SIZE];
+    auto result = traffic::decode(std::span<const uint8_t>(buffer, len.value_or(0)), scratch);
+    TEST_ASSERT(result && result.frame.payload.size() == sizeof(payload) &&
+                std::memcmp(result.frame.payload.data(), payload, sizeof(payload)) == 0,
+                "反转义后负载还原");
+    TEST_ASSERT(result.frame.payload.data() >= scratch && result.frame.payload.data() < scratch + sizeof(scratch),
+                "有转义字符时负载引用暂存区");
+}
+
+// 测试用例5：增量解码
+void test_incremental_decoder() {
+    TEST_HEADER("测试用例5：增量解码器");
+
+    uint8_t stream[MAX_FRAME_SIZE];
+    std::size_t stream_len = 0;
+    auto header = traffic::make_header<traffic::communication>(TEST_SENDER, TEST_RECEIVER, OP_SET_REQUEST);
+    for (int i = 0; i < 3; i++) {
+        header.link_addr = static_cast<uint16_t>(i);
+        stream_len += traffic::encode(header, traffic::communication{},
+                                      std::span<uint8_t>(stream + stream_len, sizeof(stream) - stream_len))
+                          .value_or(0);
+    }
+
+    traffic::frame_decoder decoder;
+    int frames = 0;
+    int in_order = 1;
+    for (std::size_t i = 0; i < stream_len; i++) {
+        decoder.feed(std::span<const uint8_t>(stream + i, 1));
+        while (auto result = decoder.next()) {
+            if (!*result || result->frame.header.link_addr != frames) {
+                in_order = 0;
+            }
+            frames++;
+        }
+    }
+    TEST_ASSERT(frames == 3 && in_order, "逐字节输入时拼接出全部帧");
+    TEST_ASSERT(decoder.pending() == 0, "输入结束后无残留半帧");
+
+    decoder.feed(std::span<const uint8_t>(stream, stream_len));
+    frames = 0;
+    while (auto result = decoder.next()) {
+        frames += *result ? 1 : 0;
+    }
+    TEST_ASSERT(frames == 3, "整批输入时依次取出全部帧");
+}
+
+// 测试用例6：协程收发
+static traffic::task<void> send_frames(traffic::poll_scheduler &scheduler, int fd, int count) {
+    auto channels = make_channels();
+    traffic::traffic_realtime msg;
+    msg.channels = std::span<const traffic::realtime_channel>(channels);
+    auto header = traffic::make_header<traffic::traffic_realtime>(TEST_SENDER, TEST_RECEIVER, OP_UPLOAD);
+
+    for (int i = 0; i < count; i++) {
+        msg.time.seconds = static_cast<uint32_t>(i);
+        if (co_await traffic::async_send(scheduler, fd, header, msg) < 0) {
+            break;
+        }
+    }
+    close(fd);
+}
+
+static traffic::task<void> receive_frames(traffic::poll_scheduler &scheduler, int fd, int *received) {
+    traffic::frame_reader reader;
+    while (auto result = co_await traffic::async_receive(scheduler, fd, reader)) {
+        auto msg = result->frame.as<traffic::traffic_realtime>();
+        if (msg && msg->time.seconds == static_cast<uint32_t>(*received)) {
+            (*received)++;
+        }
+    }
+}
+
+void test_coroutine_io() {
+    TEST_HEADER("测试用例6：协程收发");
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        TEST_ASSERT(0, "创建socketpair");
+        return;
+    }
+    fcntl(sv[0], F_SETFL, O_NONBLOCK);
+    fcntl(sv[1], F_SETFL, O_NONBLOCK);
+
+    const int count = 2000;
+    int received = 0;
+    traffic::poll_scheduler scheduler;
+    scheduler.spawn(send_frames(scheduler, sv[0], count));
+    scheduler.spawn(receive_frames(scheduler, sv[1], &received));
+    int ret = scheduler.run(5000);
+    close(sv[1]);
+
+    TEST_ASSERT(ret == 0, "调度器在所有任务结束后返回");
+    TEST_ASSERT(received == count, "接收方按顺序收到全部帧");
+}
+
+// 运行所有测试
+void run_all_tests() {
+    time_t now = time(NULL);
+    printf("=== C++20接口测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&now));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_crc16();
+    test_encode_interop();
+    test_decode_interop();
+    test_escape_roundtrip();
+    test_incremental_decoder();
+    test_coroutine_io();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！C++接口工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查C++接口实现。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
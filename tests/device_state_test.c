@@ -0,0 +1,215 @@
+/**
+ * @file device_state_test.c
+ * @brief 设备状态多版本表测试脚本
+ *
+ * 该测试脚本验证各设备最新实时信息的多版本发布与读取，包括：
+ * 1. 设备状态多版本表的跨设备一致快照与旧版本回收
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/device_state.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+// 并发快照测试的共享状态
+#define STATE_TEST_DEVICES 40
+#define STATE_TEST_ROUNDS 2000
+
+typedef struct {
+    device_state_t *state;
+    int done;                   // 写入线程已结束
+    long snapshots;             // 读者生成的快照数
+    long torn;                  // 不一致的快照数
+} state_race_t;
+
+// 写入线程：每轮依次发布全部设备，占有率基数为轮次
+static void *state_writer_thread(void *arg) {
+    state_race_t *race = (state_race_t *)arg;
+    uint8_t content[MAX_CONTENT_SIZE];
+
+    for (int round = 1; round <= STATE_TEST_ROUNDS; round++) {
+        size_t len = build_realtime_content(content, 9000 + round, 2, (uint16_t)round);
+        for (int d = 0; d < STATE_TEST_DEVICES; d++) {
+            device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, d + 1);
+            device_state_publish(race->state, &device, content, len, 0);
+        }
+        device_state_reclaim(race->state);
+    }
+    __atomic_store_n(&race->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 读者线程：快照中前若干设备处于第r轮、其余处于第r-1轮才是一致的
+static void *state_reader_thread(void *arg) {
+    state_race_t *race = (state_race_t *)arg;
+
+    while (!__atomic_load_n(&race->done, __ATOMIC_ACQUIRE)) {
+        device_snapshot_t snapshot;
+        if (device_state_snapshot(race->state, &snapshot) < 0) {
+            continue;
+        }
+
+        int previous = -1;
+        int steps = 0;
+        for (size_t i = 0; i < snapshot.device_count; i++) {
+            const device_version_t *version = device_snapshot_at(&snapshot, i, NULL);
+            int round = version ? (version->content[11] | (version->content[12] << 8)) : 0;
+            if (previous >= 0 && round != previous) {
+                steps += (round == previous - 1) ? 1 : 2;
+            }
+            previous = round;
+        }
+        if (steps > 1) {
+            race->torn++;
+        }
+        race->snapshots++;
+        device_snapshot_release(&snapshot);
+    }
+    return NULL;
+}
+
+// 测试用例1：设备状态一致快照
+void test_device_state() {
+    TEST_HEADER("测试用例1：设备状态跨设备一致快照");
+
+    device_state_t state;
+    TEST_ASSERT(device_state_init(&state, 64) == 0, "设备状态表初始化");
+
+    uint8_t content[MAX_CONTENT_SIZE];
+    device_id_t devices[3];
+    size_t len = build_realtime_content(content, 8000, 4, 100);
+    for (int d = 0; d < 3; d++) {
+        devices[d] = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 21 + d);
+        device_state_publish(&state, &devices[d], content, len, 0);
+    }
+
+    device_snapshot_t before;
+    device_state_snapshot(&state, &before);
+
+    len = build_realtime_content(content, 8002, 4, 200);
+    for (int d = 0; d < 3; d++) {
+        device_state_publish(&state, &devices[d], content, len, 0);
+    }
+    device_id_t late = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 30);
+    device_state_publish(&state, &late, content, len, 0);
+
+    device_snapshot_t after;
+    device_state_snapshot(&state, &after);
+
+    const device_version_t *old_version = device_snapshot_get(&before, &devices[1]);
+    const device_version_t *new_version = device_snapshot_get(&after, &devices[1]);
+    TEST_ASSERT(old_version && old_version->timestamp_ms == 8000500 &&
+                new_version && new_version->timestamp_ms == 8002500,
+                "两个快照分别看到各自纪元的最新版本");
+    TEST_ASSERT(device_snapshot_get(&before, &late) == NULL && device_snapshot_get(&after, &late) != NULL,
+                "快照之后出现的设备对旧快照不可见");
+
+    realtime_columns_t columns;
+    realtime_columns_init(&columns, 0);
+    int64_t rows = device_snapshot_collect(&before, &columns);
+    int consistent = rows == 12;
+    for (size_t i = 0; i < columns.count; i++) {
+        consistent &= columns.occupancy[i] >= 100 && columns.occupancy[i] < 104;
+    }
+    TEST_ASSERT(consistent, "旧快照解码出的全部设备数据属于同一纪元");
+    realtime_columns_free(&columns);
+
+    TEST_ASSERT(device_state_reclaim(&state) == 0 && state.live_versions == 7,
+                "旧快照未释放时保留其需要的版本");
+    device_snapshot_release(&before);
+    device_snapshot_release(&after);
+    TEST_ASSERT(device_state_reclaim(&state) == 3 && state.live_versions == 4,
+                "快照释放后回收旧版本");
+    device_state_destroy(&state);
+
+    // 写入线程持续发布并回收，读者线程并发取快照
+    device_state_init(&state, STATE_TEST_DEVICES);
+    state_race_t race = {&state, 0, 0, 0};
+    pthread_t writer, readers[2];
+    pthread_create(&writer, NULL, state_writer_thread, &race);
+    state_race_t reader_race[2] = {race, race};
+    for (int i = 0; i < 2; i++) {
+        reader_race[i].done = 0;
+        pthread_create(&readers[i], NULL, state_reader_thread, &reader_race[i]);
+    }
+    pthread_join(writer, NULL);
+    for (int i = 0; i < 2; i++) {
+        __atomic_store_n(&reader_race[i].done, 1, __ATOMIC_RELEASE);
+        pthread_join(readers[i], NULL);
+    }
+    printf("并发快照数：%ld，回收版本数：%llu\n", reader_race[0].snapshots + reader_race[1].snapshots,
+           (unsigned long long)state.reclaimed_versions);
+    TEST_ASSERT(reader_race[0].torn == 0 && reader_race[1].torn == 0, "并发写入时快照始终一致");
+    device_state_reclaim(&state);
+    TEST_ASSERT(state.live_versions == STATE_TEST_DEVICES, "读者全部释放后每个设备只保留最新版本");
+    device_state_destroy(&state);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 设备状态多版本表测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_device_state();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！设备状态表工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查设备状态表逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file flow_forecast_test.c
+ * @brief 按通道流量预测测试脚本
+ *
+ * 该测试脚本验证收到实时信息时按通道更新的短时流量预测，包括：
+ * 1. 按通道流量预测的增量更新与预测发布、按通道编号分配与扩展区间
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/flow_forecast.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+// 辅助函数：构造通道编号为ids的实时信息内容
+static size_t build_sparse_content(uint8_t *content, uint32_t timestamp, const uint8_t *ids, int count) {
+    size_t len = build_realtime_content(content, timestamp, count, 100);
+    for (int i = 0; i < count; i++) {
+        content[REALTIME_CONTENT_HEADER_SIZE + i * REALTIME_RECORD_SIZE] = ids[i];
+    }
+    return len;
+}
+
+// 测试用例1：按通道流量预测
+void test_flow_forecast() {
+    TEST_HEADER("测试用例1：按通道流量预测");
+
+    flow_forecast_t forecast;
+    TEST_ASSERT(flow_forecast_init(&forecast, 64, NULL) == 0, "预测器初始化");
+
+    // 通道1每2秒稳定通过6辆车 (10800辆/小时)；build_realtime_content每通道A+B+C=6
+    device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 41);
+    uint8_t content[MAX_CONTENT_SIZE];
+    size_t len = build_realtime_content(content, 100000, 4, 100);
+    TEST_ASSERT(flow_forecast_update(&forecast, &device, content, len) == 0, "首帧只记录时间");
+    TEST_ASSERT(flow_forecast_update(&forecast, &device, content, len) == 0, "重复时间的帧被忽略");
+
+    for (int i = 1; i <= 200; i++) {
+        len = build_realtime_content(content, 100000 + i * 2, 4, 100);
+        flow_forecast_update(&forecast, &device, content, len);
+    }
+
+    forecast_result_t result;
+    TEST_ASSERT(flow_forecast_read(&forecast, &device, 1, &result) == 0 &&
+                result.flow > 10799 && result.flow < 10801, "观测流量按帧间隔换算");
+    int steady = 1;
+    for (int h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+        steady &= result.prediction[h] > 10800 * 0.95 && result.prediction[h] < 10800 * 1.05;
+    }
+    TEST_ASSERT(steady, "稳定流量下各预测时长都接近实际流量");
+    TEST_ASSERT(flow_forecast_read(&forecast, &device, 9, &result) < 0, "超出通道数的读取失败");
+
+    // 间隔逐步缩短，流量持续上升，趋势项应使更远的预测更高
+    int64_t seconds = 100400;
+    for (int i = 0; i < 40; i++) {
+        seconds += (i % 2) ? 1 : 2;
+        len = build_realtime_content(content, (uint32_t)seconds, 4, 100);
+        flow_forecast_update(&forecast, &device, content, len);
+    }
+    flow_forecast_read(&forecast, &device, 2, &result);
+    TEST_ASSERT(result.prediction[FORECAST_HORIZON_COUNT - 1] > result.prediction[0],
+                "流量上升时远期预测高于近期预测");
+
+    flow_forecast_destroy(&forecast);
+
+    // 通道编号不连续：区间按最大编号分配，而不是按首帧的通道数
+    flow_forecast_init(&forecast, 128, NULL);
+    device_id_t sparse = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 42);
+    device_id_t neighbor = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 43);
+    const uint8_t first_ids[] = {3, 20};
+    const uint8_t neighbor_ids[] = {1};
+    for (int i = 0; i <= 100; i++) {
+        len = build_sparse_content(content, 200000 + i * 2, first_ids, 2);
+        flow_forecast_update(&forecast, &sparse, content, len);
+        len = build_sparse_content(content, 200000 + i * 2, neighbor_ids, 1);
+        flow_forecast_update(&forecast, &neighbor, content, len);
+    }
+    TEST_ASSERT(flow_forecast_read(&forecast, &sparse, 20, &result) == 0 &&
+                result.flow > 10799 && result.flow < 10801 && forecast.dropped_channels == 0,
+                "首帧中编号大于通道数的通道不被丢弃");
+
+    // 后续帧出现更大的编号：设备迁移到更长的区间，已学到的状态保留
+    forecast_result_t before;
+    flow_forecast_read(&forecast, &sparse, 20, &before);
+    const uint8_t grown_ids[] = {3, 20, 40};
+    len = build_sparse_content(content, 200202, grown_ids, 3);
+    TEST_ASSERT(flow_forecast_update(&forecast, &sparse, content, len) == 40 &&
+                forecast.relocations == 1, "出现更大编号时扩展并迁移区间");
+    flow_forecast_read(&forecast, &sparse, 20, &result);
+    steady = 1;
+    for (int h = 0; h < FORECAST_HORIZON_COUNT; h++) {
+        float drift = result.prediction[h] - before.prediction[h];
+        steady &= drift > -0.02f * before.prediction[h] && drift < 0.02f * before.prediction[h];
+    }
+    TEST_ASSERT(steady, "迁移后原有通道的预测延续");
+    TEST_ASSERT(flow_forecast_read(&forecast, &sparse, 40, &result) == 0 &&
+                result.flow > 10799 && result.flow < 10801, "新通道可读取");
+    TEST_ASSERT(flow_forecast_read(&forecast, &neighbor, 1, &result) == 0 &&
+                result.flow > 10799 && result.flow < 10801, "迁移不影响相邻设备");
+
+    // 编号0、超出MAX_CHANNELS，以及容量不足以扩展时，通道被丢弃并计数
+    const uint8_t invalid_ids[] = {1, 0, 200, 100};
+    len = build_sparse_content(content, 200204, invalid_ids, 4);
+    TEST_ASSERT(flow_forecast_update(&forecast, &neighbor, content, len) == 4 &&
+                forecast.dropped_channels == 3 && forecast.devices[1].dropped == 3,
+                "无效编号和无法扩展的通道计为丢弃");
+    TEST_ASSERT(flow_forecast_read(&forecast, &neighbor, 100, &result) < 0, "未分配的通道读取失败");
+
+    flow_forecast_destroy(&forecast);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 按通道流量预测测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_flow_forecast();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！流量预测工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查流量预测逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
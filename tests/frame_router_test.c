@@ -0,0 +1,333 @@
+/**
+ * @file frame_router_test.c
+ * @brief 帧路由转发器功能测试脚本
+ *
+ * 该测试脚本以子进程方式启动frame_router，配置默认路由和一条按接收方匹配的路由，
+ * 检测器端把两个信号机的帧交错发送，前半段按不规则长度分片写出 (帧跨越多次读取)，
+ * 后半段一次写出，验证每个信号机收到的字节与发给它的帧逐字节一致，包括：
+ * 1. splice模式：窥视帧边界、整段直通、半帧暂存补全、通信连接帧完整解码检查
+ * 2. copy模式：解码再编码后的字节与原帧一致
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/utils/socket_utils.h"
+#include "../src/utils/logger.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_ADMIN_CODE 110100
+#define TEST_FRAMES 120             // 每轮发送的帧数
+#define TEST_FRAGMENTED_FRAMES 60   // 分片写出的帧数 (其余一次写出)
+#define TEST_STREAM_SIZE (TEST_FRAMES * MAX_FRAME_SIZE)
+#define TEST_TIMEOUT_MS 5000        // 等待连接和数据的超时
+
+static const char *g_router_path = "bin/frame_router";
+
+// 上游信号机：接受一条连接并收集全部字节直到连接关闭
+typedef struct {
+    int listen_fd;
+    int port;
+    uint8_t *data;
+    size_t len;
+    int accepted;
+} upstream_t;
+
+// 辅助函数：监听系统分配的端口
+static int listen_any_port(int *port) {
+    int fd = create_tcp_server(0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    getsockname(fd, (struct sockaddr *)&addr, &addr_len);
+    *port = ntohs(addr.sin_port);
+    return fd;
+}
+
+// 辅助函数：上游接收线程
+static void *upstream_thread(void *arg) {
+    upstream_t *up = (upstream_t *)arg;
+    struct pollfd pfd = { up->listen_fd, POLLIN, 0 };
+    if (poll(&pfd, 1, TEST_TIMEOUT_MS) <= 0) {
+        return NULL;
+    }
+    int fd = accept(up->listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return NULL;
+    }
+    up->accepted = 1;
+
+    struct timeval tv = { TEST_TIMEOUT_MS / 1000, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ssize_t n;
+    while (up->len < TEST_STREAM_SIZE &&
+           (n = recv(fd, up->data + up->len, TEST_STREAM_SIZE - up->len, 0)) > 0) {
+        up->len += (size_t)n;
+    }
+    close(fd);
+    return NULL;
+}
+
+// 辅助函数：构造第index帧，接收方为信号机receiver_id
+static int build_test_frame(int index, uint16_t receiver_id, uint8_t *buffer, size_t size) {
+    uint8_t content[MAX_CONTENT_SIZE];
+    size_t content_len = 0;
+    uint16_t object_id = OBJ_TRAFFIC_REALTIME;
+    uint8_t operation = OP_UPLOAD;
+
+    if (index % 20 == 0) {
+        // 通信连接帧：splice模式下读入暂存区完整解码
+        object_id = OBJ_COMMUNICATION;
+        operation = OP_SET_REQUEST;
+    } else {
+        // 内容中混入0xC0/0xDB，编码后含转义字节
+        content_len = 1 + (size_t)(index * 37) % 400;
+        for (size_t k = 0; k < content_len; k++) {
+            content[k] = (uint8_t)(index * 7 + k);
+        }
+    }
+
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1),
+                                   create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, receiver_id),
+                                   operation, object_id, content_len ? content : NULL, content_len);
+    int len = encode_frame(&frame, buffer, size);
+    free_frame(&frame);
+    return len;
+}
+
+// 辅助函数：启动路由器子进程
+static pid_t start_router(const char *mode, int listen_port, int default_port, int route_port) {
+    char listen_arg[16], upstream_arg[32], route_arg[64];
+    snprintf(listen_arg, sizeof(listen_arg), "%d", listen_port);
+    snprintf(upstream_arg, sizeof(upstream_arg), "127.0.0.1:%d", default_port);
+    snprintf(route_arg, sizeof(route_arg), "%d:%d:2=127.0.0.1:%d",
+             TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, route_port);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(g_router_path, g_router_path, "-p", listen_arg, "-u", upstream_arg,
+              "-r", route_arg, "-m", mode, "-l", "3", (char *)NULL);
+        _exit(127);
+    }
+    return pid;
+}
+
+// 辅助函数：连接路由器 (路由器启动前重试)
+static int connect_router(int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (int i = 0; i < TEST_TIMEOUT_MS / 20; i++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            return fd;
+        }
+        close(fd);
+        usleep(20000);
+    }
+    return -1;
+}
+
+// 辅助函数：以指定模式运行一轮转发并逐字节校验两个目的端
+static void run_router_case(const char *mode) {
+    upstream_t ups[2];
+    pthread_t tids[2];
+    uint8_t *expected[2];
+    size_t expected_len[2] = {0, 0};
+    uint8_t *stream = malloc(TEST_STREAM_SIZE);
+    size_t stream_len = 0;
+    size_t fragmented_len = 0;
+
+    for (int r = 0; r < 2; r++) {
+        memset(&ups[r], 0, sizeof(ups[r]));
+        ups[r].listen_fd = listen_any_port(&ups[r].port);
+        ups[r].data = malloc(TEST_STREAM_SIZE);
+        expected[r] = malloc(TEST_STREAM_SIZE);
+        pthread_create(&tids[r], NULL, upstream_thread, &ups[r]);
+    }
+
+    // 默认路由 (信号机1) 和路由条目 (信号机2) 的帧交错，中间夹杂帧外字节
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        int route = (i % 3 == 1) ? 1 : 0;
+        uint8_t frame[MAX_FRAME_SIZE];
+        int len = build_test_frame(i, (uint16_t)(route + 1), frame, sizeof(frame));
+        if (len <= 0) {
+            continue;
+        }
+        if (i == TEST_FRAGMENTED_FRAMES / 2) {
+            static const uint8_t junk[] = {0x11, 0x22, 0x33};
+            memcpy(stream + stream_len, junk, sizeof(junk));
+            stream_len += sizeof(junk);
+        }
+        memcpy(stream + stream_len, frame, len);
+        stream_len += len;
+        memcpy(expected[route] + expected_len[route], frame, len);
+        expected_len[route] += len;
+        if (i == TEST_FRAGMENTED_FRAMES - 1) {
+            fragmented_len = stream_len;
+        }
+    }
+
+    int probe_port = 0;
+    int probe_fd = listen_any_port(&probe_port);
+    close(probe_fd);
+    pid_t pid = start_router(mode, probe_port, ups[0].port, ups[1].port);
+    int fd = connect_router(probe_port);
+    TEST_ASSERT(pid > 0 && fd >= 0, "连接到路由器");
+
+    int send_ok = fd >= 0;
+    if (send_ok) {
+        // 不规则长度分片写出，帧在任意位置被切开
+        static const size_t chunks[] = {1, 7, 33, 150, 5, 600, 2, 64};
+        size_t pos = 0;
+        for (int c = 0; pos < fragmented_len && send_ok; c++) {
+            size_t chunk = chunks[c % (sizeof(chunks) / sizeof(chunks[0]))];
+            if (chunk > fragmented_len - pos) {
+                chunk = fragmented_len - pos;
+            }
+            send_ok = send_all(fd, stream + pos, chunk) >= 0;
+            pos += chunk;
+            usleep(2000);
+        }
+        // 其余帧一次写出，窥视窗口中包含多段交错路由
+        send_ok = send_ok && send_all(fd, stream + pos, stream_len - pos) >= 0;
+        shutdown(fd, SHUT_WR);
+
+        // 等待路由器关闭连接，保证数据已全部转发
+        struct timeval tv = { TEST_TIMEOUT_MS / 1000, 0 };
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char drain[4096];
+        while (recv(fd, drain, sizeof(drain), 0) > 0) {
+        }
+        close(fd);
+    }
+    TEST_ASSERT(send_ok, "检测器分片写出全部帧");
+
+    for (int r = 0; r < 2; r++) {
+        pthread_join(tids[r], NULL);
+        close(ups[r].listen_fd);
+    }
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, NULL, 0);
+    }
+
+    TEST_ASSERT(ups[0].accepted && ups[1].accepted, "两个信号机都建立了上游连接");
+    if (ups[0].len != expected_len[0] || ups[1].len != expected_len[1]) {
+        printf("  默认路由：期望%zu字节，收到%zu字节；路由条目：期望%zu字节，收到%zu字节\n",
+               expected_len[0], ups[0].len, expected_len[1], ups[1].len);
+    }
+    TEST_ASSERT(ups[0].len == expected_len[0] &&
+                memcmp(ups[0].data, expected[0], expected_len[0]) == 0,
+                "默认路由收到的字节与其帧逐字节一致");
+    TEST_ASSERT(ups[1].len == expected_len[1] &&
+                memcmp(ups[1].data, expected[1], expected_len[1]) == 0,
+                "路由条目收到的字节与其帧逐字节一致");
+
+    for (int r = 0; r < 2; r++) {
+        free(ups[r].data);
+        free(expected[r]);
+    }
+    free(stream);
+}
+
+// 测试用例1：splice模式两条路由分片转发
+void test_splice_mode_routing() {
+    TEST_HEADER("测试用例1：splice模式两条路由分片转发");
+    run_router_case("splice");
+}
+
+// 测试用例2：copy模式两条路由分片转发
+void test_copy_mode_routing() {
+    TEST_HEADER("测试用例2：copy模式两条路由分片转发");
+    run_router_case("copy");
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 帧路由转发器功能测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    // 运行所有测试用例
+    test_splice_mode_routing();
+    test_copy_mode_routing();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！帧路由转发工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查帧路由转发逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) {
+        g_router_path = argv[1];
+    }
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file freshness_test.c
+ * @brief 数据新鲜度监测测试脚本
+ *
+ * 该测试脚本验证按设备和数据对象的数据新鲜度监测，包括：
+ * 1. 按设备和数据对象学习上传周期并发现停止上传的设备
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/server/freshness.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+/**
+ * @brief 新鲜度事件计数
+ */
+static void count_freshness_event(void *ctx, const freshness_event_t *event) {
+    int *counts = (int *)ctx;
+    counts[event->type == FRESHNESS_EVENT_STALE ? 0 : 1]++;
+}
+
+// 测试用例1：数据新鲜度监测
+void test_freshness() {
+    TEST_HEADER("测试用例1：数据新鲜度监测");
+
+    freshness_monitor_t monitor;
+    int counts[2] = {0, 0};
+    TEST_ASSERT(freshness_init(&monitor, 256) == 0, "监测器初始化");
+    freshness_subscribe(&monitor, count_freshness_event, counts);
+
+    // 100个设备，设备i每(i+1)秒上传一次实时信息
+    int64_t now = 0;
+    for (int round = 0; round < 20; round++) {
+        for (int i = 0; i < 100; i++) {
+            device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, (uint16_t)(i + 1));
+            freshness_observe(&monitor, &device, OBJ_TRAFFIC_REALTIME, now + (int64_t)round * (i + 1) * 1000);
+        }
+    }
+    device_id_t first = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    const freshness_stream_t *stream = freshness_get(&monitor, &first, OBJ_TRAFFIC_REALTIME);
+    TEST_ASSERT(stream && stream->period_ms == 1000, "学习到的上传周期与实际一致");
+
+    // 设备1最后一次上传在19秒，截止时间为19 + 1 + 2(最小余量)秒
+    TEST_ASSERT(freshness_expire(&monitor, 21999) == 0, "截止时间前不过期");
+    TEST_ASSERT(freshness_expire(&monitor, 22000) == 1 && counts[0] == 1, "截止时间到达时按O(log n)弹出过期");
+    TEST_ASSERT(freshness_expire(&monitor, 22500) == 0, "已过期的数据流不重复产生事件");
+
+    // 心跳仍在但实时信息停止：只有各自截止时间已过的设备过期
+    int expired = freshness_expire(&monitor, 100000);
+    TEST_ASSERT(expired > 0 && monitor.stale_streams == (size_t)(expired + 1), "按各自周期判断过期");
+
+    freshness_observe(&monitor, &first, OBJ_TRAFFIC_REALTIME, 100000);
+    TEST_ASSERT(counts[1] == 1 && monitor.stale_streams == (size_t)expired, "再次上传后恢复");
+    TEST_ASSERT(freshness_get(&monitor, &first, OBJ_TRAFFIC_REALTIME)->period_ms == 1000,
+                "中断期间的间隔不计入周期学习");
+
+    // 批量补传的密集帧只推迟截止时间
+    for (int i = 1; i <= 10; i++) {
+        freshness_observe(&monitor, &first, OBJ_TRAFFIC_REALTIME, 100000 + i * 10);
+    }
+    TEST_ASSERT(freshness_get(&monitor, &first, OBJ_TRAFFIC_REALTIME)->period_ms == 1000,
+                "突发帧不拉低学习到的周期");
+
+    freshness_destroy(&monitor);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 数据新鲜度监测测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_freshness();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！新鲜度监测工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查新鲜度监测逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file history_federation_test.c
+ * @brief 跨节点聚合查询测试脚本
+ *
+ * 该测试脚本验证多个节点历史数据的跨节点分桶聚合查询，包括：
+ * 1. 跨节点分桶聚合查询的合并、节点超时与部分结果
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/server/history_store.h"
+#include "../src/server/query_cache.h"
+#include "../src/server/history_federation.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/socket_utils.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_HISTORY_DIR "/tmp/history_federation_test_history"
+#define TEST_HISTORY_DIR_B "/tmp/history_federation_test_history_b"
+
+// 辅助函数：删除历史存储目录
+static void remove_history_dir(void) {
+    remove_history_dir_at(TEST_HISTORY_DIR);
+}
+
+// 测试用例1：跨节点聚合查询
+void test_history_federation() {
+    TEST_HEADER("测试用例1：跨节点聚合查询");
+
+    // 两个节点各有10分钟数据，时间重叠5分钟
+    remove_history_dir();
+    remove_history_dir_at(TEST_HISTORY_DIR_B);
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.warmup_threads = -1;
+    history_store_t hist_a;
+    history_store_t hist_b;
+    query_cache_t cache_a;
+    query_cache_t cache_b;
+    config.dir = TEST_HISTORY_DIR;
+    int ok = history_init(&hist_a, &config) == 0 && query_cache_init(&cache_a, &hist_a, 0) == 0;
+    config.dir = TEST_HISTORY_DIR_B;
+    ok = ok && history_init(&hist_b, &config) == 0 && query_cache_init(&cache_b, &hist_b, 0) == 0;
+    append_seconds(&hist_a, 60000, 60599);
+    append_seconds(&hist_b, 60300, 60899);
+
+    federation_server_t server_a;
+    federation_server_t server_b;
+    ok = ok && federation_server_start(&server_a, &cache_a, 0, 1) == 0 &&
+         federation_server_start(&server_b, &cache_b, 0, 1) == 0;
+    TEST_ASSERT(ok && server_a.port > 0 && server_b.port > 0, "两个节点启动查询服务");
+
+    // 一个只监听不应答的节点和一个已关闭的端口
+    int stalled_fd = create_tcp_server(0);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    getsockname(stalled_fd, (struct sockaddr *)&addr, &addr_len);
+    int stalled_port = ntohs(addr.sin_port);
+    int closed_fd = create_tcp_server(0);
+    addr_len = sizeof(addr);
+    getsockname(closed_fd, (struct sockaddr *)&addr, &addr_len);
+    int closed_port = ntohs(addr.sin_port);
+    close(closed_fd);
+
+    federation_node_t nodes[4];
+    memset(nodes, 0, sizeof(nodes));
+    for (int i = 0; i < 4; i++) {
+        snprintf(nodes[i].host, sizeof(nodes[i].host), "127.0.0.1");
+    }
+    nodes[0].port = server_a.port;
+    nodes[1].port = server_b.port;
+    nodes[2].port = stalled_port;
+    nodes[2].timeout_ms = 200;
+    nodes[3].port = closed_port;
+
+    federation_t fed;
+    federation_node_status_t status[4];
+    query_bucket_t buckets[1024];
+    realtime_query_t query;
+    realtime_query_init(&query);
+    query.start_ms = 60000000;
+    query.end_ms = 60900000;
+    TEST_ASSERT(federation_init(&fed, nodes, 2, 0) == 0 &&
+                federation_aggregate(&fed, &query, 60000, buckets, 1024, status) == 15 &&
+                status[0].state == FEDERATION_NODE_OK && status[1].state == FEDERATION_NODE_OK &&
+                status[0].complete_until_ms == 60900000 && status[0].rows == 1200 && status[1].rows == 1200,
+                "两个节点都返回完整结果");
+    TEST_ASSERT(buckets[0].start_ms == 60000000 && buckets[0].rows == 120 && buckets[5].rows == 240 &&
+                buckets[14].rows == 120 && buckets[5].count_c == 720 && buckets[9].occupancy_sum == 240 * 100 + 120,
+                "各节点的桶按时间累加");
+
+    // 1秒的桶跨越多批发回
+    int64_t count = federation_aggregate(&fed, &query, 1000, buckets, 1024, status);
+    uint64_t rows = 0;
+    for (int64_t b = 0; b < count; b++) {
+        rows += buckets[b].rows;
+    }
+    TEST_ASSERT(count == 900 && rows == 2400 && buckets[0].rows == 2 && buckets[450].rows == 4 &&
+                buckets[899].rows == 2 && status[1].complete_until_ms == 60900000, "多批结果逐批合并");
+
+    // 不应答的节点超时，无法连接的节点立即结束，其余节点的结果照常返回
+    int64_t begin = (int64_t)time(NULL);
+    TEST_ASSERT(federation_init(&fed, nodes, 4, 0) == 0 &&
+                federation_aggregate(&fed, &query, 60000, buckets, 1024, status) == 15 &&
+                buckets[5].rows == 240 && status[2].state == FEDERATION_NODE_TIMEOUT &&
+                status[2].complete_until_ms == 60000000 && status[3].state == FEDERATION_NODE_UNREACHABLE &&
+                status[0].state == FEDERATION_NODE_OK && (int64_t)time(NULL) - begin <= 1,
+                "超时和无法连接的节点给出部分结果");
+    TEST_ASSERT(fed.queries == 1 && fed.partial_queries == 1 && fed.node_timeouts == 1 && fed.node_errors == 1,
+                "部分结果计入指标");
+    TEST_ASSERT(server_a.requests == 3 && server_a.failed == 0 && server_a.buckets_sent > 0,
+                "查询服务只发回非空桶");
+
+    close(stalled_fd);
+    federation_server_stop(&server_a);
+    federation_server_stop(&server_b);
+    query_cache_destroy(&cache_a);
+    query_cache_destroy(&cache_b);
+    history_destroy(&hist_a);
+    history_destroy(&hist_b);
+    remove_history_dir();
+    remove_history_dir_at(TEST_HISTORY_DIR_B);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 跨节点聚合查询测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_history_federation();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！跨节点聚合查询工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查联邦查询逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
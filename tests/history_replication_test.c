@@ -0,0 +1,259 @@
+/**
+ * @file history_replication_test.c
+ * @brief 历史数据异步复制测试脚本
+ *
+ * 该测试脚本验证历史段文件和热层尾部到副本进程的异步复制，包括：
+ * 1. 段文件和热层尾部的异步复制、断点续传、校验失败重传、限速与副本提升
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/history_store.h"
+#include "../src/server/history_replication.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_HISTORY_DIR "/tmp/history_replication_test_history"
+#define TEST_HISTORY_DIR_B "/tmp/history_replication_test_history_b"
+
+// 辅助函数：删除历史存储目录
+static void remove_history_dir(void) {
+    remove_history_dir_at(TEST_HISTORY_DIR);
+}
+
+// 辅助函数：追加rows行 (每帧64个通道)，采集时间从first秒起每帧加1
+static void append_frames(history_store_t *hist, size_t rows, uint32_t first) {
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    for (size_t i = 0; i < rows / 64; i++) {
+        size_t len = build_realtime_content(content, first + (uint32_t)i, 64, (uint16_t)(i % 1000));
+        realtime_store_append(&hist->hot, &sender, content, len, 0);
+    }
+}
+
+// 辅助函数：主节点和副本上的同名文件内容相同
+static int same_file(const char *name) {
+    char path_a[320];
+    char path_b[320];
+    snprintf(path_a, sizeof(path_a), "%s/%s", TEST_HISTORY_DIR, name);
+    snprintf(path_b, sizeof(path_b), "%s/%s", TEST_HISTORY_DIR_B, name);
+    FILE *a = fopen(path_a, "rb");
+    FILE *b = fopen(path_b, "rb");
+    int same = a && b;
+    while (same) {
+        int ca = fgetc(a);
+        int cb = fgetc(b);
+        same = ca == cb;
+        if (ca == EOF) {
+            break;
+        }
+    }
+    if (a) {
+        fclose(a);
+    }
+    if (b) {
+        fclose(b);
+    }
+    return same;
+}
+
+// 辅助函数：在副本上放置段文件的前len字节作为未完成文件，corrupt时翻转其中一个字节
+static void plant_partial(uint64_t first_row, size_t len, int corrupt) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s/warm/seg-%020llu", TEST_HISTORY_DIR, (unsigned long long)first_row);
+    FILE *in = fopen(path, "rb");
+    uint8_t *data = malloc(len);
+    size_t n = in && data ? fread(data, 1, len, in) : 0;
+    if (corrupt && n > 0) {
+        data[n / 2] ^= 0xFF;
+    }
+    snprintf(path, sizeof(path), "%s/warm/part-%020llu", TEST_HISTORY_DIR_B, (unsigned long long)first_row);
+    FILE *out = fopen(path, "wb");
+    if (out) {
+        fwrite(data, 1, n, out);
+        fclose(out);
+    }
+    if (in) {
+        fclose(in);
+    }
+    free(data);
+}
+
+// 辅助函数：重启副本 (主节点先在断开的连接上失败一轮)，重启前放置未完成文件
+static int restart_replica(replica_t *replica, replication_t *repl, uint64_t first_row, int corrupt) {
+    replica_stop(replica);
+    int failed = replication_run_once(repl) < 0 && !repl->connected;
+    plant_partial(first_row, 100000, corrupt);
+    return failed && replica_start(replica, TEST_HISTORY_DIR_B, repl->port) == 0 ? 0 : -1;
+}
+
+// 测试用例1：历史数据异步复制
+void test_history_replication() {
+    TEST_HEADER("测试用例1：历史数据异步复制");
+
+    const uint64_t chunk = REALTIME_STORE_CHUNK_ROWS;
+    remove_history_dir();
+    remove_history_dir_at(TEST_HISTORY_DIR_B);
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    config.warm_max_bytes = UINT64_MAX;
+    config.warmup_threads = -1;
+    history_store_t hist;
+    replica_t replica;
+    TEST_ASSERT(history_init(&hist, &config) == 0 && replica_start(&replica, TEST_HISTORY_DIR_B, 0) == 0 &&
+                replica.port > 0, "主节点存储和副本启动");
+
+    // 两个写满的块写为温层段，第三块的1024行留在热层
+    append_frames(&hist, 2 * chunk + 1024, 70000);
+    history_migrate(&hist);
+    replication_t repl;
+    replication_config_t repl_config = {"127.0.0.1", replica.port, 16 << 20, 0};
+    TEST_ASSERT(replication_init(&repl, &hist, &repl_config) == 0, "复制初始化");
+    struct timespec begin;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    int result = replication_run_once(&repl);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (double)(end.tv_sec - begin.tv_sec) + (double)(end.tv_nsec - begin.tv_nsec) / 1e9;
+    TEST_ASSERT(result == 0 && repl.files_shipped == 2 && repl.tail_rows == 1024 && repl.lag_bytes == 0 &&
+                repl.lag_rows == 0 && repl.connected, "段文件和热层尾部复制后副本追平");
+    TEST_ASSERT(replica.files_committed == 2 && replica.sealed_end == 2 * chunk &&
+                replica.tail_end == 2 * chunk + 1024 && same_file("warm/seg-00000000000000000000") &&
+                same_file("warm/seg-00000000000000065536"), "副本的段文件与主节点相同");
+    TEST_ASSERT(elapsed >= (double)(repl.bytes_sent - (2 << 20)) / (16 << 20) * 0.9,
+                "发送速率不超过限速");
+    repl.max_bytes_per_sec = 0;
+
+    // 副本重启后报告未完成文件的大小，主节点从断点继续发送
+    append_frames(&hist, chunk, 71100);
+    history_migrate(&hist);
+    TEST_ASSERT(restart_replica(&replica, &repl, 2 * chunk, 0) == 0 && replica.tail_end == 2 * chunk + 1024,
+                "副本重启后从尾部日志恢复复制位置");
+    uint64_t sent = repl.bytes_sent;
+    struct stat st;
+    stat(TEST_HISTORY_DIR "/warm/seg-00000000000000131072", &st);
+    TEST_ASSERT(replication_run_once(&repl) == 0 && repl.resumed_files == 1 && repl.files_shipped == 3 &&
+                repl.bytes_sent - sent < (uint64_t)st.st_size &&
+                same_file("warm/seg-00000000000000131072"), "未完成的文件从断点续传");
+    TEST_ASSERT(replica.sealed_end == 3 * chunk && replica.tail_start == 3 * chunk &&
+                replica.tail_end == 3 * chunk + 1024, "段文件生效后尾部日志丢弃已覆盖的行");
+
+    // 未完成文件内容损坏时整个文件校验失败，丢弃后从头重传
+    append_frames(&hist, chunk, 72200);
+    history_migrate(&hist);
+    TEST_ASSERT(restart_replica(&replica, &repl, 3 * chunk, 1) == 0 && replication_run_once(&repl) < 0 &&
+                repl.checksum_failures == 1 && replica.checksum_failures == 1, "损坏的未完成文件校验失败");
+    TEST_ASSERT(replication_run_once(&repl) == 0 && repl.files_shipped == 4 &&
+                same_file("warm/seg-00000000000000196608") && replica.tail_end == 4 * chunk + 1024,
+                "校验失败的文件丢弃后从头重传");
+
+    // 主节点把温层段压缩为冷层段后，副本同样删除温层段
+    hist.warm_max_bytes = 1;
+    history_migrate(&hist);
+    TEST_ASSERT(hist.tier_segments[HISTORY_TIER_COLD] == 4 && replication_run_once(&repl) == 0 &&
+                repl.files_deleted == 4 && replica.files_deleted == 4 &&
+                same_file("cold/seg-00000000000000196608"), "压缩后的冷层段复制，温层段删除");
+    DIR *d = opendir(TEST_HISTORY_DIR_B "/warm");
+    struct dirent *entry;
+    int warm_files = 0;
+    while (d && (entry = readdir(d)) != NULL) {
+        warm_files += entry->d_name[0] != '.';
+    }
+    if (d) {
+        closedir(d);
+    }
+    TEST_ASSERT(warm_files == 0, "副本上没有多余的温层段");
+
+    // 提升副本：尾部日志中的行写为温层段，打开后与主节点的查询结果相同
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    int64_t primary_rows = count_history(&hist, INT64_MIN, INT64_MAX, &out);
+    replica_stop(&replica);
+    replication_destroy(&repl);
+    history_store_t promoted;
+    config.dir = TEST_HISTORY_DIR_B;
+    TEST_ASSERT(replica_promote(TEST_HISTORY_DIR_B) == 1024 &&
+                access(TEST_HISTORY_DIR_B "/" REPLICATION_TAIL_LOG, F_OK) != 0, "提升时尾部日志写为段");
+    TEST_ASSERT(history_init(&promoted, &config) == 0 && promoted.persisted_end == 4 * chunk + 1024 &&
+                primary_rows == (int64_t)(4 * chunk + 1024) &&
+                count_history(&promoted, INT64_MIN, INT64_MAX, &out) == primary_rows,
+                "提升后的副本提供与主节点相同的历史数据");
+
+    realtime_columns_free(&out);
+    history_destroy(&promoted);
+    history_destroy(&hist);
+    remove_history_dir();
+    remove_history_dir_at(TEST_HISTORY_DIR_B);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 历史数据异步复制测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_history_replication();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！历史数据复制工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查复制逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,395 @@
+/**
+ * @file history_store_test.c
+ * @brief 分层历史存储测试脚本
+ *
+ * 该测试脚本验证实时信息的分层历史存储，包括：
+ * 1. 分层历史存储的迁移、压缩、跨层查询和重启恢复
+ * 2. 离线导入的段与运行中的存储并存
+ * 3. 历史查询按分区并行执行、取消和内存上限
+ * 4. 按目录文件延迟加载段、首次访问时加载与后台预热
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/history_store.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_HISTORY_DIR "/tmp/history_store_test_history"
+
+// 辅助函数：删除历史存储目录
+static void remove_history_dir(void) {
+    remove_history_dir_at(TEST_HISTORY_DIR);
+}
+
+// 测试用例1：分层历史存储
+void test_history_store() {
+    TEST_HEADER("测试用例1：分层历史存储");
+
+    remove_history_dir();
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    config.hot_max_rows = 2 * REALTIME_STORE_CHUNK_ROWS;
+    config.warm_max_bytes = 6 << 20;    // 容纳两个温层段
+
+    history_store_t hist;
+    TEST_ASSERT(history_init(&hist, &config) == 0, "分层存储初始化");
+
+    // 第i块的采集时间为10000 + i秒，占有率为100 * i + 通道序号
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    int64_t migrated = 0;
+    for (int chunk = 0; chunk <= 5; chunk++) {
+        size_t len = build_realtime_content(content, 10000 + chunk, 64, (uint16_t)(chunk * 100));
+        int appends = chunk < 5 ? REALTIME_STORE_CHUNK_ROWS / 64 : 100;
+        for (int i = 0; i < appends; i++) {
+            realtime_store_append(&hist.hot, &sender, content, len, 0);
+        }
+        migrated += history_migrate(&hist);
+    }
+    uint64_t total = 5 * REALTIME_STORE_CHUNK_ROWS + 6400;
+    TEST_ASSERT(migrated == 5 * REALTIME_STORE_CHUNK_ROWS && hist.lost_rows == 0,
+                "写满的块在被热层淘汰前写为段，仍在追加的块留在内存");
+    TEST_ASSERT(hist.tier_segments[HISTORY_TIER_WARM] == 2 && hist.tier_segments[HISTORY_TIER_COLD] == 3,
+                "温层超过容量目标时最旧的段压缩到冷层");
+    TEST_ASSERT(hist.tier_bytes[HISTORY_TIER_COLD] * 10 < hist.tier_bytes[HISTORY_TIER_WARM],
+                "冷层段按列差分编码后明显小于温层段");
+
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    int ordered = 1;
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == (int64_t)total, "跨层查询每行只返回一次");
+    for (size_t i = 1; i < out.count; i++) {
+        ordered &= out.timestamp_ms[i] >= out.timestamp_ms[i - 1];
+    }
+    TEST_ASSERT(ordered && out.occupancy[0] == 0 && out.occupancy[2 * REALTIME_STORE_CHUNK_ROWS + 5] == 205 &&
+                out.occupancy[total - 1] == 563, "结果按行号顺序且冷层解压后数据不变");
+    TEST_ASSERT(hist.rows_served[HISTORY_TIER_HOT] == REALTIME_STORE_CHUNK_ROWS + 6400 &&
+                hist.rows_served[HISTORY_TIER_WARM] == REALTIME_STORE_CHUNK_ROWS &&
+                hist.rows_served[HISTORY_TIER_COLD] == 3 * REALTIME_STORE_CHUNK_ROWS,
+                "热层快照之前的行由温层和冷层提供");
+
+    TEST_ASSERT(count_history(&hist, 10001000, 10002000, &out) == REALTIME_STORE_CHUNK_ROWS &&
+                out.occupancy[0] == 100 && out.occupancy[out.count - 1] == 163, "时间条件只读取重叠的段");
+    history_destroy(&hist);
+
+    // 重启后从段文件恢复，冷层超过容量目标时删除最旧的段
+    config.cold_max_bytes = 1;
+    TEST_ASSERT(history_init(&hist, &config) == 0 && hist.persisted_end == total &&
+                hist.hot.total_rows == total, "重启后恢复段列表并从已持久化的行号继续");
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == (int64_t)total,
+                "关闭时热层剩余的行已写为段");
+    history_migrate(&hist);
+    TEST_ASSERT(hist.tier_segments[HISTORY_TIER_COLD] == 0 && hist.dropped_rows == 3 * REALTIME_STORE_CHUNK_ROWS &&
+                count_history(&hist, INT64_MIN, INT64_MAX, &out) == 2 * REALTIME_STORE_CHUNK_ROWS + 6400,
+                "冷层超过容量目标时删除最旧的段");
+
+    realtime_columns_free(&out);
+    history_destroy(&hist);
+    remove_history_dir();
+}
+
+// 测试用例2：导入段
+void test_history_import() {
+    TEST_HEADER("测试用例2：离线导入的段");
+
+    remove_history_dir();
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    history_store_t hist;
+    TEST_ASSERT(history_init(&hist, &config) == 0, "分层存储初始化");
+
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    for (uint32_t t = 0; t < 3; t++) {
+        size_t len = build_realtime_content(content, 20000 + t, 4, 0);
+        realtime_store_append(&hist.hot, &sender, content, len, 0);
+    }
+
+    // 导入工具在运行期间直接写入冷层段
+    realtime_columns_t imported;
+    realtime_columns_init(&imported, 0);
+    for (uint32_t t = 0; t < 10; t++) {
+        size_t len = build_realtime_content(content, 1000 + t, 4, 500);
+        realtime_decode_content(&imported, &sender, content, len, 0);
+    }
+    uint64_t first_row = history_import_next_row(TEST_HISTORY_DIR);
+    TEST_ASSERT(first_row == HISTORY_IMPORT_ROW_BIT &&
+                history_write_segment(TEST_HISTORY_DIR, HISTORY_TIER_COLD, &imported, first_row) > 0,
+                "导入段使用独立的行号空间");
+    TEST_ASSERT(history_import_next_row(TEST_HISTORY_DIR) == HISTORY_IMPORT_ROW_BIT + 40,
+                "下一次导入从已有导入段之后编号");
+
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == 12, "纳入前只返回接收路径的数据");
+    history_migrate(&hist);
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == 52 && out.occupancy[0] == 500 &&
+                out.timestamp_ms[51] == 20002500LL, "迁移时纳入导入段，查询时导入段在前");
+    history_destroy(&hist);
+
+    TEST_ASSERT(history_init(&hist, &config) == 0 && hist.persisted_end == 12 &&
+                count_history(&hist, INT64_MIN, INT64_MAX, &out) == 52,
+                "重启后导入段不影响接收路径的行号");
+
+    realtime_columns_free(&imported);
+    realtime_columns_free(&out);
+    history_destroy(&hist);
+    remove_history_dir();
+}
+
+// 并发查询线程的参数
+typedef struct {
+    history_store_t *hist;      // 存储
+    int64_t matched;            // 匹配的行数
+    int ordered;                // 结果是否按采集时间有序
+} parallel_query_t;
+
+// 并发查询线程：查询全部数据
+static void *parallel_query_thread(void *arg) {
+    parallel_query_t *task = (parallel_query_t *)arg;
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    task->matched = count_history(task->hist, INT64_MIN, INT64_MAX, &out);
+    task->ordered = 1;
+    for (size_t i = 1; i < out.count; i++) {
+        task->ordered &= out.timestamp_ms[i] >= out.timestamp_ms[i - 1];
+    }
+    realtime_columns_free(&out);
+    return NULL;
+}
+
+// 测试用例3：并行查询
+void test_history_parallel_query() {
+    TEST_HEADER("测试用例3：历史查询的并行执行");
+
+    remove_history_dir();
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    config.hot_max_rows = 2 * REALTIME_STORE_CHUNK_ROWS;
+    config.warm_max_bytes = 6 << 20;
+    config.query_threads = 3;
+
+    history_store_t hist;
+    TEST_ASSERT(history_init(&hist, &config) == 0 && hist.query_threads == 3, "启动查询工作线程");
+
+    // 与测试用例1相同的数据：3个冷层段、2个温层段和热层的2块
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    for (int chunk = 0; chunk <= 5; chunk++) {
+        size_t len = build_realtime_content(content, 10000 + chunk, 64, (uint16_t)(chunk * 100));
+        int appends = chunk < 5 ? REALTIME_STORE_CHUNK_ROWS / 64 : 100;
+        for (int i = 0; i < appends; i++) {
+            realtime_store_append(&hist.hot, &sender, content, len, 0);
+        }
+        history_migrate(&hist);
+    }
+    int64_t total = 5 * REALTIME_STORE_CHUNK_ROWS + 6400;
+
+    realtime_query_t query;
+    realtime_query_init(&query);
+    history_query_ctl_t ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    int ordered = 1;
+    TEST_ASSERT(history_query_run(&hist, &query, &ctl, &out) == total && ctl.status == HISTORY_QUERY_OK &&
+                ctl.partitions == 6 && ctl.skipped == 0, "按段和热层块拆分为分区");
+    for (size_t i = 1; i < out.count; i++) {
+        ordered &= out.timestamp_ms[i] >= out.timestamp_ms[i - 1];
+    }
+    TEST_ASSERT(ordered && out.occupancy[0] == 0 && out.occupancy[2 * REALTIME_STORE_CHUNK_ROWS + 5] == 205 &&
+                out.occupancy[total - 1] == 563, "部分结果按分区顺序合并");
+    TEST_ASSERT(ctl.reserved_bytes == (uint64_t)total * 37, "结束时只保留结果占用的内存");
+
+    // 取消的查询不执行剩余分区，输出不变
+    memset(&ctl, 0, sizeof(ctl));
+    out.count = 0;
+    history_query_cancel(&ctl);
+    TEST_ASSERT(history_query_run(&hist, &query, &ctl, &out) < 0 && ctl.status == HISTORY_QUERY_CANCELLED &&
+                ctl.skipped == 6 && out.count == 0, "取消的查询不执行剩余分区");
+
+    // 内存上限：冷层段按解压缓冲区和结果各一份预留
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.max_bytes = (uint64_t)REALTIME_STORE_CHUNK_ROWS * 37;
+    TEST_ASSERT(history_query_run(&hist, &query, &ctl, &out) < 0 && ctl.status == HISTORY_QUERY_OVER_LIMIT &&
+                out.count == 0, "超过内存上限的查询失败");
+    memset(&ctl, 0, sizeof(ctl));
+    ctl.max_bytes = (uint64_t)REALTIME_STORE_CHUNK_ROWS * 37 * 2;
+    query.start_ms = 10001000;
+    query.end_ms = 10002000;
+    TEST_ASSERT(history_query_run(&hist, &query, &ctl, &out) == REALTIME_STORE_CHUNK_ROWS &&
+                ctl.partitions == 3 && ctl.status == HISTORY_QUERY_OK, "时间条件之外的段和块不占用内存上限");
+
+    // 多个查询共用工作线程
+    parallel_query_t tasks[3];
+    pthread_t threads[3];
+    for (int t = 0; t < 3; t++) {
+        tasks[t].hist = &hist;
+        pthread_create(&threads[t], NULL, parallel_query_thread, &tasks[t]);
+    }
+    int concurrent_ok = 1;
+    for (int t = 0; t < 3; t++) {
+        pthread_join(threads[t], NULL);
+        concurrent_ok &= tasks[t].matched == total && tasks[t].ordered;
+    }
+    TEST_ASSERT(concurrent_ok, "并发查询共用工作线程，结果正确");
+
+    history_export_metrics(&hist);
+    TEST_ASSERT(hist.queries_cancelled == 1 && hist.queries_over_limit == 1, "取消和超限计入指标");
+
+    realtime_columns_free(&out);
+    history_destroy(&hist);
+    remove_history_dir();
+}
+
+// 辅助函数：已加载的段数
+static size_t loaded_segments(const history_store_t *hist) {
+    size_t loaded = 0;
+    for (size_t i = 0; i < hist->segment_count; i++) {
+        loaded += hist->segments[i]->state == 1;
+    }
+    return loaded;
+}
+
+// 测试用例4：延迟加载段
+void test_history_lazy_startup() {
+    TEST_HEADER("测试用例4：延迟加载段");
+
+    remove_history_dir();
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    config.hot_max_rows = REALTIME_STORE_CHUNK_ROWS;
+    config.warmup_threads = -1;
+    history_store_t hist;
+    TEST_ASSERT(history_init(&hist, &config) == 0, "分层存储初始化");
+
+    // 第i块的采集时间为30000 + i秒，关闭时写出最后一块
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    for (int chunk = 0; chunk < 3; chunk++) {
+        size_t len = build_realtime_content(content, 30000 + chunk, 64, (uint16_t)(chunk * 100));
+        for (int i = 0; i < REALTIME_STORE_CHUNK_ROWS / 64; i++) {
+            realtime_store_append(&hist.hot, &sender, content, len, 0);
+        }
+        history_migrate(&hist);
+    }
+    history_destroy(&hist);
+    TEST_ASSERT(access(TEST_HISTORY_DIR "/catalog", F_OK) == 0, "段列表写入目录文件");
+
+    // 重启时只按目录记录建立段，不打开段文件
+    TEST_ASSERT(history_init(&hist, &config) == 0 && hist.segment_count == 3 && hist.catalog_segments == 3 &&
+                loaded_segments(&hist) == 0 && hist.persisted_end == 3 * REALTIME_STORE_CHUNK_ROWS,
+                "启动时不打开段文件");
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    TEST_ASSERT(count_history(&hist, 30001000, 30002000, &out) == REALTIME_STORE_CHUNK_ROWS &&
+                out.occupancy[0] == 100 && hist.lazy_loads == 1 && loaded_segments(&hist) == 1,
+                "查询只加载时间范围重叠的段");
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == 3 * REALTIME_STORE_CHUNK_ROWS &&
+                hist.lazy_loads == 3, "全量查询加载其余的段");
+    history_destroy(&hist);
+
+    // 目录文件中没有的段 (崩溃前刚写出) 在启动时直接打开，并重写目录文件
+    realtime_columns_t extra;
+    realtime_columns_init(&extra, 0);
+    size_t len = build_realtime_content(content, 30003, 8, 0);
+    realtime_decode_content(&extra, &sender, content, len, 0);
+    history_write_segment(TEST_HISTORY_DIR, HISTORY_TIER_WARM, &extra, 3 * REALTIME_STORE_CHUNK_ROWS);
+    config.warmup_threads = 0;
+    TEST_ASSERT(history_init(&hist, &config) == 0 && hist.segment_count == 4 && hist.catalog_segments == 3 &&
+                hist.persisted_end == 3 * REALTIME_STORE_CHUNK_ROWS + 8, "目录文件之外的段在启动时打开");
+    history_wait_warmup(&hist);
+    TEST_ASSERT(loaded_segments(&hist) == 4 && hist.lazy_loads == 0, "预热线程加载全部段");
+    char damaged[320];
+    snprintf(damaged, sizeof(damaged), "%s", hist.segments[0]->path);
+    history_destroy(&hist);
+
+    // 与目录记录不符的段在首次访问时忽略
+    config.warmup_threads = -1;
+    TEST_ASSERT(truncate(damaged, 4096) == 0 && history_init(&hist, &config) == 0 && hist.catalog_segments == 4,
+                "重启后目录文件包含新段");
+    TEST_ASSERT(count_history(&hist, INT64_MIN, INT64_MAX, &out) == 2 * REALTIME_STORE_CHUNK_ROWS + 8 &&
+                loaded_segments(&hist) == 3, "损坏的段加载失败后被忽略");
+
+    realtime_columns_free(&extra);
+    realtime_columns_free(&out);
+    history_destroy(&hist);
+    remove_history_dir();
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 分层历史存储测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_history_store();
+    test_history_import();
+    test_history_parallel_query();
+    test_history_lazy_startup();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！分层历史存储工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查历史存储逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file query_cache_test.c
+ * @brief 聚合结果缓存测试脚本
+ *
+ * 该测试脚本验证历史数据分桶聚合查询的结果缓存，包括：
+ * 1. 分桶聚合结果缓存的增量补入、窗口滑动、失效和锁外计算
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/history_store.h"
+#include "../src/server/query_cache.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_HISTORY_DIR "/tmp/query_cache_test_history"
+
+// 辅助函数：删除历史存储目录
+static void remove_history_dir(void) {
+    remove_history_dir_at(TEST_HISTORY_DIR);
+}
+
+// 聚合查询线程
+typedef struct {
+    query_cache_t *cache;
+    realtime_query_t query;
+    query_bucket_t buckets[16];
+    int64_t result;
+    int done;
+} aggregate_arg_t;
+
+// 辅助函数：在另一个线程中执行聚合查询
+static void *aggregate_thread(void *arg) {
+    aggregate_arg_t *agg = (aggregate_arg_t *)arg;
+    agg->result = query_cache_aggregate(agg->cache, &agg->query, 60000, agg->buckets, 16);
+    __atomic_store_n(&agg->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 测试用例1：聚合结果缓存
+void test_query_cache() {
+    TEST_HEADER("测试用例1：聚合结果缓存");
+
+    remove_history_dir();
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = TEST_HISTORY_DIR;
+    history_store_t hist;
+    query_cache_t cache;
+    TEST_ASSERT(history_init(&hist, &config) == 0 && query_cache_init(&cache, &hist, 4) == 0,
+                "缓存初始化");
+
+    // 10分钟的数据，每分钟一个桶，每桶120行
+    append_seconds(&hist, 60000, 60599);
+    realtime_query_t query;
+    realtime_query_init(&query);
+    query.start_ms = 60000000;
+    query.end_ms = 60600000;
+    query_bucket_t buckets[16];
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 &&
+                buckets[0].start_ms == 60000000 && buckets[0].rows == 120 && buckets[9].count_c == 360 &&
+                buckets[4].occupancy_sum == 60 * (100 + 101) && cache.hits == 0 && cache.scanned_rows == 1200,
+                "首次查询完整计算各桶");
+
+    // 迟到数据和最新数据只补入对应的桶
+    append_seconds(&hist, 60200, 60200);
+    append_seconds(&hist, 60590, 60590);
+    query.start_ms = 60000001;     // 规范化后与上一次查询相同
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 && cache.hits == 1 &&
+                cache.scanned_rows == 1204 && cache.saved_rows == 1200, "命中时只聚合新追加的行");
+    TEST_ASSERT(buckets[3].rows == 122 && buckets[9].rows == 122 && buckets[5].rows == 120,
+                "迟到数据补入已结束的桶");
+
+    // 时间窗口向后滑动1分钟，只计算新增的时间段
+    append_seconds(&hist, 60600, 60609);
+    query.start_ms = 60060000;
+    query.end_ms = 60660000;
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 && cache.hits == 2 &&
+                cache.scanned_rows == 1224 && buckets[0].rows == 120 && buckets[2].rows == 122 &&
+                buckets[9].rows == 20, "窗口滑动时复用重叠的桶");
+
+    // 不同的过滤条件是不同的缓存项
+    query.channel_id = 1;
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 && cache.hits == 2 &&
+                buckets[0].rows == 60 && buckets[9].rows == 10, "按通道过滤的查询单独缓存");
+    query.channel_id = -1;
+
+    // 纳入导入段后缓存项整体重算
+    realtime_columns_t imported;
+    realtime_columns_init(&imported, 0);
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 2);
+    size_t len = build_realtime_content(content, 60100, 4, 0);
+    realtime_decode_content(&imported, &sender, content, len, 0);
+    history_write_segment(TEST_HISTORY_DIR, HISTORY_TIER_COLD, &imported, history_import_next_row(TEST_HISTORY_DIR));
+    history_migrate(&hist);
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 && cache.invalidations == 1 &&
+                buckets[0].rows == 124 && buckets[2].rows == 122, "纳入导入段后重算");
+
+    // 缓存项正在计算时 (锁外)，其他查询照常执行，相同的查询等待其完成后复用
+    query_cache_entry_t *busy = NULL;
+    for (size_t i = 0; i < cache.capacity; i++) {
+        if (cache.entries[i].valid && cache.entries[i].filter.channel_id == -1) {
+            busy = &cache.entries[i];
+        }
+    }
+    pthread_mutex_lock(&cache.lock);
+    busy->busy = 1;
+    pthread_mutex_unlock(&cache.lock);
+    query.channel_id = 2;
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) == 10 && buckets[0].rows == 61,
+                "其他缓存项计算期间不同的查询不被阻塞");
+    query.channel_id = -1;
+    aggregate_arg_t waiter;
+    memset(&waiter, 0, sizeof(waiter));
+    waiter.cache = &cache;
+    waiter.query = query;
+    pthread_t waiter_tid;
+    pthread_create(&waiter_tid, NULL, aggregate_thread, &waiter);
+    usleep(50000);
+    TEST_ASSERT(!__atomic_load_n(&waiter.done, __ATOMIC_ACQUIRE), "相同的查询等待正在进行的计算");
+    uint64_t hits = cache.hits;
+    pthread_mutex_lock(&cache.lock);
+    busy->busy = 0;
+    pthread_cond_broadcast(&cache.idle);
+    pthread_mutex_unlock(&cache.lock);
+    pthread_join(waiter_tid, NULL);
+    TEST_ASSERT(waiter.result == 10 && waiter.buckets[0].rows == 124 && cache.hits == hits + 1,
+                "计算完成后等待的查询复用缓存项");
+
+    // 超过输出容量、时间范围无界或桶宽超过上限时失败
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 4) < 0, "桶数超过输出容量时失败");
+    query.start_ms = INT64_MIN;
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, 60000, buckets, 16) < 0, "时间范围无界时失败");
+
+    // 超大桶宽：起点为负时对齐后的跨度超过INT64_MAX，按无符号计算
+    query.start_ms = -1000;
+    query.end_ms = 1000;
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, INT64_MAX, buckets, 16) < 0, "桶宽超过上限时失败");
+    TEST_ASSERT(query_cache_aggregate(&cache, &query, QUERY_CACHE_MAX_BUCKET_MS, buckets, 16) == 2 &&
+                buckets[0].start_ms == -QUERY_CACHE_MAX_BUCKET_MS && buckets[1].start_ms == 0 &&
+                buckets[0].rows == 0 && buckets[1].rows > 0, "上限内的超大桶宽正确对齐");
+
+    query_cache_export_metrics(&cache);
+    realtime_columns_free(&imported);
+    query_cache_destroy(&cache);
+    history_destroy(&hist);
+    remove_history_dir();
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 聚合结果缓存测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_query_cache();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！聚合结果缓存工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查缓存逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
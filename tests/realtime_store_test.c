@@ -0,0 +1,316 @@
+/**
+ * @file realtime_store_test.c
+ * @brief 交通流实时信息列式存储测试脚本
+ *
+ * 该测试脚本验证实时信息的列式解码与存储，包括：
+ * 1. 实时信息帧批量解码为列 (含转义帧)
+ * 2. 分块追加、快照稳定性与淘汰后快照仍可访问
+ * 3. 按时间、设备和通道的列式查询
+ * 4. 抓包文件写入与批量解码
+ * 5. 控制机收到实时信息时写入存储和抓包文件
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/capture.h"
+#include "../src/server/capture_writer.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/realtime_store.h"
+#include "../src/server/signal_controller.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_CAPTURE_FILE "/tmp/realtime_store_test.cap"
+
+// 测试用例1：列式解码
+void test_decode_columns() {
+    TEST_HEADER("测试用例1：实时信息帧解码为列");
+
+    realtime_columns_t columns;
+    TEST_ASSERT(realtime_columns_init(&columns, 0) == 0, "初始化列集合");
+
+    uint8_t buffer[MAX_FRAME_SIZE];
+    int len = encode_realtime_frame(buffer, sizeof(buffer), 7, 1700000000, 4, 300);
+    TEST_ASSERT(realtime_decode_frame(&columns, buffer, len, 42) == 4, "四个通道展开为四行");
+    TEST_ASSERT(columns.timestamp_ms[0] == 1700000000LL * 1000 + 500, "采集时间合并为毫秒");
+    TEST_ASSERT(columns.received_ns[3] == 42 && columns.device_id[3] == 7 &&
+                columns.admin_code[3] == TEST_ADMIN_CODE, "每行带接收时间和设备标识");
+    TEST_ASSERT(columns.channel_id[2] == 3 && columns.occupancy[2] == 302 &&
+                columns.length[2] == 45 && columns.speed[2] == 60, "通道字段按小端序解码");
+
+    // 占有率低字节为0xC0和0xDB，编码后含转义
+    len = encode_realtime_frame(buffer, sizeof(buffer), 8, 1700000001, 2, 0xC0);
+    TEST_ASSERT(memchr(buffer + 1, ESCAPE_CHAR, len - 2) != NULL, "测试帧包含转义字符");
+    TEST_ASSERT(realtime_decode_frame(&columns, buffer, len, 43) == 2 &&
+                columns.occupancy[4] == 0xC0 && columns.occupancy[5] == 0xC1,
+                "转义帧反转义后正确解码");
+
+    buffer[len / 2] ^= 0x01;
+    TEST_ASSERT(realtime_decode_frame(&columns, buffer, len, 44) < 0 && columns.count == 6,
+                "损坏帧被拒绝且不追加行");
+
+    realtime_columns_free(&columns);
+}
+
+// 测试用例2：分块与快照
+void test_chunks_and_snapshots() {
+    TEST_HEADER("测试用例2：分块追加与快照");
+
+    realtime_store_t store;
+    TEST_ASSERT(realtime_store_init(&store, 2 * REALTIME_STORE_CHUNK_ROWS) == 0, "初始化两块容量的存储");
+
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    size_t content_len = build_realtime_content(content, 1000, 64, 0);
+
+    // 写满第一块
+    for (int i = 0; i < REALTIME_STORE_CHUNK_ROWS / 64; i++) {
+        realtime_store_append(&store, &sender, content, content_len, 0);
+    }
+    realtime_snapshot_t first;
+    realtime_store_snapshot(&store, &first);
+    TEST_ASSERT(first.chunk_count == 1 && first.total_rows == REALTIME_STORE_CHUNK_ROWS, "第一块写满");
+    const uint16_t *first_occupancy = first.chunks[0]->columns.occupancy;
+
+    // 继续追加直到第一块被淘汰
+    content_len = build_realtime_content(content, 2000, 64, 1000);
+    for (int i = 0; i < 2 * REALTIME_STORE_CHUNK_ROWS / 64; i++) {
+        realtime_store_append(&store, &sender, content, content_len, 0);
+    }
+    TEST_ASSERT(store.chunk_count == 2 && store.evicted_rows == REALTIME_STORE_CHUNK_ROWS,
+                "超过保留容量时淘汰最旧的块");
+    TEST_ASSERT(first.rows[0] == REALTIME_STORE_CHUNK_ROWS && first.chunks[0]->columns.occupancy == first_occupancy &&
+                first_occupancy[REALTIME_STORE_CHUNK_ROWS - 1] == 63,
+                "被淘汰的块在快照释放前仍可访问");
+    realtime_snapshot_release(&first);
+
+    realtime_snapshot_t second;
+    realtime_store_snapshot(&store, &second);
+    TEST_ASSERT(second.total_rows == 2 * REALTIME_STORE_CHUNK_ROWS &&
+                second.chunks[0]->first_row == REALTIME_STORE_CHUNK_ROWS,
+                "新快照只包含保留的块");
+    realtime_snapshot_release(&second);
+
+    realtime_store_destroy(&store);
+}
+
+// 测试用例3：查询
+void test_query() {
+    TEST_HEADER("测试用例3：列式查询");
+
+    realtime_store_t store;
+    realtime_store_init(&store, 0);
+
+    uint8_t content[MAX_FRAME_SIZE];
+    for (uint16_t device = 1; device <= 3; device++) {
+        device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, device);
+        for (uint32_t t = 0; t < 100; t++) {
+            size_t len = build_realtime_content(content, 5000 + t, 4, device * 100);
+            realtime_store_append(&store, &sender, content, len, 0);
+        }
+    }
+
+    realtime_snapshot_t snapshot;
+    realtime_store_snapshot(&store, &snapshot);
+
+    realtime_query_t query;
+    realtime_columns_t out;
+    realtime_columns_init(&out, 0);
+    realtime_query_init(&query);
+    TEST_ASSERT(realtime_snapshot_query(&snapshot, &query, &out) == 1200, "无条件查询返回全部行");
+
+    out.count = 0;
+    query.start_ms = 5010LL * 1000;
+    query.end_ms = 5020LL * 1000;
+    query.match_device = 1;
+    query.device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 2);
+    query.channel_id = 3;
+    int64_t rows = realtime_snapshot_query(&snapshot, &query, &out);
+    int all_match = 1;
+    for (size_t i = 0; i < out.count; i++) {
+        all_match &= out.device_id[i] == 2 && out.channel_id[i] == 3 && out.occupancy[i] == 202 &&
+                     out.timestamp_ms[i] >= query.start_ms && out.timestamp_ms[i] < query.end_ms;
+    }
+    TEST_ASSERT(rows == 10 && all_match, "按时间、设备和通道过滤");
+
+    out.count = 0;
+    query.start_ms = 9000LL * 1000;
+    query.end_ms = INT64_MAX;
+    TEST_ASSERT(realtime_snapshot_query(&snapshot, &query, &out) == 0, "时间范围外的块被跳过");
+
+    realtime_columns_free(&out);
+    realtime_snapshot_release(&snapshot);
+    realtime_store_destroy(&store);
+}
+
+// 测试用例4：抓包文件
+void test_capture_file() {
+    TEST_HEADER("测试用例4：抓包文件写入与批量解码");
+
+    capture_writer_t writer;
+    TEST_ASSERT(capture_writer_open(&writer, TEST_CAPTURE_FILE) == 0, "创建抓包文件");
+
+    uint8_t buffer[MAX_FRAME_SIZE];
+    for (int i = 0; i < 50; i++) {
+        int len = encode_realtime_frame(buffer, sizeof(buffer), 9, 6000 + i, 2, 10);
+        capture_writer_write(&writer, 1000 + i, buffer, len);
+    }
+
+    // 非实时信息帧应被跳过
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 9),
+                                   create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    int len = encode_frame(&frame, buffer, sizeof(buffer));
+    free_frame(&frame);
+    capture_writer_write(&writer, 2000, buffer, len);
+    TEST_ASSERT(writer.records == 51, "记录数正确");
+    capture_writer_close(&writer);
+
+    capture_reader_t reader;
+    TEST_ASSERT(capture_reader_open(&reader, TEST_CAPTURE_FILE) == 0, "映射抓包文件");
+
+    realtime_columns_t columns;
+    realtime_columns_init(&columns, 0);
+    uint64_t bad = 0;
+    int64_t rows = realtime_decode_capture(&columns, &reader, &bad);
+    TEST_ASSERT(rows == 100 && bad == 0, "批量解码出全部实时信息行");
+    TEST_ASSERT(columns.received_ns[99] == 1049 && columns.timestamp_ms[99] == 6049LL * 1000 + 500,
+                "接收时间取自抓包记录");
+
+    realtime_columns_free(&columns);
+    capture_reader_close(&reader);
+    unlink(TEST_CAPTURE_FILE);
+}
+
+// 测试用例5：控制机写入存储
+void test_controller_ingest() {
+    TEST_HEADER("测试用例5：控制机写入存储和抓包");
+
+    realtime_store_t store;
+    realtime_store_init(&store, 0);
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+    signal_controller_set_realtime_store(controller, &store);
+    TEST_ASSERT(signal_controller_set_capture_file(controller, TEST_CAPTURE_FILE) == 0, "开启抓包");
+
+    int sv[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+    client_info_t *client = &controller->clients[0];
+    memset(client, 0, sizeof(*client));
+    client->sockfd = sv[0];
+    client->connected = 1;
+    client->last_heartbeat = time(NULL);
+    controller->client_count++;
+
+    // 先注册设备11，之后的实时信息才被接受
+    protocol_frame_t request;
+    request.frame_start = FRAME_START;
+    request.frame_end = FRAME_END;
+    request.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 11),
+                                     create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, 1),
+                                     OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    uint8_t buffer[MAX_FRAME_SIZE];
+    int request_len = encode_frame(&request, buffer, sizeof(buffer));
+    free_frame(&request);
+    write(sv[1], buffer, request_len);
+
+    for (int i = 0; i < 3; i++) {
+        int len = encode_realtime_frame(buffer, sizeof(buffer), 11, 7000 + i, 8, 50);
+        write(sv[1], buffer, len);
+    }
+    handle_client_message(controller, 0);
+    TEST_ASSERT(store.total_rows == 24, "实时信息按通道写入存储");
+    TEST_ASSERT(controller->capture.records == 4, "收到的帧写入抓包文件");
+
+    disconnect_client(controller, 0);
+    signal_controller_stop(controller);
+    close(sv[1]);
+
+    capture_reader_t reader;
+    realtime_columns_t columns;
+    realtime_columns_init(&columns, 0);
+    capture_reader_open(&reader, TEST_CAPTURE_FILE);
+    TEST_ASSERT(realtime_decode_capture(&columns, &reader, NULL) == 24, "抓包文件可回放");
+    capture_reader_close(&reader);
+    realtime_columns_free(&columns);
+    unlink(TEST_CAPTURE_FILE);
+
+    free(controller);
+    realtime_store_destroy(&store);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 实时信息列式存储测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_decode_columns();
+    test_chunks_and_snapshots();
+    test_query();
+    test_capture_file();
+    test_controller_ingest();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！列式存储功能工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查列式存储逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file rule_engine_test.c
+ * @brief 阈值规则引擎测试脚本
+ *
+ * 该测试脚本验证实时信息上的阈值规则评估，包括：
+ * 1. 阈值规则的编译、持续与相邻条件、重载后保留状态
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/common/realtime_codec.h"
+#include "../src/server/rule_engine.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+/**
+ * @brief 规则事件计数
+ */
+typedef struct {
+    int firing;
+    int cleared;
+    int last_channel;
+} rule_event_count_t;
+
+static void count_rule_event(void *ctx, const rule_event_t *event) {
+    rule_event_count_t *count = (rule_event_count_t *)ctx;
+    if (event->type == RULE_EVENT_FIRING) {
+        count->firing++;
+    } else {
+        count->cleared++;
+    }
+    count->last_channel = event->channel_id;
+}
+
+/**
+ * @brief 以now_ms为接收时间评估一次
+ */
+static int evaluate_rules(rule_engine_t *engine, realtime_columns_t *rows, int64_t now_ms) {
+    for (size_t i = 0; i < rows->count; i++) {
+        rows->received_ns[i] = now_ms * 1000000LL;
+    }
+    return rule_engine_evaluate(engine, rows, now_ms);
+}
+
+// 测试用例1：阈值规则引擎
+void test_rule_engine() {
+    TEST_HEADER("测试用例1：阈值规则引擎");
+
+    rule_engine_t engine;
+    rule_event_count_t count = {0, 0, 0};
+    TEST_ASSERT(rule_engine_init(&engine, NULL, 2) == 0 && engine.worker_count == 1,
+                "规则引擎初始化，启动1个常驻工作线程");
+    rule_engine_set_callback(&engine, count_rule_event, &count);
+
+    // 一个设备4个通道，占有率900~903；通道1~3速度改为5
+    realtime_columns_t rows;
+    realtime_columns_init(&rows, 16);
+    device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 51);
+    uint8_t content[MAX_CONTENT_SIZE];
+    size_t len = build_realtime_content(content, 100000, 4, 900);
+    realtime_decode_content(&rows, &device, content, len, 0);
+    rows.speed[0] = rows.speed[1] = rows.speed[2] = 5;
+
+    char rules[512];
+    snprintf(rules, sizeof(rules),
+             "# 注释行\n"
+             "occ: occupancy > 901 and admin_code == %u for 60s\n"
+             "slow: speed < 10 adjacent 3\n"
+             "any: not (speed >= 10) or count_a > 300\n"
+             "other: occupancy > 0 and admin_code == %u\n",
+             (unsigned)TEST_ADMIN_CODE, (unsigned)TEST_ADMIN_CODE + 1);
+    TEST_ASSERT(rule_engine_load_string(&engine, rules) == 4, "加载4条规则");
+    TEST_ASSERT(rule_engine_load_string(&engine, "bad: speed <> 3\n") < 0 && engine.set->count == 4,
+                "语法错误时保留原规则集");
+
+    int64_t now = 1700000000000LL;
+    TEST_ASSERT(evaluate_rules(&engine, &rows, now) == 4 && count.firing == 4,
+                "相邻3通道触发1次、低速触发3次，持续条件尚未满足");
+    TEST_ASSERT(evaluate_rules(&engine, &rows, now + 30000) == 0, "状态不变时不重复产生事件");
+    count.firing = 0;
+    TEST_ASSERT(evaluate_rules(&engine, &rows, now + 60000) == 2 && count.firing == 2,
+                "占有率持续60秒后通道3、4触发");
+
+    rows.occupancy[3] = 100;
+    TEST_ASSERT(evaluate_rules(&engine, &rows, now + 61000) == 1 && count.cleared == 1 &&
+                count.last_channel == 4, "条件不再满足时通道4解除");
+
+    // 重载：occ不变保留状态，slow改为相邻2通道重新开始
+    snprintf(rules, sizeof(rules),
+             "occ: occupancy > 901 and admin_code == %u for 60s\n"
+             "slow: speed < 10 adjacent 2\n", (unsigned)TEST_ADMIN_CODE);
+    count.firing = 0;
+    count.cleared = 0;
+    rule_engine_load_string(&engine, rules);
+    TEST_ASSERT(count.cleared == 4, "删除和修改的规则补发解除事件");
+    TEST_ASSERT(evaluate_rules(&engine, &rows, now + 62000) == 2 && count.firing == 2,
+                "重载后未变的规则不重复触发，修改的规则重新评估");
+
+    // 周期评估线程运行期间不能直接替换规则集
+    engine.running = 1;
+    TEST_ASSERT(rule_engine_load_string(&engine, rules) < 0, "运行中拒绝直接加载规则");
+    engine.running = 0;
+
+    // 记录过期 (设备停止上传) 时已触发的条件解除
+    count.cleared = 0;
+    TEST_ASSERT(rule_engine_evaluate(&engine, &rows, now + 62000 + RULE_DEFAULT_STALE_MS + 1) == 3 &&
+                count.cleared == 3, "过期记录不参与评估");
+
+    realtime_columns_free(&rows);
+    rule_engine_destroy(&engine);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 阈值规则引擎测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_rule_engine();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！规则引擎工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查规则引擎逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
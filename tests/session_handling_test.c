@@ -0,0 +1,805 @@
+/**
+ * @file session_handling_test.c
+ * @brief 交通信号控制机连接会话处理测试脚本
+ *
+ * 该测试脚本通过socketpair模拟检测器连接，验证控制机的会话管理，包括：
+ * 1. 单连接承载多个逻辑检测器的注册
+ * 2. 应答按发送方标识寻址
+ * 3. 逻辑检测器的独立心跳超时
+ * 4. 待注册连接的提升、拒绝与注册超时
+ * 5. 共享接收缓冲区与残留帧暂存
+ * 6. 主循环中检测器先后连接注册不互相阻塞
+ * 7. TCP_INFO链路采样与劣化标志
+ * 8. 指标表扩容与按标签删除
+ * 9. 数据帧发送方校验
+ * 10. 延迟直方图分桶与百分位计算
+ * 11. 接收时间戳缺失时的回退
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/server/signal_controller.h"
+#include "../src/utils/logger.h"
+#include "../src/utils/metrics.h"
+#include "../src/utils/latency_histogram.h"
+#include "../src/utils/socket_utils.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_ADMIN_CODE 0x110100
+
+// 辅助函数：将控制机的客户端槽位绑定到socketpair的一端
+// 返回检测器侧的socket
+static int attach_test_client(signal_controller_t *controller, int client_idx) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        return -1;
+    }
+
+    client_info_t *client = &controller->clients[client_idx];
+    memset(client, 0, sizeof(*client));
+    client->sockfd = sv[0];
+    client->connected = 1;
+    client->last_heartbeat = time(NULL);
+    strcpy(client->ip_addr, "127.0.0.1");
+    controller->client_count++;
+
+    return sv[1];
+}
+
+// 辅助函数：将控制机的待注册槽位绑定到socketpair的一端
+// 返回检测器侧的socket
+static int attach_pending_client(signal_controller_t *controller, int pending_idx) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        return -1;
+    }
+
+    pending_conn_t *pending = &controller->pending[pending_idx];
+    memset(pending, 0, sizeof(*pending));
+    pending->sockfd = sv[0];
+    pending->accepted_at = time(NULL);
+    controller->pending_count++;
+
+    return sv[1];
+}
+
+// 辅助函数：以指定设备编号发送一帧到控制机
+static int send_test_frame(int fd, uint16_t device_id, uint8_t operation, uint16_t object_id,
+                           const uint8_t *content, uint16_t content_len) {
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, device_id),
+                                   create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, 1),
+                                   operation, object_id, content, content_len);
+
+    uint8_t buffer[MAX_FRAME_SIZE];
+    int len = encode_frame(&frame, buffer, sizeof(buffer));
+    free_frame(&frame);
+    if (len <= 0) {
+        return -1;
+    }
+    return (int)write(fd, buffer, len);
+}
+
+// 辅助函数：读取并解码控制机发来的一帧
+static int read_response_frame(int fd, protocol_frame_t *frame) {
+    uint8_t buffer[MAX_FRAME_SIZE];
+    size_t len = 0;
+
+    // 逐字节读取直到帧结束标识
+    while (len < sizeof(buffer)) {
+        if (read(fd, &buffer[len], 1) != 1) {
+            return -1;
+        }
+        len++;
+        if (len > 1 && buffer[len - 1] == FRAME_END) {
+            break;
+        }
+    }
+    return decode_frame(buffer, len, frame) == PROTOCOL_SUCCESS ? 0 : -1;
+}
+
+// 测试用例1：单连接多逻辑检测器注册
+void test_multi_device_registration() {
+    TEST_HEADER("测试用例1：单连接多逻辑检测器注册");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+    int peer = attach_test_client(controller, 0);
+    TEST_ASSERT(peer >= 0, "创建模拟连接成功");
+
+    // 只有一个逻辑检测器时只使用内嵌的子会话槽位
+    client_info_t *client = &controller->clients[0];
+    send_test_frame(peer, 101, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->session_count == 1 && client->session.in_use && client->extra_sessions == NULL,
+                "单个逻辑检测器不分配额外的子会话槽位");
+
+    // 三个逻辑检测器通过同一连接注册
+    for (uint16_t id = 102; id <= 103; id++) {
+        send_test_frame(peer, id, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    }
+    handle_client_message(controller, 0);
+
+    TEST_ASSERT(client->session_count == 3 && client->extra_sessions != NULL, "同一连接注册了3个逻辑检测器");
+
+    device_id_t id102 = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 102);
+    client_session_t *session = find_client_session(client, &id102);
+    TEST_ASSERT(session != NULL && session->registered, "按设备标识找到子会话");
+
+    // 重复注册不应新增子会话
+    send_test_frame(peer, 102, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->session_count == 3, "重复连接请求复用已有子会话");
+
+    // 每个连接请求的应答都寻址到对应的逻辑检测器
+    int addressed_ok = 1;
+    uint16_t expected[] = {101, 102, 103, 102};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        protocol_frame_t response;
+        if (read_response_frame(peer, &response) < 0 ||
+            response.data.operation != OP_SET_RESPONSE ||
+            response.data.receiver.device_id != expected[i]) {
+            addressed_ok = 0;
+        }
+        free_frame(&response);
+    }
+    TEST_ASSERT(addressed_ok, "连接应答按发送方标识寻址");
+
+    // 统计数据应答也应寻址到发送方
+    uint8_t stats[] = {0x01, 0x02};
+    send_test_frame(peer, 103, OP_UPLOAD, OBJ_TRAFFIC_STATS, stats, sizeof(stats));
+    handle_client_message(controller, 0);
+    protocol_frame_t ack;
+    int ack_ok = read_response_frame(peer, &ack) == 0 &&
+                 ack.data.operation == OP_UPLOAD_RESPONSE &&
+                 ack.data.receiver.device_id == 103;
+    free_frame(&ack);
+    TEST_ASSERT(ack_ok, "统计数据应答寻址到发送方逻辑检测器");
+
+    disconnect_client(controller, 0);
+    TEST_ASSERT(client->session_count == 0 && client->extra_sessions == NULL, "断开连接后清空并释放子会话");
+
+    close(peer);
+    free(controller);
+}
+
+// 测试用例2：逻辑检测器独立心跳超时
+void test_per_session_heartbeat_timeout() {
+    TEST_HEADER("测试用例2：逻辑检测器独立心跳超时");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+    int peer = attach_test_client(controller, 0);
+
+    send_test_frame(peer, 201, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    send_test_frame(peer, 202, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    handle_client_message(controller, 0);
+
+    client_info_t *client = &controller->clients[0];
+    TEST_ASSERT(client->session_count == 2, "注册了2个逻辑检测器");
+
+    // 模拟设备201长时间无心跳
+    device_id_t id201 = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 201);
+    find_client_session(client, &id201)->last_heartbeat -= HEARTBEAT_TIMEOUT + 1;
+    check_heartbeat_timeout(controller);
+
+    TEST_ASSERT(client->connected, "仍有存活的逻辑检测器时保持连接");
+    TEST_ASSERT(client->session_count == 1, "超时的逻辑检测器被释放");
+    TEST_ASSERT(find_client_session(client, &id201) == NULL, "超时子会话不可再查找");
+
+    // 剩余的逻辑检测器也超时后断开连接
+    device_id_t id202 = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 202);
+    find_client_session(client, &id202)->last_heartbeat -= HEARTBEAT_TIMEOUT + 1;
+    client->last_heartbeat -= HEARTBEAT_TIMEOUT + 1;
+    check_heartbeat_timeout(controller);
+    TEST_ASSERT(!client->connected, "所有逻辑检测器超时后断开连接");
+
+    close(peer);
+    free(controller);
+}
+
+// 测试用例3：待注册连接的提升与拒绝
+void test_pending_registration() {
+    TEST_HEADER("测试用例3：待注册连接的提升与拒绝");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+
+    // 连接请求与实时数据一同到达
+    int peer = attach_pending_client(controller, 0);
+    uint8_t realtime[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    send_test_frame(peer, 301, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    send_test_frame(peer, 301, OP_UPLOAD, OBJ_DETECTOR_STATUS, realtime, sizeof(realtime));
+
+    int client_idx = handle_pending_message(controller, 0);
+    TEST_ASSERT(client_idx >= 0, "有效连接请求后提升为完整连接");
+    TEST_ASSERT(controller->pending_count == 0 && controller->pending[0].sockfd < 0,
+                "提升后释放待注册槽位");
+    TEST_ASSERT(client_idx >= 0 && controller->clients[client_idx].session_count == 1,
+                "提升后注册了逻辑检测器");
+
+    // 连接应答和随后帧的应答都应送达
+    protocol_frame_t response;
+    int set_ok = read_response_frame(peer, &response) == 0 &&
+                 response.data.operation == OP_SET_RESPONSE;
+    free_frame(&response);
+    int status_ok = read_response_frame(peer, &response) == 0 &&
+                    response.data.object_id == OBJ_DETECTOR_STATUS;
+    free_frame(&response);
+    TEST_ASSERT(set_ok && status_ok, "随连接请求到达的后续帧被处理");
+    if (client_idx >= 0) {
+        disconnect_client(controller, client_idx);
+    }
+    close(peer);
+
+    // 未注册就上传数据的连接被关闭
+    peer = attach_pending_client(controller, 1);
+    send_test_frame(peer, 302, OP_UPLOAD, OBJ_TRAFFIC_REALTIME, realtime, sizeof(realtime));
+    TEST_ASSERT(handle_pending_message(controller, 1) == -2, "未注册即上传数据的连接被关闭");
+    TEST_ASSERT(controller->client_count == 0, "被拒绝的连接不占用客户端槽位");
+    close(peer);
+
+    // 垃圾数据填满小缓冲区后被关闭
+    peer = attach_pending_client(controller, 2);
+    uint8_t junk[PENDING_RECV_BUFFER_SIZE];
+    memset(junk, 0x55, sizeof(junk));
+    write(peer, junk, sizeof(junk));
+    TEST_ASSERT(handle_pending_message(controller, 2) == -2, "垃圾数据填满缓冲区后连接被关闭");
+    close(peer);
+
+    // 超过注册时限的连接被关闭
+    peer = attach_pending_client(controller, 3);
+    controller->pending[3].accepted_at -= REGISTRATION_TIMEOUT + 1;
+    expire_pending_connections(controller);
+    TEST_ASSERT(controller->pending[3].sockfd < 0 && controller->pending_count == 0,
+                "超过注册时限的连接被关闭");
+    close(peer);
+
+    free(controller);
+}
+
+// 测试用例4：共享接收缓冲区与残留帧暂存
+void test_partial_frame_stash() {
+    TEST_HEADER("测试用例4：共享接收缓冲区与残留帧暂存");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+    int peer = attach_test_client(controller, 0);
+    client_info_t *client = &controller->clients[0];
+
+    // 完整帧处理后不保留任何暂存
+    send_test_frame(peer, 401, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->session_count == 1 && client->stash == NULL && client->stash_len == 0,
+                "完整帧就地处理，无残留暂存");
+
+    // 构造一个完整帧和一个被截断的帧
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 402),
+                                   create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    uint8_t encoded[MAX_FRAME_SIZE];
+    int encoded_len = encode_frame(&frame, encoded, sizeof(encoded));
+    free_frame(&frame);
+
+    size_t split = (size_t)encoded_len / 2;
+    write(peer, encoded, split);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->stash_len == split, "不完整帧转入暂存");
+    TEST_ASSERT(client->stash_capacity == BUFFER_POOL_MIN_CLASS_SIZE,
+                "暂存块取自最小尺寸等级");
+    TEST_ASSERT(controller->stash_pool.bytes_in_use == BUFFER_POOL_MIN_CLASS_SIZE,
+                "缓冲区池记录使用中的暂存");
+
+    // 补齐剩余数据后完成注册并释放暂存
+    write(peer, encoded + split, encoded_len - split);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->session_count == 2, "拼接暂存后成功处理跨包帧");
+    TEST_ASSERT(client->stash == NULL && controller->stash_pool.bytes_in_use == 0,
+                "处理完成后暂存归还缓冲区池");
+
+    // 断开连接时归还暂存
+    write(peer, encoded, split);
+    handle_client_message(controller, 0);
+    disconnect_client(controller, 0);
+    TEST_ASSERT(controller->stash_pool.bytes_in_use == 0, "断开连接时归还暂存");
+
+    buffer_pool_destroy(&controller->stash_pool);
+    close(peer);
+    free(controller);
+}
+
+// 辅助函数：控制机主循环线程
+static void *controller_thread(void *arg) {
+    signal_controller_start((signal_controller_t *)arg);
+    return NULL;
+}
+
+// 辅助函数：以TCP连接到本机端口，接收超时为timeout_sec秒
+static int connect_detector(int port, int timeout_sec) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {timeout_sec, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 测试用例5：主循环中检测器先后连接注册
+void test_back_to_back_registration() {
+    TEST_HEADER("测试用例5：主循环中检测器先后连接注册");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, 0);
+
+    pthread_t thread;
+    pthread_create(&thread, NULL, controller_thread, controller);
+
+    // 等待主循环启动并取得系统分配的端口
+    int port = 0;
+    for (int i = 0; i < 200 && port == 0; i++) {
+        usleep(10000);
+        if (controller->running) {
+            struct sockaddr_in addr;
+            socklen_t addr_len = sizeof(addr);
+            if (getsockname(controller->server_sockfd, (struct sockaddr *)&addr, &addr_len) == 0) {
+                port = ntohs(addr.sin_port);
+            }
+        }
+    }
+    TEST_ASSERT(port > 0, "控制机主循环启动");
+
+    // 第一个检测器注册后保持连接，不再发送数据
+    int first = connect_detector(port, 2);
+    send_test_frame(first, 501, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    protocol_frame_t response;
+    int first_ok = read_response_frame(first, &response) == 0 &&
+                   response.data.operation == OP_SET_RESPONSE;
+    free_frame(&response);
+    TEST_ASSERT(first_ok, "第一个检测器收到连接应答");
+
+    // 第二个检测器紧接着注册，主循环不应阻塞在第一个连接上
+    int second = connect_detector(port, 2);
+    send_test_frame(second, 502, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    int second_ok = read_response_frame(second, &response) == 0 &&
+                    response.data.operation == OP_SET_RESPONSE &&
+                    response.data.receiver.device_id == 502;
+    free_frame(&response);
+    TEST_ASSERT(second_ok, "第二个检测器在超时之前收到连接应答");
+    TEST_ASSERT(controller->client_count == 2, "两个检测器都成为完整连接");
+
+    controller->running = 0;
+    pthread_join(thread, NULL);
+    signal_controller_stop(controller);
+    close(first);
+    close(second);
+    free(controller);
+}
+
+// 辅助函数：建立一对本机TCP连接，sv[0]为控制机侧
+static int tcp_socket_pair(int sv[2]) {
+    sv[0] = sv[1] = -1;
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listen_fd, 1) < 0 ||
+        getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len) < 0) {
+        close(listen_fd);
+        return -1;
+    }
+    sv[1] = connect_detector(ntohs(addr.sin_port), 2);
+    sv[0] = sv[1] >= 0 ? accept(listen_fd, NULL, NULL) : -1;
+    close(listen_fd);
+    return sv[0] >= 0 ? 0 : -1;
+}
+
+// 测试用例6：TCP_INFO链路采样与劣化标志
+void test_tcp_link_sampling() {
+    TEST_HEADER("测试用例6：TCP_INFO链路采样与劣化标志");
+
+    metrics_init();
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+
+    int sv[2] = {-1, -1};
+    TEST_ASSERT(tcp_socket_pair(sv) == 0, "建立本机TCP连接");
+    client_info_t *client = &controller->clients[0];
+    memset(client, 0, sizeof(*client));
+    client->sockfd = sv[0];
+    client->connected = 1;
+    client->last_heartbeat = time(NULL);
+    strcpy(client->ip_addr, "127.0.0.1");
+    controller->client_count++;
+
+    send_test_frame(sv[1], 601, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    send_test_frame(sv[1], 602, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    usleep(10000);
+    handle_client_message(controller, 0);
+    TEST_ASSERT(client->session_count == 2, "同一TCP连接注册了2个逻辑检测器");
+
+    char labels601[METRICS_LABELS_SIZE];
+    char labels602[METRICS_LABELS_SIZE];
+    snprintf(labels601, sizeof(labels601), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 601);
+    snprintf(labels602, sizeof(labels602), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 602);
+
+    // 首次采样：记录内核链路状态并按逻辑检测器导出
+    tcp_link_stats_t *stats = &client->link_stats;
+    TEST_ASSERT(sample_client_tcp_info(controller, 0) == 0 && stats->sampled, "采样TCP_INFO成功");
+    TEST_ASSERT(stats->snd_cwnd > 0 && !stats->degraded, "本机连接有拥塞窗口且链路正常");
+    TEST_ASSERT(metrics_get("traffic_link_cwnd", labels601) == stats->snd_cwnd &&
+                metrics_get("traffic_link_cwnd", labels602) == stats->snd_cwnd,
+                "两个逻辑检测器都导出了链路指标");
+    TEST_ASSERT(metrics_get("traffic_link_degraded", labels601) == 0, "劣化标志为0");
+
+    // 模拟上个采样周期以来新增TCP_DEGRADED_RETRANS次重传
+    stats->total_retrans -= TCP_DEGRADED_RETRANS;
+    sample_client_tcp_info(controller, 0);
+    TEST_ASSERT(stats->degraded, "新增重传达到阈值时链路标记为劣化");
+    TEST_ASSERT(metrics_get("traffic_link_degraded", labels602) == 1 &&
+                metrics_get("traffic_links_degraded", NULL) == 1,
+                "劣化标志和劣化连接数指标更新");
+
+    // 没有新增重传时恢复
+    sample_client_tcp_info(controller, 0);
+    TEST_ASSERT(!stats->degraded && metrics_get("traffic_links_degraded", NULL) == 0,
+                "没有新增重传时链路恢复");
+
+    // 劣化状态下断开连接时劣化连接数回退，设备指标被删除
+    stats->total_retrans -= TCP_DEGRADED_RETRANS;
+    sample_client_tcp_info(controller, 0);
+    disconnect_client(controller, 0);
+    TEST_ASSERT(metrics_get("traffic_links_degraded", NULL) == 0, "断开劣化连接后劣化连接数回退");
+    TEST_ASSERT(metrics_get("traffic_link_cwnd", labels601) == 0 &&
+                metrics_count() == 1, "断开连接后删除逻辑检测器的链路指标");
+
+    // 已断开的连接不再采样
+    TEST_ASSERT(sample_client_tcp_info(controller, 0) < 0, "未连接的槽位不采样");
+
+    close(sv[1]);
+    free(controller);
+    metrics_init();
+}
+
+// 测试用例7：指标表扩容与按标签删除
+void test_metrics_table_growth() {
+    TEST_HEADER("测试用例7：指标表扩容与按标签删除");
+
+    metrics_init();
+
+    // 满负载：MAX_CLIENTS个连接 x MAX_SESSIONS_PER_CLIENT个逻辑检测器 x 8项链路指标
+    static const char *names[] = {
+        "traffic_link_srtt_us", "traffic_link_rttvar_us", "traffic_link_retrans_total",
+        "traffic_link_cwnd", "traffic_link_unacked_bytes", "traffic_link_send_queue_bytes",
+        "traffic_link_recv_queue_bytes", "traffic_link_degraded"
+    };
+    int devices = MAX_CLIENTS * MAX_SESSIONS_PER_CLIENT;
+    char labels[METRICS_LABELS_SIZE];
+    for (int d = 0; d < devices; d++) {
+        snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, d);
+        for (int n = 0; n < 8; n++) {
+            metrics_gauge_set(names[n], labels, d * 8 + n);
+        }
+    }
+    TEST_ASSERT(metrics_count() == devices * 8, "满负载的链路指标全部保存");
+    TEST_ASSERT(metrics_count() > METRICS_INITIAL_ENTRIES, "指标数超过初始容量时表扩容");
+
+    int values_ok = 1;
+    for (int d = 0; d < devices; d += 97) {
+        snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, d);
+        if (metrics_get("traffic_link_degraded", labels) != d * 8 + 7) {
+            values_ok = 0;
+        }
+    }
+    TEST_ASSERT(values_ok, "扩容后指标值不变");
+
+    // 反复下线和上线设备：墓碑被复用或清除，条目数保持不变
+    for (int round = 0; round < 20; round++) {
+        for (int d = 0; d < devices; d += 2) {
+            snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, d);
+            metrics_remove_labels(labels);
+        }
+        for (int d = 0; d < devices; d += 2) {
+            snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, d);
+            for (int n = 0; n < 8; n++) {
+                metrics_gauge_set(names[n], labels, round);
+            }
+        }
+    }
+    snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 2);
+    TEST_ASSERT(metrics_count() == devices * 8 && metrics_get("traffic_link_cwnd", labels) == 19,
+                "反复删除和重新创建后指标完整");
+
+    // 按标签删除只影响该标签
+    metrics_gauge_set("traffic_clients_connected", NULL, 5);
+    metrics_remove_labels(labels);
+    snprintf(labels, sizeof(labels), "device=\"%06X-%04X-%04X\"", TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 3);
+    TEST_ASSERT(metrics_count() == devices * 8 - 8 + 1 &&
+                metrics_get("traffic_link_cwnd", labels) == 3 * 8 + 3 &&
+                metrics_get("traffic_clients_connected", NULL) == 5,
+                "按标签删除不影响其他设备和无标签指标");
+
+    metrics_init();
+    TEST_ASSERT(metrics_count() == 0, "重新初始化清空指标");
+}
+
+// 测试用例8：数据帧发送方校验
+void test_upload_sender_validation() {
+    TEST_HEADER("测试用例8：数据帧发送方校验");
+
+    signal_controller_t *controller = malloc(sizeof(signal_controller_t));
+    signal_controller_init(controller, TEST_ADMIN_CODE, 1, DEFAULT_PORT);
+    int peer_a = attach_test_client(controller, 0);
+    int peer_b = attach_test_client(controller, 1);
+    client_info_t *client_a = &controller->clients[0];
+
+    send_test_frame(peer_a, 801, OP_SET_REQUEST, OBJ_COMMUNICATION, NULL, 0);
+    handle_client_message(controller, 0);
+    protocol_frame_t response;
+    read_response_frame(peer_a, &response);
+    free_frame(&response);
+
+    // 已注册的设备上传统计数据：正常应答并刷新存活时间
+    device_id_t id801 = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 801);
+    client_session_t *session = find_client_session(client_a, &id801);
+    session->last_heartbeat -= HEARTBEAT_TIMEOUT - 1;
+    client_a->last_heartbeat -= HEARTBEAT_TIMEOUT - 1;
+    uint8_t stats[] = {0x01, 0x02};
+    send_test_frame(peer_a, 801, OP_UPLOAD, OBJ_TRAFFIC_STATS, stats, sizeof(stats));
+    handle_client_message(controller, 0);
+    int ack_ok = read_response_frame(peer_a, &response) == 0 &&
+                 response.data.operation == OP_UPLOAD_RESPONSE &&
+                 response.data.receiver.device_id == 801;
+    free_frame(&response);
+    TEST_ASSERT(ack_ok, "已注册设备的上传得到应答");
+    TEST_ASSERT(time(NULL) - session->last_heartbeat <= 1 && time(NULL) - client_a->last_heartbeat <= 1,
+                "数据上传刷新逻辑检测器的存活时间");
+
+    // 同一连接上未注册的设备标识上传：出错应答
+    send_test_frame(peer_a, 802, OP_UPLOAD, OBJ_TRAFFIC_STATS, stats, sizeof(stats));
+    handle_client_message(controller, 0);
+    int error_ok = read_response_frame(peer_a, &response) == 0 &&
+                   response.data.operation == OP_ERROR_RESPONSE &&
+                   response.data.receiver.device_id == 802 &&
+                   response.data.content_len == 1 && response.data.content[0] == ERROR_LINK_ADDR;
+    free_frame(&response);
+    TEST_ASSERT(error_ok, "未注册设备的上传收到链路地址错误应答");
+    TEST_ASSERT(client_a->session_count == 1, "上传不会隐式注册设备");
+
+    // 另一连接冒充已在连接A上注册的设备
+    uint8_t status[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    send_test_frame(peer_b, 801, OP_UPLOAD, OBJ_DETECTOR_STATUS, status, sizeof(status));
+    handle_client_message(controller, 1);
+    error_ok = read_response_frame(peer_b, &response) == 0 &&
+               response.data.operation == OP_ERROR_RESPONSE;
+    free_frame(&response);
+    TEST_ASSERT(error_ok, "其他连接冒充已注册设备的上传被拒绝");
+    TEST_ASSERT(controller->clients[1].connected, "拒绝上传后保持连接");
+
+    disconnect_client(controller, 0);
+    disconnect_client(controller, 1);
+    close(peer_a);
+    close(peer_b);
+    free(controller);
+}
+
+// 辅助函数：百分位结果是否落在真实值与其1.25倍之间 (对数分桶的误差上界)
+static int percentile_within_bound(const latency_histogram_t *hist, double percentile, uint64_t exact) {
+    uint64_t value = latency_histogram_percentile(hist, percentile);
+    return value >= exact && value < exact + exact / 4 + 1;
+}
+
+// 测试用例9：延迟直方图分桶与百分位计算
+void test_latency_histogram() {
+    TEST_HEADER("测试用例9：延迟直方图分桶与百分位计算");
+
+    latency_histogram_t hist;
+    latency_histogram_reset(&hist);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 50.0) == 0, "空直方图的百分位为0");
+
+    // 小于细分桶数的值各占一个桶，桶上界即样本值
+    for (uint64_t ns = 0; ns < LATENCY_HISTOGRAM_SUB_BUCKETS; ns++) {
+        latency_histogram_record(&hist, ns);
+    }
+    TEST_ASSERT(latency_histogram_percentile(&hist, 0) == 0 &&
+                latency_histogram_percentile(&hist, 25.0) == 1 &&
+                latency_histogram_percentile(&hist, 50.0) == 2 &&
+                latency_histogram_percentile(&hist, 100.0) == 3, "小值精确分桶");
+
+    // 2的幂区间内按最高位之后两位细分：1000落在[896,1023]，上界被最大样本截断
+    latency_histogram_reset(&hist);
+    latency_histogram_record(&hist, 1000);
+    latency_histogram_record(&hist, 1023);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 0) == 1023, "同桶样本返回桶上界");
+    latency_histogram_reset(&hist);
+    latency_histogram_record(&hist, 1000);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 50.0) == 1000, "桶上界不超过最大样本");
+    latency_histogram_record(&hist, 1024);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 0) == 1023 &&
+                latency_histogram_percentile(&hist, 100.0) == 1024, "相邻区间的边界分入不同桶");
+    latency_histogram_record(&hist, 8);
+    latency_histogram_record(&hist, 9);
+    latency_histogram_record(&hist, 10);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 0) == 9 &&
+                latency_histogram_percentile(&hist, 40.0) == 11, "区间细分桶宽为区间的四分之一");
+
+    // 1..10000均匀分布：百分位不低于真实值且相对误差小于25%
+    latency_histogram_reset(&hist);
+    for (uint64_t ns = 1; ns <= 10000; ns++) {
+        latency_histogram_record(&hist, ns);
+    }
+    TEST_ASSERT(hist.count == 10000 && hist.sum_ns == 50005000ULL && hist.max_ns == 10000,
+                "样本数、总和与最大值");
+    TEST_ASSERT(percentile_within_bound(&hist, 50.0, 5001) &&
+                percentile_within_bound(&hist, 90.0, 9001) &&
+                percentile_within_bound(&hist, 99.0, 9901) &&
+                percentile_within_bound(&hist, 99.9, 9991), "百分位误差在分桶上界内");
+    TEST_ASSERT(latency_histogram_percentile(&hist, 100.0) == 10000 &&
+                latency_histogram_percentile(&hist, 150.0) == 10000, "超过100的百分位返回最大样本");
+
+    // 最高位区间的上界不溢出
+    latency_histogram_reset(&hist);
+    latency_histogram_record(&hist, UINT64_MAX);
+    latency_histogram_record(&hist, 1ULL << 63);
+    TEST_ASSERT(latency_histogram_percentile(&hist, 0) == (1ULL << 63) + (1ULL << 61) - 1 &&
+                latency_histogram_percentile(&hist, 100.0) == UINT64_MAX, "64位最大值分桶");
+
+    struct timespec later = {100, 100};
+    struct timespec earlier = {99, 999999900};
+    TEST_ASSERT(timespec_diff_ns(&later, &earlier) == 200 &&
+                timespec_diff_ns(&earlier, &later) == 0, "时间差借位与负差截断为0");
+}
+
+// 测试用例10：接收时间戳缺失时的回退
+void test_rx_timestamp_fallback() {
+    TEST_HEADER("测试用例10：接收时间戳缺失时的回退");
+
+    // 未开启时间戳 (也不支持时间戳的socket)：数据照常接收，时间戳清零
+    int sv[2];
+    TEST_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0, "建立socketpair");
+    uint8_t payload[] = {0xC0, 0x01, 0x02, 0xC0};
+    uint8_t buffer[64];
+    struct timespec rx_time = {12345, 678};
+    write(sv[1], payload, sizeof(payload));
+    int received = recv_with_rx_timestamp(sv[0], buffer, sizeof(buffer), &rx_time);
+    TEST_ASSERT(received == (int)sizeof(payload) && memcmp(buffer, payload, sizeof(payload)) == 0,
+                "无控制消息时数据完整接收");
+    TEST_ASSERT(rx_time.tv_sec == 0 && rx_time.tv_nsec == 0, "无控制消息时时间戳清零");
+
+    write(sv[1], payload, sizeof(payload));
+    TEST_ASSERT(recv_with_rx_timestamp(sv[0], buffer, sizeof(buffer), NULL) == (int)sizeof(payload),
+                "不需要时间戳时可传NULL");
+
+    // 对端关闭：返回0，时间戳清零
+    close(sv[1]);
+    rx_time.tv_sec = 1;
+    TEST_ASSERT(recv_with_rx_timestamp(sv[0], buffer, sizeof(buffer), &rx_time) == 0 &&
+                rx_time.tv_sec == 0, "连接关闭时返回0且不保留旧时间戳");
+    close(sv[0]);
+
+    // TCP连接开启时间戳后得到内核接收时间；内核启用时间戳是延迟生效的，
+    // 刚开启时到达的报文可能没有时间戳，此时同样清零而不是给出错误的时间
+    TEST_ASSERT(tcp_socket_pair(sv) == 0, "建立本机TCP连接");
+    TEST_ASSERT(enable_rx_timestamps(sv[0]) == 0, "开启接收时间戳");
+    int stamped = 0;
+    int consistent = 1;
+    for (int attempt = 0; attempt < 50 && !stamped; attempt++) {
+        struct timespec before, after;
+        clock_gettime(CLOCK_REALTIME, &before);
+        send(sv[1], payload, sizeof(payload), 0);
+        received = recv_with_rx_timestamp(sv[0], buffer, sizeof(buffer), &rx_time);
+        clock_gettime(CLOCK_REALTIME, &after);
+        if (received != (int)sizeof(payload)) {
+            consistent = 0;
+            break;
+        }
+        if (rx_time.tv_sec == 0) {
+            consistent = consistent && rx_time.tv_nsec == 0;
+            usleep(10000);
+            continue;
+        }
+        stamped = 1;
+        consistent = timespec_diff_ns(&rx_time, &before) > 0 && timespec_diff_ns(&after, &rx_time) > 0;
+    }
+    TEST_ASSERT(stamped && consistent, "内核接收时间位于发送与读取之间");
+    close(sv[0]);
+    close(sv[1]);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 交通信号控制机会话处理测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_multi_device_registration();
+    test_per_session_heartbeat_timeout();
+    test_pending_registration();
+    test_partial_frame_stash();
+    test_back_to_back_registration();
+    test_tcp_link_sampling();
+    test_metrics_table_growth();
+    test_upload_sender_validation();
+    test_latency_histogram();
+    test_rx_timestamp_fallback();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！会话处理功能工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查会话处理逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file stats_dedup_test.c
+ * @brief 统计数据去重测试脚本
+ *
+ * 该测试脚本验证重连后补传统计数据的去重，包括：
+ * 1. 重连补传统计数据的去重
+ * 2. 超前的统计起始时间不推进保留窗口
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/server/stats_dedup.h"
+#include "../src/utils/logger.h"
+#include "store_test_util.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+/**
+ * @brief 外部精确核对回调：只认定指定设备编号的数据已存在
+ */
+static int verify_device_one(void *ctx, const stats_key_t *key) {
+    int *calls = (int *)ctx;
+    (*calls)++;
+    return (key->device & 0xFFFF) == 1;
+}
+
+/**
+ * @brief 外部精确核对回调：查询测试记录的已接收数据 (按设备编号和分钟)
+ */
+static int verify_seen(void *ctx, const stats_key_t *key) {
+    uint8_t (*seen)[50] = ctx;
+    uint32_t minute = (key->interval_start % 3600) / 60;
+    return minute < 50 && seen[(key->device & 0xFFFF) - 1][minute];
+}
+
+// 测试用例1：统计数据去重
+void test_stats_dedup() {
+    TEST_HEADER("测试用例1：统计数据去重");
+
+    stats_dedup_t dedup;
+    TEST_ASSERT(stats_dedup_init(&dedup) == 0, "去重器初始化");
+
+    static uint8_t seen[100][50];
+    memset(seen, 0, sizeof(seen));
+    stats_dedup_set_verifier(&dedup, verify_seen, seen);
+
+    // 同一小时内5000条不同数据，超过过滤器初始容量，追加过滤器
+    uint32_t base = 1700000000 - 1700000000 % 3600;
+    time_t now = base + (STATS_DEDUP_WINDOW_HOURS + 2) * 3600;
+    int fresh = 1;
+    for (int i = 0; i < 5000; i++) {
+        device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, (uint16_t)(i % 100 + 1));
+        fresh &= stats_dedup_check(&dedup, &device, base + (uint32_t)(i / 100) * 60, now) == 0;
+        seen[i % 100][i / 100] = 1;
+    }
+    TEST_ASSERT(fresh && dedup.accepted == 5000, "不同设备或起始时间的数据都判定为新数据");
+    TEST_ASSERT(dedup.expansions > 0, "过滤器装满后追加更大容量的过滤器");
+
+    // 重连后整体补传一遍
+    int replayed = 1;
+    for (int i = 0; i < 5000; i++) {
+        device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, (uint16_t)(i % 100 + 1));
+        replayed &= stats_dedup_check(&dedup, &device, base + (uint32_t)(i / 100) * 60, now) == 1;
+    }
+    TEST_ASSERT(replayed && dedup.duplicates == 5000, "补传的数据全部判定为重复");
+    TEST_ASSERT(dedup.false_positives < 50, "过滤器误判率低");
+
+    // 推进到48小时之后，最早的小时桶被丢弃，补传按新数据接收
+    device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, 1);
+    stats_dedup_check(&dedup, &device, base + STATS_DEDUP_WINDOW_HOURS * 3600, now);
+    TEST_ASSERT(stats_dedup_check(&dedup, &device, base, now) == 0 && dedup.too_old == 1,
+                "超出保留窗口的数据按新数据接收");
+
+    // 外部核对只在过滤器命中时调用
+    int calls = 0;
+    stats_dedup_set_verifier(&dedup, verify_device_one, &calls);
+    uint32_t later = base + (STATS_DEDUP_WINDOW_HOURS + 1) * 3600;
+    stats_dedup_check(&dedup, &device, later, now);
+    TEST_ASSERT(calls == 0, "过滤器未命中时不做精确核对");
+    TEST_ASSERT(stats_dedup_check(&dedup, &device, later, now) == 1 && calls == 1, "命中时以外部核对结果为准");
+
+    // 没有核对回调时，过滤器命中即按重复处理
+    stats_dedup_set_verifier(&dedup, NULL, NULL);
+    device_id_t other = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, 2);
+    TEST_ASSERT(stats_dedup_check(&dedup, &other, later, now) == 0 &&
+                stats_dedup_check(&dedup, &other, later, now) == 1, "无核对回调时命中按重复处理");
+
+    stats_dedup_destroy(&dedup);
+}
+
+// 测试用例2：超前的统计起始时间
+void test_stats_dedup_future() {
+    TEST_HEADER("测试用例2：超前的统计起始时间");
+
+    stats_dedup_t dedup;
+    TEST_ASSERT(stats_dedup_init(&dedup) == 0, "去重器初始化");
+
+    uint32_t now = 1700000000;
+    device_id_t device = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, 1);
+    TEST_ASSERT(stats_dedup_check(&dedup, &device, now - 300, now) == 0, "正常数据判定为新数据");
+
+    // 时钟错误的检测器上传了一个月之后的起始时间
+    device_id_t broken = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_COIL, 2);
+    uint32_t future = now + 30 * 86400;
+    TEST_ASSERT(stats_dedup_check(&dedup, &broken, future, now) == 0 && dedup.future == 1,
+                "超前太多的数据按新数据接收");
+    TEST_ASSERT(dedup.newest_hour == (now - 300) / 3600, "超前的数据不推进保留窗口");
+    TEST_ASSERT(stats_dedup_check(&dedup, &broken, future, now) == 0 && dedup.future == 2,
+                "超前的数据不记录");
+
+    // 正常数据的去重不受影响
+    TEST_ASSERT(stats_dedup_check(&dedup, &device, now - 300, now) == 1 && dedup.too_old == 0,
+                "之后补传的正常数据仍判定为重复");
+
+    // 允许小的时钟偏差
+    TEST_ASSERT(stats_dedup_check(&dedup, &device, now + 60, now) == 0 &&
+                stats_dedup_check(&dedup, &device, now + 60, now) == 1, "略微超前的数据照常去重");
+
+    stats_dedup_destroy(&dedup);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 统计数据去重测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_stats_dedup();
+    test_stats_dedup_future();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！统计数据去重工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查去重逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
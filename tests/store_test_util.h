@@ -0,0 +1,124 @@
+/**
+ * @file store_test_util.h
+ * @brief 存储与历史相关测试共用的辅助函数
+ *
+ * 构造实时信息内容和帧、向历史存储追加数据、清理历史存储目录。
+ * 各测试文件只用到其中一部分，因此定义为static inline。
+ */
+
+#ifndef STORE_TEST_UTIL_H
+#define STORE_TEST_UTIL_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "../src/common/protocol.h"
+#include "../src/server/realtime_store.h"
+#include "../src/server/history_store.h"
+#include "../src/server/history_replication.h"
+
+#ifndef TEST_ADMIN_CODE
+#define TEST_ADMIN_CODE 0x110100
+#endif
+
+// 辅助函数：构造实时信息内容，各通道的占有率为base + 通道号
+static inline size_t build_realtime_content(uint8_t *content, uint32_t timestamp, int channels, uint16_t base) {
+    size_t len = 0;
+    content[len++] = timestamp & 0xFF;
+    content[len++] = (timestamp >> 8) & 0xFF;
+    content[len++] = (timestamp >> 16) & 0xFF;
+    content[len++] = (timestamp >> 24) & 0xFF;
+    content[len++] = 0xF4;  // 毫秒值500
+    content[len++] = 0x01;
+    content[len++] = (uint8_t)channels;
+
+    for (int i = 0; i < channels; i++) {
+        uint16_t occupancy = (uint16_t)(base + i);
+        content[len++] = (uint8_t)(i + 1);     // 通道编号
+        content[len++] = 1;                    // A类车
+        content[len++] = 2;                    // B类车
+        content[len++] = 3;                    // C类车
+        content[len++] = occupancy & 0xFF;
+        content[len++] = occupancy >> 8;
+        content[len++] = 60;                   // 速度
+        content[len++] = 45;                   // 车长
+        content[len++] = 0;
+        content[len++] = 20;                   // 车头时距
+        content[len++] = 15;                   // 车间时距
+        content[len++] = 0;                    // 停车次数
+        content[len++] = 0;                    // 停车时长
+        content[len++] = 10;                   // 占有采集次数
+        content[len++] = 0x55;                 // 占有信息
+        memset(content + len, 0, 4);
+        len += 4;
+    }
+    return len;
+}
+
+// 辅助函数：编码实时信息帧
+static inline int encode_realtime_frame(uint8_t *buffer, size_t size, uint16_t device_id,
+                                 uint32_t timestamp, int channels, uint16_t base) {
+    uint8_t content[MAX_FRAME_SIZE];
+    size_t content_len = build_realtime_content(content, timestamp, channels, base);
+
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, device_id),
+                                   create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_SIGNAL, 1),
+                                   OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, (uint16_t)content_len);
+    int len = encode_frame(&frame, buffer, size);
+    free_frame(&frame);
+    return len;
+}
+
+// 辅助函数：删除指定的历史存储目录
+static inline void remove_history_dir_at(const char *dir) {
+    const char *tiers[] = {"warm", "cold"};
+    char path[512];
+    for (int t = 0; t < 2; t++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, tiers[t]);
+        DIR *d = opendir(path);
+        struct dirent *entry;
+        while (d && (entry = readdir(d)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                snprintf(path, sizeof(path), "%s/%s/%s", dir, tiers[t], entry->d_name);
+                unlink(path);
+            }
+        }
+        if (d) {
+            closedir(d);
+        }
+        snprintf(path, sizeof(path), "%s/%s", dir, tiers[t]);
+        rmdir(path);
+    }
+    snprintf(path, sizeof(path), "%s/catalog", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/" REPLICATION_TAIL_LOG, dir);
+    unlink(path);
+    rmdir(dir);
+}
+
+// 辅助函数：跨层查询的行数
+static inline int64_t count_history(history_store_t *hist, int64_t start_ms, int64_t end_ms, realtime_columns_t *out) {
+    realtime_query_t query;
+    realtime_query_init(&query);
+    query.start_ms = start_ms;
+    query.end_ms = end_ms;
+    out->count = 0;
+    return history_query(hist, &query, out);
+}
+
+// 辅助函数：追加采集时间为[first, last]秒、每秒2个通道的实时信息
+static inline void append_seconds(history_store_t *hist, uint32_t first, uint32_t last) {
+    uint8_t content[MAX_FRAME_SIZE];
+    device_id_t sender = create_device_id(TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 1);
+    for (uint32_t t = first; t <= last; t++) {
+        size_t len = build_realtime_content(content, t, 2, 100);
+        realtime_store_append(&hist->hot, &sender, content, len, 0);
+    }
+}
+
+#endif // STORE_TEST_UTIL_H
@@ -0,0 +1,603 @@
+/**
+ * @file vehicle_detector_test.c
+ * @brief 车辆检测器客户端测试脚本
+ *
+ * 该测试脚本通过socketpair模拟与信号机的连接，验证检测器的发送路径，包括：
+ * 1. 多生产者提交与发送线程停止并发进行时不丢失已接受的消息
+ * 2. 突发模式按上传周期数和字节阈值合并发送
+ * 3. 控制帧顺带发出已累积的数据帧，断开连接时丢弃累积的数据帧
+ * 4. 多线程直接发送与突发缓冲并发进行时帧不交错、不丢失
+ * 5. 通道快照三缓冲的交换与并发发布/获取
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+// 包含必要的头文件
+#include "../src/common/protocol.h"
+#include "../src/client/vehicle_detector.h"
+#include "../src/utils/logger.h"
+
+// 测试统计
+typedef struct {
+    int total_tests;
+    int passed_tests;
+    int failed_tests;
+} test_stats_t;
+
+static test_stats_t g_stats = {0, 0, 0};
+
+// 测试辅助宏
+#define TEST_ASSERT(condition, message) \
+    do { \
+        g_stats.total_tests++; \
+        if (condition) { \
+            g_stats.passed_tests++; \
+            printf("[PASS] %s\n", message); \
+        } else { \
+            g_stats.failed_tests++; \
+            printf("[FAIL] %s\n", message); \
+        } \
+    } while(0)
+
+#define TEST_HEADER(test_name) \
+    printf("\n=== %s ===\n", test_name)
+
+#define TEST_ADMIN_CODE 0x110100
+#define TEST_PRODUCERS 4
+#define TEST_SENDERS 3
+#define TEST_SNAPSHOTS 200000
+
+// 接收端：统计收到的字节数直到连接关闭
+typedef struct {
+    int fd;
+    uint64_t bytes;
+} sink_arg_t;
+
+// 生产者：反复提交直到收到停止通知
+typedef struct {
+    vehicle_detector_t *detector;
+    volatile int *stop;
+    uint64_t accepted;          // 提交成功的消息数
+} producer_arg_t;
+
+// 停止发送线程的调用方
+typedef struct {
+    vehicle_detector_t *detector;
+    int done;                   // 停止调用已返回
+} stopper_arg_t;
+
+// 收集接收端的全部数据
+typedef struct {
+    int fd;
+    uint8_t *data;
+    size_t len;
+    size_t capacity;
+} collector_arg_t;
+
+// 直接调用send_message的线程
+typedef struct {
+    vehicle_detector_t *detector;
+    int count;                  // 发送次数
+    int failed;                 // 失败次数
+} direct_sender_arg_t;
+
+// 快照发布线程
+typedef struct {
+    vehicle_detector_t *detector;
+    volatile int done;
+} sampler_arg_t;
+
+// 辅助函数：把检测器连接到socketpair的一端
+// 返回信号机侧的socket
+static int attach_detector(vehicle_detector_t *detector) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+        return -1;
+    }
+    detector->sockfd = sv[0];
+    detector->connected = 1;
+    return sv[1];
+}
+
+// 辅助函数：接收线程
+static void *sink_thread(void *arg) {
+    sink_arg_t *sink = (sink_arg_t *)arg;
+    uint8_t buffer[65536];
+    ssize_t n;
+    while ((n = read(sink->fd, buffer, sizeof(buffer))) > 0) {
+        sink->bytes += (uint64_t)n;
+    }
+    return NULL;
+}
+
+// 辅助函数：读出接收端当前已到达的全部字节 (不阻塞)
+static size_t drain_peer(int fd, uint8_t *buffer, size_t size) {
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = recv(fd, buffer + total, size - total, MSG_DONTWAIT);
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    return total;
+}
+
+// 辅助函数：按帧界定符切分字节流并逐帧解码
+// 返回帧数，任何一帧解码失败返回-1；last_object返回最后一帧的对象标识
+static int count_frames(const uint8_t *data, size_t len, int *realtime, uint16_t *last_object) {
+    int frames = 0;
+    size_t pos = 0;
+    while (pos < len) {
+        if (data[pos] != FRAME_START) {
+            return -1;
+        }
+        size_t end = pos + 1;
+        while (end < len && data[end] != FRAME_END) {
+            end++;
+        }
+        if (end >= len) {
+            return -1;
+        }
+        protocol_frame_t frame;
+        if (decode_frame(data + pos, end + 1 - pos, &frame) != PROTOCOL_SUCCESS) {
+            return -1;
+        }
+        if (realtime && frame.data.object_id == OBJ_TRAFFIC_REALTIME) {
+            (*realtime)++;
+        }
+        if (last_object) {
+            *last_object = frame.data.object_id;
+        }
+        free_frame(&frame);
+        frames++;
+        pos = end + 1;
+    }
+    return frames;
+}
+
+// 辅助函数：收集线程
+static void *collector_thread(void *arg) {
+    collector_arg_t *collector = (collector_arg_t *)arg;
+    uint8_t buffer[65536];
+    ssize_t n;
+    while ((n = read(collector->fd, buffer, sizeof(buffer))) > 0) {
+        if (collector->len + (size_t)n > collector->capacity) {
+            size_t capacity = (collector->len + (size_t)n) * 2;
+            uint8_t *data = realloc(collector->data, capacity);
+            if (!data) {
+                break;
+            }
+            collector->data = data;
+            collector->capacity = capacity;
+        }
+        memcpy(collector->data + collector->len, buffer, (size_t)n);
+        collector->len += (size_t)n;
+    }
+    return NULL;
+}
+
+// 辅助函数：直接发送心跳应答的线程 (发送线程未启动)
+static void *direct_sender_thread(void *arg) {
+    direct_sender_arg_t *sender = (direct_sender_arg_t *)arg;
+    for (int i = 0; i < sender->count; i++) {
+        if (send_heartbeat_response(sender->detector) < 0) {
+            sender->failed++;
+        }
+    }
+    return NULL;
+}
+
+// 辅助函数：快照发布线程，每个快照的各字段都由序号导出
+static void *sampler_thread(void *arg) {
+    sampler_arg_t *sampler = (sampler_arg_t *)arg;
+    for (uint32_t i = 1; i <= TEST_SNAPSHOTS; i++) {
+        channel_snapshot_t *snapshot = detector_snapshot_begin(sampler->detector);
+        snapshot->active_channels = (int)(i % 8) + 1;
+        snapshot->total_vehicles_a = i;
+        snapshot->total_vehicles_b = i * 2;
+        snapshot->total_vehicles_c = i * 3;
+        snapshot->traffic_data[0].time_occupancy = (uint16_t)i;
+        detector_snapshot_publish(sampler->detector);
+    }
+    __atomic_store_n(&sampler->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 辅助函数：生产者线程
+static void *producer_thread(void *arg) {
+    producer_arg_t *producer = (producer_arg_t *)arg;
+    uint8_t content[7] = {1, 0, 2, 0, 3, 0, 4};
+    while (!*producer->stop) {
+        if (detector_submit(producer->detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME,
+                            content, sizeof(content)) == 0) {
+            producer->accepted++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// 辅助函数：在另一个线程中停止发送线程
+static void *stopper_thread(void *arg) {
+    stopper_arg_t *stopper = (stopper_arg_t *)arg;
+    vehicle_detector_stop_sender(stopper->detector);
+    __atomic_store_n(&stopper->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// 辅助函数：与生产者相同内容的消息编码后的帧长度
+static int encoded_message_len(const vehicle_detector_t *detector) {
+    uint8_t content[7] = {1, 0, 2, 0, 3, 0, 4};
+    protocol_frame_t frame;
+    frame.frame_start = FRAME_START;
+    frame.frame_end = FRAME_END;
+    frame.data = create_data_table(detector->device_id, detector->server_id,
+                                   OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, sizeof(content));
+    uint8_t buffer[MAX_FRAME_SIZE];
+    int len = encode_frame(&frame, buffer, sizeof(buffer));
+    free_frame(&frame);
+    return len;
+}
+
+// 测试用例1：多生产者提交与停止发送线程
+void test_submit_during_stop() {
+    TEST_HEADER("测试用例1：多生产者提交与停止发送线程");
+
+    vehicle_detector_t *detector = malloc(sizeof(vehicle_detector_t));
+    vehicle_detector_init(detector, TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 101, "127.0.0.1", 0);
+    sink_arg_t sink = { attach_detector(detector), 0 };
+    pthread_t sink_tid;
+    pthread_create(&sink_tid, NULL, sink_thread, &sink);
+
+    // 生产者持续提交期间反复启停发送线程
+    uint64_t accepted = 0;
+    int rounds_ok = 1;
+    for (int round = 0; round < 20; round++) {
+        uint64_t sent_before = detector->tx_sent;
+        volatile int stop = 0;
+        producer_arg_t producers[TEST_PRODUCERS];
+        pthread_t tids[TEST_PRODUCERS];
+
+        if (vehicle_detector_start_sender(detector) < 0) {
+            rounds_ok = 0;
+            break;
+        }
+        for (int i = 0; i < TEST_PRODUCERS; i++) {
+            producers[i].detector = detector;
+            producers[i].stop = &stop;
+            producers[i].accepted = 0;
+            pthread_create(&tids[i], NULL, producer_thread, &producers[i]);
+        }
+        usleep(2000 + round * 500);
+        vehicle_detector_stop_sender(detector);
+
+        // 停止之后生产者继续提交一段时间，全部应被拒绝
+        usleep(1000);
+        stop = 1;
+        uint64_t round_accepted = 0;
+        for (int i = 0; i < TEST_PRODUCERS; i++) {
+            pthread_join(tids[i], NULL);
+            round_accepted += producers[i].accepted;
+        }
+        accepted += round_accepted;
+
+        // 停止返回时已接受的消息都已写出，没有消息留在已释放的队列中
+        if (detector->tx_sent - sent_before != round_accepted) {
+            printf("  第%d轮：接受%llu条，发送%llu条\n", round + 1,
+                   (unsigned long long)round_accepted,
+                   (unsigned long long)(detector->tx_sent - sent_before));
+            rounds_ok = 0;
+        }
+    }
+    TEST_ASSERT(rounds_ok, "每轮停止后已接受的消息全部发送");
+    TEST_ASSERT(accepted > 0 && detector->tx_submitted == accepted, "提交计数与生产者统计一致");
+    TEST_ASSERT(detector->tx_submitters == 0, "停止后没有滞留的提交者");
+
+    // 模拟刚通过运行检查、尚未取得槽位的生产者：停止必须等它发布后才释放队列
+    vehicle_detector_start_sender(detector);
+    uint64_t sent_before = detector->tx_sent;
+    __atomic_add_fetch(&detector->tx_submitters, 1, __ATOMIC_SEQ_CST);
+    stopper_arg_t stopper = { detector, 0 };
+    pthread_t stopper_tid;
+    pthread_create(&stopper_tid, NULL, stopper_thread, &stopper);
+    usleep(50000);
+    TEST_ASSERT(!__atomic_load_n(&stopper.done, __ATOMIC_ACQUIRE), "停止等待正在提交的生产者");
+
+    uint64_t ticket;
+    detector_message_t *msg = mpsc_queue_claim(&detector->tx_queue, &ticket);
+    if (msg) {
+        msg->operation = OP_UPLOAD;
+        msg->object_id = OBJ_TRAFFIC_REALTIME;
+        msg->content_len = 7;
+        memset(msg->content, 0, 7);
+        mpsc_queue_publish(&detector->tx_queue, ticket);
+        accepted++;
+    }
+    __atomic_sub_fetch(&detector->tx_submitters, 1, __ATOMIC_SEQ_CST);
+    pthread_join(stopper_tid, NULL);
+    TEST_ASSERT(msg && detector->tx_sent == sent_before + 1, "生产者离开后其消息在停止前发出");
+
+    uint8_t content[7] = {0};
+    TEST_ASSERT(detector_submit(detector, OP_UPLOAD, OBJ_TRAFFIC_REALTIME, content, sizeof(content)) < 0,
+                "发送线程停止后拒绝提交");
+
+    detector_disconnect(detector);
+    pthread_join(sink_tid, NULL);
+    close(sink.fd);
+    int frame_len = encoded_message_len(detector);
+    TEST_ASSERT(frame_len > 0 && sink.bytes == accepted * (uint64_t)frame_len,
+                "接收端收到全部已接受消息的字节");
+
+    free(detector);
+}
+
+// 测试用例2：突发模式按周期和阈值发送
+void test_burst_flush() {
+    TEST_HEADER("测试用例2：突发模式按周期和阈值发送");
+
+    vehicle_detector_t *detector = malloc(sizeof(vehicle_detector_t));
+    vehicle_detector_init(detector, TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 102, "127.0.0.1", 0);
+    int peer = attach_detector(detector);
+    uint8_t received[DETECTOR_BURST_BUFFER_SIZE * 2];
+
+    // 每3个上传周期发送一次
+    TEST_ASSERT(vehicle_detector_set_burst(detector, 3, 0) == 0 &&
+                detector->burst_threshold == DETECTOR_BURST_BUFFER_SIZE, "启用突发模式，阈值默认为缓冲区容量");
+    send_realtime_traffic_data(detector);
+    size_t frame_len = detector->burst_len;
+    detector_burst_interval_elapsed(detector);
+    send_realtime_traffic_data(detector);
+    detector_burst_interval_elapsed(detector);
+    TEST_ASSERT(frame_len > 0 && detector->burst_frames == 2 && detector->radio_writes == 0 &&
+                drain_peer(peer, received, sizeof(received)) == 0, "未满3个周期时只在本地累积");
+
+    send_realtime_traffic_data(detector);
+    detector_burst_interval_elapsed(detector);
+    size_t len = drain_peer(peer, received, sizeof(received));
+    int realtime = 0;
+    TEST_ASSERT(detector->radio_writes == 1 && detector->burst_len == 0 && len == frame_len * 3 &&
+                count_frames(received, len, &realtime, NULL) == 3 && realtime == 3,
+                "第3个周期结束时3帧合并为一次写入");
+
+    // 字节阈值为两帧时，第二帧累积后立即发送，不等周期结束
+    vehicle_detector_set_burst(detector, 100, frame_len * 2);
+    send_realtime_traffic_data(detector);
+    TEST_ASSERT(detector->radio_writes == 1 && detector->burst_frames == 1, "未达到阈值时继续累积");
+    send_realtime_traffic_data(detector);
+    len = drain_peer(peer, received, sizeof(received));
+    TEST_ASSERT(detector->radio_writes == 2 && detector->burst_frames == 0 && len == frame_len * 2 &&
+                count_frames(received, len, NULL, NULL) == 2, "达到字节阈值时提前发送");
+
+    // 关闭突发模式时先发出已累积的帧，之后每帧立即发送
+    send_realtime_traffic_data(detector);
+    vehicle_detector_set_burst(detector, 0, 0);
+    send_realtime_traffic_data(detector);
+    len = drain_peer(peer, received, sizeof(received));
+    TEST_ASSERT(detector->radio_writes == 4 && detector->burst_len == 0 && len == frame_len * 2,
+                "关闭突发模式时发出累积的帧，之后立即发送");
+
+    detector_disconnect(detector);
+    close(peer);
+    free(detector);
+}
+
+// 测试用例3：控制帧顺带发送与断开时丢弃
+void test_burst_piggyback_and_discard() {
+    TEST_HEADER("测试用例3：控制帧顺带发送与断开时丢弃");
+
+    vehicle_detector_t *detector = malloc(sizeof(vehicle_detector_t));
+    vehicle_detector_init(detector, TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 103, "127.0.0.1", 0);
+    int peer = attach_detector(detector);
+    uint8_t received[DETECTOR_BURST_BUFFER_SIZE * 2];
+
+    vehicle_detector_set_burst(detector, 10, 0);
+    send_realtime_traffic_data(detector);
+    send_realtime_traffic_data(detector);
+    size_t data_len = detector->burst_len;
+
+    // 心跳应答立即发送，累积的数据帧在它之前随同一次写入发出
+    TEST_ASSERT(send_heartbeat_response(detector) == 0, "突发模式下控制帧立即发送");
+    size_t len = drain_peer(peer, received, sizeof(received));
+    int realtime = 0;
+    uint16_t last_object = 0;
+    TEST_ASSERT(detector->radio_writes == 1 && detector->burst_len == 0 && len > data_len &&
+                count_frames(received, len, &realtime, &last_object) == 3 && realtime == 2 &&
+                last_object == OBJ_COMMUNICATION, "累积的2帧与控制帧合并为一次写入，控制帧在最后");
+
+    // 断开连接时累积的帧直接丢弃，不写入旧连接
+    send_realtime_traffic_data(detector);
+    send_realtime_traffic_data(detector);
+    TEST_ASSERT(detector->burst_frames == 2, "断开前累积2帧");
+    detector_disconnect(detector);
+    TEST_ASSERT(detector->burst_len == 0 && detector->burst_frames == 0 &&
+                detector->burst_pending_intervals == 0 && detector->radio_writes == 1,
+                "断开连接时丢弃累积的帧");
+    TEST_ASSERT(read(peer, received, sizeof(received)) == 0, "旧连接上没有再写入数据");
+    close(peer);
+
+    // 重连后从空缓冲区开始
+    peer = attach_detector(detector);
+    send_realtime_traffic_data(detector);
+    TEST_ASSERT(detector_flush_burst(detector) == 0 &&
+                drain_peer(peer, received, sizeof(received)) == data_len / 2,
+                "重连后只发送新累积的帧");
+
+    detector_disconnect(detector);
+    close(peer);
+    free(detector);
+}
+
+// 测试用例4：多线程直接发送与突发缓冲并发
+void test_burst_concurrent_send() {
+    TEST_HEADER("测试用例4：多线程直接发送与突发缓冲并发");
+
+    vehicle_detector_t *detector = malloc(sizeof(vehicle_detector_t));
+    vehicle_detector_init(detector, TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 104, "127.0.0.1", 0);
+    collector_arg_t collector = { attach_detector(detector), NULL, 0, 0 };
+    pthread_t collector_tid;
+    pthread_create(&collector_tid, NULL, collector_thread, &collector);
+
+    // 发送线程未启动：其他线程直接调用send_message，主线程同时累积和发送数据帧
+    vehicle_detector_set_burst(detector, 2, 0);
+    direct_sender_arg_t senders[TEST_SENDERS];
+    pthread_t tids[TEST_SENDERS];
+    for (int i = 0; i < TEST_SENDERS; i++) {
+        senders[i].detector = detector;
+        senders[i].count = 2000;
+        senders[i].failed = 0;
+        pthread_create(&tids[i], NULL, direct_sender_thread, &senders[i]);
+    }
+    int data_frames = 2000;
+    int data_failed = 0;
+    for (int i = 0; i < data_frames; i++) {
+        if (send_realtime_traffic_data(detector) < 0) {
+            data_failed++;
+        }
+        detector_burst_interval_elapsed(detector);
+    }
+    int failed = data_failed;
+    for (int i = 0; i < TEST_SENDERS; i++) {
+        pthread_join(tids[i], NULL);
+        failed += senders[i].failed;
+    }
+    detector_flush_burst(detector);
+    detector_disconnect(detector);
+    pthread_join(collector_tid, NULL);
+    close(collector.fd);
+
+    int realtime = 0;
+    int frames = count_frames(collector.data, collector.len, &realtime, NULL);
+    TEST_ASSERT(failed == 0, "并发发送全部成功");
+    TEST_ASSERT(frames == data_frames + TEST_SENDERS * 2000 && realtime == data_frames,
+                "接收端逐帧解码成功，帧数与发送数一致");
+
+    free(collector.data);
+    free(detector);
+}
+
+// 测试用例5：通道快照三缓冲
+void test_snapshot_triple_buffer() {
+    TEST_HEADER("测试用例5：通道快照三缓冲");
+
+    vehicle_detector_t *detector = malloc(sizeof(vehicle_detector_t));
+    vehicle_detector_init(detector, TEST_ADMIN_CODE, DEVICE_TYPE_RADAR, 105, "127.0.0.1", 0);
+
+    // 三个缓冲区始终各不相同
+    TEST_ASSERT(detector->snapshot_back != detector->snapshot_front &&
+                detector->snapshot_back != detector->snapshot_middle &&
+                detector->snapshot_front != detector->snapshot_middle &&
+                !(detector->snapshot_middle & DETECTOR_SNAPSHOT_FRESH), "初始三个缓冲区互不相同且没有新快照");
+    const channel_snapshot_t *initial = detector_snapshot_acquire(detector);
+    TEST_ASSERT(initial == &detector->snapshots[detector->snapshot_front] && initial->sequence == 0,
+                "首次采样前读到初始快照");
+
+    // 发布后获取切换到新快照，FRESH标志被清除
+    channel_snapshot_t *snapshot = detector_snapshot_begin(detector);
+    snapshot->total_vehicles_a = 11;
+    detector_snapshot_publish(detector);
+    TEST_ASSERT(detector->snapshot_middle & DETECTOR_SNAPSHOT_FRESH, "发布后middle带FRESH标志");
+    const channel_snapshot_t *acquired = detector_snapshot_acquire(detector);
+    TEST_ASSERT(acquired == snapshot && acquired->sequence == 1 && acquired->total_vehicles_a == 11 &&
+                !(detector->snapshot_middle & DETECTOR_SNAPSHOT_FRESH), "获取到刚发布的快照并清除FRESH标志");
+    TEST_ASSERT(detector_snapshot_acquire(detector) == acquired, "没有新快照时继续使用当前缓冲区");
+
+    // 连续发布两次后只获取最新的一个，采样方不会写入上传方正在读取的缓冲区
+    snapshot = detector_snapshot_begin(detector);
+    TEST_ASSERT(snapshot != acquired, "采样方写入的缓冲区不是上传方正在读取的缓冲区");
+    snapshot->total_vehicles_a = 12;
+    detector_snapshot_publish(detector);
+    snapshot = detector_snapshot_begin(detector);
+    TEST_ASSERT(snapshot != acquired, "再次发布后仍不与读取中的缓冲区重叠");
+    snapshot->total_vehicles_a = 13;
+    detector_snapshot_publish(detector);
+    acquired = detector_snapshot_acquire(detector);
+    TEST_ASSERT(acquired->sequence == 3 && acquired->total_vehicles_a == 13, "连续发布时获取最新的快照");
+    int mask = (1 << detector->snapshot_back) | (1 << detector->snapshot_front) |
+               (1 << (detector->snapshot_middle & ~DETECTOR_SNAPSHOT_FRESH));
+    TEST_ASSERT(mask == 0x7, "交换后三个索引仍是0、1、2的排列");
+
+    // 并发：采样线程持续发布，上传方读到的快照字段一致、序号不回退
+    sampler_arg_t sampler = { detector, 0 };
+    pthread_t sampler_tid;
+    pthread_create(&sampler_tid, NULL, sampler_thread, &sampler);
+    uint64_t last_sequence = 0;
+    uint64_t reads = 0;
+    int consistent = 1;
+    int monotonic = 1;
+    for (;;) {
+        int done = __atomic_load_n(&sampler.done, __ATOMIC_ACQUIRE);
+        const channel_snapshot_t *current = detector_snapshot_acquire(detector);
+        if (current->sequence > 3) {
+            uint32_t i = current->total_vehicles_a;
+            if (current->total_vehicles_b != i * 2 || current->total_vehicles_c != i * 3 ||
+                current->traffic_data[0].time_occupancy != (uint16_t)i ||
+                current->active_channels != (int)(i % 8) + 1 || current->sequence != (uint64_t)i + 3) {
+                consistent = 0;
+            }
+        }
+        if (current->sequence < last_sequence) {
+            monotonic = 0;
+        }
+        last_sequence = current->sequence;
+        reads++;
+        if (done) {
+            break;
+        }
+    }
+    pthread_join(sampler_tid, NULL);
+    TEST_ASSERT(consistent, "并发发布期间读到的快照内容完整一致");
+    TEST_ASSERT(monotonic && last_sequence == TEST_SNAPSHOTS + 3, "读到的序号不回退，最后读到最新快照");
+    printf("  上传方读取%llu次\n", (unsigned long long)reads);
+
+    free(detector);
+}
+
+// 运行所有测试
+void run_all_tests() {
+    printf("=== 车辆检测器客户端测试脚本 ===\n");
+    printf("测试开始时间：%s", ctime(&(time_t){time(NULL)}));
+
+    // 初始化日志系统
+    logger_init(LOG_LEVEL_WARN, NULL);
+
+    // 运行所有测试用例
+    test_submit_during_stop();
+    test_burst_flush();
+    test_burst_piggyback_and_discard();
+    test_burst_concurrent_send();
+    test_snapshot_triple_buffer();
+
+    // 输出测试结果统计
+    printf("\n=== 测试结果统计 ===\n");
+    printf("总测试数：%d\n", g_stats.total_tests);
+    printf("通过数：%d\n", g_stats.passed_tests);
+    printf("失败数：%d\n", g_stats.failed_tests);
+
+    if (g_stats.failed_tests == 0) {
+        printf("\n🎉 所有测试通过！检测器发送路径工作正常。\n");
+    } else {
+        printf("\n❌ 有 %d 个测试失败，请检查检测器发送逻辑。\n", g_stats.failed_tests);
+    }
+
+    logger_close();
+}
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    run_all_tests();
+
+    return g_stats.failed_tests == 0 ? 0 : 1;
+}
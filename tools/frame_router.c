@@ -0,0 +1,1122 @@
+/**
+ * @file frame_router.c
+ * @brief 协议帧路由转发器
+ *
+ * 部署在检测器与信号机之间的汇聚节点上，按帧的接收方标识把上行帧转发到对应的信号机，
+ * 应答帧按原路返回检测器。两种转发模式：
+ * - splice: 只在内核缓冲区上窥视(MSG_PEEK)以确定帧边界和接收方，整段字节通过管道
+ *           用splice在socket之间搬运，不经过用户态缓冲区；只有需要检查的帧
+ *           (默认通信连接对象，用于识别设备并校验CRC)才完整解码。
+ * - copy:   传统代理，每帧接收到用户态、完整解码再重新编码后发送，用于性能对比。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "common/protocol.h"
+#include "utils/socket_utils.h"
+#include "utils/logger.h"
+
+#define MAX_ROUTER_CONNECTIONS 256  // 最大下游连接数
+#define MAX_ROUTES 8                // 最大路由条目数 (含默认路由)
+#define MAX_INSPECT_OBJECTS 8       // 最多需要完整解码的对象标识数
+#define SCAN_WINDOW_SIZE 65536      // 单次窥视的字节数
+#define PIPE_CAPACITY (1 << 20)     // 每个目的端管道容量
+#define COPY_BUFFER_SIZE 65536      // copy模式接收缓冲区大小
+#define COPY_OUT_LIMIT (1 << 20)    // copy模式单个目的端最大待发送字节数
+#define STATS_INTERVAL 10           // 统计输出间隔(秒)
+
+/**
+ * @brief 转发模式
+ */
+typedef enum {
+    ROUTER_MODE_SPLICE = 0,     // 零拷贝直通
+    ROUTER_MODE_COPY            // 解码再编码
+} router_mode_t;
+
+/**
+ * @brief 路由条目
+ */
+typedef struct {
+    device_id_t receiver;       // 匹配的接收方标识 (默认路由不使用)
+    char host[64];              // 上游信号机地址
+    int port;                   // 上游信号机端口
+} route_t;
+
+/**
+ * @brief 转发目的端
+ *
+ * splice模式下所有写往该socket的数据都先进入专用管道，管道内容始终以整帧为单位，
+ * 只有owner_fd对应的源正在搬运一个未完成的数据段时才允许管道末尾是半帧。
+ */
+typedef struct {
+    int fd;                     // 目的socket，-1表示未连接
+    int pipe_rd;                // 管道读端
+    int pipe_wr;                // 管道写端
+    size_t pipe_bytes;          // 管道中待写出的字节数
+    int owner_fd;               // 正在写入半帧的源socket，-1表示无
+    uint8_t *out;               // 待发送数据 (copy模式)
+    size_t out_len;             // 待发送字节数 (copy模式)
+} sink_t;
+
+/**
+ * @brief 转发源
+ */
+typedef struct {
+    int fd;                     // 源socket，-1表示未连接
+    sink_t *carry;              // 未搬运完的数据段的目的端
+    size_t carry_len;           // 未搬运完的字节数
+    int blocked;                // 等待目的端可写
+    uint8_t stash[MAX_FRAME_SIZE];  // 跨读取窗口的半帧和待检查帧 (splice模式)
+    uint16_t stash_len;         // 暂存字节数
+    uint8_t stash_complete;     // 暂存区中是完整帧
+    uint8_t *in;                // 接收缓冲区 (copy模式)
+    size_t in_len;              // 接收缓冲区数据长度 (copy模式)
+} source_t;
+
+/**
+ * @brief 一条下游连接及其上游连接
+ */
+typedef struct {
+    int active;
+    int id;
+    device_id_t device;         // 从通信连接帧中识别的检测器标识
+    int device_known;
+    source_t down_src;          // 检测器 -> 路由器
+    sink_t down_sink;           // 路由器 -> 检测器
+    source_t up_src[MAX_ROUTES];    // 信号机 -> 路由器
+    sink_t up_sink[MAX_ROUTES];     // 路由器 -> 信号机
+} router_conn_t;
+
+/**
+ * @brief 转发统计
+ */
+typedef struct {
+    uint64_t bytes_in;          // 转发的字节数
+    uint64_t frames_spliced;    // 直通转发的帧数
+    uint64_t frames_inspected;  // 完整解码后转发的帧数 (splice模式)
+    uint64_t frames_stashed;    // 跨读取窗口经暂存区转发的帧数 (splice模式)
+    uint64_t frames_copied;     // 解码再编码转发的帧数 (copy模式)
+    uint64_t frames_dropped;    // 丢弃的无效帧数
+    uint64_t junk_bytes;        // 丢弃的帧外字节数
+} router_stats_t;
+
+static volatile sig_atomic_t g_running = 1;
+static router_mode_t g_mode = ROUTER_MODE_SPLICE;
+static route_t g_routes[MAX_ROUTES];
+static int g_route_count = 0;
+static uint16_t g_inspect_objects[MAX_INSPECT_OBJECTS] = {OBJ_COMMUNICATION};
+static int g_inspect_count = 1;
+static router_conn_t g_conns[MAX_ROUTER_CONNECTIONS];
+static router_stats_t g_stats;
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+/**
+ * @brief 比较两个设备标识
+ */
+static int device_id_equal(const device_id_t *a, const device_id_t *b) {
+    return a->admin_code == b->admin_code &&
+           a->device_type == b->device_type &&
+           a->device_id == b->device_id;
+}
+
+/**
+ * @brief 判断对象是否需要完整解码
+ */
+static int needs_inspection(uint16_t object_id) {
+    for (int i = 0; i < g_inspect_count; i++) {
+        if (g_inspect_objects[i] == object_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 按接收方标识选择路由，未匹配时使用默认路由0
+ */
+static int select_route(const device_id_t *receiver) {
+    for (int i = 1; i < g_route_count; i++) {
+        if (device_id_equal(&g_routes[i].receiver, receiver)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 初始化目的端
+ */
+static int sink_open(sink_t *sink, int fd) {
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    sink->pipe_rd = -1;
+    sink->pipe_wr = -1;
+    sink->owner_fd = -1;
+
+    if (g_mode == ROUTER_MODE_SPLICE) {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+            LOG_ERROR("Failed to create pipe: %s", strerror(errno));
+            return -1;
+        }
+        // 管道容量以页为单位计数，小报文段也会占满一页，因此尽量放大
+        fcntl(fds[1], F_SETPIPE_SZ, PIPE_CAPACITY);
+        sink->pipe_rd = fds[0];
+        sink->pipe_wr = fds[1];
+    } else {
+        sink->out = malloc(COPY_OUT_LIMIT + MAX_FRAME_SIZE);
+        if (!sink->out) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 关闭目的端 (不关闭socket)
+ */
+static void sink_close(sink_t *sink) {
+    if (sink->pipe_rd >= 0) {
+        close(sink->pipe_rd);
+        close(sink->pipe_wr);
+    }
+    free(sink->out);
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = -1;
+    sink->pipe_rd = -1;
+    sink->pipe_wr = -1;
+    sink->owner_fd = -1;
+}
+
+/**
+ * @brief 初始化转发源
+ */
+static int source_open(source_t *src, int fd) {
+    memset(src, 0, sizeof(*src));
+    src->fd = fd;
+
+    if (g_mode == ROUTER_MODE_COPY) {
+        src->in = malloc(COPY_BUFFER_SIZE);
+        if (!src->in) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 关闭转发源 (不关闭socket)
+ */
+static void source_close(source_t *src) {
+    free(src->in);
+    memset(src, 0, sizeof(*src));
+    src->fd = -1;
+}
+
+/**
+ * @brief 检查目的端是否还有待写出的数据
+ */
+static int sink_pending(const sink_t *sink) {
+    return sink->fd >= 0 && (sink->pipe_bytes > 0 || sink->out_len > 0);
+}
+
+/**
+ * @brief 把目的端待写出的数据写入socket
+ * @return 写出的字节数，-1表示连接出错
+ */
+static ssize_t sink_drain(sink_t *sink) {
+    ssize_t total = 0;
+
+    while (sink->pipe_bytes > 0) {
+        ssize_t n = splice(sink->pipe_rd, NULL, sink->fd, NULL, sink->pipe_bytes,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                return total;
+            }
+            return -1;
+        }
+        sink->pipe_bytes -= n;
+        total += n;
+    }
+
+    while (sink->out_len > 0) {
+        ssize_t n = send(sink->fd, sink->out, sink->out_len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                break;
+            }
+            return -1;
+        }
+        memmove(sink->out, sink->out + n, sink->out_len - n);
+        sink->out_len -= n;
+        total += n;
+    }
+
+    return total;
+}
+
+/**
+ * @brief 将源socket中的len字节经管道搬运到目的端
+ * @return 1全部完成，0目的端阻塞 (剩余部分记入carry)，-1出错
+ */
+static int splice_run(source_t *src, sink_t *sink, size_t len) {
+    while (len > 0) {
+        ssize_t n = splice(src->fd, NULL, sink->pipe_wr, NULL, len,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE);
+        if (n > 0) {
+            len -= n;
+            sink->pipe_bytes += n;
+            g_stats.bytes_in += n;
+            continue;
+        }
+        if (n == 0) {
+            return -1;
+        }
+        if (errno != EAGAIN && errno != EINTR) {
+            return -1;
+        }
+
+        // 管道已满：尝试写出，仍无进展则等待目的端可写
+        ssize_t drained = sink_drain(sink);
+        if (drained < 0) {
+            return -1;
+        }
+        if (drained == 0) {
+            src->carry = sink;
+            src->carry_len = len;
+            sink->owner_fd = src->fd;
+            return 0;
+        }
+    }
+
+    return sink_drain(sink) < 0 ? -1 : 1;
+}
+
+/**
+ * @brief 丢弃源socket中的len字节
+ */
+static int discard_bytes(source_t *src, size_t len) {
+    uint8_t scratch[4096];
+
+    while (len > 0) {
+        size_t chunk = len < sizeof(scratch) ? len : sizeof(scratch);
+        ssize_t n = recv(src->fd, scratch, chunk, MSG_DONTWAIT);
+        if (n <= 0) {
+            return -1;
+        }
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief 获取到指定路由的上游连接，首次使用时建立
+ */
+static sink_t *get_upstream(router_conn_t *conn, int route) {
+    if (conn->up_sink[route].fd >= 0) {
+        return &conn->up_sink[route];
+    }
+
+    int fd = create_tcp_client(g_routes[route].host, g_routes[route].port);
+    if (fd < 0) {
+        LOG_WARN("Connection %d: upstream %s:%d unreachable",
+                 conn->id, g_routes[route].host, g_routes[route].port);
+        return NULL;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    set_nonblocking(fd);
+
+    if (sink_open(&conn->up_sink[route], fd) < 0 || source_open(&conn->up_src[route], fd) < 0) {
+        sink_close(&conn->up_sink[route]);
+        close(fd);
+        return NULL;
+    }
+
+    LOG_DEBUG("Connection %d: opened upstream route %d (%s:%d)",
+              conn->id, route, g_routes[route].host, g_routes[route].port);
+    return &conn->up_sink[route];
+}
+
+/**
+ * @brief 把用户态中的一个完整帧写入目的端管道
+ * @return 1已写入，0管道空间不足或有其他源的半帧，-1出错
+ */
+static int sink_write_frame(sink_t *sink, const uint8_t *frame, size_t len) {
+    if (sink->owner_fd >= 0) {
+        return 0;
+    }
+
+    // 帧长度不超过PIPE_BUF，写入管道是原子的：要么全部写入，要么EAGAIN
+    ssize_t n = write(sink->pipe_wr, frame, len);
+    if (n < 0) {
+        return errno == EAGAIN ? 0 : -1;
+    }
+    sink->pipe_bytes += n;
+    g_stats.bytes_in += n;
+
+    return sink_drain(sink) < 0 ? -1 : 1;
+}
+
+/**
+ * @brief 转发暂存区中的完整帧
+ *
+ * 暂存区中的帧来自两种情况：跨越两次读取的半帧，以及需要完整解码检查的帧。
+ * @return 1已处理，0目的端阻塞，-1出错
+ */
+static int flush_stash(router_conn_t *conn, source_t *src, int from_device) {
+    sink_t *sink = &conn->down_sink;
+    int inspect = 0;
+
+    if (from_device) {
+        data_table_t header;
+        if (peek_frame_header(src->stash, src->stash_len, &header) != PROTOCOL_SUCCESS) {
+            g_stats.frames_dropped++;
+            src->stash_len = 0;
+            src->stash_complete = 0;
+            return 1;
+        }
+        inspect = needs_inspection(header.object_id);
+        sink = get_upstream(conn, select_route(&header.receiver));
+        if (!sink) {
+            return -1;
+        }
+    }
+
+    if (inspect) {
+        protocol_frame_t frame;
+        if (decode_frame(src->stash, src->stash_len, &frame) != PROTOCOL_SUCCESS) {
+            LOG_WARN("Connection %d: dropping invalid frame (%u bytes)", conn->id, src->stash_len);
+            g_stats.frames_dropped++;
+            src->stash_len = 0;
+            src->stash_complete = 0;
+            return 1;
+        }
+
+        if (frame.data.object_id == OBJ_COMMUNICATION && !conn->device_known) {
+            conn->device = frame.data.sender;
+            conn->device_known = 1;
+            LOG_INFO("Connection %d: device %06X-%04X-%04X", conn->id,
+                     conn->device.admin_code, conn->device.device_type, conn->device.device_id);
+        }
+        free_frame(&frame);
+    }
+
+    int result = sink_write_frame(sink, src->stash, src->stash_len);
+    if (result <= 0) {
+        return result;
+    }
+
+    if (inspect) {
+        g_stats.frames_inspected++;
+    } else {
+        g_stats.frames_stashed++;
+    }
+    src->stash_len = 0;
+    src->stash_complete = 0;
+    return 1;
+}
+
+/**
+ * @brief 从源socket读取len字节追加到暂存区
+ */
+static int stash_bytes(source_t *src, size_t len) {
+    if (recv(src->fd, src->stash + src->stash_len, len, MSG_DONTWAIT) != (ssize_t)len) {
+        return -1;
+    }
+    src->stash_len += len;
+    return 0;
+}
+
+/**
+ * @brief splice模式处理可读的源socket
+ *
+ * 完整帧留在内核中直接搬运；读取窗口末尾的半帧必须读入暂存区，否则数据留在
+ * 接收队列中会使TCP接收窗口无法打开，发送端停滞而socket持续可读。
+ * @param from_device 1表示检测器方向 (需按接收方路由)
+ * @return 1继续，0目的端阻塞，-1连接关闭或出错
+ */
+static int process_source_splice(router_conn_t *conn, source_t *src, int from_device) {
+    static uint8_t scan[SCAN_WINDOW_SIZE];
+    ssize_t n;
+
+    // 先完成上次未搬运完的数据段
+    if (src->carry_len > 0) {
+        sink_t *sink = src->carry;
+        size_t len = src->carry_len;
+        src->carry = NULL;
+        src->carry_len = 0;
+        sink->owner_fd = -1;
+        int result = splice_run(src, sink, len);
+        if (result <= 0) {
+            return result;
+        }
+    }
+
+    // 只有默认路由时应答方向不会交错，无需识别帧边界
+    if (!from_device && g_route_count == 1) {
+        sink_t *sink = &conn->down_sink;
+        if (sink->owner_fd >= 0 && sink->owner_fd != src->fd) {
+            return 0;
+        }
+        n = splice(src->fd, NULL, sink->pipe_wr, NULL, SCAN_WINDOW_SIZE,
+                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n == 0) {
+            return -1;
+        }
+        if (n < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                return -1;
+            }
+            return sink_drain(sink) < 0 ? -1 : 0;
+        }
+        sink->pipe_bytes += n;
+        g_stats.bytes_in += n;
+        return sink_drain(sink) < 0 ? -1 : 1;
+    }
+
+    // 补全暂存区中的半帧
+    if (src->stash_len > 0 && !src->stash_complete) {
+        n = recv(src->fd, scan, sizeof(scan), MSG_PEEK | MSG_DONTWAIT);
+        if (n == 0) {
+            return -1;
+        }
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EINTR) ? 1 : -1;
+        }
+
+        const uint8_t *end = memchr(scan, FRAME_END, n);
+        size_t take = end ? (size_t)(end - scan + 1) : (size_t)n;
+
+        if (src->stash_len == 1 && end == scan) {
+            // 暂存的0xC0是上一帧残留的结束标识，socket中的0xC0才是帧开始
+            g_stats.junk_bytes++;
+            src->stash_len = 0;
+        } else if (src->stash_len + take > sizeof(src->stash)) {
+            // 超长无结束标识，丢弃暂存区重新同步
+            g_stats.junk_bytes += src->stash_len;
+            src->stash_len = 0;
+        } else {
+            if (stash_bytes(src, take) < 0) {
+                return -1;
+            }
+            if (!end) {
+                return 1;
+            }
+            src->stash_complete = 1;
+        }
+    }
+
+    if (src->stash_complete) {
+        int result = flush_stash(conn, src, from_device);
+        if (result <= 0) {
+            return result;
+        }
+    }
+
+    // 窥视内核接收队列，定位完整帧的边界
+    n = recv(src->fd, scan, sizeof(scan), MSG_PEEK | MSG_DONTWAIT);
+    if (n == 0) {
+        return -1;
+    }
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EINTR) ? 1 : -1;
+    }
+
+    size_t pos = 0;
+    sink_t *run_sink = NULL;
+    size_t run_len = 0;
+    int result = 1;
+
+    while (pos < (size_t)n) {
+        // 帧外字节直接丢弃
+        if (scan[pos] != FRAME_START) {
+            const uint8_t *next = memchr(scan + pos, FRAME_START, n - pos);
+            size_t junk = next ? (size_t)(next - (scan + pos)) : (size_t)n - pos;
+            if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+                return result;
+            }
+            run_len = 0;
+            if (discard_bytes(src, junk) < 0) {
+                return -1;
+            }
+            g_stats.junk_bytes += junk;
+            pos += junk;
+            continue;
+        }
+
+        const uint8_t *end = memchr(scan + pos + 1, FRAME_END, n - pos - 1);
+        if (!end && n - pos < sizeof(src->stash)) {
+            // 窗口末尾的半帧读入暂存区，等待后续数据补全
+            if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+                return result;
+            }
+            return stash_bytes(src, n - pos) < 0 ? -1 : 1;
+        }
+        size_t frame_len = end ? (size_t)(end - (scan + pos) + 1) : 2;
+
+        // 连续两个0xC0 (前一个是上一帧残留的结束标识) 或超长无结束标识：丢弃一个字节重新同步
+        if (frame_len == 2) {
+            if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+                return result;
+            }
+            run_len = 0;
+            if (discard_bytes(src, 1) < 0) {
+                return -1;
+            }
+            g_stats.junk_bytes++;
+            pos++;
+            continue;
+        }
+
+        sink_t *sink;
+        int inspect = 0;
+        if (from_device) {
+            data_table_t header;
+            if (peek_frame_header(scan + pos, frame_len, &header) != PROTOCOL_SUCCESS) {
+                if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+                    return result;
+                }
+                run_len = 0;
+                if (discard_bytes(src, frame_len) < 0) {
+                    return -1;
+                }
+                g_stats.frames_dropped++;
+                pos += frame_len;
+                continue;
+            }
+            inspect = needs_inspection(header.object_id) && frame_len <= sizeof(src->stash);
+            sink = get_upstream(conn, select_route(&header.receiver));
+            if (!sink) {
+                return -1;
+            }
+        } else {
+            sink = &conn->down_sink;
+        }
+
+        // 目的端管道中有其他源的半帧，暂停
+        if (sink->owner_fd >= 0 && sink->owner_fd != src->fd) {
+            break;
+        }
+
+        if (inspect || (run_len > 0 && run_sink != sink)) {
+            if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+                return result;
+            }
+            run_len = 0;
+        }
+
+        if (inspect) {
+            // 需要检查的帧读入暂存区完整解码
+            if (stash_bytes(src, frame_len) < 0) {
+                return -1;
+            }
+            src->stash_complete = 1;
+            result = flush_stash(conn, src, from_device);
+            if (result <= 0) {
+                return result;
+            }
+        } else {
+            run_sink = sink;
+            run_len += frame_len;
+            g_stats.frames_spliced++;
+        }
+        pos += frame_len;
+    }
+
+    if (run_len > 0 && (result = splice_run(src, run_sink, run_len)) <= 0) {
+        return result;
+    }
+    return pos < (size_t)n ? 0 : 1;
+}
+
+/**
+ * @brief copy模式处理可读的源socket：解码每一帧再重新编码发送
+ * @return 1继续，0目的端阻塞，-1连接关闭或出错
+ */
+static int process_source_copy(router_conn_t *conn, source_t *src, int from_device) {
+    int eof = 0;
+
+    if (src->in_len < COPY_BUFFER_SIZE) {
+        ssize_t n = recv(src->fd, src->in + src->in_len, COPY_BUFFER_SIZE - src->in_len, MSG_DONTWAIT);
+        if (n == 0) {
+            eof = 1;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return -1;
+        }
+        if (n > 0) {
+            src->in_len += n;
+            g_stats.bytes_in += n;
+        }
+    }
+
+    size_t pos = 0;
+    int result = 1;
+
+    while (pos < src->in_len) {
+        if (src->in[pos] != FRAME_START) {
+            const uint8_t *next = memchr(src->in + pos, FRAME_START, src->in_len - pos);
+            size_t junk = next ? (size_t)(next - (src->in + pos)) : src->in_len - pos;
+            g_stats.junk_bytes += junk;
+            pos += junk;
+            continue;
+        }
+
+        const uint8_t *end = memchr(src->in + pos + 1, FRAME_END, src->in_len - pos - 1);
+        if (!end) {
+            break;
+        }
+        size_t frame_len = end - (src->in + pos) + 1;
+        if (frame_len == 2) {
+            g_stats.junk_bytes++;
+            pos++;
+            continue;
+        }
+
+        protocol_frame_t frame;
+        if (decode_frame(src->in + pos, frame_len, &frame) != PROTOCOL_SUCCESS) {
+            g_stats.frames_dropped++;
+            pos += frame_len;
+            continue;
+        }
+
+        sink_t *sink = &conn->down_sink;
+        if (from_device) {
+            if (frame.data.object_id == OBJ_COMMUNICATION && !conn->device_known) {
+                conn->device = frame.data.sender;
+                conn->device_known = 1;
+            }
+            sink = get_upstream(conn, select_route(&frame.data.receiver));
+            if (!sink) {
+                free_frame(&frame);
+                return -1;
+            }
+        }
+
+        if (sink->out_len >= COPY_OUT_LIMIT) {
+            free_frame(&frame);
+            result = 0;
+            break;
+        }
+
+        int encoded = encode_frame(&frame, sink->out + sink->out_len, MAX_FRAME_SIZE);
+        free_frame(&frame);
+        if (encoded < 0) {
+            g_stats.frames_dropped++;
+        } else {
+            sink->out_len += encoded;
+            g_stats.frames_copied++;
+        }
+        pos += frame_len;
+    }
+
+    if (pos > 0) {
+        memmove(src->in, src->in + pos, src->in_len - pos);
+        src->in_len -= pos;
+    }
+
+    // 写出本轮产生的数据
+    if (sink_drain(&conn->down_sink) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < g_route_count; i++) {
+        if (conn->up_sink[i].fd >= 0 && sink_drain(&conn->up_sink[i]) < 0) {
+            return -1;
+        }
+    }
+
+    return eof ? -1 : result;
+}
+
+/**
+ * @brief 处理可读的源socket
+ */
+static int process_source(router_conn_t *conn, source_t *src, int from_device) {
+    if (g_mode == ROUTER_MODE_SPLICE) {
+        return process_source_splice(conn, src, from_device);
+    }
+    return process_source_copy(conn, src, from_device);
+}
+
+/**
+ * @brief 目的端有进展后唤醒该连接所有被阻塞的源
+ *
+ * copy模式下被阻塞的源可能已把数据读入用户态缓冲区，socket不会再次可读，需要主动处理。
+ */
+static int wake_sources(router_conn_t *conn) {
+    for (int r = -1; r < g_route_count; r++) {
+        source_t *src = r < 0 ? &conn->down_src : &conn->up_src[r];
+        if (src->fd < 0 || !src->blocked) {
+            continue;
+        }
+        src->blocked = 0;
+        if (g_mode == ROUTER_MODE_COPY && src->in_len > 0) {
+            int result = process_source(conn, src, r < 0);
+            if (result < 0) {
+                return -1;
+            }
+            src->blocked = (result == 0);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief 关闭一条下游连接及其全部上游连接
+ */
+static void close_conn(router_conn_t *conn) {
+    LOG_INFO("Connection %d closed", conn->id);
+
+    // 尽量写出已搬入管道/缓冲区的数据，避免丢失对端关闭前的最后几帧
+    sink_t *sinks[1 + MAX_ROUTES];
+    int sink_count = 0;
+    sinks[sink_count++] = &conn->down_sink;
+    for (int i = 0; i < MAX_ROUTES; i++) {
+        sinks[sink_count++] = &conn->up_sink[i];
+    }
+    for (int i = 0; i < sink_count; i++) {
+        if (sink_pending(sinks[i])) {
+            fcntl(sinks[i]->fd, F_SETFL, fcntl(sinks[i]->fd, F_GETFL) & ~O_NONBLOCK);
+            sink_drain(sinks[i]);
+        }
+    }
+
+    close(conn->down_src.fd);
+    source_close(&conn->down_src);
+    sink_close(&conn->down_sink);
+
+    for (int i = 0; i < MAX_ROUTES; i++) {
+        if (conn->up_sink[i].fd >= 0) {
+            close(conn->up_sink[i].fd);
+        }
+        source_close(&conn->up_src[i]);
+        sink_close(&conn->up_sink[i]);
+    }
+    conn->active = 0;
+}
+
+/**
+ * @brief 接受一条下游连接并建立默认路由的上游连接
+ */
+static void accept_conn(int listen_fd, int conn_id) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    router_conn_t *conn = NULL;
+    for (int i = 0; i < MAX_ROUTER_CONNECTIONS; i++) {
+        if (!g_conns[i].active) {
+            conn = &g_conns[i];
+            break;
+        }
+    }
+    if (!conn) {
+        LOG_WARN("Too many connections, rejecting");
+        close(fd);
+        return;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    set_nonblocking(fd);
+
+    memset(conn, 0, sizeof(*conn));
+    conn->id = conn_id;
+    for (int i = 0; i < MAX_ROUTES; i++) {
+        conn->up_sink[i].fd = -1;
+        conn->up_sink[i].pipe_rd = -1;
+        conn->up_src[i].fd = -1;
+    }
+
+    if (source_open(&conn->down_src, fd) < 0 || sink_open(&conn->down_sink, fd) < 0) {
+        source_close(&conn->down_src);
+        sink_close(&conn->down_sink);
+        close(fd);
+        return;
+    }
+    conn->active = 1;
+
+    if (!get_upstream(conn, 0)) {
+        close_conn(conn);
+        return;
+    }
+
+    LOG_INFO("Connection %d accepted", conn_id);
+}
+
+/**
+ * @brief 解析 host:port
+ */
+static int parse_host_port(const char *text, char *host, size_t host_size, int *port) {
+    const char *colon = strrchr(text, ':');
+    if (!colon || (size_t)(colon - text) >= host_size) {
+        return -1;
+    }
+    memcpy(host, text, colon - text);
+    host[colon - text] = '\0';
+    *port = atoi(colon + 1);
+    return *port > 0 ? 0 : -1;
+}
+
+/**
+ * @brief 输出转发统计
+ */
+static void log_stats(void) {
+    LOG_INFO("Router stats: %llu bytes, %llu spliced, %llu inspected, %llu stashed, %llu copied, "
+             "%llu dropped frames, %llu junk bytes",
+             (unsigned long long)g_stats.bytes_in,
+             (unsigned long long)g_stats.frames_spliced,
+             (unsigned long long)g_stats.frames_inspected,
+             (unsigned long long)g_stats.frames_stashed,
+             (unsigned long long)g_stats.frames_copied,
+             (unsigned long long)g_stats.frames_dropped,
+             (unsigned long long)g_stats.junk_bytes);
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s -u <host:port> [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -p <port>        Listen port (default: 40002)\n");
+    printf("  -u <host:port>   Default upstream controller (required)\n");
+    printf("  -r <admin:type:id=host:port>\n");
+    printf("                   Route frames for the given receiver to another controller\n");
+    printf("  -m <mode>        Forwarding mode: splice (default) or copy\n");
+    printf("  -i <obj>         Also fully decode frames with this object ID (hex)\n");
+    printf("  -l <level>       Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
+    printf("  -h               Show this help\n");
+    printf("\nExample:\n");
+    printf("  %s -p 40002 -u 127.0.0.1:40000 -r 110100:1:2=127.0.0.1:40010\n", program_name);
+}
+
+int main(int argc, char *argv[]) {
+    int listen_port = 40002;
+    log_level_t log_level = LOG_LEVEL_INFO;
+
+    g_route_count = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:u:r:m:i:l:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                listen_port = atoi(optarg);
+                break;
+            case 'u':
+                if (parse_host_port(optarg, g_routes[0].host, sizeof(g_routes[0].host),
+                                    &g_routes[0].port) < 0) {
+                    fprintf(stderr, "Invalid upstream: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r': {
+                unsigned long admin, type, id;
+                int consumed = 0;
+                if (g_route_count >= MAX_ROUTES ||
+                    sscanf(optarg, "%lu:%lu:%lu=%n", &admin, &type, &id, &consumed) != 3 ||
+                    consumed == 0) {
+                    fprintf(stderr, "Invalid route: %s\n", optarg);
+                    return 1;
+                }
+                route_t *route = &g_routes[g_route_count];
+                route->receiver = create_device_id(admin, type, id);
+                if (parse_host_port(optarg + consumed, route->host, sizeof(route->host),
+                                    &route->port) < 0) {
+                    fprintf(stderr, "Invalid route: %s\n", optarg);
+                    return 1;
+                }
+                g_route_count++;
+                break;
+            }
+            case 'm':
+                if (strcmp(optarg, "splice") == 0) {
+                    g_mode = ROUTER_MODE_SPLICE;
+                } else if (strcmp(optarg, "copy") == 0) {
+                    g_mode = ROUTER_MODE_COPY;
+                } else {
+                    fprintf(stderr, "Invalid mode: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'i':
+                if (g_inspect_count >= MAX_INSPECT_OBJECTS) {
+                    fprintf(stderr, "Too many inspected objects\n");
+                    return 1;
+                }
+                g_inspect_objects[g_inspect_count++] = (uint16_t)strtoul(optarg, NULL, 16);
+                break;
+            case 'l':
+                log_level = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (g_routes[0].port <= 0) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(log_level, NULL);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = create_tcp_server(listen_port);
+    if (listen_fd < 0) {
+        LOG_ERROR("Failed to listen on port %d", listen_port);
+        return 1;
+    }
+    set_nonblocking(listen_fd);
+
+    LOG_INFO("Frame router listening on %d (%s mode), default upstream %s:%d, %d extra routes",
+             listen_port, g_mode == ROUTER_MODE_SPLICE ? "splice" : "copy",
+             g_routes[0].host, g_routes[0].port, g_route_count - 1);
+
+    // 每个连接最多 1个下游 + MAX_ROUTES个上游
+    static struct pollfd pfds[1 + MAX_ROUTER_CONNECTIONS * (1 + MAX_ROUTES)];
+    static struct {
+        router_conn_t *conn;
+        source_t *src;
+        sink_t *sink;
+        int from_device;
+    } slots[1 + MAX_ROUTER_CONNECTIONS * (1 + MAX_ROUTES)];
+    int next_conn_id = 0;
+    time_t last_stats = time(NULL);
+
+    while (g_running) {
+        int nfds = 0;
+        pfds[nfds].fd = listen_fd;
+        pfds[nfds].events = POLLIN;
+        nfds++;
+
+        for (int i = 0; i < MAX_ROUTER_CONNECTIONS; i++) {
+            router_conn_t *conn = &g_conns[i];
+            if (!conn->active) {
+                continue;
+            }
+
+            for (int r = -1; r < g_route_count; r++) {
+                source_t *src = r < 0 ? &conn->down_src : &conn->up_src[r];
+                sink_t *sink = r < 0 ? &conn->down_sink : &conn->up_sink[r];
+                if (src->fd < 0) {
+                    continue;
+                }
+
+                // 同一个socket既是源也是目的端
+                short events = src->blocked ? 0 : POLLIN;
+                if (sink_pending(sink)) {
+                    events |= POLLOUT;
+                }
+                pfds[nfds].fd = src->fd;
+                pfds[nfds].events = events;
+                slots[nfds].conn = conn;
+                slots[nfds].src = src;
+                slots[nfds].sink = sink;
+                slots[nfds].from_device = r < 0;
+                nfds++;
+            }
+        }
+
+        int ready = poll(pfds, nfds, 100);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Poll error: %s", strerror(errno));
+            break;
+        }
+
+        if (ready == 0) {
+            // 超时兜底：解除所有阻塞标记重新尝试
+            for (int i = 0; i < MAX_ROUTER_CONNECTIONS; i++) {
+                if (!g_conns[i].active) {
+                    continue;
+                }
+                g_conns[i].down_src.blocked = 0;
+                for (int r = 0; r < MAX_ROUTES; r++) {
+                    g_conns[i].up_src[r].blocked = 0;
+                }
+            }
+        }
+
+        if (pfds[0].revents & POLLIN) {
+            accept_conn(listen_fd, next_conn_id++);
+        }
+
+        for (int k = 1; k < nfds; k++) {
+            router_conn_t *conn = slots[k].conn;
+            if (!conn->active || pfds[k].revents == 0) {
+                continue;
+            }
+
+            int failed = 0;
+
+            if (pfds[k].revents & POLLOUT) {
+                ssize_t drained = sink_drain(slots[k].sink);
+                if (drained < 0) {
+                    failed = 1;
+                } else if (drained > 0 && wake_sources(conn) < 0) {
+                    failed = 1;
+                }
+            }
+
+            if (!failed && (pfds[k].revents & (POLLIN | POLLHUP | POLLERR))) {
+                int result = process_source(conn, slots[k].src, slots[k].from_device);
+                if (result < 0) {
+                    failed = 1;
+                } else if (result == 0) {
+                    slots[k].src->blocked = 1;
+                }
+            }
+
+            if (failed) {
+                close_conn(conn);
+            }
+        }
+
+        if (time(NULL) - last_stats >= STATS_INTERVAL) {
+            log_stats();
+            last_stats = time(NULL);
+        }
+    }
+
+    for (int i = 0; i < MAX_ROUTER_CONNECTIONS; i++) {
+        if (g_conns[i].active) {
+            close_conn(&g_conns[i]);
+        }
+    }
+    log_stats();
+    close(listen_fd);
+    logger_close();
+    return 0;
+}
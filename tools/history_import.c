@@ -0,0 +1,660 @@
+/**
+ * @file history_import.c
+ * @brief 历史数据离线批量导入工具
+ *
+ * 读取抓包文件 (TPCAP001) 或原始帧转储 (连续的协议帧字节)，把其中的实时信息
+ * 直接写为分层历史存储的段文件，不经过TCP接收路径。输入按批处理：
+ * 每批按记录边界切分给多个线程，各线程用批量列式解码器解码自己的范围；
+ * 之后按(小时, 设备, 采集时间)对帧排序，使同一设备的数据在每个小时内按时间连续；
+ * 最后按每段REALTIME_STORE_CHUNK_ROWS行切分，多个线程并行收集、编码并写出段文件。
+ *
+ * 导入段使用独立的行号空间 (HISTORY_IMPORT_ROW_BIT)，段文件先写临时文件再改名，
+ * 运行中的信号控制机在下一轮迁移时纳入新段，因此可以与之同时运行；
+ * 同一目录同时只允许一个导入进程 (import.lock文件锁)。
+ * 原始帧转储没有接收时间，接收时间取采集时间。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "common/protocol.h"
+#include "common/capture.h"
+#include "common/realtime_codec.h"
+#include "server/history_store.h"
+#include "utils/logger.h"
+
+#define DEFAULT_BATCH_MB 256        // 默认每批输入字节数(MB)
+#define MAX_IMPORT_THREADS 64       // 线程数上限
+#define SEGMENT_ROWS REALTIME_STORE_CHUNK_ROWS  // 每段行数上限
+#define HOUR_MS 3600000LL           // 每小时毫秒数
+#define SORT_DIGITS 14              // 排序键字节数：小时内毫秒3 + 设备7 + 小时4
+
+/**
+ * @brief 解码出的一帧实时信息 (排序单位，帧内各通道保持原顺序)
+ */
+typedef struct {
+    uint64_t device;            // 行政区划 << 32 | 设备类型 << 16 | 设备编号
+    uint32_t hour;              // 采集时间所在小时
+    uint32_t ms_in_hour;        // 小时内毫秒数
+    uint32_t row;               // 在所属线程列集合中的首行
+    uint16_t rows;              // 行数
+    uint16_t worker;            // 所属线程
+} import_frame_t;
+
+/**
+ * @brief 解码线程
+ */
+typedef struct {
+    const uint8_t *data;        // 输入文件映射
+    size_t size;                // 输入文件大小
+    size_t start;               // 负责范围的起点
+    size_t end;                 // 负责范围的终点
+    int capture;                // 是否为抓包文件
+    int index;                  // 线程序号
+    realtime_columns_t cols;    // 解码结果 (每批复用)
+    import_frame_t *frames;     // 解码出的帧
+    size_t frame_count;         // 帧数
+    size_t frame_capacity;      // 帧数组容量
+    uint64_t bad_frames;        // 损坏的帧数
+    int failed;                 // 是否内存不足
+} import_worker_t;
+
+/**
+ * @brief 段写出任务
+ */
+typedef struct {
+    size_t first_frame;         // 排序后的首帧下标
+    size_t frame_count;         // 帧数
+    uint64_t first_row;         // 段首行行号
+} import_segment_t;
+
+/**
+ * @brief 导入状态
+ */
+typedef struct {
+    const char *dir;            // 段文件目录
+    history_tier_t tier;        // 目标层
+    int threads;                // 线程数
+    size_t batch_bytes;         // 每批输入字节数
+    import_worker_t workers[MAX_IMPORT_THREADS]; // 解码线程
+
+    import_frame_t *frames;     // 本批全部帧
+    import_frame_t *sorted;     // 排序缓冲
+    size_t frame_capacity;      // 帧数组容量
+    import_segment_t *segments; // 本批的段
+    size_t segment_count;       // 段数
+    size_t segment_capacity;    // 段数组容量
+    size_t next_segment;        // 下一个待写出的段 (原子递增)
+    int write_failed;           // 是否有段写出失败
+
+    uint64_t next_row;          // 下一个导入行号
+    uint64_t input_bytes;       // 累计输入字节数
+    uint64_t frames_total;      // 累计实时信息帧数
+    uint64_t rows_total;        // 累计行数
+    uint64_t bad_total;         // 累计损坏帧数
+    uint64_t segments_total;    // 累计段数
+    uint64_t output_bytes;      // 累计写出字节数
+} importer_t;
+
+/**
+ * @brief 获取单调时钟纳秒数
+ */
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief 记录一帧的解码结果
+ */
+static int push_frame(import_worker_t *worker, size_t first_row, int rows, int raw) {
+    if (worker->frame_count == worker->frame_capacity) {
+        size_t capacity = worker->frame_capacity ? worker->frame_capacity * 2 : 4096;
+        import_frame_t *frames = realloc(worker->frames, capacity * sizeof(import_frame_t));
+        if (!frames) {
+            return -1;
+        }
+        worker->frames = frames;
+        worker->frame_capacity = capacity;
+    }
+
+    const realtime_columns_t *cols = &worker->cols;
+    int64_t ts = cols->timestamp_ms[first_row];
+    if (raw) {
+        for (int i = 0; i < rows; i++) {
+            worker->cols.received_ns[first_row + i] = ts * 1000000LL;
+        }
+    }
+
+    import_frame_t *frame = &worker->frames[worker->frame_count++];
+    frame->device = ((uint64_t)cols->admin_code[first_row] << 32) |
+                    ((uint64_t)cols->device_type[first_row] << 16) | cols->device_id[first_row];
+    frame->hour = (uint32_t)(ts / HOUR_MS);
+    frame->ms_in_hour = (uint32_t)(ts % HOUR_MS);
+    frame->row = (uint32_t)first_row;
+    frame->rows = (uint16_t)rows;
+    frame->worker = (uint16_t)worker->index;
+    return 0;
+}
+
+/**
+ * @brief 解码一帧并记录
+ */
+static void decode_one(import_worker_t *worker, const uint8_t *frame, size_t len,
+                       int64_t received_ns, int raw) {
+    if (worker->cols.count + 255 > worker->cols.capacity &&
+        realtime_columns_reserve(&worker->cols, worker->cols.count + 255) < 0) {
+        worker->failed = 1;
+        return;
+    }
+    size_t first = worker->cols.count;
+    int rows = realtime_decode_frame(&worker->cols, frame, len, received_ns);
+    if (rows < 0) {
+        worker->bad_frames++;
+    } else if (rows > 0 && push_frame(worker, first, rows, raw) < 0) {
+        worker->failed = 1;
+    }
+}
+
+/**
+ * @brief 解码线程：抓包文件按记录读取，原始转储按帧标识切分
+ * 原始转储中每个0xC0都是帧边界，相邻两个0xC0之间的非空字节为一个候选帧；
+ * 起始标识落在[start, end)内的候选帧归本线程，末尾的帧可越过end读取
+ */
+static void *decode_range(void *arg) {
+    import_worker_t *worker = (import_worker_t *)arg;
+    worker->cols.count = 0;
+    worker->frame_count = 0;
+
+    if (worker->capture) {
+        capture_reader_t reader = {worker->data, worker->end, worker->start};
+        int64_t timestamp_ns;
+        const uint8_t *frame;
+        size_t len;
+        while (!worker->failed && capture_reader_next(&reader, &timestamp_ns, &frame, &len) > 0) {
+            decode_one(worker, frame, len, timestamp_ns, 0);
+        }
+        return NULL;
+    }
+
+    const uint8_t *p = memchr(worker->data + worker->start, FRAME_START, worker->end - worker->start);
+    while (p && p < worker->data + worker->end && !worker->failed) {
+        const uint8_t *q = memchr(p + 1, FRAME_END, (size_t)(worker->data + worker->size - p - 1));
+        if (!q) {
+            break;      // 文件末尾不完整的帧
+        }
+        if (q - p > 1) {
+            decode_one(worker, p, (size_t)(q - p + 1), 0, 1);
+        }
+        p = q;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 帧排序键的第d个字节 (由低到高)
+ */
+static inline uint8_t frame_digit(const import_frame_t *frame, int d, uint32_t base_hour) {
+    if (d < 3) {
+        return (uint8_t)(frame->ms_in_hour >> (d * 8));
+    }
+    if (d < 10) {
+        return (uint8_t)(frame->device >> ((d - 3) * 8));
+    }
+    return (uint8_t)((frame->hour - base_hour) >> ((d - 10) * 8));
+}
+
+/**
+ * @brief 按(小时, 设备, 小时内毫秒)对帧做稳定的LSD基数排序，全部相同的字节跳过
+ * @return 排序结果所在的数组
+ */
+static import_frame_t *sort_frames(import_frame_t *frames, import_frame_t *buffer, size_t count) {
+    if (count == 0) {
+        return frames;
+    }
+    uint32_t base_hour = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        base_hour = frames[i].hour < base_hour ? frames[i].hour : base_hour;
+    }
+
+    for (int d = 0; d < SORT_DIGITS; d++) {
+        size_t counts[256] = {0};
+        for (size_t i = 0; i < count; i++) {
+            counts[frame_digit(&frames[i], d, base_hour)]++;
+        }
+        if (counts[frame_digit(&frames[0], d, base_hour)] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t n = counts[b];
+            counts[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            buffer[counts[frame_digit(&frames[i], d, base_hour)]++] = frames[i];
+        }
+        import_frame_t *tmp = frames;
+        frames = buffer;
+        buffer = tmp;
+    }
+    return frames;
+}
+
+/**
+ * @brief 段写出线程
+ */
+typedef struct {
+    importer_t *importer;       // 导入状态
+    const import_frame_t *frames; // 排序后的帧
+    realtime_columns_t cols;    // 收集缓冲 (一段)
+    uint64_t bytes;             // 写出字节数
+} import_writer_t;
+
+/**
+ * @brief 段写出线程：按排序后的帧顺序收集各列并写段文件
+ */
+static void *write_segments(void *arg) {
+    import_writer_t *writer = (import_writer_t *)arg;
+    importer_t *importer = writer->importer;
+
+    for (;;) {
+        size_t s = __atomic_fetch_add(&importer->next_segment, 1, __ATOMIC_RELAXED);
+        if (s >= importer->segment_count || __atomic_load_n(&importer->write_failed, __ATOMIC_RELAXED)) {
+            break;
+        }
+        const import_segment_t *segment = &importer->segments[s];
+        realtime_columns_t *dst = &writer->cols;
+        dst->count = 0;
+        for (size_t f = segment->first_frame; f < segment->first_frame + segment->frame_count; f++) {
+            const import_frame_t *frame = &writer->frames[f];
+            const realtime_columns_t *src = &importer->workers[frame->worker].cols;
+            for (int i = 0; i < REALTIME_COLUMN_COUNT; i++) {
+                size_t item = realtime_column_info[i].item_size;
+                memcpy((uint8_t *)realtime_column_data(dst, i) + dst->count * item,
+                       (const uint8_t *)realtime_column_data(src, i) + (size_t)frame->row * item,
+                       frame->rows * item);
+            }
+            dst->count += frame->rows;
+        }
+
+        int64_t bytes = history_write_segment(importer->dir, importer->tier, dst, segment->first_row);
+        if (bytes < 0) {
+            __atomic_store_n(&importer->write_failed, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        writer->bytes += (uint64_t)bytes;
+    }
+    return NULL;
+}
+
+/**
+ * @brief 按线程数运行函数 (单线程时在调用线程中运行)
+ */
+static void run_parallel(int threads, void *(*fn)(void *), void *args, size_t arg_size) {
+    pthread_t tids[MAX_IMPORT_THREADS];
+    int started[MAX_IMPORT_THREADS] = {0};
+    for (int t = 1; t < threads; t++) {
+        started[t] = pthread_create(&tids[t], NULL, fn, (uint8_t *)args + t * arg_size) == 0;
+    }
+    fn(args);
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        } else {
+            fn((uint8_t *)args + t * arg_size);
+        }
+    }
+}
+
+/**
+ * @brief 排序本批的帧并并行写出段
+ * @return 0成功，-1失败
+ */
+static int flush_batch(importer_t *importer) {
+    size_t total = 0;
+    for (int t = 0; t < importer->threads; t++) {
+        total += importer->workers[t].frame_count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    if (total > importer->frame_capacity) {
+        free(importer->frames);
+        free(importer->sorted);
+        importer->frames = malloc(total * sizeof(import_frame_t));
+        importer->sorted = malloc(total * sizeof(import_frame_t));
+        importer->frame_capacity = importer->frames && importer->sorted ? total : 0;
+        if (!importer->frame_capacity) {
+            return -1;
+        }
+    }
+    size_t n = 0;
+    for (int t = 0; t < importer->threads; t++) {
+        memcpy(importer->frames + n, importer->workers[t].frames,
+               importer->workers[t].frame_count * sizeof(import_frame_t));
+        n += importer->workers[t].frame_count;
+    }
+    const import_frame_t *frames = sort_frames(importer->frames, importer->sorted, total);
+
+    // 按行数切段，帧不跨段
+    importer->segment_count = 0;
+    size_t rows = 0;
+    for (size_t f = 0; f < total; f++) {
+        if (importer->segment_count == 0 || rows + frames[f].rows > SEGMENT_ROWS) {
+            if (importer->segment_count == importer->segment_capacity) {
+                size_t capacity = importer->segment_capacity ? importer->segment_capacity * 2 : 64;
+                import_segment_t *segments = realloc(importer->segments, capacity * sizeof(import_segment_t));
+                if (!segments) {
+                    return -1;
+                }
+                importer->segments = segments;
+                importer->segment_capacity = capacity;
+            }
+            import_segment_t *segment = &importer->segments[importer->segment_count++];
+            segment->first_frame = f;
+            segment->frame_count = 0;
+            segment->first_row = importer->next_row;
+            rows = 0;
+        }
+        importer->segments[importer->segment_count - 1].frame_count++;
+        rows += frames[f].rows;
+        importer->next_row += frames[f].rows;
+        importer->rows_total += frames[f].rows;
+    }
+
+    import_writer_t writers[MAX_IMPORT_THREADS];
+    int threads = importer->threads < (int)importer->segment_count ? importer->threads
+                                                                    : (int)importer->segment_count;
+    for (int t = 0; t < threads; t++) {
+        writers[t].importer = importer;
+        writers[t].frames = frames;
+        writers[t].bytes = 0;
+        if (realtime_columns_init(&writers[t].cols, SEGMENT_ROWS) < 0) {
+            return -1;
+        }
+    }
+    importer->next_segment = 0;
+    run_parallel(threads, write_segments, writers, sizeof(import_writer_t));
+    for (int t = 0; t < threads; t++) {
+        importer->output_bytes += writers[t].bytes;
+        realtime_columns_free(&writers[t].cols);
+    }
+
+    importer->frames_total += total;
+    importer->segments_total += importer->segment_count;
+    return importer->write_failed ? -1 : 0;
+}
+
+/**
+ * @brief 确定一批抓包记录的范围，并按字节数均分给各线程 (边界落在记录头上)
+ * @return 本批的终点
+ */
+static size_t plan_capture_batch(importer_t *importer, const uint8_t *data, size_t size, size_t offset) {
+    size_t share = importer->batch_bytes / (size_t)importer->threads;
+    size_t pos = offset;
+    int t = 0;
+    importer->workers[0].start = offset;
+    while (pos < size && pos - offset < importer->batch_bytes) {
+        size_t len = size - pos < CAPTURE_RECORD_HEADER_SIZE ? SIZE_MAX :
+                     ((uint32_t)data[pos + 8] | ((uint32_t)data[pos + 9] << 8) |
+                      ((uint32_t)data[pos + 10] << 16) | ((uint32_t)data[pos + 11] << 24));
+        if (len == SIZE_MAX || size - pos - CAPTURE_RECORD_HEADER_SIZE < len) {
+            // 末尾不完整的记录交给读取器，读取器在此处停止
+            LOG_WARN("Capture file truncated at offset %zu", pos);
+            pos = size;
+            break;
+        }
+        pos += CAPTURE_RECORD_HEADER_SIZE + len;
+        if (t + 1 < importer->threads && pos - offset >= share * (size_t)(t + 1)) {
+            importer->workers[t].end = pos;
+            importer->workers[++t].start = pos;
+        }
+    }
+    importer->workers[t].end = pos;
+    while (++t < importer->threads) {
+        importer->workers[t].start = importer->workers[t].end = pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief 导入一个输入文件
+ * @return 0成功，-1失败
+ */
+static int import_file(importer_t *importer, const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        LOG_ERROR("Failed to open %s: %s", path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+    const uint8_t *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        LOG_ERROR("Failed to map %s: %s", path, strerror(errno));
+        return -1;
+    }
+    madvise((void *)data, size, MADV_SEQUENTIAL);
+
+    int capture = size >= CAPTURE_MAGIC_SIZE && memcmp(data, CAPTURE_MAGIC, CAPTURE_MAGIC_SIZE) == 0;
+    size_t offset = capture ? CAPTURE_MAGIC_SIZE : 0;
+    int result = 0;
+    while (offset < size && result == 0) {
+        size_t end;
+        if (capture) {
+            end = plan_capture_batch(importer, data, size, offset);
+        } else {
+            end = size - offset > importer->batch_bytes ? offset + importer->batch_bytes : size;
+            size_t share = (end - offset) / (size_t)importer->threads;
+            for (int t = 0; t < importer->threads; t++) {
+                importer->workers[t].start = offset + share * (size_t)t;
+                importer->workers[t].end = t + 1 == importer->threads ? end : offset + share * (size_t)(t + 1);
+            }
+        }
+        for (int t = 0; t < importer->threads; t++) {
+            importer->workers[t].data = data;
+            importer->workers[t].size = size;
+            importer->workers[t].capture = capture;
+        }
+
+        run_parallel(importer->threads, decode_range, importer->workers, sizeof(import_worker_t));
+        for (int t = 0; t < importer->threads; t++) {
+            importer->bad_total += importer->workers[t].bad_frames;
+            importer->workers[t].bad_frames = 0;
+            if (importer->workers[t].failed) {
+                LOG_ERROR("Out of memory decoding %s", path);
+                result = -1;
+            }
+        }
+        if (result == 0 && flush_batch(importer) < 0) {
+            LOG_ERROR("Failed to write history segments for %s", path);
+            result = -1;
+        }
+        importer->input_bytes += end - offset;
+        offset = end;
+    }
+
+    munmap((void *)data, size);
+    return result;
+}
+
+/**
+ * @brief 删除上次导入中断留下的临时文件 (持有导入锁时调用)
+ */
+static void remove_stale_temp_files(const char *dir) {
+    const char *tiers[] = {"warm", "cold"};
+    for (int t = 0; t < 2; t++) {
+        char tier_dir[512];
+        snprintf(tier_dir, sizeof(tier_dir), "%s/%s", dir, tiers[t]);
+        DIR *d = opendir(tier_dir);
+        if (!d) {
+            continue;
+        }
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            if (strncmp(entry->d_name, "import-", 7) == 0) {
+                char path[sizeof(tier_dir) + sizeof(entry->d_name)];
+                snprintf(path, sizeof(path), "%s/%s", tier_dir, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(d);
+    }
+}
+
+/**
+ * @brief 创建段文件目录并获取导入锁
+ * @return 锁文件描述符，-1失败
+ */
+static int lock_directory(const char *dir) {
+    char path[512];
+    const char *subdirs[] = {"", "/warm", "/cold"};
+    for (int i = 0; i < 3; i++) {
+        snprintf(path, sizeof(path), "%s%s", dir, subdirs[i]);
+        if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+            LOG_ERROR("Failed to create %s: %s", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    snprintf(path, sizeof(path), "%s/import.lock", dir);
+    int fd = open(path, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        LOG_ERROR("Another import is running in %s", dir);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s -d <dir> [options] <file>...\n", program_name);
+    printf("Import capture files or raw frame dumps into history segments.\n");
+    printf("Options:\n");
+    printf("  -d <dir>     History directory (required, same as server_demo -H)\n");
+    printf("  -j <n>       Threads (default: online CPUs)\n");
+    printf("  -b <mb>      Input bytes per batch (default: %d)\n", DEFAULT_BATCH_MB);
+    printf("  -w           Write warm (uncompressed) segments instead of cold\n");
+    printf("  -l <level>   Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
+    printf("  -h           Show this help\n");
+    printf("\nExample:\n");
+    printf("  %s -d /var/lib/traffic/history -j 16 old_site_*.cap\n", program_name);
+}
+
+int main(int argc, char *argv[]) {
+    static importer_t importer;
+    const char *dir = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int batch_mb = DEFAULT_BATCH_MB;
+    history_tier_t tier = HISTORY_TIER_COLD;
+    log_level_t log_level = LOG_LEVEL_INFO;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:j:b:wl:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                dir = optarg;
+                break;
+            case 'j':
+                threads = atoi(optarg);
+                break;
+            case 'b':
+                batch_mb = atoi(optarg);
+                break;
+            case 'w':
+                tier = HISTORY_TIER_WARM;
+                break;
+            case 'l':
+                log_level = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!dir || optind >= argc || threads < 1 || batch_mb < 1) {
+        show_usage(argv[0]);
+        return 1;
+    }
+    if (threads > MAX_IMPORT_THREADS) {
+        threads = MAX_IMPORT_THREADS;
+    }
+
+    logger_init(log_level, NULL);
+    int lock_fd = lock_directory(dir);
+    if (lock_fd < 0) {
+        logger_close();
+        return 1;
+    }
+    remove_stale_temp_files(dir);
+
+    importer.dir = dir;
+    importer.tier = tier;
+    importer.threads = threads;
+    importer.batch_bytes = (size_t)batch_mb << 20;
+    importer.next_row = history_import_next_row(dir);
+    for (int t = 0; t < threads; t++) {
+        importer.workers[t].index = t;
+        if (realtime_columns_init(&importer.workers[t].cols, 0) < 0) {
+            LOG_ERROR("Failed to allocate decode buffers");
+            return 1;
+        }
+    }
+
+    int result = 0;
+    int64_t begin = now_ns();
+    for (int i = optind; i < argc && result == 0; i++) {
+        LOG_INFO("Importing %s", argv[i]);
+        result = import_file(&importer, argv[i]);
+    }
+    double seconds = (double)(now_ns() - begin) / 1e9;
+
+    printf("Imported %llu rows from %llu frames (%llu bad) in %llu %s segments\n",
+           (unsigned long long)importer.rows_total, (unsigned long long)importer.frames_total,
+           (unsigned long long)importer.bad_total, (unsigned long long)importer.segments_total,
+           history_tier_name(tier));
+    printf("Input %.1f MB, output %.1f MB, %.2f s, %.1f MB/s with %d threads\n",
+           importer.input_bytes / 1e6, importer.output_bytes / 1e6, seconds,
+           seconds > 0 ? importer.input_bytes / 1e6 / seconds : 0.0, threads);
+
+    for (int t = 0; t < threads; t++) {
+        realtime_columns_free(&importer.workers[t].cols);
+        free(importer.workers[t].frames);
+    }
+    free(importer.frames);
+    free(importer.sorted);
+    free(importer.segments);
+    close(lock_fd);
+    logger_close();
+    return result == 0 ? 0 : 1;
+}
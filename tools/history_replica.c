@@ -0,0 +1,178 @@
+/**
+ * @file history_replica.c
+ * @brief 历史数据副本进程
+ *
+ * 在另一台机器上接收主节点 (server_demo -H dir -R host:port) 复制来的段文件和热层尾部，
+ * 目录布局与主节点相同。主节点失效时向进程发送SIGUSR1 (或以-P启动) 提升副本：
+ * 停止接收，把尾部日志中的行写为温层段，然后打开历史存储，
+ * 在-Q指定的端口上为其他节点提供分桶聚合查询 (与server_demo -Q相同的查询服务)。
+ * 运行期间每秒把复制位置和接收量写入-m指定的指标文件。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <unistd.h>
+#include "server/history_replication.h"
+#include "server/history_federation.h"
+#include "utils/logger.h"
+#include "utils/metrics.h"
+
+#define DEFAULT_PORT 41000          // 默认复制端口
+
+static volatile sig_atomic_t g_running = 1;
+static volatile sig_atomic_t g_promote = 0;
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig) {
+    if (sig == SIGUSR1) {
+        g_promote = 1;
+    } else {
+        g_running = 0;
+    }
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s -d <dir> [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -d <dir>     Replica history directory (required)\n");
+    printf("  -p <port>    Replication listen port (default: %d)\n", DEFAULT_PORT);
+    printf("  -Q <port>    Serve bucketed history aggregates on port after promotion\n");
+    printf("  -P           Promote immediately instead of waiting for SIGUSR1\n");
+    printf("  -m <file>    Write replica metrics to file every second\n");
+    printf("  -l <level>   Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
+    printf("  -h           Show this help\n");
+}
+
+/**
+ * @brief 提升后的服务：打开历史存储并提供聚合查询，直到收到退出信号
+ * @return 0成功，1失败
+ */
+static int serve_promoted(const char *dir, int query_port, const char *metrics_file) {
+    history_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.dir = dir;
+    history_store_t hist;
+    if (history_init(&hist, &config) < 0) {
+        LOG_ERROR("Failed to open promoted history directory %s", dir);
+        return 1;
+    }
+
+    query_cache_t cache;
+    federation_server_t server;
+    int serving = query_port && query_cache_init(&cache, &hist, 0) == 0;
+    if (serving && federation_server_start(&server, &cache, query_port, 0) < 0) {
+        query_cache_destroy(&cache);
+        serving = 0;
+    }
+    if (query_port && !serving) {
+        LOG_ERROR("Failed to serve history queries on port %d", query_port);
+        history_destroy(&hist);
+        return 1;
+    }
+    printf("Promoted: %llu rows in %zu warm and %zu cold segments\n",
+           (unsigned long long)hist.persisted_end, hist.tier_segments[HISTORY_TIER_WARM],
+           hist.tier_segments[HISTORY_TIER_COLD]);
+
+    while (g_running) {
+        sleep(1);
+        history_export_metrics(&hist);
+        if (serving) {
+            federation_server_export_metrics(&server);
+        }
+        if (metrics_file) {
+            metrics_write_file(metrics_file);
+        }
+    }
+
+    if (serving) {
+        federation_server_stop(&server);
+        query_cache_destroy(&cache);
+    }
+    history_destroy(&hist);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dir = NULL;
+    int port = DEFAULT_PORT;
+    int query_port = 0;
+    const char *metrics_file = NULL;
+    log_level_t log_level = LOG_LEVEL_INFO;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:p:Q:Pm:l:h")) != -1) {
+        switch (opt) {
+            case 'd':
+                dir = optarg;
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'Q':
+                query_port = atoi(optarg);
+                break;
+            case 'P':
+                g_promote = 1;
+                break;
+            case 'm':
+                metrics_file = optarg;
+                break;
+            case 'l':
+                log_level = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!dir || port <= 0 || port > 65535 || query_port < 0 || query_port > 65535 ||
+        log_level < LOG_LEVEL_DEBUG || log_level > LOG_LEVEL_ERROR) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    logger_init(log_level, NULL);
+    metrics_init();
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGUSR1, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (!g_promote) {
+        replica_t replica;
+        if (replica_start(&replica, dir, port) < 0) {
+            fprintf(stderr, "Failed to start replica at %s on port %d\n", dir, port);
+            return 1;
+        }
+        printf("Replicating history into %s on port %d (SIGUSR1 promotes)\n", dir, replica.port);
+        while (g_running && !g_promote) {
+            sleep(1);
+            replica_export_metrics(&replica);
+            if (metrics_file) {
+                metrics_write_file(metrics_file);
+            }
+        }
+        replica_stop(&replica);
+        if (!g_running) {
+            return 0;
+        }
+    }
+
+    if (replica_promote(dir) < 0) {
+        fprintf(stderr, "Failed to promote replica at %s\n", dir);
+        return 1;
+    }
+    return serve_promoted(dir, query_port, metrics_file);
+}
@@ -0,0 +1,783 @@
+/**
+ * @file impair_proxy.c
+ * @brief 用户态网络劣化代理
+ *
+ * 位于检测器(或压测程序)与server_demo之间转发TCP数据，按配置注入：
+ * - 延迟分布 (固定/均匀/正态/帕累托长尾)
+ * - 带宽限制
+ * - 报文切分 (将数据拆成随机长度的小段发送，用于考验帧提取逻辑)
+ * - 传输停顿
+ * - 连接复位
+ * 无需root权限和netem，可按连接轮流套用不同的劣化配置。
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "utils/socket_utils.h"
+#include "utils/logger.h"
+
+#define MAX_PROXY_CONNECTIONS 512   // 最大代理连接数
+#define MAX_PROFILES 8              // 最多轮流套用的劣化配置数
+#define READ_CHUNK_SIZE 16384       // 单次读取字节数
+#define MAX_QUEUED_BYTES (1 << 20)  // 单方向最大排队字节数，超过后暂停读取
+#define STATS_INTERVAL 10           // 统计输出间隔(秒)
+#define LINK_BURST_US 1000          // 带宽限制下允许提前发送的时间(微秒)，小段不必逐个等待
+
+/**
+ * @brief 延迟分布类型
+ */
+typedef enum {
+    DELAY_FIXED = 0,        // 固定延迟
+    DELAY_UNIFORM,          // [delay-jitter, delay+jitter] 均匀分布
+    DELAY_NORMAL,           // 均值delay、标准差jitter的正态分布
+    DELAY_PARETO            // delay加上尺度为jitter的帕累托长尾
+} delay_dist_t;
+
+/**
+ * @brief 劣化配置
+ */
+typedef struct {
+    char name[32];              // 配置名称
+    delay_dist_t dist;          // 延迟分布
+    double delay_ms;            // 基础延迟(毫秒)
+    double jitter_ms;           // 延迟抖动(毫秒)
+    double bandwidth_kbps;      // 带宽限制(kbit/s)，0表示不限
+    int max_segment;            // 最大报文段长度，0表示不切分
+    double stall_prob;          // 每个报文段触发停顿的概率
+    double stall_ms;            // 停顿时长(毫秒)
+    double reset_per_sec;       // 每秒触发连接复位的概率
+} impair_profile_t;
+
+/**
+ * @brief 待发送的数据段
+ */
+typedef struct segment {
+    struct segment *next;
+    long long due_us;           // 最早发送时间(微秒)
+    size_t len;                 // 数据长度
+    size_t offset;              // 已发送偏移
+    uint8_t data[];             // 数据
+} segment_t;
+
+/**
+ * @brief 单方向的转发状态
+ */
+typedef struct {
+    int from_fd;                // 读取端
+    int to_fd;                  // 写入端
+    segment_t *head;            // 待发送队列头
+    segment_t *tail;            // 待发送队列尾
+    size_t queued_bytes;        // 排队字节数
+    long long last_due_us;      // 最后一个数据段的发送时间 (保证TCP字节序)
+    double link_free_us;        // 带宽限制下链路空闲的时间 (保留小数，小段的发送耗时不被截断)
+    int poll_index;             // 本轮读取端在poll数组中的位置，-1表示未监听
+    int eof;                    // 读取端已关闭
+    int shut;                   // 已向写入端发送FIN
+    uint64_t bytes;             // 已转发字节数
+    uint64_t segments;          // 已转发段数
+    uint64_t stalls;            // 停顿次数
+} direction_t;
+
+/**
+ * @brief 代理连接
+ */
+typedef struct {
+    int active;
+    int id;
+    const impair_profile_t *profile;
+    direction_t up;             // 检测器 -> 服务端
+    direction_t down;           // 服务端 -> 检测器
+    int connecting;             // 到目标服务器的非阻塞连接尚未完成
+    int connect_index;          // 本轮目标socket在poll数组中的位置 (连接中)，-1表示未监听
+    long long last_reset_check_us;
+} proxy_conn_t;
+
+static volatile sig_atomic_t g_running = 1;
+static uint64_t g_rng_state = 0x9E3779B97F4A7C15ULL;
+static proxy_conn_t g_conns[MAX_PROXY_CONNECTIONS];
+static uint64_t g_total_resets = 0;
+
+/**
+ * @brief 内置劣化配置
+ */
+static const impair_profile_t builtin_profiles[] = {
+    // 名称       分布           延迟  抖动  带宽kbps 切分 停顿概率 停顿ms 复位/秒
+    {"lan",      DELAY_FIXED,    0.2,  0,    0,      0,   0,      0,     0},
+    {"cellular", DELAY_PARETO,   60,   15,   2000,   536, 0.002,  1500,  0.0005},
+    {"serial",   DELAY_UNIFORM,  25,   10,   9.6,    16,  0.001,  500,   0},
+    {"lossy",    DELAY_NORMAL,   120,  60,   512,    64,  0.02,   3000,  0.002},
+    {"fragment", DELAY_FIXED,    0,    0,    0,      3,   0,      0,     0},
+};
+
+/**
+ * @brief 信号处理函数
+ */
+static void signal_handler(int sig) {
+    (void)sig;
+    g_running = 0;
+}
+
+/**
+ * @brief 获取单调时钟微秒数
+ */
+static long long now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * @brief 生成[0,1)均匀分布随机数 (xorshift64*)
+ */
+static double rand_uniform(void) {
+    g_rng_state ^= g_rng_state >> 12;
+    g_rng_state ^= g_rng_state << 25;
+    g_rng_state ^= g_rng_state >> 27;
+    return (double)((g_rng_state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+/**
+ * @brief 按配置采样一个延迟值(毫秒)
+ */
+static double sample_delay(const impair_profile_t *profile) {
+    double delay = profile->delay_ms;
+
+    switch (profile->dist) {
+        case DELAY_UNIFORM:
+            delay += (rand_uniform() * 2 - 1) * profile->jitter_ms;
+            break;
+        case DELAY_NORMAL: {
+            // Box-Muller变换
+            double u1 = rand_uniform();
+            double u2 = rand_uniform();
+            if (u1 < 1e-12) {
+                u1 = 1e-12;
+            }
+            delay += sqrt(-2 * log(u1)) * cos(2 * M_PI * u2) * profile->jitter_ms;
+            break;
+        }
+        case DELAY_PARETO: {
+            // 形状参数1.5的帕累托分布，模拟重传造成的长尾
+            double u = 1 - rand_uniform();
+            delay += profile->jitter_ms * (pow(u, -1.0 / 1.5) - 1);
+            break;
+        }
+        case DELAY_FIXED:
+        default:
+            break;
+    }
+
+    return delay > 0 ? delay : 0;
+}
+
+/**
+ * @brief 查找内置劣化配置
+ */
+static const impair_profile_t *find_profile(const char *name) {
+    for (size_t i = 0; i < sizeof(builtin_profiles) / sizeof(builtin_profiles[0]); i++) {
+        if (strcmp(builtin_profiles[i].name, name) == 0) {
+            return &builtin_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief 解析延迟分布名称
+ */
+static int parse_dist(const char *name, delay_dist_t *dist) {
+    if (strcmp(name, "fixed") == 0) {
+        *dist = DELAY_FIXED;
+    } else if (strcmp(name, "uniform") == 0) {
+        *dist = DELAY_UNIFORM;
+    } else if (strcmp(name, "normal") == 0) {
+        *dist = DELAY_NORMAL;
+    } else if (strcmp(name, "pareto") == 0) {
+        *dist = DELAY_PARETO;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 开始以非阻塞方式连接目标服务器，不阻塞其他连接的转发
+ *
+ * 连接结果在目标socket可写后由check_connect检查。
+ * @return 目标socket，-1表示地址无效或立即失败
+ */
+static int connect_target(const char *host, int port) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) {
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief 检查非阻塞连接的结果
+ * @return 0已连接，-1连接失败
+ */
+static int check_connect(int fd) {
+    int error = 0;
+    socklen_t error_len = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) < 0) {
+        return -1;
+    }
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 释放方向上的排队数据
+ */
+static void free_direction(direction_t *dir) {
+    segment_t *seg = dir->head;
+    while (seg) {
+        segment_t *next = seg->next;
+        free(seg);
+        seg = next;
+    }
+    dir->head = dir->tail = NULL;
+    dir->queued_bytes = 0;
+}
+
+/**
+ * @brief 关闭代理连接
+ * @param reset 1表示以RST方式关闭两端
+ */
+static void close_conn(proxy_conn_t *conn, int reset) {
+    if (reset) {
+        struct linger lg = {1, 0};
+        setsockopt(conn->up.from_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        setsockopt(conn->up.to_fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        g_total_resets++;
+    }
+
+    LOG_INFO("Connection %d closed%s: up %llu bytes/%llu segments/%llu stalls, "
+             "down %llu bytes/%llu segments/%llu stalls",
+             conn->id, reset ? " by injected reset" : "",
+             (unsigned long long)conn->up.bytes, (unsigned long long)conn->up.segments,
+             (unsigned long long)conn->up.stalls,
+             (unsigned long long)conn->down.bytes, (unsigned long long)conn->down.segments,
+             (unsigned long long)conn->down.stalls);
+
+    close(conn->up.from_fd);
+    close(conn->up.to_fd);
+    free_direction(&conn->up);
+    free_direction(&conn->down);
+    conn->active = 0;
+}
+
+/**
+ * @brief 将读取的数据按配置切分并排队
+ */
+static int enqueue_data(direction_t *dir, const impair_profile_t *profile,
+                        const uint8_t *data, size_t len, long long now) {
+    size_t pos = 0;
+
+    while (pos < len) {
+        size_t seg_len = len - pos;
+        if (profile->max_segment > 0) {
+            size_t max_len = 1 + (size_t)(rand_uniform() * profile->max_segment);
+            if (seg_len > max_len) {
+                seg_len = max_len;
+            }
+        }
+
+        segment_t *seg = malloc(sizeof(segment_t) + seg_len);
+        if (!seg) {
+            return -1;
+        }
+        memcpy(seg->data, data + pos, seg_len);
+        seg->len = seg_len;
+        seg->offset = 0;
+        seg->next = NULL;
+
+        // 发送时间单调不减，保持TCP字节流顺序
+        long long due = now + (long long)(sample_delay(profile) * 1000);
+        if (profile->stall_prob > 0 && rand_uniform() < profile->stall_prob) {
+            due += (long long)(profile->stall_ms * 1000);
+            dir->stalls++;
+        }
+        if (due < dir->last_due_us) {
+            due = dir->last_due_us;
+        }
+        seg->due_us = due;
+        dir->last_due_us = due;
+
+        if (dir->tail) {
+            dir->tail->next = seg;
+        } else {
+            dir->head = seg;
+        }
+        dir->tail = seg;
+        dir->queued_bytes += seg_len;
+        pos += seg_len;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 从读取端读取数据
+ * @return 0正常，-1连接出错
+ */
+static int read_direction(direction_t *dir, const impair_profile_t *profile, long long now) {
+    uint8_t buffer[READ_CHUNK_SIZE];
+    int n = recv(dir->from_fd, buffer, sizeof(buffer), 0);
+
+    if (n == 0) {
+        dir->eof = 1;
+        return 0;
+    }
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+    }
+
+    return enqueue_data(dir, profile, buffer, (size_t)n, now);
+}
+
+/**
+ * @brief 发送已到期的数据段
+ * @return 0正常，-1连接出错
+ */
+static int flush_direction(direction_t *dir, const impair_profile_t *profile, long long now) {
+    while (dir->head && dir->head->due_us <= now) {
+        // 带宽限制：链路忙时等待 (链路空闲时间累计小数部分，平均速率不受突发影响)
+        if (profile->bandwidth_kbps > 0 && dir->link_free_us > now + LINK_BURST_US) {
+            break;
+        }
+
+        segment_t *seg = dir->head;
+        int n = send(dir->to_fd, seg->data + seg->offset, seg->len - seg->offset, MSG_NOSIGNAL);
+        if (n < 0) {
+            return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+        }
+
+        seg->offset += n;
+        dir->bytes += n;
+        dir->queued_bytes -= n;
+
+        if (profile->bandwidth_kbps > 0) {
+            // n字节在kbit/s链路上占用 n*8/kbps 毫秒，即 n*8000/kbps 微秒
+            double start = dir->link_free_us > now ? dir->link_free_us : (double)now;
+            dir->link_free_us = start + n * 8000.0 / profile->bandwidth_kbps;
+        }
+
+        if (seg->offset < seg->len) {
+            break; // 写入端缓冲区已满
+        }
+
+        dir->segments++;
+        dir->head = seg->next;
+        if (!dir->head) {
+            dir->tail = NULL;
+        }
+        free(seg);
+    }
+
+    // 读取端关闭且数据已发完时，向写入端转发FIN
+    if (dir->eof && !dir->head && !dir->shut) {
+        shutdown(dir->to_fd, SHUT_WR);
+        dir->shut = 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 计算方向上下一次需要唤醒的时间
+ */
+static long long next_wakeup(const direction_t *dir, const impair_profile_t *profile) {
+    if (!dir->head) {
+        return -1;
+    }
+
+    long long wake = dir->head->due_us;
+    if (profile->bandwidth_kbps > 0 && dir->link_free_us - LINK_BURST_US > wake) {
+        wake = (long long)ceil(dir->link_free_us) - LINK_BURST_US;
+    }
+    return wake;
+}
+
+/**
+ * @brief 显示使用帮助
+ */
+static void show_usage(const char *program_name) {
+    printf("Usage: %s -t <host:port> [options]\n", program_name);
+    printf("Options:\n");
+    printf("  -p <port>        Listen port (default: 40001)\n");
+    printf("  -t <host:port>   Target server address (required)\n");
+    printf("  -P <profile>     Impairment profile, repeat to rotate per connection\n");
+    printf("                   (lan, cellular, serial, lossy, fragment)\n");
+    printf("  -d <ms>          Base one-way delay\n");
+    printf("  -j <ms>          Delay jitter / tail scale\n");
+    printf("  -D <dist>        Delay distribution: fixed, uniform, normal, pareto\n");
+    printf("  -b <kbps>        Bandwidth limit per direction (0 = unlimited)\n");
+    printf("  -s <bytes>       Split data into random segments of 1..bytes\n");
+    printf("  -S <prob:ms>     Stall probability per segment and stall duration\n");
+    printf("  -r <prob>        Connection reset probability per second\n");
+    printf("  -e <seed>        Random seed\n");
+    printf("  -l <level>       Log level (0=DEBUG, 1=INFO, 2=WARN, 3=ERROR) (default: 1)\n");
+    printf("  -h               Show this help\n");
+    printf("\nOptions -d/-j/-D/-b/-s/-S/-r override the last -P profile (or 'lan').\n");
+    printf("\nExample:\n");
+    printf("  %s -p 40001 -t 127.0.0.1:40000 -P cellular -P fragment\n", program_name);
+}
+
+int main(int argc, char *argv[]) {
+    int listen_port = 40001;
+    char target_host[64] = "";
+    int target_port = 0;
+    impair_profile_t profiles[MAX_PROFILES];
+    int profile_count = 0;
+    impair_profile_t custom = builtin_profiles[0];
+    int custom_set = 0;
+    log_level_t log_level = LOG_LEVEL_INFO;
+
+    // 解析命令行参数
+    int opt;
+    while ((opt = getopt(argc, argv, "p:t:P:d:j:D:b:s:S:r:e:l:h")) != -1) {
+        switch (opt) {
+            case 'p':
+                listen_port = atoi(optarg);
+                break;
+            case 't': {
+                const char *colon = strrchr(optarg, ':');
+                if (!colon || (size_t)(colon - optarg) >= sizeof(target_host)) {
+                    fprintf(stderr, "Invalid target: %s\n", optarg);
+                    return 1;
+                }
+                memcpy(target_host, optarg, colon - optarg);
+                target_host[colon - optarg] = '\0';
+                target_port = atoi(colon + 1);
+                break;
+            }
+            case 'P': {
+                const impair_profile_t *profile = find_profile(optarg);
+                if (!profile || profile_count >= MAX_PROFILES) {
+                    fprintf(stderr, "Unknown profile or too many profiles: %s\n", optarg);
+                    return 1;
+                }
+                profiles[profile_count++] = *profile;
+                custom = *profile;
+                break;
+            }
+            case 'd':
+                custom.delay_ms = atof(optarg);
+                custom_set = 1;
+                break;
+            case 'j':
+                custom.jitter_ms = atof(optarg);
+                custom_set = 1;
+                break;
+            case 'D':
+                if (parse_dist(optarg, &custom.dist) < 0) {
+                    fprintf(stderr, "Invalid distribution: %s\n", optarg);
+                    return 1;
+                }
+                custom_set = 1;
+                break;
+            case 'b':
+                custom.bandwidth_kbps = atof(optarg);
+                custom_set = 1;
+                break;
+            case 's':
+                custom.max_segment = atoi(optarg);
+                custom_set = 1;
+                break;
+            case 'S':
+                if (sscanf(optarg, "%lf:%lf", &custom.stall_prob, &custom.stall_ms) != 2) {
+                    fprintf(stderr, "Invalid stall spec: %s\n", optarg);
+                    return 1;
+                }
+                custom_set = 1;
+                break;
+            case 'r':
+                custom.reset_per_sec = atof(optarg);
+                custom_set = 1;
+                break;
+            case 'e':
+                g_rng_state = strtoull(optarg, NULL, 10) | 1;
+                break;
+            case 'l':
+                log_level = atoi(optarg);
+                break;
+            case 'h':
+                show_usage(argv[0]);
+                return 0;
+            default:
+                show_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (target_port <= 0) {
+        show_usage(argv[0]);
+        return 1;
+    }
+
+    // 命令行参数覆盖最后一个配置
+    if (custom_set) {
+        snprintf(custom.name, sizeof(custom.name), "custom");
+        if (profile_count > 0) {
+            profiles[profile_count - 1] = custom;
+        } else {
+            profiles[profile_count++] = custom;
+        }
+    }
+    if (profile_count == 0) {
+        profiles[profile_count++] = builtin_profiles[0];
+    }
+
+    logger_init(log_level, NULL);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = create_tcp_server(listen_port);
+    if (listen_fd < 0) {
+        LOG_ERROR("Failed to listen on port %d", listen_port);
+        return 1;
+    }
+    set_nonblocking(listen_fd);
+
+    for (int i = 0; i < profile_count; i++) {
+        LOG_INFO("Profile %d '%s': delay=%.1fms jitter=%.1fms bw=%.1fkbps split=%d "
+                 "stall=%.4f/%.0fms reset=%.4f/s",
+                 i, profiles[i].name, profiles[i].delay_ms, profiles[i].jitter_ms,
+                 profiles[i].bandwidth_kbps, profiles[i].max_segment,
+                 profiles[i].stall_prob, profiles[i].stall_ms, profiles[i].reset_per_sec);
+    }
+    LOG_INFO("Impairment proxy listening on %d, forwarding to %s:%d",
+             listen_port, target_host, target_port);
+
+    int next_conn_id = 0;
+    time_t last_stats = time(NULL);
+    struct pollfd pfds[1 + 2 * MAX_PROXY_CONNECTIONS];
+
+    while (g_running) {
+        long long now = now_us();
+        long long wake = -1;
+        int nfds = 0;
+
+        pfds[nfds].fd = listen_fd;
+        pfds[nfds].events = POLLIN;
+        nfds++;
+
+        for (int i = 0; i < MAX_PROXY_CONNECTIONS; i++) {
+            proxy_conn_t *conn = &g_conns[i];
+            if (!conn->active) {
+                continue;
+            }
+
+            direction_t *dirs[2] = {&conn->up, &conn->down};
+            dirs[0]->poll_index = -1;
+            dirs[1]->poll_index = -1;
+            conn->connect_index = -1;
+
+            // 连接目标期间只等待连接完成，检测器发来的数据先排队
+            if (conn->connecting) {
+                pfds[nfds].fd = conn->up.to_fd;
+                pfds[nfds].events = POLLOUT;
+                conn->connect_index = nfds++;
+                if (!conn->up.eof && conn->up.queued_bytes < MAX_QUEUED_BYTES) {
+                    pfds[nfds].fd = conn->up.from_fd;
+                    pfds[nfds].events = POLLIN;
+                    conn->up.poll_index = nfds++;
+                }
+                continue;
+            }
+
+            for (int d = 0; d < 2; d++) {
+                // 写入端阻塞时等待可写
+                if (dirs[d]->head && dirs[d]->head->offset > 0) {
+                    pfds[nfds].fd = dirs[d]->to_fd;
+                    pfds[nfds].events = POLLOUT;
+                    nfds++;
+                }
+                if (!dirs[d]->eof && dirs[d]->queued_bytes < MAX_QUEUED_BYTES) {
+                    pfds[nfds].fd = dirs[d]->from_fd;
+                    pfds[nfds].events = POLLIN;
+                    dirs[d]->poll_index = nfds++;
+                }
+
+                long long w = next_wakeup(dirs[d], conn->profile);
+                if (w >= 0 && (wake < 0 || w < wake)) {
+                    wake = w;
+                }
+            }
+        }
+
+        // 以微秒精度等待 (ppoll)，带宽限制下的小段不会被取整到整毫秒
+        long long timeout_us = 1000000;
+        if (wake >= 0) {
+            timeout_us = wake > now ? wake - now : 0;
+            if (timeout_us > 1000000) {
+                timeout_us = 1000000;
+            }
+        }
+        struct timespec timeout = {timeout_us / 1000000, (timeout_us % 1000000) * 1000};
+
+        int ready = ppoll(pfds, nfds, &timeout, NULL);
+        if (ready < 0) {
+            if (errno != EINTR) {
+                LOG_ERROR("Poll error: %s", strerror(errno));
+                break;
+            }
+            // 被信号中断时各revents无效，本轮只处理到期的发送
+            for (int k = 0; k < nfds; k++) {
+                pfds[k].revents = 0;
+            }
+        }
+        now = now_us();
+
+        // 接受新连接
+        if (pfds[0].revents & POLLIN) {
+            int client_fd = accept(listen_fd, NULL, NULL);
+            if (client_fd >= 0) {
+                int slot = -1;
+                for (int i = 0; i < MAX_PROXY_CONNECTIONS; i++) {
+                    if (!g_conns[i].active) {
+                        slot = i;
+                        break;
+                    }
+                }
+
+                int target_fd = slot >= 0 ? connect_target(target_host, target_port) : -1;
+                if (target_fd < 0) {
+                    LOG_WARN("Dropping incoming connection (no slot or target unreachable)");
+                    close(client_fd);
+                } else {
+                    int one = 1;
+                    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                    set_nonblocking(client_fd);
+
+                    proxy_conn_t *conn = &g_conns[slot];
+                    memset(conn, 0, sizeof(*conn));
+                    conn->active = 1;
+                    conn->connecting = 1;
+                    conn->id = next_conn_id;
+                    conn->profile = &profiles[next_conn_id % profile_count];
+                    conn->up.from_fd = client_fd;
+                    conn->up.to_fd = target_fd;
+                    conn->down.from_fd = target_fd;
+                    conn->down.to_fd = client_fd;
+                    // 本轮poll中没有该连接的socket
+                    conn->up.poll_index = -1;
+                    conn->down.poll_index = -1;
+                    conn->connect_index = -1;
+                    conn->last_reset_check_us = now;
+                    next_conn_id++;
+
+                    LOG_INFO("Connection %d accepted, profile '%s'", conn->id, conn->profile->name);
+                }
+            }
+        }
+
+        // 处理各连接：读取、按时发送、注入复位
+        for (int i = 0; i < MAX_PROXY_CONNECTIONS; i++) {
+            proxy_conn_t *conn = &g_conns[i];
+            if (!conn->active) {
+                continue;
+            }
+
+            const impair_profile_t *profile = conn->profile;
+            int failed = 0;
+            direction_t *dirs[2] = {&conn->up, &conn->down};
+
+            if (conn->connecting && conn->connect_index >= 0 && pfds[conn->connect_index].revents) {
+                if (check_connect(conn->up.to_fd) < 0) {
+                    LOG_WARN("Connection %d: target %s:%d unreachable: %s",
+                             conn->id, target_host, target_port, strerror(errno));
+                    failed = 1;
+                } else {
+                    conn->connecting = 0;
+                    LOG_DEBUG("Connection %d connected to target", conn->id);
+                }
+            }
+
+            for (int d = 0; d < 2 && !failed; d++) {
+                // 只读取poll报告可读 (或挂断/出错) 的socket
+                int k = dirs[d]->poll_index;
+                if (k >= 0 && (pfds[k].revents & (POLLIN | POLLHUP | POLLERR))) {
+                    if (read_direction(dirs[d], profile, now) < 0) {
+                        failed = 1;
+                    }
+                }
+                if (!failed && !conn->connecting && flush_direction(dirs[d], profile, now) < 0) {
+                    failed = 1;
+                }
+            }
+
+            if (failed || (conn->up.shut && conn->down.shut)) {
+                close_conn(conn, 0);
+                continue;
+            }
+
+            // 按每秒概率注入连接复位
+            if (profile->reset_per_sec > 0 && now - conn->last_reset_check_us >= 1000000) {
+                conn->last_reset_check_us = now;
+                if (rand_uniform() < profile->reset_per_sec) {
+                    close_conn(conn, 1);
+                }
+            }
+        }
+
+        // 定期输出统计
+        if (time(NULL) - last_stats >= STATS_INTERVAL) {
+            int active = 0;
+            size_t queued = 0;
+            for (int i = 0; i < MAX_PROXY_CONNECTIONS; i++) {
+                if (g_conns[i].active) {
+                    active++;
+                    queued += g_conns[i].up.queued_bytes + g_conns[i].down.queued_bytes;
+                }
+            }
+            LOG_INFO("Proxy stats: %d active connections, %zu bytes queued, %llu injected resets",
+                     active, queued, (unsigned long long)g_total_resets);
+            last_stats = time(NULL);
+        }
+    }
+
+    for (int i = 0; i < MAX_PROXY_CONNECTIONS; i++) {
+        if (g_conns[i].active) {
+            close_conn(&g_conns[i], 0);
+        }
+    }
+    close(listen_fd);
+    logger_close();
+    return 0;
+}